@@ -135,8 +135,11 @@ typedef struct INTNETBUF
     STAMCOUNTER     cStatLost;
     /** Number of bad frames (both rings). */
     STAMCOUNTER     cStatBadFrames;
-    /** Reserved for future use. */
-    STAMCOUNTER     aStatReserved[2];
+    /** Number of times the receiver was woken up by a new frame. */
+    STAMCOUNTER     cStatRecvWakeups;
+    /** Number of receive wakeups that were coalesced because the receiver was
+     * still busy draining the ring. */
+    STAMCOUNTER     cStatRecvWakeupsCoalesced;
     /** Reserved for future send profiling. */
     STAMPROFILE     StatSend1;
     /** Reserved for future send profiling. */
@@ -1876,7 +1876,7 @@ typedef const PDMRTCHLP *PCPDMRTCHLP;
 
 /** Current PDMDEVHLPR3 version number.
  * @todo Next major revision should add piBus to pfnPCIBusRegister.  */
-#define PDM_DEVHLPR3_VERSION                    PDM_VERSION_MAKE_PP(0xffe7, 19, 1)
+#define PDM_DEVHLPR3_VERSION                    PDM_VERSION_MAKE_PP(0xffe7, 19, 2)
 //#define PDM_DEVHLPR3_VERSION                    PDM_VERSION_MAKE_PP(0xffe7, 20, 0)
 
 /**
@@ -3264,9 +3264,30 @@ typedef struct PDMDEVHLPR3
      */
     DECLR3CALLBACKMEMBER(VMRESUMEREASON, pfnVMGetResumeReason,(PPDMDEVINS pDevIns));
 
+    /**
+     * Hands the processing of a device queue over to a dedicated consumer
+     * thread instead of the EMTs.
+     *
+     * Producers (ring-0 and ring-3) wake up the thread directly, without
+     * setting any force action flags.  PDMQueueInsertEx deadlines are used to
+     * coalesce the wakeups, see PDMR3QueueEnableConsumerThread for details.
+     *
+     * @returns VBox status code.
+     * @param   pDevIns             The device instance.
+     * @param   pQueue              The queue, created by pfnQueueCreate with a
+     *                              zero polling interval.  The consumer callback
+     *                              will be called on the new thread.
+     * @param   cMaxBatch           Number of pending items which triggers a
+     *                              wakeup regardless of the deadlines.
+     * @param   enmType             The thread type.
+     * @param   pszThreadName       The thread name.  Not copied.
+     * @thread  The emulation thread.
+     */
+    DECLR3CALLBACKMEMBER(int, pfnQueueEnableConsumerThread,(PPDMDEVINS pDevIns, PPDMQUEUE pQueue, uint32_t cMaxBatch,
+                                                            RTTHREADTYPE enmType, const char *pszThreadName));
+
     /** Space reserved for future members.
      * @{ */
-    DECLR3CALLBACKMEMBER(void, pfnReserved1,(void));
     DECLR3CALLBACKMEMBER(void, pfnReserved2,(void));
     DECLR3CALLBACKMEMBER(void, pfnReserved3,(void));
     DECLR3CALLBACKMEMBER(void, pfnReserved4,(void));
@@ -4926,6 +4947,15 @@ DECLINLINE(int) PDMDevHlpQueueCreate(PPDMDEVINS pDevIns, size_t cbItem, uint32_t
     return pDevIns->pHlpR3->pfnQueueCreate(pDevIns, cbItem, cItems, cMilliesInterval, pfnCallback, fRZEnabled, pszName, ppQueue);
 }
 
+/**
+ * @copydoc PDMDEVHLPR3::pfnQueueEnableConsumerThread
+ */
+DECLINLINE(int) PDMDevHlpQueueEnableConsumerThread(PPDMDEVINS pDevIns, PPDMQUEUE pQueue, uint32_t cMaxBatch,
+                                                   RTTHREADTYPE enmType, const char *pszThreadName)
+{
+    return pDevIns->pHlpR3->pfnQueueEnableConsumerThread(pDevIns, pQueue, cMaxBatch, enmType, pszThreadName);
+}
+
 /**
  * Initializes a PDM critical section.
  *
@@ -41,6 +41,7 @@
 
 #define PDM_NETSHAPER_MIN_BUCKET_SIZE UINT32_C(65536) /**< bytes */
 #define PDM_NETSHAPER_MAX_LATENCY     UINT32_C(100)   /**< milliseconds */
+#define PDM_NETSHAPER_MAX_BUCKET_SIZE UINT32_C(0x40000000) /**< bytes */
 
 RT_C_DECLS_BEGIN
 
@@ -55,7 +56,9 @@ typedef struct PDMNSFILTER
     /** Set when the filter fails to obtain bandwidth. */
     bool                                fChoked;
     /** Aligment padding. */
-    bool                                afPadding[HC_ARCH_BITS == 32 ? 3 : 7];
+    bool                                afPadding[3];
+    /** The size of the transfer that got the filter choked. */
+    uint32_t                            cbChoked;
     /** The driver this filter is aggregated into (ring-3). */
     R3PTRTYPE(PPDMINETWORKDOWN)         pIDrvNetR3;
 } PDMNSFILTER;
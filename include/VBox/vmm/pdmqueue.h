@@ -27,6 +27,7 @@
 #define ___VBox_vmm_pdmqueue_h
 
 #include <VBox/types.h>
+#include <iprt/thread.h>
 
 RT_C_DECLS_BEGIN
 
@@ -138,6 +139,8 @@ VMMR3_INT_DECL(int)  PDMR3QueueCreateInternal(PVM pVM, size_t cbItem, uint32_t c
                                               PFNPDMQUEUEINT pfnCallback, bool fGCEnabled, const char *pszName, PPDMQUEUE *ppQueue);
 VMMR3_INT_DECL(int)  PDMR3QueueCreateExternal(PVM pVM, size_t cbItem, uint32_t cItems, uint32_t cMilliesInterval,
                                               PFNPDMQUEUEEXT pfnCallback, void *pvUser, const char *pszName, PPDMQUEUE *ppQueue);
+VMMR3_INT_DECL(int)  PDMR3QueueEnableConsumerThread(PPDMQUEUE pQueue, uint32_t cMaxBatch, RTTHREADTYPE enmType,
+                                                    const char *pszThreadName);
 VMMR3_INT_DECL(int)  PDMR3QueueDestroy(PPDMQUEUE pQueue);
 VMMR3_INT_DECL(int)  PDMR3QueueDestroyDevice(PVM pVM, PPDMDEVINS pDevIns);
 VMMR3_INT_DECL(int)  PDMR3QueueDestroyDriver(PVM pVM, PPDMDRVINS pDrvIns);
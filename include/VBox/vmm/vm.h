@@ -209,7 +209,7 @@ typedef struct VMCPU
 #ifdef ___IOMInternal_h
         struct IOMCPU       s;
 #endif
-        uint8_t             padding[512];       /* multiple of 64 */
+        uint8_t             padding[1024];      /* multiple of 64 */
     } iom;
 
     /** DBGF part.
@@ -253,7 +253,7 @@ typedef struct VMCPU
     STAMPROFILEADV          aStatAdHoc[8];                          /* size: 40*8 = 320 */
 
     /** Align the following members on page boundary. */
-    uint8_t                 abAlignment2[3192];
+    uint8_t                 abAlignment2[2680];
 
     /** PGM part. */
     union VMCPUUNIONPGM
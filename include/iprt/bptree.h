@@ -0,0 +1,480 @@
+/** @file
+ * IPRT - Cache Friendly Range Trees (B+tree and Radix Tree).
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+#ifndef ___iprt_bptree_h
+#define ___iprt_bptree_h
+
+#include <iprt/cdefs.h>
+#include <iprt/types.h>
+#include <iprt/memcache.h>
+
+RT_C_DECLS_BEGIN
+
+/** @defgroup grp_rt_bptree     RTBpTree / RTRadixTree - Cache Friendly Range Trees
+ * @ingroup grp_rt
+ *
+ * These complement the RTAvlr* range trees for hot lookup paths.  Both keep
+ * the same semantics: the user embeds a RTRANGEU64NODECORE in its own
+ * structure, ranges are inclusive and must not overlap, and nodes are looked
+ * up by the first key or by any key within the range.
+ *
+ * The B+tree keeps up to ten ranges per 256 byte leaf and fifteen keys per
+ * inner node, so a lookup touches a handful of cache lines per level and
+ * the tree is much shallower than an AVL tree.  The radix tree indexes the
+ * key space directly using 64 slots per node; it's the better choice for
+ * dense, page granular key spaces like guest physical memory.
+ *
+ * Modifications must be serialized by the caller, like with the AVL trees.
+ * When initialized with RTBPTREE_F_LOCKLESS_READERS, lookups may be done
+ * concurrently with modifications inside a read section (ReadEnter /
+ * ReadLeave).  Writers then never change memory readers can reach: the B+tree
+ * copies the modified nodes and publishes a new root, the radix tree writes
+ * single slots atomically.  Replaced nodes are freed after all readers that
+ * could have seen them have left their read sections, which means a node
+ * core removed from such a tree can be freed as soon as the remove function
+ * returns, provided readers only use what they look up inside the read
+ * section.
+ *
+ * @{
+ */
+
+/**
+ * Range node core, embedded in the user structure.
+ *
+ * The fields must not be changed while the node is in a tree.
+ */
+typedef struct RTRANGEU64NODECORE
+{
+    /** First key value in the range (inclusive). */
+    uint64_t        Key;
+    /** Last key value in the range (inclusive). */
+    uint64_t        KeyLast;
+} RTRANGEU64NODECORE;
+/** Pointer to a range node core. */
+typedef RTRANGEU64NODECORE *PRTRANGEU64NODECORE;
+
+/** Callback function for the DoWithAll and Destroy functions.
+ * @returns IPRT status code, a non-zero status stops DoWithAll.
+ * @param   pNode       The node.
+ * @param   pvUser      The user argument.
+ */
+typedef DECLCALLBACK(int) FNRTRANGEU64CALLBACK(PRTRANGEU64NODECORE pNode, void *pvUser);
+/** Pointer to a FNRTRANGEU64CALLBACK. */
+typedef FNRTRANGEU64CALLBACK *PFNRTRANGEU64CALLBACK;
+
+/**
+ * Read section bookkeeping for trees with lockless readers.
+ *
+ * Readers count themselves in the current epoch.  A writer flips the epoch
+ * after publishing a change and waits for the readers of the old one to
+ * leave before freeing what it replaced.
+ */
+typedef struct RTRANGETREERCU
+{
+    /** The current epoch, 0 or 1. */
+    uint32_t volatile   iEpoch;
+    /** Number of readers in each of the epochs. */
+    uint32_t volatile   acReaders[2];
+    /** Explicit padding. */
+    uint32_t            u32Padding;
+} RTRANGETREERCU;
+
+/** @name RTBPTREE_F_XXX - Range tree flags.
+ * @{ */
+/** Allow lookups to run concurrently with modifications. */
+#define RTBPTREE_F_LOCKLESS_READERS     RT_BIT_32(0)
+/** Valid flags. */
+#define RTBPTREE_F_VALID_MASK           UINT32_C(0x00000001)
+/** @} */
+
+
+/** @name B+tree of uint64_t ranges.
+ * @{ */
+
+/**
+ * B+tree of uint64_t ranges.
+ */
+typedef struct RTBPTREEU64
+{
+    /** The root node, NULL if empty. */
+    void * volatile     pRoot;
+    /** Modification counter, lets iterators know their cached leaf is stale. */
+    uint32_t volatile   uGeneration;
+    /** RTBPTREE_F_XXX. */
+    uint32_t            fFlags;
+    /** Number of nodes (ranges) in the tree. */
+    size_t              cNodes;
+    /** The cache the tree nodes are allocated from. */
+    RTMEMCACHE          hMemCache;
+    /** Free nodes kept for the next modifications (internal). */
+    void               *pvSpareNodes;
+    /** Number of nodes in the pvSpareNodes list. */
+    uint32_t            cSpareNodes;
+    /** Lockless reader bookkeeping. */
+    RTRANGETREERCU      Rcu;
+} RTBPTREEU64;
+/** Pointer to a B+tree of uint64_t ranges. */
+typedef RTBPTREEU64 *PRTBPTREEU64;
+
+/**
+ * B+tree iterator.
+ *
+ * This doesn't hold any references, so the tree may be modified between
+ * calls to RTBpTreeU64IterNext (it'll then continue after the last node
+ * returned).
+ */
+typedef struct RTBPTREEU64ITER
+{
+    /** The key to continue at. */
+    uint64_t            uNextKey;
+    /** Set when the end has been reached. */
+    bool                fDone;
+    /** The cached leaf (internal). */
+    void const         *pvLeaf;
+    /** The index of the next entry in the cached leaf (internal). */
+    uint32_t            iEntry;
+    /** The tree generation the cached leaf belongs to (internal). */
+    uint32_t            uGeneration;
+} RTBPTREEU64ITER;
+/** Pointer to a B+tree iterator. */
+typedef RTBPTREEU64ITER *PRTBPTREEU64ITER;
+
+/**
+ * Initializes an empty B+tree.
+ *
+ * @returns IPRT status code.
+ * @param   pTree       The tree.
+ * @param   fFlags      RTBPTREE_F_XXX.
+ */
+RTDECL(int)                 RTBpTreeU64Init(PRTBPTREEU64 pTree, uint32_t fFlags);
+
+/**
+ * Inserts a node into the tree.
+ *
+ * @returns IPRT status code.
+ * @retval  VERR_ALREADY_EXISTS if the range overlaps with an existing node.
+ * @retval  VERR_NO_MEMORY
+ * @param   pTree       The tree.
+ * @param   pNode       The node to insert.
+ */
+RTDECL(int)                 RTBpTreeU64Insert(PRTBPTREEU64 pTree, PRTRANGEU64NODECORE pNode);
+
+/**
+ * Removes the node with the given first key.
+ *
+ * @returns The removed node, NULL if not found.  With lockless readers the
+ *          modified nodes are copied, so this also returns NULL if out of
+ *          memory.
+ * @param   pTree       The tree.
+ * @param   Key         The first key of the range to remove.
+ */
+RTDECL(PRTRANGEU64NODECORE) RTBpTreeU64Remove(PRTBPTREEU64 pTree, uint64_t Key);
+
+/**
+ * Removes the node with the range containing the given key.
+ *
+ * @returns The removed node, NULL if not found (or out of memory, see
+ *          RTBpTreeU64Remove).
+ * @param   pTree       The tree.
+ * @param   Key         A key within the range to remove.
+ */
+RTDECL(PRTRANGEU64NODECORE) RTBpTreeU64RangeRemove(PRTBPTREEU64 pTree, uint64_t Key);
+
+/**
+ * Gets the node with the given first key.
+ *
+ * @returns The node, NULL if not found.
+ * @param   pTree       The tree.
+ * @param   Key         The first key of the range.
+ */
+RTDECL(PRTRANGEU64NODECORE) RTBpTreeU64Get(PRTBPTREEU64 pTree, uint64_t Key);
+
+/**
+ * Gets the node with the range containing the given key.
+ *
+ * @returns The node, NULL if not found.
+ * @param   pTree       The tree.
+ * @param   Key         The key to look up.
+ */
+RTDECL(PRTRANGEU64NODECORE) RTBpTreeU64RangeGet(PRTBPTREEU64 pTree, uint64_t Key);
+
+/**
+ * Gets the node with the first key closest to the given one.
+ *
+ * @returns The node, NULL if not found.
+ * @param   pTree       The tree.
+ * @param   Key         The key to look up.
+ * @param   fAbove      true: the node with the smallest first key >= @a Key.
+ *                      false: the node with the largest first key <= @a Key.
+ */
+RTDECL(PRTRANGEU64NODECORE) RTBpTreeU64GetBestFit(PRTBPTREEU64 pTree, uint64_t Key, bool fAbove);
+
+/**
+ * Calls the callback for each node in key order.
+ *
+ * The callback must not modify the tree.
+ *
+ * @returns IPRT status code, the first non-zero callback status.
+ * @param   pTree       The tree.
+ * @param   fFromLeft   true: ascending order, false: descending order.
+ * @param   pfnCallback The callback.
+ * @param   pvUser      The user argument for the callback.
+ */
+RTDECL(int)                 RTBpTreeU64DoWithAll(PRTBPTREEU64 pTree, bool fFromLeft, PFNRTRANGEU64CALLBACK pfnCallback, void *pvUser);
+
+/**
+ * Destroys the tree, calling the callback for each node.
+ *
+ * The callback may free the node.  The tree must not be in use by lockless
+ * readers and must be initialized again before it can be reused.
+ *
+ * @returns IPRT status code, the first non-zero callback status (the tree is
+ *          destroyed regardless).
+ * @param   pTree       The tree.
+ * @param   pfnCallback The callback, optional.
+ * @param   pvUser      The user argument for the callback.
+ */
+RTDECL(int)                 RTBpTreeU64Destroy(PRTBPTREEU64 pTree, PFNRTRANGEU64CALLBACK pfnCallback, void *pvUser);
+
+/**
+ * Initializes an iterator.
+ *
+ * @param   pIter       The iterator.
+ * @param   uFirstKey   Where to start, nodes starting before this key are
+ *                      skipped.
+ */
+RTDECL(void)                RTBpTreeU64IterInit(PRTBPTREEU64ITER pIter, uint64_t uFirstKey);
+
+/**
+ * Gets the next node in ascending key order.
+ *
+ * @returns The next node, NULL when done.
+ * @param   pTree       The tree.
+ * @param   pIter       The iterator.
+ */
+RTDECL(PRTRANGEU64NODECORE) RTBpTreeU64IterNext(PRTBPTREEU64 pTree, PRTBPTREEU64ITER pIter);
+
+/**
+ * Enters a read section on a tree with lockless readers.
+ *
+ * @returns Token to pass to RTBpTreeU64ReadLeave.
+ * @param   pTree       The tree.
+ */
+RTDECL(uint32_t)            RTBpTreeU64ReadEnter(PRTBPTREEU64 pTree);
+
+/**
+ * Leaves a read section.
+ *
+ * @param   pTree       The tree.
+ * @param   uToken      The RTBpTreeU64ReadEnter return value.
+ */
+RTDECL(void)                RTBpTreeU64ReadLeave(PRTBPTREEU64 pTree, uint32_t uToken);
+
+/** @} */
+
+
+/** @name Radix tree of uint64_t ranges.
+ * @{ */
+
+/**
+ * Radix tree of uint64_t ranges.
+ */
+typedef struct RTRADIXTREEU64
+{
+    /** The root node, NULL if empty. */
+    void * volatile     pRoot;
+    /** The key granularity shift, keys are indexed in 2^cShift units. */
+    uint32_t            cShift;
+    /** RTBPTREE_F_XXX. */
+    uint32_t            fFlags;
+    /** Number of nodes (ranges) in the tree. */
+    size_t              cNodes;
+    /** The cache the tree nodes are allocated from. */
+    RTMEMCACHE          hMemCache;
+    /** Lockless reader bookkeeping. */
+    RTRANGETREERCU      Rcu;
+} RTRADIXTREEU64;
+/** Pointer to a radix tree of uint64_t ranges. */
+typedef RTRADIXTREEU64 *PRTRADIXTREEU64;
+
+/**
+ * Radix tree iterator.
+ */
+typedef struct RTRADIXTREEU64ITER
+{
+    /** The key to continue at. */
+    uint64_t            uNextKey;
+    /** Set when the end has been reached. */
+    bool                fDone;
+} RTRADIXTREEU64ITER;
+/** Pointer to a radix tree iterator. */
+typedef RTRADIXTREEU64ITER *PRTRADIXTREEU64ITER;
+
+/**
+ * Initializes an empty radix tree.
+ *
+ * @returns IPRT status code.
+ * @param   pTree       The tree.
+ * @param   cShift      The key granularity shift.  All ranges must start
+ *                      and end on 2^cShift boundaries, e.g. 12 (PAGE_SHIFT)
+ *                      for page aligned ranges.  The tree is indexed by
+ *                      Key >> cShift, so larger granularities give flatter
+ *                      trees.
+ * @param   fFlags      RTBPTREE_F_XXX.
+ */
+RTDECL(int)                 RTRadixTreeU64Init(PRTRADIXTREEU64 pTree, uint32_t cShift, uint32_t fFlags);
+
+/**
+ * Inserts a node into the tree.
+ *
+ * With lockless readers, a reader may see the range partially inserted, i.e.
+ * some keys of it resolve to the node while others don't yet.
+ *
+ * @returns IPRT status code.
+ * @retval  VERR_ALREADY_EXISTS if the range overlaps with an existing node.
+ * @retval  VERR_INVALID_PARAMETER if the range isn't aligned to the
+ *          granularity.
+ * @retval  VERR_NO_MEMORY
+ * @param   pTree       The tree.
+ * @param   pNode       The node to insert.
+ */
+RTDECL(int)                 RTRadixTreeU64Insert(PRTRADIXTREEU64 pTree, PRTRANGEU64NODECORE pNode);
+
+/**
+ * Removes the node with the given first key.
+ *
+ * @returns The removed node, NULL if not found.
+ * @param   pTree       The tree.
+ * @param   Key         The first key of the range to remove.
+ */
+RTDECL(PRTRANGEU64NODECORE) RTRadixTreeU64Remove(PRTRADIXTREEU64 pTree, uint64_t Key);
+
+/**
+ * Removes the node with the range containing the given key.
+ *
+ * @returns The removed node, NULL if not found.
+ * @param   pTree       The tree.
+ * @param   Key         A key within the range to remove.
+ */
+RTDECL(PRTRANGEU64NODECORE) RTRadixTreeU64RangeRemove(PRTRADIXTREEU64 pTree, uint64_t Key);
+
+/**
+ * Gets the node with the given first key.
+ *
+ * @returns The node, NULL if not found.
+ * @param   pTree       The tree.
+ * @param   Key         The first key of the range.
+ */
+RTDECL(PRTRANGEU64NODECORE) RTRadixTreeU64Get(PRTRADIXTREEU64 pTree, uint64_t Key);
+
+/**
+ * Gets the node with the range containing the given key.
+ *
+ * @returns The node, NULL if not found.
+ * @param   pTree       The tree.
+ * @param   Key         The key to look up.
+ */
+RTDECL(PRTRANGEU64NODECORE) RTRadixTreeU64RangeGet(PRTRADIXTREEU64 pTree, uint64_t Key);
+
+/**
+ * Gets the node with the first key closest to the given one.
+ *
+ * @returns The node, NULL if not found.
+ * @param   pTree       The tree.
+ * @param   Key         The key to look up.
+ * @param   fAbove      true: the node with the smallest first key >= @a Key.
+ *                      false: the node with the largest first key <= @a Key.
+ */
+RTDECL(PRTRANGEU64NODECORE) RTRadixTreeU64GetBestFit(PRTRADIXTREEU64 pTree, uint64_t Key, bool fAbove);
+
+/**
+ * Calls the callback for each node in key order.
+ *
+ * The callback must not modify the tree.
+ *
+ * @returns IPRT status code, the first non-zero callback status.
+ * @param   pTree       The tree.
+ * @param   fFromLeft   true: ascending order, false: descending order.
+ * @param   pfnCallback The callback.
+ * @param   pvUser      The user argument for the callback.
+ */
+RTDECL(int)                 RTRadixTreeU64DoWithAll(PRTRADIXTREEU64 pTree, bool fFromLeft, PFNRTRANGEU64CALLBACK pfnCallback, void *pvUser);
+
+/**
+ * Destroys the tree, calling the callback for each node.
+ *
+ * The callback may free the node.  The tree must not be in use by lockless
+ * readers and must be initialized again before it can be reused.
+ *
+ * @returns IPRT status code, the first non-zero callback status (the tree is
+ *          destroyed regardless).
+ * @param   pTree       The tree.
+ * @param   pfnCallback The callback, optional.
+ * @param   pvUser      The user argument for the callback.
+ */
+RTDECL(int)                 RTRadixTreeU64Destroy(PRTRADIXTREEU64 pTree, PFNRTRANGEU64CALLBACK pfnCallback, void *pvUser);
+
+/**
+ * Initializes an iterator.
+ *
+ * @param   pIter       The iterator.
+ * @param   uFirstKey   Where to start, nodes starting before this key are
+ *                      skipped.
+ */
+RTDECL(void)                RTRadixTreeU64IterInit(PRTRADIXTREEU64ITER pIter, uint64_t uFirstKey);
+
+/**
+ * Gets the next node in ascending key order.
+ *
+ * @returns The next node, NULL when done.
+ * @param   pTree       The tree.
+ * @param   pIter       The iterator.
+ */
+RTDECL(PRTRANGEU64NODECORE) RTRadixTreeU64IterNext(PRTRADIXTREEU64 pTree, PRTRADIXTREEU64ITER pIter);
+
+/**
+ * Enters a read section on a tree with lockless readers.
+ *
+ * @returns Token to pass to RTRadixTreeU64ReadLeave.
+ * @param   pTree       The tree.
+ */
+RTDECL(uint32_t)            RTRadixTreeU64ReadEnter(PRTRADIXTREEU64 pTree);
+
+/**
+ * Leaves a read section.
+ *
+ * @param   pTree       The tree.
+ * @param   uToken      The RTRadixTreeU64ReadEnter return value.
+ */
+RTDECL(void)                RTRadixTreeU64ReadLeave(PRTRADIXTREEU64 pTree, uint32_t uToken);
+
+/** @} */
+
+/** @} */
+
+RT_C_DECLS_END
+
+#endif
+
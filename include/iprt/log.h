@@ -357,6 +357,14 @@ typedef enum RTLOGFLAGS
     RTLOGFLAGS_FLUSH                = 0x00000200,
     /** Restrict the number of log entries per group. */
     RTLOGFLAGS_RESTRICT_GROUPS      = 0x00000400,
+    /** Deferred formatting (ring-3 only).  Callers only copy the format string,
+     * the raw arguments (string arguments included) and a timestamp into a
+     * per-thread buffer, the formatting and output is done by a background
+     * flusher thread.  Records with arguments that cannot be captured safely
+     * (%N, %M, pointer based %R types, ++), records too big for the buffer and
+     * groups restricted by RTLOGFLAGS_RESTRICT_GROUPS are formatted immediately
+     * as usual. */
+    RTLOGFLAGS_BINARY               = 0x00000800,
     /** New lines should be prefixed with the write and read lock counts. */
     RTLOGFLAGS_PREFIX_LOCK_COUNTS   = 0x00008000,
     /** New lines should be prefixed with the CPU id (ApicID on intel/amd). */
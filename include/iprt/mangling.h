@@ -575,6 +575,19 @@
 # define RTBldCfgVersionBuild                           RT_MANGLER(RTBldCfgVersionBuild)
 # define RTBldCfgVersionMajor                           RT_MANGLER(RTBldCfgVersionMajor)
 # define RTBldCfgVersionMinor                           RT_MANGLER(RTBldCfgVersionMinor)
+# define RTBpTreeU64Destroy                             RT_MANGLER(RTBpTreeU64Destroy)
+# define RTBpTreeU64DoWithAll                           RT_MANGLER(RTBpTreeU64DoWithAll)
+# define RTBpTreeU64Get                                 RT_MANGLER(RTBpTreeU64Get)
+# define RTBpTreeU64GetBestFit                          RT_MANGLER(RTBpTreeU64GetBestFit)
+# define RTBpTreeU64Init                                RT_MANGLER(RTBpTreeU64Init)
+# define RTBpTreeU64Insert                              RT_MANGLER(RTBpTreeU64Insert)
+# define RTBpTreeU64IterInit                            RT_MANGLER(RTBpTreeU64IterInit)
+# define RTBpTreeU64IterNext                            RT_MANGLER(RTBpTreeU64IterNext)
+# define RTBpTreeU64RangeGet                            RT_MANGLER(RTBpTreeU64RangeGet)
+# define RTBpTreeU64RangeRemove                         RT_MANGLER(RTBpTreeU64RangeRemove)
+# define RTBpTreeU64ReadEnter                           RT_MANGLER(RTBpTreeU64ReadEnter)
+# define RTBpTreeU64ReadLeave                           RT_MANGLER(RTBpTreeU64ReadLeave)
+# define RTBpTreeU64Remove                              RT_MANGLER(RTBpTreeU64Remove)
 # define RTCdromOpen                                    RT_MANGLER(RTCdromOpen)
 # define RTCdromRetain                                  RT_MANGLER(RTCdromRetain)
 # define RTCdromRelease                                 RT_MANGLER(RTCdromRelease)
@@ -1225,6 +1238,7 @@
 # define RTMemCacheCreate                               RT_MANGLER(RTMemCacheCreate)
 # define RTMemCacheDestroy                              RT_MANGLER(RTMemCacheDestroy)
 # define RTMemCacheFree                                 RT_MANGLER(RTMemCacheFree)
+# define RTMemCacheQueryStats                           RT_MANGLER(RTMemCacheQueryStats)
 # define RTMemContAlloc                                 RT_MANGLER(RTMemContAlloc) /* r0drv */
 # define RTMemContFree                                  RT_MANGLER(RTMemContFree) /* r0drv */
 # define RTMemDump                                      RT_MANGLER(RTMemDump)
@@ -1343,6 +1357,7 @@
 # define RTMsgWarning                                   RT_MANGLER(RTMsgWarning)
 # define RTMsgWarningV                                  RT_MANGLER(RTMsgWarningV)
 # define RTNetIPv4AddDataChecksum                       RT_MANGLER(RTNetIPv4AddDataChecksum)
+# define RTNetIPv4AddDataChecksumAndCopy                RT_MANGLER(RTNetIPv4AddDataChecksumAndCopy)
 # define RTNetIPv4AddTCPChecksum                        RT_MANGLER(RTNetIPv4AddTCPChecksum)
 # define RTNetIPv4AddUDPChecksum                        RT_MANGLER(RTNetIPv4AddUDPChecksum)
 # define RTNetIPv4FinalizeChecksum                      RT_MANGLER(RTNetIPv4FinalizeChecksum)
@@ -1532,6 +1547,19 @@
 # define rtR3MemRealloc                                 RT_MANGLER(rtR3MemRealloc)
 # define RTRCInit                                       RT_MANGLER(RTRCInit)
 # define RTRCTerm                                       RT_MANGLER(RTRCTerm)
+# define RTRadixTreeU64Destroy                          RT_MANGLER(RTRadixTreeU64Destroy)
+# define RTRadixTreeU64DoWithAll                        RT_MANGLER(RTRadixTreeU64DoWithAll)
+# define RTRadixTreeU64Get                              RT_MANGLER(RTRadixTreeU64Get)
+# define RTRadixTreeU64GetBestFit                       RT_MANGLER(RTRadixTreeU64GetBestFit)
+# define RTRadixTreeU64Init                             RT_MANGLER(RTRadixTreeU64Init)
+# define RTRadixTreeU64Insert                           RT_MANGLER(RTRadixTreeU64Insert)
+# define RTRadixTreeU64IterInit                         RT_MANGLER(RTRadixTreeU64IterInit)
+# define RTRadixTreeU64IterNext                         RT_MANGLER(RTRadixTreeU64IterNext)
+# define RTRadixTreeU64RangeGet                         RT_MANGLER(RTRadixTreeU64RangeGet)
+# define RTRadixTreeU64RangeRemove                      RT_MANGLER(RTRadixTreeU64RangeRemove)
+# define RTRadixTreeU64ReadEnter                        RT_MANGLER(RTRadixTreeU64ReadEnter)
+# define RTRadixTreeU64ReadLeave                        RT_MANGLER(RTRadixTreeU64ReadLeave)
+# define RTRadixTreeU64Remove                           RT_MANGLER(RTRadixTreeU64Remove)
 # define RTRandAdvBytes                                 RT_MANGLER(RTRandAdvBytes)
 # define RTRandAdvCreateParkMiller                      RT_MANGLER(RTRandAdvCreateParkMiller)
 # define RTRandAdvCreateSystemFaster                    RT_MANGLER(RTRandAdvCreateSystemFaster)
@@ -1558,6 +1586,8 @@
 # define RTRandU64                                      RT_MANGLER(RTRandU64)
 # define RTRandU64Ex                                    RT_MANGLER(RTRandU64Ex)
 # define RTReqPoolAlloc                                 RT_MANGLER(RTReqPoolAlloc)
+# define RTReqPoolCallAfterEx                           RT_MANGLER(RTReqPoolCallAfterEx)
+# define RTReqPoolCallAfterExV                          RT_MANGLER(RTReqPoolCallAfterExV)
 # define RTReqPoolCallEx                                RT_MANGLER(RTReqPoolCallEx)
 # define RTReqPoolCallExV                               RT_MANGLER(RTReqPoolCallExV)
 # define RTReqPoolCallWait                              RT_MANGLER(RTReqPoolCallWait)
@@ -1767,10 +1797,23 @@
 # define RTSocketWriteNB                                RT_MANGLER(RTSocketWriteNB)
 # define RTSocketWriteTo                                RT_MANGLER(RTSocketWriteTo)
 # define RTSocketWriteToNB                              RT_MANGLER(RTSocketWriteToNB)
+# define RTSortApvBinarySearch                          RT_MANGLER(RTSortApvBinarySearch)
+# define RTSortApvIntro                                 RT_MANGLER(RTSortApvIntro)
 # define RTSortApvIsSorted                              RT_MANGLER(RTSortApvIsSorted)
+# define RTSortApvLowerBound                            RT_MANGLER(RTSortApvLowerBound)
+# define RTSortApvMerge                                 RT_MANGLER(RTSortApvMerge)
 # define RTSortApvShell                                 RT_MANGLER(RTSortApvShell)
+# define RTSortBinarySearch                             RT_MANGLER(RTSortBinarySearch)
+# define RTSortIntro                                    RT_MANGLER(RTSortIntro)
 # define RTSortIsSorted                                 RT_MANGLER(RTSortIsSorted)
+# define RTSortLowerBound                               RT_MANGLER(RTSortLowerBound)
+# define RTSortMerge                                    RT_MANGLER(RTSortMerge)
+# define RTSortParallel                                 RT_MANGLER(RTSortParallel)
+# define RTSortRadixByKey                               RT_MANGLER(RTSortRadixByKey)
+# define RTSortRadixU32                                 RT_MANGLER(RTSortRadixU32)
+# define RTSortRadixU64                                 RT_MANGLER(RTSortRadixU64)
 # define RTSortShell                                    RT_MANGLER(RTSortShell)
+# define RTSortUpperBound                               RT_MANGLER(RTSortUpperBound)
 # define RTSpinlockAcquire                              RT_MANGLER(RTSpinlockAcquire)
 # define RTSpinlockAcquireNoInts                        RT_MANGLER(RTSpinlockAcquireNoInts)
 # define RTSpinlockCreate                               RT_MANGLER(RTSpinlockCreate)
@@ -2182,6 +2225,8 @@
 # define RTTlsGet                                       RT_MANGLER(RTTlsGet)
 # define RTTlsGetEx                                     RT_MANGLER(RTTlsGetEx)
 # define RTTlsSet                                       RT_MANGLER(RTTlsSet)
+# define RTTraceBufAddEvent                             RT_MANGLER(RTTraceBufAddEvent)
+# define RTTraceBufAddEventEx                           RT_MANGLER(RTTraceBufAddEventEx)
 # define RTTraceBufAddMsg                               RT_MANGLER(RTTraceBufAddMsg)
 # define RTTraceBufAddMsgEx                             RT_MANGLER(RTTraceBufAddMsgEx)
 # define RTTraceBufAddMsgF                              RT_MANGLER(RTTraceBufAddMsgF)
@@ -2198,8 +2243,11 @@
 # define RTTraceBufDumpToLog                            RT_MANGLER(RTTraceBufDumpToLog)
 # define RTTraceBufEnable                               RT_MANGLER(RTTraceBufEnable)
 # define RTTraceBufEnumEntries                          RT_MANGLER(RTTraceBufEnumEntries)
+# define RTTraceBufEnumRecords                          RT_MANGLER(RTTraceBufEnumRecords)
+# define RTTraceBufExportChromeTrace                    RT_MANGLER(RTTraceBufExportChromeTrace)
 # define RTTraceBufGetEntryCount                        RT_MANGLER(RTTraceBufGetEntryCount)
 # define RTTraceBufGetEntrySize                         RT_MANGLER(RTTraceBufGetEntrySize)
+# define RTTraceBufGetMaxEventArgs                      RT_MANGLER(RTTraceBufGetMaxEventArgs)
 # define RTTraceBufRelease                              RT_MANGLER(RTTraceBufRelease)
 # define RTTraceBufRetain                               RT_MANGLER(RTTraceBufRetain)
 # define RTTraceGetDefaultBuf                           RT_MANGLER(RTTraceGetDefaultBuf)
@@ -2380,6 +2428,7 @@
 # define RTZipDecompDestroy                             RT_MANGLER(RTZipDecompDestroy)
 # define RTZipDecompress                                RT_MANGLER(RTZipDecompress)
 # define RTZipGzipCompressIoStream                      RT_MANGLER(RTZipGzipCompressIoStream)
+# define RTZipGzipDecompressFile                        RT_MANGLER(RTZipGzipDecompressFile)
 # define RTZipGzipDecompressIoStream                    RT_MANGLER(RTZipGzipDecompressIoStream)
 # define RTZipPkzipFsStreamFromIoStream                 RT_MANGLER(RTZipPkzipFsStreamFromIoStream)
 # define RTZipPkzipMemDecompress                        RT_MANGLER(RTZipPkzipMemDecompress)
@@ -59,6 +59,60 @@ typedef RTMEMCACHE                             *PRTMEMCACHE;
 /** Nil memory cache handle. */
 #define NIL_RTMEMCACHE                          ((RTMEMCACHE)0)
 
+/** @name RTMemCacheCreate flags
+ * @{ */
+/** Put a magazine layer in front of the cache (Bonwick style).  Threads
+ * allocate from and free to small private stacks of objects (magazines)
+ * without touching any shared state, exchanging full and empty magazines with
+ * a depot when they run dry or overflow.  Recommended for caches that are
+ * hammered by several threads at once, e.g. I/O request objects. */
+#define RTMEMCACHE_FLAGS_MAGAZINES              RT_BIT_32(0)
+/** Valid flags. */
+#define RTMEMCACHE_FLAGS_VALID_MASK             UINT32_C(0x00000001)
+/** @} */
+
+/**
+ * Memory cache statistics (RTMemCacheQueryStats).
+ *
+ * The counters of the magazine layer are all zero unless the cache was
+ * created with RTMEMCACHE_FLAGS_MAGAZINES.
+ */
+typedef struct RTMEMCACHESTATS
+{
+    /** Total number of objects in the cache pages. */
+    uint32_t    cObjects;
+    /** Number of objects free at the page level (not counting magazines). */
+    uint32_t    cFreeObjects;
+    /** The current magazine size (rounds). */
+    uint32_t    cMagazineRounds;
+    /** Number of full magazines in the depot. */
+    uint32_t    cDepotFull;
+    /** Number of empty magazines in the depot. */
+    uint32_t    cDepotEmpty;
+    /** Explicit padding. */
+    uint32_t    u32Padding;
+    /** Allocations served by the magazine layer. */
+    uint64_t    cAllocHits;
+    /** Allocations that had to go to the page level. */
+    uint64_t    cAllocMisses;
+    /** Frees absorbed by the magazine layer. */
+    uint64_t    cFreeHits;
+    /** Frees that had to go to the page level. */
+    uint64_t    cFreeMisses;
+    /** Frees of objects carved out by another thread's slot. */
+    uint64_t    cRemoteFrees;
+    /** Operations bypassing the magazines because the slot was busy. */
+    uint64_t    cSlotCollisions;
+    /** Magazine exchanges with the depot. */
+    uint64_t    cDepotExchanges;
+    /** Number of times the depot lock was contended. */
+    uint64_t    cDepotContention;
+    /** Number of full magazines returned to the page level by rebalancing. */
+    uint64_t    cDepotTrims;
+} RTMEMCACHESTATS;
+/** Pointer to memory cache statistics. */
+typedef RTMEMCACHESTATS *PRTMEMCACHESTATS;
+
 
 /**
  * Object constructor.
@@ -106,7 +160,7 @@ typedef FNMEMCACHEDTOR *PFNMEMCACHEDTOR;
  * @param   pfnCtor             Object constructor callback.  Optional.
  * @param   pfnDtor             Object destructor callback.  Optional.
  * @param   pvUser              User argument for the two callbacks.
- * @param   fFlags              Flags reserved for future use.  Must be zero.
+ * @param   fFlags              RTMEMCACHE_FLAGS_XXX.
  */
 RTDECL(int)     RTMemCacheCreate(PRTMEMCACHE phMemCache, size_t cbObject, size_t cbAlignment, uint32_t cMaxObjects,
                                  PFNMEMCACHECTOR pfnCtor, PFNMEMCACHEDTOR pfnDtor, void *pvUser, uint32_t fFlags);
@@ -149,6 +203,18 @@ RTDECL(int)     RTMemCacheAllocEx(RTMEMCACHE hMemCache, void **ppvObj);
  */
 RTDECL(void)    RTMemCacheFree(RTMEMCACHE hMemCache, void *pvObj);
 
+/**
+ * Queries the cache statistics.
+ *
+ * The counters are gathered without any serialization, so they may be
+ * slightly inconsistent on a busy cache.
+ *
+ * @returns IPRT status code.
+ * @param   hMemCache           The cache handle.
+ * @param   pStats              Where to return the statistics.
+ */
+RTDECL(int)     RTMemCacheQueryStats(RTMEMCACHE hMemCache, PRTMEMCACHESTATS pStats);
+
 /** @} */
 
 RT_C_DECLS_END
@@ -78,7 +78,16 @@ typedef enum RTREQFLAGS
     /** Return type mask. */
     RTREQFLAGS_RETURN_MASK  = 1,
     /** Caller does not wait on the packet, Queue process thread will free it. */
-    RTREQFLAGS_NO_WAIT      = 2
+    RTREQFLAGS_NO_WAIT      = 2,
+    /** Request thread pools only: Schedule the request ahead of the normal
+     * priority ones in the shared pool queue. */
+    RTREQFLAGS_PRIORITY_HIGH = 4,
+    /** Request thread pools only: Schedule the request after the normal
+     * priority ones and after the idle workers have tried stealing work from
+     * the busy ones. */
+    RTREQFLAGS_PRIORITY_LOW = 8,
+    /** Priority mask. */
+    RTREQFLAGS_PRIORITY_MASK = 12
 } RTREQFLAGS;
 
 
@@ -352,6 +361,18 @@ typedef enum RTREQPOOLCFGVAR
     RTREQPOOLCFGVAR_PUSH_BACK_MAX_MS,
     /** The maximum number of free requests to keep handy for recycling. */
     RTREQPOOLCFGVAR_MAX_FREE_REQUESTS,
+    /** Non-zero to bind each new worker thread to an online CPU, handing them
+     * out round robin in CPU set index order.  Only affects worker threads
+     * created after it was set, so set it right after creating the pool. */
+    RTREQPOOLCFGVAR_BIND_TO_CPUS,
+    /** Non-zero to let a worker thread waiting indefinitely on a request of the
+     * same pool (RTReqWait) process other queued requests meanwhile, so fork/join
+     * style users don't deadlock small pools.  These run on the stack of the
+     * waiting worker and with whatever locks it holds, so only enable it for
+     * pools whose requests are written for that.  This also makes requests
+     * submitted by worker threads go onto per-worker queues for other workers
+     * to steal from.  Default is off. */
+    RTREQPOOLCFGVAR_HELP_WHILE_WAITING,
     /** The end of the range of valid config variables. */
     RTREQPOOLCFGVAR_END,
     /** Blow the type up to 32-bits. */
@@ -409,6 +430,11 @@ typedef enum RTREQPOOLSTAT
     /** Average time the requests had to wait in the queue before being
      * scheduled. */
     RTREQPOOLSTAT_NS_AVERAGE_REQ_QUEUED,
+    /** The total number of requests worker threads submitted to their own
+     * work stealing deque. */
+    RTREQPOOLSTAT_REQUESTS_WORKER_QUEUED,
+    /** The total number of requests stolen from another worker's deque. */
+    RTREQPOOLSTAT_REQUESTS_STOLEN,
     /** The end of the valid statistics value names. */
     RTREQPOOLSTAT_END,
     /** Blow the type up to 32-bit. */
@@ -537,6 +563,54 @@ RTDECL(int) RTReqPoolCallVoidWait(RTREQPOOL hPool, PFNRT pfnFunction, unsigned c
  */
 RTDECL(int) RTReqPoolCallVoidNoWait(RTREQPOOL hPool, PFNRT pfnFunction, unsigned cArgs, ...);
 
+/**
+ * Call a function on a worker thread once another request has completed.
+ *
+ * This is the continuation part of using requests as futures: the request
+ * returned in @a phReq is submitted to @a hPool when @a hReqAfter completes,
+ * regardless of its status, and can itself be waited on or be used as the
+ * @a hReqAfter of further calls.  If @a hReqAfter has already completed, the
+ * request is submitted right away.  To get at the status of @a hReqAfter, pass
+ * it as an argument and keep a reference to it.
+ *
+ * @returns IPRT status code.  This function never waits.
+ * @param   hPool           The request thread pool handle.
+ * @param   hReqAfter       The request to wait for.  The caller must hold a
+ *                          reference to it for the duration of the call.  It
+ *                          does not need to belong to @a hPool and must have
+ *                          been submitted or be submitted later for anything
+ *                          to happen.
+ * @param   phReq           Where to return the request. Can be NULL if the
+ *                          RTREQFLAGS_NO_WAIT flag is used.
+ * @param   fFlags          A combination of RTREQFLAGS values.
+ * @param   pfnFunction     The function to be called.  Must be declared by a
+ *                          DECL macro because of calling conventions.
+ * @param   cArgs           The number of arguments in the ellipsis.
+ * @param   ...             Arguments.
+ * @remarks See remarks on RTReqPoolCallEx.
+ */
+RTDECL(int) RTReqPoolCallAfterEx(RTREQPOOL hPool, PRTREQ hReqAfter, PRTREQ *phReq, uint32_t fFlags,
+                                 PFNRT pfnFunction, unsigned cArgs, ...);
+
+/**
+ * Call a function on a worker thread once another request has completed.
+ *
+ * @returns IPRT status code.  This function never waits.
+ * @param   hPool           The request thread pool handle.
+ * @param   hReqAfter       The request to wait for.
+ * @param   phReq           Where to return the request. Can be NULL if the
+ *                          RTREQFLAGS_NO_WAIT flag is used.
+ * @param   fFlags          A combination of RTREQFLAGS values.
+ * @param   pfnFunction     The function to be called.  Must be declared by a
+ *                          DECL macro because of calling conventions.
+ * @param   cArgs           The number of arguments in the variable argument
+ *                          list.
+ * @param   va              Arguments.
+ * @remarks See remarks on RTReqPoolCallAfterEx.
+ */
+RTDECL(int) RTReqPoolCallAfterExV(RTREQPOOL hPool, PRTREQ hReqAfter, PRTREQ *phReq, uint32_t fFlags,
+                                  PFNRT pfnFunction, unsigned cArgs, va_list va);
+
 
 /**
  * Retainsa reference to a request.
@@ -581,6 +655,12 @@ RTDECL(int) RTReqSubmit(PRTREQ pReq, RTMSINTERVAL cMillies);
 /**
  * Wait for a request to be completed.
  *
+ * When a worker thread of a request thread pool waits indefinitely on a
+ * request of the same pool, it processes other requests of the pool (its own
+ * first) until the one it waits for has completed or there is nothing left it
+ * can pick up.  This keeps fork/join style use of the pool from running out of
+ * worker threads.
+ *
  * @returns iprt status code.
  *          Will not return VERR_INTERRUPTED.
  * @returns VERR_TIMEOUT if cMillies was reached without the packet being completed.
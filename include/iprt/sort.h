@@ -27,6 +27,7 @@
 #define ___iprt_sort_h
 
 #include <iprt/types.h>
+#include <iprt/req.h>
 
 /** @defgroup grp_rt_sort       RTSort - Sorting Algorithms
  * @ingroup grp_rt
@@ -96,6 +97,122 @@ RTDECL(void) RTSortShell(void *pvArray, size_t cElements, size_t cbElement, PFNR
  */
 RTDECL(void) RTSortApvShell(void **papvArray, size_t cElements, PFNRTSORTCMP pfnCmp, void *pvUser);
 
+/**
+ * Introspective sort of an array of variable sized elementes.
+ *
+ * This is a quick sort with median-of-three (ninther for larger partitions)
+ * pivot selection and insertion sort for the small partitions, falling back
+ * on heap sort when the recursion gets too deep.  Partitions that didn't need
+ * any swapping are finished off using insertion sort if that can be done in a
+ * few moves, so already sorted input is handled in linear time.  The sort is
+ * not stable.
+ *
+ * @param   pvArray         The array to sort.
+ * @param   cElements       The number of elements in the array.
+ * @param   cbElement       The size of an array element.
+ * @param   pfnCmp          Callback function comparing two elements.
+ * @param   pvUser          User argument for the callback.
+ */
+RTDECL(void) RTSortIntro(void *pvArray, size_t cElements, size_t cbElement, PFNRTSORTCMP pfnCmp, void *pvUser);
+
+/**
+ * Same as RTSortIntro but speciallized for an array containing element
+ * pointers.
+ *
+ * @param   papvArray       The array to sort.
+ * @param   cElements       The number of elements in the array.
+ * @param   pfnCmp          Callback function comparing two elements.
+ * @param   pvUser          User argument for the callback.
+ */
+RTDECL(void) RTSortApvIntro(void **papvArray, size_t cElements, PFNRTSORTCMP pfnCmp, void *pvUser);
+
+/**
+ * Stable merge sort of an array of variable sized elementes.
+ *
+ * @returns IPRT status code.
+ * @retval  VERR_NO_TMP_MEMORY if the temporary buffer (same size as the array)
+ *          could not be allocated.  The array is left untouched.
+ * @param   pvArray         The array to sort.
+ * @param   cElements       The number of elements in the array.
+ * @param   cbElement       The size of an array element.
+ * @param   pfnCmp          Callback function comparing two elements.
+ * @param   pvUser          User argument for the callback.
+ */
+RTDECL(int) RTSortMerge(void *pvArray, size_t cElements, size_t cbElement, PFNRTSORTCMP pfnCmp, void *pvUser);
+
+/**
+ * Same as RTSortMerge but speciallized for an array containing element
+ * pointers.
+ *
+ * @returns IPRT status code.
+ * @retval  VERR_NO_TMP_MEMORY if the temporary buffer could not be allocated.
+ * @param   papvArray       The array to sort.
+ * @param   cElements       The number of elements in the array.
+ * @param   pfnCmp          Callback function comparing two elements.
+ * @param   pvUser          User argument for the callback.
+ */
+RTDECL(int) RTSortApvMerge(void **papvArray, size_t cElements, PFNRTSORTCMP pfnCmp, void *pvUser);
+
+/**
+ * Radix sorts an array of unsigned 32-bit integers.
+ *
+ * @returns IPRT status code.
+ * @retval  VERR_NO_TMP_MEMORY if the temporary buffer could not be allocated.
+ * @param   pau32Array      The array to sort.
+ * @param   cElements       The number of elements in the array.
+ */
+RTDECL(int) RTSortRadixU32(uint32_t *pau32Array, size_t cElements);
+
+/**
+ * Radix sorts an array of unsigned 64-bit integers.
+ *
+ * @returns IPRT status code.
+ * @retval  VERR_NO_TMP_MEMORY if the temporary buffer could not be allocated.
+ * @param   pau64Array      The array to sort.
+ * @param   cElements       The number of elements in the array.
+ */
+RTDECL(int) RTSortRadixU64(uint64_t *pau64Array, size_t cElements);
+
+/**
+ * Stable radix sort of an array of variable sized elements by an unsigned
+ * integer key in each element.
+ *
+ * @returns IPRT status code.
+ * @retval  VERR_NO_TMP_MEMORY if the temporary buffer could not be allocated.
+ * @retval  VERR_INVALID_PARAMETER if @a cbKey isn't 1, 2, 4 or 8, or the key
+ *          doesn't fit inside the element.
+ * @param   pvArray         The array to sort.
+ * @param   cElements       The number of elements in the array.
+ * @param   cbElement       The size of an array element.
+ * @param   offKey          The offset of the key into the element.  The key
+ *                          must be naturally aligned if the architecture
+ *                          requires it.
+ * @param   cbKey           The key size: 1, 2, 4 or 8 bytes.  Host endian.
+ */
+RTDECL(int) RTSortRadixByKey(void *pvArray, size_t cElements, size_t cbElement, size_t offKey, size_t cbKey);
+
+/**
+ * Sorts an array of variable sized elements using a request pool.
+ *
+ * The array is split into one chunk per worker which are sorted using
+ * RTSortIntro in parallel, then merged in parallel rounds with each merge
+ * split into independent parts.  The sort is not stable.  Small arrays and
+ * pools with a single thread are sorted on the calling thread.
+ *
+ * @returns IPRT status code.
+ * @retval  VERR_NO_TMP_MEMORY if the temporary buffer (same size as the array)
+ *          could not be allocated.  The array is left untouched.
+ * @param   hPool           The request pool to use.  NIL_RTREQPOOL means
+ *                          sorting on the calling thread.  The callback
+ *                          will be called on the pool threads.
+ * @param   pvArray         The array to sort.
+ * @param   cElements       The number of elements in the array.
+ * @param   cbElement       The size of an array element.
+ * @param   pfnCmp          Callback function comparing two elements.
+ * @param   pvUser          User argument for the callback.
+ */
+RTDECL(int) RTSortParallel(RTREQPOOL hPool, void *pvArray, size_t cElements, size_t cbElement, PFNRTSORTCMP pfnCmp, void *pvUser);
+
 /**
  * Checks if an array of variable sized elementes is sorted.
  *
@@ -120,6 +237,259 @@ RTDECL(bool) RTSortIsSorted(void const *pvArray, size_t cElements, size_t cbElem
  */
 RTDECL(bool) RTSortApvIsSorted(void const * const *papvArray, size_t cElements, PFNRTSORTCMP pfnCmp, void *pvUser);
 
+/**
+ * Finds the first element in a sorted array that isn't ordered before the
+ * given key.
+ *
+ * @returns Index of the first element not less than @a pvKey, @a cElements
+ *          if there is none.
+ * @param   pvArray         The sorted array.
+ * @param   cElements       The number of elements in the array.
+ * @param   cbElement       The size of an array element.
+ * @param   pvKey           The key to look for.
+ * @param   pfnCmp          Callback function comparing an array element (1st
+ *                          parameter) with the key (2nd parameter).
+ * @param   pvUser          User argument for the callback.
+ */
+RTDECL(size_t) RTSortLowerBound(void const *pvArray, size_t cElements, size_t cbElement, void const *pvKey,
+                                PFNRTSORTCMP pfnCmp, void *pvUser);
+
+/**
+ * Finds the first element in a sorted array that is ordered after the given
+ * key.
+ *
+ * @returns Index of the first element greater than @a pvKey, @a cElements if
+ *          there is none.
+ * @param   pvArray         The sorted array.
+ * @param   cElements       The number of elements in the array.
+ * @param   cbElement       The size of an array element.
+ * @param   pvKey           The key to look for.
+ * @param   pfnCmp          Callback function comparing an array element (1st
+ *                          parameter) with the key (2nd parameter).
+ * @param   pvUser          User argument for the callback.
+ */
+RTDECL(size_t) RTSortUpperBound(void const *pvArray, size_t cElements, size_t cbElement, void const *pvKey,
+                                PFNRTSORTCMP pfnCmp, void *pvUser);
+
+/**
+ * Binary search for a key in a sorted array of variable sized elements.
+ *
+ * @returns true if found, false if not.
+ * @param   pvArray         The sorted array.
+ * @param   cElements       The number of elements in the array.
+ * @param   cbElement       The size of an array element.
+ * @param   pvKey           The key to look for.
+ * @param   pfnCmp          Callback function comparing an array element (1st
+ *                          parameter) with the key (2nd parameter).
+ * @param   pvUser          User argument for the callback.
+ * @param   piElement       Where to return the index of the first matching
+ *                          element, or where to insert the key if not found.
+ *                          Optional.
+ */
+RTDECL(bool) RTSortBinarySearch(void const *pvArray, size_t cElements, size_t cbElement, void const *pvKey,
+                                PFNRTSORTCMP pfnCmp, void *pvUser, size_t *piElement);
+
+/**
+ * Same as RTSortLowerBound but speciallized for an array containing element
+ * pointers.
+ *
+ * @returns Index of the first element not less than @a pvKey, @a cElements
+ *          if there is none.
+ * @param   papvArray       The sorted array.
+ * @param   cElements       The number of elements in the array.
+ * @param   pvKey           The key to look for.
+ * @param   pfnCmp          Callback function comparing an array element (1st
+ *                          parameter) with the key (2nd parameter).
+ * @param   pvUser          User argument for the callback.
+ */
+RTDECL(size_t) RTSortApvLowerBound(void const * const *papvArray, size_t cElements, void const *pvKey,
+                                   PFNRTSORTCMP pfnCmp, void *pvUser);
+
+/**
+ * Same as RTSortBinarySearch but speciallized for an array containing element
+ * pointers.
+ *
+ * @returns true if found, false if not.
+ * @param   papvArray       The sorted array.
+ * @param   cElements       The number of elements in the array.
+ * @param   pvKey           The key to look for.
+ * @param   pfnCmp          Callback function comparing an array element (1st
+ *                          parameter) with the key (2nd parameter).
+ * @param   pvUser          User argument for the callback.
+ * @param   piElement       Where to return the index of the first matching
+ *                          element, or where to insert the key if not found.
+ *                          Optional.
+ */
+RTDECL(bool) RTSortApvBinarySearch(void const * const *papvArray, size_t cElements, void const *pvKey,
+                                   PFNRTSORTCMP pfnCmp, void *pvUser, size_t *piElement);
+
+
+/** @def RTSORT_DECL_INLINE_TYPE
+ * Instantiates the type specialized inline sorting and searching functions.
+ *
+ * These work directly on arrays of a simple type that can be compared using
+ * the less-than operator, so there are no callbacks involved.  The sort is
+ * an introspective sort like RTSortIntro.  The following functions are
+ * produced, with @a a_Sfx appended to the name:
+ *      - RTSort: sorts the array in ascending order.
+ *      - RTSortIsSorted: checks that the array is sorted.
+ *      - RTSortLowerBound: index of the first element >= key.
+ *      - RTSortUpperBound: index of the first element > key.
+ *      - RTSortBinarySearch: like RTSortBinarySearch.
+ *
+ * @param   a_Type      The element type.
+ * @param   a_Sfx       The function name suffix.
+ * @remarks No trailing semicolon.
+ */
+#define RTSORT_DECL_INLINE_TYPE(a_Type, a_Sfx) \
+    DECLINLINE(void) rtSortInsertion##a_Sfx(a_Type *paArray, size_t cElements) \
+    { \
+        size_t i, j; \
+        for (i = 1; i < cElements; i++) \
+        { \
+            a_Type const Tmp = paArray[i]; \
+            for (j = i; j > 0 && Tmp < paArray[j - 1]; j--) \
+                paArray[j] = paArray[j - 1]; \
+            paArray[j] = Tmp; \
+        } \
+    } \
+    \
+    DECLINLINE(void) rtSortHeap##a_Sfx(a_Type *paArray, size_t cElements) \
+    { \
+        size_t iStart = cElements / 2; \
+        size_t iEnd   = cElements; \
+        while (iEnd > 1) \
+        { \
+            a_Type Tmp; \
+            size_t iRoot, iChild; \
+            if (iStart > 0) \
+                iStart--; \
+            else \
+            { \
+                iEnd--; \
+                Tmp = paArray[0]; paArray[0] = paArray[iEnd]; paArray[iEnd] = Tmp; \
+            } \
+            iRoot = iStart; \
+            while ((iChild = iRoot * 2 + 1) < iEnd) \
+            { \
+                if (iChild + 1 < iEnd && paArray[iChild] < paArray[iChild + 1]) \
+                    iChild++; \
+                if (!(paArray[iRoot] < paArray[iChild])) \
+                    break; \
+                Tmp = paArray[iRoot]; paArray[iRoot] = paArray[iChild]; paArray[iChild] = Tmp; \
+                iRoot = iChild; \
+            } \
+        } \
+    } \
+    \
+    DECLINLINE(void) rtSortIntro##a_Sfx(a_Type *paArray, size_t cElements, unsigned cDepth) \
+    { \
+        while (cElements > 16) \
+        { \
+            size_t const iMid = cElements / 2; \
+            size_t       i    = 0; \
+            size_t       j    = cElements; \
+            a_Type       Tmp; \
+            a_Type       Pivot; \
+            if (!cDepth--) \
+            { \
+                rtSortHeap##a_Sfx(paArray, cElements); \
+                return; \
+            } \
+            /* Median of three into paArray[0], then Hoare partitioning around it. */ \
+            if (paArray[iMid] < paArray[0]) \
+            { Tmp = paArray[iMid]; paArray[iMid] = paArray[0]; paArray[0] = Tmp; } \
+            if (paArray[cElements - 1] < paArray[iMid]) \
+            { \
+                Tmp = paArray[iMid]; paArray[iMid] = paArray[cElements - 1]; paArray[cElements - 1] = Tmp; \
+                if (paArray[iMid] < paArray[0]) \
+                { Tmp = paArray[iMid]; paArray[iMid] = paArray[0]; paArray[0] = Tmp; } \
+            } \
+            Pivot         = paArray[iMid]; \
+            paArray[iMid] = paArray[0]; \
+            paArray[0]    = Pivot; \
+            for (;;) \
+            { \
+                do i++; while (i < cElements && paArray[i] < Pivot); \
+                do j--; while (Pivot < paArray[j]); \
+                if (i >= j) \
+                    break; \
+                Tmp = paArray[i]; paArray[i] = paArray[j]; paArray[j] = Tmp; \
+            } \
+            paArray[0] = paArray[j]; \
+            paArray[j] = Pivot; \
+            /* Recurse on the smaller part, loop on the larger one. */ \
+            if (j < cElements - j - 1) \
+            { \
+                rtSortIntro##a_Sfx(paArray, j, cDepth); \
+                paArray   += j + 1; \
+                cElements -= j + 1; \
+            } \
+            else \
+            { \
+                rtSortIntro##a_Sfx(&paArray[j + 1], cElements - j - 1, cDepth); \
+                cElements = j; \
+            } \
+        } \
+        rtSortInsertion##a_Sfx(paArray, cElements); \
+    } \
+    \
+    DECLINLINE(void) RTSort##a_Sfx(a_Type *paArray, size_t cElements) \
+    { \
+        unsigned cDepth = 0; \
+        size_t   c; \
+        for (c = cElements; c > 1; c >>= 1) \
+            cDepth += 2; \
+        rtSortIntro##a_Sfx(paArray, cElements, cDepth); \
+    } \
+    \
+    DECLINLINE(bool) RTSortIsSorted##a_Sfx(a_Type const *paArray, size_t cElements) \
+    { \
+        size_t i; \
+        for (i = 1; i < cElements; i++) \
+            if (paArray[i] < paArray[i - 1]) \
+                return false; \
+        return true; \
+    } \
+    \
+    DECLINLINE(size_t) RTSortLowerBound##a_Sfx(a_Type const *paArray, size_t cElements, a_Type Key) \
+    { \
+        size_t iBase = 0; \
+        while (cElements > 1) \
+        { \
+            size_t const cHalf = cElements / 2; \
+            iBase      = paArray[iBase + cHalf - 1] < Key ? iBase + cHalf : iBase; \
+            cElements -= cHalf; \
+        } \
+        return iBase + (cElements == 1 && paArray[iBase] < Key); \
+    } \
+    \
+    DECLINLINE(size_t) RTSortUpperBound##a_Sfx(a_Type const *paArray, size_t cElements, a_Type Key) \
+    { \
+        size_t iBase = 0; \
+        while (cElements > 1) \
+        { \
+            size_t const cHalf = cElements / 2; \
+            iBase      = !(Key < paArray[iBase + cHalf - 1]) ? iBase + cHalf : iBase; \
+            cElements -= cHalf; \
+        } \
+        return iBase + (cElements == 1 && !(Key < paArray[iBase])); \
+    } \
+    \
+    DECLINLINE(bool) RTSortBinarySearch##a_Sfx(a_Type const *paArray, size_t cElements, a_Type Key, size_t *piElement) \
+    { \
+        size_t const i = RTSortLowerBound##a_Sfx(paArray, cElements, Key); \
+        if (piElement) \
+            *piElement = i; \
+        return i < cElements && !(Key < paArray[i]); \
+    }
+
+RTSORT_DECL_INLINE_TYPE(uint32_t,  U32)
+RTSORT_DECL_INLINE_TYPE(uint64_t,  U64)
+RTSORT_DECL_INLINE_TYPE(int32_t,   S32)
+RTSORT_DECL_INLINE_TYPE(int64_t,   S64)
+RTSORT_DECL_INLINE_TYPE(uintptr_t, UPtr)
+
 RT_C_DECLS_END
 
 /** @} */
@@ -80,8 +80,15 @@ RT_C_DECLS_BEGIN
 #define RTTRACEBUF_FLAGS_DISABLED       RT_BIT_32(RTTRACEBUF_FLAGS_DISABLED_BIT)
 /** The bit number corresponding to the RTTRACEBUF_FLAGS_DISABLED mask. */
 #define RTTRACEBUF_FLAGS_DISABLED_BIT   1
+/** Use per-CPU sub-buffers.
+ * Each CPU reserves entries from its own ring so that concurrent writers
+ * don't bounce a shared cache line between them.  Readers merge the rings in
+ * time stamp order.  The entry count is divided evenly between the rings.
+ * Each ring gets at least 128 entries, so with small buffers several CPUs
+ * share a ring. */
+#define RTTRACEBUF_FLAGS_PER_CPU        RT_BIT_32(2)
 /** Mask of the valid flags. */
-#define RTTRACEBUF_FLAGS_MASK           UINT32_C(0x00000003)
+#define RTTRACEBUF_FLAGS_MASK           UINT32_C(0x00000007)
 /** @}  */
 
 
@@ -174,6 +181,159 @@ RTDECL(bool)        RTTraceBufDisable(RTTRACEBUF hTraceBuf);
 RTDECL(bool)        RTTraceBufEnable(RTTRACEBUF hTraceBuf);
 
 
+/** The event ID used for text message records. */
+#define RTTRACEBUF_EVENT_ID_MSG         UINT32_C(0)
+
+/**
+ * A trace buffer record as seen by RTTraceBufEnumRecords.
+ */
+typedef struct RTTRACEBUFRECORD
+{
+    /** The nano second time stamp of the record. */
+    uint64_t            NanoTS;
+    /** The ID of the CPU which added the record. */
+    RTCPUID             idCpu;
+    /** The event ID, RTTRACEBUF_EVENT_ID_MSG for text messages. */
+    uint32_t            idEvent;
+    /** The number of arguments in pau64Args (binary events only). */
+    uint32_t            cArgs;
+    /** The event arguments (binary events only). */
+    uint64_t const     *pau64Args;
+    /** The message text, NULL for binary events. */
+    const char         *pszMsg;
+} RTTRACEBUFRECORD;
+/** Pointer to a const trace buffer record. */
+typedef RTTRACEBUFRECORD const *PCRTTRACEBUFRECORD;
+
+/**
+ * Trace buffer callback for processing one record.
+ *
+ * Used by RTTraceBufEnumRecords.
+ *
+ * @returns IPRT status code.  Any status code but VINF_SUCCESS will abort the
+ *          enumeration and be returned by RTTraceBufEnumRecords.
+ * @param   hTraceBuf           The trace buffer handle.
+ * @param   iEntry              The number of entries left after this one.
+ * @param   pRecord             The record.  Only valid during the call.
+ * @param   pvUser              The user argument.
+ */
+typedef DECLCALLBACK(int) FNRTTRACEBUFRECCALLBACK(RTTRACEBUF hTraceBuf, uint32_t iEntry, PCRTTRACEBUFRECORD pRecord,
+                                                  void *pvUser);
+/** Pointer to trace buffer record enumeration callback function. */
+typedef FNRTTRACEBUFRECCALLBACK *PFNRTTRACEBUFRECCALLBACK;
+
+/**
+ * Enumerates the used trace buffer entries in time stamp order, calling
+ * @a pfnCallback for each.
+ *
+ * Unlike RTTraceBufEnumEntries, binary event records are passed on as they
+ * are instead of being formatted as text.
+ *
+ * @returns IPRT status code.  Should the callback (@a pfnCallback) return
+ *          anything other than VINF_SUCCESS, then the enumeration will be
+ *          aborted and the status code will be returned by this function.
+ * @retval  VINF_SUCCESS
+ * @retval  VERR_INVALID_HANDLE
+ *
+ * @param   hTraceBuf           The trace buffer handle.  Special handles are
+ *                              accepted.
+ * @param   pfnCallback         The callback to call for each record.
+ * @param   pvUser              The user argument for the callback.
+ */
+RTDECL(int)         RTTraceBufEnumRecords(RTTRACEBUF hTraceBuf, PFNRTTRACEBUFRECCALLBACK pfnCallback, void *pvUser);
+
+/**
+ * Adds a binary event record with up to four arguments.
+ *
+ * This is considerably cheaper than the message variants as nothing is
+ * formatted when recording.  Unused arguments should be passed as zero.
+ *
+ * @returns IPRT status code.
+ * @retval  VINF_SUCCESS also when tracing is disabled.
+ * @retval  VERR_INVALID_HANDLE
+ * @retval  VERR_NOT_FOUND if RTTRACEBUF_DEFAULT is passed and there is no
+ *          default buffer.
+ *
+ * @param   hTraceBuf           The trace buffer handle.  Special handles are
+ *                              accepted.
+ * @param   idEvent             The event ID.  RTTRACEBUF_EVENT_ID_MSG is not
+ *                              allowed.
+ * @param   uArg1               The first argument.
+ * @param   uArg2               The second argument.
+ * @param   uArg3               The third argument.
+ * @param   uArg4               The fourth argument.
+ */
+RTDECL(int)         RTTraceBufAddEvent(RTTRACEBUF hTraceBuf, uint32_t idEvent,
+                                       uint64_t uArg1, uint64_t uArg2, uint64_t uArg3, uint64_t uArg4);
+
+/**
+ * Adds a binary event record with an arbitrary number of arguments.
+ *
+ * @returns IPRT status code, see RTTraceBufAddEvent.
+ * @retval  VERR_BUFFER_OVERFLOW if the arguments doesn't fit into an entry.
+ *          The event is recorded with the arguments that fit.
+ *
+ * @param   hTraceBuf           The trace buffer handle.  Special handles are
+ *                              accepted.
+ * @param   idEvent             The event ID.  RTTRACEBUF_EVENT_ID_MSG is not
+ *                              allowed.
+ * @param   pau64Args           The arguments.
+ * @param   cArgs               The number of arguments.  The entry size limits
+ *                              how many are stored, RTTraceBufGetMaxEventArgs.
+ */
+RTDECL(int)         RTTraceBufAddEventEx(RTTRACEBUF hTraceBuf, uint32_t idEvent, uint64_t const *pau64Args, uint32_t cArgs);
+
+/**
+ * Gets the maximum number of binary event arguments an entry can hold.
+ *
+ * @returns The argument count on success, 0 if the handle is invalid.
+ *
+ * @param   hTraceBuf           The trace buffer handle.  Special handles are
+ *                              accepted.
+ */
+RTDECL(uint32_t)    RTTraceBufGetMaxEventArgs(RTTRACEBUF hTraceBuf);
+
+
+/**
+ * Binary event descriptor used when exporting trace buffers.
+ */
+typedef struct RTTRACEBUFEVTDESC
+{
+    /** The event ID. */
+    uint32_t            idEvent;
+    /** The number of arguments to export (the rest are ignored). */
+    uint32_t            cArgs;
+    /** The event name. */
+    const char         *pszName;
+    /** The category (optional). */
+    const char         *pszCategory;
+    /** The argument names, cArgs entries (optional). */
+    const char * const *papszArgNames;
+} RTTRACEBUFEVTDESC;
+/** Pointer to a const binary event descriptor. */
+typedef RTTRACEBUFEVTDESC const *PCRTTRACEBUFEVTDESC;
+
+/**
+ * Exports the trace buffer content in the Chrome trace event format (JSON),
+ * loadable by chrome://tracing, Perfetto and similar viewers.
+ *
+ * Every record becomes an instant event with the CPU ID as thread ID.  Text
+ * messages are exported as "msg" events with the text as argument.  Binary
+ * events are named using @a paDescs, events without a descriptor are named
+ * after their ID.
+ *
+ * @returns IPRT status code.
+ * @param   hTraceBuf           The trace buffer handle.  Special handles are
+ *                              accepted.
+ * @param   paDescs             Binary event descriptors (optional).
+ * @param   cDescs              Number of descriptors in @a paDescs.
+ * @param   pfnPrintfV          The output function.
+ * @param   pvUser              The user argument for the output function.
+ */
+RTDECL(int)         RTTraceBufExportChromeTrace(RTTRACEBUF hTraceBuf, PCRTTRACEBUFEVTDESC paDescs, uint32_t cDescs,
+                                                PFNRTDUMPPRINTFV pfnPrintfV, void *pvUser);
+
+
 RTDECL(int)         RTTraceBufAddMsg(      RTTRACEBUF hTraceBuf, const char *pszMsg);
 RTDECL(int)         RTTraceBufAddMsgF(     RTTRACEBUF hTraceBuf, const char *pszMsgFmt, ...) RT_IPRT_FORMAT_ATTR(2, 3);
 RTDECL(int)         RTTraceBufAddMsgV(     RTTRACEBUF hTraceBuf, const char *pszMsgFmt, va_list va) RT_IPRT_FORMAT_ATTR(2, 0);
@@ -87,6 +87,8 @@ typedef enum RTZIPTYPE
     RTZIPTYPE_LZO,
     /* Zlib compression the data without zlib header. */
     RTZIPTYPE_ZLIB_NO_HEADER,
+    /** LZ4 block format compression. */
+    RTZIPTYPE_LZ4,
     /** End of valid the valid compression types.  */
     RTZIPTYPE_END
 } RTZIPTYPE;
@@ -246,13 +248,44 @@ RTDECL(int) RTZipGzipDecompressIoStream(RTVFSIOSTREAM hVfsIosIn, uint32_t fFlags
  * @param   hVfsIosDst          The compressed output stream (must be writable).
  *                              The reference is not consumed, instead another
  *                              one is retained.
- * @param   fFlags              Flags, MBZ.
+ * @param   fFlags              RTZIPGZIPCOMP_F_XXX.
  * @param   uLevel              The gzip compression level, 1 thru 9.
  * @param   phVfsIosGzip        Where to return the gzip input I/O stream handle
  *                              (you write to this).
  */
 RTDECL(int) RTZipGzipCompressIoStream(RTVFSIOSTREAM hVfsIosDst, uint32_t fFlags, uint8_t uLevel, PRTVFSIOSTREAM phVfsIosGzip);
 
+/** @name RTZipGzipCompressIoStream flags.
+ * @{ */
+/** Compress the input in independent blocks on a pool of worker threads.
+ *
+ * Each block is primed with the last 32KB of the preceding input as
+ * dictionary and ends on a byte boundary (sync flush), so the blocks simply
+ * concatenate into a single regular gzip member that any gunzip can read.
+ * The ratio is marginally worse than the serial compressor and flushing costs
+ * a partial block. */
+#define RTZIPGZIPCOMP_F_PARALLEL            RT_BIT(0)
+/** @} */
+
+/**
+ * Opens a gzip compressed file for random access decompression.
+ *
+ * An index of inflate access points is built while the file is being read,
+ * so seeking back or to somewhere already passed only has to inflate from the
+ * nearest access point instead of from the start of the file.  Concatenated
+ * gzip members are treated as one stream, like gunzip does.
+ *
+ * @returns IPRT status code.
+ *
+ * @param   hVfsFileIn          The compressed input file (must be readable).
+ *                              The reference is not consumed, instead another
+ *                              one is retained.
+ * @param   fFlags              RTZIPGZIPDECOMP_F_XXX.
+ * @param   phVfsFileGunzip     Where to return the handle to the gunzipped file
+ *                              (read-only).
+ */
+RTDECL(int) RTZipGzipDecompressFile(RTVFSFILE hVfsFileIn, uint32_t fFlags, PRTVFSFILE phVfsFileGunzip);
+
 /**
  * Opens a TAR filesystem stream.
  *
@@ -41,6 +41,7 @@
 #include <VBox/vmm/pdmnetifs.h>
 #include <VBox/vmm/pdmnetinline.h>
 #include <VBox/param.h>
+#include <VBox/msi.h>
 #include "VBoxDD.h"
 
 #include "DevEEPROM.h"
@@ -156,6 +157,14 @@
 # define E1K_RXD_CACHE_SIZE 16u
 #endif /* E1K_WITH_RXD_CACHE */
 
+/**
+ * E1K_MAX_QUEUES specifies the number of RX and TX descriptor rings. All chips
+ * but 82574L use a single pair of rings, 82574L has two of each.
+ */
+#define E1K_MAX_QUEUES 2u
+/** The number of MSI-X vectors provided by 82574L. */
+#define E1K_MSIX_VECTORS 5u
+
 
 /* Little helpers ************************************************************/
 #undef htons
@@ -235,6 +244,7 @@ typedef uint32_t E1KCHIP;
 #define E1K_CHIP_82540EM 0
 #define E1K_CHIP_82543GC 1
 #define E1K_CHIP_82545EM 2
+#define E1K_CHIP_82574L  3
 
 #ifdef IN_RING3
 /** Different E1000 chips. */
@@ -257,7 +267,8 @@ static const struct E1kChips
 # endif
                       0x8086, 0x001E, "82540EM" }, /* Intel 82540EM-A in Intel PRO/1000 MT Desktop */
     { 0x8086, 0x1004, 0x8086, 0x1004, "82543GC" }, /* Intel 82543GC   in Intel PRO/1000 T  Server */
-    { 0x8086, 0x100F, 0x15AD, 0x0750, "82545EM" }  /* Intel 82545EM-A in VMWare Network Adapter */
+    { 0x8086, 0x100F, 0x15AD, 0x0750, "82545EM" }, /* Intel 82545EM-A in VMWare Network Adapter */
+    { 0x8086, 0x10D3, 0x8086, 0xA01F, "82574L"  }  /* Intel 82574L    in Intel Gigabit CT Desktop Adapter */
 };
 #endif /* IN_RING3 */
 
@@ -287,12 +298,17 @@ static const struct E1kChips
 #define CTRL_RESET          UINT32_C(0x04000000)
 #define CTRL_VME            UINT32_C(0x40000000)
 
+#define CTRL_EXT_EIAME      UINT32_C(0x01000000)          /**< 82574L only. */
+#define CTRL_EXT_IAME       UINT32_C(0x08000000)          /**< 82574L only. */
+#define CTRL_EXT_PBA_CLR    UINT32_C(0x80000000)          /**< 82574L only. */
+
 #define STATUS_LU           UINT32_C(0x00000002)
 #define STATUS_TXOFF        UINT32_C(0x00000010)
 
 #define EECD_EE_WIRES       UINT32_C(0x0F)
 #define EECD_EE_REQ         UINT32_C(0x40)
 #define EECD_EE_GNT         UINT32_C(0x80)
+#define EECD_AUTO_RD        UINT32_C(0x200)
 
 #define EERD_START          UINT32_C(0x00000001)
 #define EERD_DONE           UINT32_C(0x00000010)
@@ -301,6 +317,11 @@ static const struct E1kChips
 #define EERD_ADDR_MASK      UINT32_C(0x0000FF00)
 #define EERD_ADDR_SHIFT     8
 
+/* 82574L moved the address field and the done bit in EERD. */
+#define EERD_82574_DONE       UINT32_C(0x00000002)
+#define EERD_82574_ADDR_MASK  UINT32_C(0x0000FFFC)
+#define EERD_82574_ADDR_SHIFT 2
+
 #define MDIC_DATA_MASK      UINT32_C(0x0000FFFF)
 #define MDIC_DATA_SHIFT     0
 #define MDIC_REG_MASK       UINT32_C(0x001F0000)
@@ -342,6 +363,13 @@ static const struct E1kChips
 #define ICR_RXDMT0          UINT32_C(0x00000010)
 #define ICR_RXT0            UINT32_C(0x00000080)
 #define ICR_TXD_LOW         UINT32_C(0x00008000)
+#define ICR_RXQ0            UINT32_C(0x00100000)          /**< 82574L only. */
+#define ICR_RXQ1            UINT32_C(0x00200000)          /**< 82574L only. */
+#define ICR_TXQ0            UINT32_C(0x00400000)          /**< 82574L only. */
+#define ICR_TXQ1            UINT32_C(0x00800000)          /**< 82574L only. */
+#define ICR_OTHER           UINT32_C(0x01000000)          /**< 82574L only. */
+#define ICR_MSIX_CAUSES     UINT32_C(0x01F00000)          /**< 82574L only. */
+#define ICR_INT_ASSERTED    UINT32_C(0x80000000)          /**< 82574L only. */
 #define RDTR_FPD            UINT32_C(0x80000000)
 
 #define PBA_st  ((PBAST*)(pThis->auRegs + PBA_IDX))
@@ -353,6 +381,22 @@ typedef struct
 } PBAST;
 AssertCompileSize(PBAST, 4);
 
+/**
+ * Descriptor ring registers. The ones of the first ring occupy consecutive
+ * slots of auRegs, the ones of the second 82574L ring live in the state
+ * structure, so both can be accessed via the same pointer type.
+ */
+typedef struct E1KRINGREGS
+{
+    uint32_t    uBAL;       /**< Base address, low part. */
+    uint32_t    uBAH;       /**< Base address, high part. */
+    uint32_t    uLEN;       /**< Length of the ring in bytes. */
+    uint32_t    uH;         /**< Head. */
+    uint32_t    uT;         /**< Tail. */
+} E1KRINGREGS;
+typedef E1KRINGREGS *PE1KRINGREGS;
+AssertCompileSize(E1KRINGREGS, 20);
+
 #define TXDCTL_WTHRESH_MASK   0x003F0000
 #define TXDCTL_WTHRESH_SHIFT  16
 #define TXDCTL_LWTHRESH_MASK  0xFE000000
@@ -360,6 +404,37 @@ AssertCompileSize(PBAST, 4);
 
 #define RXCSUM_PCSS_MASK    UINT32_C(0x000000FF)
 #define RXCSUM_PCSS_SHIFT   0
+#define RXCSUM_IPPCSE       UINT32_C(0x00001000)          /**< 82574L only. */
+#define RXCSUM_PCSD         UINT32_C(0x00002000)          /**< 82574L only. */
+
+#define RFCTL_EXSTEN        UINT32_C(0x00008000)
+
+#define MRQC_ENABLE_MASK    UINT32_C(0x00000003)
+#define MRQC_ENABLE_RSS     UINT32_C(0x00000001)
+#define MRQC_RSS_TCPIPV4    UINT32_C(0x00010000)
+#define MRQC_RSS_IPV4       UINT32_C(0x00020000)
+#define MRQC_RSS_IPV6       UINT32_C(0x00100000)
+#define MRQC_RSS_TCPIPV6    UINT32_C(0x00200000)
+
+/** @name RSS types reported in extended RX descriptors.
+ * @{ */
+#define E1K_RSS_TYPE_NONE     0
+#define E1K_RSS_TYPE_TCPIPV4  1
+#define E1K_RSS_TYPE_IPV4     2
+#define E1K_RSS_TYPE_TCPIPV6  3
+#define E1K_RSS_TYPE_IPV6     5
+/** @} */
+
+/** @name IVAR layout: one 4-bit field per interrupt cause.
+ * @{ */
+#define IVAR_FIELD_RXQ0     0
+#define IVAR_FIELD_RXQ1     1
+#define IVAR_FIELD_TXQ0     2
+#define IVAR_FIELD_TXQ1     3
+#define IVAR_FIELD_OTHER    4
+#define IVAR_VALID          UINT32_C(0x8)
+#define IVAR_VECTOR_MASK    UINT32_C(0x7)
+/** @} */
 
 /** @name Register access macros
  * @remarks These ASSUME alocal variable @a pThis of type PE1KSTATE.
@@ -626,6 +701,22 @@ typedef enum
     RA_82542_IDX,
     MTA_82542_IDX,
     VFTA_82542_IDX,
+    EIAC_IDX,
+    IAM_IDX,
+    IVAR_IDX,
+    EITR_IDX,
+    EXTCNF_CTRL_IDX,
+    RXQ1_IDX,
+    RXDCTL1_IDX,
+    TARC0_IDX,
+    TXQ1_IDX,
+    TXDCTL1_IDX,
+    TARC1_IDX,
+    RFCTL_IDX,
+    MRQC_IDX,
+    SWSM_IDX,
+    RETA_IDX,
+    RSSRK_IDX,
     E1K_NUM_OF_REGS
 } E1kRegIndex;
 
@@ -633,6 +724,9 @@ typedef enum
 /** The number of registers with strictly increasing offset. */
 #define E1K_NUM_OF_BINARY_SEARCHABLE    (WUPL_IDX + 1)
 
+AssertCompile(RDBAH_IDX == RDBAL_IDX + 1 && RDLEN_IDX == RDBAL_IDX + 2 && RDH_IDX == RDBAL_IDX + 3 && RDT_IDX == RDBAL_IDX + 4);
+AssertCompile(TDBAH_IDX == TDBAL_IDX + 1 && TDLEN_IDX == TDBAL_IDX + 2 && TDH_IDX == TDBAL_IDX + 3 && TDT_IDX == TDBAL_IDX + 4);
+
 
 /**
  * Define E1000-specific EEPROM layout.
@@ -1109,6 +1203,9 @@ struct E1kState_st
     bool        fTidEnabled;
     /** Link up delay (in milliseconds). */
     uint32_t    cMsLinkUpDelay;
+    /** All: Minimum interval between receive interrupts (in nanoseconds),
+     * independent of ITR.  0 if receive interrupts are not coalesced. */
+    uint32_t    cNsRxIntCoalescing;
 
     /** All: Device register storage. */
     uint32_t    auRegs[E1K_NUM_OF_32BIT_REGS];
@@ -1139,14 +1236,22 @@ struct E1kState_st
     /** EMT: Gets signalled when more RX descriptors become available. */
     RTSEMEVENT  hEventMoreRxDescAvail;
 #ifdef E1K_WITH_RXD_CACHE
-    /** RX: Fetched RX descriptors. */
-    E1KRXDESC   aRxDescriptors[E1K_RXD_CACHE_SIZE];
-    //uint64_t    aRxDescAddr[E1K_RXD_CACHE_SIZE];
-    /** RX: Actual number of fetched RX descriptors. */
-    uint32_t    nRxDFetched;
-    /** RX: Index in cache of RX descriptor being processed. */
-    uint32_t    iRxDCurrent;
+    /** RX: Per-ring descriptor caches. */
+    struct E1KRXQ
+    {
+        /** RX: Fetched RX descriptors. */
+        E1KRXDESC   aRxDescriptors[E1K_RXD_CACHE_SIZE];
+        //uint64_t    aRxDescAddr[E1K_RXD_CACHE_SIZE];
+        /** RX: Actual number of fetched RX descriptors. */
+        uint32_t    nRxDFetched;
+        /** RX: Index in cache of RX descriptor being processed. */
+        uint32_t    iRxDCurrent;
+    }           aRxQ[E1K_MAX_QUEUES];
 #endif /* E1K_WITH_RXD_CACHE */
+    /** RX: RSS hash of the packet being stored (82574L). */
+    uint32_t    uRxRssHash;
+    /** RX: RSS type of the packet being stored (82574L). */
+    uint32_t    uRxRssType;
 
     /** TX: Context used for TCP segmentation packets. */
     E1KTXCTX    contextTSE;
@@ -1167,6 +1272,10 @@ struct E1kState_st
     uint32_t    cbTxAlloc;
 
 #endif /* E1K_WITH_TXD_CACHE */
+    /** TX: The ring being serviced. */
+    uint32_t    iTxQ;
+    /** TX: Contexts (TSE, normal) of the rings not being serviced (82574L). */
+    E1KTXCTX    aTxQCtx[E1K_MAX_QUEUES][2];
     /** GSO context. u8Type is set to PDMNETWORKGSOTYPE_INVALID when not
      *  applicable to the current TSE mode. */
     PDMNETWORKGSO GsoCtx;
@@ -1207,6 +1316,47 @@ struct E1kState_st
     /** EMT: Physical interface emulation. */
     PHY         phy;
 
+    /** @name 82574L registers not kept in auRegs.
+     * @{ */
+    /** All: Registers of the second RX descriptor ring. */
+    E1KRINGREGS RxRing1;
+    /** All: Registers of the second TX descriptor ring. */
+    E1KRINGREGS TxRing1;
+    /** EMT: Receive descriptor control of the second ring. */
+    uint32_t    uRXDCTL1;
+    /** EMT: Transmit descriptor control of the second ring. */
+    uint32_t    uTXDCTL1;
+    /** EMT: Transmit arbitration counters. */
+    uint32_t    auTARC[E1K_MAX_QUEUES];
+    /** All: Extended interrupt auto clear. */
+    uint32_t    uEIAC;
+    /** All: Interrupt acknowledge auto-mask. */
+    uint32_t    uIAM;
+    /** All: Interrupt vector allocation. */
+    uint32_t    uIVAR;
+    /** All: Per-vector interrupt throttling. */
+    uint32_t    auEITR[E1K_MSIX_VECTORS];
+    /** EMT: Extended configuration control (software semaphore). */
+    uint32_t    uEXTCNF_CTRL;
+    /** EMT: Software semaphore. */
+    uint32_t    uSWSM;
+    /** RX: Receive filter control. */
+    uint32_t    uRFCTL;
+    /** RX: Multiple receive queues command. */
+    uint32_t    uMRQC;
+    /** RX: RSS redirection table, 128 entries of one byte each. */
+    uint32_t    auRETA[32];
+    /** RX: RSS random key, 40 bytes. */
+    uint32_t    auRSSRK[10];
+    /** @} */
+    /** EMT: Offset of MSI-X capability in PCI config space, 0 if none. */
+    uint8_t     offMsixCap;
+    uint8_t     abAlignment2[3];
+    /** All: Vectors with throttled interrupts pending. */
+    uint32_t    fMsixDeferred;
+    /** All: The time each vector has last been fired. */
+    uint64_t    au64VectorFiredAt[E1K_MSIX_VECTORS];
+
 #if 0
     /** Alignment padding. */
     uint8_t                             Alignment[HC_ARCH_BITS == 64 ? 8 : 4];
@@ -1229,6 +1379,7 @@ struct E1kState_st
     STAMCOUNTER                         StatLateInts;
     STAMCOUNTER                         StatIntsRaised;
     STAMCOUNTER                         StatIntsPrevented;
+    STAMCOUNTER                         StatIntsRxCoalesced;
     STAMPROFILEADV                      StatReceive;
     STAMPROFILEADV                      StatReceiveCRC;
     STAMPROFILEADV                      StatReceiveFilter;
@@ -1318,7 +1469,10 @@ static int e1kRegReadCTRL          (PE1KSTATE pThis, uint32_t offset, uint32_t i
 static int e1kRegWriteCTRL         (PE1KSTATE pThis, uint32_t offset, uint32_t index, uint32_t u32Value);
 static int e1kRegReadEECD          (PE1KSTATE pThis, uint32_t offset, uint32_t index, uint32_t *pu32Value);
 static int e1kRegWriteEECD         (PE1KSTATE pThis, uint32_t offset, uint32_t index, uint32_t u32Value);
+static int e1kRegReadEERD          (PE1KSTATE pThis, uint32_t offset, uint32_t index, uint32_t *pu32Value);
 static int e1kRegWriteEERD         (PE1KSTATE pThis, uint32_t offset, uint32_t index, uint32_t u32Value);
+static int e1kRegReadCTRL_EXT      (PE1KSTATE pThis, uint32_t offset, uint32_t index, uint32_t *pu32Value);
+static int e1kRegWriteCTRL_EXT     (PE1KSTATE pThis, uint32_t offset, uint32_t index, uint32_t u32Value);
 static int e1kRegWriteMDIC         (PE1KSTATE pThis, uint32_t offset, uint32_t index, uint32_t u32Value);
 static int e1kRegReadICR           (PE1KSTATE pThis, uint32_t offset, uint32_t index, uint32_t *pu32Value);
 static int e1kRegWriteICR          (PE1KSTATE pThis, uint32_t offset, uint32_t index, uint32_t u32Value);
@@ -1336,6 +1490,9 @@ static int e1kRegReadRA            (PE1KSTATE pThis, uint32_t offset, uint32_t i
 static int e1kRegWriteRA           (PE1KSTATE pThis, uint32_t offset, uint32_t index, uint32_t u32Value);
 static int e1kRegReadVFTA          (PE1KSTATE pThis, uint32_t offset, uint32_t index, uint32_t *pu32Value);
 static int e1kRegWriteVFTA         (PE1KSTATE pThis, uint32_t offset, uint32_t index, uint32_t u32Value);
+static int e1kRegWriteRXCSUM       (PE1KSTATE pThis, uint32_t offset, uint32_t index, uint32_t u32Value);
+static int e1kRegRead82574         (PE1KSTATE pThis, uint32_t offset, uint32_t index, uint32_t *pu32Value);
+static int e1kRegWrite82574        (PE1KSTATE pThis, uint32_t offset, uint32_t index, uint32_t u32Value);
 
 /**
  * Register map table.
@@ -1367,8 +1524,8 @@ static const struct E1kRegMap_st
     { 0x00000, 0x00004, 0xDBF31BE9, 0xDBF31BE9, e1kRegReadDefault      , e1kRegWriteCTRL         , "CTRL"    , "Device Control" },
     { 0x00008, 0x00004, 0x0000FDFF, 0x00000000, e1kRegReadDefault      , e1kRegWriteUnimplemented, "STATUS"  , "Device Status" },
     { 0x00010, 0x00004, 0x000027F0, 0x00000070, e1kRegReadEECD         , e1kRegWriteEECD         , "EECD"    , "EEPROM/Flash Control/Data" },
-    { 0x00014, 0x00004, 0xFFFFFF10, 0xFFFFFF00, e1kRegReadDefault      , e1kRegWriteEERD         , "EERD"    , "EEPROM Read" },
-    { 0x00018, 0x00004, 0xFFFFFFFF, 0xFFFFFFFF, e1kRegReadUnimplemented, e1kRegWriteUnimplemented, "CTRL_EXT", "Extended Device Control" },
+    { 0x00014, 0x00004, 0xFFFFFF10, 0xFFFFFF00, e1kRegReadEERD         , e1kRegWriteEERD         , "EERD"    , "EEPROM Read" },
+    { 0x00018, 0x00004, 0xFFFFFFFF, 0xFFFFFFFF, e1kRegReadCTRL_EXT     , e1kRegWriteCTRL_EXT     , "CTRL_EXT", "Extended Device Control" },
     { 0x0001c, 0x00004, 0xFFFFFFFF, 0xFFFFFFFF, e1kRegReadUnimplemented, e1kRegWriteUnimplemented, "FLA"     , "Flash Access (N/A)" },
     { 0x00020, 0x00004, 0xFFFFFFFF, 0xFFFFFFFF, e1kRegReadDefault      , e1kRegWriteMDIC         , "MDIC"    , "MDI Control" },
     { 0x00028, 0x00004, 0xFFFFFFFF, 0xFFFFFFFF, e1kRegReadUnimplemented, e1kRegWriteUnimplemented, "FCAL"    , "Flow Control Address Low" },
@@ -1400,7 +1557,7 @@ static const struct E1kRegMap_st
     { 0x02804, 0x00004, 0xFFFFFFFF, 0xFFFFFFFF, e1kRegReadDefault      , e1kRegWriteDefault      , "RDBAH"   , "Receive Descriptor Base High" },
     { 0x02808, 0x00004, 0xFFFFFFFF, 0xFFFFFFFF, e1kRegReadDefault      , e1kRegWriteDefault      , "RDLEN"   , "Receive Descriptor Length" },
     { 0x02810, 0x00004, 0xFFFFFFFF, 0xFFFFFFFF, e1kRegReadDefault      , e1kRegWriteDefault      , "RDH"     , "Receive Descriptor Head" },
-    { 0x02818, 0x00004, 0xFFFFFFFF, 0xFFFFFFFF, e1kRegReadDefault      , e1kRegWriteRDT          , "RDT"     , "Receive Descriptor Tail" },
+    { 0x02818, 0x00004, 0x0000FFFF, 0x0000FFFF, e1kRegReadDefault      , e1kRegWriteRDT          , "RDT"     , "Receive Descriptor Tail" },
     { 0x02820, 0x00004, 0x0000FFFF, 0x0000FFFF, e1kRegReadDefault      , e1kRegWriteRDTR         , "RDTR"    , "Receive Delay Timer" },
     { 0x02828, 0x00004, 0xFFFFFFFF, 0xFFFFFFFF, e1kRegReadUnimplemented, e1kRegWriteUnimplemented, "RXDCTL"  , "Receive Descriptor Control" },
     { 0x0282c, 0x00004, 0x0000FFFF, 0x0000FFFF, e1kRegReadDefault      , e1kRegWriteDefault      , "RADV"    , "Receive Interrupt Absolute Delay Timer" },
@@ -1478,7 +1635,7 @@ static const struct E1kRegMap_st
     { 0x040f4, 0x00004, 0xFFFFFFFF, 0x00000000, e1kRegReadAutoClear    , e1kRegWriteUnimplemented, "BPTC"    , "Broadcast Packets Transmitted Count" },
     { 0x040f8, 0x00004, 0xFFFFFFFF, 0x00000000, e1kRegReadAutoClear    , e1kRegWriteUnimplemented, "TSCTC"   , "TCP Segmentation Context Transmitted Count" },
     { 0x040fc, 0x00004, 0xFFFFFFFF, 0x00000000, e1kRegReadAutoClear    , e1kRegWriteUnimplemented, "TSCTFC"  , "TCP Segmentation Context Tx Fail Count" },
-    { 0x05000, 0x00004, 0x000007FF, 0x000007FF, e1kRegReadDefault      , e1kRegWriteDefault      , "RXCSUM"  , "Receive Checksum Control" },
+    { 0x05000, 0x00004, 0x000037FF, 0x000037FF, e1kRegReadDefault      , e1kRegWriteRXCSUM       , "RXCSUM"  , "Receive Checksum Control" },
     { 0x05800, 0x00004, 0xFFFFFFFF, 0xFFFFFFFF, e1kRegReadUnimplemented, e1kRegWriteUnimplemented, "WUC"     , "Wakeup Control" },
     { 0x05808, 0x00004, 0xFFFFFFFF, 0xFFFFFFFF, e1kRegReadUnimplemented, e1kRegWriteUnimplemented, "WUFC"    , "Wakeup Filter Control" },
     { 0x05810, 0x00004, 0xFFFFFFFF, 0x00000000, e1kRegReadUnimplemented, e1kRegWriteUnimplemented, "WUS"     , "Wakeup Status" },
@@ -1497,7 +1654,23 @@ static const struct E1kRegMap_st
     { 0x10000, 0x10000, 0xFFFFFFFF, 0xFFFFFFFF, e1kRegReadUnimplemented, e1kRegWriteUnimplemented, "PBM"     , "Packet Buffer Memory (n)" },
     { 0x00040, 0x00080, 0xFFFFFFFF, 0xFFFFFFFF, e1kRegReadRA           , e1kRegWriteRA           , "RA82542" , "Receive Address (64-bit) (n) (82542)" },
     { 0x00200, 0x00200, 0xFFFFFFFF, 0xFFFFFFFF, e1kRegReadMTA          , e1kRegWriteMTA          , "MTA82542", "Multicast Table Array (n) (82542)" },
-    { 0x00600, 0x00200, 0xFFFFFFFF, 0xFFFFFFFF, e1kRegReadVFTA         , e1kRegWriteVFTA         , "VFTA82542", "VLAN Filter Table Array (n) (82542)" }
+    { 0x00600, 0x00200, 0xFFFFFFFF, 0xFFFFFFFF, e1kRegReadVFTA         , e1kRegWriteVFTA         , "VFTA82542", "VLAN Filter Table Array (n) (82542)" },
+    { 0x000dc, 0x00004, 0x01F00000, 0x01F00000, e1kRegRead82574        , e1kRegWrite82574        , "EIAC"    , "Extended Interrupt Auto Clear (82574)" },
+    { 0x000e0, 0x00004, 0xFFFFFFFF, 0xFFFFFFFF, e1kRegRead82574        , e1kRegWrite82574        , "IAM"     , "Interrupt Acknowledge Auto Mask (82574)" },
+    { 0x000e4, 0x00004, 0x800FFFFF, 0x800FFFFF, e1kRegRead82574        , e1kRegWrite82574        , "IVAR"    , "Interrupt Vector Allocation Registers (82574)" },
+    { 0x000e8, 0x00014, 0x0000FFFF, 0x0000FFFF, e1kRegRead82574        , e1kRegWrite82574        , "EITR"    , "Extended Interrupt Throttle (n) (82574)" },
+    { 0x00f00, 0x00004, 0xFFFFFFFF, 0xFFFFFFFF, e1kRegRead82574        , e1kRegWrite82574        , "EXTCNF_CTRL", "Extended Configuration Control (82574)" },
+    { 0x02900, 0x0001c, 0xFFFFFFFF, 0xFFFFFFFF, e1kRegRead82574        , e1kRegWrite82574        , "RXQ1"    , "Receive Descriptor Ring 1 (82574)" },
+    { 0x02928, 0x00004, 0xFFFFFFFF, 0xFFFFFFFF, e1kRegRead82574        , e1kRegWrite82574        , "RXDCTL1" , "Receive Descriptor Control 1 (82574)" },
+    { 0x03840, 0x00004, 0xFFFFFFFF, 0xFFFFFFFF, e1kRegRead82574        , e1kRegWrite82574        , "TARC0"   , "Transmit Arbitration Count 0 (82574)" },
+    { 0x03900, 0x0001c, 0xFFFFFFFF, 0xFFFFFFFF, e1kRegRead82574        , e1kRegWrite82574        , "TXQ1"    , "Transmit Descriptor Ring 1 (82574)" },
+    { 0x03928, 0x00004, 0xFF3F3F3F, 0xFF3F3F3F, e1kRegRead82574        , e1kRegWrite82574        , "TXDCTL1" , "Transmit Descriptor Control 1 (82574)" },
+    { 0x03940, 0x00004, 0xFFFFFFFF, 0xFFFFFFFF, e1kRegRead82574        , e1kRegWrite82574        , "TARC1"   , "Transmit Arbitration Count 1 (82574)" },
+    { 0x05008, 0x00004, 0xFFFFFFFF, 0xFFFFFFFF, e1kRegRead82574        , e1kRegWrite82574        , "RFCTL"   , "Receive Filter Control (82574)" },
+    { 0x05818, 0x00004, 0x003F0003, 0x003F0003, e1kRegRead82574        , e1kRegWrite82574        , "MRQC"    , "Multiple Receive Queues Command (82574)" },
+    { 0x05b50, 0x00004, 0xFFFFFFFF, 0xFFFFFFFF, e1kRegRead82574        , e1kRegWrite82574        , "SWSM"    , "Software Semaphore (82574)" },
+    { 0x05c00, 0x00080, 0xFFFFFFFF, 0xFFFFFFFF, e1kRegRead82574        , e1kRegWrite82574        , "RETA"    , "Redirection Table (82574)" },
+    { 0x05c80, 0x00028, 0xFFFFFFFF, 0xFFFFFFFF, e1kRegRead82574        , e1kRegWrite82574        , "RSSRK"   , "RSS Random Key (82574)" }
 };
 
 #ifdef LOG_ENABLED
@@ -1644,6 +1817,26 @@ static void e1kHardReset(PE1KSTATE pThis)
     TSPMT  = 0x01000400;/* TSMT=0400h TSPBP=0100h */
     Assert(GET_BITS(RCTL, BSIZE) == 0);
     pThis->u16RxBSize = 2048;
+    if (pThis->eChip == E1K_CHIP_82574L)
+        EECD |= EECD_AUTO_RD; /* e1000e waits for the NVM auto-read to complete */
+
+    /* 82574L registers */
+    RT_ZERO(pThis->RxRing1);
+    RT_ZERO(pThis->TxRing1);
+    pThis->uRXDCTL1     = 0;
+    pThis->uTXDCTL1     = 0;
+    RT_ZERO(pThis->auTARC);
+    pThis->uEIAC        = 0;
+    pThis->uIAM         = 0;
+    pThis->uIVAR        = 0;
+    RT_ZERO(pThis->auEITR);
+    pThis->uEXTCNF_CTRL = 0;
+    pThis->uSWSM        = 0;
+    pThis->uRFCTL       = 0;
+    pThis->uMRQC        = 0;
+    RT_ZERO(pThis->auRETA);
+    RT_ZERO(pThis->auRSSRK);
+    pThis->fMsixDeferred = 0;
 
     /* Reset promiscuous mode */
     if (pThis->pDrvR3)
@@ -1657,13 +1850,16 @@ static void e1kHardReset(PE1KSTATE pThis)
         pThis->iTxDCurrent  = 0;
         pThis->fGSO         = false;
         pThis->cbTxAlloc    = 0;
+        pThis->iTxQ         = 0;
+        RT_ZERO(pThis->aTxQCtx);
         e1kCsTxLeave(pThis);
     }
 #endif /* E1K_WITH_TXD_CACHE */
 #ifdef E1K_WITH_RXD_CACHE
     if (RT_LIKELY(e1kCsRxEnter(pThis, VERR_SEM_BUSY) == VINF_SUCCESS))
     {
-        pThis->iRxDCurrent = pThis->nRxDFetched = 0;
+        for (unsigned iQ = 0; iQ < E1K_MAX_QUEUES; iQ++)
+            pThis->aRxQ[iQ].iRxDCurrent = pThis->aRxQ[iQ].nRxDFetched = 0;
         e1kCsRxLeave(pThis);
     }
 #endif /* E1K_WITH_RXD_CACHE */
@@ -1687,6 +1883,10 @@ static void e1kHardReset(PE1KSTATE pThis)
  */
 static uint16_t e1kCSum16(const void *pvBuf, size_t cb)
 {
+#ifndef IN_RC
+    bool fOdd = false;
+    return RTNetIPv4FinalizeChecksum(RTNetIPv4AddDataChecksum(pvBuf, cb, 0, &fOdd));
+#else
     uint32_t  csum = 0;
     uint16_t *pu16 = (uint16_t *)pvBuf;
 
@@ -1700,6 +1900,7 @@ static uint16_t e1kCSum16(const void *pvBuf, size_t cb)
     while (csum >> 16)
         csum = (csum >> 16) + (csum & 0xFFFF);
     return ~csum;
+#endif
 }
 
 /**
@@ -1903,6 +2104,93 @@ inline void e1kPostponeInterrupt(PE1KSTATE pThis, uint64_t uNanoseconds)
         TMTimerSetNano(pThis->CTX_SUFF(pIntTimer), uNanoseconds);
 }
 
+/**
+ * Check if the guest has enabled MSI-X (82574L only).
+ *
+ * @returns true if interrupts are to be delivered via MSI-X vectors.
+ * @param   pThis       The device state structure.
+ */
+DECLINLINE(bool) e1kMsixEnabled(PE1KSTATE pThis)
+{
+    return pThis->offMsixCap
+        && (PCIDevGetWord(&pThis->pciDevice, pThis->offMsixCap + VBOX_MSIX_CAP_MESSAGE_CONTROL) & VBOX_PCI_MSIX_FLAGS_ENABLE);
+}
+
+/**
+ * Raise MSI-X interrupts for the unmasked causes (82574L only).
+ *
+ * Causes are mapped to vectors via IVAR. RXQ0, RXQ1, TXQ0 and TXQ1 have
+ * dedicated allocation fields, everything else is reported via OTHER. Each
+ * vector is throttled by its own EITR register; the vectors that are too
+ * early to fire are remembered and fired by the late interrupt timer. Unlike
+ * ITR, EITR is always honored as only MSI-X aware drivers program it.
+ *
+ * @param   pThis       The device state structure.
+ * @param   u32IntCause The new causes, 0 to re-evaluate all pending causes.
+ * @remarks Must be called in the device critical section.
+ */
+static void e1kMsixRaise(PE1KSTATE pThis, uint32_t u32IntCause)
+{
+    /* Causes raised without a queue (delay timers, RDTR flush) belong to the first rings. */
+    if ((u32IntCause & ICR_RXT0) && !(u32IntCause & (ICR_RXQ0 | ICR_RXQ1)))
+        u32IntCause |= ICR_RXQ0;
+    if ((u32IntCause & ICR_TXDW) && !(u32IntCause & (ICR_TXQ0 | ICR_TXQ1)))
+        u32IntCause |= ICR_TXQ0;
+    ICR |= u32IntCause;
+    if (u32IntCause & IMS & ~(ICR_MSIX_CAUSES | ICR_RXT0 | ICR_TXDW))
+    {
+        ICR |= ICR_OTHER;
+        u32IntCause |= ICR_OTHER;
+    }
+    uint32_t fCauses  = (u32IntCause ? u32IntCause : ICR) & ICR & IMS & ICR_MSIX_CAUSES;
+    uint32_t fVectors = pThis->fMsixDeferred;
+    int      aiVector[IVAR_FIELD_OTHER + 1];
+    pThis->fMsixDeferred = 0;
+
+    for (unsigned iField = 0; iField <= IVAR_FIELD_OTHER; iField++)
+    {
+        uint32_t uAlloc = (pThis->uIVAR >> (iField * 4)) & 0xF;
+        aiVector[iField] = (uAlloc & IVAR_VALID) ? (int)(uAlloc & IVAR_VECTOR_MASK) : -1;
+        if ((fCauses & (ICR_RXQ0 << iField)) && aiVector[iField] >= 0)
+            fVectors |= RT_BIT_32(aiVector[iField]);
+    }
+
+    uint64_t tsNow  = TMTimerGet(pThis->CTX_SUFF(pIntTimer));
+    uint32_t fFired = 0;
+    for (unsigned iVector = 0; iVector < E1K_MSIX_VECTORS; iVector++)
+    {
+        if (!(fVectors & RT_BIT_32(iVector)))
+            continue;
+        uint64_t cNsInterval = (uint64_t)(pThis->auEITR[iVector] & 0xFFFF) * 256;
+        uint64_t cNsElapsed  = tsNow - pThis->au64VectorFiredAt[iVector];
+        if (cNsElapsed < cNsInterval)
+        {
+            E1K_INC_ISTAT_CNT(pThis->uStatIntEarly);
+            E1kLog2(("%s e1kMsixRaise: Too early to fire vector %u: %RU64 ns < %RU64 ns.\n",
+                     pThis->szPrf, iVector, cNsElapsed, cNsInterval));
+            pThis->fMsixDeferred |= RT_BIT_32(iVector);
+            e1kPostponeInterrupt(pThis, cNsInterval - cNsElapsed);
+            continue;
+        }
+        pThis->au64VectorFiredAt[iVector] = tsNow;
+        fFired |= RT_BIT_32(iVector);
+        E1K_INC_ISTAT_CNT(pThis->uStatInt);
+        STAM_COUNTER_INC(&pThis->StatIntsRaised);
+        /* Raise(1) the vector, MSI-X is edge-triggered. */
+        PDMDevHlpPCISetIrq(pThis->CTX_SUFF(pDevIns), iVector, 1);
+        E1kLog(("%s e1kMsixRaise: Fired vector %u, ICR&IMS=%08x\n", pThis->szPrf, iVector, ICR & IMS));
+    }
+
+    /* Auto-clear (EIAC) and auto-mask (IAM) the causes that have been signalled. */
+    uint32_t fSignalled = 0;
+    for (unsigned iField = 0; iField <= IVAR_FIELD_OTHER; iField++)
+        if (aiVector[iField] >= 0 && (fFired & RT_BIT_32(aiVector[iField])))
+            fSignalled |= fCauses & (ICR_RXQ0 << iField);
+    ICR &= ~(pThis->uEIAC & fSignalled);
+    if (CTRL_EXT & CTRL_EXT_EIAME)
+        IMS &= ~(pThis->uIAM & fSignalled);
+}
+
 /**
  * Raise interrupt if not masked.
  *
@@ -1915,7 +2203,14 @@ static int e1kRaiseInterrupt(PE1KSTATE pThis, int rcBusy, uint32_t u32IntCause =
         return rc;
 
     E1K_INC_ISTAT_CNT(pThis->uStatIntTry);
-    ICR |= u32IntCause;
+    if (e1kMsixEnabled(pThis))
+    {
+        e1kMsixRaise(pThis, u32IntCause);
+        e1kCsLeave(pThis);
+        return VINF_SUCCESS;
+    }
+    /* The per-queue causes are only reported in MSI-X mode. */
+    ICR |= u32IntCause & ~ICR_MSIX_CAUSES;
     if (ICR & IMS)
     {
         if (pThis->fIntRaised)
@@ -1935,6 +2230,21 @@ static int e1kRaiseInterrupt(PE1KSTATE pThis, int rcBusy, uint32_t u32IntCause =
                         pThis->szPrf, (uint32_t)(tsNow - pThis->u64AckedAt), ITR * 256));
                 e1kPostponeInterrupt(pThis, ITR * 256);
             }
+            else if (   pThis->cNsRxIntCoalescing
+                     && !(ICR & IMS & ~(ICR_RXT0 | ICR_RXDMT0))
+                     && tsNow - pThis->u64AckedAt < pThis->cNsRxIntCoalescing)
+            {
+                /*
+                 * Only receive causes are pending and the guest has just
+                 * handled the previous interrupt: let more frames accumulate
+                 * so a burst costs the guest one interrupt instead of one
+                 * per frame.
+                 */
+                STAM_COUNTER_INC(&pThis->StatIntsRxCoalesced);
+                E1kLog2(("%s e1kRaiseInterrupt: Coalescing RX interrupt: %d ns < %d ns.\n",
+                        pThis->szPrf, (uint32_t)(tsNow - pThis->u64AckedAt), pThis->cNsRxIntCoalescing));
+                e1kPostponeInterrupt(pThis, pThis->cNsRxIntCoalescing - (tsNow - pThis->u64AckedAt));
+            }
             else
             {
 
@@ -1979,6 +2289,32 @@ DECLINLINE(RTGCPHYS) e1kDescAddr(uint32_t baseHigh, uint32_t baseLow, uint32_t i
     return ((uint64_t)baseHigh << 32) + baseLow + idxDesc * sizeof(E1KRXDESC);
 }
 
+/**
+ * Get the registers of a receive descriptor ring.
+ *
+ * @returns Pointer to RDBAL..RDT of the ring.
+ * @param   pThis       The device state structure.
+ * @param   iQ          The ring index, 1 is only used by 82574L.
+ */
+DECLINLINE(PE1KRINGREGS) e1kRxRing(PE1KSTATE pThis, unsigned iQ)
+{
+    Assert(iQ < E1K_MAX_QUEUES);
+    return iQ ? &pThis->RxRing1 : (PE1KRINGREGS)&pThis->auRegs[RDBAL_IDX];
+}
+
+/**
+ * Get the registers of a transmit descriptor ring.
+ *
+ * @returns Pointer to TDBAL..TDT of the ring.
+ * @param   pThis       The device state structure.
+ * @param   iQ          The ring index, 1 is only used by 82574L.
+ */
+DECLINLINE(PE1KRINGREGS) e1kTxRing(PE1KSTATE pThis, unsigned iQ)
+{
+    Assert(iQ < E1K_MAX_QUEUES);
+    return iQ ? &pThis->TxRing1 : (PE1KRINGREGS)&pThis->auRegs[TDBAL_IDX];
+}
+
 #ifdef IN_RING3 /* currently only used in ring-3 due to stack space requirements of the caller */
 /**
  * Advance the head pointer of the receive descriptor queue.
@@ -1986,18 +2322,20 @@ DECLINLINE(RTGCPHYS) e1kDescAddr(uint32_t baseHigh, uint32_t baseLow, uint32_t i
  * @remarks RDH always points to the next available RX descriptor.
  *
  * @param   pThis       The device state structure.
+ * @param   iQ          The receive ring.
  */
-DECLINLINE(void) e1kAdvanceRDH(PE1KSTATE pThis)
+DECLINLINE(void) e1kAdvanceRDH(PE1KSTATE pThis, unsigned iQ)
 {
     Assert(e1kCsRxIsOwner(pThis));
+    PE1KRINGREGS pRing = e1kRxRing(pThis, iQ);
     //e1kCsEnter(pThis, RT_SRC_POS);
-    if (++RDH * sizeof(E1KRXDESC) >= RDLEN)
-        RDH = 0;
+    if (++pRing->uH * sizeof(E1KRXDESC) >= pRing->uLEN)
+        pRing->uH = 0;
     /*
      * Compute current receive queue length and fire RXDMT0 interrupt
      * if we are low on receive buffers
      */
-    uint32_t uRQueueLen = RDH>RDT ? RDLEN/sizeof(E1KRXDESC)-RDH+RDT : RDT-RDH;
+    uint32_t uRQueueLen = pRing->uH > pRing->uT ? pRing->uLEN/sizeof(E1KRXDESC) - pRing->uH + pRing->uT : pRing->uT - pRing->uH;
     /*
      * The minimum threshold is controlled by RDMTS bits of RCTL:
      * 00 = 1/2 of RDLEN
@@ -2005,17 +2343,17 @@ DECLINLINE(void) e1kAdvanceRDH(PE1KSTATE pThis)
      * 10 = 1/8 of RDLEN
      * 11 = reserved
      */
-    uint32_t uMinRQThreshold = RDLEN / sizeof(E1KRXDESC) / (2 << GET_BITS(RCTL, RDMTS));
+    uint32_t uMinRQThreshold = pRing->uLEN / sizeof(E1KRXDESC) / (2 << GET_BITS(RCTL, RDMTS));
     if (uRQueueLen <= uMinRQThreshold)
     {
-        E1kLogRel(("E1000: low on RX descriptors, RDH=%x RDT=%x len=%x threshold=%x\n", RDH, RDT, uRQueueLen, uMinRQThreshold));
-        E1kLog2(("%s Low on RX descriptors, RDH=%x RDT=%x len=%x threshold=%x, raise an interrupt\n",
-                 pThis->szPrf, RDH, RDT, uRQueueLen, uMinRQThreshold));
+        E1kLogRel(("E1000: low on RX descriptors, RDH%u=%x RDT%u=%x len=%x threshold=%x\n", iQ, pRing->uH, iQ, pRing->uT, uRQueueLen, uMinRQThreshold));
+        E1kLog2(("%s Low on RX descriptors, RDH%u=%x RDT%u=%x len=%x threshold=%x, raise an interrupt\n",
+                 pThis->szPrf, iQ, pRing->uH, iQ, pRing->uT, uRQueueLen, uMinRQThreshold));
         E1K_INC_ISTAT_CNT(pThis->uStatIntRXDMT0);
         e1kRaiseInterrupt(pThis, VERR_SEM_BUSY, ICR_RXDMT0);
     }
-    E1kLog2(("%s e1kAdvanceRDH: at exit RDH=%x RDT=%x len=%x\n",
-             pThis->szPrf, RDH, RDT, uRQueueLen));
+    E1kLog2(("%s e1kAdvanceRDH: at exit RDH%u=%x RDT%u=%x len=%x\n",
+             pThis->szPrf, iQ, pRing->uH, iQ, pRing->uT, uRQueueLen));
     //e1kCsLeave(pThis);
 }
 #endif /* IN_RING3 */
@@ -2027,27 +2365,29 @@ DECLINLINE(void) e1kAdvanceRDH(PE1KSTATE pThis)
  *
  * @returns the number of available descriptors in RX ring.
  * @param   pThis       The device state structure.
+ * @param   iQ          The receive ring.
  * @thread  ???
  */
-DECLINLINE(uint32_t) e1kGetRxLen(PE1KSTATE pThis)
+DECLINLINE(uint32_t) e1kGetRxLen(PE1KSTATE pThis, unsigned iQ)
 {
+    PE1KRINGREGS pRing = e1kRxRing(pThis, iQ);
     /**
      *  Make sure RDT won't change during computation. EMT may modify RDT at
      *  any moment.
      */
-    uint32_t rdt = RDT;
-    return (RDH > rdt ? RDLEN/sizeof(E1KRXDESC) : 0) + rdt - RDH;
+    uint32_t rdt = pRing->uT;
+    return (pRing->uH > rdt ? pRing->uLEN/sizeof(E1KRXDESC) : 0) + rdt - pRing->uH;
 }
 
-DECLINLINE(unsigned) e1kRxDInCache(PE1KSTATE pThis)
+DECLINLINE(unsigned) e1kRxDInCache(PE1KSTATE pThis, unsigned iQ)
 {
-    return pThis->nRxDFetched > pThis->iRxDCurrent ?
-        pThis->nRxDFetched - pThis->iRxDCurrent : 0;
+    return pThis->aRxQ[iQ].nRxDFetched > pThis->aRxQ[iQ].iRxDCurrent ?
+        pThis->aRxQ[iQ].nRxDFetched - pThis->aRxQ[iQ].iRxDCurrent : 0;
 }
 
-DECLINLINE(unsigned) e1kRxDIsCacheEmpty(PE1KSTATE pThis)
+DECLINLINE(unsigned) e1kRxDIsCacheEmpty(PE1KSTATE pThis, unsigned iQ)
 {
-    return pThis->iRxDCurrent >= pThis->nRxDFetched;
+    return pThis->aRxQ[iQ].iRxDCurrent >= pThis->aRxQ[iQ].nRxDFetched;
 }
 
 /**
@@ -2059,20 +2399,21 @@ DECLINLINE(unsigned) e1kRxDIsCacheEmpty(PE1KSTATE pThis)
  *
  * @returns the actual number of descriptors fetched.
  * @param   pThis       The device state structure.
- * @param   pDesc       Pointer to descriptor union.
- * @param   addr        Physical address in guest context.
+ * @param   iQ          The receive ring.
  * @thread  EMT, RX
  */
-DECLINLINE(unsigned) e1kRxDPrefetch(PE1KSTATE pThis)
+DECLINLINE(unsigned) e1kRxDPrefetch(PE1KSTATE pThis, unsigned iQ)
 {
-    /* We've already loaded pThis->nRxDFetched descriptors past RDH. */
-    unsigned nDescsAvailable    = e1kGetRxLen(pThis) - e1kRxDInCache(pThis);
-    unsigned nDescsToFetch      = RT_MIN(nDescsAvailable, E1K_RXD_CACHE_SIZE - pThis->nRxDFetched);
-    unsigned nDescsTotal        = RDLEN / sizeof(E1KRXDESC);
+    PE1KRINGREGS pRing = e1kRxRing(pThis, iQ);
+    struct E1kState_st::E1KRXQ *pRxQ = &pThis->aRxQ[iQ];
+    /* We've already loaded pRxQ->nRxDFetched descriptors past RDH. */
+    unsigned nDescsAvailable    = e1kGetRxLen(pThis, iQ) - e1kRxDInCache(pThis, iQ);
+    unsigned nDescsToFetch      = RT_MIN(nDescsAvailable, E1K_RXD_CACHE_SIZE - pRxQ->nRxDFetched);
+    unsigned nDescsTotal        = pRing->uLEN / sizeof(E1KRXDESC);
     Assert(nDescsTotal != 0);
     if (nDescsTotal == 0)
         return 0;
-    unsigned nFirstNotLoaded    = (RDH + e1kRxDInCache(pThis)) % nDescsTotal;
+    unsigned nFirstNotLoaded    = (pRing->uH + e1kRxDInCache(pThis, iQ)) % nDescsTotal;
     unsigned nDescsInSingleRead = RT_MIN(nDescsToFetch, nDescsTotal - nFirstNotLoaded);
     E1kLog3(("%s e1kRxDPrefetch: nDescsAvailable=%u nDescsToFetch=%u "
              "nDescsTotal=%u nFirstNotLoaded=0x%x nDescsInSingleRead=%u\n",
@@ -2080,9 +2421,9 @@ DECLINLINE(unsigned) e1kRxDPrefetch(PE1KSTATE pThis)
              nFirstNotLoaded, nDescsInSingleRead));
     if (nDescsToFetch == 0)
         return 0;
-    E1KRXDESC* pFirstEmptyDesc = &pThis->aRxDescriptors[pThis->nRxDFetched];
+    E1KRXDESC* pFirstEmptyDesc = &pRxQ->aRxDescriptors[pRxQ->nRxDFetched];
     PDMDevHlpPhysRead(pThis->CTX_SUFF(pDevIns),
-                      ((uint64_t)RDBAH << 32) + RDBAL + nFirstNotLoaded * sizeof(E1KRXDESC),
+                      ((uint64_t)pRing->uBAH << 32) + pRing->uBAL + nFirstNotLoaded * sizeof(E1KRXDESC),
                       pFirstEmptyDesc, nDescsInSingleRead * sizeof(E1KRXDESC));
     // uint64_t addrBase = ((uint64_t)RDBAH << 32) + RDBAL;
     // unsigned i, j;
@@ -2091,17 +2432,17 @@ DECLINLINE(unsigned) e1kRxDPrefetch(PE1KSTATE pThis)
     //     pThis->aRxDescAddr[i] = addrBase + (nFirstNotLoaded + i - pThis->nRxDFetched) * sizeof(E1KRXDESC);
     //     E1kLog3(("%s aRxDescAddr[%d] = %p\n", pThis->szPrf, i, pThis->aRxDescAddr[i]));
     // }
-    E1kLog3(("%s Fetched %u RX descriptors at %08x%08x(0x%x), RDLEN=%08x, RDH=%08x, RDT=%08x\n",
+    E1kLog3(("%s Fetched %u RX descriptors at %08x%08x(0x%x), RDLEN%u=%08x, RDH=%08x, RDT=%08x\n",
              pThis->szPrf, nDescsInSingleRead,
-             RDBAH, RDBAL + RDH * sizeof(E1KRXDESC),
-             nFirstNotLoaded, RDLEN, RDH, RDT));
+             pRing->uBAH, pRing->uBAL + pRing->uH * sizeof(E1KRXDESC),
+             nFirstNotLoaded, iQ, pRing->uLEN, pRing->uH, pRing->uT));
     if (nDescsToFetch > nDescsInSingleRead)
     {
         PDMDevHlpPhysRead(pThis->CTX_SUFF(pDevIns),
-                          ((uint64_t)RDBAH << 32) + RDBAL,
+                          ((uint64_t)pRing->uBAH << 32) + pRing->uBAL,
                           pFirstEmptyDesc + nDescsInSingleRead,
                           (nDescsToFetch - nDescsInSingleRead) * sizeof(E1KRXDESC));
-        // Assert(i == pThis->nRxDFetched  + nDescsInSingleRead);
+        // Assert(i == pRxQ->nRxDFetched  + nDescsInSingleRead);
         // for (j = 0; i < pThis->nRxDFetched + nDescsToFetch; ++i, ++j)
         // {
         //     pThis->aRxDescAddr[i] = addrBase + j * sizeof(E1KRXDESC);
@@ -2109,9 +2450,9 @@ DECLINLINE(unsigned) e1kRxDPrefetch(PE1KSTATE pThis)
         // }
         E1kLog3(("%s Fetched %u RX descriptors at %08x%08x\n",
                  pThis->szPrf, nDescsToFetch - nDescsInSingleRead,
-                 RDBAH, RDBAL));
+                 pRing->uBAH, pRing->uBAL));
     }
-    pThis->nRxDFetched += nDescsToFetch;
+    pRxQ->nRxDFetched += nDescsToFetch;
     return nDescsToFetch;
 }
 
@@ -2126,18 +2467,20 @@ DECLINLINE(unsigned) e1kRxDPrefetch(PE1KSTATE pThis)
  * cache is empty to do pre-fetch @bugref(6217).
  *
  * @param   pThis       The device state structure.
+ * @param   iQ          The receive ring.
  * @thread  RX
  */
-DECLINLINE(E1KRXDESC*) e1kRxDGet(PE1KSTATE pThis)
+DECLINLINE(E1KRXDESC*) e1kRxDGet(PE1KSTATE pThis, unsigned iQ)
 {
     Assert(e1kCsRxIsOwner(pThis));
+    struct E1kState_st::E1KRXQ *pRxQ = &pThis->aRxQ[iQ];
     /* Check the cache first. */
-    if (pThis->iRxDCurrent < pThis->nRxDFetched)
-        return &pThis->aRxDescriptors[pThis->iRxDCurrent];
+    if (pRxQ->iRxDCurrent < pRxQ->nRxDFetched)
+        return &pRxQ->aRxDescriptors[pRxQ->iRxDCurrent];
     /* Cache is empty, reset it and check if we can fetch more. */
-    pThis->iRxDCurrent = pThis->nRxDFetched = 0;
-    if (e1kRxDPrefetch(pThis))
-        return &pThis->aRxDescriptors[pThis->iRxDCurrent];
+    pRxQ->iRxDCurrent = pRxQ->nRxDFetched = 0;
+    if (e1kRxDPrefetch(pThis, iQ))
+        return &pRxQ->aRxDescriptors[pRxQ->iRxDCurrent];
     /* Out of Rx descriptors. */
     return NULL;
 }
@@ -2147,23 +2490,44 @@ DECLINLINE(E1KRXDESC*) e1kRxDGet(PE1KSTATE pThis)
  * Return the RX descriptor obtained with e1kRxDGet() and advance the cache
  * pointer. The descriptor gets written back to the RXD ring.
  *
+ * With RFCTL.EXSTEN set (82574L) the descriptor is written back in the
+ * extended format which carries the RSS hash and type along with the queue.
+ *
  * @param   pThis       The device state structure.
+ * @param   iQ          The receive ring.
  * @param   pDesc       The descriptor being "returned" to the RX ring.
  * @thread  RX
  */
-DECLINLINE(void) e1kRxDPut(PE1KSTATE pThis, E1KRXDESC* pDesc)
+DECLINLINE(void) e1kRxDPut(PE1KSTATE pThis, unsigned iQ, E1KRXDESC* pDesc)
 {
     Assert(e1kCsRxIsOwner(pThis));
-    pThis->iRxDCurrent++;
+    PE1KRINGREGS pRing = e1kRxRing(pThis, iQ);
+    pThis->aRxQ[iQ].iRxDCurrent++;
     // Assert(pDesc >= pThis->aRxDescriptors);
     // Assert(pDesc < pThis->aRxDescriptors + E1K_RXD_CACHE_SIZE);
     // uint64_t addr = e1kDescAddr(RDBAH, RDBAL, RDH);
     // uint32_t rdh = RDH;
     // Assert(pThis->aRxDescAddr[pDesc - pThis->aRxDescriptors] == addr);
-    PDMDevHlpPCIPhysWrite(pThis->CTX_SUFF(pDevIns),
-                          e1kDescAddr(RDBAH, RDBAL, RDH),
-                          pDesc, sizeof(E1KRXDESC));
-    e1kAdvanceRDH(pThis);
+    if (pThis->uRFCTL & RFCTL_EXSTEN)
+    {
+        uint32_t aExt[4];
+        uint32_t u32Status;
+        AssertCompile(sizeof(aExt) == sizeof(E1KRXDESC));
+        AssertCompile(sizeof(u32Status) == sizeof(pDesc->status));
+        memcpy(&u32Status, &pDesc->status, sizeof(u32Status));
+        aExt[0] = pThis->uRxRssType | (iQ << 8);
+        aExt[1] = (RXCSUM & RXCSUM_PCSD) ? pThis->uRxRssHash : (uint32_t)pDesc->u16Checksum << 16;
+        aExt[2] = (u32Status & 0xFF) | ((u32Status & 0xFF00) << 16);
+        aExt[3] = pDesc->u16Length | (u32Status & 0xFFFF0000);
+        PDMDevHlpPCIPhysWrite(pThis->CTX_SUFF(pDevIns),
+                              e1kDescAddr(pRing->uBAH, pRing->uBAL, pRing->uH),
+                              aExt, sizeof(aExt));
+    }
+    else
+        PDMDevHlpPCIPhysWrite(pThis->CTX_SUFF(pDevIns),
+                              e1kDescAddr(pRing->uBAH, pRing->uBAL, pRing->uH),
+                              pDesc, sizeof(E1KRXDESC));
+    e1kAdvanceRDH(pThis, iQ);
     e1kPrintRDesc(pThis, pDesc);
 }
 
@@ -2211,7 +2575,7 @@ static DECLCALLBACK(void) e1kStoreRxFragment(PE1KSTATE pThis, E1KRXDESC *pDesc,
     e1kPrintRDesc(pThis, pDesc);
     E1kLogRel(("E1000: Wrote back RX desc, RDH=%x\n", RDH));
     /* Advance head */
-    e1kAdvanceRDH(pThis);
+    e1kAdvanceRDH(pThis, 0);
     //E1kLog2(("%s e1kStoreRxFragment: EOP=%d RDTR=%08X RADV=%08X\n", pThis->szPrf, pDesc->fEOP, RDTR, RADV));
     if (pDesc->status.fEOP)
     {
@@ -2317,6 +2681,123 @@ static int e1kRxChecksumOffload(PE1KSTATE pThis, const uint8_t *pFrame, size_t c
 }
 #endif /* IN_RING3 */
 
+#ifdef IN_RING3
+/**
+ * Compute Toeplitz hash of the RSS input using the key in RSSRK.
+ *
+ * @returns The 32-bit hash.
+ * @param   pThis       The device state structure.
+ * @param   pbInput     The addresses and ports in network byte order.
+ * @param   cbInput     The size of the input, 36 bytes at most.
+ */
+static uint32_t e1kRssToeplitzHash(PE1KSTATE pThis, const uint8_t *pbInput, size_t cbInput)
+{
+    uint8_t abKey[sizeof(pThis->auRSSRK)];
+    for (unsigned i = 0; i < sizeof(abKey); i++)
+        abKey[i] = (uint8_t)(pThis->auRSSRK[i / 4] >> (8 * (i % 4)));
+    Assert(cbInput + 4 <= sizeof(abKey));
+
+    uint32_t uHash   = 0;
+    uint32_t uWindow = RT_MAKE_U32_FROM_U8(abKey[3], abKey[2], abKey[1], abKey[0]);
+    for (size_t i = 0; i < cbInput; i++)
+        for (int iBit = 7; iBit >= 0; iBit--)
+        {
+            if (pbInput[i] & RT_BIT(iBit))
+                uHash ^= uWindow;
+            uWindow = (uWindow << 1) | ((abKey[i + 4] >> iBit) & 1);
+        }
+    return uHash;
+}
+
+/**
+ * Select the receive ring for a frame (82574L only).
+ *
+ * Hashes IPv4/IPv6 addresses (and TCP ports) of the frame according to MRQC
+ * and looks the hash up in the redirection table. The hash and its type are
+ * stored in the device state to be written back into extended descriptors.
+ *
+ * @returns The receive ring index.
+ * @param   pThis       The device state structure.
+ * @param   pbFrame     The frame.
+ * @param   cb          The size of the frame.
+ */
+static unsigned e1kRssSelectQueue(PE1KSTATE pThis, const uint8_t *pbFrame, size_t cb)
+{
+    pThis->uRxRssHash = 0;
+    pThis->uRxRssType = E1K_RSS_TYPE_NONE;
+    if (pThis->eChip != E1K_CHIP_82574L || (pThis->uMRQC & MRQC_ENABLE_MASK) != MRQC_ENABLE_RSS || cb < 14)
+        return 0;
+
+    size_t   off        = 12;
+    uint16_t uEtherType = RT_MAKE_U16(pbFrame[off + 1], pbFrame[off]);
+    if (uEtherType == RTNET_ETHERTYPE_VLAN && cb >= 18)
+    {
+        off += 4;
+        uEtherType = RT_MAKE_U16(pbFrame[off + 1], pbFrame[off]);
+    }
+    off += 2;
+
+    uint8_t  abInput[36];
+    size_t   cbInput;
+    uint32_t uType;
+    const uint8_t *pbIp = pbFrame + off;
+    if (uEtherType == RTNET_ETHERTYPE_IPV4 && (pThis->uMRQC & (MRQC_RSS_TCPIPV4 | MRQC_RSS_IPV4)))
+    {
+        size_t cbIpHdr = (pbIp[0] & 0xF) * 4;
+        if (cb < off + 20 || (pbIp[0] >> 4) != 4 || cbIpHdr < 20 || cb < off + cbIpHdr)
+            return 0;
+        memcpy(abInput, pbIp + 12, 8);
+        bool fFragment = (RT_MAKE_U16(pbIp[7], pbIp[6]) & 0x3FFF) != 0;
+        if (   pbIp[9] == RTNETIPV4_PROT_TCP && !fFragment && (pThis->uMRQC & MRQC_RSS_TCPIPV4)
+            && cb >= off + cbIpHdr + 4)
+        {
+            memcpy(abInput + 8, pbIp + cbIpHdr, 4);
+            cbInput = 12;
+            uType   = E1K_RSS_TYPE_TCPIPV4;
+        }
+        else if (pThis->uMRQC & MRQC_RSS_IPV4)
+        {
+            cbInput = 8;
+            uType   = E1K_RSS_TYPE_IPV4;
+        }
+        else
+            return 0;
+    }
+    else if (uEtherType == RTNET_ETHERTYPE_IPV6 && (pThis->uMRQC & (MRQC_RSS_TCPIPV6 | MRQC_RSS_IPV6)))
+    {
+        if (cb < off + 40 || (pbIp[0] >> 4) != 6)
+            return 0;
+        memcpy(abInput, pbIp + 8, 32);
+        /* Extension headers are not parsed, such packets are hashed by addresses only. */
+        if (pbIp[6] == RTNETIPV4_PROT_TCP && (pThis->uMRQC & MRQC_RSS_TCPIPV6) && cb >= off + 44)
+        {
+            memcpy(abInput + 32, pbIp + 40, 4);
+            cbInput = 36;
+            uType   = E1K_RSS_TYPE_TCPIPV6;
+        }
+        else if (pThis->uMRQC & MRQC_RSS_IPV6)
+        {
+            cbInput = 32;
+            uType   = E1K_RSS_TYPE_IPV6;
+        }
+        else
+            return 0;
+    }
+    else
+        return 0;
+
+    uint32_t uHash  = e1kRssToeplitzHash(pThis, abInput, cbInput);
+    uint8_t  bEntry = (uint8_t)(pThis->auRETA[(uHash & 0x7F) / 4] >> (8 * (uHash & 3)));
+    unsigned iQ     = bEntry >> 7;
+    if (iQ && !pThis->RxRing1.uLEN)
+        iQ = 0;
+    pThis->uRxRssHash = uHash;
+    pThis->uRxRssType = uType;
+    E1kLog3(("%s e1kRssSelectQueue: type=%u hash=%08x queue=%u\n", pThis->szPrf, uType, uHash, iQ));
+    return iQ;
+}
+#endif /* IN_RING3 */
+
 /**
  * Pad and store received packet.
  *
@@ -2413,15 +2894,17 @@ static int e1kHandleRxPacket(PE1KSTATE pThis, const void *pvBuf, size_t cb, E1KR
     E1K_INC_ISTAT_CNT(pThis->uStatRxFrm);
 
 # ifdef E1K_WITH_RXD_CACHE
+    unsigned iQ = e1kRssSelectQueue(pThis, rxPacket, cb);
     while (cb > 0)
     {
-        E1KRXDESC *pDesc = e1kRxDGet(pThis);
+        E1KRXDESC *pDesc = e1kRxDGet(pThis, iQ);
 
         if (pDesc == NULL)
         {
             E1kLog(("%s Out of receive buffers, dropping the packet "
-                    "(cb=%u, in_cache=%u, RDH=%x RDT=%x)\n",
-                    pThis->szPrf, cb, e1kRxDInCache(pThis), RDH, RDT));
+                    "(cb=%u, queue=%u, in_cache=%u, RDH=%x RDT=%x)\n",
+                    pThis->szPrf, cb, iQ, e1kRxDInCache(pThis, iQ),
+                    e1kRxRing(pThis, iQ)->uH, e1kRxRing(pThis, iQ)->uT));
             break;
         }
 # else /* !E1K_WITH_RXD_CACHE */
@@ -2487,7 +2970,7 @@ static int e1kHandleRxPacket(PE1KSTATE pThis, const void *pvBuf, size_t cb, E1KR
 # ifdef E1K_WITH_RXD_CACHE
         /* Write back the descriptor. */
         pDesc->status.fDD = true;
-        e1kRxDPut(pThis, pDesc);
+        e1kRxDPut(pThis, iQ, pDesc);
 # else /* !E1K_WITH_RXD_CACHE */
         else
         {
@@ -2496,7 +2979,7 @@ static int e1kHandleRxPacket(PE1KSTATE pThis, const void *pvBuf, size_t cb, E1KR
             PDMDevHlpPCIPhysWrite(pThis->CTX_SUFF(pDevIns),
                                   e1kDescAddr(RDBAH, RDBAL, RDH),
                                   pDesc, sizeof(E1KRXDESC));
-            e1kAdvanceRDH(pThis);
+            e1kAdvanceRDH(pThis, 0);
         }
 # endif /* !E1K_WITH_RXD_CACHE */
     }
@@ -2523,7 +3006,7 @@ static int e1kHandleRxPacket(PE1KSTATE pThis, const void *pvBuf, size_t cb, E1KR
 #  endif /* E1K_USE_RX_TIMERS */
         /* 0 delay means immediate interrupt */
         E1K_INC_ISTAT_CNT(pThis->uStatIntRx);
-        e1kRaiseInterrupt(pThis, VERR_SEM_BUSY, ICR_RXT0);
+        e1kRaiseInterrupt(pThis, VERR_SEM_BUSY, ICR_RXT0 | (ICR_RXQ0 << iQ));
 #  ifdef E1K_USE_RX_TIMERS
     }
 #  endif /* E1K_USE_RX_TIMERS */
@@ -2819,6 +3302,21 @@ static int e1kRegReadEECD(PE1KSTATE pThis, uint32_t offset, uint32_t index, uint
 static int e1kRegWriteEERD(PE1KSTATE pThis, uint32_t offset, uint32_t index, uint32_t value)
 {
 #ifdef IN_RING3
+    if (pThis->eChip == E1K_CHIP_82574L)
+    {
+        /* 82574L has the address in bits 2..15 and DONE in bit 1. */
+        EERD = value & (EERD_START | EERD_82574_ADDR_MASK);
+        if (value & EERD_START)
+        {
+            uint16_t tmp;
+            STAM_PROFILE_ADV_START(&pThis->StatEEPROMRead, a);
+            if (pThis->eeprom.readWord(GET_BITS_V(value, EERD_82574, ADDR), &tmp))
+                SET_BITS(EERD, DATA, tmp);
+            EERD |= EERD_82574_DONE;
+            STAM_PROFILE_ADV_STOP(&pThis->StatEEPROMRead, a);
+        }
+        return VINF_SUCCESS;
+    }
     /* Make use of 'writable' and 'readable' masks. */
     e1kRegWriteDefault(pThis, offset, index, value);
     /* DONE and DATA are set only if read was triggered by START. */
@@ -2933,6 +3431,13 @@ static int e1kRegReadICR(PE1KSTATE pThis, uint32_t offset, uint32_t index, uint3
 
     uint32_t value = 0;
     rc = e1kRegReadDefault(pThis, offset, index, &value);
+    if (RT_SUCCESS(rc) && pThis->eChip == E1K_CHIP_82574L)
+    {
+        /* 82574L reports the per-queue causes and whether INTx was asserted. */
+        value = ICR & (g_aE1kRegMap[ICR_IDX].readable | ICR_MSIX_CAUSES);
+        if (value & IMS)
+            value |= ICR_INT_ASSERTED;
+    }
     if (RT_SUCCESS(rc))
     {
         if (value)
@@ -3131,7 +3636,7 @@ static int e1kRegWritePBA(PE1KSTATE pThis, uint32_t offset, uint32_t index, uint
 }
 
 /**
- * Write handler for Receive Descriptor Tail register.
+ * Update the tail of a receive descriptor ring.
  *
  * @remarks Write into RDT forces switch to HC and signal to
  *          e1kR3NetworkDown_WaitReceiveAvail().
@@ -3139,13 +3644,11 @@ static int e1kRegWritePBA(PE1KSTATE pThis, uint32_t offset, uint32_t index, uint
  * @returns VBox status code.
  *
  * @param   pThis       The device state structure.
- * @param   offset      Register offset in memory-mapped frame.
- * @param   index       Register index in register array.
+ * @param   iQ          The receive ring.
  * @param   value       The value to store.
- * @param   mask        Used to implement partial writes (8 and 16-bit).
  * @thread  EMT
  */
-static int e1kRegWriteRDT(PE1KSTATE pThis, uint32_t offset, uint32_t index, uint32_t value)
+static int e1kRegWriteRxTail(PE1KSTATE pThis, unsigned iQ, uint32_t value)
 {
 #ifndef IN_RING3
     /* XXX */
@@ -3154,7 +3657,9 @@ static int e1kRegWriteRDT(PE1KSTATE pThis, uint32_t offset, uint32_t index, uint
     int rc = e1kCsRxEnter(pThis, VINF_IOM_R3_MMIO_WRITE);
     if (RT_LIKELY(rc == VINF_SUCCESS))
     {
-        E1kLog(("%s e1kRegWriteRDT\n",  pThis->szPrf));
+        PE1KRINGREGS pRing = e1kRxRing(pThis, iQ);
+        value &= g_aE1kRegMap[RDT_IDX].writable;
+        E1kLog(("%s e1kRegWriteRxTail: RDT%u=%x\n",  pThis->szPrf, iQ, value));
         /*
          * Some drivers advance RDT too far, so that it equals RDH. This
          * somehow manages to work with real hardware but not with this
@@ -3162,14 +3667,14 @@ static int e1kRegWriteRDT(PE1KSTATE pThis, uint32_t offset, uint32_t index, uint
          * write 1 less when we see a driver writing RDT equal to RDH,
          * see @bugref{7346}.
          */
-        if (value == RDH)
+        if (value == pRing->uH)
         {
-            if (RDH == 0)
-                value = (RDLEN / sizeof(E1KRXDESC)) - 1;
+            if (pRing->uH == 0)
+                value = (pRing->uLEN / sizeof(E1KRXDESC)) - 1;
             else
-                value = RDH - 1;
+                value = pRing->uH - 1;
         }
-        rc = e1kRegWriteDefault(pThis, offset, index, value);
+        pRing->uT = value;
 #ifdef E1K_WITH_RXD_CACHE
         /*
          * We need to fetch descriptors now as RDT may go whole circle
@@ -3190,8 +3695,8 @@ static int e1kRegWriteRDT(PE1KSTATE pThis, uint32_t offset, uint32_t index, uint
          * reset the cache here even if it appears empty. It will be reset at
          * a later point in e1kRxDGet().
          */
-        if (e1kRxDIsCacheEmpty(pThis) && (RCTL & RCTL_EN))
-            e1kRxDPrefetch(pThis);
+        if (e1kRxDIsCacheEmpty(pThis, iQ) && (RCTL & RCTL_EN) && pRing->uLEN)
+            e1kRxDPrefetch(pThis, iQ);
 #endif /* E1K_WITH_RXD_CACHE */
         e1kCsRxLeave(pThis);
         if (RT_SUCCESS(rc))
@@ -3214,6 +3719,24 @@ static int e1kRegWriteRDT(PE1KSTATE pThis, uint32_t offset, uint32_t index, uint
     return rc;
 }
 
+/**
+ * Write handler for Receive Descriptor Tail register.
+ *
+ * @returns VBox status code.
+ *
+ * @param   pThis       The device state structure.
+ * @param   offset      Register offset in memory-mapped frame.
+ * @param   index       Register index in register array.
+ * @param   value       The value to store.
+ * @param   mask        Used to implement partial writes (8 and 16-bit).
+ * @thread  EMT
+ */
+static int e1kRegWriteRDT(PE1KSTATE pThis, uint32_t offset, uint32_t index, uint32_t value)
+{
+    RT_NOREF_PV(offset); RT_NOREF_PV(index);
+    return e1kRegWriteRxTail(pThis, 0, value);
+}
+
 /**
  * Write handler for Receive Delay Timer register.
  *
@@ -3241,14 +3764,15 @@ static int e1kRegWriteRDTR(PE1KSTATE pThis, uint32_t offset, uint32_t index, uin
     return VINF_SUCCESS;
 }
 
-DECLINLINE(uint32_t) e1kGetTxLen(PE1KSTATE pThis)
+DECLINLINE(uint32_t) e1kGetTxLen(PE1KSTATE pThis, unsigned iQ)
 {
+    PE1KRINGREGS pRing = e1kTxRing(pThis, iQ);
     /**
      *  Make sure TDT won't change during computation. EMT may modify TDT at
      *  any moment.
      */
-    uint32_t tdt = TDT;
-    return (TDH>tdt ? TDLEN/sizeof(E1KTXDESC) : 0) + tdt - TDH;
+    uint32_t tdt = pRing->uT;
+    return (pRing->uH > tdt ? pRing->uLEN/sizeof(E1KTXDESC) : 0) + tdt - pRing->uH;
 }
 
 #ifdef IN_RING3
@@ -3792,11 +4316,14 @@ DECLINLINE(void) e1kLoadDesc(PE1KSTATE pThis, E1KTXDESC *pDesc, RTGCPHYS addr)
 DECLINLINE(unsigned) e1kTxDLoadMore(PE1KSTATE pThis)
 {
     Assert(pThis->iTxDCurrent == 0);
+    PE1KRINGREGS pRing = e1kTxRing(pThis, pThis->iTxQ);
     /* We've already loaded pThis->nTxDFetched descriptors past TDH. */
-    unsigned nDescsAvailable    = e1kGetTxLen(pThis) - pThis->nTxDFetched;
+    unsigned nDescsAvailable    = e1kGetTxLen(pThis, pThis->iTxQ) - pThis->nTxDFetched;
     unsigned nDescsToFetch      = RT_MIN(nDescsAvailable, E1K_TXD_CACHE_SIZE - pThis->nTxDFetched);
-    unsigned nDescsTotal        = TDLEN / sizeof(E1KTXDESC);
-    unsigned nFirstNotLoaded    = (TDH + pThis->nTxDFetched) % nDescsTotal;
+    unsigned nDescsTotal        = pRing->uLEN / sizeof(E1KTXDESC);
+    if (nDescsTotal == 0)
+        return 0;
+    unsigned nFirstNotLoaded    = (pRing->uH + pThis->nTxDFetched) % nDescsTotal;
     unsigned nDescsInSingleRead = RT_MIN(nDescsToFetch, nDescsTotal - nFirstNotLoaded);
     E1kLog3(("%s e1kTxDLoadMore: nDescsAvailable=%u nDescsToFetch=%u "
              "nDescsTotal=%u nFirstNotLoaded=0x%x nDescsInSingleRead=%u\n",
@@ -3806,40 +4333,70 @@ DECLINLINE(unsigned) e1kTxDLoadMore(PE1KSTATE pThis)
         return 0;
     E1KTXDESC* pFirstEmptyDesc = &pThis->aTxDescriptors[pThis->nTxDFetched];
     PDMDevHlpPhysRead(pThis->CTX_SUFF(pDevIns),
-                      ((uint64_t)TDBAH << 32) + TDBAL + nFirstNotLoaded * sizeof(E1KTXDESC),
+                      ((uint64_t)pRing->uBAH << 32) + pRing->uBAL + nFirstNotLoaded * sizeof(E1KTXDESC),
                       pFirstEmptyDesc, nDescsInSingleRead * sizeof(E1KTXDESC));
-    E1kLog3(("%s Fetched %u TX descriptors at %08x%08x(0x%x), TDLEN=%08x, TDH=%08x, TDT=%08x\n",
+    E1kLog3(("%s Fetched %u TX descriptors at %08x%08x(0x%x), TDLEN%u=%08x, TDH=%08x, TDT=%08x\n",
              pThis->szPrf, nDescsInSingleRead,
-             TDBAH, TDBAL + TDH * sizeof(E1KTXDESC),
-             nFirstNotLoaded, TDLEN, TDH, TDT));
+             pRing->uBAH, pRing->uBAL + pRing->uH * sizeof(E1KTXDESC),
+             nFirstNotLoaded, pThis->iTxQ, pRing->uLEN, pRing->uH, pRing->uT));
     if (nDescsToFetch > nDescsInSingleRead)
     {
         PDMDevHlpPhysRead(pThis->CTX_SUFF(pDevIns),
-                          ((uint64_t)TDBAH << 32) + TDBAL,
+                          ((uint64_t)pRing->uBAH << 32) + pRing->uBAL,
                           pFirstEmptyDesc + nDescsInSingleRead,
                           (nDescsToFetch - nDescsInSingleRead) * sizeof(E1KTXDESC));
         E1kLog3(("%s Fetched %u TX descriptors at %08x%08x\n",
                  pThis->szPrf, nDescsToFetch - nDescsInSingleRead,
-                 TDBAH, TDBAL));
+                 pRing->uBAH, pRing->uBAL));
     }
     pThis->nTxDFetched += nDescsToFetch;
     return nDescsToFetch;
 }
 
+/**
+ * Switch the descriptor cache over to another transmit ring (82574L).
+ *
+ * Each ring has its own offload contexts, so the current ones are put aside
+ * and the ones of the new ring are brought in.
+ *
+ * @param   pThis       The device state structure.
+ * @param   iQ          The transmit ring to service next.
+ * @thread  E1000_TX
+ */
+static void e1kTxSwitchQueue(PE1KSTATE pThis, unsigned iQ)
+{
+    Assert(pThis->nTxDFetched == 0);
+    pThis->aTxQCtx[pThis->iTxQ][0] = pThis->contextTSE;
+    pThis->aTxQCtx[pThis->iTxQ][1] = pThis->contextNormal;
+    pThis->contextTSE    = pThis->aTxQCtx[iQ][0];
+    pThis->contextNormal = pThis->aTxQCtx[iQ][1];
+    e1kSetupGsoCtx(&pThis->GsoCtx, &pThis->contextTSE);
+    pThis->iTxQ = iQ;
+}
+
 /**
  * Load transmit descriptors from guest memory only if there are no loaded
  * descriptors.
  *
+ * An empty cache means we are at a packet boundary, which is where the
+ * transmit rings of 82574L take turns.
+ *
  * @returns true if there are descriptors in cache.
  * @param   pThis       The device state structure.
- * @param   pDesc       Pointer to descriptor union.
- * @param   addr        Physical address in guest context.
  * @thread  E1000_TX
  */
 DECLINLINE(bool) e1kTxDLazyLoad(PE1KSTATE pThis)
 {
     if (pThis->nTxDFetched == 0)
+    {
+        if (pThis->TxRing1.uLEN || pThis->iTxQ)
+        {
+            unsigned iNext = (pThis->iTxQ + 1) % E1K_MAX_QUEUES;
+            if (e1kGetTxLen(pThis, iNext))
+                e1kTxSwitchQueue(pThis, iNext);
+        }
         return e1kTxDLoadMore(pThis) != 0;
+    }
     return true;
 }
 #endif /* E1K_WITH_TXD_CACHE */
@@ -4518,7 +5075,7 @@ static void e1kDescReport(PE1KSTATE pThis, E1KTXDESC *pDesc, RTGCPHYS addr)
                 }
 //#endif /* E1K_USE_TX_TIMERS */
                 E1K_INC_ISTAT_CNT(pThis->uStatIntTx);
-                e1kRaiseInterrupt(pThis, VERR_SEM_BUSY, ICR_TXDW);
+                e1kRaiseInterrupt(pThis, VERR_SEM_BUSY, ICR_TXDW | (ICR_TXQ0 << pThis->iTxQ));
 //#ifdef E1K_USE_TX_TIMERS
             }
 //#endif /* E1K_USE_TX_TIMERS */
@@ -5089,18 +5646,21 @@ static int e1kXmitPacket(PE1KSTATE pThis, bool fOnWorkerThread)
     while (pThis->iTxDCurrent < pThis->nTxDFetched)
     {
         E1KTXDESC *pDesc = &pThis->aTxDescriptors[pThis->iTxDCurrent];
-        E1kLog3(("%s About to process new TX descriptor at %08x%08x, TDLEN=%08x, TDH=%08x, TDT=%08x\n",
-                 pThis->szPrf, TDBAH, TDBAL + TDH * sizeof(E1KTXDESC), TDLEN, TDH, TDT));
-        rc = e1kXmitDesc(pThis, pDesc, e1kDescAddr(TDBAH, TDBAL, TDH), fOnWorkerThread);
+        PE1KRINGREGS pRing = e1kTxRing(pThis, pThis->iTxQ);
+        E1kLog3(("%s About to process new TX descriptor at %08x%08x, TDLEN%u=%08x, TDH=%08x, TDT=%08x\n",
+                 pThis->szPrf, pRing->uBAH, pRing->uBAL + pRing->uH * sizeof(E1KTXDESC), pThis->iTxQ,
+                 pRing->uLEN, pRing->uH, pRing->uT));
+        rc = e1kXmitDesc(pThis, pDesc, e1kDescAddr(pRing->uBAH, pRing->uBAL, pRing->uH), fOnWorkerThread);
         if (RT_FAILURE(rc))
             break;
-        if (++TDH * sizeof(E1KTXDESC) >= TDLEN)
-            TDH = 0;
-        uint32_t uLowThreshold = GET_BITS(TXDCTL, LWTHRESH)*8;
-        if (uLowThreshold != 0 && e1kGetTxLen(pThis) <= uLowThreshold)
+        if (++pRing->uH * sizeof(E1KTXDESC) >= pRing->uLEN)
+            pRing->uH = 0;
+        uint32_t uTxDCtl = pThis->iTxQ ? pThis->uTXDCTL1 : TXDCTL;
+        uint32_t uLowThreshold = GET_BITS_V(uTxDCtl, TXDCTL, LWTHRESH)*8;
+        if (uLowThreshold != 0 && e1kGetTxLen(pThis, pThis->iTxQ) <= uLowThreshold)
         {
             E1kLog2(("%s Low on transmit descriptors, raise ICR.TXD_LOW, len=%x thresh=%x\n",
-                     pThis->szPrf, e1kGetTxLen(pThis), GET_BITS(TXDCTL, LWTHRESH)*8));
+                     pThis->szPrf, e1kGetTxLen(pThis, pThis->iTxQ), uLowThreshold));
             e1kRaiseInterrupt(pThis, VERR_SEM_BUSY, ICR_TXD_LOW);
         }
         ++pThis->iTxDCurrent;
@@ -5165,10 +5725,10 @@ static int e1kXmitPending(PE1KSTATE pThis, bool fOnWorkerThread)
             if (++TDH * sizeof(desc) >= TDLEN)
                 TDH = 0;
 
-            if (e1kGetTxLen(pThis) <= GET_BITS(TXDCTL, LWTHRESH)*8)
+            if (e1kGetTxLen(pThis, 0) <= GET_BITS(TXDCTL, LWTHRESH)*8)
             {
                 E1kLog2(("%s Low on transmit descriptors, raise ICR.TXD_LOW, len=%x thresh=%x\n",
-                         pThis->szPrf, e1kGetTxLen(pThis), GET_BITS(TXDCTL, LWTHRESH)*8));
+                         pThis->szPrf, e1kGetTxLen(pThis, 0), GET_BITS(TXDCTL, LWTHRESH)*8));
                 e1kRaiseInterrupt(pThis, VERR_SEM_BUSY, ICR_TXD_LOW);
             }
 
@@ -5192,20 +5752,21 @@ static int e1kXmitPending(PE1KSTATE pThis, bool fOnWorkerThread)
 
 static void e1kDumpTxDCache(PE1KSTATE pThis)
 {
-    unsigned i, cDescs = TDLEN / sizeof(E1KTXDESC);
-    uint32_t tdh = TDH;
-    LogRel(("-- Transmit Descriptors (%d total) --\n", cDescs));
+    PE1KRINGREGS pRing = e1kTxRing(pThis, pThis->iTxQ);
+    unsigned i, cDescs = pRing->uLEN / sizeof(E1KTXDESC);
+    uint32_t tdh = pRing->uH;
+    LogRel(("-- Transmit Descriptors (%d total, ring %u) --\n", cDescs, pThis->iTxQ));
     for (i = 0; i < cDescs; ++i)
     {
         E1KTXDESC desc;
-        PDMDevHlpPhysRead(pThis->CTX_SUFF(pDevIns), e1kDescAddr(TDBAH, TDBAL, i),
+        PDMDevHlpPhysRead(pThis->CTX_SUFF(pDevIns), e1kDescAddr(pRing->uBAH, pRing->uBAL, i),
                           &desc, sizeof(desc));
         if (i == tdh)
             LogRel((">>> "));
-        LogRel(("%RGp: %R[e1ktxd]\n", e1kDescAddr(TDBAH, TDBAL, i), &desc));
+        LogRel(("%RGp: %R[e1ktxd]\n", e1kDescAddr(pRing->uBAH, pRing->uBAL, i), &desc));
     }
     LogRel(("-- Transmit Descriptors in Cache (at %d (TDH %d)/ fetched %d / max %d) --\n",
-            pThis->iTxDCurrent, TDH, pThis->nTxDFetched, E1K_TXD_CACHE_SIZE));
+            pThis->iTxDCurrent, pRing->uH, pThis->nTxDFetched, E1K_TXD_CACHE_SIZE));
     if (tdh > pThis->iTxDCurrent)
         tdh -= pThis->iTxDCurrent;
     else
@@ -5214,7 +5775,7 @@ static void e1kDumpTxDCache(PE1KSTATE pThis)
     {
         if (i == pThis->iTxDCurrent)
             LogRel((">>> "));
-        LogRel(("%RGp: %R[e1ktxd]\n", e1kDescAddr(TDBAH, TDBAL, tdh++ % cDescs), &pThis->aTxDescriptors[i]));
+        LogRel(("%RGp: %R[e1ktxd]\n", e1kDescAddr(pRing->uBAH, pRing->uBAL, tdh++ % cDescs), &pThis->aTxDescriptors[i]));
     }
 }
 
@@ -5289,7 +5850,7 @@ static int e1kXmitPending(PE1KSTATE pThis, bool fOnWorkerThread)
                       pThis->szPrf,
                       u8Remain == E1K_TXD_CACHE_SIZE ? " full" : "",
                       pThis->nTxDFetched, pThis->iTxDCurrent,
-                      e1kGetTxLen(pThis)));
+                      e1kGetTxLen(pThis, pThis->iTxQ)));
                 if (!fTxDCacheDumped)
                 {
                     fTxDCacheDumped = true;
@@ -5312,7 +5873,7 @@ static int e1kXmitPending(PE1KSTATE pThis, bool fOnWorkerThread)
                 Log4(("%s Incomplete packet at %d. Already fetched %d, "
                       "%d more are available\n",
                       pThis->szPrf, pThis->iTxDCurrent, u8Remain,
-                      e1kGetTxLen(pThis) - u8Remain));
+                      e1kGetTxLen(pThis, pThis->iTxQ) - u8Remain));
 
                 /*
                  * A packet was partially fetched. Move incomplete packet to
@@ -5330,7 +5891,7 @@ static int e1kXmitPending(PE1KSTATE pThis, bool fOnWorkerThread)
                 pThis->nTxDFetched = 0;
             pThis->iTxDCurrent = 0;
         }
-        if (!pThis->fLocked && GET_BITS(TXDCTL, LWTHRESH) == 0)
+        if (!pThis->fLocked && GET_BITS_V(pThis->iTxQ ? pThis->uTXDCTL1 : TXDCTL, TXDCTL, LWTHRESH) == 0)
         {
             E1kLog2(("%s Out of transmit descriptors, raise ICR.TXD_LOW\n",
                      pThis->szPrf));
@@ -5403,30 +5964,30 @@ static DECLCALLBACK(bool) e1kCanRxQueueConsumer(PPDMDEVINS pDevIns, PPDMQUEUEITE
 #endif /* IN_RING3 */
 
 /**
- * Write handler for Transmit Descriptor Tail register.
+ * Update the tail of a transmit descriptor ring and start transmission.
  *
  * @param   pThis       The device state structure.
- * @param   offset      Register offset in memory-mapped frame.
- * @param   index       Register index in register array.
+ * @param   iQ          The transmit ring.
  * @param   value       The value to store.
- * @param   mask        Used to implement partial writes (8 and 16-bit).
  * @thread  EMT
  */
-static int e1kRegWriteTDT(PE1KSTATE pThis, uint32_t offset, uint32_t index, uint32_t value)
+static int e1kRegWriteTxTail(PE1KSTATE pThis, unsigned iQ, uint32_t value)
 {
-    int rc = e1kRegWriteDefault(pThis, offset, index, value);
+    int rc = VINF_SUCCESS;
+    PE1KRINGREGS pRing = e1kTxRing(pThis, iQ);
+    pRing->uT = value & g_aE1kRegMap[TDT_IDX].writable;
 
     /* All descriptors starting with head and not including tail belong to us. */
     /* Process them. */
-    E1kLog2(("%s e1kRegWriteTDT: TDBAL=%08x, TDBAH=%08x, TDLEN=%08x, TDH=%08x, TDT=%08x\n",
-            pThis->szPrf, TDBAL, TDBAH, TDLEN, TDH, TDT));
+    E1kLog2(("%s e1kRegWriteTxTail: TDBAL%u=%08x, TDBAH=%08x, TDLEN=%08x, TDH=%08x, TDT=%08x\n",
+            pThis->szPrf, iQ, pRing->uBAL, pRing->uBAH, pRing->uLEN, pRing->uH, pRing->uT));
 
     /* Ignore TDT writes when the link is down. */
-    if (TDH != TDT && (STATUS & STATUS_LU))
+    if (pRing->uH != pRing->uT && (STATUS & STATUS_LU))
     {
-        Log5(("E1000: TDT write: TDH=%08x, TDT=%08x, %d descriptors to process\n", TDH, TDT, e1kGetTxLen(pThis)));
-        E1kLog(("%s e1kRegWriteTDT: %d descriptors to process\n",
-                 pThis->szPrf, e1kGetTxLen(pThis)));
+        Log5(("E1000: TDT%u write: TDH=%08x, TDT=%08x, %d descriptors to process\n", iQ, pRing->uH, pRing->uT, e1kGetTxLen(pThis, iQ)));
+        E1kLog(("%s e1kRegWriteTxTail: %d descriptors to process\n",
+                 pThis->szPrf, e1kGetTxLen(pThis, iQ)));
 
         /* Transmit pending packets if possible, defer it if we cannot do it
            in the current context. */
@@ -5469,6 +6030,22 @@ static int e1kRegWriteTDT(PE1KSTATE pThis, uint32_t offset, uint32_t index, uint
     return rc;
 }
 
+/**
+ * Write handler for Transmit Descriptor Tail register.
+ *
+ * @param   pThis       The device state structure.
+ * @param   offset      Register offset in memory-mapped frame.
+ * @param   index       Register index in register array.
+ * @param   value       The value to store.
+ * @param   mask        Used to implement partial writes (8 and 16-bit).
+ * @thread  EMT
+ */
+static int e1kRegWriteTDT(PE1KSTATE pThis, uint32_t offset, uint32_t index, uint32_t value)
+{
+    RT_NOREF_PV(offset); RT_NOREF_PV(index);
+    return e1kRegWriteTxTail(pThis, 0, value);
+}
+
 /**
  * Write handler for Multicast Table Array registers.
  *
@@ -5574,6 +6151,181 @@ static int e1kRegReadVFTA(PE1KSTATE pThis, uint32_t offset, uint32_t index, uint
     return VINF_SUCCESS;
 }
 
+/**
+ * Map an offset within a descriptor ring register block to the register.
+ *
+ * @returns Pointer to the register, NULL for reserved offsets.
+ * @param   pRing       The ring registers.
+ * @param   iReg        Offset within the block in dwords.
+ */
+DECLINLINE(uint32_t *) e1kRingRegPtr(PE1KRINGREGS pRing, uint32_t iReg)
+{
+    switch (iReg)
+    {
+        case 0: return &pRing->uBAL;
+        case 1: return &pRing->uBAH;
+        case 2: return &pRing->uLEN;
+        case 4: return &pRing->uH;
+        case 6: return &pRing->uT;
+        default: return NULL;
+    }
+}
+
+/**
+ * Locate the storage of a register that is present in 82574L only.
+ *
+ * @returns Pointer to the register, NULL if not emulated.
+ * @param   pThis       The device state structure.
+ * @param   offset      Register offset in memory-mapped frame.
+ * @param   index       Register index in register array.
+ */
+static uint32_t *e1kReg82574Ptr(PE1KSTATE pThis, uint32_t offset, uint32_t index)
+{
+    if (pThis->eChip != E1K_CHIP_82574L)
+        return NULL;
+    uint32_t iReg = (offset - g_aE1kRegMap[index].offset) / sizeof(uint32_t);
+    switch (index)
+    {
+        case EIAC_IDX:        return &pThis->uEIAC;
+        case IAM_IDX:         return &pThis->uIAM;
+        case IVAR_IDX:        return &pThis->uIVAR;
+        case EITR_IDX:        return iReg < RT_ELEMENTS(pThis->auEITR) ? &pThis->auEITR[iReg] : NULL;
+        case EXTCNF_CTRL_IDX: return &pThis->uEXTCNF_CTRL;
+        case RXQ1_IDX:        return e1kRingRegPtr(&pThis->RxRing1, iReg);
+        case RXDCTL1_IDX:     return &pThis->uRXDCTL1;
+        case TARC0_IDX:       return &pThis->auTARC[0];
+        case TXQ1_IDX:        return e1kRingRegPtr(&pThis->TxRing1, iReg);
+        case TXDCTL1_IDX:     return &pThis->uTXDCTL1;
+        case TARC1_IDX:       return &pThis->auTARC[1];
+        case RFCTL_IDX:       return &pThis->uRFCTL;
+        case MRQC_IDX:        return &pThis->uMRQC;
+        case SWSM_IDX:        return &pThis->uSWSM;
+        case RETA_IDX:        return iReg < RT_ELEMENTS(pThis->auRETA) ? &pThis->auRETA[iReg] : NULL;
+        case RSSRK_IDX:       return iReg < RT_ELEMENTS(pThis->auRSSRK) ? &pThis->auRSSRK[iReg] : NULL;
+        default:              return NULL;
+    }
+}
+
+/**
+ * Read handler for registers present in 82574L only.
+ *
+ * Other chips treat them as unimplemented.
+ *
+ * @returns VBox status code.
+ *
+ * @param   pThis       The device state structure.
+ * @param   offset      Register offset in memory-mapped frame.
+ * @param   index       Register index in register array.
+ * @thread  EMT
+ */
+static int e1kRegRead82574(PE1KSTATE pThis, uint32_t offset, uint32_t index, uint32_t *pu32Value)
+{
+    uint32_t *pu32Reg = e1kReg82574Ptr(pThis, offset, index);
+    if (!pu32Reg)
+        return e1kRegReadUnimplemented(pThis, offset, index, pu32Value);
+    *pu32Value = *pu32Reg & g_aE1kRegMap[index].readable;
+    return VINF_SUCCESS;
+}
+
+/**
+ * Write handler for registers present in 82574L only.
+ *
+ * Tail writes of the second descriptor rings get the same treatment as
+ * RDT and TDT; other chips treat these registers as unimplemented.
+ *
+ * @param   pThis       The device state structure.
+ * @param   offset      Register offset in memory-mapped frame.
+ * @param   index       Register index in register array.
+ * @param   value       The value to store.
+ * @thread  EMT
+ */
+static int e1kRegWrite82574(PE1KSTATE pThis, uint32_t offset, uint32_t index, uint32_t value)
+{
+    uint32_t *pu32Reg = e1kReg82574Ptr(pThis, offset, index);
+    if (!pu32Reg)
+        return e1kRegWriteUnimplemented(pThis, offset, index, value);
+    if (pu32Reg == &pThis->RxRing1.uT)
+        return e1kRegWriteRxTail(pThis, 1, value);
+    if (pu32Reg == &pThis->TxRing1.uT)
+        return e1kRegWriteTxTail(pThis, 1, value);
+    *pu32Reg = (value & g_aE1kRegMap[index].writable) | (*pu32Reg & ~g_aE1kRegMap[index].writable);
+    return VINF_SUCCESS;
+}
+
+/**
+ * Read handler for Extended Device Control register.
+ *
+ * @returns VBox status code.
+ *
+ * @param   pThis       The device state structure.
+ * @param   offset      Register offset in memory-mapped frame.
+ * @param   index       Register index in register array.
+ * @thread  EMT
+ */
+static int e1kRegReadCTRL_EXT(PE1KSTATE pThis, uint32_t offset, uint32_t index, uint32_t *pu32Value)
+{
+    if (pThis->eChip != E1K_CHIP_82574L)
+        return e1kRegReadUnimplemented(pThis, offset, index, pu32Value);
+    return e1kRegReadDefault(pThis, offset, index, pu32Value);
+}
+
+/**
+ * Write handler for Extended Device Control register.
+ *
+ * Only 82574L keeps its value, it controls MSI-X auto-masking there.
+ *
+ * @param   pThis       The device state structure.
+ * @param   offset      Register offset in memory-mapped frame.
+ * @param   index       Register index in register array.
+ * @param   value       The value to store.
+ * @thread  EMT
+ */
+static int e1kRegWriteCTRL_EXT(PE1KSTATE pThis, uint32_t offset, uint32_t index, uint32_t value)
+{
+    if (pThis->eChip != E1K_CHIP_82574L)
+        return e1kRegWriteUnimplemented(pThis, offset, index, value);
+    return e1kRegWriteDefault(pThis, offset, index, value);
+}
+
+/**
+ * Write handler for Receive Checksum Control register.
+ *
+ * IPPCSE and PCSD exist in 82574L only.
+ *
+ * @param   pThis       The device state structure.
+ * @param   offset      Register offset in memory-mapped frame.
+ * @param   index       Register index in register array.
+ * @param   value       The value to store.
+ * @thread  EMT
+ */
+static int e1kRegWriteRXCSUM(PE1KSTATE pThis, uint32_t offset, uint32_t index, uint32_t value)
+{
+    if (pThis->eChip != E1K_CHIP_82574L)
+        value &= ~(RXCSUM_IPPCSE | RXCSUM_PCSD);
+    return e1kRegWriteDefault(pThis, offset, index, value);
+}
+
+/**
+ * Read handler for EEPROM Read register.
+ *
+ * @returns VBox status code.
+ *
+ * @param   pThis       The device state structure.
+ * @param   offset      Register offset in memory-mapped frame.
+ * @param   index       Register index in register array.
+ * @thread  EMT
+ */
+static int e1kRegReadEERD(PE1KSTATE pThis, uint32_t offset, uint32_t index, uint32_t *pu32Value)
+{
+    /* 82574L has the address in bits 2..15 and DONE in bit 1. */
+    if (pThis->eChip == E1K_CHIP_82574L)
+    {
+        *pu32Value = EERD;
+        return VINF_SUCCESS;
+    }
+    return e1kRegReadDefault(pThis, offset, index, pu32Value);
+}
+
 /**
  * Read handler for unimplemented registers.
  *
@@ -6244,27 +6996,37 @@ static int e1kCanReceive(PE1KSTATE pThis)
     e1kCsRxLeave(pThis);
     return cb > 0 ? VINF_SUCCESS : VERR_NET_NO_BUFFER_SPACE;
 #else /* E1K_WITH_RXD_CACHE */
-    int rc = VINF_SUCCESS;
+    int rc = VERR_NET_NO_BUFFER_SPACE;
 
     if (RT_UNLIKELY(e1kCsRxEnter(pThis, VERR_SEM_BUSY) != VINF_SUCCESS))
         return VERR_NET_NO_BUFFER_SPACE;
 
-    if (RT_UNLIKELY(RDLEN == sizeof(E1KRXDESC)))
-    {
-        E1KRXDESC desc;
-        PDMDevHlpPhysRead(pThis->CTX_SUFF(pDevIns), e1kDescAddr(RDBAH, RDBAL, RDH),
-                          &desc, sizeof(desc));
-        if (desc.status.fDD)
-            rc = VERR_NET_NO_BUFFER_SPACE;
-    }
-    else if (e1kRxDIsCacheEmpty(pThis) && RDH == RDT)
+    /*
+     * With RSS spreading frames over both rings (82574L) we accept a frame as
+     * long as any of them has room, a frame hashed to an exhausted ring gets
+     * dropped just like real hardware does.
+     */
+    unsigned cQueues = pThis->RxRing1.uLEN && (pThis->uMRQC & MRQC_ENABLE_MASK) == MRQC_ENABLE_RSS ? 2 : 1;
+    for (unsigned iQ = 0; iQ < cQueues && rc != VINF_SUCCESS; iQ++)
     {
-        /* Cache is empty, so is the RX ring. */
-        rc = VERR_NET_NO_BUFFER_SPACE;
+        PE1KRINGREGS pRing = e1kRxRing(pThis, iQ);
+        if (RT_UNLIKELY(pRing->uLEN == sizeof(E1KRXDESC)))
+        {
+            E1KRXDESC desc;
+            PDMDevHlpPhysRead(pThis->CTX_SUFF(pDevIns), e1kDescAddr(pRing->uBAH, pRing->uBAL, pRing->uH),
+                              &desc, sizeof(desc));
+            if (!desc.status.fDD)
+                rc = VINF_SUCCESS;
+        }
+        else if (!e1kRxDIsCacheEmpty(pThis, iQ) || pRing->uH != pRing->uT)
+        {
+            /* Either the cache or the RX ring has descriptors. */
+            rc = VINF_SUCCESS;
+        }
+        E1kLog2(("%s e1kCanReceive: at exit queue=%u in_cache=%d RDH=%d RDT=%d RDLEN=%d"
+                 " u16RxBSize=%d rc=%Rrc\n", pThis->szPrf, iQ,
+                 e1kRxDInCache(pThis, iQ), pRing->uH, pRing->uT, pRing->uLEN, pThis->u16RxBSize, rc));
     }
-    E1kLog2(("%s e1kCanReceive: at exit in_cache=%d RDH=%d RDT=%d RDLEN=%d"
-             " u16RxBSize=%d rc=%Rrc\n", pThis->szPrf,
-             e1kRxDInCache(pThis), RDH, RDT, RDLEN, pThis->u16RxBSize, rc));
 
     e1kCsRxLeave(pThis);
     return rc;
@@ -6755,6 +7517,28 @@ static DECLCALLBACK(int) e1kSaveExec(PPDMDEVINS pDevIns, PSSMHANDLE pSSM)
     SSMR3PutU8(pSSM, 0);
 #endif
 #endif /* E1K_WITH_TXD_CACHE */
+    if (pThis->eChip == E1K_CHIP_82574L)
+    {
+        /* The 82574L did not exist before this unit version, no need to bump it. */
+        SSMR3PutMem(pSSM, &pThis->RxRing1, sizeof(pThis->RxRing1));
+        SSMR3PutMem(pSSM, &pThis->TxRing1, sizeof(pThis->TxRing1));
+        SSMR3PutU32(pSSM, pThis->uRXDCTL1);
+        SSMR3PutU32(pSSM, pThis->uTXDCTL1);
+        SSMR3PutMem(pSSM, pThis->auTARC, sizeof(pThis->auTARC));
+        SSMR3PutU32(pSSM, pThis->uEIAC);
+        SSMR3PutU32(pSSM, pThis->uIAM);
+        SSMR3PutU32(pSSM, pThis->uIVAR);
+        SSMR3PutMem(pSSM, pThis->auEITR, sizeof(pThis->auEITR));
+        SSMR3PutU32(pSSM, pThis->uEXTCNF_CTRL);
+        SSMR3PutU32(pSSM, pThis->uSWSM);
+        SSMR3PutU32(pSSM, pThis->uRFCTL);
+        SSMR3PutU32(pSSM, pThis->uMRQC);
+        SSMR3PutMem(pSSM, pThis->auRETA, sizeof(pThis->auRETA));
+        SSMR3PutMem(pSSM, pThis->auRSSRK, sizeof(pThis->auRSSRK));
+        SSMR3PutU32(pSSM, pThis->iTxQ);
+        SSMR3PutMem(pSSM, pThis->aTxQCtx, sizeof(pThis->aTxQCtx));
+        SSMR3PutU32(pSSM, pThis->fMsixDeferred);
+    }
 /** @todo GSO requires some more state here. */
     E1kLog(("%s State has been saved\n", pThis->szPrf));
     return VINF_SUCCESS;
@@ -6886,8 +7670,37 @@ static DECLCALLBACK(int) e1kLoadExec(PPDMDEVINS pDevIns, PSSMHANDLE pSSM, uint32
          * There is no point in storing the RX descriptor cache in the saved
          * state, we just need to make sure it is empty.
          */
-        pThis->iRxDCurrent = pThis->nRxDFetched = 0;
+        for (unsigned iQ = 0; iQ < RT_ELEMENTS(pThis->aRxQ); iQ++)
+            pThis->aRxQ[iQ].iRxDCurrent = pThis->aRxQ[iQ].nRxDFetched = 0;
 #endif /* E1K_WITH_RXD_CACHE */
+        if (pThis->eChip == E1K_CHIP_82574L)
+        {
+            SSMR3GetMem(pSSM, &pThis->RxRing1, sizeof(pThis->RxRing1));
+            SSMR3GetMem(pSSM, &pThis->TxRing1, sizeof(pThis->TxRing1));
+            SSMR3GetU32(pSSM, &pThis->uRXDCTL1);
+            SSMR3GetU32(pSSM, &pThis->uTXDCTL1);
+            SSMR3GetMem(pSSM, pThis->auTARC, sizeof(pThis->auTARC));
+            SSMR3GetU32(pSSM, &pThis->uEIAC);
+            SSMR3GetU32(pSSM, &pThis->uIAM);
+            SSMR3GetU32(pSSM, &pThis->uIVAR);
+            SSMR3GetMem(pSSM, pThis->auEITR, sizeof(pThis->auEITR));
+            SSMR3GetU32(pSSM, &pThis->uEXTCNF_CTRL);
+            SSMR3GetU32(pSSM, &pThis->uSWSM);
+            SSMR3GetU32(pSSM, &pThis->uRFCTL);
+            SSMR3GetU32(pSSM, &pThis->uMRQC);
+            SSMR3GetMem(pSSM, pThis->auRETA, sizeof(pThis->auRETA));
+            SSMR3GetMem(pSSM, pThis->auRSSRK, sizeof(pThis->auRSSRK));
+            SSMR3GetU32(pSSM, &pThis->iTxQ);
+            SSMR3GetMem(pSSM, pThis->aTxQCtx, sizeof(pThis->aTxQCtx));
+            rc = SSMR3GetU32(pSSM, &pThis->fMsixDeferred);
+            AssertRCReturn(rc, rc);
+            AssertLogRelMsgReturn(pThis->iTxQ < E1K_MAX_QUEUES, ("iTxQ=%u\n", pThis->iTxQ),
+                                  VERR_SSM_DATA_UNIT_FORMAT_CHANGED);
+            pThis->fMsixDeferred &= RT_BIT_32(E1K_MSIX_VECTORS) - 1;
+            /* The throttling timestamps are not saved, so the deferred vectors
+               may fire right away (see e1kLoadDone). */
+            RT_ZERO(pThis->au64VectorFiredAt);
+        }
         /* derived state  */
         e1kSetupGsoCtx(&pThis->GsoCtx, &pThis->contextTSE);
 
@@ -6910,6 +7723,11 @@ static DECLCALLBACK(int) e1kLoadDone(PPDMDEVINS pDevIns, PSSMHANDLE pSSM)
         pThis->pDrvR3->pfnSetPromiscuousMode(pThis->pDrvR3,
                                              !!(RCTL & (RCTL_UPE | RCTL_MPE)));
 
+    /* The interrupt timer isn't part of the saved state, re-arm it for any
+       MSI-X vectors that were held back by throttling. */
+    if (pThis->fMsixDeferred)
+        e1kPostponeInterrupt(pThis, 0);
+
     /*
     * Force the link down here, since PDMNETWORKLINKSTATE_DOWN_RESUME is never
     * passed to us. We go through all this stuff if the link was up and we
@@ -7135,19 +7953,28 @@ static DECLCALLBACK(void) e1kInfo(PPDMDEVINS pDevIns, PCDBGFINFOHLP pHlp, const
         pHlp->pfnPrintf(pHlp, "%RGp: %R[e1krxd]\n", e1kDescAddr(RDBAH, RDBAL, i), &desc);
     }
 #ifdef E1K_WITH_RXD_CACHE
-    pHlp->pfnPrintf(pHlp, "\n-- Receive Descriptors in Cache (at %d (RDH %d)/ fetched %d / max %d) --\n",
-                    pThis->iRxDCurrent, RDH, pThis->nRxDFetched, E1K_RXD_CACHE_SIZE);
-    if (rdh > pThis->iRxDCurrent)
-        rdh -= pThis->iRxDCurrent;
-    else
-        rdh = cDescs + rdh - pThis->iRxDCurrent;
-    for (i = 0; i < pThis->nRxDFetched; ++i)
-    {
-        if (i == pThis->iRxDCurrent)
-            pHlp->pfnPrintf(pHlp, ">>> ");
-        pHlp->pfnPrintf(pHlp, "%RGp: %R[e1krxd]\n",
-                        e1kDescAddr(RDBAH, RDBAL, rdh++ % cDescs),
-                        &pThis->aRxDescriptors[i]);
+    for (unsigned iQ = 0; iQ < E1K_MAX_QUEUES; iQ++)
+    {
+        PE1KRINGREGS pRing = e1kRxRing(pThis, iQ);
+        struct E1kState_st::E1KRXQ *pRxQ = &pThis->aRxQ[iQ];
+        if (!pRing->uLEN)
+            continue;
+        cDescs = pRing->uLEN / sizeof(E1KRXDESC);
+        rdh    = pRing->uH;
+        pHlp->pfnPrintf(pHlp, "\n-- Receive Descriptors in Cache #%u (at %d (RDH %d)/ fetched %d / max %d) --\n",
+                        iQ, pRxQ->iRxDCurrent, pRing->uH, pRxQ->nRxDFetched, E1K_RXD_CACHE_SIZE);
+        if (rdh > pRxQ->iRxDCurrent)
+            rdh -= pRxQ->iRxDCurrent;
+        else
+            rdh = cDescs + rdh - pRxQ->iRxDCurrent;
+        for (i = 0; i < pRxQ->nRxDFetched; ++i)
+        {
+            if (i == pRxQ->iRxDCurrent)
+                pHlp->pfnPrintf(pHlp, ">>> ");
+            pHlp->pfnPrintf(pHlp, "%RGp: %R[e1krxd]\n",
+                            e1kDescAddr(pRing->uBAH, pRing->uBAL, rdh++ % cDescs),
+                            &pRxQ->aRxDescriptors[i]);
+        }
     }
 #endif /* E1K_WITH_RXD_CACHE */
 
@@ -7164,8 +7991,11 @@ static DECLCALLBACK(void) e1kInfo(PPDMDEVINS pDevIns, PCDBGFINFOHLP pHlp, const
         pHlp->pfnPrintf(pHlp, "%RGp: %R[e1ktxd]\n", e1kDescAddr(TDBAH, TDBAL, i), &desc);
     }
 #ifdef E1K_WITH_TXD_CACHE
-    pHlp->pfnPrintf(pHlp, "\n-- Transmit Descriptors in Cache (at %d (TDH %d)/ fetched %d / max %d) --\n",
-                    pThis->iTxDCurrent, TDH, pThis->nTxDFetched, E1K_TXD_CACHE_SIZE);
+    PE1KRINGREGS pTxRing = e1kTxRing(pThis, pThis->iTxQ);
+    cDescs = pTxRing->uLEN / sizeof(E1KTXDESC);
+    tdh    = pTxRing->uH;
+    pHlp->pfnPrintf(pHlp, "\n-- Transmit Descriptors in Cache #%u (at %d (TDH %d)/ fetched %d / max %d) --\n",
+                    pThis->iTxQ, pThis->iTxDCurrent, pTxRing->uH, pThis->nTxDFetched, E1K_TXD_CACHE_SIZE);
     if (tdh > pThis->iTxDCurrent)
         tdh -= pThis->iTxDCurrent;
     else
@@ -7175,7 +8005,7 @@ static DECLCALLBACK(void) e1kInfo(PPDMDEVINS pDevIns, PCDBGFINFOHLP pHlp, const
         if (i == pThis->iTxDCurrent)
             pHlp->pfnPrintf(pHlp, ">>> ");
         pHlp->pfnPrintf(pHlp, "%RGp: %R[e1ktxd]\n",
-                        e1kDescAddr(TDBAH, TDBAL, tdh++ % cDescs),
+                        e1kDescAddr(pTxRing->uBAH, pTxRing->uBAL, tdh++ % cDescs),
                         &pThis->aTxDescriptors[i]);
     }
 #endif /* E1K_WITH_TXD_CACHE */
@@ -7522,6 +8352,43 @@ static DECLCALLBACK(void) e1kConfigurePciDev(PPDMPCIDEV pPciDev, E1KCHIP eChip)
     /* PCI-X Status: 32-bit, 66MHz*/
     /** @todo is this value really correct? fff8 doesn't look like actual PCI address */
     PCIDevSetDWord(pPciDev, 0xE4 + 4,                0x0040FFF8);
+
+    if (eChip == E1K_CHIP_82574L)
+    {
+        /*
+         * The 82574L is a PCIe part: PM at 0xC8, then PCI Express at 0xE0
+         * replacing PCI-X, then the MSI-X capability at 0xA0 which gets
+         * filled in by PDMDevHlpPCIRegisterMsi().
+         */
+        PCIDevSetByte( pPciDev, VBOX_PCI_CAPABILITY_LIST,      0xC8);
+        PCIDevSetByte( pPciDev, 0xDC,                          0x00);
+        PCIDevSetByte( pPciDev, 0xDC + 1,                      0x00);
+        PCIDevSetWord( pPciDev, 0xDC + 2,                    0x0000);
+
+        /* PCI Power Management Registers ************************************/
+        PCIDevSetByte( pPciDev, 0xC8,            VBOX_PCI_CAP_ID_PM);
+        PCIDevSetByte( pPciDev, 0xC8 + 1,                      0xE0);
+        PCIDevSetWord( pPciDev, 0xC8 + 2,
+                        0x0002 | VBOX_PCI_PM_CAP_DSI);
+        PCIDevSetWord( pPciDev, 0xC8 + 4,                    0x0000);
+
+        /* PCI Express Capability Registers **********************************/
+        PCIDevSetByte( pPciDev, 0xE0,           VBOX_PCI_CAP_ID_EXP);
+        PCIDevSetByte( pPciDev, 0xE0 + 1,                      0xA0);
+        /* Capability version 1, PCI Express endpoint */
+        PCIDevSetWord( pPciDev, 0xE0 + 2,
+                       0x0001 | (VBOX_PCI_EXP_TYPE_ENDPOINT << 4));
+        /* Device capabilities: 256 byte max payload */
+        PCIDevSetDWord(pPciDev, 0xE0 + 4,                0x00000001);
+        /* Device control / status */
+        PCIDevSetWord( pPciDev, 0xE0 + 8,                    0x0000);
+        PCIDevSetWord( pPciDev, 0xE0 + 10,                   0x0000);
+        /* Link capabilities: 2.5 GT/s, x1 */
+        PCIDevSetDWord(pPciDev, 0xE0 + 12,               0x00000011);
+        /* Link control / status: 2.5 GT/s, x1 negotiated */
+        PCIDevSetWord( pPciDev, 0xE0 + 16,                   0x0000);
+        PCIDevSetWord( pPciDev, 0xE0 + 18,                   0x0011);
+    }
 }
 
 /**
@@ -7583,7 +8450,7 @@ static DECLCALLBACK(int) e1kR3Construct(PPDMDEVINS pDevIns, int iInstance, PCFGM
      */
     if (!CFGMR3AreValuesValid(pCfg, "MAC\0" "CableConnected\0" "AdapterType\0"
                                     "LineSpeed\0" "GCEnabled\0" "R0Enabled\0"
-                                    "ItrEnabled\0" "ItrRxEnabled\0"
+                                    "ItrEnabled\0" "ItrRxEnabled\0" "RxIntCoalescing\0"
                                     "EthernetCRC\0" "GSOEnabled\0" "LinkUpDelay\0"))
         return PDMDEV_SET_ERROR(pDevIns, VERR_PDM_DEVINS_UNKNOWN_CFG_VALUES,
                                 N_("Invalid configuration for E1000 device"));
@@ -7603,7 +8470,7 @@ static DECLCALLBACK(int) e1kR3Construct(PPDMDEVINS pDevIns, int iInstance, PCFGM
     if (RT_FAILURE(rc))
         return PDMDEV_SET_ERROR(pDevIns, rc,
                                 N_("Configuration error: Failed to get the value of 'AdapterType'"));
-    Assert(pThis->eChip <= E1K_CHIP_82545EM);
+    Assert(pThis->eChip <= E1K_CHIP_82574L);
     rc = CFGMR3QueryBoolDef(pCfg, "GCEnabled", &pThis->fRCEnabled, true);
     if (RT_FAILURE(rc))
         return PDMDEV_SET_ERROR(pDevIns, rc,
@@ -7634,6 +8501,16 @@ static DECLCALLBACK(int) e1kR3Construct(PPDMDEVINS pDevIns, int iInstance, PCFGM
         return PDMDEV_SET_ERROR(pDevIns, rc,
                                 N_("Configuration error: Failed to get the value of 'ItrRxEnabled'"));
 
+    uint32_t cUsRxIntCoalescing;
+    rc = CFGMR3QueryU32Def(pCfg, "RxIntCoalescing", &cUsRxIntCoalescing, 0); /* us */
+    if (RT_FAILURE(rc))
+        return PDMDEV_SET_ERROR(pDevIns, rc,
+                                N_("Configuration error: Failed to get the value of 'RxIntCoalescing'"));
+    if (cUsRxIntCoalescing > 10000)
+        return PDMDEV_SET_ERROR(pDevIns, VERR_OUT_OF_RANGE,
+                                N_("Configuration error: 'RxIntCoalescing' must not exceed 10000 microseconds"));
+    pThis->cNsRxIntCoalescing = cUsRxIntCoalescing * 1000;
+
     rc = CFGMR3QueryBoolDef(pCfg, "TidEnabled", &pThis->fTidEnabled, false);
     if (RT_FAILURE(rc))
         return PDMDEV_SET_ERROR(pDevIns, rc,
@@ -7649,12 +8526,13 @@ static DECLCALLBACK(int) e1kR3Construct(PPDMDEVINS pDevIns, int iInstance, PCFGM
     else if (pThis->cMsLinkUpDelay == 0)
         LogRel(("%s WARNING! Link up delay is disabled!\n", pThis->szPrf));
 
-    LogRel(("%s Chip=%s LinkUpDelay=%ums EthernetCRC=%s GSO=%s Itr=%s ItrRx=%s TID=%s R0=%s GC=%s\n", pThis->szPrf,
+    LogRel(("%s Chip=%s LinkUpDelay=%ums EthernetCRC=%s GSO=%s Itr=%s ItrRx=%s RxIntCoalescing=%uus TID=%s R0=%s GC=%s\n", pThis->szPrf,
             g_aChips[pThis->eChip].pcszName, pThis->cMsLinkUpDelay,
             pThis->fEthernetCRC ? "on" : "off",
             pThis->fGSOEnabled ? "enabled" : "disabled",
             pThis->fItrEnabled ? "enabled" : "disabled",
             pThis->fItrRxEnabled ? "enabled" : "disabled",
+            cUsRxIntCoalescing,
             pThis->fTidEnabled ? "enabled" : "disabled",
             pThis->fR0Enabled ? "enabled" : "disabled",
             pThis->fRCEnabled ? "enabled" : "disabled"));
@@ -7663,7 +8541,8 @@ static DECLCALLBACK(int) e1kR3Construct(PPDMDEVINS pDevIns, int iInstance, PCFGM
     pThis->eeprom.init(pThis->macConfigured);
 
     /* Initialize internal PHY. */
-    Phy::init(&pThis->phy, iInstance, pThis->eChip == E1K_CHIP_82543GC ? PHY_EPID_M881000 : PHY_EPID_M881011);
+    Phy::init(&pThis->phy, iInstance,   pThis->eChip == E1K_CHIP_82543GC ? PHY_EPID_M881000
+                                      : pThis->eChip == E1K_CHIP_82574L  ? PHY_EPID_BME1000 : PHY_EPID_M881011);
 
     /* Initialize critical sections. We do our own locking. */
     rc = PDMDevHlpSetDeviceCritSect(pDevIns, PDMDevHlpCritSectGetNop(pDevIns));
@@ -7706,6 +8585,26 @@ static DECLCALLBACK(int) e1kR3Construct(PPDMDEVINS pDevIns, int iInstance, PCFGM
     AssertRCReturn(rc, rc);
 #endif
 
+#ifdef VBOX_WITH_MSI_DEVICES
+    if (pThis->eChip == E1K_CHIP_82574L)
+    {
+        PDMMSIREG MsixReg;
+        RT_ZERO(MsixReg);
+        MsixReg.cMsixVectors    = E1K_MSIX_VECTORS;
+        MsixReg.iMsixCapOffset  = 0xA0;
+        MsixReg.iMsixNextOffset = 0x00;
+        MsixReg.iMsixBar        = 3;
+        rc = PDMDevHlpPCIRegisterMsi(pDevIns, &MsixReg);
+        if (RT_SUCCESS(rc))
+            pThis->offMsixCap = 0xA0;
+        else
+        {
+            /* Not fatal (e.g. PIIX3 chipset), we just stay with INTx. */
+            LogRel(("%s MSI-X registration failed (%Rrc), using INTx\n", pThis->szPrf, rc));
+            PCIDevSetByte(&pThis->pciDevice, 0xE0 + 1, 0x00);
+        }
+    }
+#endif
 
     /* Map our registers to memory space (region 0, see e1kConfigurePCI)*/
     rc = PDMDevHlpPCIIORegionRegister(pDevIns, 0, E1K_MM_SIZE, PCI_ADDRESS_SPACE_MEM, e1kMap);
@@ -7881,6 +8780,7 @@ static DECLCALLBACK(int) e1kR3Construct(PPDMDEVINS pDevIns, int iInstance, PCFGM
     PDMDevHlpSTAMRegisterF(pDevIns, &pThis->StatLateInts,           STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES,     "Number of late interrupts",          "/Devices/E1k%d/LateInt/Occured", iInstance);
     PDMDevHlpSTAMRegisterF(pDevIns, &pThis->StatIntsRaised,         STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES,     "Number of raised interrupts",        "/Devices/E1k%d/Interrupts/Raised", iInstance);
     PDMDevHlpSTAMRegisterF(pDevIns, &pThis->StatIntsPrevented,      STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES,     "Number of prevented interrupts",     "/Devices/E1k%d/Interrupts/Prevented", iInstance);
+    PDMDevHlpSTAMRegisterF(pDevIns, &pThis->StatIntsRxCoalesced,    STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES,     "Number of coalesced RX interrupts",  "/Devices/E1k%d/Interrupts/RxCoalesced", iInstance);
     PDMDevHlpSTAMRegisterF(pDevIns, &pThis->StatReceive,            STAMTYPE_PROFILE, STAMVISIBILITY_ALWAYS, STAMUNIT_TICKS_PER_CALL, "Profiling receive",                  "/Devices/E1k%d/Receive/Total", iInstance);
     PDMDevHlpSTAMRegisterF(pDevIns, &pThis->StatReceiveCRC,         STAMTYPE_PROFILE, STAMVISIBILITY_ALWAYS, STAMUNIT_TICKS_PER_CALL, "Profiling receive checksumming",     "/Devices/E1k%d/Receive/CRC", iInstance);
     PDMDevHlpSTAMRegisterF(pDevIns, &pThis->StatReceiveFilter,      STAMTYPE_PROFILE, STAMVISIBILITY_ALWAYS, STAMUNIT_TICKS_PER_CALL, "Profiling receive filtering",        "/Devices/E1k%d/Receive/Filter", iInstance);
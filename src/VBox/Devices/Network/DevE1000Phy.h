@@ -19,6 +19,7 @@
 
 #define PHY_EPID_M881000 0xC50
 #define PHY_EPID_M881011 0xC24
+#define PHY_EPID_BME1000 0xCB1
 
 #define PCTRL_SPDSELM 0x0040
 #define PCTRL_DUPMOD  0x0100
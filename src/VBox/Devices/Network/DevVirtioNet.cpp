@@ -31,11 +31,13 @@
 #include <iprt/semaphore.h>
 #ifdef IN_RING3
 # include <iprt/mem.h>
+# include <iprt/time.h>
 # include <iprt/uuid.h>
 #endif /* IN_RING3 */
 #include <VBox/VBoxPktDmp.h>
 #include "VBoxDD.h"
 #include "../VirtIO/Virtio.h"
+#include "NetLro.h"
 
 
 /*********************************************************************************************************************************
@@ -194,6 +196,19 @@ typedef struct VNetState_st
     /** EMT: Gets signalled when more RX descriptors become available. */
     RTSEMEVENT              hEventMoreRxDescAvail;
 
+    /** @name Large receive offload.
+     * @{ */
+    /** RX: The TCP segment coalescer, NULL if disabled. */
+    R3PTRTYPE(PNETLRO)      pLroR3;
+    /** Flushes coalesced segments still held when the traffic pauses. */
+    PTMTIMERR3              pLroTimer;
+    /** Maximum time to hold a segment for coalescing (nanoseconds). */
+    uint32_t                cNsLroTimeout;
+    uint32_t                alignment2;
+    /** Serializes the RX thread and the LRO flush timer. */
+    PDMCRITSECT             csLro;
+    /** @} */
+
     /** @name Statistic
      * @{ */
     STAMCOUNTER             StatReceiveBytes;
@@ -202,6 +217,8 @@ typedef struct VNetState_st
     STAMCOUNTER             StatTransmitPackets;
     STAMCOUNTER             StatTransmitGSO;
     STAMCOUNTER             StatTransmitCSum;
+    STAMCOUNTER             StatLroTimeouts;
+    STAMCOUNTER             StatLroNoRoom;
 #if defined(VBOX_WITH_STATISTICS)
     STAMPROFILE             StatReceive;
     STAMPROFILE             StatReceiveStore;
@@ -495,6 +512,13 @@ static DECLCALLBACK(int) vnetIoCb_Reset(void *pvState)
 #ifndef IN_RING3
     return VINF_IOM_R3_IOPORT_WRITE;
 #else
+    if (pThis->pLroR3)
+    {
+        /* The guest's RX buffers are gone, drop whatever is being coalesced. */
+        PDMCritSectEnter(&pThis->csLro, VERR_SEM_BUSY);
+        NetLroDiscard(pThis->pLroR3);
+        PDMCritSectLeave(&pThis->csLro);
+    }
     if (pThis->pDrv)
         pThis->pDrv->pfnSetPromiscuousMode(pThis->pDrv, true);
     return VINF_SUCCESS;
@@ -925,6 +949,124 @@ static int vnetHandleRxPacket(PVNETSTATE pThis, const void *pvBuf, size_t cb,
     return VINF_SUCCESS;
 }
 
+/**
+ * Checks whether the guest has posted enough receive buffers to store a
+ * packet completely.
+ *
+ * @returns true if the packet fits.
+ * @param   pThis           The device state structure.
+ * @param   cb              The size of the packet.
+ * @thread  RX
+ */
+static bool vnetRxHasRoom(PVNETSTATE pThis, size_t cb)
+{
+    /* Without mergeable buffers the packet has to go into a single one. */
+    if (!vnetMergeableRxBuffers(pThis))
+        return !vqueueIsEmpty(&pThis->VPCI, pThis->pRxQueue);
+
+    /* Walk the available buffers and put them back afterwards. */
+    uint16_t const uNextAvailIndex = pThis->pRxQueue->uNextAvailIndex;
+    size_t         cbAvail         = 0;
+    VQUEUEELEM     elem;
+    cb += sizeof(VNETHDRMRX);
+    while (cbAvail < cb && vqueueGet(&pThis->VPCI, pThis->pRxQueue, &elem))
+        for (unsigned i = 0; i < elem.nIn; i++)
+            cbAvail += elem.aSegsIn[i].cb;
+    pThis->pRxQueue->uNextAvailIndex = uNextAvailIndex;
+    return cbAvail >= cb;
+}
+
+/**
+ * @callback_method_impl{FNNETLRODELIVER}
+ *
+ * A single NetLroReceive or NetLroFlush call may deliver several frames while
+ * vnetCanReceive was only checked once, so each frame is checked to fit.  One
+ * that doesn't is dropped instead of leaving a partially filled buffer chain.
+ */
+static DECLCALLBACK(int) vnetLroDeliver(void *pvUser, const void *pvFrame, size_t cbFrame, PCPDMNETWORKGSO pGso)
+{
+    PVNETSTATE pThis = (PVNETSTATE)pvUser;
+    if (!vnetRxHasRoom(pThis, cbFrame))
+    {
+        STAM_REL_COUNTER_INC(&pThis->StatLroNoRoom);
+        return VERR_NET_NO_BUFFER_SPACE;
+    }
+    return vnetHandleRxPacket(pThis, pvFrame, cbFrame, pGso);
+}
+
+/**
+ * Returns the GSO types (as RT_BIT_32(PDMNETWORKGSOTYPE_XXX) mask) the guest
+ * can receive, i.e. the types received TCP segments may be coalesced into.
+ */
+DECLINLINE(uint32_t) vnetLroGsoTypes(PVNETSTATE pThis)
+{
+    uint32_t fTypes = 0;
+    if (pThis->VPCI.uGuestFeatures & VNET_F_GUEST_TSO4)
+        fTypes |= RT_BIT_32(PDMNETWORKGSOTYPE_IPV4_TCP);
+    if (pThis->VPCI.uGuestFeatures & VNET_F_GUEST_TSO6)
+        fTypes |= RT_BIT_32(PDMNETWORKGSOTYPE_IPV6_TCP);
+    return fTypes;
+}
+
+/**
+ * Stores a received packet, coalescing TCP segments when LRO is enabled.
+ *
+ * @returns VBox status code.
+ * @param   pThis           The device state structure.
+ * @param   pvBuf           The available data.
+ * @param   cb              Number of bytes available in the buffer.
+ * @param   pGso            The GSO context of the packet, NULL if none.
+ * @thread  RX
+ */
+static int vnetLroHandleRxPacket(PVNETSTATE pThis, const void *pvBuf, size_t cb, PCPDMNETWORKGSO pGso)
+{
+    if (!pThis->pLroR3)
+        return vnetHandleRxPacket(pThis, pvBuf, cb, pGso);
+
+    int rc = PDMCritSectEnter(&pThis->csLro, VERR_SEM_BUSY);
+    AssertRCReturn(rc, rc);
+
+    uint32_t const fGsoTypes = vnetLroGsoTypes(pThis);
+    if (!pGso && fGsoTypes)
+        rc = NetLroReceive(pThis->pLroR3, pvBuf, cb, fGsoTypes, RTTimeNanoTS());
+    else
+    {
+        /* Keep the order, anything held goes first. */
+        NetLroFlush(pThis->pLroR3, UINT64_MAX);
+        rc = vnetRxHasRoom(pThis, cb) ? vnetHandleRxPacket(pThis, pvBuf, cb, pGso) : VERR_NET_NO_BUFFER_SPACE;
+    }
+
+    if (   NetLroGetOldest(pThis->pLroR3) != UINT64_MAX
+        && !TMTimerIsActive(pThis->pLroTimer))
+        TMTimerSetNano(pThis->pLroTimer, pThis->cNsLroTimeout);
+
+    PDMCritSectLeave(&pThis->csLro);
+    return rc;
+}
+
+/**
+ * @callback_method_impl{FNTMTIMERDEV, Flushes held segments when no more arrive.}
+ */
+static DECLCALLBACK(void) vnetLroTimer(PPDMDEVINS pDevIns, PTMTIMER pTimer, void *pvUser)
+{
+    RT_NOREF(pDevIns);
+    PVNETSTATE pThis = (PVNETSTATE)pvUser;
+
+    if (PDMCritSectEnter(&pThis->csLro, VERR_SEM_BUSY) != VINF_SUCCESS)
+        return;
+    if (NetLroGetOldest(pThis->pLroR3) != UINT64_MAX)
+    {
+        if (RT_SUCCESS(vnetCanReceive(pThis)))
+        {
+            STAM_REL_COUNTER_INC(&pThis->StatLroTimeouts);
+            NetLroFlush(pThis->pLroR3, UINT64_MAX);
+        }
+        else
+            TMTimerSetNano(pTimer, pThis->cNsLroTimeout); /* No RX buffers yet, try again later. */
+    }
+    PDMCritSectLeave(&pThis->csLro);
+}
+
 /**
  * @interface_method_impl{PDMINETWORKDOWN,pfnReceiveGso}
  */
@@ -980,7 +1122,7 @@ static DECLCALLBACK(int) vnetNetworkDown_ReceiveGso(PPDMINETWORKDOWN pInterface,
         rc = vnetCsRxEnter(pThis, VERR_SEM_BUSY);
         if (RT_SUCCESS(rc))
         {
-            rc = vnetHandleRxPacket(pThis, pvBuf, cb, pGso);
+            rc = vnetLroHandleRxPacket(pThis, pvBuf, cb, pGso);
             STAM_REL_COUNTER_ADD(&pThis->StatReceiveBytes, cb);
             vnetCsRxLeave(pThis);
         }
@@ -1133,6 +1275,10 @@ DECLINLINE(PPDMNETWORKGSO) vnetSetupGsoCtx(PPDMNETWORKGSO pGso, VNETHDR const *p
 
 DECLINLINE(uint16_t) vnetCSum16(const void *pvBuf, size_t cb)
 {
+#ifndef IN_RC
+    bool fOdd = false;
+    return RTNetIPv4FinalizeChecksum(RTNetIPv4AddDataChecksum(pvBuf, cb, 0, &fOdd));
+#else
     uint32_t  csum = 0;
     uint16_t *pu16 = (uint16_t *)pvBuf;
 
@@ -1146,6 +1292,7 @@ DECLINLINE(uint16_t) vnetCSum16(const void *pvBuf, size_t cb)
     while (csum >> 16)
         csum = (csum >> 16) + (csum & 0xFFFF);
     return ~csum;
+#endif
 }
 
 DECLINLINE(void) vnetCompleteChecksum(uint8_t *pBuf, unsigned cbSize, uint16_t uStart, uint16_t uOffset)
@@ -1905,6 +2052,16 @@ static DECLCALLBACK(int) vnetAttach(PPDMDEVINS pDevIns, unsigned iLUN, uint32_t
  */
 static DECLCALLBACK(void) vnetSuspend(PPDMDEVINS pDevIns)
 {
+    PVNETSTATE pThis = PDMINS_2_DATA(pDevIns, PVNETSTATE);
+
+    /* Hand over what is still being coalesced before the state gets saved. */
+    if (pThis->pLroR3)
+    {
+        PDMCritSectEnter(&pThis->csLro, VERR_SEM_BUSY);
+        NetLroFlush(pThis->pLroR3, UINT64_MAX);
+        PDMCritSectLeave(&pThis->csLro);
+    }
+
     /* Poke thread waiting for buffer space. */
     vnetWakeupReceive(pDevIns);
 }
@@ -1956,6 +2113,14 @@ static DECLCALLBACK(int) vnetDestruct(PPDMDEVINS pDevIns)
     // if (PDMCritSectIsInitialized(&pThis->csRx))
     //     PDMR3CritSectDelete(&pThis->csRx);
 
+    if (pThis->pLroR3)
+    {
+        NetLroDestroy(pThis->pLroR3);
+        pThis->pLroR3 = NULL;
+    }
+    if (PDMCritSectIsInitialized(&pThis->csLro))
+        PDMR3CritSectDelete(&pThis->csLro);
+
     return vpciDestruct(&pThis->VPCI);
 }
 
@@ -1990,7 +2155,8 @@ static DECLCALLBACK(int) vnetConstruct(PPDMDEVINS pDevIns, int iInstance, PCFGMN
     /*
      * Validate configuration.
      */
-    if (!CFGMR3AreValuesValid(pCfg, "MAC\0" "CableConnected\0" "LineSpeed\0" "LinkUpDelay\0"))
+    if (!CFGMR3AreValuesValid(pCfg, "MAC\0" "CableConnected\0" "LineSpeed\0" "LinkUpDelay\0"
+                                    "LROEnabled\0" "LROTimeout\0"))
                     return PDMDEV_SET_ERROR(pDevIns, VERR_PDM_DEVINS_UNKNOWN_CFG_VALUES,
                                             N_("Invalid configuration for VirtioNet device"));
 
@@ -2017,6 +2183,21 @@ static DECLCALLBACK(int) vnetConstruct(PPDMDEVINS pDevIns, int iInstance, PCFGMN
     Log(("%s Link up delay is set to %u seconds\n",
          INSTANCE(pThis), pThis->cMsLinkUpDelay / 1000));
 
+    bool fLroEnabled;
+    rc = CFGMR3QueryBoolDef(pCfg, "LROEnabled", &fLroEnabled, false);
+    if (RT_FAILURE(rc))
+        return PDMDEV_SET_ERROR(pDevIns, rc,
+                                N_("Configuration error: Failed to get the value of 'LROEnabled'"));
+    uint32_t cUsLroTimeout;
+    rc = CFGMR3QueryU32Def(pCfg, "LROTimeout", &cUsLroTimeout, 100); /* us */
+    if (RT_FAILURE(rc))
+        return PDMDEV_SET_ERROR(pDevIns, rc,
+                                N_("Configuration error: Failed to get the value of 'LROTimeout'"));
+    if (cUsLroTimeout == 0 || cUsLroTimeout > 10000)
+        return PDMDEV_SET_ERROR(pDevIns, VERR_OUT_OF_RANGE,
+                                N_("Configuration error: 'LROTimeout' must be between 1 and 10000 microseconds"));
+    pThis->cNsLroTimeout = cUsLroTimeout * 1000;
+
 
     vnetPrintFeatures(pThis, vnetIoCb_GetHostFeatures(pThis), "Device supports the following features");
 
@@ -2075,6 +2256,23 @@ static DECLCALLBACK(int) vnetConstruct(PPDMDEVINS pDevIns, int iInstance, PCFGMN
     if (RT_FAILURE(rc))
         return rc;
 
+    if (fLroEnabled)
+    {
+        /* Receive coalescing, only in effect once the guest accepts TSO frames. */
+        rc = PDMDevHlpCritSectInit(pDevIns, &pThis->csLro, RT_SRC_POS, "%sLRO", INSTANCE(pThis));
+        if (RT_FAILURE(rc))
+            return rc;
+        rc = PDMDevHlpTMTimerCreate(pDevIns, TMCLOCK_VIRTUAL, vnetLroTimer, pThis,
+                                    TMTIMER_FLAGS_NO_CRIT_SECT,
+                                    "VirtioNet LRO Flush Timer", &pThis->pLroTimer);
+        if (RT_FAILURE(rc))
+            return rc;
+        rc = NetLroCreate(4, vnetLroDeliver, pThis, &pThis->pLroR3);
+        if (RT_FAILURE(rc))
+            return rc;
+        LogRel(("%s Large receive offload enabled, timeout %u us\n", INSTANCE(pThis), cUsLroTimeout));
+    }
+
 #ifdef VNET_TX_DELAY
     /* Create Transmit Delay Timer */
     rc = PDMDevHlpTMTimerCreate(pDevIns, TMCLOCK_VIRTUAL, vnetTxTimer, pThis,
@@ -2126,6 +2324,16 @@ static DECLCALLBACK(int) vnetConstruct(PPDMDEVINS pDevIns, int iInstance, PCFGMN
     PDMDevHlpSTAMRegisterF(pDevIns, &pThis->StatTransmitPackets,    STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_COUNT,          "Number of sent packets",             "/Devices/VNet%d/Packets/Transmit", iInstance);
     PDMDevHlpSTAMRegisterF(pDevIns, &pThis->StatTransmitGSO,        STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_COUNT,          "Number of sent GSO packets",         "/Devices/VNet%d/Packets/Transmit-Gso", iInstance);
     PDMDevHlpSTAMRegisterF(pDevIns, &pThis->StatTransmitCSum,       STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_COUNT,          "Number of completed TX checksums",   "/Devices/VNet%d/Packets/Transmit-Csum", iInstance);
+    if (pThis->pLroR3)
+    {
+        PDMDevHlpSTAMRegisterF(pDevIns, &pThis->pLroR3->StatSegsMerged,     STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_COUNT,      "Number of received segments merged into a previous one", "/Devices/VNet%d/LRO/SegsMerged", iInstance);
+        PDMDevHlpSTAMRegisterF(pDevIns, &pThis->pLroR3->StatFramesMerged,   STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_COUNT,      "Number of coalesced GSO frames delivered", "/Devices/VNet%d/LRO/FramesMerged", iInstance);
+        PDMDevHlpSTAMRegisterF(pDevIns, &pThis->pLroR3->StatFramesBypassed, STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_COUNT,      "Number of frames passed through", "/Devices/VNet%d/LRO/FramesBypassed", iInstance);
+        PDMDevHlpSTAMRegisterF(pDevIns, &pThis->pLroR3->StatEvictions,      STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES, "Number of flows flushed to make room for another", "/Devices/VNet%d/LRO/Evictions", iInstance);
+        PDMDevHlpSTAMRegisterF(pDevIns, &pThis->pLroR3->StatSegsBadCsum,    STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_COUNT,      "Number of segments not merged because of a bad checksum", "/Devices/VNet%d/LRO/SegsBadCsum", iInstance);
+        PDMDevHlpSTAMRegisterF(pDevIns, &pThis->StatLroTimeouts,            STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES, "Number of flushes by the LRO timer", "/Devices/VNet%d/LRO/Timeouts", iInstance);
+        PDMDevHlpSTAMRegisterF(pDevIns, &pThis->StatLroNoRoom,              STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_COUNT,      "Number of frames dropped for lack of RX buffers", "/Devices/VNet%d/LRO/NoRoom", iInstance);
+    }
 #if defined(VBOX_WITH_STATISTICS)
     PDMDevHlpSTAMRegisterF(pDevIns, &pThis->StatReceive,            STAMTYPE_PROFILE, STAMVISIBILITY_ALWAYS, STAMUNIT_TICKS_PER_CALL, "Profiling receive",                  "/Devices/VNet%d/Receive/Total", iInstance);
     PDMDevHlpSTAMRegisterF(pDevIns, &pThis->StatReceiveStore,       STAMTYPE_PROFILE, STAMVISIBILITY_ALWAYS, STAMUNIT_TICKS_PER_CALL, "Profiling receive storing",          "/Devices/VNet%d/Receive/Store", iInstance);
@@ -143,6 +143,12 @@ typedef struct DRVINTNET
     bool                            fActivateEarlyDeactivateLate;
     /** Padding. */
     bool                            afReserved[HC_ARCH_BITS == 64 ? 3 : 3];
+    /** Number of frames committed to the send ring since it was last pushed
+     * thru the switch.  Protected by the XmitLock. */
+    uint32_t                        cXmitPending;
+    /** The max number of frames to batch up in the send ring before calling
+     * ring-0 to push them thru the switch (ring-3 only, see SendBatchMax). */
+    uint32_t                        cXmitBatchMax;
     /** Scratch space for holding the ring-0 scatter / gather descriptor.
      * The PDMSCATTERGATHER::fFlags member is used to indicate whether it is in
      * use or not.  Always accessed while owning the XmitLock. */
@@ -168,6 +174,10 @@ typedef struct DRVINTNET
     STAMCOUNTER                     StatXmitWakeupR3;
     /** The times the xmit thread has been told to process the ring. */
     STAMCOUNTER                     StatXmitProcessRing;
+    /** Number of frames pushed thru the switch per send call. */
+    STAMPROFILE                     StatXmitFramesPerCall;
+    /** Number of frames received per receive thread wakeup. */
+    STAMPROFILE                     StatRecvFramesPerWakeup;
 #ifdef VBOX_WITH_STATISTICS
     /** Profiling packet transmit runs. */
     STAMPROFILE                     StatTransmit;
@@ -293,6 +303,12 @@ DECLINLINE(int) drvIntNetProcessXmit(PDRVINTNET pThis)
 {
     Assert(PDMCritSectIsOwner(&pThis->XmitLock));
 
+    if (pThis->cXmitPending)
+    {
+        STAM_REL_PROFILE_ADD_PERIOD(&pThis->StatXmitFramesPerCall, pThis->cXmitPending);
+        pThis->cXmitPending = 0;
+    }
+
 #ifdef IN_RING3
     INTNETIFSENDREQ SendReq;
     SendReq.Hdr.u32Magic = SUPVMMR0REQHDR_MAGIC;
@@ -507,7 +523,17 @@ PDMBOTHCBDECL(int) drvIntNetUp_SendBuf(PPDMINETWORKUP pInterface, PPDMSCATTERGAT
      */
     PINTNETHDR pHdr = (PINTNETHDR)pSgBuf->pvAllocator;
     IntNetRingCommitFrameEx(&pThis->CTX_SUFF(pBuf)->Send, pHdr, pSgBuf->cbUsed);
+    pThis->cXmitPending++;
+#ifdef IN_RING3
+    /* In ring-3 each push costs a trip to ring-0, so batch up frames and leave
+       it to EndXmit (or AllocBuf when the ring fills up) unless we've got
+       enough of them already. */
+    int rc = VINF_SUCCESS;
+    if (pThis->cXmitPending >= pThis->cXmitBatchMax)
+        rc = drvIntNetProcessXmit(pThis);
+#else
     int rc = drvIntNetProcessXmit(pThis);
+#endif
     STAM_PROFILE_STOP(&pThis->StatTransmit, a);
 
     /*
@@ -529,6 +555,11 @@ PDMBOTHCBDECL(int) drvIntNetUp_SendBuf(PPDMINETWORKUP pInterface, PPDMSCATTERGAT
 PDMBOTHCBDECL(void) drvIntNetUp_EndXmit(PPDMINETWORKUP pInterface)
 {
     PDRVINTNET pThis = RT_FROM_MEMBER(pInterface, DRVINTNET, CTX_SUFF(INetworkUp));
+#ifdef IN_RING3
+    /* Flush the frames batched up by drvIntNetUp_SendBuf. */
+    if (pThis->cXmitPending)
+        drvIntNetProcessXmit(pThis);
+#endif
     ASMAtomicUoWriteBool(&pThis->fXmitOnXmitThread, false);
     PDMCritSectLeave(&pThis->XmitLock);
 }
@@ -693,9 +724,11 @@ static int drvR3IntNetRecvRun(PDRVINTNET pThis)
         /*
          * Process the receive buffer.
          */
+        uint32_t   cFrames = 0;
         PINTNETHDR pHdr;
         while ((pHdr = IntNetRingGetNextFrameToRead(pRingBuf)) != NULL)
         {
+            cFrames++;
             /*
              * Check the state and then inspect the packet.
              */
@@ -841,6 +874,9 @@ static int drvR3IntNetRecvRun(PDRVINTNET pThis)
             }
         } /* while more received data */
 
+        if (cFrames)
+            STAM_REL_PROFILE_ADD_PERIOD(&pThis->StatRecvFramesPerWakeup, cFrames);
+
         /*
          * Wait for data, checking the state before we block.
          */
@@ -1227,6 +1263,8 @@ static DECLCALLBACK(void) drvR3IntNetDestruct(PPDMDRVINS pDrvIns)
         PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->pBufR3->cStatYieldsNok);
         PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->pBufR3->cStatLost);
         PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->pBufR3->cStatBadFrames);
+        PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->pBufR3->cStatRecvWakeups);
+        PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->pBufR3->cStatRecvWakeupsCoalesced);
         PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->pBufR3->StatSend1);
         PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->pBufR3->StatSend2);
         PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->pBufR3->StatRecv1);
@@ -1241,6 +1279,8 @@ static DECLCALLBACK(void) drvR3IntNetDestruct(PPDMDRVINS pDrvIns)
         PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->StatXmitWakeupR0);
         PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->StatXmitWakeupR3);
         PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->StatXmitProcessRing);
+        PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->StatXmitFramesPerCall);
+        PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->StatRecvFramesPerWakeup);
     }
 
     /*
@@ -1409,7 +1449,8 @@ static DECLCALLBACK(int) drvR3IntNetConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pCfg
                                   "|TrunkPolicyWire"
                                   "|IsService"
                                   "|IgnoreConnectFailure"
-                                  "|Workaround1",
+                                  "|Workaround1"
+                                  "|SendBatchMax",
                                   "");
 
     /*
@@ -1700,6 +1741,15 @@ static DECLCALLBACK(int) drvR3IntNetConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pCfg
     if (fWorkaround1)
         OpenReq.fFlags |= INTNET_OPEN_FLAGS_WORKAROUND_1;
 
+    /** @cfgm{SendBatchMax, uint32_t, 32}
+     * The max number of frames a NIC may queue up in the send ring from ring-3
+     * before we call ring-0 to push them thru the switch.  Anything queued is
+     * pushed when the NIC ends the transmit run.  0 or 1 disables batching. */
+    rc = CFGMR3QueryU32Def(pCfg, "SendBatchMax", &pThis->cXmitBatchMax, 32);
+    if (RT_FAILURE(rc))
+        return PDMDRV_SET_ERROR(pDrvIns, rc,
+                                N_("Configuration error: Failed to get the \"SendBatchMax\" value"));
+
     LogRel(("IntNet#%u: szNetwork={%s} enmTrunkType=%d szTrunk={%s} fFlags=%#x cbRecv=%u cbSend=%u fIgnoreConnectFailure=%RTbool\n",
             pDrvIns->iInstance, OpenReq.szNetwork, OpenReq.enmTrunkType, OpenReq.szTrunk, OpenReq.fFlags,
             OpenReq.cbRecv, OpenReq.cbSend, fIgnoreConnectFailure));
@@ -1806,6 +1856,8 @@ static DECLCALLBACK(int) drvR3IntNetConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pCfg
     PDMDrvHlpSTAMRegCounter(pDrvIns, &pThis->pBufR3->cStatYieldsNok,     "YieldOk",              "Number of times yielding helped fix an overflow.");
     PDMDrvHlpSTAMRegCounter(pDrvIns, &pThis->pBufR3->cStatYieldsOk,      "YieldNok",             "Number of times yielding didn't help fix an overflow.");
     PDMDrvHlpSTAMRegCounter(pDrvIns, &pThis->pBufR3->cStatBadFrames,     "BadFrames",            "Number of bad frames seed by the consumers.");
+    PDMDrvHlpSTAMRegCounter(pDrvIns, &pThis->pBufR3->cStatRecvWakeups,   "RecvWakeups",          "Number of times the receive thread was woken up.");
+    PDMDrvHlpSTAMRegCounter(pDrvIns, &pThis->pBufR3->cStatRecvWakeupsCoalesced, "RecvWakeupsCoalesced", "Number of receive wakeups coalesced into a pending one.");
     PDMDrvHlpSTAMRegProfile(pDrvIns, &pThis->pBufR3->StatSend1,          "Send1",                "Profiling IntNetR0IfSend.");
     PDMDrvHlpSTAMRegProfile(pDrvIns, &pThis->pBufR3->StatSend2,          "Send2",                "Profiling sending to the trunk.");
     PDMDrvHlpSTAMRegProfile(pDrvIns, &pThis->pBufR3->StatRecv1,          "Recv1",                "Reserved for future receive profiling.");
@@ -1818,6 +1870,8 @@ static DECLCALLBACK(int) drvR3IntNetConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pCfg
     PDMDrvHlpSTAMRegCounter(pDrvIns, &pThis->StatXmitWakeupR0,           "XmitWakeup-R0",        "Xmit thread wakeups from ring-0.");
     PDMDrvHlpSTAMRegCounter(pDrvIns, &pThis->StatXmitWakeupR3,           "XmitWakeup-R3",        "Xmit thread wakeups from ring-3.");
     PDMDrvHlpSTAMRegCounter(pDrvIns, &pThis->StatXmitProcessRing,        "XmitProcessRing",      "Time xmit thread was told to process the ring.");
+    PDMDrvHlpSTAMRegProfileEx(pDrvIns, &pThis->StatXmitFramesPerCall,    "XmitFramesPerCall",    STAMUNIT_OCCURENCES, "Frames pushed thru the switch per send call.");
+    PDMDrvHlpSTAMRegProfileEx(pDrvIns, &pThis->StatRecvFramesPerWakeup,  "RecvFramesPerWakeup",  STAMUNIT_OCCURENCES, "Frames received per receive thread wakeup.");
 
     /*
      * Create the async I/O threads.
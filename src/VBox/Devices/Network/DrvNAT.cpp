@@ -176,9 +176,14 @@ typedef struct DRVNAT
     RTPIPE                  hPipeWrite;
     /** The read end of the control pipe. */
     RTPIPE                  hPipeRead;
-# if HC_ARCH_BITS == 32
+    /** Poll array handed to slirp, kept across iterations of the I/O thread
+     * and only grown when the number of sockets exceeds its size. */
+    struct pollfd          *paPolls;
+    /** Number of entries allocated in paPolls. */
+    uint32_t                cPollsAlloc;
+    /** Alignment padding.  Needed on 32-bit and 64-bit hosts alike now that
+     * cPollsAlloc follows three pointers (it was 32-bit only before). */
     uint32_t                u32Padding;
-# endif
 #else
     /** for external notification */
     HANDLE                  hWakeupEvent;
@@ -808,10 +813,17 @@ static DECLCALLBACK(int) drvNATAsyncIoThread(PPDMDRVINS pDrvIns, PPDMTHREAD pThr
          */
 #ifndef RT_OS_WINDOWS
         nFDs = slirp_get_nsock(pThis->pNATState);
-        /* allocation for all sockets + Management pipe */
-        struct pollfd *polls = (struct pollfd *)RTMemAlloc((1 + nFDs) * sizeof(struct pollfd) + sizeof(uint32_t));
-        if (polls == NULL)
-            return VERR_NO_MEMORY;
+        /* room for all sockets + Management pipe, reusing the previous array if it is big enough */
+        if ((uint32_t)nFDs + 1 > pThis->cPollsAlloc)
+        {
+            uint32_t cNew = RT_ALIGN_32((uint32_t)nFDs + 1, 64);
+            struct pollfd *paNew = (struct pollfd *)RTMemRealloc(pThis->paPolls, cNew * sizeof(struct pollfd));
+            if (paNew == NULL)
+                return VERR_NO_MEMORY;
+            pThis->paPolls     = paNew;
+            pThis->cPollsAlloc = cNew;
+        }
+        struct pollfd *polls = pThis->paPolls;
 
         /* don't pass the management pipe */
         slirp_select_fill(pThis->pNATState, &nFDs, &polls[1]);
@@ -821,7 +833,12 @@ static DECLCALLBACK(int) drvNATAsyncIoThread(PPDMDRVINS pDrvIns, PPDMTHREAD pThr
         polls[0].events = POLLRDNORM | POLLPRI | POLLRDBAND;
         polls[0].revents = 0;
 
+# ifdef RT_OS_LINUX
+        /* epoll set kept in sync with the fill results, see slirp_select_wait */
+        int cChangedFDs = slirp_select_wait(pThis->pNATState, polls, nFDs, slirp_get_timeout_ms(pThis->pNATState));
+# else
         int cChangedFDs = poll(polls, nFDs + 1, slirp_get_timeout_ms(pThis->pNATState));
+# endif
         if (cChangedFDs < 0)
         {
             if (errno == EINTR)
@@ -861,7 +878,6 @@ static DECLCALLBACK(int) drvNATAsyncIoThread(PPDMDRVINS pDrvIns, PPDMTHREAD pThr
         }
         /* process _all_ outstanding requests but don't wait */
         RTReqQueueProcess(pThis->hSlirpReqQueue, 0);
-        RTMemFree(polls);
 
 #else /* RT_OS_WINDOWS */
         nFDs = -1;
@@ -1469,6 +1485,12 @@ static DECLCALLBACK(void) drvNATDestruct(PPDMDRVINS pDrvIns)
         pThis->pNATState = NULL;
     }
 
+#ifndef RT_OS_WINDOWS
+    RTMemFree(pThis->paPolls);
+    pThis->paPolls     = NULL;
+    pThis->cPollsAlloc = 0;
+#endif
+
     RTReqQueueDestroy(pThis->hHostResQueue);
     pThis->hHostResQueue = NIL_RTREQQUEUE;
 
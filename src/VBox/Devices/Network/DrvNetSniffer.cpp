@@ -23,11 +23,18 @@
 #include <VBox/vmm/pdmdrv.h>
 #include <VBox/vmm/pdmnetifs.h>
 
+#include <VBox/vmm/pdmnetinline.h>
+
 #include <VBox/log.h>
+#include <iprt/asm.h>
 #include <iprt/assert.h>
 #include <iprt/critsect.h>
+#include <iprt/ctype.h>
 #include <iprt/file.h>
+#include <iprt/mem.h>
+#include <iprt/net.h>
 #include <iprt/process.h>
+#include <iprt/semaphore.h>
 #include <iprt/string.h>
 #include <iprt/time.h>
 #include <iprt/uuid.h>
@@ -38,9 +45,80 @@
 #include "VBoxDD.h"
 
 
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** Maximum number of nodes in a compiled capture filter. */
+#define DRVNETSNIFFER_FILTER_MAX_NODES  32
+/** Ring record type of the padding record at the end of the ring buffer. */
+#define DRVNETSNIFFER_RING_BT_PAD       UINT32_C(0x80000001)
+/** Default size of the capture ring buffer. */
+#define DRVNETSNIFFER_RING_SIZE_DEF     _4M
+/** Minimum size of the capture ring buffer. */
+#define DRVNETSNIFFER_RING_SIZE_MIN     _256K
+/** Maximum number of bytes the writer thread hands to a single RTFileWrite. */
+#define DRVNETSNIFFER_WRITE_CHUNK       _1M
+
+
 /*********************************************************************************************************************************
 *   Structures and Typedefs                                                                                                      *
 *********************************************************************************************************************************/
+/**
+ * Capture filter node operation.
+ */
+typedef enum DRVNETSNIFFERFLTOP
+{
+    DRVNETSNIFFERFLTOP_INVALID = 0,
+    DRVNETSNIFFERFLTOP_AND,
+    DRVNETSNIFFERFLTOP_OR,
+    DRVNETSNIFFERFLTOP_NOT,
+    /** Ethertype (after VLAN tags) equals uValue. */
+    DRVNETSNIFFERFLTOP_ETHERTYPE,
+    /** VLAN tagged frame. */
+    DRVNETSNIFFERFLTOP_VLAN,
+    /** IPv4/IPv6 protocol / next header equals uValue. */
+    DRVNETSNIFFERFLTOP_IPPROTO,
+    /** IPv4 source or destination address equals uValue. */
+    DRVNETSNIFFERFLTOP_HOST,
+    DRVNETSNIFFERFLTOP_SRC_HOST,
+    DRVNETSNIFFERFLTOP_DST_HOST,
+    /** TCP/UDP source or destination port equals uValue. */
+    DRVNETSNIFFERFLTOP_PORT,
+    DRVNETSNIFFERFLTOP_SRC_PORT,
+    DRVNETSNIFFERFLTOP_DST_PORT
+} DRVNETSNIFFERFLTOP;
+
+/**
+ * Capture filter node.
+ */
+typedef struct DRVNETSNIFFERFLTNODE
+{
+    /** The operation. */
+    uint8_t                 enmOp;
+    /** Left operand (AND, OR, NOT). */
+    uint8_t                 iLeft;
+    /** Right operand (AND, OR). */
+    uint8_t                 iRight;
+    /** Comparison value, host byte order. */
+    uint32_t                uValue;
+} DRVNETSNIFFERFLTNODE;
+
+/**
+ * Header fields a capture filter is evaluated against.
+ */
+typedef struct DRVNETSNIFFERPKTINFO
+{
+    uint16_t                uEtherType;
+    bool                    fVlan;
+    bool                    fIPv4;
+    bool                    fPorts;
+    uint8_t                 uIpProto;
+    uint16_t                uSrcPort;
+    uint16_t                uDstPort;
+    uint32_t                uSrcAddr;
+    uint32_t                uDstAddr;
+} DRVNETSNIFFERPKTINFO;
+
 /**
  * Block driver instance data.
  *
@@ -76,10 +154,708 @@ typedef struct DRVNETSNIFFER
     /** For when we're the leaf driver. */
     RTCRITSECT              XmitLock;
 
+    /** Maximum number of bytes to capture per frame. */
+    uint32_t                cbSnapLen;
+    /** Number of nodes in the capture filter, 0 if everything is captured. */
+    uint32_t                cFltNodes;
+    /** Index of the capture filter root node. */
+    uint32_t                iFltRoot;
+    /** The compiled capture filter. */
+    DRVNETSNIFFERFLTNODE    aFltNodes[DRVNETSNIFFER_FILTER_MAX_NODES];
+
+    /** @name Asynchronous capture mode.
+     * Frames are stored as pcapng Enhanced Packet Blocks in a multi-producer,
+     * single-consumer ring which a writer thread drains to the file.  A block
+     * is published by writing its block type last, the writer zeroes the whole
+     * block again before handing the space back to the producers so that stale
+     * payload can never be mistaken for a block header.
+     * @{ */
+    /** Whether asynchronous capture is enabled. */
+    bool                    fAsync;
+    /** Set while the writer thread waits for work. */
+    bool volatile           fWriterWaiting;
+    /** Set when the writer found an invalid block, capturing stops. */
+    bool volatile           fRingCorrupt;
+    /** The ring buffer. */
+    uint8_t                *pbRing;
+    /** Size of the ring buffer, power of two. */
+    uint32_t                cbRing;
+    /** Producer position (bytes reserved since start). */
+    uint64_t volatile       offRingHead;
+    /** Consumer position (bytes consumed since start). */
+    uint64_t volatile       offRingTail;
+    /** Event the writer thread waits on. */
+    RTSEMEVENT              hEvtWriter;
+    /** The writer thread. */
+    PPDMTHREAD              pWriterThread;
+    /** Rotate to the next file after this many bytes, 0 for no rotation. */
+    uint64_t                cbFileMax;
+    /** Number of files to rotate through. */
+    uint32_t                cFilesMax;
+    /** Current file index. */
+    uint32_t                iFile;
+    /** Bytes written to the current file. */
+    uint64_t                cbFile;
+    /** Difference between RTTimeNanoTS and nanoseconds since the epoch. */
+    uint64_t                offEpochNs;
+    /** @} */
+
+    /** Number of frames captured. */
+    STAMCOUNTER             StatCaptured;
+    /** Number of bytes captured. */
+    STAMCOUNTER             StatCapturedBytes;
+    /** Number of frames rejected by the capture filter. */
+    STAMCOUNTER             StatFiltered;
+    /** Number of frames truncated to the snap length. */
+    STAMCOUNTER             StatTruncated;
+    /** Number of frames dropped because the ring was full or they could not be captured. */
+    STAMCOUNTER             StatDropped;
+    /** Number of bytes dropped because the ring was full. */
+    STAMCOUNTER             StatDroppedBytes;
+    /** Number of failed file writes. */
+    STAMCOUNTER             StatWriteErrors;
+    /** Number of file rotations. */
+    STAMCOUNTER             StatRotations;
 } DRVNETSNIFFER, *PDRVNETSNIFFER;
 
 
 
+/*********************************************************************************************************************************
+*   Capture Filter                                                                                                               *
+*********************************************************************************************************************************/
+
+/**
+ * Extracts the header fields the capture filter looks at.
+ */
+static void drvNetSnifferParseFrame(uint8_t const *pbFrame, size_t cbFrame, DRVNETSNIFFERPKTINFO *pInfo)
+{
+    RT_ZERO(*pInfo);
+    if (cbFrame < sizeof(RTNETETHERHDR))
+        return;
+    uint32_t off = 12;
+    uint16_t uType = RT_MAKE_U16(pbFrame[off + 1], pbFrame[off]);
+    while ((uType == RTNET_ETHERTYPE_VLAN || uType == UINT16_C(0x88a8)) && off + 6 <= cbFrame)
+    {
+        pInfo->fVlan = true;
+        off  += 4;
+        uType = RT_MAKE_U16(pbFrame[off + 1], pbFrame[off]);
+    }
+    pInfo->uEtherType = uType;
+    off += 2;
+
+    uint32_t offL4 = 0;
+    if (uType == RTNET_ETHERTYPE_IPV4 && off + RTNETIPV4_MIN_LEN <= cbFrame)
+    {
+        PCRTNETIPV4 pIp = (PCRTNETIPV4)&pbFrame[off];
+        pInfo->fIPv4    = true;
+        pInfo->uIpProto = pIp->ip_p;
+        pInfo->uSrcAddr = RT_N2H_U32(pIp->ip_src.u);
+        pInfo->uDstAddr = RT_N2H_U32(pIp->ip_dst.u);
+        if (!(RT_N2H_U16(pIp->ip_off) & UINT16_C(0x1fff))) /* first fragment only */
+            offL4 = off + pIp->ip_hl * 4;
+    }
+    else if (uType == RTNET_ETHERTYPE_IPV6 && off + sizeof(RTNETIPV6) <= cbFrame)
+    {
+        PCRTNETIPV6 pIp6 = (PCRTNETIPV6)&pbFrame[off];
+        pInfo->uIpProto = pIp6->ip6_nxt;
+        offL4 = off + sizeof(RTNETIPV6);
+    }
+
+    if (   offL4
+        && (pInfo->uIpProto == RTNETIPV4_PROT_TCP || pInfo->uIpProto == RTNETIPV4_PROT_UDP)
+        && offL4 + 4 <= cbFrame)
+    {
+        pInfo->fPorts   = true;
+        pInfo->uSrcPort = RT_MAKE_U16(pbFrame[offL4 + 1], pbFrame[offL4]);
+        pInfo->uDstPort = RT_MAKE_U16(pbFrame[offL4 + 3], pbFrame[offL4 + 2]);
+    }
+}
+
+
+/**
+ * Evaluates a capture filter node.
+ */
+static bool drvNetSnifferFilterEval(PDRVNETSNIFFER pThis, uint32_t iNode, DRVNETSNIFFERPKTINFO const *pInfo)
+{
+    DRVNETSNIFFERFLTNODE const *pNode = &pThis->aFltNodes[iNode];
+    switch ((DRVNETSNIFFERFLTOP)pNode->enmOp)
+    {
+        case DRVNETSNIFFERFLTOP_AND:
+            return drvNetSnifferFilterEval(pThis, pNode->iLeft, pInfo) && drvNetSnifferFilterEval(pThis, pNode->iRight, pInfo);
+        case DRVNETSNIFFERFLTOP_OR:
+            return drvNetSnifferFilterEval(pThis, pNode->iLeft, pInfo) || drvNetSnifferFilterEval(pThis, pNode->iRight, pInfo);
+        case DRVNETSNIFFERFLTOP_NOT:
+            return !drvNetSnifferFilterEval(pThis, pNode->iLeft, pInfo);
+        case DRVNETSNIFFERFLTOP_ETHERTYPE:
+            return pInfo->uEtherType == pNode->uValue;
+        case DRVNETSNIFFERFLTOP_VLAN:
+            return pInfo->fVlan;
+        case DRVNETSNIFFERFLTOP_IPPROTO:
+            return (   pInfo->uEtherType == RTNET_ETHERTYPE_IPV4
+                    || pInfo->uEtherType == RTNET_ETHERTYPE_IPV6)
+                && pInfo->uIpProto == pNode->uValue;
+        case DRVNETSNIFFERFLTOP_HOST:
+            return pInfo->fIPv4 && (pInfo->uSrcAddr == pNode->uValue || pInfo->uDstAddr == pNode->uValue);
+        case DRVNETSNIFFERFLTOP_SRC_HOST:
+            return pInfo->fIPv4 && pInfo->uSrcAddr == pNode->uValue;
+        case DRVNETSNIFFERFLTOP_DST_HOST:
+            return pInfo->fIPv4 && pInfo->uDstAddr == pNode->uValue;
+        case DRVNETSNIFFERFLTOP_PORT:
+            return pInfo->fPorts && (pInfo->uSrcPort == pNode->uValue || pInfo->uDstPort == pNode->uValue);
+        case DRVNETSNIFFERFLTOP_SRC_PORT:
+            return pInfo->fPorts && pInfo->uSrcPort == pNode->uValue;
+        case DRVNETSNIFFERFLTOP_DST_PORT:
+            return pInfo->fPorts && pInfo->uDstPort == pNode->uValue;
+        default:
+            AssertFailedReturn(true);
+    }
+}
+
+
+/**
+ * Checks whether a frame passes the capture filter.
+ *
+ * @returns true if the frame should be captured.
+ * @param   pThis       The sniffer instance.
+ * @param   pvFrame     The frame (at least the headers).
+ * @param   cbFrame     Number of valid bytes at @a pvFrame.
+ */
+DECLINLINE(bool) drvNetSnifferFilterMatch(PDRVNETSNIFFER pThis, const void *pvFrame, size_t cbFrame)
+{
+    if (!pThis->cFltNodes)
+        return true;
+    DRVNETSNIFFERPKTINFO Info;
+    drvNetSnifferParseFrame((uint8_t const *)pvFrame, cbFrame, &Info);
+    return drvNetSnifferFilterEval(pThis, pThis->iFltRoot, &Info);
+}
+
+
+/**
+ * Capture filter compiler state.
+ */
+typedef struct DRVNETSNIFFERFLTPARSER
+{
+    PDRVNETSNIFFER          pThis;
+    const char             *psz;
+    char                    szToken[64];
+} DRVNETSNIFFERFLTPARSER;
+
+static int drvNetSnifferFltParseOr(DRVNETSNIFFERFLTPARSER *pParser, uint32_t *piNode);
+
+/** Fetches the next token, parentheses are tokens of their own. */
+static const char *drvNetSnifferFltNextToken(DRVNETSNIFFERFLTPARSER *pParser, bool fPeek)
+{
+    const char *psz = RTStrStripL(pParser->psz);
+    size_t      cch = 0;
+    if (*psz == '(' || *psz == ')')
+        cch = 1;
+    else
+        while (psz[cch] && !RT_C_IS_SPACE(psz[cch]) && psz[cch] != '(' && psz[cch] != ')')
+            cch++;
+    cch = RT_MIN(cch, sizeof(pParser->szToken) - 1);
+    memcpy(pParser->szToken, psz, cch);
+    pParser->szToken[cch] = '\0';
+    if (!fPeek)
+        pParser->psz = psz + cch;
+    return pParser->szToken;
+}
+
+static int drvNetSnifferFltNewNode(DRVNETSNIFFERFLTPARSER *pParser, DRVNETSNIFFERFLTOP enmOp, uint32_t uValue,
+                                   uint32_t iLeft, uint32_t iRight, uint32_t *piNode)
+{
+    PDRVNETSNIFFER pThis = pParser->pThis;
+    if (pThis->cFltNodes >= RT_ELEMENTS(pThis->aFltNodes))
+        return VERR_TOO_MUCH_DATA;
+    DRVNETSNIFFERFLTNODE *pNode = &pThis->aFltNodes[pThis->cFltNodes];
+    pNode->enmOp  = (uint8_t)enmOp;
+    pNode->iLeft  = (uint8_t)iLeft;
+    pNode->iRight = (uint8_t)iRight;
+    pNode->uValue = uValue;
+    *piNode = pThis->cFltNodes++;
+    return VINF_SUCCESS;
+}
+
+/** primitive := 'not' primitive | '(' or ')' | keyword [argument] */
+static int drvNetSnifferFltParsePrimitive(DRVNETSNIFFERFLTPARSER *pParser, uint32_t *piNode)
+{
+    const char *pszTok = drvNetSnifferFltNextToken(pParser, false);
+    if (!strcmp(pszTok, "not") || !strcmp(pszTok, "!"))
+    {
+        uint32_t iOperand;
+        int rc = drvNetSnifferFltParsePrimitive(pParser, &iOperand);
+        if (RT_SUCCESS(rc))
+            rc = drvNetSnifferFltNewNode(pParser, DRVNETSNIFFERFLTOP_NOT, 0, iOperand, 0, piNode);
+        return rc;
+    }
+    if (!strcmp(pszTok, "("))
+    {
+        int rc = drvNetSnifferFltParseOr(pParser, piNode);
+        if (RT_SUCCESS(rc) && strcmp(drvNetSnifferFltNextToken(pParser, false), ")"))
+            rc = VERR_PARSE_ERROR;
+        return rc;
+    }
+
+    static const struct { const char *pszName; DRVNETSNIFFERFLTOP enmOp; uint32_t uValue; } s_aSimple[] =
+    {
+        { "arp",    DRVNETSNIFFERFLTOP_ETHERTYPE,   RTNET_ETHERTYPE_ARP  },
+        { "ip",     DRVNETSNIFFERFLTOP_ETHERTYPE,   RTNET_ETHERTYPE_IPV4 },
+        { "ip6",    DRVNETSNIFFERFLTOP_ETHERTYPE,   RTNET_ETHERTYPE_IPV6 },
+        { "vlan",   DRVNETSNIFFERFLTOP_VLAN,        0 },
+        { "tcp",    DRVNETSNIFFERFLTOP_IPPROTO,     RTNETIPV4_PROT_TCP },
+        { "udp",    DRVNETSNIFFERFLTOP_IPPROTO,     RTNETIPV4_PROT_UDP },
+        { "icmp",   DRVNETSNIFFERFLTOP_IPPROTO,     RTNETIPV4_PROT_ICMP },
+        { "icmp6",  DRVNETSNIFFERFLTOP_IPPROTO,     58 },
+    };
+    for (unsigned i = 0; i < RT_ELEMENTS(s_aSimple); i++)
+        if (!strcmp(pszTok, s_aSimple[i].pszName))
+            return drvNetSnifferFltNewNode(pParser, s_aSimple[i].enmOp, s_aSimple[i].uValue, 0, 0, piNode);
+
+    /* Qualified primitives: [src|dst] host A.B.C.D, [src|dst] port N, ether proto N, proto N. */
+    int iDir = 0;
+    if (!strcmp(pszTok, "src"))
+        iDir = 1;
+    else if (!strcmp(pszTok, "dst"))
+        iDir = 2;
+    if (iDir)
+        pszTok = drvNetSnifferFltNextToken(pParser, false);
+
+    if (!strcmp(pszTok, "host"))
+    {
+        RTNETADDRIPV4 Addr;
+        int rc = RTNetStrToIPv4Addr(drvNetSnifferFltNextToken(pParser, false), &Addr);
+        if (RT_FAILURE(rc))
+            return VERR_PARSE_ERROR;
+        static const DRVNETSNIFFERFLTOP s_aOps[] =
+        { DRVNETSNIFFERFLTOP_HOST, DRVNETSNIFFERFLTOP_SRC_HOST, DRVNETSNIFFERFLTOP_DST_HOST };
+        return drvNetSnifferFltNewNode(pParser, s_aOps[iDir], RT_N2H_U32(Addr.u), 0, 0, piNode);
+    }
+    if (!strcmp(pszTok, "port"))
+    {
+        uint16_t uPort;
+        int rc = RTStrToUInt16Full(drvNetSnifferFltNextToken(pParser, false), 0, &uPort);
+        if (rc != VINF_SUCCESS)
+            return VERR_PARSE_ERROR;
+        static const DRVNETSNIFFERFLTOP s_aOps[] =
+        { DRVNETSNIFFERFLTOP_PORT, DRVNETSNIFFERFLTOP_SRC_PORT, DRVNETSNIFFERFLTOP_DST_PORT };
+        return drvNetSnifferFltNewNode(pParser, s_aOps[iDir], uPort, 0, 0, piNode);
+    }
+    if (iDir)
+        return VERR_PARSE_ERROR;
+
+    DRVNETSNIFFERFLTOP enmOp = DRVNETSNIFFERFLTOP_INVALID;
+    if (!strcmp(pszTok, "ether"))
+    {
+        if (strcmp(drvNetSnifferFltNextToken(pParser, false), "proto"))
+            return VERR_PARSE_ERROR;
+        enmOp = DRVNETSNIFFERFLTOP_ETHERTYPE;
+    }
+    else if (!strcmp(pszTok, "proto"))
+        enmOp = DRVNETSNIFFERFLTOP_IPPROTO;
+    else
+        return VERR_PARSE_ERROR;
+    uint16_t uValue;
+    int rc = RTStrToUInt16Full(drvNetSnifferFltNextToken(pParser, false), 0, &uValue);
+    if (rc != VINF_SUCCESS)
+        return VERR_PARSE_ERROR;
+    return drvNetSnifferFltNewNode(pParser, enmOp, uValue, 0, 0, piNode);
+}
+
+/** and := primitive (('and' | '&&') primitive)* */
+static int drvNetSnifferFltParseAnd(DRVNETSNIFFERFLTPARSER *pParser, uint32_t *piNode)
+{
+    int rc = drvNetSnifferFltParsePrimitive(pParser, piNode);
+    while (RT_SUCCESS(rc))
+    {
+        const char *pszTok = drvNetSnifferFltNextToken(pParser, true);
+        if (strcmp(pszTok, "and") && strcmp(pszTok, "&&"))
+            break;
+        drvNetSnifferFltNextToken(pParser, false);
+        uint32_t iRight;
+        rc = drvNetSnifferFltParsePrimitive(pParser, &iRight);
+        if (RT_SUCCESS(rc))
+            rc = drvNetSnifferFltNewNode(pParser, DRVNETSNIFFERFLTOP_AND, 0, *piNode, iRight, piNode);
+    }
+    return rc;
+}
+
+/** or := and (('or' | '||') and)* */
+static int drvNetSnifferFltParseOr(DRVNETSNIFFERFLTPARSER *pParser, uint32_t *piNode)
+{
+    int rc = drvNetSnifferFltParseAnd(pParser, piNode);
+    while (RT_SUCCESS(rc))
+    {
+        const char *pszTok = drvNetSnifferFltNextToken(pParser, true);
+        if (strcmp(pszTok, "or") && strcmp(pszTok, "||"))
+            break;
+        drvNetSnifferFltNextToken(pParser, false);
+        uint32_t iRight;
+        rc = drvNetSnifferFltParseAnd(pParser, &iRight);
+        if (RT_SUCCESS(rc))
+            rc = drvNetSnifferFltNewNode(pParser, DRVNETSNIFFERFLTOP_OR, 0, *piNode, iRight, piNode);
+    }
+    return rc;
+}
+
+
+/**
+ * Compiles a capture filter expression.
+ *
+ * The syntax is a small subset of the tcpdump/BPF one: the primitives arp, ip,
+ * ip6, vlan, tcp, udp, icmp, icmp6, [src|dst] host <IPv4>, [src|dst] port <n>,
+ * ether proto <n> and proto <n>, combined with not/!, and/&&, or/|| and
+ * parentheses.
+ *
+ * @returns VBox status code.
+ * @param   pThis       The sniffer instance.
+ * @param   pszFilter   The filter expression.
+ */
+static int drvNetSnifferFilterCompile(PDRVNETSNIFFER pThis, const char *pszFilter)
+{
+    DRVNETSNIFFERFLTPARSER Parser;
+    Parser.pThis = pThis;
+    Parser.psz   = pszFilter;
+    pThis->cFltNodes = 0;
+
+    uint32_t iRoot;
+    int rc = drvNetSnifferFltParseOr(&Parser, &iRoot);
+    if (RT_SUCCESS(rc) && *drvNetSnifferFltNextToken(&Parser, true) != '\0')
+        rc = VERR_PARSE_ERROR;
+    if (RT_SUCCESS(rc))
+        pThis->iFltRoot = iRoot;
+    else
+        pThis->cFltNodes = 0;
+    return rc;
+}
+
+
+
+/*********************************************************************************************************************************
+*   Asynchronous Capture                                                                                                         *
+*********************************************************************************************************************************/
+
+/**
+ * Reserves space for a record in the capture ring.
+ *
+ * @returns Pointer to the record space, NULL if the ring is full.
+ * @param   pThis       The sniffer instance.
+ * @param   cbRec       The record size, multiple of 8.
+ */
+static uint8_t *drvNetSnifferRingReserve(PDRVNETSNIFFER pThis, uint32_t cbRec)
+{
+    uint32_t const fMask = pThis->cbRing - 1;
+    if (RT_UNLIKELY(ASMAtomicReadBool(&pThis->fRingCorrupt)))
+        return NULL;
+    for (;;)
+    {
+        uint64_t const offHead = ASMAtomicReadU64(&pThis->offRingHead);
+        uint64_t const offTail = ASMAtomicReadU64(&pThis->offRingTail);
+        uint32_t const offIdx  = (uint32_t)offHead & fMask;
+        /* Records never wrap around, pad to the end of the ring instead. */
+        uint32_t const cbPad   = pThis->cbRing - offIdx < cbRec ? pThis->cbRing - offIdx : 0;
+        if (offHead + cbPad + cbRec - offTail > pThis->cbRing)
+            return NULL;
+        if (ASMAtomicCmpXchgU64(&pThis->offRingHead, offHead + cbPad + cbRec, offHead))
+        {
+            if (cbPad)
+            {
+                *(uint32_t *)&pThis->pbRing[offIdx + 4] = cbPad;
+                ASMAtomicWriteU32((uint32_t volatile *)&pThis->pbRing[offIdx], DRVNETSNIFFER_RING_BT_PAD);
+            }
+            return &pThis->pbRing[(offIdx + cbPad) & fMask];
+        }
+        ASMNopPause();
+    }
+}
+
+
+/**
+ * Queues a frame (or GSO segment) for the writer thread.
+ *
+ * The frame may be split in two parts, e.g. segment headers and payload.
+ *
+ * @param   pThis       The sniffer instance.
+ * @param   pv1         First part.
+ * @param   cb1         Size of the first part.
+ * @param   pv2         Second part, optional.
+ * @param   cb2         Size of the second part.
+ * @param   cbOrig      The size of the frame on the wire.
+ */
+static void drvNetSnifferRingPut(PDRVNETSNIFFER pThis, const void *pv1, uint32_t cb1, const void *pv2, uint32_t cb2,
+                                 uint32_t cbOrig)
+{
+    uint32_t const cbCaptured = RT_MIN(cb1 + cb2, pThis->cbSnapLen);
+    uint32_t const cbRec      = PcapNgCalcEpbSize(cbCaptured);
+    uint8_t       *pbRec      = drvNetSnifferRingReserve(pThis, cbRec);
+    if (RT_UNLIKELY(!pbRec))
+    {
+        STAM_REL_COUNTER_INC(&pThis->StatDropped);
+        STAM_REL_COUNTER_ADD(&pThis->StatDroppedBytes, cbOrig);
+        return;
+    }
+
+    PcapNgInitEpb(pbRec, cbRec, RTTimeNanoTS() + pThis->offEpochNs, cbCaptured, cbOrig);
+    uint32_t const cbCopy1 = RT_MIN(cb1, cbCaptured);
+    memcpy(&pbRec[PCAPNG_EPB_HDR_SIZE], pv1, cbCopy1);
+    if (cbCaptured > cbCopy1)
+        memcpy(&pbRec[PCAPNG_EPB_HDR_SIZE + cbCopy1], pv2, cbCaptured - cbCopy1);
+
+    /* Publish and kick the writer if it's idle. */
+    ASMAtomicWriteU32((uint32_t volatile *)pbRec, PCAPNG_BT_EPB);
+    if (ASMAtomicReadBool(&pThis->fWriterWaiting))
+        RTSemEventSignal(pThis->hEvtWriter);
+
+    STAM_REL_COUNTER_INC(&pThis->StatCaptured);
+    STAM_REL_COUNTER_ADD(&pThis->StatCapturedBytes, cbCaptured);
+    if (cbCaptured < cbOrig)
+        STAM_REL_COUNTER_INC(&pThis->StatTruncated);
+}
+
+
+/**
+ * Opens the capture file (the current one when rotating) and writes the
+ * pcapng header to it.
+ */
+static int drvNetSnifferOpenFile(PDRVNETSNIFFER pThis)
+{
+    char        szRotated[RTPATH_MAX];
+    const char *pszFile = pThis->szFilename;
+    if (pThis->cbFileMax)
+    {
+        RTStrPrintf(szRotated, sizeof(szRotated), "%s.%u", pThis->szFilename, pThis->iFile);
+        pszFile = szRotated;
+    }
+
+    int rc = RTFileOpen(&pThis->hFile, pszFile, RTFILE_O_WRITE | RTFILE_O_CREATE_REPLACE | RTFILE_O_DENY_WRITE);
+    if (RT_SUCCESS(rc))
+    {
+        char szIfName[32];
+        RTStrPrintf(szIfName, sizeof(szIfName), "NetSniffer#%u", pThis->pDrvIns->iInstance);
+        rc = PcapNgFileHdr(pThis->hFile, pThis->cbSnapLen, szIfName);
+        pThis->cbFile = 0;
+    }
+    return rc;
+}
+
+
+/**
+ * Stops asynchronous capturing after finding an invalid block in the ring.
+ */
+static void drvNetSnifferRingSetCorrupt(PDRVNETSNIFFER pThis, uint32_t offBlock, uint32_t uType, uint32_t cbBlock)
+{
+    LogRel(("NetSniffer#%u: Invalid block in the capture ring at %#x: type=%#x cb=%#x, capturing stopped\n",
+            pThis->pDrvIns->iInstance, offBlock, uType, cbBlock));
+    ASMAtomicWriteBool(&pThis->fRingCorrupt, true);
+}
+
+
+/**
+ * Writes out everything that has been published in the capture ring.
+ *
+ * Block lengths are checked before being used since the ring is shared with
+ * the producers; should one ever be off, capturing is stopped rather than
+ * writing or zeroing memory outside the ring.
+ *
+ * @param   pThis       The sniffer instance.
+ */
+static void drvNetSnifferRingDrain(PDRVNETSNIFFER pThis)
+{
+    uint32_t const fMask   = pThis->cbRing - 1;
+    uint64_t       offTail = pThis->offRingTail;
+    while (!ASMAtomicReadBool(&pThis->fRingCorrupt))
+    {
+        /* Collect a run of published blocks which are contiguous in the ring. */
+        uint32_t const offStart = (uint32_t)offTail & fMask;
+        uint32_t       cbRun    = 0;
+        uint32_t       cBlocks  = 0;
+        uint32_t       cbPad    = 0;
+        while (cbRun < DRVNETSNIFFER_WRITE_CHUNK && offStart + cbRun < pThis->cbRing)
+        {
+            uint32_t const *pu32 = (uint32_t const *)&pThis->pbRing[offStart + cbRun];
+            uint32_t const  uType = ASMAtomicReadU32((uint32_t volatile *)pu32);
+            if (uType == PCAPNG_BT_EPB)
+            {
+                uint32_t const cbBlock = pu32[1];
+                if (RT_UNLIKELY(   cbBlock < PcapNgCalcEpbSize(0)
+                                || (cbBlock & 3)
+                                || cbBlock > pThis->cbRing - offStart - cbRun))
+                {
+                    drvNetSnifferRingSetCorrupt(pThis, offStart + cbRun, uType, cbBlock);
+                    break;
+                }
+                if (   pThis->cbFileMax
+                    && cBlocks
+                    && pThis->cbFile + cbRun + cbBlock > pThis->cbFileMax)
+                    break;
+                cbRun += cbBlock;
+                cBlocks++;
+            }
+            else
+            {
+                if (uType == DRVNETSNIFFER_RING_BT_PAD && !cBlocks)
+                {
+                    /* Padding always runs to the end of the ring. */
+                    cbPad = pu32[1];
+                    if (RT_UNLIKELY(cbPad != pThis->cbRing - offStart))
+                    {
+                        drvNetSnifferRingSetCorrupt(pThis, offStart, uType, cbPad);
+                        cbPad = 0;
+                    }
+                }
+                else if (RT_UNLIKELY(uType != 0 && uType != DRVNETSNIFFER_RING_BT_PAD))
+                    drvNetSnifferRingSetCorrupt(pThis, offStart + cbRun, uType, pu32[1]);
+                break;
+            }
+        }
+
+        if (cBlocks)
+        {
+            /* Rotate first if this would take the file over the limit. */
+            if (   pThis->cbFileMax
+                && pThis->cbFile
+                && pThis->cbFile + cbRun > pThis->cbFileMax)
+            {
+                RTFileClose(pThis->hFile);
+                pThis->hFile = NIL_RTFILE;
+                pThis->iFile = pThis->cFilesMax ? (pThis->iFile + 1) % pThis->cFilesMax : pThis->iFile + 1;
+                int rc = drvNetSnifferOpenFile(pThis);
+                if (RT_FAILURE(rc))
+                    LogRelMax(16, ("NetSniffer#%u: Failed to rotate capture file: %Rrc\n", pThis->pDrvIns->iInstance, rc));
+                STAM_REL_COUNTER_INC(&pThis->StatRotations);
+            }
+
+            int rc = pThis->hFile != NIL_RTFILE
+                   ? RTFileWrite(pThis->hFile, &pThis->pbRing[offStart], cbRun, NULL)
+                   : VERR_INVALID_HANDLE;
+            if (RT_SUCCESS(rc))
+                pThis->cbFile += cbRun;
+            else
+                STAM_REL_COUNTER_INC(&pThis->StatWriteErrors);
+
+            /* Zero the space before handing it back to the producers, a new block
+               can start anywhere within the old ones. */
+            memset(&pThis->pbRing[offStart], 0, cbRun);
+            offTail += cbRun;
+            ASMAtomicWriteU64(&pThis->offRingTail, offTail);
+        }
+        else if (cbPad)
+        {
+            memset(&pThis->pbRing[offStart], 0, cbPad);
+            offTail += cbPad;
+            ASMAtomicWriteU64(&pThis->offRingTail, offTail);
+        }
+        else
+            break;
+    }
+}
+
+
+/**
+ * Waits for the next block to be published in the capture ring.
+ *
+ * Producers publish a block before checking fWriterWaiting, and both accesses
+ * are fully ordered, so either the check below sees the block or the producer
+ * sees the flag and signals the event.
+ *
+ * @param   pThis       The sniffer instance.
+ */
+static void drvNetSnifferRingWait(PDRVNETSNIFFER pThis)
+{
+    ASMAtomicXchgBool(&pThis->fWriterWaiting, true);
+    uint32_t const *pu32Next = (uint32_t const *)&pThis->pbRing[(uint32_t)pThis->offRingTail & (pThis->cbRing - 1)];
+    if (   !ASMAtomicReadU32((uint32_t volatile *)pu32Next)
+        || ASMAtomicReadBool(&pThis->fRingCorrupt))
+        RTSemEventWait(pThis->hEvtWriter, RT_INDEFINITE_WAIT);
+    ASMAtomicWriteBool(&pThis->fWriterWaiting, false);
+}
+
+
+/**
+ * @callback_method_impl{FNPDMTHREADDRV, Capture file writer.}
+ */
+static DECLCALLBACK(int) drvNetSnifferWriterThread(PPDMDRVINS pDrvIns, PPDMTHREAD pThread)
+{
+    PDRVNETSNIFFER pThis = PDMINS_2_DATA(pDrvIns, PDRVNETSNIFFER);
+    if (pThread->enmState == PDMTHREADSTATE_INITIALIZING)
+        return VINF_SUCCESS;
+
+    while (pThread->enmState == PDMTHREADSTATE_RUNNING)
+    {
+        drvNetSnifferRingDrain(pThis);
+        drvNetSnifferRingWait(pThis);
+    }
+
+    /* Flush what's left when suspending or powering off. */
+    drvNetSnifferRingDrain(pThis);
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * @callback_method_impl{FNPDMTHREADWAKEUPDRV}
+ */
+static DECLCALLBACK(int) drvNetSnifferWriterWakeUp(PPDMDRVINS pDrvIns, PPDMTHREAD pThread)
+{
+    RT_NOREF(pThread);
+    PDRVNETSNIFFER pThis = PDMINS_2_DATA(pDrvIns, PDRVNETSNIFFER);
+    return RTSemEventSignal(pThis->hEvtWriter);
+}
+
+
+/**
+ * Captures a frame, synchronously or by queueing it to the writer thread.
+ *
+ * @param   pThis       The sniffer instance.
+ * @param   pGso        The GSO context if this is a GSO frame, otherwise NULL.
+ * @param   pvFrame     The frame.
+ * @param   cbFrame     The size of the frame.
+ * @param   cbAvail     The number of bytes available at @a pvFrame.
+ */
+static void drvNetSnifferCapture(PDRVNETSNIFFER pThis, PCPDMNETWORKGSO pGso, const void *pvFrame, size_t cbFrame, size_t cbAvail)
+{
+    if (!drvNetSnifferFilterMatch(pThis, pvFrame, cbAvail))
+    {
+        STAM_REL_COUNTER_INC(&pThis->StatFiltered);
+        return;
+    }
+
+    if (!pThis->fAsync)
+    {
+        RTCritSectEnter(&pThis->Lock);
+        if (!pGso)
+            PcapFileFrame(pThis->hFile, pThis->StartNanoTS, pvFrame, cbFrame, RT_MIN(cbAvail, pThis->cbSnapLen));
+        else
+            PcapFileGsoFrame(pThis->hFile, pThis->StartNanoTS, pGso, pvFrame, cbFrame, RT_MIN(cbAvail, pThis->cbSnapLen));
+        RTCritSectLeave(&pThis->Lock);
+        STAM_REL_COUNTER_INC(&pThis->StatCaptured);
+        STAM_REL_COUNTER_ADD(&pThis->StatCapturedBytes, RT_MIN(cbAvail, pThis->cbSnapLen));
+        return;
+    }
+
+    if (!pGso)
+        drvNetSnifferRingPut(pThis, pvFrame, (uint32_t)cbAvail, NULL, 0, (uint32_t)cbFrame);
+    else if (cbAvail >= cbFrame)
+    {
+        /* Store the segments as they will appear on the wire. */
+        uint8_t const  *pbFrame = (uint8_t const *)pvFrame;
+        uint8_t         abHdrs[256];
+        uint32_t const  cSegs   = PDMNetGsoCalcSegmentCount(pGso, cbFrame);
+        for (uint32_t iSeg = 0; iSeg < cSegs; iSeg++)
+        {
+            uint32_t cbSegPayload, cbHdrs;
+            uint32_t offSegPayload = PDMNetGsoCarveSegment(pGso, pbFrame, cbFrame, iSeg, cSegs, abHdrs, &cbHdrs, &cbSegPayload);
+            drvNetSnifferRingPut(pThis, abHdrs, cbHdrs, pbFrame + offSegPayload, cbSegPayload, cbHdrs + cbSegPayload);
+        }
+    }
+    else
+    {
+        /* Can't carve segments out of a partial frame. */
+        STAM_REL_COUNTER_INC(&pThis->StatDropped);
+        STAM_REL_COUNTER_ADD(&pThis->StatDroppedBytes, cbFrame);
+    }
+}
+
+
+
 /**
  * @interface_method_impl{PDMINETWORKUP,pfnBeginXmit}
  */
@@ -132,18 +908,10 @@ static DECLCALLBACK(int) drvNetSnifferUp_SendBuf(PPDMINETWORKUP pInterface, PPDM
         return VERR_NET_DOWN;
 
     /* output to sniffer */
-    RTCritSectEnter(&pThis->Lock);
-    if (!pSgBuf->pvUser)
-        PcapFileFrame(pThis->hFile, pThis->StartNanoTS,
-                      pSgBuf->aSegs[0].pvSeg,
-                      pSgBuf->cbUsed,
-                      RT_MIN(pSgBuf->cbUsed, pSgBuf->aSegs[0].cbSeg));
-    else
-        PcapFileGsoFrame(pThis->hFile, pThis->StartNanoTS, (PCPDMNETWORKGSO)pSgBuf->pvUser,
+    drvNetSnifferCapture(pThis, (PCPDMNETWORKGSO)pSgBuf->pvUser,
                          pSgBuf->aSegs[0].pvSeg,
                          pSgBuf->cbUsed,
                          RT_MIN(pSgBuf->cbUsed, pSgBuf->aSegs[0].cbSeg));
-    RTCritSectLeave(&pThis->Lock);
 
     return pThis->pIBelowNet->pfnSendBuf(pThis->pIBelowNet, pSgBuf, fOnWorkerThread);
 }
@@ -205,9 +973,7 @@ static DECLCALLBACK(int) drvNetSnifferDown_Receive(PPDMINETWORKDOWN pInterface,
     PDRVNETSNIFFER pThis = RT_FROM_MEMBER(pInterface, DRVNETSNIFFER, INetworkDown);
 
     /* output to sniffer */
-    RTCritSectEnter(&pThis->Lock);
-    PcapFileFrame(pThis->hFile, pThis->StartNanoTS, pvBuf, cb, cb);
-    RTCritSectLeave(&pThis->Lock);
+    drvNetSnifferCapture(pThis, NULL, pvBuf, cb, cb);
 
     /* pass up */
     int rc = pThis->pIAboveNet->pfnReceive(pThis->pIAboveNet, pvBuf, cb);
@@ -353,6 +1119,18 @@ static DECLCALLBACK(void) drvNetSnifferDestruct(PPDMDRVINS pDrvIns)
     PDRVNETSNIFFER pThis = PDMINS_2_DATA(pDrvIns, PDRVNETSNIFFER);
     PDMDRV_CHECK_VERSIONS_RETURN_VOID(pDrvIns);
 
+    /* Stop the writer (it flushes the ring) before closing the file. */
+    if (pThis->pWriterThread)
+    {
+        PDMR3ThreadDestroy(pThis->pWriterThread, NULL);
+        pThis->pWriterThread = NULL;
+    }
+    if (pThis->hEvtWriter != NIL_RTSEMEVENT)
+    {
+        RTSemEventDestroy(pThis->hEvtWriter);
+        pThis->hEvtWriter = NIL_RTSEMEVENT;
+    }
+
     if (RTCritSectIsInitialized(&pThis->Lock))
         RTCritSectDelete(&pThis->Lock);
 
@@ -364,6 +1142,12 @@ static DECLCALLBACK(void) drvNetSnifferDestruct(PPDMDRVINS pDrvIns)
         RTFileClose(pThis->hFile);
         pThis->hFile = NIL_RTFILE;
     }
+
+    if (pThis->pbRing)
+    {
+        RTMemPageFree(pThis->pbRing, pThis->cbRing);
+        pThis->pbRing = NULL;
+    }
 }
 
 
@@ -382,6 +1166,7 @@ static DECLCALLBACK(int) drvNetSnifferConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pC
      */
     pThis->pDrvIns                                  = pDrvIns;
     pThis->hFile                                    = NIL_RTFILE;
+    pThis->hEvtWriter                               = NIL_RTSEMEVENT;
     /* The pcap file *must* start at time offset 0,0. */
     pThis->StartNanoTS                              = RTTimeNanoTS() - RTTimeProgramNanoTS();
     /* IBase */
@@ -414,7 +1199,13 @@ static DECLCALLBACK(int) drvNetSnifferConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pC
     /*
      * Validate the config.
      */
-    if (!CFGMR3AreValuesValid(pCfg, "File\0"))
+    if (!CFGMR3AreValuesValid(pCfg, "File\0"
+                                    "Async\0"
+                                    "Filter\0"
+                                    "SnapLen\0"
+                                    "RingSize\0"
+                                    "FileSize\0"
+                                    "FileCount\0"))
         return VERR_PDM_DRVINS_UNKNOWN_CFG_VALUES;
 
     if (CFGMR3GetFirstChild(pCfg))
@@ -423,13 +1214,18 @@ static DECLCALLBACK(int) drvNetSnifferConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pC
     /*
      * Get the filename.
      */
+    rc = CFGMR3QueryBoolDef(pCfg, "Async", &pThis->fAsync, false);
+    if (RT_FAILURE(rc))
+        return PDMDRV_SET_ERROR(pDrvIns, rc, N_("Configuration error: Failed to get the \"Async\" value"));
+
     rc = CFGMR3QueryString(pCfg, "File", pThis->szFilename, sizeof(pThis->szFilename));
     if (rc == VERR_CFGM_VALUE_NOT_FOUND)
     {
+        const char *pszExt = pThis->fAsync ? "pcapng" : "pcap";
         if (pDrvIns->iInstance > 0)
-            RTStrPrintf(pThis->szFilename, sizeof(pThis->szFilename), "./VBox-%x-%u.pcap", RTProcSelf(), pDrvIns->iInstance);
+            RTStrPrintf(pThis->szFilename, sizeof(pThis->szFilename), "./VBox-%x-%u.%s", RTProcSelf(), pDrvIns->iInstance, pszExt);
         else
-            RTStrPrintf(pThis->szFilename, sizeof(pThis->szFilename), "./VBox-%x.pcap", RTProcSelf());
+            RTStrPrintf(pThis->szFilename, sizeof(pThis->szFilename), "./VBox-%x.%s", RTProcSelf(), pszExt);
     }
 
     else if (RT_FAILURE(rc))
@@ -438,6 +1234,51 @@ static DECLCALLBACK(int) drvNetSnifferConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pC
         return rc;
     }
 
+    rc = CFGMR3QueryU32Def(pCfg, "SnapLen", &pThis->cbSnapLen, UINT16_MAX);
+    if (RT_FAILURE(rc))
+        return PDMDRV_SET_ERROR(pDrvIns, rc, N_("Configuration error: Failed to get the \"SnapLen\" value"));
+    if (pThis->cbSnapLen < sizeof(RTNETETHERHDR) || pThis->cbSnapLen > _256K)
+        return PDMDrvHlpVMSetError(pDrvIns, VERR_OUT_OF_RANGE, RT_SRC_POS,
+                                   N_("Configuration error: \"SnapLen\" must be between 14 and 262144 bytes"));
+
+    char *pszFilter = NULL;
+    rc = CFGMR3QueryStringAllocDef(pCfg, "Filter", &pszFilter, NULL);
+    if (RT_FAILURE(rc))
+        return PDMDRV_SET_ERROR(pDrvIns, rc, N_("Configuration error: Failed to get the \"Filter\" value"));
+    if (pszFilter && *pszFilter)
+    {
+        rc = drvNetSnifferFilterCompile(pThis, pszFilter);
+        if (RT_FAILURE(rc))
+        {
+            rc = PDMDrvHlpVMSetError(pDrvIns, rc, RT_SRC_POS,
+                                     N_("Configuration error: Invalid capture filter \"%s\""), pszFilter);
+            MMR3HeapFree(pszFilter);
+            return rc;
+        }
+        LogRel(("NetSniffer#%u: Capture filter \"%s\" (%u nodes)\n", pDrvIns->iInstance, pszFilter, pThis->cFltNodes));
+    }
+    MMR3HeapFree(pszFilter);
+
+    if (pThis->fAsync)
+    {
+        uint32_t cbRing;
+        rc = CFGMR3QueryU32Def(pCfg, "RingSize", &cbRing, DRVNETSNIFFER_RING_SIZE_DEF);
+        if (RT_FAILURE(rc))
+            return PDMDRV_SET_ERROR(pDrvIns, rc, N_("Configuration error: Failed to get the \"RingSize\" value"));
+        /* Power of two, and room for a few maximum sized records. */
+        cbRing = RT_MAX(cbRing, RT_MAX(DRVNETSNIFFER_RING_SIZE_MIN, 4 * PcapNgCalcEpbSize(pThis->cbSnapLen)));
+        if (cbRing & (cbRing - 1))
+            cbRing = RT_BIT_32(ASMBitLastSetU32(cbRing));
+        pThis->cbRing = cbRing;
+
+        rc = CFGMR3QueryU64Def(pCfg, "FileSize", &pThis->cbFileMax, 0);
+        if (RT_FAILURE(rc))
+            return PDMDRV_SET_ERROR(pDrvIns, rc, N_("Configuration error: Failed to get the \"FileSize\" value"));
+        rc = CFGMR3QueryU32Def(pCfg, "FileCount", &pThis->cFilesMax, 0);
+        if (RT_FAILURE(rc))
+            return PDMDRV_SET_ERROR(pDrvIns, rc, N_("Configuration error: Failed to get the \"FileCount\" value"));
+    }
+
     /*
      * Query the network port interface.
      */
@@ -484,8 +1325,11 @@ static DECLCALLBACK(int) drvNetSnifferConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pC
     /*
      * Open output file / pipe.
      */
-    rc = RTFileOpen(&pThis->hFile, pThis->szFilename,
-                    RTFILE_O_WRITE | RTFILE_O_CREATE_REPLACE | RTFILE_O_DENY_WRITE);
+    if (pThis->fAsync)
+        rc = drvNetSnifferOpenFile(pThis);
+    else
+        rc = RTFileOpen(&pThis->hFile, pThis->szFilename,
+                        RTFILE_O_WRITE | RTFILE_O_CREATE_REPLACE | RTFILE_O_DENY_WRITE);
     if (RT_FAILURE(rc))
         return PDMDrvHlpVMSetError(pDrvIns, rc, RT_SRC_POS,
                                    N_("Netsniffer cannot open '%s' for writing. The directory must exist and it must be writable for the current user"), pThis->szFilename);
@@ -499,12 +1343,46 @@ static DECLCALLBACK(int) drvNetSnifferConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pC
     else
         LogRel(("NetSniffer: Sniffing to '%s'\n", pThis->szFilename));
 
-    /*
-     * Write pcap header.
-     * Some time has gone by since capturing pThis->StartNanoTS so get the
-     * current time again.
-     */
-    PcapFileHdr(pThis->hFile, RTTimeNanoTS());
+    if (!pThis->fAsync)
+    {
+        /*
+         * Write pcap header.
+         * Some time has gone by since capturing pThis->StartNanoTS so get the
+         * current time again.
+         */
+        PcapFileHdr(pThis->hFile, RTTimeNanoTS());
+    }
+    else
+    {
+        /*
+         * Set up the capture ring and the writer thread.
+         */
+        RTTIMESPEC Now;
+        pThis->offEpochNs = RTTimeSpecGetNano(RTTimeNow(&Now)) - RTTimeNanoTS();
+
+        pThis->pbRing = (uint8_t *)RTMemPageAllocZ(pThis->cbRing);
+        if (!pThis->pbRing)
+            return VERR_NO_MEMORY;
+
+        rc = RTSemEventCreate(&pThis->hEvtWriter);
+        AssertRCReturn(rc, rc);
+
+        rc = PDMDrvHlpThreadCreate(pDrvIns, &pThis->pWriterThread, pThis, drvNetSnifferWriterThread,
+                                   drvNetSnifferWriterWakeUp, 0, RTTHREADTYPE_IO, "NetSniffer");
+        AssertRCReturn(rc, rc);
+
+        LogRel(("NetSniffer#%u: Asynchronous capture, ring %u KB, snaplen %u, file size limit %RU64, %u files\n",
+                pDrvIns->iInstance, pThis->cbRing / _1K, pThis->cbSnapLen, pThis->cbFileMax, pThis->cFilesMax));
+    }
+
+    PDMDrvHlpSTAMRegCounter(pDrvIns, &pThis->StatCaptured,       "Captured",      "Number of frames captured.");
+    PDMDrvHlpSTAMRegCounterEx(pDrvIns, &pThis->StatCapturedBytes, "CapturedBytes", STAMUNIT_BYTES, "Number of bytes captured.");
+    PDMDrvHlpSTAMRegCounter(pDrvIns, &pThis->StatFiltered,       "Filtered",      "Number of frames rejected by the capture filter.");
+    PDMDrvHlpSTAMRegCounter(pDrvIns, &pThis->StatTruncated,      "Truncated",     "Number of frames truncated to the snap length.");
+    PDMDrvHlpSTAMRegCounter(pDrvIns, &pThis->StatDropped,        "Dropped",       "Number of frames dropped because the capture ring was full or they could not be captured.");
+    PDMDrvHlpSTAMRegCounterEx(pDrvIns, &pThis->StatDroppedBytes, "DroppedBytes",  STAMUNIT_BYTES, "Number of bytes dropped because the capture ring was full or they could not be captured.");
+    PDMDrvHlpSTAMRegCounter(pDrvIns, &pThis->StatWriteErrors,    "WriteErrors",   "Number of failed capture file writes.");
+    PDMDrvHlpSTAMRegCounter(pDrvIns, &pThis->StatRotations,      "Rotations",     "Number of capture file rotations.");
 
     return VINF_SUCCESS;
 }
@@ -61,15 +61,101 @@
 #else
 # include <sys/fcntl.h>
 #endif
+#ifdef RT_OS_LINUX
+# include <sys/uio.h>
+# include <net/if.h>
+# include <linux/if_tun.h>
+#endif
 #include <errno.h>
 #include <unistd.h>
 
 #include "VBoxDD.h"
 
 
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** The max number of TAP queues we can service (one I/O thread each). */
+#ifdef RT_OS_LINUX
+# define DRVTAP_MAX_QUEUES              8
+#else
+# define DRVTAP_MAX_QUEUES              1
+#endif
+/** The max number of frames to read per poll() wakeup. */
+#define DRVTAP_RECV_BATCH               64
+/** The size of the per queue receive buffer.  This must be able to hold a GSO
+ *  frame from the host plus the virtio-net header. */
+#define DRVTAP_RECV_BUF_SIZE            (_64K + _1K)
+
+
+/** @name Virtio-net header flags and GSO types (DRVTAPVNETHDR).
+ * @{ */
+#define DRVTAP_VNETHDR_F_NEEDS_CSUM     1
+#define DRVTAP_VNETHDR_GSO_NONE         0
+#define DRVTAP_VNETHDR_GSO_TCPV4        1
+#define DRVTAP_VNETHDR_GSO_UDP          3
+#define DRVTAP_VNETHDR_GSO_TCPV6        4
+#define DRVTAP_VNETHDR_GSO_ECN          0x80
+/** @} */
+
+
 /*********************************************************************************************************************************
 *   Structures and Typedefs                                                                                                      *
 *********************************************************************************************************************************/
+/**
+ * The virtio-net header prefixed to each frame when the TAP device is set up
+ * with IFF_VNET_HDR.
+ *
+ * This mirrors struct virtio_net_hdr, as linux/virtio_net.h isn't C++ safe.
+ */
+typedef struct DRVTAPVNETHDR
+{
+    /** DRVTAP_VNETHDR_F_XXX. */
+    uint8_t                 fFlags;
+    /** DRVTAP_VNETHDR_GSO_XXX. */
+    uint8_t                 u8GsoType;
+    /** Length of the headers (hint). */
+    uint16_t                cbHdrs;
+    /** The maximum segment size. */
+    uint16_t                cbGsoSize;
+    /** Where to start checksumming. */
+    uint16_t                offCsumStart;
+    /** Where to store the checksum, relative to offCsumStart. */
+    uint16_t                offCsum;
+} DRVTAPVNETHDR;
+AssertCompileSize(DRVTAPVNETHDR, 10);
+/** Pointer to a const virtio-net header. */
+typedef DRVTAPVNETHDR const *PCDRVTAPVNETHDR;
+
+
+/**
+ * TAP queue.
+ *
+ * With IFF_MULTI_QUEUE each queue has its own TAP file handle which is
+ * serviced by a dedicated receive thread.  Otherwise there is only one queue
+ * using DRVTAP::hFileDevice.
+ */
+typedef struct DRVTAPQUEUE
+{
+    /** Pointer to the driver instance data. */
+    struct DRVTAP          *pThis;
+    /** TAP file handle of this queue. */
+    RTFILE                  hFile;
+    /** The write end of the control pipe. */
+    RTPIPE                  hPipeWrite;
+    /** The read end of the control pipe. */
+    RTPIPE                  hPipeRead;
+    /** Reader thread. */
+    PPDMTHREAD              pThread;
+    /** The receive buffer (DRVTAP_RECV_BUF_SIZE bytes). */
+    uint8_t                *pbRecvBuf;
+    /** The queue number. */
+    uint32_t                iQueue;
+} DRVTAPQUEUE;
+/** Pointer to a TAP queue. */
+typedef DRVTAPQUEUE *PDRVTAPQUEUE;
+
+
 /**
  * TAP driver instance data.
  *
@@ -97,16 +183,20 @@ typedef struct DRVTAP
     char                   *pszSetupApplication;
     /** TAP terminate application. */
     char                   *pszTerminateApplication;
-    /** The write end of the control pipe. */
-    RTPIPE                  hPipeWrite;
-    /** The read end of the control pipe. */
-    RTPIPE                  hPipeRead;
-    /** Reader thread. */
-    PPDMTHREAD              pThread;
+    /** Number of queues in use. */
+    uint32_t                cQueues;
+    /** Set if the TAP device was set up with IFF_VNET_HDR, i.e. all frames are
+     * prefixed by a virtio-net header carrying the GSO and checksum offload
+     * details. */
+    bool                    fVNetHdr;
+    /** The queues. */
+    DRVTAPQUEUE             aQueues[DRVTAP_MAX_QUEUES];
 
     /** @todo The transmit thread. */
     /** Transmit lock used by drvTAPNetworkUp_BeginXmit. */
     RTCRITSECT              XmitLock;
+    /** Receive lock serializing the queue threads when passing frames up. */
+    RTCRITSECT              RecvLock;
 
 #ifdef VBOX_WITH_STATISTICS
     /** Number of sent packets. */
@@ -117,6 +207,12 @@ typedef struct DRVTAP
     STAMCOUNTER             StatPktRecv;
     /** Number of received bytes. */
     STAMCOUNTER             StatPktRecvBytes;
+    /** Number of GSO frames sent as such to the host. */
+    STAMCOUNTER             StatPktSentGso;
+    /** Number of GSO frames received from the host. */
+    STAMCOUNTER             StatPktRecvGso;
+    /** Number of frames read per poll() wakeup. */
+    STAMPROFILE             StatRecvFramesPerWakeup;
     /** Profiling packet transmit runs. */
     STAMPROFILE             StatTransmit;
     /** Profiling packet receive runs. */
@@ -144,6 +240,244 @@ static int              SolarisTAPAttach(PDRVTAP pThis);
 #endif
 
 
+#ifdef RT_OS_LINUX
+/**
+ * Checks whether a GSO frame can be handed to the host as-is.
+ *
+ * Only TCP segmentation is passed on, UFO support is being phased out by the
+ * Linux kernel and the other GSO types have no virtio-net header equivalent.
+ *
+ * @returns true if it can, false if we have to segment it ourselves.
+ * @param   pGso            The GSO context.
+ */
+DECLINLINE(bool) drvTAPIsGsoOffloadable(PCPDMNETWORKGSO pGso)
+{
+    return pGso->u8Type == PDMNETWORKGSOTYPE_IPV4_TCP
+        || pGso->u8Type == PDMNETWORKGSOTYPE_IPV6_TCP;
+}
+
+
+/**
+ * Sets up a GSO context from the virtio-net header of a frame read from the
+ * TAP device.
+ *
+ * The header length given by the host is the linear part of its socket
+ * buffer and not necessarily the protocol headers, so we work these out
+ * from the frame instead.
+ *
+ * @returns true on success, false if the frame cannot be represented.
+ * @param   pGso            The GSO context to set up.
+ * @param   pVNetHdr        The virtio-net header.
+ * @param   pbFrame         The frame.
+ * @param   cbFrame         The frame size.
+ */
+static bool drvTAPSetupGsoCtx(PPDMNETWORKGSO pGso, PCDRVTAPVNETHDR pVNetHdr,
+                              uint8_t const *pbFrame, size_t cbFrame)
+{
+    if (   !(pVNetHdr->fFlags & DRVTAP_VNETHDR_F_NEEDS_CSUM)
+        || (pVNetHdr->u8GsoType & DRVTAP_VNETHDR_GSO_ECN)
+        || cbFrame < sizeof(RTNETETHERHDR)
+        || pVNetHdr->offCsumStart >= cbFrame)
+        return false;
+
+    /* Skip a VLAN tag if present. */
+    uint8_t  offHdr1    = sizeof(RTNETETHERHDR);
+    uint16_t uEtherType = RT_BE2H_U16(((PCRTNETETHERHDR)pbFrame)->EtherType);
+    if (uEtherType == RTNET_ETHERTYPE_VLAN && cbFrame >= sizeof(RTNETETHERHDR) + 4)
+    {
+        offHdr1   += 4;
+        uEtherType = RT_MAKE_U16(pbFrame[offHdr1 - 1], pbFrame[offHdr1 - 2]);
+    }
+
+    uint32_t const offHdr2 = pVNetHdr->offCsumStart;
+    uint32_t       cbHdrsTotal;
+    switch (pVNetHdr->u8GsoType)
+    {
+        case DRVTAP_VNETHDR_GSO_TCPV4:
+        case DRVTAP_VNETHDR_GSO_TCPV6:
+            if (offHdr2 + sizeof(RTNETTCP) > cbFrame)
+                return false;
+            pGso->u8Type    = pVNetHdr->u8GsoType == DRVTAP_VNETHDR_GSO_TCPV4
+                            ? PDMNETWORKGSOTYPE_IPV4_TCP : PDMNETWORKGSOTYPE_IPV6_TCP;
+            cbHdrsTotal     = offHdr2 + ((PCRTNETTCP)&pbFrame[offHdr2])->th_off * 4;
+            pGso->cbHdrsSeg = (uint8_t)cbHdrsTotal;
+            break;
+        case DRVTAP_VNETHDR_GSO_UDP:
+            pGso->u8Type    = uEtherType == RTNET_ETHERTYPE_IPV6
+                            ? PDMNETWORKGSOTYPE_IPV6_UDP : PDMNETWORKGSOTYPE_IPV4_UDP;
+            cbHdrsTotal     = offHdr2 + sizeof(RTNETUDP);
+            pGso->cbHdrsSeg = (uint8_t)offHdr2;
+            break;
+        default:
+            return false;
+    }
+    if (cbHdrsTotal > UINT8_MAX || cbHdrsTotal > cbFrame)
+        return false;
+    pGso->cbHdrsTotal = (uint8_t)cbHdrsTotal;
+    pGso->cbMaxSeg    = pVNetHdr->cbGsoSize;
+    pGso->offHdr1     = offHdr1;
+    pGso->offHdr2     = (uint8_t)offHdr2;
+    pGso->u8Unused    = 0;
+    return PDMNetGsoIsValid(pGso, sizeof(*pGso), cbFrame);
+}
+
+
+/**
+ * Completes a partial checksum left to us by the host (DRVTAP_VNETHDR_F_NEEDS_CSUM).
+ *
+ * The checksum field holds the pseudo header sum, so summing up everything
+ * from offCsumStart gives us the final value.
+ *
+ * @param   pVNetHdr        The virtio-net header.
+ * @param   pbFrame         The frame.
+ * @param   cbFrame         The frame size.
+ */
+static void drvTAPCompleteChecksum(PCDRVTAPVNETHDR pVNetHdr, uint8_t *pbFrame, size_t cbFrame)
+{
+    uint32_t const offStart = pVNetHdr->offCsumStart;
+    uint32_t const offSum   = offStart + pVNetHdr->offCsum;
+    if (offSum + sizeof(uint16_t) <= cbFrame)
+    {
+        bool     fOdd   = false;
+        uint32_t u32Sum = RTNetIPv4AddDataChecksum(&pbFrame[offStart], cbFrame - offStart, 0, &fOdd);
+        uint16_t u16Sum = RTNetIPv4FinalizeChecksum(u32Sum);
+        if (!u16Sum && pVNetHdr->offCsum == RT_OFFSETOF(RTNETUDP, uh_sum))
+            u16Sum = 0xffff;
+        memcpy(&pbFrame[offSum], &u16Sum, sizeof(u16Sum));
+    }
+}
+
+
+/**
+ * Queries the TAP device setup, enables the host offloads if the device uses
+ * virtio-net headers and attaches the additional queues.
+ *
+ * @returns VBox status code.
+ * @param   pThis           The instance data.
+ * @param   cQueues         The number of queues wanted.
+ */
+static int drvTAPLinuxSetupOffloadAndQueues(PDRVTAP pThis, uint32_t cQueues)
+{
+    int const fd = RTFileToNative(pThis->hFileDevice);
+    struct ifreq IfReq;
+    RT_ZERO(IfReq);
+    if (ioctl(fd, TUNGETIFF, &IfReq) != 0)
+    {
+        LogRel(("TAP#%d: TUNGETIFF failed (errno=%d), no offloading\n", pThis->pDrvIns->iInstance, errno));
+        return VINF_SUCCESS;
+    }
+
+    /*
+     * With virtio-net headers we can take partially checksummed and GSO
+     * frames from the host.  UFO is refused by recent kernels, so retry
+     * without it.
+     */
+    pThis->fVNetHdr = RT_BOOL(IfReq.ifr_flags & IFF_VNET_HDR);
+    if (pThis->fVNetHdr)
+    {
+        unsigned long fOffloads = TUN_F_CSUM | TUN_F_TSO4 | TUN_F_TSO6 | TUN_F_UFO;
+        if (ioctl(fd, TUNSETOFFLOAD, fOffloads) != 0)
+        {
+            fOffloads &= ~(unsigned long)TUN_F_UFO;
+            if (ioctl(fd, TUNSETOFFLOAD, fOffloads) != 0)
+                fOffloads = 0;
+        }
+        LogRel(("TAP#%d: Using virtio-net headers, host offloads %#lx\n", pThis->pDrvIns->iInstance, fOffloads));
+    }
+
+    /*
+     * Attach the additional queues.  We must use the same flags as the
+     * first one, which the kernel checks.
+     */
+#ifdef IFF_MULTI_QUEUE
+    if (cQueues > 1 && (IfReq.ifr_flags & IFF_MULTI_QUEUE))
+    {
+        while (pThis->cQueues < cQueues)
+        {
+            PDRVTAPQUEUE pQueue = &pThis->aQueues[pThis->cQueues];
+            int rc = RTFileOpen(&pQueue->hFile, "/dev/net/tun", RTFILE_O_READWRITE | RTFILE_O_OPEN | RTFILE_O_DENY_NONE);
+            if (RT_FAILURE(rc))
+            {
+                LogRel(("TAP#%d: Failed to open /dev/net/tun for queue %u: %Rrc\n", pThis->pDrvIns->iInstance, pThis->cQueues, rc));
+                break;
+            }
+            struct ifreq IfReqQueue = IfReq;
+            if (   ioctl(RTFileToNative(pQueue->hFile), TUNSETIFF, &IfReqQueue) != 0
+                || fcntl(RTFileToNative(pQueue->hFile), F_SETFL, O_NONBLOCK) == -1)
+            {
+                LogRel(("TAP#%d: Failed to attach queue %u to %s: errno=%d\n",
+                        pThis->pDrvIns->iInstance, pThis->cQueues, IfReq.ifr_name, errno));
+                RTFileClose(pQueue->hFile);
+                pQueue->hFile = NIL_RTFILE;
+                break;
+            }
+            pThis->cQueues++;
+        }
+        LogRel(("TAP#%d: Using %u queues\n", pThis->pDrvIns->iInstance, pThis->cQueues));
+    }
+    else
+#endif
+    if (cQueues > 1)
+        LogRel(("TAP#%d: %u queues requested, but %s is not a multi-queue device\n",
+                pThis->pDrvIns->iInstance, cQueues, IfReq.ifr_name));
+    return VINF_SUCCESS;
+}
+#endif /* RT_OS_LINUX */
+
+
+/**
+ * Writes a frame to the TAP device.
+ *
+ * When the device uses virtio-net headers the header and the frame are
+ * written in one go using writev, passing on the GSO context if given.
+ *
+ * @returns VBox status code.
+ * @param   pThis           The instance data.
+ * @param   pvFrame         The frame.  GSO frames are modified in place to
+ *                          get the headers ready for the host.
+ * @param   cbFrame         The frame size.
+ * @param   pGso            The GSO context, NULL if plain frame.  Must be
+ *                          offloadable (see drvTAPIsGsoOffloadable).
+ */
+static int drvTAPWriteFrame(PDRVTAP pThis, void *pvFrame, size_t cbFrame, PCPDMNETWORKGSO pGso)
+{
+#ifdef RT_OS_LINUX
+    if (pThis->fVNetHdr)
+    {
+        DRVTAPVNETHDR VNetHdr;
+        RT_ZERO(VNetHdr);
+        if (pGso)
+        {
+            Assert(drvTAPIsGsoOffloadable(pGso));
+            VNetHdr.fFlags       = DRVTAP_VNETHDR_F_NEEDS_CSUM;
+            VNetHdr.u8GsoType    = pGso->u8Type == PDMNETWORKGSOTYPE_IPV4_TCP
+                                 ? DRVTAP_VNETHDR_GSO_TCPV4 : DRVTAP_VNETHDR_GSO_TCPV6;
+            VNetHdr.cbHdrs       = pGso->cbHdrsTotal;
+            VNetHdr.cbGsoSize    = pGso->cbMaxSeg;
+            VNetHdr.offCsumStart = pGso->offHdr2;
+            VNetHdr.offCsum      = RT_OFFSETOF(RTNETTCP, th_sum);
+
+            /* The host segments the frame using the headers as templates, so
+               the IP total length, the IPv4 header checksum and the TCP pseudo
+               header checksum must be set up like for a real NIC. */
+            PDMNetGsoPrepForDirectUse(pGso, pvFrame, cbFrame, PDMNETCSUMTYPE_PSEUDO);
+        }
+
+        struct iovec aIov[2];
+        aIov[0].iov_base = &VNetHdr;
+        aIov[0].iov_len  = sizeof(VNetHdr);
+        aIov[1].iov_base = (void *)pvFrame;
+        aIov[1].iov_len  = cbFrame;
+        if (writev(RTFileToNative(pThis->hFileDevice), &aIov[0], RT_ELEMENTS(aIov)) >= 0)
+            return VINF_SUCCESS;
+        return RTErrConvertFromErrno(errno);
+    }
+#endif
+    RT_NOREF(pGso);
+    return RTFileWrite(pThis->hFileDevice, pvFrame, cbFrame, NULL);
+}
+
+
 
 /**
  * @interface_method_impl{PDMINETWORKUP,pfnBeginXmit}
@@ -263,8 +597,17 @@ static DECLCALLBACK(int) drvTAPNetworkUp_SendBuf(PPDMINETWORKUP pInterface, PPDM
               "%.*Rhxd\n",
               pSgBuf->aSegs[0].pvSeg, pSgBuf->cbUsed, pSgBuf->cbUsed, pSgBuf->aSegs[0].pvSeg));
 
-        rc = RTFileWrite(pThis->hFileDevice, pSgBuf->aSegs[0].pvSeg, pSgBuf->cbUsed, NULL);
+        rc = drvTAPWriteFrame(pThis, pSgBuf->aSegs[0].pvSeg, pSgBuf->cbUsed, NULL);
+    }
+#ifdef RT_OS_LINUX
+    else if (   pThis->fVNetHdr
+             && drvTAPIsGsoOffloadable((PCPDMNETWORKGSO)pSgBuf->pvUser))
+    {
+        /* Let the host do the segmentation. */
+        STAM_COUNTER_INC(&pThis->StatPktSentGso);
+        rc = drvTAPWriteFrame(pThis, pSgBuf->aSegs[0].pvSeg, pSgBuf->cbUsed, (PCPDMNETWORKGSO)pSgBuf->pvUser);
     }
+#endif
     else
     {
         uint8_t         abHdrScratch[256];
@@ -277,7 +620,7 @@ static DECLCALLBACK(int) drvTAPNetworkUp_SendBuf(PPDMINETWORKUP pInterface, PPDM
             uint32_t cbSegFrame;
             void *pvSegFrame = PDMNetGsoCarveSegmentQD(pGso, (uint8_t *)pbFrame, pSgBuf->cbUsed, abHdrScratch,
                                                        iSeg, cSegs, &cbSegFrame);
-            rc = RTFileWrite(pThis->hFileDevice, pvSegFrame, cbSegFrame, NULL);
+            rc = drvTAPWriteFrame(pThis, pvSegFrame, cbSegFrame, NULL);
             if (RT_FAILURE(rc))
                 break;
         }
@@ -330,17 +673,165 @@ static DECLCALLBACK(void) drvTAPNetworkUp_NotifyLinkChanged(PPDMINETWORKUP pInte
 }
 
 
+/**
+ * Passes a received frame up to the device/driver above us.
+ *
+ * The queue threads are serialized here as the devices aren't prepared for
+ * concurrent pfnWaitReceiveAvail callers.
+ *
+ * @param   pThis           The instance data.
+ * @param   pbFrame         The frame.
+ * @param   cbFrame         The frame size.
+ * @param   pGso            The GSO context if it's a GSO frame, otherwise NULL.
+ */
+static void drvTAPRecvFrame(PDRVTAP pThis, uint8_t *pbFrame, size_t cbFrame, PCPDMNETWORKGSO pGso)
+{
+    RTCritSectEnter(&pThis->RecvLock);
+
+    /*
+     * Wait for the device to have space for this frame.
+     * Most guests use frame-sized receive buffers, hence non-zero cbMax
+     * automatically means there is enough room for entire frame. Some
+     * guests (eg. Solaris) use large chains of small receive buffers
+     * (each 128 or so bytes large). We will still start receiving as soon
+     * as cbMax is non-zero because:
+     *  - it would be quite expensive for pfnCanReceive to accurately
+     *    determine free receive buffer space
+     *  - if we were waiting for enough free buffers, there is a risk
+     *    of deadlocking because the guest could be waiting for a receive
+     *    overflow error to allocate more receive buffers
+     */
+    STAM_PROFILE_ADV_STOP(&pThis->StatReceive, a);
+    int rc = pThis->pIAboveNet->pfnWaitReceiveAvail(pThis->pIAboveNet, RT_INDEFINITE_WAIT);
+    STAM_PROFILE_ADV_START(&pThis->StatReceive, a);
+
+    /*
+     * A return code != VINF_SUCCESS means that we were woken up during a VM
+     * state transition. Drop the packet and wait for the next one.
+     */
+    if (RT_SUCCESS(rc))
+    {
+        /*
+         * Pass the data up.
+         */
+#ifdef LOG_ENABLED
+        uint64_t u64Now = RTTimeProgramNanoTS();
+        LogFlow(("drvTAPAsyncIoThread: %-4d bytes at %llu ns  deltas: r=%llu t=%llu\n",
+                 cbFrame, u64Now, u64Now - pThis->u64LastReceiveTS, u64Now - pThis->u64LastTransferTS));
+        pThis->u64LastReceiveTS = u64Now;
+#endif
+        Log2(("drvTAPAsyncIoThread: cbRead=%#x\n" "%.*Rhxd\n", cbFrame, cbFrame, pbFrame));
+        STAM_COUNTER_INC(&pThis->StatPktRecv);
+        STAM_COUNTER_ADD(&pThis->StatPktRecvBytes, cbFrame);
+        if (!pGso)
+        {
+            rc = pThis->pIAboveNet->pfnReceive(pThis->pIAboveNet, pbFrame, cbFrame);
+            AssertRC(rc);
+        }
+        else
+        {
+            STAM_COUNTER_INC(&pThis->StatPktRecvGso);
+            if (   !pThis->pIAboveNet->pfnReceiveGso
+                || RT_FAILURE(pThis->pIAboveNet->pfnReceiveGso(pThis->pIAboveNet, pbFrame, cbFrame, pGso)))
+            {
+                /*
+                 * The device can't take GSO frames, so do the segmentation here.
+                 */
+                uint8_t         abHdrScratch[256];
+                uint32_t const  cSegs = PDMNetGsoCalcSegmentCount(pGso, cbFrame);
+                for (uint32_t iSeg = 0; iSeg < cSegs; iSeg++)
+                {
+                    uint32_t cbSegFrame;
+                    void    *pvSegFrame = PDMNetGsoCarveSegmentQD(pGso, pbFrame, cbFrame, abHdrScratch,
+                                                                  iSeg, cSegs, &cbSegFrame);
+                    if (iSeg > 0)
+                    {
+                        STAM_PROFILE_ADV_STOP(&pThis->StatReceive, a);
+                        rc = pThis->pIAboveNet->pfnWaitReceiveAvail(pThis->pIAboveNet, RT_INDEFINITE_WAIT);
+                        STAM_PROFILE_ADV_START(&pThis->StatReceive, a);
+                        if (RT_FAILURE(rc))
+                            break; /* we drop the rest. */
+                    }
+                    rc = pThis->pIAboveNet->pfnReceive(pThis->pIAboveNet, pvSegFrame, cbSegFrame);
+                    AssertRC(rc);
+                }
+            }
+        }
+    }
+
+    RTCritSectLeave(&pThis->RecvLock);
+}
+
+
+/**
+ * Reads a frame from a TAP queue into the queue receive buffer.
+ *
+ * @returns VBox status code, VERR_TRY_AGAIN if there is nothing to read.
+ * @param   pThis           The instance data.
+ * @param   pQueue          The queue to read from.
+ * @param   pcbFrame        Where to return the frame size.
+ * @param   ppGso           Where to return the GSO context (pointing to
+ *                          @a pGsoBuf) if it's a GSO frame, otherwise NULL.
+ * @param   pGsoBuf         Buffer for the GSO context.
+ */
+static int drvTAPReadFrame(PDRVTAP pThis, PDRVTAPQUEUE pQueue, size_t *pcbFrame, PCPDMNETWORKGSO *ppGso, PPDMNETWORKGSO pGsoBuf)
+{
+    *ppGso = NULL;
+#ifdef RT_OS_LINUX
+    if (pThis->fVNetHdr)
+    {
+        DRVTAPVNETHDR VNetHdr;
+        struct iovec          aIov[2];
+        aIov[0].iov_base = &VNetHdr;
+        aIov[0].iov_len  = sizeof(VNetHdr);
+        aIov[1].iov_base = pQueue->pbRecvBuf;
+        aIov[1].iov_len  = DRVTAP_RECV_BUF_SIZE;
+        ssize_t cbRead = readv(RTFileToNative(pQueue->hFile), &aIov[0], RT_ELEMENTS(aIov));
+        if (cbRead < 0)
+            return RTErrConvertFromErrno(errno);
+        if ((size_t)cbRead <= sizeof(VNetHdr))
+            return VERR_NET_MSG_SIZE;
+        size_t const cbFrame = (size_t)cbRead - sizeof(VNetHdr);
+        *pcbFrame = cbFrame;
+
+        /*
+         * Apply the offload information from the host.
+         */
+        if (VNetHdr.u8GsoType != DRVTAP_VNETHDR_GSO_NONE)
+        {
+            if (!drvTAPSetupGsoCtx(pGsoBuf, &VNetHdr, pQueue->pbRecvBuf, cbFrame))
+            {
+                LogFlow(("drvTAPReadFrame: Invalid GSO frame: u8GsoType=%#x fFlags=%#x offCsumStart=%#x cbGsoSize=%#x cbFrame=%#zx\n",
+                         VNetHdr.u8GsoType, VNetHdr.fFlags, VNetHdr.offCsumStart, VNetHdr.cbGsoSize, cbFrame));
+                return VERR_INVALID_PARAMETER;
+            }
+            *ppGso = pGsoBuf;
+        }
+        else if (VNetHdr.fFlags & DRVTAP_VNETHDR_F_NEEDS_CSUM)
+            drvTAPCompleteChecksum(&VNetHdr, pQueue->pbRecvBuf, cbFrame);
+        return VINF_SUCCESS;
+    }
+#else
+    RT_NOREF(pThis, pGsoBuf);
+#endif
+    return RTFileRead(pQueue->hFile, pQueue->pbRecvBuf, DRVTAP_RECV_BUF_SIZE, pcbFrame);
+}
+
+
 /**
  * Asynchronous I/O thread for handling receive.
  *
+ * There is one of these per TAP queue.
+ *
  * @returns VINF_SUCCESS (ignored).
  * @param   Thread          Thread handle.
- * @param   pvUser          Pointer to a DRVTAP structure.
+ * @param   pvUser          Pointer to a DRVTAPQUEUE structure.
  */
 static DECLCALLBACK(int) drvTAPAsyncIoThread(PPDMDRVINS pDrvIns, PPDMTHREAD pThread)
 {
-    PDRVTAP pThis = PDMINS_2_DATA(pDrvIns, PDRVTAP);
-    LogFlow(("drvTAPAsyncIoThread: pThis=%p\n", pThis));
+    PDRVTAP      pThis  = PDMINS_2_DATA(pDrvIns, PDRVTAP);
+    PDRVTAPQUEUE pQueue = (PDRVTAPQUEUE)pThread->pvUser;
+    LogFlow(("drvTAPAsyncIoThread: pThis=%p iQueue=%u\n", pThis, pQueue->iQueue));
 
     if (pThread->enmState == PDMTHREADSTATE_INITIALIZING)
         return VINF_SUCCESS;
@@ -356,10 +847,10 @@ static DECLCALLBACK(int) drvTAPAsyncIoThread(PPDMDRVINS pDrvIns, PPDMTHREAD pThr
          * Wait for something to become available.
          */
         struct pollfd aFDs[2];
-        aFDs[0].fd      = RTFileToNative(pThis->hFileDevice);
+        aFDs[0].fd      = RTFileToNative(pQueue->hFile);
         aFDs[0].events  = POLLIN | POLLPRI;
         aFDs[0].revents = 0;
-        aFDs[1].fd      = RTPipeToNative(pThis->hPipeRead);
+        aFDs[1].fd      = RTPipeToNative(pQueue->hPipeRead);
         aFDs[1].events  = POLLIN | POLLPRI | POLLERR | POLLHUP;
         aFDs[1].revents = 0;
         STAM_PROFILE_ADV_STOP(&pThis->StatReceive, a);
@@ -376,62 +867,42 @@ static DECLCALLBACK(int) drvTAPAsyncIoThread(PPDMDRVINS pDrvIns, PPDMTHREAD pThr
             &&  !aFDs[1].revents)
         {
             /*
-             * Read the frame.
+             * Read frames until the queue is drained or we've done a batch.
              */
-            char achBuf[16384];
-            size_t cbRead = 0;
             /** @note At least on Linux we will never receive more than one network packet
-             *        after poll() returned successfully. I don't know why but a second
-             *        RTFileRead() operation will return with VERR_TRY_AGAIN in any case. */
-            rc = RTFileRead(pThis->hFileDevice, achBuf, sizeof(achBuf), &cbRead);
-            if (RT_SUCCESS(rc))
-            {
-                /*
-                 * Wait for the device to have space for this frame.
-                 * Most guests use frame-sized receive buffers, hence non-zero cbMax
-                 * automatically means there is enough room for entire frame. Some
-                 * guests (eg. Solaris) use large chains of small receive buffers
-                 * (each 128 or so bytes large). We will still start receiving as soon
-                 * as cbMax is non-zero because:
-                 *  - it would be quite expensive for pfnCanReceive to accurately
-                 *    determine free receive buffer space
-                 *  - if we were waiting for enough free buffers, there is a risk
-                 *    of deadlocking because the guest could be waiting for a receive
-                 *    overflow error to allocate more receive buffers
-                 */
-                STAM_PROFILE_ADV_STOP(&pThis->StatReceive, a);
-                int rc1 = pThis->pIAboveNet->pfnWaitReceiveAvail(pThis->pIAboveNet, RT_INDEFINITE_WAIT);
-                STAM_PROFILE_ADV_START(&pThis->StatReceive, a);
-
-                /*
-                 * A return code != VINF_SUCCESS means that we were woken up during a VM
-                 * state transition. Drop the packet and wait for the next one.
-                 */
-                if (RT_FAILURE(rc1))
-                    continue;
-
-                /*
-                 * Pass the data up.
-                 */
-#ifdef LOG_ENABLED
-                uint64_t u64Now = RTTimeProgramNanoTS();
-                LogFlow(("drvTAPAsyncIoThread: %-4d bytes at %llu ns  deltas: r=%llu t=%llu\n",
-                         cbRead, u64Now, u64Now - pThis->u64LastReceiveTS, u64Now - pThis->u64LastTransferTS));
-                pThis->u64LastReceiveTS = u64Now;
-#endif
-                Log2(("drvTAPAsyncIoThread: cbRead=%#x\n" "%.*Rhxd\n", cbRead, cbRead, achBuf));
-                STAM_COUNTER_INC(&pThis->StatPktRecv);
-                STAM_COUNTER_ADD(&pThis->StatPktRecvBytes, cbRead);
-                rc1 = pThis->pIAboveNet->pfnReceive(pThis->pIAboveNet, achBuf, cbRead);
-                AssertRC(rc1);
-            }
-            else
+             *        per read, so we have to keep reading till we get VERR_TRY_AGAIN to
+             *        save the poll() calls. */
+            uint32_t cFrames = 0;
+            while (   cFrames < DRVTAP_RECV_BATCH
+                   && pThread->enmState == PDMTHREADSTATE_RUNNING)
             {
-                LogFlow(("drvTAPAsyncIoThread: RTFileRead -> %Rrc\n", rc));
-                if (rc == VERR_INVALID_HANDLE)
+                PDMNETWORKGSO   GsoBuf;
+                PCPDMNETWORKGSO pGso;
+                size_t          cbRead = 0;
+                rc = drvTAPReadFrame(pThis, pQueue, &cbRead, &pGso, &GsoBuf);
+                if (RT_SUCCESS(rc))
+                {
+                    cFrames++;
+                    drvTAPRecvFrame(pThis, pQueue->pbRecvBuf, cbRead, pGso);
+                }
+                else if (rc == VERR_TRY_AGAIN && cFrames > 0)
                     break;
-                RTThreadYield();
+                else if (rc == VERR_INVALID_PARAMETER || rc == VERR_NET_MSG_SIZE)
+                    cFrames++; /* bad frame, drop it */
+                else
+                {
+                    LogFlow(("drvTAPAsyncIoThread: RTFileRead -> %Rrc\n", rc));
+                    if (rc == VERR_INVALID_HANDLE)
+                    {
+                        STAM_PROFILE_ADV_STOP(&pThis->StatReceive, a);
+                        return VINF_SUCCESS;
+                    }
+                    RTThreadYield();
+                    break;
+                }
             }
+            if (cFrames)
+                STAM_PROFILE_ADD_PERIOD(&pThis->StatRecvFramesPerWakeup, cFrames);
         }
         else if (   rc > 0
                  && aFDs[1].revents)
@@ -443,7 +914,7 @@ static DECLCALLBACK(int) drvTAPAsyncIoThread(PPDMDRVINS pDrvIns, PPDMTHREAD pThr
             /* drain the pipe */
             char ch;
             size_t cbRead;
-            RTPipeRead(pThis->hPipeRead, &ch, 1, &cbRead);
+            RTPipeRead(pQueue->hPipeRead, &ch, 1, &cbRead);
         }
         else
         {
@@ -477,11 +948,11 @@ static DECLCALLBACK(int) drvTAPAsyncIoThread(PPDMDRVINS pDrvIns, PPDMTHREAD pThr
  */
 static DECLCALLBACK(int) drvTapAsyncIoWakeup(PPDMDRVINS pDrvIns, PPDMTHREAD pThread)
 {
-    RT_NOREF(pThread);
-    PDRVTAP pThis = PDMINS_2_DATA(pDrvIns, PDRVTAP);
+    RT_NOREF(pDrvIns);
+    PDRVTAPQUEUE pQueue = (PDRVTAPQUEUE)pThread->pvUser;
 
     size_t cbIgnored;
-    int rc = RTPipeWrite(pThis->hPipeWrite, "", 1, &cbIgnored);
+    int rc = RTPipeWrite(pQueue->hPipeWrite, "", 1, &cbIgnored);
     AssertRC(rc);
 
     return VINF_SUCCESS;
@@ -782,18 +1253,30 @@ static DECLCALLBACK(void) drvTAPDestruct(PPDMDRVINS pDrvIns)
     PDMDRV_CHECK_VERSIONS_RETURN_VOID(pDrvIns);
 
     /*
-     * Terminate the control pipe.
+     * Terminate the control pipes and close the additional queues.
      */
     int rc;
-    if (pThis->hPipeWrite != NIL_RTPIPE)
-    {
-        rc = RTPipeClose(pThis->hPipeWrite); AssertRC(rc);
-        pThis->hPipeWrite = NIL_RTPIPE;
-    }
-    if (pThis->hPipeRead != NIL_RTPIPE)
+    for (uint32_t iQueue = 0; iQueue < RT_ELEMENTS(pThis->aQueues); iQueue++)
     {
-        rc = RTPipeClose(pThis->hPipeRead); AssertRC(rc);
-        pThis->hPipeRead = NIL_RTPIPE;
+        PDRVTAPQUEUE pQueue = &pThis->aQueues[iQueue];
+        if (pQueue->hPipeWrite != NIL_RTPIPE)
+        {
+            rc = RTPipeClose(pQueue->hPipeWrite); AssertRC(rc);
+            pQueue->hPipeWrite = NIL_RTPIPE;
+        }
+        if (pQueue->hPipeRead != NIL_RTPIPE)
+        {
+            rc = RTPipeClose(pQueue->hPipeRead); AssertRC(rc);
+            pQueue->hPipeRead = NIL_RTPIPE;
+        }
+        /* The first queue uses hFileDevice which isn't ours on most hosts. */
+        if (iQueue > 0 && pQueue->hFile != NIL_RTFILE)
+        {
+            rc = RTFileClose(pQueue->hFile); AssertRC(rc);
+        }
+        pQueue->hFile = NIL_RTFILE;
+        RTMemFree(pQueue->pbRecvBuf);
+        pQueue->pbRecvBuf = NULL;
     }
 
 #ifdef RT_OS_SOLARIS
@@ -832,6 +1315,8 @@ static DECLCALLBACK(void) drvTAPDestruct(PPDMDRVINS pDrvIns)
      */
     if (RTCritSectIsInitialized(&pThis->XmitLock))
         RTCritSectDelete(&pThis->XmitLock);
+    if (RTCritSectIsInitialized(&pThis->RecvLock))
+        RTCritSectDelete(&pThis->RecvLock);
 
 #ifdef VBOX_WITH_STATISTICS
     /*
@@ -841,6 +1326,9 @@ static DECLCALLBACK(void) drvTAPDestruct(PPDMDRVINS pDrvIns)
     PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->StatPktSentBytes);
     PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->StatPktRecv);
     PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->StatPktRecvBytes);
+    PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->StatPktSentGso);
+    PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->StatPktRecvGso);
+    PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->StatRecvFramesPerWakeup);
     PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->StatTransmit);
     PDMDrvHlpSTAMDeregister(pDrvIns, &pThis->StatReceive);
 #endif /* VBOX_WITH_STATISTICS */
@@ -863,8 +1351,6 @@ static DECLCALLBACK(int) drvTAPConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pCfg, uin
      */
     pThis->pDrvIns                      = pDrvIns;
     pThis->hFileDevice                  = NIL_RTFILE;
-    pThis->hPipeWrite                   = NIL_RTPIPE;
-    pThis->hPipeRead                    = NIL_RTPIPE;
     pThis->pszDeviceName                = NULL;
 #ifdef RT_OS_SOLARIS
     pThis->iIPFileDes                   = -1;
@@ -872,6 +1358,16 @@ static DECLCALLBACK(int) drvTAPConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pCfg, uin
 #endif
     pThis->pszSetupApplication          = NULL;
     pThis->pszTerminateApplication      = NULL;
+    pThis->cQueues                      = 1;
+    pThis->fVNetHdr                     = false;
+    for (uint32_t iQueue = 0; iQueue < RT_ELEMENTS(pThis->aQueues); iQueue++)
+    {
+        pThis->aQueues[iQueue].pThis        = pThis;
+        pThis->aQueues[iQueue].hFile        = NIL_RTFILE;
+        pThis->aQueues[iQueue].hPipeWrite   = NIL_RTPIPE;
+        pThis->aQueues[iQueue].hPipeRead    = NIL_RTPIPE;
+        pThis->aQueues[iQueue].iQueue       = iQueue;
+    }
 
     /* IBase */
     pDrvIns->IBase.pfnQueryInterface    = drvTAPQueryInterface;
@@ -892,6 +1388,9 @@ static DECLCALLBACK(int) drvTAPConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pCfg, uin
     PDMDrvHlpSTAMRegisterF(pDrvIns, &pThis->StatPktSentBytes,  STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_BYTES,             "Number of sent bytes.",            "/Drivers/TAP%d/Bytes/Sent", pDrvIns->iInstance);
     PDMDrvHlpSTAMRegisterF(pDrvIns, &pThis->StatPktRecv,       STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES,        "Number of received packets.",      "/Drivers/TAP%d/Packets/Received", pDrvIns->iInstance);
     PDMDrvHlpSTAMRegisterF(pDrvIns, &pThis->StatPktRecvBytes,  STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_BYTES,             "Number of received bytes.",        "/Drivers/TAP%d/Bytes/Received", pDrvIns->iInstance);
+    PDMDrvHlpSTAMRegisterF(pDrvIns, &pThis->StatPktSentGso,    STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES,        "Number of GSO frames segmented by the host.", "/Drivers/TAP%d/Packets/Sent-Gso", pDrvIns->iInstance);
+    PDMDrvHlpSTAMRegisterF(pDrvIns, &pThis->StatPktRecvGso,    STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES,        "Number of GSO frames received from the host.", "/Drivers/TAP%d/Packets/Received-Gso", pDrvIns->iInstance);
+    PDMDrvHlpSTAMRegisterF(pDrvIns, &pThis->StatRecvFramesPerWakeup, STAMTYPE_PROFILE, STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES,  "Frames read per receive thread wakeup.", "/Drivers/TAP%d/RecvFramesPerWakeup", pDrvIns->iInstance);
     PDMDrvHlpSTAMRegisterF(pDrvIns, &pThis->StatTransmit,      STAMTYPE_PROFILE, STAMVISIBILITY_ALWAYS, STAMUNIT_TICKS_PER_CALL,    "Profiling packet transmit runs.",  "/Drivers/TAP%d/Transmit", pDrvIns->iInstance);
     PDMDrvHlpSTAMRegisterF(pDrvIns, &pThis->StatReceive,       STAMTYPE_PROFILE, STAMVISIBILITY_ALWAYS, STAMUNIT_TICKS_PER_CALL,    "Profiling packet receive runs.",   "/Drivers/TAP%d/Receive", pDrvIns->iInstance);
 #endif /* VBOX_WITH_STATISTICS */
@@ -899,7 +1398,7 @@ static DECLCALLBACK(int) drvTAPConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pCfg, uin
     /*
      * Validate the config.
      */
-    if (!CFGMR3AreValuesValid(pCfg, "Device\0InitProg\0TermProg\0FileHandle\0TAPSetupApplication\0TAPTerminateApplication\0MAC"))
+    if (!CFGMR3AreValuesValid(pCfg, "Device\0InitProg\0TermProg\0FileHandle\0TAPSetupApplication\0TAPTerminateApplication\0MAC\0Queues"))
         return PDMDRV_SET_ERROR(pDrvIns, VERR_PDM_DRVINS_UNKNOWN_CFG_VALUES, "");
 
     /*
@@ -976,10 +1475,12 @@ static DECLCALLBACK(int) drvTAPConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pCfg, uin
 #endif /* !RT_OS_SOLARIS */
 
     /*
-     * Create the transmit lock.
+     * Create the transmit and receive locks.
      */
     rc = RTCritSectInit(&pThis->XmitLock);
     AssertRCReturn(rc, rc);
+    rc = RTCritSectInit(&pThis->RecvLock);
+    AssertRCReturn(rc, rc);
 
     /*
      * Make sure the descriptor is non-blocking and valid.
@@ -992,19 +1493,49 @@ static DECLCALLBACK(int) drvTAPConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pCfg, uin
                                    N_("Configuration error: Failed to configure /dev/net/tun. errno=%d"), errno);
     /** @todo determine device name. This can be done by reading the link /proc/<pid>/fd/<fd> */
     Log(("drvTAPContruct: %d (from fd)\n", (intptr_t)pThis->hFileDevice));
+    pThis->aQueues[0].hFile = pThis->hFileDevice;
     rc = VINF_SUCCESS;
 
-    /*
-     * Create the control pipe.
-     */
-    rc = RTPipeCreate(&pThis->hPipeRead, &pThis->hPipeWrite, 0 /*fFlags*/);
-    AssertRCReturn(rc, rc);
+#ifdef RT_OS_LINUX
+    /** @cfgm{Queues, uint32_t, 1}
+     * The number of TAP queues to service, each by its own receive thread.  This
+     * requires the TAP device to be set up with IFF_MULTI_QUEUE and is quietly
+     * limited to 1 otherwise. */
+    uint32_t cQueues;
+    rc = CFGMR3QueryU32Def(pCfg, "Queues", &cQueues, 1);
+    if (RT_FAILURE(rc))
+        return PDMDRV_SET_ERROR(pDrvIns, rc, N_("Configuration error: failed to query \"Queues\""));
+    if (cQueues < 1 || cQueues > DRVTAP_MAX_QUEUES)
+        return PDMDrvHlpVMSetError(pDrvIns, VERR_INVALID_PARAMETER, RT_SRC_POS,
+                                   N_("Configuration error: \"Queues\" must be between 1 and %u"), DRVTAP_MAX_QUEUES);
+
+    rc = drvTAPLinuxSetupOffloadAndQueues(pThis, cQueues);
+    if (RT_FAILURE(rc))
+        return rc;
+#endif
 
     /*
-     * Create the async I/O thread.
+     * Create the control pipes, receive buffers and the async I/O threads.
      */
-    rc = PDMDrvHlpThreadCreate(pDrvIns, &pThis->pThread, pThis, drvTAPAsyncIoThread, drvTapAsyncIoWakeup, 128 * _1K, RTTHREADTYPE_IO, "TAP");
-    AssertRCReturn(rc, rc);
+    for (uint32_t iQueue = 0; iQueue < pThis->cQueues; iQueue++)
+    {
+        PDRVTAPQUEUE pQueue = &pThis->aQueues[iQueue];
+        rc = RTPipeCreate(&pQueue->hPipeRead, &pQueue->hPipeWrite, 0 /*fFlags*/);
+        AssertRCReturn(rc, rc);
+
+        pQueue->pbRecvBuf = (uint8_t *)RTMemAlloc(DRVTAP_RECV_BUF_SIZE);
+        if (!pQueue->pbRecvBuf)
+            return VERR_NO_MEMORY;
+
+        char szName[16];
+        if (iQueue == 0)
+            RTStrCopy(szName, sizeof(szName), "TAP");
+        else
+            RTStrPrintf(szName, sizeof(szName), "TAP-Q%u", iQueue);
+        rc = PDMDrvHlpThreadCreate(pDrvIns, &pQueue->pThread, pQueue, drvTAPAsyncIoThread, drvTapAsyncIoWakeup,
+                                   128 * _1K, RTTHREADTYPE_IO, szName);
+        AssertRCReturn(rc, rc);
+    }
 
     return rc;
 }
@@ -0,0 +1,500 @@
+/* $Id$ */
+/** @file
+ * Large receive offload (LRO) - TCP segment coalescing for network devices.
+ *
+ * Consecutive in-order TCP segments of the same flow are merged into one
+ * large frame which the device hands to the guest as a GSO frame, so the
+ * guest processes (and gets interrupted for) one frame instead of dozens.
+ * Only plain ACK/PSH data segments without IP options or fragmentation are
+ * merged, anything else flushes the flow it belongs to and is passed on
+ * untouched so the ordering within a flow is preserved.  Segments are only
+ * merged if their checksums are correct, as the merged frame gets a freshly
+ * calculated one and corrupted data would no longer be detectable.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#define LOG_GROUP LOG_GROUP_DEV
+#include "NetLro.h"
+
+#include <VBox/log.h>
+#include <VBox/vmm/pdmnetinline.h>
+#include <iprt/assert.h>
+#include <iprt/err.h>
+#include <iprt/mem.h>
+#include <iprt/net.h>
+#include <iprt/string.h>
+
+
+/*********************************************************************************************************************************
+*   Structures and Typedefs                                                                                                      *
+*********************************************************************************************************************************/
+/**
+ * Classification of a received frame.
+ */
+typedef enum NETLROCLASS
+{
+    /** Not TCP over IPv4/IPv6, or not a type the guest accepts. */
+    NETLROCLASS_OTHER = 0,
+    /** TCP, but not mergeable (control flags, no payload, options, ...). */
+    NETLROCLASS_TCP,
+    /** A mergeable TCP data segment. */
+    NETLROCLASS_MERGEABLE
+} NETLROCLASS;
+
+/**
+ * Parsed TCP segment.
+ */
+typedef struct NETLROSEG
+{
+    /** The GSO type the segment would be merged as. */
+    uint8_t             u8GsoType;
+    /** Offset of the IP header. */
+    uint8_t             offIp;
+    /** Offset of the TCP header. */
+    uint8_t             offTcp;
+    /** Size of all headers. */
+    uint8_t             cbHdrs;
+    /** The TCP flags. */
+    uint8_t             fFlags;
+    /** Size of the TCP payload. */
+    uint32_t            cbPayload;
+    /** The sequence number. */
+    uint32_t            uSeq;
+} NETLROSEG;
+
+
+/**
+ * Checks the IPv4 header checksum and the TCP checksum of a parsed segment.
+ */
+static bool netLroIsChecksumValid(uint8_t const *pbFrame, NETLROSEG const *pSeg)
+{
+    PCRTNETTCP     pTcp      = (PCRTNETTCP)&pbFrame[pSeg->offTcp];
+    uint8_t const *pbPayload = &pbFrame[pSeg->cbHdrs];
+    if (pSeg->u8GsoType == PDMNETWORKGSOTYPE_IPV4_TCP)
+    {
+        PCRTNETIPV4  pIp  = (PCRTNETIPV4)&pbFrame[pSeg->offIp];
+        size_t const cbIp = RT_N2H_U16(pIp->ip_len);
+        return RTNetIPv4IsHdrValid(pIp, RTNETIPV4_MIN_LEN, cbIp, true /*fChecksum*/)
+            && RTNetIPv4IsTCPValid(pIp, pTcp, pSeg->cbHdrs - pSeg->offTcp, pbPayload, cbIp - RTNETIPV4_MIN_LEN,
+                                   true /*fChecksum*/);
+    }
+    PCRTNETIPV6 pIp6 = (PCRTNETIPV6)&pbFrame[pSeg->offIp];
+    return RTNetTCPChecksum(RTNetIPv6PseudoChecksum(pIp6), pTcp, pbPayload, pSeg->cbPayload) == pTcp->th_sum;
+}
+
+
+/**
+ * Classifies a frame and parses the headers of TCP segments.
+ *
+ * @returns Frame class.
+ * @param   pbFrame     The frame.
+ * @param   cbFrame     The size of the frame.
+ * @param   fGsoTypes   Mask of the GSO types the guest accepts.
+ * @param   pSeg        Where to return the parsed segment.
+ * @param   pfBadCsum   Where to return whether an otherwise mergeable segment
+ *                      was rejected because of a bad checksum.
+ */
+static NETLROCLASS netLroClassify(uint8_t const *pbFrame, size_t cbFrame, uint32_t fGsoTypes, NETLROSEG *pSeg,
+                                  bool *pfBadCsum)
+{
+    if (cbFrame < sizeof(RTNETETHERHDR) + RTNETIPV4_MIN_LEN + RTNETTCP_MIN_LEN)
+        return NETLROCLASS_OTHER;
+
+    uint16_t const uEtherType = RT_MAKE_U16(pbFrame[13], pbFrame[12]);
+    uint8_t  const offIp      = sizeof(RTNETETHERHDR);
+    uint32_t       cbIp;
+    bool           fMergeable = true;
+    if (uEtherType == RTNET_ETHERTYPE_IPV4)
+    {
+        PCRTNETIPV4 pIp = (PCRTNETIPV4)&pbFrame[offIp];
+        if (   pIp->ip_v != 4
+            || pIp->ip_p != RTNETIPV4_PROT_TCP
+            || (RT_N2H_U16(pIp->ip_off) & UINT16_C(0x3fff)) /* MF or fragment offset */)
+            return NETLROCLASS_OTHER;
+        if (pIp->ip_hl != RTNETIPV4_MIN_LEN / 4)
+            fMergeable = false;
+        cbIp = RT_N2H_U16(pIp->ip_len);
+        pSeg->offTcp    = offIp + pIp->ip_hl * 4;
+        pSeg->u8GsoType = PDMNETWORKGSOTYPE_IPV4_TCP;
+    }
+    else if (uEtherType == RTNET_ETHERTYPE_IPV6)
+    {
+        if (cbFrame < sizeof(RTNETETHERHDR) + sizeof(RTNETIPV6) + RTNETTCP_MIN_LEN)
+            return NETLROCLASS_OTHER;
+        PCRTNETIPV6 pIp6 = (PCRTNETIPV6)&pbFrame[offIp];
+        if (   (pbFrame[offIp] >> 4) != 6
+            || pIp6->ip6_nxt != RTNETIPV4_PROT_TCP /* no extension headers */)
+            return NETLROCLASS_OTHER;
+        cbIp = sizeof(RTNETIPV6) + RT_N2H_U16(pIp6->ip6_plen);
+        pSeg->offTcp    = offIp + sizeof(RTNETIPV6);
+        pSeg->u8GsoType = PDMNETWORKGSOTYPE_IPV6_TCP;
+    }
+    else
+        return NETLROCLASS_OTHER;
+
+    /* Frames may carry Ethernet padding, the IP length is what counts. */
+    if (   cbIp > cbFrame - offIp
+        || (uint32_t)pSeg->offTcp + RTNETTCP_MIN_LEN > offIp + cbIp)
+        return NETLROCLASS_OTHER;
+
+    PCRTNETTCP     pTcp  = (PCRTNETTCP)&pbFrame[pSeg->offTcp];
+    uint32_t const cbTcp = pTcp->th_off * 4;
+    if (cbTcp < RTNETTCP_MIN_LEN || pSeg->offTcp + cbTcp > offIp + cbIp)
+        return NETLROCLASS_OTHER;
+
+    pSeg->offIp     = offIp;
+    pSeg->cbHdrs    = (uint8_t)(pSeg->offTcp + cbTcp);
+    pSeg->fFlags    = (uint8_t)pTcp->th_flags;
+    pSeg->cbPayload = offIp + cbIp - pSeg->cbHdrs;
+    pSeg->uSeq      = RT_N2H_U32(pTcp->th_seq);
+
+    if (   !fMergeable
+        || !(fGsoTypes & RT_BIT_32(pSeg->u8GsoType))
+        || (pSeg->fFlags & ~RTNETTCP_F_PSH) != RTNETTCP_F_ACK
+        || !pSeg->cbPayload)
+        return NETLROCLASS_TCP;
+    /* Leave damaged segments for the guest to discard. */
+    if (!netLroIsChecksumValid(pbFrame, pSeg))
+    {
+        *pfBadCsum = true;
+        return NETLROCLASS_TCP;
+    }
+    return NETLROCLASS_MERGEABLE;
+}
+
+
+/**
+ * Gets the number of bytes the IP length field of a flow covers.
+ */
+DECLINLINE(uint32_t) netLroIpLen(PNETLROFLOW pFlow, uint32_t cbFrame)
+{
+    /* The IPv4 total length includes the IP header, the IPv6 payload length doesn't. */
+    return pFlow->u8GsoType == PDMNETWORKGSOTYPE_IPV4_TCP
+         ? cbFrame - sizeof(RTNETETHERHDR)
+         : cbFrame - pFlow->offTcp;
+}
+
+
+/**
+ * Checks whether a segment belongs to a flow (same addresses and ports).
+ */
+static bool netLroIsSameFlow(PNETLROFLOW pFlow, uint8_t const *pbFrame, NETLROSEG const *pSeg)
+{
+    if (pFlow->u8GsoType != pSeg->u8GsoType)
+        return false;
+    uint8_t const *pbHdrs = pFlow->pbFrame;
+    if (pSeg->u8GsoType == PDMNETWORKGSOTYPE_IPV4_TCP)
+    {
+        if (memcmp(&pbHdrs[pSeg->offIp + 12], &pbFrame[pSeg->offIp + 12], 8)) /* ip_src, ip_dst */
+            return false;
+    }
+    else if (memcmp(&pbHdrs[pSeg->offIp + 8], &pbFrame[pSeg->offIp + 8], 32)) /* ip6_src, ip6_dst */
+        return false;
+    return !memcmp(&pbHdrs[pFlow->offTcp], &pbFrame[pSeg->offTcp], 4); /* th_sport, th_dport */
+}
+
+
+/**
+ * Checks whether a segment of a flow can be appended to it.
+ */
+static bool netLroCanAppend(PNETLROFLOW pFlow, uint8_t const *pbFrame, NETLROSEG const *pSeg)
+{
+    if (   pSeg->uSeq != pFlow->uSeqNext
+        || pSeg->cbHdrs != pFlow->cbHdrs
+        || pSeg->cbPayload > pFlow->cbMss
+        || netLroIpLen(pFlow, pFlow->cbFrame + pSeg->cbPayload) > UINT16_MAX)
+        return false;
+
+    uint8_t const *pbHdrs = pFlow->pbFrame;
+    if (pSeg->u8GsoType == PDMNETWORKGSOTYPE_IPV4_TCP)
+    {
+        /* Same TOS and TTL. */
+        if (   pbHdrs[pSeg->offIp + 1] != pbFrame[pSeg->offIp + 1]
+            || pbHdrs[pSeg->offIp + 8] != pbFrame[pSeg->offIp + 8])
+            return false;
+    }
+    else
+    {
+        /* Same traffic class, flow label and hop limit. */
+        if (   memcmp(&pbHdrs[pSeg->offIp], &pbFrame[pSeg->offIp], 4)
+            || pbHdrs[pSeg->offIp + 7] != pbFrame[pSeg->offIp + 7])
+            return false;
+    }
+
+    /* The TCP options must match, except for the timestamp values when the
+       options are the usual NOP, NOP, timestamp layout. */
+    uint32_t const offOpts = pSeg->offTcp + RTNETTCP_MIN_LEN;
+    uint32_t const cbOpts  = pSeg->cbHdrs - offOpts;
+    if (   cbOpts == 12
+        && pbFrame[offOpts] == 1 && pbFrame[offOpts + 1] == 1 && pbFrame[offOpts + 2] == 8 && pbFrame[offOpts + 3] == 10)
+        return !memcmp(&pbHdrs[offOpts], &pbFrame[offOpts], 4);
+    return !memcmp(&pbHdrs[offOpts], &pbFrame[offOpts], cbOpts);
+}
+
+
+/**
+ * Delivers the frame of a flow and frees the slot.
+ */
+static int netLroFlushFlow(PNETLRO pLro, PNETLROFLOW pFlow)
+{
+    Assert(pFlow->cbFrame);
+    int rc;
+    if (pFlow->cSegs == 1)
+        rc = pLro->pfnDeliver(pLro->pvUser, pFlow->pbFrame, pFlow->cbFrame, NULL);
+    else
+    {
+        PDMNETWORKGSO Gso;
+        Gso.u8Type      = pFlow->u8GsoType;
+        Gso.cbHdrsTotal = pFlow->cbHdrs;
+        Gso.cbHdrsSeg   = pFlow->cbHdrs;
+        Gso.cbMaxSeg    = pFlow->cbMss;
+        Gso.offHdr1     = sizeof(RTNETETHERHDR);
+        Gso.offHdr2     = pFlow->offTcp;
+        Gso.u8Unused    = 0;
+        /* Fix up the IP length (and IPv4 header checksum) and leave the pseudo
+           header checksum in the TCP header, as a sender doing TSO would. */
+        PDMNetGsoPrepForDirectUse(&Gso, pFlow->pbFrame, pFlow->cbFrame, PDMNETCSUMTYPE_PSEUDO);
+        STAM_REL_COUNTER_INC(&pLro->StatFramesMerged);
+        rc = pLro->pfnDeliver(pLro->pvUser, pFlow->pbFrame, pFlow->cbFrame, &Gso);
+    }
+    pFlow->cbFrame = 0;
+    pLro->cActive--;
+    return rc;
+}
+
+
+/**
+ * Creates a receive coalescer.
+ *
+ * @returns VBox status code.
+ * @param   cFlows      Number of flows to track, at most NETLRO_MAX_FLOWS.
+ * @param   pfnDeliver  Callback delivering frames to the guest.
+ * @param   pvUser      User argument for @a pfnDeliver.
+ * @param   ppLro       Where to return the coalescer.
+ */
+int NetLroCreate(uint32_t cFlows, PFNNETLRODELIVER pfnDeliver, void *pvUser, PNETLRO *ppLro)
+{
+    AssertReturn(cFlows > 0 && cFlows <= NETLRO_MAX_FLOWS, VERR_INVALID_PARAMETER);
+    AssertPtrReturn(pfnDeliver, VERR_INVALID_POINTER);
+
+    PNETLRO pLro = (PNETLRO)RTMemAllocZ(sizeof(*pLro));
+    if (!pLro)
+        return VERR_NO_MEMORY;
+    pLro->pfnDeliver = pfnDeliver;
+    pLro->pvUser     = pvUser;
+    pLro->cFlows     = cFlows;
+    for (uint32_t i = 0; i < cFlows; i++)
+    {
+        pLro->aFlows[i].pbFrame = (uint8_t *)RTMemAlloc(NETLRO_MAX_FRAME);
+        if (!pLro->aFlows[i].pbFrame)
+        {
+            NetLroDestroy(pLro);
+            return VERR_NO_MEMORY;
+        }
+    }
+    *ppLro = pLro;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Destroys a receive coalescer, frames still held are dropped.
+ *
+ * @param   pLro        The coalescer, NULL is ignored.
+ */
+void NetLroDestroy(PNETLRO pLro)
+{
+    if (!pLro)
+        return;
+    for (uint32_t i = 0; i < pLro->cFlows; i++)
+        RTMemFree(pLro->aFlows[i].pbFrame);
+    RTMemFree(pLro);
+}
+
+
+/**
+ * Passes a received frame through the coalescer.
+ *
+ * The frame is either merged into a flow, held as the start of a new flow or
+ * delivered right away.  Flows it cannot be merged into are flushed first.
+ *
+ * @returns VBox status code of the first failing delivery.
+ * @param   pLro        The coalescer.
+ * @param   pvFrame     The frame.
+ * @param   cbFrame     The size of the frame.
+ * @param   fGsoTypes   Mask of GSO types (RT_BIT_32(PDMNETWORKGSOTYPE_XXX))
+ *                      the guest can receive, frames are only merged into
+ *                      one of these.
+ * @param   tsNow       The current time (RTTimeNanoTS).
+ */
+int NetLroReceive(PNETLRO pLro, const void *pvFrame, size_t cbFrame, uint32_t fGsoTypes, uint64_t tsNow)
+{
+    uint8_t const *pbFrame = (uint8_t const *)pvFrame;
+    NETLROSEG      Seg;
+    bool           fBadCsum = false;
+    NETLROCLASS    enmClass = netLroClassify(pbFrame, cbFrame, fGsoTypes, &Seg, &fBadCsum);
+    if (fBadCsum)
+        STAM_REL_COUNTER_INC(&pLro->StatSegsBadCsum);
+    if (enmClass == NETLROCLASS_OTHER)
+    {
+        STAM_REL_COUNTER_INC(&pLro->StatFramesBypassed);
+        return pLro->pfnDeliver(pLro->pvUser, pvFrame, cbFrame, NULL);
+    }
+
+    /*
+     * Look up the flow.
+     */
+    int         rc    = VINF_SUCCESS;
+    PNETLROFLOW pFlow = NULL;
+    if (pLro->cActive)
+        for (uint32_t i = 0; i < pLro->cFlows; i++)
+            if (   pLro->aFlows[i].cbFrame
+                && netLroIsSameFlow(&pLro->aFlows[i], pbFrame, &Seg))
+            {
+                pFlow = &pLro->aFlows[i];
+                break;
+            }
+
+    if (pFlow)
+    {
+        if (   enmClass == NETLROCLASS_MERGEABLE
+            && netLroCanAppend(pFlow, pbFrame, &Seg))
+        {
+            /* Append the payload, take over the latest ACK, window and timestamps. */
+            uint8_t *pbHdrs = pFlow->pbFrame;
+            memcpy(&pbHdrs[pFlow->cbFrame], &pbFrame[Seg.cbHdrs], Seg.cbPayload);
+            memcpy(&pbHdrs[Seg.offTcp + 8], &pbFrame[Seg.offTcp + 8], 4);   /* th_ack */
+            memcpy(&pbHdrs[Seg.offTcp + 14], &pbFrame[Seg.offTcp + 14], 2); /* th_win */
+            memcpy(&pbHdrs[Seg.offTcp + RTNETTCP_MIN_LEN], &pbFrame[Seg.offTcp + RTNETTCP_MIN_LEN],
+                   Seg.cbHdrs - Seg.offTcp - RTNETTCP_MIN_LEN);
+            pbHdrs[Seg.offTcp + 13] |= Seg.fFlags & RTNETTCP_F_PSH;
+            pFlow->cbFrame  += Seg.cbPayload;
+            pFlow->uSeqNext += Seg.cbPayload;
+            pFlow->cSegs++;
+            STAM_REL_COUNTER_INC(&pLro->StatSegsMerged);
+
+            /* A short or pushed segment ends the burst, no point in waiting. */
+            if (   (Seg.fFlags & RTNETTCP_F_PSH)
+                || Seg.cbPayload < pFlow->cbMss
+                || netLroIpLen(pFlow, pFlow->cbFrame + pFlow->cbMss) > UINT16_MAX)
+                rc = netLroFlushFlow(pLro, pFlow);
+            return rc;
+        }
+
+        rc = netLroFlushFlow(pLro, pFlow);
+    }
+
+    /*
+     * Hold mergeable segments as the start of a new flow, unless they are
+     * pushed (interactive traffic) which would be flushed right away anyway.
+     */
+    if (   enmClass != NETLROCLASS_MERGEABLE
+        || (Seg.fFlags & RTNETTCP_F_PSH))
+    {
+        STAM_REL_COUNTER_INC(&pLro->StatFramesBypassed);
+        int rc2 = pLro->pfnDeliver(pLro->pvUser, pvFrame, cbFrame, NULL);
+        return RT_SUCCESS(rc) ? rc2 : rc;
+    }
+
+    PNETLROFLOW pOldest = NULL;
+    pFlow = NULL;
+    for (uint32_t i = 0; i < pLro->cFlows; i++)
+    {
+        if (!pLro->aFlows[i].cbFrame)
+        {
+            pFlow = &pLro->aFlows[i];
+            break;
+        }
+        if (!pOldest || pLro->aFlows[i].tsFirst < pOldest->tsFirst)
+            pOldest = &pLro->aFlows[i];
+    }
+    if (!pFlow)
+    {
+        STAM_REL_COUNTER_INC(&pLro->StatEvictions);
+        int rc2 = netLroFlushFlow(pLro, pOldest);
+        if (RT_SUCCESS(rc))
+            rc = rc2;
+        pFlow = pOldest;
+    }
+
+    pFlow->cbFrame   = Seg.cbHdrs + Seg.cbPayload; /* drops any Ethernet padding */
+    memcpy(pFlow->pbFrame, pbFrame, pFlow->cbFrame);
+    pFlow->cSegs     = 1;
+    pFlow->uSeqNext  = Seg.uSeq + Seg.cbPayload;
+    pFlow->cbMss     = (uint16_t)Seg.cbPayload;
+    pFlow->cbHdrs    = Seg.cbHdrs;
+    pFlow->offTcp    = Seg.offTcp;
+    pFlow->u8GsoType = Seg.u8GsoType;
+    pFlow->tsFirst   = tsNow;
+    pLro->cActive++;
+    return rc;
+}
+
+
+/**
+ * Delivers the flows which have been held since before the given time.
+ *
+ * @returns VBox status code of the first failing delivery.
+ * @param   pLro        The coalescer.
+ * @param   tsDeadline  Flush flows started at or before this time,
+ *                      UINT64_MAX flushes everything.
+ */
+int NetLroFlush(PNETLRO pLro, uint64_t tsDeadline)
+{
+    int rc = VINF_SUCCESS;
+    for (uint32_t i = 0; i < pLro->cFlows && pLro->cActive; i++)
+        if (   pLro->aFlows[i].cbFrame
+            && pLro->aFlows[i].tsFirst <= tsDeadline)
+        {
+            int rc2 = netLroFlushFlow(pLro, &pLro->aFlows[i]);
+            if (RT_SUCCESS(rc))
+                rc = rc2;
+        }
+    return rc;
+}
+
+
+/**
+ * Drops all frames held by the coalescer (device reset).
+ *
+ * @param   pLro        The coalescer.
+ */
+void NetLroDiscard(PNETLRO pLro)
+{
+    for (uint32_t i = 0; i < pLro->cFlows; i++)
+        pLro->aFlows[i].cbFrame = 0;
+    pLro->cActive = 0;
+}
+
+
+/**
+ * Gets the time the oldest held flow was started.
+ *
+ * @returns RTTimeNanoTS timestamp, UINT64_MAX if nothing is held.
+ * @param   pLro        The coalescer.
+ */
+uint64_t NetLroGetOldest(PNETLRO pLro)
+{
+    uint64_t tsOldest = UINT64_MAX;
+    if (pLro->cActive)
+        for (uint32_t i = 0; i < pLro->cFlows; i++)
+            if (pLro->aFlows[i].cbFrame && pLro->aFlows[i].tsFirst < tsOldest)
+                tsOldest = pLro->aFlows[i].tsFirst;
+    return tsOldest;
+}
+
@@ -0,0 +1,116 @@
+/* $Id$ */
+/** @file
+ * Large receive offload (LRO) - TCP segment coalescing for network devices.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ */
+
+#ifndef ___VBox_NetLro_h
+#define ___VBox_NetLro_h
+
+#include <VBox/types.h>
+#include <VBox/vmm/stam.h>
+
+RT_C_DECLS_BEGIN
+
+/** Maximum number of flows a coalescer keeps track of. */
+#define NETLRO_MAX_FLOWS        8
+/** Size of the per flow frame buffer: Ethernet, IPv6 and a maximum TCP
+ * header plus the largest payload an IP length field can describe. */
+#define NETLRO_MAX_FRAME        (14 + 40 + 60 + 65535)
+
+/**
+ * Callback delivering a (possibly coalesced) frame to the guest.
+ *
+ * @returns VBox status code.
+ * @param   pvUser      The user argument given to NetLroCreate.
+ * @param   pvFrame     The frame.
+ * @param   cbFrame     The size of the frame.
+ * @param   pGso        The GSO context if several segments were merged,
+ *                      NULL for a plain frame.  The TCP checksum field holds
+ *                      the pseudo header checksum in that case.
+ */
+typedef DECLCALLBACK(int) FNNETLRODELIVER(void *pvUser, const void *pvFrame, size_t cbFrame, PCPDMNETWORKGSO pGso);
+/** Pointer to a FNNETLRODELIVER. */
+typedef FNNETLRODELIVER *PFNNETLRODELIVER;
+
+/**
+ * A TCP flow being coalesced.
+ */
+typedef struct NETLROFLOW
+{
+    /** The frame being assembled (NETLRO_MAX_FRAME bytes). */
+    uint8_t            *pbFrame;
+    /** Size of the assembled frame, 0 if the slot is free. */
+    uint32_t            cbFrame;
+    /** Number of segments merged into the frame. */
+    uint32_t            cSegs;
+    /** The sequence number of the next in-order segment. */
+    uint32_t            uSeqNext;
+    /** Payload size of the first segment, used as MSS for the merged frame. */
+    uint16_t            cbMss;
+    /** Size of the Ethernet, IP and TCP headers. */
+    uint8_t             cbHdrs;
+    /** Offset of the TCP header. */
+    uint8_t             offTcp;
+    /** The GSO type (PDMNETWORKGSOTYPE) of the merged frame. */
+    uint8_t             u8GsoType;
+    /** When the first segment was received (RTTimeNanoTS). */
+    uint64_t            tsFirst;
+} NETLROFLOW;
+/** Pointer to a coalesced flow. */
+typedef NETLROFLOW *PNETLROFLOW;
+
+/**
+ * Receive coalescer instance.
+ *
+ * The caller serializes all calls.
+ */
+typedef struct NETLRO
+{
+    /** The delivery callback. */
+    PFNNETLRODELIVER    pfnDeliver;
+    /** User argument for pfnDeliver. */
+    void               *pvUser;
+    /** Number of flow slots. */
+    uint32_t            cFlows;
+    /** Number of flow slots in use. */
+    uint32_t            cActive;
+    /** The flow slots. */
+    NETLROFLOW          aFlows[NETLRO_MAX_FLOWS];
+
+    /** Number of segments merged into a previous segment. */
+    STAMCOUNTER         StatSegsMerged;
+    /** Number of merged frames delivered. */
+    STAMCOUNTER         StatFramesMerged;
+    /** Number of frames passed through untouched. */
+    STAMCOUNTER         StatFramesBypassed;
+    /** Number of flows flushed to make room for a new one. */
+    STAMCOUNTER         StatEvictions;
+    /** Number of segments not merged because of a bad checksum. */
+    STAMCOUNTER         StatSegsBadCsum;
+} NETLRO;
+/** Pointer to a receive coalescer. */
+typedef NETLRO *PNETLRO;
+
+int      NetLroCreate(uint32_t cFlows, PFNNETLRODELIVER pfnDeliver, void *pvUser, PNETLRO *ppLro);
+void     NetLroDestroy(PNETLRO pLro);
+int      NetLroReceive(PNETLRO pLro, const void *pvFrame, size_t cbFrame, uint32_t fGsoTypes, uint64_t tsNow);
+int      NetLroFlush(PNETLRO pLro, uint64_t tsDeadline);
+void     NetLroDiscard(PNETLRO pLro);
+uint64_t NetLroGetOldest(PNETLRO pLro);
+
+RT_C_DECLS_END
+
+#endif
+
@@ -25,6 +25,7 @@
 #include <iprt/stream.h>
 #include <iprt/time.h>
 #include <iprt/err.h>
+#include <iprt/string.h>
 #include <VBox/vmm/pdmnetinline.h>
 
 
@@ -62,6 +63,52 @@ struct pcaprec_hdr_init
 };
 
 
+/* pcapng Section Header Block, RFC draft "PCAP Next Generation Dump File Format". */
+#define PCAPNG_BT_SHB               UINT32_C(0x0a0d0d0a)
+#define PCAPNG_BT_IDB               UINT32_C(0x00000001)
+#define PCAPNG_BYTE_ORDER_MAGIC     UINT32_C(0x1a2b3c4d)
+#define PCAPNG_OPT_ENDOFOPT         0
+#define PCAPNG_OPT_COMMENT          1
+#define PCAPNG_OPT_IF_NAME          2
+#define PCAPNG_OPT_IF_TSRESOL       9
+#define PCAPNG_LINKTYPE_ETHERNET    1
+
+struct pcapng_shb
+{
+    uint32_t    block_type;     /* PCAPNG_BT_SHB */
+    uint32_t    block_total_length;
+    uint32_t    byte_order_magic;
+    uint16_t    major_version;  /* = 1 */
+    uint16_t    minor_version;  /* = 0 */
+    /* Split in two so the block doesn't get padded to 32 bytes. */
+    uint32_t    section_length_lo; /* = -1, unspecified */
+    uint32_t    section_length_hi;
+    uint32_t    block_total_length2;
+};
+
+struct pcapng_idb
+{
+    uint32_t    block_type;     /* PCAPNG_BT_IDB */
+    uint32_t    block_total_length;
+    uint16_t    linktype;
+    uint16_t    reserved;
+    uint32_t    snaplen;
+};
+
+struct pcapng_epb
+{
+    uint32_t    block_type;     /* PCAPNG_BT_EPB */
+    uint32_t    block_total_length;
+    uint32_t    interface_id;
+    uint32_t    timestamp_high;
+    uint32_t    timestamp_low;
+    uint32_t    captured_len;
+    uint32_t    packet_len;
+};
+AssertCompileSize(struct pcapng_epb, PCAPNG_EPB_HDR_SIZE);
+AssertCompileSize(struct pcapng_shb, 28);
+
+
 /*********************************************************************************************************************************
 *   Global Variables                                                                                                             *
 *********************************************************************************************************************************/
@@ -255,3 +302,113 @@ int PcapFileGsoFrame(RTFILE File, uint64_t StartNanoTS, PCPDMNETWORKGSO pGso,
     return VINF_SUCCESS;
 }
 
+
+/**
+ * Writes the pcapng section header and the (single) interface description.
+ *
+ * Timestamps are in nanoseconds since the UNIX epoch (if_tsresol=9).
+ *
+ * @returns IPRT status code, @see RTFileWrite.
+ *
+ * @param   File            The file handle.
+ * @param   cbSnapLen       The maximum number of bytes captured per packet.
+ * @param   pszIfName       The interface name to record, optional.
+ */
+int PcapNgFileHdr(RTFILE File, uint32_t cbSnapLen, const char *pszIfName)
+{
+    struct pcapng_shb Shb;
+    Shb.block_type          = PCAPNG_BT_SHB;
+    Shb.block_total_length  = sizeof(Shb);
+    Shb.byte_order_magic    = PCAPNG_BYTE_ORDER_MAGIC;
+    Shb.major_version       = 1;
+    Shb.minor_version       = 0;
+    Shb.section_length_lo   = UINT32_MAX;
+    Shb.section_length_hi   = UINT32_MAX;
+    Shb.block_total_length2 = sizeof(Shb);
+    int rc = RTFileWrite(File, &Shb, sizeof(Shb), NULL);
+    if (RT_FAILURE(rc))
+        return rc;
+
+    /* Interface description with if_name, if_tsresol and opt_endofopt options. */
+    uint8_t  abIdb[sizeof(struct pcapng_idb) + 4 + 256 + 4 + 4 + 4 + 4];
+    size_t   cchName = pszIfName ? RT_MIN(strlen(pszIfName), 255) : 0;
+    struct pcapng_idb *pIdb = (struct pcapng_idb *)&abIdb[0];
+    pIdb->block_type = PCAPNG_BT_IDB;
+    pIdb->linktype   = PCAPNG_LINKTYPE_ETHERNET;
+    pIdb->reserved   = 0;
+    pIdb->snaplen    = cbSnapLen;
+    uint32_t off = sizeof(*pIdb);
+    if (cchName)
+    {
+        *(uint16_t *)&abIdb[off]     = PCAPNG_OPT_IF_NAME;
+        *(uint16_t *)&abIdb[off + 2] = (uint16_t)cchName;
+        memset(&abIdb[off + 4], 0, RT_ALIGN_32(cchName, 4));
+        memcpy(&abIdb[off + 4], pszIfName, cchName);
+        off += 4 + RT_ALIGN_32((uint32_t)cchName, 4);
+    }
+    *(uint16_t *)&abIdb[off]     = PCAPNG_OPT_IF_TSRESOL;
+    *(uint16_t *)&abIdb[off + 2] = 1;
+    *(uint32_t *)&abIdb[off + 4] = 9; /* 10^-9 s, the remaining bytes are padding */
+    off += 8;
+    *(uint32_t *)&abIdb[off] = PCAPNG_OPT_ENDOFOPT;
+    off += 4;
+    pIdb->block_total_length = off + 4;
+    *(uint32_t *)&abIdb[off] = off + 4;
+    off += 4;
+    return RTFileWrite(File, abIdb, off, NULL);
+}
+
+
+/**
+ * Calculates the size of an Enhanced Packet Block.
+ *
+ * The result is always a multiple of 8 so that EPBs can be laid out back to
+ * back in a buffer with 64-bit aligned headers.
+ *
+ * @returns Size in bytes.
+ * @param   cbCaptured      The number of packet bytes stored in the block.
+ */
+uint32_t PcapNgCalcEpbSize(uint32_t cbCaptured)
+{
+    return RT_ALIGN_32(PCAPNG_EPB_HDR_SIZE + RT_ALIGN_32(cbCaptured, 4) + PCAPNG_EPB_TRAILER_SIZE, 8);
+}
+
+
+/**
+ * Fills in the header and trailer of an Enhanced Packet Block.
+ *
+ * The caller copies the packet data to PCAPNG_EPB_HDR_SIZE bytes into the
+ * block.  The block type is left zero so the caller can publish the block by
+ * writing PCAPNG_BT_EPB to it as the very last step.
+ *
+ * @param   pvBlock         The block, PcapNgCalcEpbSize(cbCaptured) bytes.
+ * @param   cbBlock         The block size as returned by PcapNgCalcEpbSize.
+ * @param   u64TimestampNs  The timestamp in nanoseconds since the epoch.
+ * @param   cbCaptured      The number of packet bytes stored in the block.
+ * @param   cbOrig          The original packet size.
+ */
+void PcapNgInitEpb(void *pvBlock, uint32_t cbBlock, uint64_t u64TimestampNs, uint32_t cbCaptured, uint32_t cbOrig)
+{
+    struct pcapng_epb *pEpb = (struct pcapng_epb *)pvBlock;
+    pEpb->block_type         = 0;
+    pEpb->block_total_length = cbBlock;
+    pEpb->interface_id       = 0;
+    pEpb->timestamp_high     = (uint32_t)(u64TimestampNs >> 32);
+    pEpb->timestamp_low      = (uint32_t)u64TimestampNs;
+    pEpb->captured_len       = cbCaptured;
+    pEpb->packet_len         = cbOrig;
+
+    /* Zero the data padding. */
+    uint8_t *pbBlock = (uint8_t *)pvBlock;
+    uint32_t offOpts = PCAPNG_EPB_HDR_SIZE + RT_ALIGN_32(cbCaptured, 4);
+    memset(&pbBlock[PCAPNG_EPB_HDR_SIZE + cbCaptured], 0, offOpts - PCAPNG_EPB_HDR_SIZE - cbCaptured);
+
+    /* The options: an empty opt_comment if we need to fill 8 bytes, then opt_endofopt. */
+    if (cbBlock - offOpts == PCAPNG_EPB_TRAILER_SIZE + 4)
+    {
+        *(uint32_t *)&pbBlock[offOpts] = PCAPNG_OPT_COMMENT;
+        offOpts += 4;
+    }
+    *(uint32_t *)&pbBlock[offOpts] = PCAPNG_OPT_ENDOFOPT;
+    *(uint32_t *)&pbBlock[cbBlock - 4] = cbBlock;
+}
@@ -33,6 +33,21 @@ int PcapFileFrame(RTFILE File, uint64_t StartNanoTS, const void *pvFrame, size_t
 int PcapFileGsoFrame(RTFILE File, uint64_t StartNanoTS, PCPDMNETWORKGSO pGso,
                      const void *pvFrame, size_t cbFrame, size_t cbSegMax);
 
+/** @name pcapng support (used by the asynchronous sniffer mode).
+ * @{ */
+/** pcapng Enhanced Packet Block type. */
+#define PCAPNG_BT_EPB               UINT32_C(0x00000006)
+/** Size of the fixed Enhanced Packet Block part preceding the packet data. */
+#define PCAPNG_EPB_HDR_SIZE         28
+/** Size of the Enhanced Packet Block part following the packet data
+ * (opt_endofopt and the trailing block length). */
+#define PCAPNG_EPB_TRAILER_SIZE     8
+
+int      PcapNgFileHdr(RTFILE File, uint32_t cbSnapLen, const char *pszIfName);
+uint32_t PcapNgCalcEpbSize(uint32_t cbCaptured);
+void     PcapNgInitEpb(void *pvBlock, uint32_t cbBlock, uint64_t u64TimestampNs, uint32_t cbCaptured, uint32_t cbOrig);
+/** @} */
+
 RT_C_DECLS_END
 
 #endif
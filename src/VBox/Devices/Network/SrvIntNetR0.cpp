@@ -65,6 +65,11 @@
 /** The wakeup bit in the INTNETIF::cBusy and INTNETRUNKIF::cBusy counters. */
 #define INTNET_BUSY_WAKEUP_MASK     RT_BIT_32(30)
 
+/** The number of hash chains in the MAC address lookup table (power of two). */
+#define INTNET_MACTAB_HASH_SIZE     256
+/** The MAC address lookup table chain terminator. */
+#define INTNET_MACTAB_NIL           UINT32_MAX
+
 
 /*********************************************************************************************************************************
 *   Structures and Typedefs                                                                                                      *
@@ -87,6 +92,12 @@ typedef struct INTNETMACTABENTRY
     bool                    fActive;
     /** Pointer to the network interface. */
     struct INTNETIF        *pIf;
+    /** The index of the next entry in the hash chain, INTNET_MACTAB_NIL if last.
+     * Entries with dummy MAC addresses are not hashed. */
+    uint32_t                iHashNext;
+    /** The index of the next entry on the special list (dummy MAC address or
+     * promiscuous), INTNET_MACTAB_NIL if last or not on the list. */
+    uint32_t                iSpecialNext;
 } INTNETMACTABENTRY;
 /** Pointer to a MAC address lookup table entry. */
 typedef INTNETMACTABENTRY *PINTNETMACTABENTRY;
@@ -132,6 +143,16 @@ typedef struct INTNETMACTAB
 
     /** Pointer to the trunk interface. */
     struct INTNETTRUNKIF   *pTrunk;
+
+    /** The index of the first entry on the special list, i.e. the entries with
+     * a dummy MAC address or in effective promiscuous mode, which have to be
+     * considered for every unicast frame.  INTNET_MACTAB_NIL if empty. */
+    uint32_t                iSpecialHead;
+    /** The MAC address hash chains, indexed by intnetR0MacTabHash().  Each
+     * holds the index of the first entry or INTNET_MACTAB_NIL.
+     * @remarks Rebuilt by intnetR0MacTabRehash() whenever entries are added,
+     *          removed or change their MAC address or promiscuous setting. */
+    uint32_t                aiHashHeads[INTNET_MACTAB_HASH_SIZE];
 } INTNETMACTAB;
 /** Pointer to a MAC address .  */
 typedef INTNETMACTAB *PINTNETMACTAB;
@@ -219,6 +240,11 @@ typedef struct INTNETIF
     bool                    fActive;
     /** Whether someone has indicated that the end is nigh by means of IntNetR0IfAbortWait. */
     bool volatile           fNoMoreWaits;
+    /** Set by IntNetR0IfWait when the receiver has drained the receive ring and
+     * is about to block.  Producers clear it when signalling hRecvEvent and skip
+     * the signal while it is clear, since the receiver is then still busy reading
+     * and will pick up the new frame without being woken up. */
+    bool volatile           fRecvArmed;
     /** The flags specified when opening this interface. */
     uint32_t                fOpenFlags;
     /** Number of yields done to try make the interface read pending data.
@@ -1655,6 +1681,66 @@ DECL_FORCE_INLINE(bool) intnetR0AreMacAddrsEqual(PCRTMAC pDstAddr1, PCRTMAC pDst
 }
 
 
+/**
+ * Calculates the MAC address lookup table hash chain index of a MAC address.
+ *
+ * @returns Index into INTNETMACTAB::aiHashHeads.
+ * @param   pMacAddr            The address.
+ */
+DECL_FORCE_INLINE(uint32_t) intnetR0MacTabHash(PCRTMAC pMacAddr)
+{
+    /* The OUI is usually the same for all interfaces, so the last three bytes
+       carries most of the entropy. */
+    uint32_t uHash = pMacAddr->au16[0] ^ pMacAddr->au16[1] ^ pMacAddr->au16[2];
+    uHash ^= uHash >> 8;
+    return uHash & (INTNET_MACTAB_HASH_SIZE - 1);
+}
+
+
+/**
+ * Rebuilds the hash chains and the special list of the MAC address lookup
+ * table.
+ *
+ * This is done whenever entries are added or removed, or when an entry changes
+ * its MAC address or promiscuous setting.  These are rare events compared to
+ * the frame switching, so we keep it simple and start over every time.
+ *
+ * @param   pTab                The MAC address table.
+ *
+ * @remarks Caller must own the network's address spinlock (or be creating /
+ *          destroying the network).
+ */
+static void intnetR0MacTabRehash(PINTNETMACTAB pTab)
+{
+    for (uint32_t i = 0; i < RT_ELEMENTS(pTab->aiHashHeads); i++)
+        pTab->aiHashHeads[i] = INTNET_MACTAB_NIL;
+    pTab->iSpecialHead = INTNET_MACTAB_NIL;
+
+    uint32_t iIfMac = pTab->cEntries;
+    while (iIfMac-- > 0)
+    {
+        PINTNETMACTABENTRY pEntry = &pTab->paEntries[iIfMac];
+        bool const         fDummy = intnetR0IsMacAddrDummy(&pEntry->MacAddr);
+        if (fDummy || pEntry->fPromiscuousEff)
+        {
+            pEntry->iSpecialNext = pTab->iSpecialHead;
+            pTab->iSpecialHead   = iIfMac;
+        }
+        else
+            pEntry->iSpecialNext = INTNET_MACTAB_NIL;
+
+        if (!fDummy)
+        {
+            uint32_t const iHash = intnetR0MacTabHash(&pEntry->MacAddr);
+            pEntry->iHashNext = pTab->aiHashHeads[iHash];
+            pTab->aiHashHeads[iHash] = iIfMac;
+        }
+        else
+            pEntry->iHashNext = INTNET_MACTAB_NIL;
+    }
+}
+
+
 /**
  * Switch a unicast frame based on the network layer address (OSI level 3) and
  * return a destination table.
@@ -1787,32 +1873,36 @@ static INTNETSWDECISION intnetR0NetworkPreSwitchUnicast(PINTNETNETWORK pNetwork,
     PINTNETMACTAB       pTab            = &pNetwork->MacTab;
     RTSpinlockAcquire(pNetwork->hAddrSpinlock);
 
-    /* Iterate the internal network interfaces and look for matching source and
-       destination addresses. */
-    uint32_t iIfMac = pTab->cEntries;
-    while (iIfMac-- > 0)
-    {
-        if (pTab->paEntries[iIfMac].fActive)
-        {
-            /* Unknown interface address? */
-            if (intnetR0IsMacAddrDummy(&pTab->paEntries[iIfMac].MacAddr))
-                break;
+    /* Unknown interface addresses means we cannot tell, so broadcast. */
+    uint32_t iIfMac;
+    for (iIfMac = pTab->iSpecialHead; iIfMac != INTNET_MACTAB_NIL; iIfMac = pTab->paEntries[iIfMac].iSpecialNext)
+        if (   pTab->paEntries[iIfMac].fActive
+            && intnetR0IsMacAddrDummy(&pTab->paEntries[iIfMac].MacAddr))
+            break;
 
-            /* Paranoia - this shouldn't happen, right? */
-            if (    pSrcAddr
-                &&  intnetR0AreMacAddrsEqual(&pTab->paEntries[iIfMac].MacAddr, pSrcAddr))
+    /* Paranoia - an internal interface matching the source shouldn't happen, right? */
+    if (   iIfMac == INTNET_MACTAB_NIL
+        && pSrcAddr)
+        for (iIfMac = pTab->aiHashHeads[intnetR0MacTabHash(pSrcAddr)];
+             iIfMac != INTNET_MACTAB_NIL;
+             iIfMac = pTab->paEntries[iIfMac].iHashNext)
+            if (   pTab->paEntries[iIfMac].fActive
+                && intnetR0AreMacAddrsEqual(&pTab->paEntries[iIfMac].MacAddr, pSrcAddr))
                 break;
 
-            /* Exact match? */
-            if (intnetR0AreMacAddrsEqual(&pTab->paEntries[iIfMac].MacAddr, pDstAddr))
+    /* Exact match? */
+    if (iIfMac == INTNET_MACTAB_NIL)
+        for (iIfMac = pTab->aiHashHeads[intnetR0MacTabHash(pDstAddr)];
+             iIfMac != INTNET_MACTAB_NIL;
+             iIfMac = pTab->paEntries[iIfMac].iHashNext)
+            if (   pTab->paEntries[iIfMac].fActive
+                && intnetR0AreMacAddrsEqual(&pTab->paEntries[iIfMac].MacAddr, pDstAddr))
             {
                 enmSwDecision = pTab->fHostPromiscuousEff && fSrc == INTNETTRUNKDIR_WIRE
                               ? INTNETSWDECISION_BROADCAST
                               : INTNETSWDECISION_INTNET;
                 break;
             }
-        }
-    }
 
     RTSpinlockRelease(pNetwork->hAddrSpinlock);
     return enmSwDecision;
@@ -1847,30 +1937,47 @@ static INTNETSWDECISION intnetR0NetworkSwitchUnicast(PINTNETNETWORK pNetwork, ui
     pDstTab->pTrunk     = 0;
     pDstTab->cIfs       = 0;
 
-    /* Find exactly matching or promiscuous interfaces. */
+    /* Find exactly matching interfaces by hash lookup. */
     uint32_t cExactHits = 0;
-    uint32_t iIfMac     = pTab->cEntries;
-    while (iIfMac-- > 0)
+    uint32_t iIfMac;
+    for (iIfMac = pTab->aiHashHeads[intnetR0MacTabHash(pDstAddr)];
+         iIfMac != INTNET_MACTAB_NIL;
+         iIfMac = pTab->paEntries[iIfMac].iHashNext)
     {
-        if (pTab->paEntries[iIfMac].fActive)
+        if (   pTab->paEntries[iIfMac].fActive
+            && intnetR0AreMacAddrsEqual(&pTab->paEntries[iIfMac].MacAddr, pDstAddr))
         {
-            bool fExact = intnetR0AreMacAddrsEqual(&pTab->paEntries[iIfMac].MacAddr, pDstAddr);
-            if (   fExact
-                || intnetR0IsMacAddrDummy(&pTab->paEntries[iIfMac].MacAddr)
-                || (   pTab->paEntries[iIfMac].fPromiscuousSeeTrunk
-                    || (!fSrc && pTab->paEntries[iIfMac].fPromiscuousEff) )
-               )
+            cExactHits++;
+
+            PINTNETIF pIf = pTab->paEntries[iIfMac].pIf;            AssertPtr(pIf); Assert(pIf->pNetwork == pNetwork);
+            if (RT_LIKELY(pIf != pIfSender)) /* paranoia */
             {
-                cExactHits += fExact;
+                uint32_t iIfDst = pDstTab->cIfs++;
+                pDstTab->aIfs[iIfDst].pIf            = pIf;
+                pDstTab->aIfs[iIfDst].fReplaceDstMac = false;
+                intnetR0BusyIncIf(pIf);
+            }
+        }
+    }
 
-                PINTNETIF pIf = pTab->paEntries[iIfMac].pIf;        AssertPtr(pIf); Assert(pIf->pNetwork == pNetwork);
-                if (RT_LIKELY(pIf != pIfSender)) /* paranoia */
-                {
-                    uint32_t iIfDst = pDstTab->cIfs++;
-                    pDstTab->aIfs[iIfDst].pIf            = pIf;
-                    pDstTab->aIfs[iIfDst].fReplaceDstMac = false;
-                    intnetR0BusyIncIf(pIf);
-                }
+    /* Add the interfaces with unknown addresses and the promiscuous ones
+       from the special list (skipping exact matches added above). */
+    for (iIfMac = pTab->iSpecialHead; iIfMac != INTNET_MACTAB_NIL; iIfMac = pTab->paEntries[iIfMac].iSpecialNext)
+    {
+        if (   pTab->paEntries[iIfMac].fActive
+            && !intnetR0AreMacAddrsEqual(&pTab->paEntries[iIfMac].MacAddr, pDstAddr)
+            && (   intnetR0IsMacAddrDummy(&pTab->paEntries[iIfMac].MacAddr)
+                || pTab->paEntries[iIfMac].fPromiscuousSeeTrunk
+                || (!fSrc && pTab->paEntries[iIfMac].fPromiscuousEff) )
+           )
+        {
+            PINTNETIF pIf = pTab->paEntries[iIfMac].pIf;            AssertPtr(pIf); Assert(pIf->pNetwork == pNetwork);
+            if (RT_LIKELY(pIf != pIfSender)) /* paranoia */
+            {
+                uint32_t iIfDst = pDstTab->cIfs++;
+                pDstTab->aIfs[iIfDst].pIf            = pIf;
+                pDstTab->aIfs[iIfDst].fReplaceDstMac = false;
+                intnetR0BusyIncIf(pIf);
             }
         }
     }
@@ -1880,8 +1987,7 @@ static INTNETSWDECISION intnetR0NetworkSwitchUnicast(PINTNETNETWORK pNetwork, ui
         && fSrc
         && pNetwork->MacTab.cPromiscuousNoTrunkEntries)
     {
-        iIfMac = pTab->cEntries;
-        while (iIfMac-- > 0)
+        for (iIfMac = pTab->iSpecialHead; iIfMac != INTNET_MACTAB_NIL; iIfMac = pTab->paEntries[iIfMac].iSpecialNext)
         {
             if (   pTab->paEntries[iIfMac].fPromiscuousEff
                 && !pTab->paEntries[iIfMac].fPromiscuousSeeTrunk
@@ -2816,6 +2922,30 @@ static int intnetR0RingWriteFrame(PINTNETRINGBUF pRingBuf, PCINTNETSG pSG, PCRTM
 }
 
 
+/**
+ * Wakes up the receiver of an interface after a frame was committed to its
+ * receive ring, coalescing wakeups while the receiver is busy.
+ *
+ * The receiver arms itself in IntNetR0IfWait before it re-checks the ring and
+ * blocks, so if it isn't armed it is still draining the ring and is bound to
+ * see the frame we just committed.  This avoids a signalled event semaphore
+ * bouncing the receiver through a pointless ring-3/ring-0 round trip for each
+ * frame in a burst.
+ *
+ * @param   pIf             The interface.
+ */
+DECLINLINE(void) intnetR0IfSignalRecv(PINTNETIF pIf)
+{
+    if (ASMAtomicXchgBool(&pIf->fRecvArmed, false))
+    {
+        STAM_REL_COUNTER_INC(&pIf->pIntBuf->cStatRecvWakeups);
+        RTSemEventSignal(pIf->hRecvEvent);
+    }
+    else
+        STAM_REL_COUNTER_INC(&pIf->pIntBuf->cStatRecvWakeupsCoalesced);
+}
+
+
 /**
  * Sends a frame to a specific interface.
  *
@@ -2835,7 +2965,7 @@ static void intnetR0IfSend(PINTNETIF pIf, PINTNETIF pIfSender, PINTNETSG pSG, PC
     if (RT_SUCCESS(rc))
     {
         pIf->cYields = 0;
-        RTSemEventSignal(pIf->hRecvEvent);
+        intnetR0IfSignalRecv(pIf);
         return;
     }
 
@@ -3971,7 +4101,10 @@ static INTNETSWDECISION intnetR0NetworkSend(PINTNETNETWORK pNetwork, PINTNETIF p
 
         PINTNETMACTABENTRY pIfEntry = intnetR0NetworkFindMacAddrEntry(pNetwork, pIfSender);
         if (pIfEntry)
+        {
             pIfEntry->MacAddr = EthHdr.SrcMac;
+            intnetR0MacTabRehash(&pNetwork->MacTab);
+        }
         pIfSender->MacAddr    = EthHdr.SrcMac;
 
         RTSpinlockRelease(pNetwork->hAddrSpinlock);
@@ -4342,6 +4475,8 @@ INTNETR0DECL(int) IntNetR0IfSetPromiscuousMode(INTNETIFHANDLE hIf, PSUPDRVSESSIO
                 }
                 Assert(pNetwork->MacTab.cPromiscuousEntries        <= pNetwork->MacTab.cEntries);
                 Assert(pNetwork->MacTab.cPromiscuousNoTrunkEntries <= pNetwork->MacTab.cEntries);
+
+                intnetR0MacTabRehash(&pNetwork->MacTab);
             }
         }
 
@@ -4419,7 +4554,10 @@ INTNETR0DECL(int) IntNetR0IfSetMacAddress(INTNETIFHANDLE hIf, PSUPDRVSESSION pSe
             /* Update the two copies. */
             PINTNETMACTABENTRY pEntry = intnetR0NetworkFindMacAddrEntry(pNetwork, pIf); Assert(pEntry);
             if (RT_LIKELY(pEntry))
+            {
                 pEntry->MacAddr = *pMac;
+                intnetR0MacTabRehash(&pNetwork->MacTab);
+            }
             pIf->MacAddr        = *pMac;
             pIf->fMacSet        = true;
 
@@ -4667,11 +4805,20 @@ INTNETR0DECL(int) IntNetR0IfWait(INTNETIFHANDLE hIf, PSUPDRVSESSION pSession, ui
         && hRecvEvent != NIL_RTSEMEVENT)
     {
         /*
-         * It is tempting to check if there is data to be read here,
-         * but the problem with such an approach is that it will cause
-         * one unnecessary supervisor->user->supervisor trip. There is
-         * already a slight risk for such, so no need to increase it.
+         * Arm the receive wakeup before checking for data, so a producer
+         * committing a frame after our check will signal us (see
+         * intnetR0IfSignalRecv).  Producers skip the signal while we're
+         * disarmed, so we must not block if something arrived in the meantime.
          */
+        ASMAtomicWriteBool(&pIf->fRecvArmed, true);
+        PINTNETBUF pIntBuf = pIf->pIntBuf;
+        if (pIntBuf && IntNetRingHasMoreToRead(&pIntBuf->Recv))
+        {
+            ASMAtomicWriteBool(&pIf->fRecvArmed, false);
+            intnetR0IfRelease(pIf, pSession);
+            Log4(("IntNetR0IfWait: returns VINF_SUCCESS (pending data)\n"));
+            return VINF_SUCCESS;
+        }
 
         /*
          * Increment the number of waiters before starting the wait.
@@ -4944,6 +5091,7 @@ static DECLCALLBACK(void) intnetR0IfDestruct(void *pvObj, void *pvUser1, void *p
                             &pNetwork->MacTab.paEntries[iIf + 1],
                             (pNetwork->MacTab.cEntries - iIf - 1) * sizeof(pNetwork->MacTab.paEntries[0]));
                 pNetwork->MacTab.cEntries--;
+                intnetR0MacTabRehash(&pNetwork->MacTab);
                 break;
             }
 
@@ -5110,6 +5258,7 @@ static int intnetR0NetworkCreateIf(PINTNETNETWORK pNetwork, PSUPDRVSESSION pSess
     //pIf->fPromiscuousReal = false;
     //pIf->fActive          = false;
     //pIf->fNoMoreWaits     = false;
+    pIf->fRecvArmed         = true;
     pIf->fOpenFlags         = fFlags;
     //pIf->cYields          = 0;
     //pIf->pIntBuf          = 0;
@@ -5182,6 +5331,7 @@ static int intnetR0NetworkCreateIf(PINTNETNETWORK pNetwork, PSUPDRVSESSION pSess
                     pNetwork->MacTab.paEntries[iIf].pIf                  = pIf;
 
                     pNetwork->MacTab.cEntries = iIf + 1;
+                    intnetR0MacTabRehash(&pNetwork->MacTab);
                     pIf->pNetwork = pNetwork;
 
                     /*
@@ -5970,6 +6120,10 @@ static DECLCALLBACK(void) intnetR0NetworkDestruct(void *pvObj, void *pvUser1, vo
         }
     }
 
+    /* The orphaned entries are all inactive, so the hash chains were safe to
+       traverse while we were at it, but let's not leave them dangling. */
+    intnetR0MacTabRehash(&pNetwork->MacTab);
+
     /*
      * Zap the trunk pointer while we still own the spinlock, destroy the
      * trunk after we've left it.  Note that this might take a while...
@@ -6168,6 +6322,8 @@ static int intnetR0AdaptOpenNetworkFlags(PINTNETNETWORK pNetwork, uint32_t fFlag
                     }
                 }
             }
+
+            intnetR0MacTabRehash(&pNetwork->MacTab);
         }
 
         RTSpinlockRelease(pNetwork->hAddrSpinlock);
@@ -6388,7 +6544,9 @@ static int intnetR0CreateNetwork(PINTNET pIntNet, PSUPDRVSESSION pSession, const
     if (RT_SUCCESS(rc))
     {
         pNetwork->MacTab.paEntries = (PINTNETMACTABENTRY)RTMemAlloc(sizeof(INTNETMACTABENTRY) * pNetwork->MacTab.cEntriesAllocated);
-        if (!pNetwork->MacTab.paEntries)
+        if (pNetwork->MacTab.paEntries)
+            intnetR0MacTabRehash(&pNetwork->MacTab);
+        else
             rc = VERR_NO_MEMORY;
     }
     if (RT_SUCCESS(rc))
@@ -206,12 +206,17 @@ in_pseudo(u_int32_t a, u_int32_t b, u_int32_t c)
 u_short
 in_cksum_skip(struct mbuf *m, int len, int skip)
 {
+#ifndef VBOX
 	u_int64_t sum = 0;
-	int mlen = 0;
 	int clen = 0;
-	caddr_t addr;
 	union q_util q_util;
 	union l_util l_util;
+#else
+	uint32_t sum = 0;
+	bool fOdd = false;
+#endif
+	int mlen = 0;
+	caddr_t addr;
 
         len -= skip;
         for (; skip && m; m = m->m_next) {
@@ -232,16 +237,26 @@ in_cksum_skip(struct mbuf *m, int len, int skip)
 skip_start:
 		if (len < mlen)
 			mlen = len;
+#ifndef VBOX
 		if ((clen ^ (long) addr) & 1)
 		    sum += in_cksumdata((const u_int32_t *)addr, mlen) << 8;
 		else
 		    sum += in_cksumdata((const u_int32_t *)addr, mlen);
 
 		clen += mlen;
+#else
+		/* IPRT carries odd lengths over to the next chunk and uses
+		   the widest summing loop the host offers. */
+		sum = RTNetIPv4AddDataChecksum(addr, mlen, sum, &fOdd);
+#endif
 		len -= mlen;
 	}
+#ifndef VBOX
 	REDUCE16;
 	return (~sum & 0xffff);
+#else
+	return RTNetIPv4FinalizeChecksum(sum);
+#endif
 }
 
 u_int in_cksum_hdr(const struct ip *ip)
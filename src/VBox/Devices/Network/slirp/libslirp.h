@@ -177,6 +177,15 @@ unsigned int slirp_get_timeout_ms(PNATState pData);
 int slirp_get_nsock(PNATState pData);
 # endif
 
+# ifdef RT_OS_LINUX
+/*
+ * Waits for events on the sockets filled in by slirp_select_fill using a
+ * persistent epoll set. polls[0] is the caller's wakeup descriptor and
+ * polls[1..nfds] the slirp entries; returns like poll().
+ */
+int slirp_select_wait(PNATState pData, struct pollfd *polls, int nfds, int cMillies);
+# endif
+
 #ifdef VBOX_WITH_DNSMAPPING_IN_HOSTRESOLVER
 void slirp_add_host_resolver_mapping(PNATState pData,
                                      const char *pszHostName, bool fPattern,
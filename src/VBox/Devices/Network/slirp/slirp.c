@@ -55,6 +55,9 @@
 # include <sys/ioctl.h>
 # include <poll.h>
 # include <netinet/in.h>
+# ifdef RT_OS_LINUX
+#  include <sys/epoll.h>
+# endif
 #else
 # include <Winnls.h>
 # define _WINSOCK2API_
@@ -316,6 +319,13 @@ int slirp_init(PNATState *ppData, uint32_t u32NetAddr, uint32_t u32Netmask,
     pData->fUseHostResolverPermanent = fUseHostResolver;
     pData->pvUser = pvUser;
     pData->netmask = u32Netmask;
+#ifdef RT_OS_LINUX
+    pData->iEpollWakeupFd = -1;
+    pData->icmp_socket.so_epoll_fd = -1;
+    pData->iEpollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (pData->iEpollFd == -1)
+        LogRel(("NAT: epoll_create1 failed (%s), falling back to poll\n", strerror(errno)));
+#endif
 
     rc = RTCritSectRwInit(&pData->CsRwHandlerChain);
     if (RT_FAILURE(rc))
@@ -581,6 +591,13 @@ void slirp_term(PNATState pData)
     Log(("\n"
          "\n"
          "\n"));
+#endif
+#ifdef RT_OS_LINUX
+    if (pData->iEpollFd != -1)
+    {
+        close(pData->iEpollFd);
+        pData->iEpollFd = -1;
+    }
 #endif
     RTCritSectRwDelete(&pData->CsRwHandlerChain);
     RTMemFree(pData);
@@ -1655,6 +1672,153 @@ int slirp_get_nsock(PNATState pData)
 }
 #endif
 
+#ifdef RT_OS_LINUX
+/**
+ * Drops the epoll registration of a socket which is about to be freed.
+ *
+ * Closing the descriptor removes it from the set as well, so this only
+ * matters when the descriptor is still open.
+ */
+void slirp_epoll_forget(PNATState pData, struct socket *so)
+{
+    if (so->so_epoll_fd == -1)
+        return;
+    if (so->so_epoll_fd == so->s && pData->iEpollFd != -1)
+        epoll_ctl(pData->iEpollFd, EPOLL_CTL_DEL, so->so_epoll_fd, NULL);
+    so->so_epoll_fd = -1;
+    so->so_epoll_events = 0;
+}
+
+/**
+ * Brings the epoll registration of a socket in line with the interest
+ * slirp_select_fill expressed in the poll array, issuing a system call only
+ * when the descriptor or the event mask changed since the last round.
+ *
+ * The registration is kept for as long as the descriptor lives, interest
+ * changes are a single EPOLL_CTL_MOD and slirp_epoll_forget drops it.
+ */
+static void slirpEpollSync(PNATState pData, struct socket *so, struct pollfd *polls, int nfds)
+{
+    struct epoll_event Ev;
+    uint32_t fEvents = 0;
+    int rc;
+
+    if (   so->s != -1
+        && so->so_poll_index >= 0
+        && so->so_poll_index < nfds
+        && polls[so->so_poll_index].fd == so->s)
+        fEvents = (uint16_t)polls[so->so_poll_index].events;
+
+    if (so->so_epoll_fd == so->s && so->so_epoll_events == fEvents)
+        return;
+
+    /*
+     * A descriptor which is no longer ours was closed and thus left the set
+     * already, its number might be in use by another socket by now.
+     */
+    if (so->so_epoll_fd != -1 && so->so_epoll_fd != so->s)
+    {
+        so->so_epoll_fd = -1;
+        so->so_epoll_events = 0;
+    }
+    if (so->so_epoll_fd == -1 && !fEvents)
+        return; /* nothing registered and nothing wanted */
+
+    /*
+     * POLLIN/POLLOUT/POLLPRI match their EPOLL* counterparts.  POLLERR and
+     * POLLHUP are always reported, so a registered socket without interest is
+     * made edge triggered to keep a pending hangup from waking us up over and
+     * over again.
+     */
+    RT_ZERO(Ev);
+    Ev.events = fEvents ? fEvents : EPOLLET;
+    Ev.data.ptr = so;
+    if (so->so_epoll_fd == so->s)
+    {
+        rc = epoll_ctl(pData->iEpollFd, EPOLL_CTL_MOD, so->s, &Ev);
+        if (rc == -1 && errno == ENOENT) /* closed and reopened under the same number */
+            rc = epoll_ctl(pData->iEpollFd, EPOLL_CTL_ADD, so->s, &Ev);
+    }
+    else
+    {
+        rc = epoll_ctl(pData->iEpollFd, EPOLL_CTL_ADD, so->s, &Ev);
+        if (rc == -1 && errno == EEXIST)
+            rc = epoll_ctl(pData->iEpollFd, EPOLL_CTL_MOD, so->s, &Ev);
+    }
+    if (rc == 0)
+    {
+        so->so_epoll_fd = so->s;
+        so->so_epoll_events = fEvents;
+    }
+    else
+    {
+        Log2(("NAT: epoll_ctl failed for %R[natsock] (%s)\n", so, strerror(errno)));
+        so->so_epoll_fd = -1;
+        so->so_epoll_events = 0;
+    }
+}
+
+int slirp_select_wait(PNATState pData, struct pollfd *polls, int nfds, int cMillies)
+{
+    struct epoll_event aEvents[128];
+    struct socket *so, *so_next;
+    int cEvents;
+    int i;
+
+    if (pData->iEpollFd == -1)
+        return poll(polls, nfds + 1, cMillies);
+
+    /* the wakeup descriptor is registered once, it's identified by a NULL pointer */
+    if (polls[0].fd != pData->iEpollWakeupFd)
+    {
+        struct epoll_event Ev;
+        RT_ZERO(Ev);
+        Ev.events = polls[0].events;
+        Ev.data.ptr = NULL;
+        if (pData->iEpollWakeupFd != -1)
+            epoll_ctl(pData->iEpollFd, EPOLL_CTL_DEL, pData->iEpollWakeupFd, NULL);
+        if (epoll_ctl(pData->iEpollFd, EPOLL_CTL_ADD, polls[0].fd, &Ev) != 0)
+        {
+            LogRel(("NAT: failed to add the wakeup descriptor to the epoll set (%s), falling back to poll\n",
+                    strerror(errno)));
+            close(pData->iEpollFd);
+            pData->iEpollFd = -1;
+            return poll(polls, nfds + 1, cMillies);
+        }
+        pData->iEpollWakeupFd = polls[0].fd;
+    }
+
+    /* polls[] is passed to slirp_select_fill without the wakeup entry */
+    slirpEpollSync(pData, &pData->icmp_socket, &polls[1], nfds);
+    QSOCKET_FOREACH(so, so_next, tcp)
+    /* { */
+        slirpEpollSync(pData, so, &polls[1], nfds);
+        LOOP_LABEL(tcp, so, so_next);
+    }
+    QSOCKET_FOREACH(so, so_next, udp)
+    /* { */
+        slirpEpollSync(pData, so, &polls[1], nfds);
+        LOOP_LABEL(udp, so, so_next);
+    }
+
+    for (i = 0; i <= nfds; i++)
+        polls[i].revents = 0;
+
+    cEvents = epoll_wait(pData->iEpollFd, aEvents, RT_ELEMENTS(aEvents), cMillies);
+    for (i = 0; i < cEvents; i++)
+    {
+        so = (struct socket *)aEvents[i].data.ptr;
+        if (so == NULL)
+            polls[0].revents = (short)aEvents[i].events;
+        else if (   so->so_poll_index >= 0
+                 && so->so_poll_index < nfds
+                 && polls[so->so_poll_index + 1].fd == so->s)
+            polls[so->so_poll_index + 1].revents = (short)aEvents[i].events;
+    }
+    return cEvents;
+}
+#endif /* RT_OS_LINUX */
+
 /*
  * this function called from NAT thread
  */
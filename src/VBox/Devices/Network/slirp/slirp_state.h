@@ -194,6 +194,13 @@ typedef struct NATState
 #  define NSOCK_DEC() do {} while (0)
 #  define NSOCK_INC_EX(ex) do {} while (0)
 #  define NSOCK_DEC_EX(ex) do {} while (0)
+# endif
+# ifdef RT_OS_LINUX
+    /** Persistent epoll set mirroring the interest computed by
+     * slirp_select_fill, -1 if epoll isn't available (plain poll is used). */
+    int iEpollFd;
+    /** The caller's wakeup descriptor currently registered in iEpollFd. */
+    int iEpollWakeupFd;
 # endif
 
     struct socket icmp_socket;
@@ -173,6 +173,9 @@ socreate(void)
         so->s = -1;
 #if !defined(RT_OS_WINDOWS)
         so->so_poll_index = -1;
+#endif
+#ifdef RT_OS_LINUX
+        so->so_epoll_fd = -1;
 #endif
     }
     return so;
@@ -220,6 +223,11 @@ sofree(PNATState pData, struct socket *so)
         so->so_ohdr = NULL;
     }
 
+#ifdef RT_OS_LINUX
+    /* the descriptor may outlive the socket structure, don't leave it behind in the epoll set */
+    slirp_epoll_forget(pData, so);
+#endif
+
     if (so->so_next && so->so_prev)
     {
         remque(pData, so);  /* crashes if so is not in a queue */
@@ -89,6 +89,10 @@ struct socket
 #ifndef RT_OS_WINDOWS
     int so_poll_index;
 #endif /* !RT_OS_WINDOWS */
+#ifdef RT_OS_LINUX
+    int so_epoll_fd;           /* descriptor registered in the epoll set, -1 if none */
+    uint32_t so_epoll_events;  /* event mask it is registered with */
+#endif
     /*
      * FD_CLOSE/POLLHUP event has been occurred on socket
      */
@@ -170,6 +174,9 @@ void so_init (void);
 struct socket * solookup (struct socket *, struct in_addr, u_int, struct in_addr, u_int);
 struct socket * socreate (void);
 void sofree (PNATState, struct socket *);
+#ifdef RT_OS_LINUX
+void slirp_epoll_forget (PNATState, struct socket *);
+#endif
 int soread (PNATState, struct socket *);
 void sorecvoob (PNATState, struct socket *);
 int sosendoob (struct socket *);
@@ -0,0 +1,299 @@
+/* $Id$ */
+/** @file
+ * Large receive offload (LRO) - Testcase for the TCP segment coalescer.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include "../NetLro.h"
+
+#include <VBox/vmm/pdmnetinline.h>
+#include <iprt/err.h>
+#include <iprt/initterm.h>
+#include <iprt/mem.h>
+#include <iprt/net.h>
+#include <iprt/string.h>
+#include <iprt/test.h>
+
+
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** The segment payload size used by the tests. */
+#define TST_MSS         1000
+/** Maximum number of frames recorded per step. */
+#define TST_MAX_FRAMES  8
+
+
+/*********************************************************************************************************************************
+*   Structures and Typedefs                                                                                                      *
+*********************************************************************************************************************************/
+/** A frame handed to the delivery callback. */
+typedef struct TSTFRAME
+{
+    uint8_t        *pbFrame;
+    size_t          cbFrame;
+    bool            fGso;
+    PDMNETWORKGSO   Gso;
+} TSTFRAME;
+
+
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
+static RTTEST       g_hTest;
+/** Frames delivered since the last tstReset. */
+static TSTFRAME     g_aFrames[TST_MAX_FRAMES];
+/** Number of entries in g_aFrames. */
+static uint32_t     g_cFrames;
+
+
+/**
+ * @callback_method_impl{FNNETLRODELIVER}
+ */
+static DECLCALLBACK(int) tstDeliver(void *pvUser, const void *pvFrame, size_t cbFrame, PCPDMNETWORKGSO pGso)
+{
+    RT_NOREF(pvUser);
+    RTTESTI_CHECK_RET(g_cFrames < TST_MAX_FRAMES, VERR_BUFFER_OVERFLOW);
+    TSTFRAME *pFrame = &g_aFrames[g_cFrames++];
+    pFrame->pbFrame = (uint8_t *)RTMemDup(pvFrame, cbFrame);
+    pFrame->cbFrame = cbFrame;
+    pFrame->fGso    = pGso != NULL;
+    if (pGso)
+        pFrame->Gso = *pGso;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Forgets the delivered frames.
+ */
+static void tstReset(void)
+{
+    for (uint32_t i = 0; i < g_cFrames; i++)
+        RTMemFree(g_aFrames[i].pbFrame);
+    g_cFrames = 0;
+}
+
+
+/**
+ * Builds a TCP segment with correct checksums, the payload continues a byte
+ * pattern derived from the sequence number.
+ *
+ * @returns The frame size.
+ */
+static size_t tstMakeSegment(uint8_t *pbFrame, bool fIpv6, uint32_t uSeq, uint32_t cbPayload, uint8_t fFlags)
+{
+    static uint8_t const s_abMacs[12] = { 0x02, 0, 0, 0, 0, 0x01,  0x02, 0, 0, 0, 0, 0x02 };
+    memset(pbFrame, 0, sizeof(RTNETETHERHDR) + sizeof(RTNETIPV6) + RTNETTCP_MIN_LEN);
+    memcpy(pbFrame, s_abMacs, sizeof(s_abMacs));
+
+    uint32_t const offTcp = sizeof(RTNETETHERHDR) + (fIpv6 ? sizeof(RTNETIPV6) : RTNETIPV4_MIN_LEN);
+    PRTNETTCP      pTcp   = (PRTNETTCP)&pbFrame[offTcp];
+    uint8_t       *pbData = &pbFrame[offTcp + RTNETTCP_MIN_LEN];
+    pTcp->th_sport = RT_H2N_U16_C(1234);
+    pTcp->th_dport = RT_H2N_U16_C(80);
+    pTcp->th_seq   = RT_H2N_U32(uSeq);
+    pTcp->th_ack   = RT_H2N_U32_C(1);
+    pTcp->th_off   = RTNETTCP_MIN_LEN / 4;
+    pTcp->th_flags = fFlags;
+    pTcp->th_win   = RT_H2N_U16_C(8192);
+    for (uint32_t i = 0; i < cbPayload; i++)
+        pbData[i] = (uint8_t)(uSeq + i);
+
+    if (!fIpv6)
+    {
+        pbFrame[12] = 0x08;
+        pbFrame[13] = 0x00;
+        PRTNETIPV4 pIp = (PRTNETIPV4)&pbFrame[sizeof(RTNETETHERHDR)];
+        pIp->ip_v          = 4;
+        pIp->ip_hl         = RTNETIPV4_MIN_LEN / 4;
+        pIp->ip_len        = RT_H2N_U16((uint16_t)(RTNETIPV4_MIN_LEN + RTNETTCP_MIN_LEN + cbPayload));
+        pIp->ip_off        = RT_H2N_U16_C(0x4000); /* DF */
+        pIp->ip_ttl        = 64;
+        pIp->ip_p          = RTNETIPV4_PROT_TCP;
+        pIp->ip_src.u      = RT_H2N_U32_C(0x0a000001);
+        pIp->ip_dst.u      = RT_H2N_U32_C(0x0a000002);
+        pIp->ip_sum        = RTNetIPv4HdrChecksum(pIp);
+        pTcp->th_sum       = RTNetIPv4TCPChecksum(pIp, pTcp, NULL);
+    }
+    else
+    {
+        pbFrame[12] = 0x86;
+        pbFrame[13] = 0xdd;
+        PRTNETIPV6 pIp6 = (PRTNETIPV6)&pbFrame[sizeof(RTNETETHERHDR)];
+        pIp6->ip6_vfc      = RT_H2N_U32_C(0x60000000);
+        pIp6->ip6_plen     = RT_H2N_U16((uint16_t)(RTNETTCP_MIN_LEN + cbPayload));
+        pIp6->ip6_nxt      = RTNETIPV4_PROT_TCP;
+        pIp6->ip6_hlim     = 64;
+        pIp6->ip6_src.au8[0]  = 0xfe;
+        pIp6->ip6_src.au8[1]  = 0x80;
+        pIp6->ip6_src.au8[15] = 1;
+        pIp6->ip6_dst.au8[0]  = 0xfe;
+        pIp6->ip6_dst.au8[1]  = 0x80;
+        pIp6->ip6_dst.au8[15] = 2;
+        pTcp->th_sum       = RTNetTCPChecksum(RTNetIPv6PseudoChecksum(pIp6), pTcp, pbData, cbPayload);
+    }
+    return offTcp + RTNETTCP_MIN_LEN + cbPayload;
+}
+
+
+/**
+ * Checks that a delivered frame carries the stream bytes [uSeq, uSeq + cbPayload)
+ * and, for IPv4, a correct IP length and header checksum.
+ */
+static void tstCheckFrame(TSTFRAME const *pFrame, bool fIpv6, uint32_t uSeq, uint32_t cbPayload)
+{
+    uint32_t const cbHdrs = sizeof(RTNETETHERHDR) + (fIpv6 ? sizeof(RTNETIPV6) : RTNETIPV4_MIN_LEN) + RTNETTCP_MIN_LEN;
+    RTTESTI_CHECK_RETV(pFrame->cbFrame == cbHdrs + cbPayload);
+    PCRTNETTCP pTcp = (PCRTNETTCP)&pFrame->pbFrame[cbHdrs - RTNETTCP_MIN_LEN];
+    RTTESTI_CHECK(RT_N2H_U32(pTcp->th_seq) == uSeq);
+    for (uint32_t i = 0; i < cbPayload; i++)
+        if (pFrame->pbFrame[cbHdrs + i] != (uint8_t)(uSeq + i))
+        {
+            RTTestIFailed("Payload mismatch at offset %u\n", i);
+            break;
+        }
+    if (!fIpv6)
+    {
+        PCRTNETIPV4 pIp = (PCRTNETIPV4)&pFrame->pbFrame[sizeof(RTNETETHERHDR)];
+        RTTESTI_CHECK(RT_N2H_U16(pIp->ip_len) == cbHdrs - sizeof(RTNETETHERHDR) + cbPayload);
+        RTTESTI_CHECK(RTNetIPv4IsHdrValid(pIp, RTNETIPV4_MIN_LEN, pFrame->cbFrame - sizeof(RTNETETHERHDR), true /*fChecksum*/));
+    }
+    else
+    {
+        PCRTNETIPV6 pIp6 = (PCRTNETIPV6)&pFrame->pbFrame[sizeof(RTNETETHERHDR)];
+        RTTESTI_CHECK(RT_N2H_U16(pIp6->ip6_plen) == RTNETTCP_MIN_LEN + cbPayload);
+    }
+}
+
+
+/**
+ * In-order segments are merged into one GSO frame, which is delivered once a
+ * pushed segment ends the burst.
+ */
+static void tstMerge(PNETLRO pLro, bool fIpv6, uint32_t fGsoTypes)
+{
+    RTTestISubF("Merging, %s", fIpv6 ? "IPv6" : "IPv4");
+    static uint8_t s_abFrame[2048];
+    uint32_t const uSeq0 = 1000;
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        size_t cbFrame = tstMakeSegment(s_abFrame, fIpv6, uSeq0 + i * TST_MSS, TST_MSS,
+                                        RTNETTCP_F_ACK | (i == 3 ? RTNETTCP_F_PSH : 0));
+        RTTESTI_CHECK_RC(NetLroReceive(pLro, s_abFrame, cbFrame, fGsoTypes, i), VINF_SUCCESS);
+        RTTESTI_CHECK(g_cFrames == (i == 3 ? 1U : 0U));
+    }
+    if (g_cFrames == 1)
+    {
+        RTTESTI_CHECK(g_aFrames[0].fGso);
+        RTTESTI_CHECK(g_aFrames[0].Gso.u8Type == (fIpv6 ? PDMNETWORKGSOTYPE_IPV6_TCP : PDMNETWORKGSOTYPE_IPV4_TCP));
+        RTTESTI_CHECK(g_aFrames[0].Gso.cbMaxSeg == TST_MSS);
+        tstCheckFrame(&g_aFrames[0], fIpv6, uSeq0, 4 * TST_MSS);
+    }
+    RTTESTI_CHECK(NetLroGetOldest(pLro) == UINT64_MAX);
+    tstReset();
+}
+
+
+/**
+ * A segment with a bad checksum ends the flow and is passed on untouched.
+ *
+ * @param   offCorrupt  Offset of the byte to corrupt in the third segment.
+ */
+static void tstBadChecksum(PNETLRO pLro, bool fIpv6, uint32_t fGsoTypes, uint32_t offCorrupt, const char *pszWhat)
+{
+    RTTestISubF("Bad %s checksum, %s", pszWhat, fIpv6 ? "IPv6" : "IPv4");
+    static uint8_t s_abFrame[2048];
+    uint64_t const cBadBefore = pLro->StatSegsBadCsum.c;
+    uint32_t const uSeq0      = 50000;
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        size_t cbFrame = tstMakeSegment(s_abFrame, fIpv6, uSeq0 + i * TST_MSS, TST_MSS, RTNETTCP_F_ACK);
+        RTTESTI_CHECK_RC(NetLroReceive(pLro, s_abFrame, cbFrame, fGsoTypes, i), VINF_SUCCESS);
+    }
+    RTTESTI_CHECK(g_cFrames == 0);
+
+    size_t cbFrame = tstMakeSegment(s_abFrame, fIpv6, uSeq0 + 2 * TST_MSS, TST_MSS, RTNETTCP_F_ACK);
+    s_abFrame[offCorrupt] ^= 0x40;
+    RTTESTI_CHECK_RC(NetLroReceive(pLro, s_abFrame, cbFrame, fGsoTypes, 2), VINF_SUCCESS);
+    RTTESTI_CHECK(pLro->StatSegsBadCsum.c == cBadBefore + 1);
+    RTTESTI_CHECK_RETV(g_cFrames == 2);
+
+    /* The two good segments, merged, followed by the bad one as it came in. */
+    RTTESTI_CHECK(g_aFrames[0].fGso);
+    tstCheckFrame(&g_aFrames[0], fIpv6, uSeq0, 2 * TST_MSS);
+    RTTESTI_CHECK(!g_aFrames[1].fGso);
+    RTTESTI_CHECK(g_aFrames[1].cbFrame == cbFrame && !memcmp(g_aFrames[1].pbFrame, s_abFrame, cbFrame));
+    RTTESTI_CHECK(NetLroGetOldest(pLro) == UINT64_MAX);
+    tstReset();
+}
+
+
+/**
+ * Held flows are delivered by NetLroFlush according to their age.
+ */
+static void tstFlush(PNETLRO pLro, uint32_t fGsoTypes)
+{
+    RTTestISub("Flush");
+    static uint8_t s_abFrame[2048];
+    size_t cbFrame = tstMakeSegment(s_abFrame, false /*fIpv6*/, 7000, TST_MSS, RTNETTCP_F_ACK);
+    RTTESTI_CHECK_RC(NetLroReceive(pLro, s_abFrame, cbFrame, fGsoTypes, 100), VINF_SUCCESS);
+    cbFrame = tstMakeSegment(s_abFrame, true /*fIpv6*/, 9000, TST_MSS, RTNETTCP_F_ACK);
+    RTTESTI_CHECK_RC(NetLroReceive(pLro, s_abFrame, cbFrame, fGsoTypes, 200), VINF_SUCCESS);
+    RTTESTI_CHECK(g_cFrames == 0);
+    RTTESTI_CHECK(NetLroGetOldest(pLro) == 100);
+
+    RTTESTI_CHECK_RC(NetLroFlush(pLro, 150), VINF_SUCCESS);
+    RTTESTI_CHECK_RETV(g_cFrames == 1);
+    RTTESTI_CHECK(!g_aFrames[0].fGso);
+    tstCheckFrame(&g_aFrames[0], false /*fIpv6*/, 7000, TST_MSS);
+    RTTESTI_CHECK(NetLroGetOldest(pLro) == 200);
+
+    RTTESTI_CHECK_RC(NetLroFlush(pLro, UINT64_MAX), VINF_SUCCESS);
+    RTTESTI_CHECK_RETV(g_cFrames == 2);
+    tstCheckFrame(&g_aFrames[1], true /*fIpv6*/, 9000, TST_MSS);
+    RTTESTI_CHECK(NetLroGetOldest(pLro) == UINT64_MAX);
+    tstReset();
+}
+
+
+int main()
+{
+    RTEXITCODE rcExit = RTTestInitAndCreate("tstNetLro", &g_hTest);
+    if (rcExit != RTEXITCODE_SUCCESS)
+        return rcExit;
+    RTTestBanner(g_hTest);
+
+    PNETLRO pLro;
+    int rc = NetLroCreate(4, tstDeliver, NULL, &pLro);
+    if (RT_FAILURE(rc))
+        return RTTestSkipAndDestroy(g_hTest, "NetLroCreate failed: %Rrc", rc);
+    uint32_t const fGsoTypes = RT_BIT_32(PDMNETWORKGSOTYPE_IPV4_TCP) | RT_BIT_32(PDMNETWORKGSOTYPE_IPV6_TCP);
+    uint32_t const offTcp4   = sizeof(RTNETETHERHDR) + RTNETIPV4_MIN_LEN;
+    uint32_t const offTcp6   = sizeof(RTNETETHERHDR) + sizeof(RTNETIPV6);
+
+    tstMerge(pLro, false /*fIpv6*/, fGsoTypes);
+    tstMerge(pLro, true  /*fIpv6*/, fGsoTypes);
+    tstBadChecksum(pLro, false /*fIpv6*/, fGsoTypes, sizeof(RTNETETHERHDR) + 4 /*ip_id*/, "IP header");
+    tstBadChecksum(pLro, false /*fIpv6*/, fGsoTypes, offTcp4 + RTNETTCP_MIN_LEN + 10, "TCP");
+    tstBadChecksum(pLro, true  /*fIpv6*/, fGsoTypes, offTcp6 + RTNETTCP_MIN_LEN + 10, "TCP");
+    tstFlush(pLro, fGsoTypes);
+
+    NetLroDestroy(pLro);
+    return RTTestSummaryAndDestroy(g_hTest);
+}
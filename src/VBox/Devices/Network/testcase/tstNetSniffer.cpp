@@ -0,0 +1,351 @@
+/* $Id$ */
+/** @file
+ * Network sniffer - Testcase for the asynchronous capture ring.
+ *
+ * This includes the driver source so the ring can be exercised without a VM.
+ */
+
+/*
+ * Copyright (C) 2006-2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include <iprt/asm.h>
+#include <iprt/file.h>
+#include <iprt/initterm.h>
+#include <iprt/mem.h>
+#include <iprt/path.h>
+#include <iprt/string.h>
+#include <iprt/test.h>
+#include <iprt/thread.h>
+
+
+/*********************************************************************************************************************************
+*   Driver Source                                                                                                                *
+*********************************************************************************************************************************/
+/* Ugly but necessary. */
+#undef LOG_GROUP
+#include "../DrvNetSniffer.cpp"
+
+
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** Number of producer threads. */
+#define TST_PRODUCERS           4
+/** Number of frames each producer queues. */
+#define TST_FRAMES_PER_PRODUCER 20000
+
+
+/*********************************************************************************************************************************
+*   Structures and Typedefs                                                                                                      *
+*********************************************************************************************************************************/
+/** Producer thread arguments. */
+typedef struct TSTPRODUCER
+{
+    PDRVNETSNIFFER      pThis;
+    uint32_t            iProducer;
+} TSTPRODUCER;
+
+
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
+static RTTEST           g_hTest;
+/** Fake driver instance, only iInstance is used. */
+static PDMDRVINS        g_DrvIns;
+/** Tells the writer thread to finish up. */
+static bool volatile    g_fWriterStop;
+
+
+/**
+ * Sets up an asynchronous capture instance writing to @a pszFile.
+ */
+static int tstInit(PDRVNETSNIFFER pThis, uint32_t cbRing, const char *pszFile)
+{
+    RT_ZERO(*pThis);
+    pThis->pDrvIns     = &g_DrvIns;
+    pThis->hFile       = NIL_RTFILE;
+    pThis->hEvtWriter  = NIL_RTSEMEVENT;
+    pThis->cbSnapLen   = 0xffff;
+    pThis->fAsync      = true;
+    pThis->cbRing      = cbRing;
+    pThis->pbRing      = (uint8_t *)RTMemPageAllocZ(cbRing);
+    if (!pThis->pbRing)
+        return VERR_NO_MEMORY;
+    RTStrCopy(pThis->szFilename, sizeof(pThis->szFilename), pszFile);
+    int rc = RTSemEventCreate(&pThis->hEvtWriter);
+    if (RT_SUCCESS(rc))
+        rc = drvNetSnifferOpenFile(pThis);
+    return rc;
+}
+
+
+/**
+ * Cleans up after tstInit.
+ */
+static void tstTerm(PDRVNETSNIFFER pThis)
+{
+    if (pThis->hFile != NIL_RTFILE)
+        RTFileClose(pThis->hFile);
+    pThis->hFile = NIL_RTFILE;
+    RTSemEventDestroy(pThis->hEvtWriter);
+    pThis->hEvtWriter = NIL_RTSEMEVENT;
+    RTMemPageFree(pThis->pbRing, pThis->cbRing);
+    pThis->pbRing = NULL;
+}
+
+
+/**
+ * Queues frames of varying size, each tagged with the producer and sequence number.
+ */
+static DECLCALLBACK(int) tstProducerThread(RTTHREAD hThreadSelf, void *pvUser)
+{
+    RT_NOREF(hThreadSelf);
+    TSTPRODUCER *pArgs = (TSTPRODUCER *)pvUser;
+    uint8_t      abFrame[1514];
+    for (uint32_t iFrame = 0; iFrame < TST_FRAMES_PER_PRODUCER; iFrame++)
+    {
+        uint32_t const cbFrame = 60 + (iFrame * 37 + pArgs->iProducer * 101) % (sizeof(abFrame) - 60);
+        memset(abFrame, (uint8_t)(iFrame + pArgs->iProducer), cbFrame);
+        ((uint32_t *)abFrame)[0] = pArgs->iProducer;
+        ((uint32_t *)abFrame)[1] = iFrame;
+        drvNetSnifferRingPut(pArgs->pThis, abFrame, 16, &abFrame[16], cbFrame - 16, cbFrame);
+        if (!(iFrame % 64))
+            RTThreadYield(); /* Give the writer a chance, we want some drops but not only drops. */
+    }
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Drains the ring the same way the PDM writer thread does.
+ */
+static DECLCALLBACK(int) tstWriterThread(RTTHREAD hThreadSelf, void *pvUser)
+{
+    RT_NOREF(hThreadSelf);
+    PDRVNETSNIFFER pThis = (PDRVNETSNIFFER)pvUser;
+    while (!ASMAtomicReadBool(&g_fWriterStop))
+    {
+        drvNetSnifferRingDrain(pThis);
+        drvNetSnifferRingWait(pThis);
+    }
+    drvNetSnifferRingDrain(pThis);
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Parses the capture file and checks every packet in it.
+ *
+ * @returns Number of packets found.
+ */
+static uint64_t tstVerifyFile(const char *pszFile)
+{
+    void  *pvFile;
+    size_t cbFile;
+    int rc = RTFileReadAll(pszFile, &pvFile, &cbFile);
+    if (RT_FAILURE(rc))
+    {
+        RTTestFailed(g_hTest, "RTFileReadAll -> %Rrc\n", rc);
+        return 0;
+    }
+
+    uint8_t const *pbFile = (uint8_t const *)pvFile;
+    uint32_t       aiNext[TST_PRODUCERS] = { 0 };
+    uint64_t       cPackets = 0;
+    size_t         off      = 0;
+    while (off + 12 <= cbFile)
+    {
+        uint32_t const *pu32    = (uint32_t const *)&pbFile[off];
+        uint32_t const  cbBlock = pu32[1];
+        if (cbBlock < 12 || (cbBlock & 3) || cbBlock > cbFile - off)
+        {
+            RTTestFailed(g_hTest, "Bad block length %#x at %#zx\n", cbBlock, off);
+            break;
+        }
+        if (*(uint32_t const *)&pbFile[off + cbBlock - 4] != cbBlock)
+        {
+            RTTestFailed(g_hTest, "Block at %#zx: trailing length mismatch\n", off);
+            break;
+        }
+        if (pu32[0] == PCAPNG_BT_EPB)
+        {
+            uint32_t const  cbCaptured = pu32[5];
+            uint8_t const  *pbData     = &pbFile[off + PCAPNG_EPB_HDR_SIZE];
+            uint32_t const  iProducer  = ((uint32_t const *)pbData)[0];
+            uint32_t const  iFrame     = ((uint32_t const *)pbData)[1];
+            if (   cbBlock != PcapNgCalcEpbSize(cbCaptured)
+                || cbCaptured != pu32[6]
+                || iProducer >= TST_PRODUCERS
+                || iFrame < aiNext[iProducer]
+                || !ASMMemIsAllU8(&pbData[8], cbCaptured - 8, (uint8_t)(iFrame + iProducer)))
+            {
+                RTTestFailed(g_hTest, "Bad packet at %#zx: cb=%#x/%#x producer=%u frame=%u\n",
+                             off, cbCaptured, pu32[6], iProducer, iFrame);
+                break;
+            }
+            aiNext[iProducer] = iFrame + 1;
+            cPackets++;
+        }
+        off += cbBlock;
+    }
+    RTTEST_CHECK(g_hTest, off == cbFile);
+    RTFileReadAllFree(pvFile, cbFile);
+    return cPackets;
+}
+
+
+/**
+ * Several producers racing a writer through a ring much smaller than the
+ * amount of data, so the ring wraps, pads and overflows.
+ */
+static void tstConcurrent(const char *pszFile)
+{
+    RTTestSub(g_hTest, "Concurrent producers");
+
+    DRVNETSNIFFER This;
+    RTTESTI_CHECK_RC_OK_RETV(tstInit(&This, DRVNETSNIFFER_RING_SIZE_MIN, pszFile));
+
+    g_fWriterStop = false;
+    RTTHREAD hWriter;
+    RTTESTI_CHECK_RC_OK_RETV(RTThreadCreate(&hWriter, tstWriterThread, &This, 0,
+                                            RTTHREADTYPE_IO, RTTHREADFLAGS_WAITABLE, "Writer"));
+
+    TSTPRODUCER aArgs[TST_PRODUCERS];
+    RTTHREAD    ahProducers[TST_PRODUCERS];
+    for (uint32_t i = 0; i < TST_PRODUCERS; i++)
+    {
+        aArgs[i].pThis     = &This;
+        aArgs[i].iProducer = i;
+        RTTESTI_CHECK_RC_OK(RTThreadCreateF(&ahProducers[i], tstProducerThread, &aArgs[i], 0,
+                                            RTTHREADTYPE_DEFAULT, RTTHREADFLAGS_WAITABLE, "Producer%u", i));
+    }
+    for (uint32_t i = 0; i < TST_PRODUCERS; i++)
+        RTTESTI_CHECK_RC_OK(RTThreadWait(ahProducers[i], RT_MS_1MIN, NULL));
+
+    ASMAtomicWriteBool(&g_fWriterStop, true);
+    RTSemEventSignal(This.hEvtWriter);
+    RTTESTI_CHECK_RC_OK(RTThreadWait(hWriter, RT_MS_1MIN, NULL));
+
+    RTTESTI_CHECK(!This.fRingCorrupt);
+    RTTESTI_CHECK(This.offRingHead == This.offRingTail);
+    RTTESTI_CHECK(ASMMemIsZero(This.pbRing, This.cbRing));
+    RTTESTI_CHECK(This.StatCaptured.c + This.StatDropped.c == TST_PRODUCERS * TST_FRAMES_PER_PRODUCER);
+    RTTESTI_CHECK(This.StatWriteErrors.c == 0);
+    RTFileClose(This.hFile);
+    This.hFile = NIL_RTFILE;
+
+    uint64_t cPackets = tstVerifyFile(pszFile);
+    if (cPackets != This.StatCaptured.c)
+        RTTestFailed(g_hTest, "%RU64 packets in the file, %RU64 captured\n", cPackets, This.StatCaptured.c);
+    RTTestPrintf(g_hTest, RTTESTLVL_ALWAYS, "captured=%RU64 dropped=%RU64\n", This.StatCaptured.c, This.StatDropped.c);
+    tstTerm(&This);
+}
+
+
+/**
+ * Published blocks with impossible lengths must stop capturing, not make the
+ * writer loop or touch memory outside the ring.
+ */
+static void tstBadLength(const char *pszFile)
+{
+    RTTestSub(g_hTest, "Invalid block lengths");
+
+    static uint32_t const s_acbBad[] = { 0, 4, 46, _64K + 8, UINT32_MAX & ~7 };
+    for (uint32_t i = 0; i < RT_ELEMENTS(s_acbBad); i++)
+    {
+        DRVNETSNIFFER This;
+        RTTESTI_CHECK_RC_OK_RETV(tstInit(&This, _64K, pszFile));
+        uint64_t cbFileBefore = 0;
+        RTFileGetSize(This.hFile, &cbFileBefore);
+
+        /* A valid block followed by a bogus one. */
+        uint8_t abFrame[64];
+        memset(abFrame, 0xa5, sizeof(abFrame));
+        drvNetSnifferRingPut(&This, abFrame, sizeof(abFrame), NULL, 0, sizeof(abFrame));
+        uint32_t const offBad = (uint32_t)This.offRingHead;
+        ((uint32_t *)&This.pbRing[offBad])[1] = s_acbBad[i];
+        ASMAtomicWriteU32((uint32_t volatile *)&This.pbRing[offBad], PCAPNG_BT_EPB);
+        This.offRingHead += PcapNgCalcEpbSize(0);
+
+        drvNetSnifferRingDrain(&This);
+        RTTESTI_CHECK(This.fRingCorrupt);
+        RTTESTI_CHECK(This.offRingTail == offBad);
+
+        uint64_t cbFileAfter = 0;
+        RTFileGetSize(This.hFile, &cbFileAfter);
+        RTTESTI_CHECK(cbFileAfter == cbFileBefore + PcapNgCalcEpbSize(sizeof(abFrame)));
+
+        /* Further frames are dropped and counted. */
+        drvNetSnifferRingPut(&This, abFrame, sizeof(abFrame), NULL, 0, sizeof(abFrame));
+        RTTESTI_CHECK(This.StatDropped.c == 1);
+        tstTerm(&This);
+    }
+}
+
+
+/**
+ * Incomplete GSO frames cannot be segmented and are counted as dropped.
+ */
+static void tstGsoDrop(const char *pszFile)
+{
+    RTTestSub(g_hTest, "Incomplete GSO frames");
+
+    DRVNETSNIFFER This;
+    RTTESTI_CHECK_RC_OK_RETV(tstInit(&This, _64K, pszFile));
+
+    PDMNETWORKGSO Gso;
+    RT_ZERO(Gso);
+    Gso.u8Type      = PDMNETWORKGSOTYPE_IPV4_TCP;
+    Gso.cbHdrsTotal = 54;
+    Gso.cbHdrsSeg   = 54;
+    Gso.cbMaxSeg    = 1460;
+    Gso.offHdr1     = 14;
+    Gso.offHdr2     = 34;
+    uint8_t abFrame[128];
+    RT_ZERO(abFrame);
+    drvNetSnifferCapture(&This, &Gso, abFrame, 4000, sizeof(abFrame));
+
+    RTTESTI_CHECK(This.StatDropped.c == 1);
+    RTTESTI_CHECK(This.StatDroppedBytes.c == 4000);
+    RTTESTI_CHECK(This.StatCaptured.c == 0);
+    RTTESTI_CHECK(This.offRingHead == 0);
+    tstTerm(&This);
+}
+
+
+int main()
+{
+    RTEXITCODE rcExit = RTTestInitAndCreate("tstNetSniffer", &g_hTest);
+    if (rcExit != RTEXITCODE_SUCCESS)
+        return rcExit;
+    RTTestBanner(g_hTest);
+
+    char szFile[RTPATH_MAX];
+    int rc = RTPathTemp(szFile, sizeof(szFile));
+    if (RT_SUCCESS(rc))
+        rc = RTPathAppend(szFile, sizeof(szFile), "tstNetSniffer-XXXXXX.pcapng");
+    if (RT_SUCCESS(rc))
+        rc = RTFileCreateTemp(szFile, 0600);
+    if (RT_FAILURE(rc))
+        return RTTestSkipAndDestroy(g_hTest, "Failed to create temporary file: %Rrc", rc);
+
+    tstConcurrent(szFile);
+    tstBadLength(szFile);
+    tstGsoDrop(szFile);
+
+    RTFileDelete(szFile);
+    return RTTestSummaryAndDestroy(g_hTest);
+}
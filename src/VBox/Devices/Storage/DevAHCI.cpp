@@ -6009,6 +6009,15 @@ static DECLCALLBACK(int) ahciR3Construct(PPDMDEVINS pDevIns, int iInstance, PCFG
     pThis->pNotifierQueueR0 = PDMQueueR0Ptr(pThis->pNotifierQueueR3);
     pThis->pNotifierQueueRC = PDMQueueRCPtr(pThis->pNotifierQueueR3);
 
+    /*
+     * The consumer only kicks the port I/O thread, which is safe from any
+     * thread, so let a dedicated thread service the queue.  This way a doorbell
+     * write in R0 doesn't have to wait for the EMT to get back to ring-3.
+     */
+    rc = PDMDevHlpQueueEnableConsumerThread(pDevIns, pThis->pNotifierQueueR3, 1 /*cMaxBatch*/, RTTHREADTYPE_IO, "AHCI-Ntfy");
+    if (RT_FAILURE(rc))
+        return PDMDEV_SET_ERROR(pDevIns, rc, N_("AHCI: Failed to create the notification queue consumer thread"));
+
     /* Initialize static members on every port. */
     for (i = 0; i < AHCI_MAX_NR_PORTS_IMPL; i++)
         ahciPortHwReset(&pThis->ahciPort[i]);
@@ -1474,6 +1474,13 @@ int main()
     GEN_CHECK_OFF(E1KSTATE, u32SavedCsum);
     GEN_CHECK_OFF(E1KSTATE, eeprom);
     GEN_CHECK_OFF(E1KSTATE, phy);
+    GEN_CHECK_OFF(E1KSTATE, RxRing1);
+    GEN_CHECK_OFF(E1KSTATE, TxRing1);
+    GEN_CHECK_OFF(E1KSTATE, auEITR);
+    GEN_CHECK_OFF(E1KSTATE, auRETA);
+    GEN_CHECK_OFF(E1KSTATE, auRSSRK);
+    GEN_CHECK_OFF(E1KSTATE, offMsixCap);
+    GEN_CHECK_OFF(E1KSTATE, au64VectorFiredAt);
     GEN_CHECK_OFF(E1KSTATE, StatReceiveBytes);
 #endif /* VBOX_WITH_E1000 */
 
@@ -8982,8 +8982,26 @@ HRESULT Console::i_attachToTapInterface(INetworkAdapter *networkAdapter)
             /* If we are using a static TAP device then try to open it. */
             Utf8Str str(tapDeviceName);
             RTStrCopy(IfReq.ifr_name, sizeof(IfReq.ifr_name), str.c_str()); /** @todo bitch about names which are too long... */
-            IfReq.ifr_flags = IFF_TAP | IFF_NO_PI;
-            rcVBox = ioctl(RTFileToNative(maTapFD[slot]), TUNSETIFF, &IfReq);
+            /*
+             * Ask for virtio-net headers (offloading) and multiple queues, falling
+             * back on the plain setup for persistent devices created without
+             * multi-queue support and for older kernels.  DrvTAP checks what we got.
+             */
+            static short const s_afFlags[] =
+            {
+# ifdef IFF_MULTI_QUEUE
+                IFF_TAP | IFF_NO_PI | IFF_VNET_HDR | IFF_MULTI_QUEUE,
+# endif
+                IFF_TAP | IFF_NO_PI | IFF_VNET_HDR,
+                IFF_TAP | IFF_NO_PI
+            };
+            for (size_t i = 0; i < RT_ELEMENTS(s_afFlags); i++)
+            {
+                IfReq.ifr_flags = s_afFlags[i];
+                rcVBox = ioctl(RTFileToNative(maTapFD[slot]), TUNSETIFF, &IfReq);
+                if (rcVBox == 0)
+                    break;
+            }
             if (rcVBox != 0)
             {
                 LogRel(("Failed to open the host network interface %ls\n", tapDeviceName.raw()));
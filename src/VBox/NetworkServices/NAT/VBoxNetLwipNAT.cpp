@@ -95,6 +95,7 @@ extern "C"
 #include "netif/etharp.h"
 
 #include "proxy.h"
+#include "proxy_pollmgr.h"
 #include "pxremap.h"
 #include "portfwd.h"
 }
@@ -657,6 +658,7 @@ VBoxNetLwipNAT::VBoxNetLwipNAT(SOCKET icmpsock4, SOCKET icmpsock6) : VBoxNetBase
     m_src6.sin6_len = sizeof(m_src6);
 #endif
     m_ProxyOptions.nameservers = NULL;
+    m_ProxyOptions.pollmgr_threads = 0;
 
     m_LwipNetIf.name[0] = 'N';
     m_LwipNetIf.name[1] = 'T';
@@ -891,6 +893,27 @@ int VBoxNetLwipNAT::init()
     }
 
 
+    /*
+     * Number of threads polling host sockets of proxied connections.
+     */
+    com::Bstr bstrPollThreads;
+    com::Bstr bstrPollThreadsKey = com::BstrFmt("NAT/%s/PollThreads", networkName.c_str());
+    hrc = virtualbox->GetExtraData(bstrPollThreadsKey.raw(), bstrPollThreads.asOutParam());
+    if (SUCCEEDED(hrc) && bstrPollThreads.isNotEmpty())
+    {
+        uint32_t cThreads;
+        rc = RTStrToUInt32Full(com::Utf8Str(bstrPollThreads).c_str(), 10, &cThreads);
+        if (rc == VINF_SUCCESS && cThreads <= POLLMGR_MAX_SHARDS)
+        {
+            m_ProxyOptions.pollmgr_threads = (int)cThreads;
+            LogRel(("Will use %u poll manager threads\n", cThreads));
+        }
+        else
+            LogRel(("Failed to parse \"%s\" poll manager thread count\n",
+                    com::Utf8Str(bstrPollThreads).c_str()));
+    }
+
+
     if (!fDontLoadRulesOnStartup)
     {
         fetchNatPortForwardRules(m_net, false, m_vecPortForwardRule4);
@@ -55,7 +55,6 @@ static FNRTSTRFORMATTYPE proxy_sockerr_rtstrfmt;
 static SOCKET proxy_create_socket(int, int);
 
 volatile struct proxy_options *g_proxy_options;
-static sys_thread_t pollmgr_tid;
 
 /* XXX: for mapping loopbacks to addresses in our network (ip4) */
 struct netif *g_proxy_netif;
@@ -70,6 +69,7 @@ void
 proxy_init(struct netif *proxy_netif, struct proxy_options *opts)
 {
     int status;
+    int i;
 
     LWIP_ASSERT1(opts != NULL);
     LWIP_UNUSED_ARG(proxy_netif);
@@ -97,7 +97,7 @@ proxy_init(struct netif *proxy_netif, struct proxy_options *opts)
         tftpd_init(proxy_netif, opts->tftp_root);
     }
 
-    status = pollmgr_init();
+    status = pollmgr_init(opts->pollmgr_threads);
     if (status < 0) {
         errx(EXIT_FAILURE, "failed to initialize poll manager");
         /* NOTREACHED */
@@ -112,13 +112,17 @@ proxy_init(struct netif *proxy_netif, struct proxy_options *opts)
 
     pxping_init(proxy_netif, opts->icmpsock4, opts->icmpsock6);
 
-    pollmgr_tid = sys_thread_new("pollmgr_thread",
-                                 pollmgr_thread, NULL,
-                                 DEFAULT_THREAD_STACKSIZE,
-                                 DEFAULT_THREAD_PRIO);
-    if (!pollmgr_tid) {
-        errx(EXIT_FAILURE, "failed to create poll manager thread");
-        /* NOTREACHED */
+    for (i = 0; i < pollmgr_shard_count(); ++i) {
+        sys_thread_t pollmgr_tid;
+
+        pollmgr_tid = sys_thread_new("pollmgr_thread",
+                                     pollmgr_thread, (void *)(intptr_t)i,
+                                     DEFAULT_THREAD_STACKSIZE,
+                                     DEFAULT_THREAD_PRIO);
+        if (!pollmgr_tid) {
+            errx(EXIT_FAILURE, "failed to create poll manager thread");
+            /* NOTREACHED */
+        }
     }
 }
 
@@ -22,6 +22,10 @@
 #include "proxy_pollmgr.h"
 #include "proxy.h"
 
+#include <iprt/err.h>
+#include <iprt/mp.h>
+#include <iprt/thread.h>
+
 #ifndef RT_OS_WINDOWS
 #include <sys/socket.h>
 #include <netinet/in.h>
@@ -42,22 +46,41 @@
 
 #define POLLMGR_GARBAGE (-1)
 
+/*
+ * Host sockets of proxied connections are spread over several poll
+ * manager threads ("shards"), each with its own pollfd array and its
+ * own set of channels.  Shard 0 also owns everything that is not a
+ * per-connection proxy (port-forwarding, dns, ping), so with a single
+ * shard we behave exactly as before.
+ */
 struct pollmgr {
     struct pollfd *fds;
     struct pollmgr_handler **handlers;
     nfds_t capacity;            /* allocated size of the arrays */
     nfds_t nfds;                /* part of the arrays in use */
+    int shard;                  /* index of this shard */
 
     /* channels (socketpair) for static slots */
     SOCKET chan[POLLMGR_SLOT_STATIC_COUNT][2];
 #define POLLMGR_CHFD_RD 0       /* - pollmgr side */
 #define POLLMGR_CHFD_WR 1       /* - client side */
-} pollmgr;
 
+    /* see pollmgr_udpbuf */
+    struct pollmgr_rxbuf udpbuf;
+};
+
+static struct pollmgr pollmgr[POLLMGR_MAX_SHARDS];
+static int pollmgr_nshards;
+
+/* shard of the current poll manager thread */
+static RTTLS pollmgr_tls = NIL_RTTLS;
 
-static void pollmgr_loop(void);
 
-static void pollmgr_add_at(int, struct pollmgr_handler *, SOCKET, int);
+static int pollmgr_init_shard(struct pollmgr *, int);
+static struct pollmgr *pollmgr_self(void);
+static void pollmgr_loop(struct pollmgr *);
+
+static void pollmgr_add_at(struct pollmgr *, int, struct pollmgr_handler *, SOCKET, int);
 static void pollmgr_refptr_delete(struct pollmgr_refptr *);
 
 
@@ -69,14 +92,76 @@ static void pollmgr_refptr_delete(struct pollmgr_refptr *);
  * of data, since typical UDP datagrams are small enough to avoid
  * fragmentation.
  *
- * We can use shared buffer here since we read from sockets
- * sequentially in a loop over pollfd.
+ * We can use per-shard buffer here since each poll manager thread
+ * reads from its sockets sequentially in a loop over pollfd.
  */
-u8_t pollmgr_udpbuf[64 * 1024];
+struct pollmgr_rxbuf *
+pollmgr_udpbuf_get(void)
+{
+    return &pollmgr_self()->udpbuf;
+}
 
 
+/**
+ * Initialize poll manager with the specified number of shards (poll
+ * manager threads).  Zero selects the number based on the host CPU
+ * count.
+ */
 int
-pollmgr_init(void)
+pollmgr_init(int nshards)
+{
+    int status;
+    int i;
+
+    if (nshards <= 0) {
+        nshards = (int)(RTMpGetOnlineCount() / 2);
+    }
+    if (nshards < 1) {
+        nshards = 1;
+    }
+    else if (nshards > POLLMGR_MAX_SHARDS) {
+        nshards = POLLMGR_MAX_SHARDS;
+    }
+
+    status = RTTlsAllocEx(&pollmgr_tls, NULL);
+    if (RT_FAILURE(status)) {
+        DPRINTF(("%s: Failed to allocate TLS: %Rrc\n", __func__, status));
+        return -1;
+    }
+
+    for (i = 0; i < nshards; ++i) {
+        status = pollmgr_init_shard(&pollmgr[i], i);
+        if (status < 0) {
+            break;
+        }
+    }
+
+    if (i == 0) {
+        return -1;
+    }
+    if (i < nshards) {
+        /* run with the shards we've got */
+        DPRINTF(("%s: using %d poll manager threads instead of %d\n",
+                 __func__, i, nshards));
+    }
+
+    pollmgr_nshards = i;
+    return 0;
+}
+
+
+/**
+ * Number of poll manager threads to start.
+ */
+int
+pollmgr_shard_count(void)
+{
+    return pollmgr_nshards;
+}
+
+
+static int
+pollmgr_init_shard(struct pollmgr *pm, int shard)
 {
     struct pollfd *newfds;
     struct pollmgr_handler **newhdls;
@@ -84,25 +169,26 @@ pollmgr_init(void)
     int status;
     nfds_t i;
 
-    pollmgr.fds = NULL;
-    pollmgr.handlers = NULL;
-    pollmgr.capacity = 0;
-    pollmgr.nfds = 0;
+    pm->fds = NULL;
+    pm->handlers = NULL;
+    pm->capacity = 0;
+    pm->nfds = 0;
+    pm->shard = shard;
 
     for (i = 0; i < POLLMGR_SLOT_STATIC_COUNT; ++i) {
-        pollmgr.chan[i][POLLMGR_CHFD_RD] = INVALID_SOCKET;
-        pollmgr.chan[i][POLLMGR_CHFD_WR] = INVALID_SOCKET;
+        pm->chan[i][POLLMGR_CHFD_RD] = INVALID_SOCKET;
+        pm->chan[i][POLLMGR_CHFD_WR] = INVALID_SOCKET;
     }
 
     for (i = 0; i < POLLMGR_SLOT_STATIC_COUNT; ++i) {
 #ifndef RT_OS_WINDOWS
-        status = socketpair(PF_LOCAL, SOCK_DGRAM, 0, pollmgr.chan[i]);
+        status = socketpair(PF_LOCAL, SOCK_DGRAM, 0, pm->chan[i]);
         if (status < 0) {
             DPRINTF(("socketpair: %R[sockerr]\n", SOCKERRNO()));
             goto cleanup_close;
         }
 #else
-        status = RTWinSocketPair(PF_INET, SOCK_DGRAM, 0, pollmgr.chan[i]);
+        status = RTWinSocketPair(PF_INET, SOCK_DGRAM, 0, pm->chan[i]);
         if (RT_FAILURE(status)) {
             goto cleanup_close;
         }
@@ -114,37 +200,38 @@ pollmgr_init(void)
     LWIP_ASSERT1(newcap >= POLLMGR_SLOT_STATIC_COUNT);
 
     newfds = (struct pollfd *)
-        malloc(newcap * sizeof(*pollmgr.fds));
+        malloc(newcap * sizeof(*pm->fds));
     if (newfds == NULL) {
         DPRINTF(("%s: Failed to allocate fds array\n", __func__));
         goto cleanup_close;
     }
 
     newhdls = (struct pollmgr_handler **)
-        malloc(newcap * sizeof(*pollmgr.handlers));
+        malloc(newcap * sizeof(*pm->handlers));
     if (newhdls == NULL) {
         DPRINTF(("%s: Failed to allocate handlers array\n", __func__));
         free(newfds);
         goto cleanup_close;
     }
 
-    pollmgr.capacity = newcap;
-    pollmgr.fds = newfds;
-    pollmgr.handlers = newhdls;
+    pm->capacity = newcap;
+    pm->fds = newfds;
+    pm->handlers = newhdls;
 
-    pollmgr.nfds = POLLMGR_SLOT_STATIC_COUNT;
+    pm->nfds = POLLMGR_SLOT_STATIC_COUNT;
 
-    for (i = 0; i < pollmgr.capacity; ++i) {
-        pollmgr.fds[i].fd = INVALID_SOCKET;
-        pollmgr.fds[i].events = 0;
-        pollmgr.fds[i].revents = 0;
+    for (i = 0; i < pm->capacity; ++i) {
+        pm->fds[i].fd = INVALID_SOCKET;
+        pm->fds[i].events = 0;
+        pm->fds[i].revents = 0;
+        pm->handlers[i] = NULL;
     }
 
     return 0;
 
   cleanup_close:
     for (i = 0; i < POLLMGR_SLOT_STATIC_COUNT; ++i) {
-        SOCKET *chan = pollmgr.chan[i];
+        SOCKET *chan = pm->chan[i];
         if (chan[POLLMGR_CHFD_RD] != INVALID_SOCKET) {
             closesocket(chan[POLLMGR_CHFD_RD]);
             closesocket(chan[POLLMGR_CHFD_WR]);
@@ -155,53 +242,117 @@ pollmgr_init(void)
 }
 
 
+/**
+ * Poll manager of the calling thread.  Initialization code that runs
+ * before poll manager threads are started registers with shard 0.
+ */
+static struct pollmgr *
+pollmgr_self(void)
+{
+    struct pollmgr *pm;
+
+    pm = (struct pollmgr *)RTTlsGet(pollmgr_tls);
+    if (pm == NULL) {
+        pm = &pollmgr[0];
+    }
+    return pm;
+}
+
+
+/**
+ * Pick the shard for a new proxied connection.  Hashing the
+ * connection tuple keeps the choice stable and spreads connections
+ * from many guests evenly.
+ */
+int
+pollmgr_shard_select(const ipX_addr_t *laddr, u16_t lport,
+                     const ipX_addr_t *raddr, u16_t rport)
+{
+    const u8_t *p;
+    u32_t hash;
+    size_t i;
+
+    if (pollmgr_nshards <= 1) {
+        return 0;
+    }
+
+    /* FNV-1a */
+    hash = 2166136261U;
+#define POLLMGR_HASH(ptr, len) do {                     \
+        p = (const u8_t *)(ptr);                        \
+        for (i = 0; i < (len); ++i) {                   \
+            hash = (hash ^ p[i]) * 16777619U;           \
+        }                                               \
+    } while (0)
+
+    POLLMGR_HASH(laddr, sizeof(*laddr));
+    POLLMGR_HASH(&lport, sizeof(lport));
+    POLLMGR_HASH(raddr, sizeof(*raddr));
+    POLLMGR_HASH(&rport, sizeof(rport));
+#undef POLLMGR_HASH
+
+    return (int)(hash % (u32_t)pollmgr_nshards);
+}
+
+
 /*
  * Must be called before pollmgr loop is started, so no locking.
+ *
+ * Channels are created in every shard with the same handler, so that
+ * messages about a connection can be sent to the shard that polls its
+ * socket.  The returned write end is that of shard 0.
  */
 SOCKET
 pollmgr_add_chan(int slot, struct pollmgr_handler *handler)
 {
+    int shard;
+
     if (slot >= POLLMGR_SLOT_FIRST_DYNAMIC) {
         handler->slot = -1;
         return INVALID_SOCKET;
     }
 
-    pollmgr_add_at(slot, handler, pollmgr.chan[slot][POLLMGR_CHFD_RD], POLLIN);
-    return pollmgr.chan[slot][POLLMGR_CHFD_WR];
+    for (shard = pollmgr_nshards - 1; shard >= 0; --shard) {
+        struct pollmgr *pm = &pollmgr[shard];
+        pollmgr_add_at(pm, slot, handler, pm->chan[slot][POLLMGR_CHFD_RD], POLLIN);
+    }
+    return pollmgr[0].chan[slot][POLLMGR_CHFD_WR];
 }
 
 
 /*
  * Must be called from pollmgr loop (via callbacks), so no locking.
+ * The handler is added to the shard of the calling thread.
  */
 int
 pollmgr_add(struct pollmgr_handler *handler, SOCKET fd, int events)
 {
+    struct pollmgr *pm = pollmgr_self();
     int slot;
 
     DPRINTF2(("%s: new fd %d\n", __func__, fd));
 
-    if (pollmgr.nfds == pollmgr.capacity) {
+    if (pm->nfds == pm->capacity) {
         struct pollfd *newfds;
         struct pollmgr_handler **newhdls;
         nfds_t newcap;
         nfds_t i;
 
-        newcap = pollmgr.capacity * 2;
+        newcap = pm->capacity * 2;
 
         newfds = (struct pollfd *)
-            realloc(pollmgr.fds, newcap * sizeof(*pollmgr.fds));
+            realloc(pm->fds, newcap * sizeof(*pm->fds));
         if (newfds == NULL) {
             DPRINTF(("%s: Failed to reallocate fds array\n", __func__));
             handler->slot = -1;
             return -1;
         }
 
-        pollmgr.fds = newfds; /* don't crash/leak if realloc(handlers) fails */
+        pm->fds = newfds; /* don't crash/leak if realloc(handlers) fails */
         /* but don't update capacity yet! */
 
         newhdls = (struct pollmgr_handler **)
-            realloc(pollmgr.handlers, newcap * sizeof(*pollmgr.handlers));
+            realloc(pm->handlers, newcap * sizeof(*pm->handlers));
         if (newhdls == NULL) {
             DPRINTF(("%s: Failed to reallocate handlers array\n", __func__));
             /* if we failed to realloc here, then fds points to the
@@ -210,10 +361,10 @@ pollmgr_add(struct pollmgr_handler *handler, SOCKET fd, int events)
             return -1;
         }
 
-        pollmgr.handlers = newhdls;
-        pollmgr.capacity = newcap;
+        pm->handlers = newhdls;
+        pm->capacity = newcap;
 
-        for (i = pollmgr.nfds; i < newcap; ++i) {
+        for (i = pm->nfds; i < newcap; ++i) {
             newfds[i].fd = INVALID_SOCKET;
             newfds[i].events = 0;
             newfds[i].revents = 0;
@@ -221,28 +372,41 @@ pollmgr_add(struct pollmgr_handler *handler, SOCKET fd, int events)
         }
     }
 
-    slot = pollmgr.nfds;
-    ++pollmgr.nfds;
+    slot = pm->nfds;
+    ++pm->nfds;
 
-    pollmgr_add_at(slot, handler, fd, events);
+    pollmgr_add_at(pm, slot, handler, fd, events);
     return slot;
 }
 
 
 static void
-pollmgr_add_at(int slot, struct pollmgr_handler *handler, SOCKET fd, int events)
+pollmgr_add_at(struct pollmgr *pm, int slot, struct pollmgr_handler *handler,
+               SOCKET fd, int events)
 {
-    pollmgr.fds[slot].fd = fd;
-    pollmgr.fds[slot].events = events;
-    pollmgr.fds[slot].revents = 0;
-    pollmgr.handlers[slot] = handler;
+    pm->fds[slot].fd = fd;
+    pm->fds[slot].events = events;
+    pm->fds[slot].revents = 0;
+    pm->handlers[slot] = handler;
 
     handler->slot = slot;
+    handler->shard = pm->shard;
 }
 
 
 ssize_t
 pollmgr_chan_send(int slot, void *buf, size_t nbytes)
+{
+    return pollmgr_shard_chan_send(0, slot, buf, nbytes);
+}
+
+
+/**
+ * Send a message to the channel of the specified shard, usually the
+ * one recorded in the handler the message refers to.
+ */
+ssize_t
+pollmgr_shard_chan_send(int shard, int slot, void *buf, size_t nbytes)
 {
     SOCKET fd;
     ssize_t nsent;
@@ -251,7 +415,8 @@ pollmgr_chan_send(int slot, void *buf, size_t nbytes)
         return -1;
     }
 
-    fd = pollmgr.chan[slot][POLLMGR_CHFD_WR];
+    LWIP_ASSERT1(shard >= 0 && shard < pollmgr_nshards);
+    fd = pollmgr[shard].chan[slot][POLLMGR_CHFD_WR];
     nsent = send(fd, buf, (int)nbytes, 0);
     if (nsent == SOCKET_ERROR) {
         DPRINTF(("send on chan %d: %R[sockerr]\n", slot, SOCKERRNO()));
@@ -304,38 +469,61 @@ pollmgr_chan_recv_ptr(struct pollmgr_handler *handler, SOCKET fd, int revents)
 }
 
 
+/*
+ * Dynamic slots are only manipulated by the thread that polls them.
+ */
 void
 pollmgr_update_events(int slot, int events)
 {
+    struct pollmgr *pm = pollmgr_self();
+
     LWIP_ASSERT1(slot >= POLLMGR_SLOT_FIRST_DYNAMIC);
-    LWIP_ASSERT1((nfds_t)slot < pollmgr.nfds);
+    LWIP_ASSERT1((nfds_t)slot < pm->nfds);
 
-    pollmgr.fds[slot].events = events;
+    pm->fds[slot].events = events;
 }
 
 
 void
 pollmgr_del_slot(int slot)
 {
+    struct pollmgr *pm = pollmgr_self();
+
     LWIP_ASSERT1(slot >= POLLMGR_SLOT_FIRST_DYNAMIC);
 
     DPRINTF2(("%s(%d): fd %d ! DELETED\n",
-              __func__, slot, pollmgr.fds[slot].fd));
+              __func__, slot, pm->fds[slot].fd));
 
-    pollmgr.fds[slot].fd = INVALID_SOCKET; /* see poll loop */
+    pm->fds[slot].fd = INVALID_SOCKET; /* see poll loop */
 }
 
 
+/**
+ * Poll manager thread.  The argument is the shard index cast to
+ * pointer.
+ */
 void
-pollmgr_thread(void *ignored)
+pollmgr_thread(void *arg)
 {
-    LWIP_UNUSED_ARG(ignored);
-    pollmgr_loop();
+    const int shard = (int)(intptr_t)arg;
+    struct pollmgr *pm;
+    int status;
+
+    LWIP_ASSERT1(shard >= 0 && shard < pollmgr_nshards);
+    pm = &pollmgr[shard];
+
+    status = RTTlsSet(pollmgr_tls, pm);
+    if (RT_FAILURE(status)) {
+        errx(EXIT_FAILURE, "pollmgr %d: failed to set TLS", shard);
+        /* NOTREACHED */
+    }
+
+    pollmgr_loop(pm);
 }
 
 
 static void
-pollmgr_loop(void)
+pollmgr_loop(struct pollmgr *pm)
 {
     int nready;
     SOCKET delfirst;
@@ -344,9 +532,9 @@ pollmgr_loop(void)
 
     for (;;) {
 #ifndef RT_OS_WINDOWS
-        nready = poll(pollmgr.fds, pollmgr.nfds, -1);
+        nready = poll(pm->fds, pm->nfds, -1);
 #else
-        int rc = RTWinPoll(pollmgr.fds, pollmgr.nfds,RT_INDEFINITE_WAIT, &nready);
+        int rc = RTWinPoll(pm->fds, pm->nfds,RT_INDEFINITE_WAIT, &nready);
         if (RT_FAILURE(rc)) {
             err(EXIT_FAILURE, "poll"); /* XXX: what to do on error? */
             /* NOTREACHED*/
@@ -372,13 +560,13 @@ pollmgr_loop(void)
         delfirst = INVALID_SOCKET;
         pdelprev = &delfirst;
 
-        for (i = 0; (nfds_t)i < pollmgr.nfds && nready > 0; ++i) {
+        for (i = 0; (nfds_t)i < pm->nfds && nready > 0; ++i) {
             struct pollmgr_handler *handler;
             SOCKET fd;
             int revents, nevents;
 
-            fd = pollmgr.fds[i].fd;
-            revents = pollmgr.fds[i].revents;
+            fd = pm->fds[i].fd;
+            revents = pm->fds[i].revents;
 
             /*
              * Channel handlers can request deletion of dynamic slots
@@ -400,7 +588,7 @@ pollmgr_loop(void)
             }
             --nready;
 
-            handler = pollmgr.handlers[i];
+            handler = pm->handlers[i];
 
             if (handler != NULL && handler->callback != NULL) {
 #ifdef LWIP_PROXY_DEBUG
@@ -435,32 +623,32 @@ pollmgr_loop(void)
 
           update_events:
             if (nevents >= 0) {
-                if (nevents != pollmgr.fds[i].events) {
+                if (nevents != pm->fds[i].events) {
                     DPRINTF2(("%s: fd %d ! nevents 0x%x\n",
                               __func__, fd, nevents));
                 }
-                pollmgr.fds[i].events = nevents;
+                pm->fds[i].events = nevents;
             }
             else if (i < POLLMGR_SLOT_FIRST_DYNAMIC) {
                 /* Don't garbage-collect channels. */
                 DPRINTF2(("%s: fd %d ! DELETED (channel %d)\n",
                           __func__, fd, i));
-                pollmgr.fds[i].fd = INVALID_SOCKET;
-                pollmgr.fds[i].events = 0;
-                pollmgr.fds[i].revents = 0;
-                pollmgr.handlers[i] = NULL;
+                pm->fds[i].fd = INVALID_SOCKET;
+                pm->fds[i].events = 0;
+                pm->fds[i].revents = 0;
+                pm->handlers[i] = NULL;
             }
             else {
                 DPRINTF2(("%s: fd %d ! DELETED\n", __func__, fd));
 
                 /* schedule for deletion (see g/c loop for details) */
                 *pdelprev = i;  /* make previous entry point to us */
-                pdelprev = &pollmgr.fds[i].fd;
+                pdelprev = &pm->fds[i].fd;
 
-                pollmgr.fds[i].fd = INVALID_SOCKET; /* end of list (for now) */
-                pollmgr.fds[i].events = POLLMGR_GARBAGE;
-                pollmgr.fds[i].revents = 0;
-                pollmgr.handlers[i] = NULL;
+                pm->fds[i].fd = INVALID_SOCKET; /* end of list (for now) */
+                pm->fds[i].events = POLLMGR_GARBAGE;
+                pm->fds[i].revents = 0;
+                pm->handlers[i] = NULL;
             }
         } /* processing loop */
 
@@ -478,33 +666,33 @@ pollmgr_loop(void)
          * processing loop above.
          */
         while (delfirst != INVALID_SOCKET) {
-            const int last = pollmgr.nfds - 1;
+            const int last = pm->nfds - 1;
 
             /*
              * We want a live entry in the last slot to swap into the
              * freed slot, so make sure we have one.
              */
-            if (pollmgr.fds[last].events == POLLMGR_GARBAGE /* garbage */
-                || pollmgr.fds[last].fd == INVALID_SOCKET)  /* or killed */
+            if (pm->fds[last].events == POLLMGR_GARBAGE /* garbage */
+                || pm->fds[last].fd == INVALID_SOCKET)  /* or killed */
             {
                 /* drop garbage entry at the end of the array */
-                --pollmgr.nfds;
+                --pm->nfds;
 
                 if (delfirst == (SOCKET)last) {
-                    /* congruent to delnext >= pollmgr.nfds test below */
+                    /* congruent to delnext >= pm->nfds test below */
                     delfirst = INVALID_SOCKET; /* done */
                 }
             }
             else {
-                const SOCKET delnext = pollmgr.fds[delfirst].fd;
+                const SOCKET delnext = pm->fds[delfirst].fd;
 
                 /* copy live entry at the end to the first slot being freed */
-                pollmgr.fds[delfirst] = pollmgr.fds[last]; /* struct copy */
-                pollmgr.handlers[delfirst] = pollmgr.handlers[last];
-                pollmgr.handlers[delfirst]->slot = (int)delfirst;
-                --pollmgr.nfds;
+                pm->fds[delfirst] = pm->fds[last]; /* struct copy */
+                pm->handlers[delfirst] = pm->handlers[last];
+                pm->handlers[delfirst]->slot = (int)delfirst;
+                --pm->nfds;
 
-                if ((nfds_t)delnext >= pollmgr.nfds) {
+                if ((nfds_t)delnext >= pm->nfds) {
                     delfirst = INVALID_SOCKET; /* done */
                 }
                 else {
@@ -512,10 +700,10 @@ pollmgr_loop(void)
                 }
             }
 
-            pollmgr.fds[last].fd = INVALID_SOCKET;
-            pollmgr.fds[last].events = 0;
-            pollmgr.fds[last].revents = 0;
-            pollmgr.handlers[last] = NULL;
+            pm->fds[last].fd = INVALID_SOCKET;
+            pm->fds[last].events = 0;
+            pm->fds[last].revents = 0;
+            pm->handlers[last] = NULL;
         }
     } /* poll loop */
 }
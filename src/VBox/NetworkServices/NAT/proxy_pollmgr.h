@@ -22,6 +22,10 @@
 # include <unistd.h>             /* for ssize_t */
 #endif
 #include "lwip/sys.h"
+#include "lwip/ip_addr.h"
+
+/* upper limit on the number of poll manager threads */
+#define POLLMGR_MAX_SHARDS 8
 
 enum pollmgr_slot_t {
     POLLMGR_CHAN_PXTCP_ADD,     /* new proxy tcp connection from guest */
@@ -47,6 +51,7 @@ struct pollmgr_handler {
     pollmgr_callback callback;
     void *data;
     int slot;
+    int shard;                  /* poll manager thread polling the slot */
 };
 
 struct pollmgr_refptr {
@@ -56,11 +61,14 @@ struct pollmgr_refptr {
     size_t weak;
 };
 
-int pollmgr_init(void);
+int pollmgr_init(int);
+int pollmgr_shard_count(void);
+int pollmgr_shard_select(const ipX_addr_t *, u16_t, const ipX_addr_t *, u16_t);
 
 /* static named slots (aka "channels") */
 SOCKET pollmgr_add_chan(int, struct pollmgr_handler *);
 ssize_t pollmgr_chan_send(int, void *buf, size_t nbytes);
+ssize_t pollmgr_shard_chan_send(int, int, void *buf, size_t nbytes);
 void *pollmgr_chan_recv_ptr(struct pollmgr_handler *, SOCKET, int);
 
 /* dynamic slots */
@@ -78,6 +86,11 @@ void pollmgr_del_slot(int);
 void pollmgr_thread(void *);
 
 /* buffer for callbacks to receive udp without worrying about truncation */
-extern u8_t pollmgr_udpbuf[64 * 1024];
+struct pollmgr_rxbuf {
+    u8_t buf[64 * 1024];
+};
+struct pollmgr_rxbuf *pollmgr_udpbuf_get(void);
+/* - each poll manager thread has its own */
+#define pollmgr_udpbuf (pollmgr_udpbuf_get()->buf)
 
 #endif /* _PROXY_POLLMGR_H_ */
@@ -335,12 +335,14 @@ pxtcp_init(void)
 
 /**
  * Syntactic sugar for sending pxtcp pointer over poll manager
- * channel.  Used by lwip thread functions.
+ * channel.  Used by lwip thread functions.  Messages go to the poll
+ * manager thread that polls (or is going to poll) pxtcp's socket.
  */
 static ssize_t
 pxtcp_chan_send(enum pollmgr_slot_t slot, struct pxtcp *pxtcp)
 {
-    return pollmgr_chan_send(slot, &pxtcp, sizeof(pxtcp));
+    return pollmgr_shard_chan_send(pxtcp->pmhdl.shard, slot,
+                                   &pxtcp, sizeof(pxtcp));
 }
 
 
@@ -352,7 +354,8 @@ static ssize_t
 pxtcp_chan_send_weak(enum pollmgr_slot_t slot, struct pxtcp *pxtcp)
 {
     pollmgr_refptr_weak_ref(pxtcp->rp);
-    return pollmgr_chan_send(slot, &pxtcp->rp, sizeof(pxtcp->rp));
+    return pollmgr_shard_chan_send(pxtcp->pmhdl.shard, slot,
+                                   &pxtcp->rp, sizeof(pxtcp->rp));
 }
 
 
@@ -590,6 +593,7 @@ pxtcp_allocate(void)
     pxtcp->pmhdl.callback = NULL;
     pxtcp->pmhdl.data = (void *)pxtcp;
     pxtcp->pmhdl.slot = -1;
+    pxtcp->pmhdl.shard = 0;
 
     pxtcp->pcb = NULL;
     pxtcp->sock = INVALID_SOCKET;
@@ -1064,6 +1068,8 @@ pxtcp_pcb_accept_outbound(struct tcp_pcb *newpcb, struct pbuf *p,
     pxtcp->sock = sock;
 
     pxtcp->pmhdl.callback = pxtcp_pmgr_connect;
+    pxtcp->pmhdl.shard = pollmgr_shard_select(&newpcb->local_ip, newpcb->local_port,
+                                              &newpcb->remote_ip, newpcb->remote_port);
     pxtcp->events = POLLOUT;
 
     nsent = pxtcp_chan_send(POLLMGR_CHAN_PXTCP_ADD, pxtcp);
@@ -1487,6 +1493,14 @@ pxtcp_pcb_forward_outbound_close(struct pxtcp *pxtcp)
  *
  * (Re)scehdules one-time callout if not all data are sent.
  */
+/*
+ * Max number of pbufs of outbound chain passed to a single sendmsg().
+ * Guest segments are usually one pbuf each, so this lets us push a
+ * whole receive window worth of data straight from pbuf payloads with
+ * one system call.
+ */
+#define PXTCP_OUTBOUND_IOVMAX 64
+
 static err_t
 pxtcp_pcb_forward_outbound(struct pxtcp *pxtcp, struct pbuf *p)
 {
@@ -1505,7 +1519,7 @@ pxtcp_pcb_forward_outbound(struct pxtcp *pxtcp, struct pbuf *p)
 
     qs = p;
     while (qs != NULL) {
-        IOVEC iov[8];
+        IOVEC iov[PXTCP_OUTBOUND_IOVMAX];
         const size_t iovsize = sizeof(iov)/sizeof(iov[0]);
         size_t fwd1;
         ssize_t nsent;
@@ -177,12 +177,14 @@ pxudp_init(void)
 
 /**
  * Syntactic sugar for sending pxudp pointer over poll manager
- * channel.  Used by lwip thread functions.
+ * channel.  Used by lwip thread functions.  Messages go to the poll
+ * manager thread that polls (or is going to poll) pxudp's socket.
  */
 static ssize_t
 pxudp_chan_send(enum pollmgr_slot_t chan, struct pxudp *pxudp)
 {
-    return pollmgr_chan_send(chan, &pxudp, sizeof(pxudp));
+    return pollmgr_shard_chan_send(pxudp->pmhdl.shard, chan,
+                                   &pxudp, sizeof(pxudp));
 }
 
 
@@ -194,7 +196,8 @@ static ssize_t
 pxudp_chan_send_weak(enum pollmgr_slot_t chan, struct pxudp *pxudp)
 {
     pollmgr_refptr_weak_ref(pxudp->rp);
-    return pollmgr_chan_send(chan, &pxudp->rp, sizeof(pxudp->rp));
+    return pollmgr_shard_chan_send(pxudp->pmhdl.shard, chan,
+                                   &pxudp->rp, sizeof(pxudp->rp));
 }
 
 
@@ -300,6 +303,7 @@ pxudp_allocate(void)
     pxudp->pmhdl.callback = NULL;
     pxudp->pmhdl.data = (void *)pxudp;
     pxudp->pmhdl.slot = -1;
+    pxudp->pmhdl.shard = 0;
 
     pxudp->pcb = NULL;
     pxudp->sock = INVALID_SOCKET;
@@ -547,6 +551,8 @@ pxudp_pcb_accept(void *arg, struct udp_pcb *newpcb, struct pbuf *p,
     udp_recv(newpcb, pxudp_pcb_recv, pxudp);
 
     pxudp->pmhdl.callback = pxudp_pmgr_pump;
+    pxudp->pmhdl.shard = pollmgr_shard_select(&newpcb->local_ip, newpcb->local_port,
+                                              &newpcb->remote_ip, newpcb->remote_port);
     pxudp_chan_send(POLLMGR_CHAN_PXUDP_ADD, pxudp);
 
     /* dispatch directly instead of calling pxudp_pcb_recv() */
@@ -36,11 +36,30 @@
 #include <iprt/critsect.h>
 #include <iprt/err.h>
 #include <iprt/mem.h>
+#include <iprt/mp.h>
 #include <iprt/param.h>
+#include <iprt/string.h>
+#include <iprt/thread.h>
 
 #include "internal/magics.h"
 
 
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** The initial number of rounds in a magazine. */
+#define RTMEMCACHE_MAG_ROUNDS_INIT      16
+/** The max number of rounds in a magazine. */
+#define RTMEMCACHE_MAG_ROUNDS_MAX       64
+/** The max number of magazine slots. */
+#define RTMEMCACHE_MAX_SLOTS            128
+/** The number of contended depot lock acquisitions after which the magazine
+ * size is increased. */
+#define RTMEMCACHE_DEPOT_CONTENTION_GROW 16
+/** The number of depot operations between rebalancing runs. */
+#define RTMEMCACHE_DEPOT_BALANCE_OPS    1024
+
+
 /*********************************************************************************************************************************
 *   Structures and Typedefs                                                                                                      *
 *********************************************************************************************************************************/
@@ -48,6 +67,8 @@
 typedef struct RTMEMCACHEINT  *PRTMEMCACHEINT;
 /** Pointer to a cache page. */
 typedef struct RTMEMCACHEPAGE *PRTMEMCACHEPAGE;
+/** Pointer to a magazine. */
+typedef struct RTMEMCACHEMAG *PRTMEMCACHEMAG;
 
 
 
@@ -90,15 +111,70 @@ typedef struct RTMEMCACHEPAGE
     uint8_t                    *pbObjects;
     /** The number of objects on this page.  */
     uint32_t                    cObjects;
+    /** The magazine slot of the thread which created the page (for the
+     * remote free statistics). */
+    uint32_t                    idxHomeSlot;
 
     /** Padding to force cFree into the next cache line. (ASSUMES CL = 64) */
-    uint8_t                     abPadding[ARCH_BITS == 32 ? 64 - 6*4 : 64 - 5*8 - 4];
+    uint8_t                     abPadding[ARCH_BITS == 32 ? 64 - 7*4 : 64 - 5*8 - 2*4];
     /** The number of free objects. */
     int32_t volatile            cFree;
 } RTMEMCACHEPAGE;
 AssertCompileMemberOffset(RTMEMCACHEPAGE, cFree, 64);
 
 
+/**
+ * A magazine - a stack of free (constructed) objects.
+ */
+typedef struct RTMEMCACHEMAG
+{
+    /** The next magazine in the depot list. */
+    PRTMEMCACHEMAG              pNext;
+    /** The number of objects (rounds) in the magazine. */
+    uint32_t                    cRounds;
+    /** The objects. */
+    void                       *apvRounds[RTMEMCACHE_MAG_ROUNDS_MAX];
+} RTMEMCACHEMAG;
+
+
+/**
+ * A magazine slot.
+ *
+ * Threads are hashed onto the slots, each slot holding a loaded and a previous
+ * magazine as described by Bonwick.  A slot is owned by whoever manages to set
+ * fBusy, the others bypass the magazine layer for that call.
+ */
+typedef union RTMEMCACHESLOT
+{
+    struct
+    {
+        /** Set while a thread is using the slot. */
+        uint32_t volatile       fBusy;
+        /** Explicit padding. */
+        uint32_t                u32Padding;
+        /** The loaded magazine, NULL if none. */
+        PRTMEMCACHEMAG          pLoaded;
+        /** The previous magazine, NULL if none. */
+        PRTMEMCACHEMAG          pPrevious;
+        /** Allocations served by the magazines. */
+        uint64_t                cAllocHits;
+        /** Allocations that went to the page level. */
+        uint64_t                cAllocMisses;
+        /** Frees absorbed by the magazines. */
+        uint64_t                cFreeHits;
+        /** Frees that went to the page level. */
+        uint64_t                cFreeMisses;
+        /** Frees of objects carved out by another slot. */
+        uint64_t                cRemoteFrees;
+    } s;
+    /** Padding to keep the slots in separate cache lines. */
+    uint8_t                     abPadding[128];
+} RTMEMCACHESLOT;
+AssertCompile(sizeof(((RTMEMCACHESLOT *)0)->s) <= 128);
+/** Pointer to a magazine slot. */
+typedef RTMEMCACHESLOT *PRTMEMCACHESLOT;
+
+
 /**
  * Memory object cache instance.
  */
@@ -146,6 +222,41 @@ typedef struct RTMEMCACHEINT
      *       cache.  Also, it totally doesn't work when the objects are too
      *       small. */
     PRTMEMCACHEFREEOBJ volatile pFreeTop;
+
+    /** @name Magazine layer (RTMEMCACHE_FLAGS_MAGAZINES).
+     * @{ */
+    /** The magazine slots, NULL if the magazine layer is disabled. */
+    PRTMEMCACHESLOT             paSlots;
+    /** The slot index mask (number of slots - 1). */
+    uint32_t                    fSlotMask;
+    /** The current magazine size (rounds). */
+    uint32_t volatile           cMagRounds;
+    /** Critical section protecting the depot. */
+    RTCRITSECT                  DepotCritSect;
+    /** Full magazines. */
+    PRTMEMCACHEMAG              pDepotFull;
+    /** Empty magazines. */
+    PRTMEMCACHEMAG              pDepotEmpty;
+    /** Number of full magazines. */
+    uint32_t                    cDepotFull;
+    /** Number of empty magazines. */
+    uint32_t                    cDepotEmpty;
+    /** The lowest cDepotFull value since the last rebalancing, i.e. the number
+     * of full magazines which weren't needed (the working set). */
+    uint32_t                    cDepotFullMin;
+    /** Depot operations since the last rebalancing. */
+    uint32_t                    cDepotOps;
+    /** Contended depot lock acquisitions since the magazine size last grew. */
+    uint32_t                    cDepotContentionRecent;
+    /** Magazine exchanges with the depot. */
+    uint64_t                    cDepotExchanges;
+    /** Number of times the depot lock was contended. */
+    uint64_t                    cDepotContention;
+    /** Number of full magazines returned to the page level. */
+    uint64_t                    cDepotTrims;
+    /** Operations bypassing the magazines because the slot was busy. */
+    uint64_t volatile           cSlotCollisions;
+    /** @} */
 } RTMEMCACHEINT;
 
 
@@ -153,6 +264,8 @@ typedef struct RTMEMCACHEINT
 *   Internal Functions                                                                                                           *
 *********************************************************************************************************************************/
 static void rtMemCacheFreeList(RTMEMCACHEINT *pThis, PRTMEMCACHEFREEOBJ pHead);
+static void rtMemCacheFreeOne(RTMEMCACHEINT *pThis, void *pvObj);
+static void rtMemCacheFreeSlab(RTMEMCACHEINT *pThis, void *pvObj);
 
 
 RTDECL(int) RTMemCacheCreate(PRTMEMCACHE phMemCache, size_t cbObject, size_t cbAlignment, uint32_t cMaxObjects,
@@ -165,7 +278,7 @@ RTDECL(int) RTMemCacheCreate(PRTMEMCACHE phMemCache, size_t cbObject, size_t cbA
     AssertReturn(!pfnDtor || pfnCtor, VERR_INVALID_PARAMETER);
     AssertReturn(cbObject > 0, VERR_INVALID_PARAMETER);
     AssertReturn(cbObject <= PAGE_SIZE / 8, VERR_INVALID_PARAMETER);
-    AssertReturn(!fFlags, VERR_INVALID_PARAMETER);
+    AssertReturn(!(fFlags & ~RTMEMCACHE_FLAGS_VALID_MASK), VERR_INVALID_PARAMETER);
 
     if (cbAlignment == 0)
     {
@@ -191,7 +304,7 @@ RTDECL(int) RTMemCacheCreate(PRTMEMCACHE phMemCache, size_t cbObject, size_t cbA
     /*
      * Allocate and initialize the instance memory.
      */
-    RTMEMCACHEINT *pThis = (RTMEMCACHEINT *)RTMemAlloc(sizeof(*pThis));
+    RTMEMCACHEINT *pThis = (RTMEMCACHEINT *)RTMemAllocZ(sizeof(*pThis));
     if (!pThis)
         return VERR_NO_MEMORY;
     int rc = RTCritSectInit(&pThis->CritSect);
@@ -201,6 +314,37 @@ RTDECL(int) RTMemCacheCreate(PRTMEMCACHE phMemCache, size_t cbObject, size_t cbA
         return rc;
     }
 
+    /*
+     * The magazine layer.  Use about twice as many slots as there are CPUs
+     * to keep the collisions between threads down.
+     */
+    if (fFlags & RTMEMCACHE_FLAGS_MAGAZINES)
+    {
+        uint32_t const cCpus  = RT_MAX(RTMpGetCount(), 1);
+        uint32_t       cSlots = 4;
+        while (cSlots < cCpus * 2 && cSlots < RTMEMCACHE_MAX_SLOTS)
+            cSlots *= 2;
+
+        rc = RTCritSectInit(&pThis->DepotCritSect);
+        if (RT_SUCCESS(rc))
+        {
+            pThis->paSlots = (PRTMEMCACHESLOT)RTMemAllocZ(sizeof(pThis->paSlots[0]) * cSlots);
+            if (!pThis->paSlots)
+            {
+                RTCritSectDelete(&pThis->DepotCritSect);
+                rc = VERR_NO_MEMORY;
+            }
+        }
+        if (RT_FAILURE(rc))
+        {
+            RTCritSectDelete(&pThis->CritSect);
+            RTMemFree(pThis);
+            return rc;
+        }
+        pThis->fSlotMask    = cSlots - 1;
+        pThis->cMagRounds   = RTMEMCACHE_MAG_ROUNDS_INIT;
+    }
+
     pThis->u32Magic         = RTMEMCACHE_MAGIC;
     pThis->cbObject         = (uint32_t)RT_ALIGN_Z(cbObject, cbAlignment);
     pThis->cbAlignment      = (uint32_t)cbAlignment;
@@ -251,6 +395,30 @@ RTDECL(int) RTMemCacheDestroy(RTMEMCACHE hMemCache)
     AssertReturn(ASMAtomicCmpXchgU32(&pThis->u32Magic, RTMEMCACHE_MAGIC_DEAD, RTMEMCACHE_MAGIC), VERR_INVALID_HANDLE);
     RTCritSectDelete(&pThis->CritSect);
 
+    /* The magazines only hold objects living in the pages below. */
+    if (pThis->paSlots)
+    {
+        for (uint32_t iSlot = 0; iSlot <= pThis->fSlotMask; iSlot++)
+        {
+            RTMemFree(pThis->paSlots[iSlot].s.pLoaded);
+            RTMemFree(pThis->paSlots[iSlot].s.pPrevious);
+        }
+        RTMemFree(pThis->paSlots);
+        pThis->paSlots = NULL;
+
+        PRTMEMCACHEMAG apHeads[2] = { pThis->pDepotFull, pThis->pDepotEmpty };
+        for (unsigned i = 0; i < RT_ELEMENTS(apHeads); i++)
+            while (apHeads[i])
+            {
+                PRTMEMCACHEMAG pMag = apHeads[i];
+                apHeads[i] = pMag->pNext;
+                RTMemFree(pMag);
+            }
+        pThis->pDepotFull  = NULL;
+        pThis->pDepotEmpty = NULL;
+        RTCritSectDelete(&pThis->DepotCritSect);
+    }
+
     while (pThis->pPageHead)
     {
         PRTMEMCACHEPAGE pPage = pThis->pPageHead;
@@ -273,6 +441,19 @@ RTDECL(int) RTMemCacheDestroy(RTMEMCACHE hMemCache)
 }
 
 
+/**
+ * Gets the magazine slot index of the calling thread.
+ *
+ * @returns Slot index.
+ * @param   pThis               The memory cache instance.
+ */
+DECLINLINE(uint32_t) rtMemCacheSlotIndex(RTMEMCACHEINT *pThis)
+{
+    uint64_t uHash = (uint64_t)RTThreadNativeSelf() * UINT64_C(0x9e3779b97f4a7c15);
+    return (uint32_t)(uHash >> 32) & pThis->fSlotMask;
+}
+
+
 /**
  * Grows the cache.
  *
@@ -309,6 +490,7 @@ static int rtMemCacheGrow(RTMEMCACHEINT *pThis)
             pPage->pNext        = NULL;
             pPage->cFree        = cObjects;
             pPage->cObjects     = cObjects;
+            pPage->idxHomeSlot  = pThis->paSlots ? rtMemCacheSlotIndex(pThis) : 0;
             uint8_t *pb = (uint8_t *)(pPage + 1);
             pb = RT_ALIGN_PT(pb, 8, uint8_t *);
             pPage->pbmCtor      = pb;
@@ -360,12 +542,15 @@ DECL_FORCE_INLINE(int32_t) rtMemCacheGrabObj(PRTMEMCACHEPAGE pPage)
 }
 
 
-RTDECL(int) RTMemCacheAllocEx(RTMEMCACHE hMemCache, void **ppvObj)
+/**
+ * Allocates an object at the page level.
+ *
+ * @returns IPRT status code.
+ * @param   pThis               The memory cache instance.
+ * @param   ppvObj              Where to return the object.
+ */
+static int rtMemCacheAllocSlab(RTMEMCACHEINT *pThis, void **ppvObj)
 {
-    RTMEMCACHEINT *pThis = hMemCache;
-    AssertPtrReturn(pThis, VERR_INVALID_PARAMETER);
-    AssertReturn(pThis->u32Magic == RTMEMCACHE_MAGIC, VERR_INVALID_PARAMETER);
-
     /*
      * Try grab a free object from the stack.
      */
@@ -468,11 +653,11 @@ RTDECL(int) RTMemCacheAllocEx(RTMEMCACHE hMemCache, void **ppvObj)
     if (   pThis->pfnCtor
         && !ASMAtomicBitTestAndSet(pPage->pbmCtor, iObj))
     {
-        int rc = pThis->pfnCtor(hMemCache, pvObj, pThis->pvUser);
+        int rc = pThis->pfnCtor(pThis, pvObj, pThis->pvUser);
         if (RT_FAILURE(rc))
         {
             ASMAtomicBitClear(pPage->pbmCtor, iObj);
-            RTMemCacheFree(pThis, pvObj);
+            rtMemCacheFreeSlab(pThis, pvObj);
             return rc;
         }
     }
@@ -544,18 +729,14 @@ static void rtMemCacheFreeList(RTMEMCACHEINT *pThis, PRTMEMCACHEFREEOBJ pHead)
 
 
 
-RTDECL(void) RTMemCacheFree(RTMEMCACHE hMemCache, void *pvObj)
+/**
+ * Frees an object at the page level.
+ *
+ * @param   pThis               The memory cache.
+ * @param   pvObj               The memory object to free.
+ */
+static void rtMemCacheFreeSlab(RTMEMCACHEINT *pThis, void *pvObj)
 {
-    if (!pvObj)
-        return;
-
-    RTMEMCACHEINT *pThis = hMemCache;
-    AssertPtrReturnVoid(pThis);
-    AssertReturnVoid(pThis->u32Magic == RTMEMCACHE_MAGIC);
-
-    AssertPtr(pvObj);
-    Assert(RT_ALIGN_P(pvObj, pThis->cbAlignment) == pvObj);
-
     if (!pThis->fUseFreeList)
         rtMemCacheFreeOne(pThis, pvObj);
     else
@@ -583,3 +764,374 @@ RTDECL(void) RTMemCacheFree(RTMEMCACHE hMemCache, void *pvObj)
     }
 }
 
+
+
+/**
+ * Tries to take ownership of the calling thread's magazine slot, falling back
+ * on the neighbouring slot if it is busy.
+ *
+ * @returns Pointer to the owned slot, NULL if both are busy.
+ * @param   pThis               The memory cache.
+ * @param   pidxSlot            Where to return the slot index.
+ */
+DECLINLINE(PRTMEMCACHESLOT) rtMemCacheSlotAcquire(RTMEMCACHEINT *pThis, uint32_t *pidxSlot)
+{
+    uint32_t        idxSlot = rtMemCacheSlotIndex(pThis);
+    PRTMEMCACHESLOT pSlot   = &pThis->paSlots[idxSlot];
+    if (!ASMAtomicCmpXchgU32(&pSlot->s.fBusy, 1, 0))
+    {
+        idxSlot = (idxSlot + 1) & pThis->fSlotMask;
+        pSlot   = &pThis->paSlots[idxSlot];
+        if (!ASMAtomicCmpXchgU32(&pSlot->s.fBusy, 1, 0))
+        {
+            ASMAtomicIncU64(&pThis->cSlotCollisions);
+            return NULL;
+        }
+    }
+    *pidxSlot = idxSlot;
+    return pSlot;
+}
+
+
+/**
+ * Returns the rounds of a magazine to the page level.
+ *
+ * @param   pThis               The memory cache.
+ * @param   pMag                The magazine.  NULL is fine.
+ */
+static void rtMemCacheMagEmpty(RTMEMCACHEINT *pThis, PRTMEMCACHEMAG pMag)
+{
+    if (pMag)
+        while (pMag->cRounds > 0)
+            rtMemCacheFreeSlab(pThis, pMag->apvRounds[--pMag->cRounds]);
+}
+
+
+/**
+ * Enters the depot critical section, growing the magazines if it is found to
+ * be contended.
+ *
+ * @param   pThis               The memory cache.
+ */
+static void rtMemCacheDepotEnter(RTMEMCACHEINT *pThis)
+{
+    if (RT_FAILURE(RTCritSectTryEnter(&pThis->DepotCritSect)))
+    {
+        RTCritSectEnter(&pThis->DepotCritSect);
+        pThis->cDepotContention++;
+
+        /* Bigger magazines means fewer trips to the depot. */
+        if (   ++pThis->cDepotContentionRecent >= RTMEMCACHE_DEPOT_CONTENTION_GROW
+            && pThis->cMagRounds < RTMEMCACHE_MAG_ROUNDS_MAX)
+        {
+            ASMAtomicWriteU32(&pThis->cMagRounds, RT_MIN(pThis->cMagRounds * 2, RTMEMCACHE_MAG_ROUNDS_MAX));
+            pThis->cDepotContentionRecent = 0;
+        }
+    }
+}
+
+
+/**
+ * Leaves the depot critical section, rebalancing the depot now and then.
+ *
+ * Full magazines that stayed in the depot during a whole interval are not
+ * part of the working set and are returned to the page level, and the empty
+ * magazine list is trimmed to the number of slots.
+ *
+ * @param   pThis               The memory cache.
+ */
+static void rtMemCacheDepotLeave(RTMEMCACHEINT *pThis)
+{
+    if (++pThis->cDepotOps >= RTMEMCACHE_DEPOT_BALANCE_OPS)
+    {
+        uint32_t cTrim = pThis->cDepotFullMin;
+        while (cTrim-- > 0 && pThis->pDepotFull)
+        {
+            PRTMEMCACHEMAG pMag = pThis->pDepotFull;
+            pThis->pDepotFull = pMag->pNext;
+            pThis->cDepotFull--;
+            rtMemCacheMagEmpty(pThis, pMag);
+            pMag->pNext = pThis->pDepotEmpty;
+            pThis->pDepotEmpty = pMag;
+            pThis->cDepotEmpty++;
+            pThis->cDepotTrims++;
+        }
+
+        while (pThis->cDepotEmpty > pThis->fSlotMask + 1)
+        {
+            PRTMEMCACHEMAG pMag = pThis->pDepotEmpty;
+            pThis->pDepotEmpty = pMag->pNext;
+            pThis->cDepotEmpty--;
+            RTMemFree(pMag);
+        }
+
+        pThis->cDepotFullMin = pThis->cDepotFull;
+        pThis->cDepotOps     = 0;
+    }
+    RTCritSectLeave(&pThis->DepotCritSect);
+}
+
+
+/**
+ * Allocates an object from the magazines of a slot.
+ *
+ * @returns The object, NULL if the magazines and the depot are empty.
+ * @param   pThis               The memory cache.
+ * @param   pSlot               The slot, owned by the caller.
+ */
+static void *rtMemCacheMagAlloc(RTMEMCACHEINT *pThis, PRTMEMCACHESLOT pSlot)
+{
+    PRTMEMCACHEMAG pMag = pSlot->s.pLoaded;
+    if (RT_LIKELY(pMag && pMag->cRounds > 0))
+        return pMag->apvRounds[--pMag->cRounds];
+
+    pMag = pSlot->s.pPrevious;
+    if (pMag && pMag->cRounds > 0)
+    {
+        pSlot->s.pPrevious = pSlot->s.pLoaded;
+        pSlot->s.pLoaded   = pMag;
+        return pMag->apvRounds[--pMag->cRounds];
+    }
+
+    /*
+     * Both are empty, exchange the previous one for a full one from the depot.
+     */
+    rtMemCacheDepotEnter(pThis);
+    pMag = pThis->pDepotFull;
+    if (pMag)
+    {
+        pThis->pDepotFull = pMag->pNext;
+        pThis->cDepotFull--;
+        if (pThis->cDepotFull < pThis->cDepotFullMin)
+            pThis->cDepotFullMin = pThis->cDepotFull;
+        if (pSlot->s.pPrevious)
+        {
+            pSlot->s.pPrevious->pNext = pThis->pDepotEmpty;
+            pThis->pDepotEmpty = pSlot->s.pPrevious;
+            pThis->cDepotEmpty++;
+        }
+        pSlot->s.pPrevious = pSlot->s.pLoaded;
+        pSlot->s.pLoaded   = pMag;
+        pThis->cDepotExchanges++;
+    }
+    rtMemCacheDepotLeave(pThis);
+    if (pMag)
+    {
+        Assert(pMag->cRounds > 0);
+        return pMag->apvRounds[--pMag->cRounds];
+    }
+    return NULL;
+}
+
+
+/**
+ * Frees an object into the magazines of a slot.
+ *
+ * @returns true if taken, false if the caller must free it at the page level.
+ * @param   pThis               The memory cache.
+ * @param   pSlot               The slot, owned by the caller.
+ * @param   pvObj               The object.
+ */
+static bool rtMemCacheMagFree(RTMEMCACHEINT *pThis, PRTMEMCACHESLOT pSlot, void *pvObj)
+{
+    uint32_t const cMaxRounds = ASMAtomicUoReadU32(&pThis->cMagRounds);
+    PRTMEMCACHEMAG pMag = pSlot->s.pLoaded;
+    if (RT_LIKELY(pMag && pMag->cRounds < cMaxRounds))
+    {
+        pMag->apvRounds[pMag->cRounds++] = pvObj;
+        return true;
+    }
+
+    pMag = pSlot->s.pPrevious;
+    if (pMag && pMag->cRounds < cMaxRounds)
+    {
+        pSlot->s.pPrevious = pSlot->s.pLoaded;
+        pSlot->s.pLoaded   = pMag;
+        pMag->apvRounds[pMag->cRounds++] = pvObj;
+        return true;
+    }
+
+    /*
+     * Both are full (or missing), exchange the previous one for an empty one.
+     */
+    rtMemCacheDepotEnter(pThis);
+    pMag = pThis->pDepotEmpty;
+    if (pMag)
+    {
+        pThis->pDepotEmpty = pMag->pNext;
+        pThis->cDepotEmpty--;
+    }
+    else
+        pMag = (PRTMEMCACHEMAG)RTMemAlloc(sizeof(*pMag));
+    if (pMag)
+    {
+        pMag->pNext   = NULL;
+        pMag->cRounds = 0;
+        if (pSlot->s.pPrevious)
+        {
+            pSlot->s.pPrevious->pNext = pThis->pDepotFull;
+            pThis->pDepotFull = pSlot->s.pPrevious;
+            pThis->cDepotFull++;
+        }
+        pSlot->s.pPrevious = pSlot->s.pLoaded;
+        pSlot->s.pLoaded   = pMag;
+        pThis->cDepotExchanges++;
+    }
+    rtMemCacheDepotLeave(pThis);
+    if (pMag)
+    {
+        pMag->apvRounds[pMag->cRounds++] = pvObj;
+        return true;
+    }
+    return false;
+}
+
+
+/**
+ * Returns all objects held by the magazine layer to the page level.
+ *
+ * This is used when the page level runs out of objects so that the
+ * cMaxObjects limit keeps working as before.
+ *
+ * @param   pThis               The memory cache.
+ */
+static void rtMemCachePurge(RTMEMCACHEINT *pThis)
+{
+    for (uint32_t iSlot = 0; iSlot <= pThis->fSlotMask; iSlot++)
+    {
+        PRTMEMCACHESLOT pSlot = &pThis->paSlots[iSlot];
+        while (!ASMAtomicCmpXchgU32(&pSlot->s.fBusy, 1, 0))
+            ASMNopPause();
+        rtMemCacheMagEmpty(pThis, pSlot->s.pLoaded);
+        rtMemCacheMagEmpty(pThis, pSlot->s.pPrevious);
+        ASMAtomicWriteU32(&pSlot->s.fBusy, 0);
+    }
+
+    RTCritSectEnter(&pThis->DepotCritSect);
+    while (pThis->pDepotFull)
+    {
+        PRTMEMCACHEMAG pMag = pThis->pDepotFull;
+        pThis->pDepotFull = pMag->pNext;
+        rtMemCacheMagEmpty(pThis, pMag);
+        pMag->pNext = pThis->pDepotEmpty;
+        pThis->pDepotEmpty = pMag;
+        pThis->cDepotEmpty++;
+    }
+    pThis->cDepotFull    = 0;
+    pThis->cDepotFullMin = 0;
+    RTCritSectLeave(&pThis->DepotCritSect);
+}
+
+
+RTDECL(int) RTMemCacheAllocEx(RTMEMCACHE hMemCache, void **ppvObj)
+{
+    RTMEMCACHEINT *pThis = hMemCache;
+    AssertPtrReturn(pThis, VERR_INVALID_PARAMETER);
+    AssertReturn(pThis->u32Magic == RTMEMCACHE_MAGIC, VERR_INVALID_PARAMETER);
+
+    if (!pThis->paSlots)
+        return rtMemCacheAllocSlab(pThis, ppvObj);
+
+    /*
+     * Try the magazines first.
+     */
+    uint32_t        idxSlot;
+    PRTMEMCACHESLOT pSlot = rtMemCacheSlotAcquire(pThis, &idxSlot);
+    if (pSlot)
+    {
+        void *pvObj = rtMemCacheMagAlloc(pThis, pSlot);
+        if (pvObj)
+            pSlot->s.cAllocHits++;
+        else
+            pSlot->s.cAllocMisses++;
+        ASMAtomicWriteU32(&pSlot->s.fBusy, 0);
+        if (pvObj)
+        {
+            *ppvObj = pvObj;
+            return VINF_SUCCESS;
+        }
+    }
+
+    /*
+     * Go to the page level, purging the magazines if it's exhausted.
+     */
+    int rc = rtMemCacheAllocSlab(pThis, ppvObj);
+    if (rc == VERR_MEM_CACHE_MAX_SIZE)
+    {
+        rtMemCachePurge(pThis);
+        rc = rtMemCacheAllocSlab(pThis, ppvObj);
+    }
+    return rc;
+}
+
+
+RTDECL(void) RTMemCacheFree(RTMEMCACHE hMemCache, void *pvObj)
+{
+    if (!pvObj)
+        return;
+
+    RTMEMCACHEINT *pThis = hMemCache;
+    AssertPtrReturnVoid(pThis);
+    AssertReturnVoid(pThis->u32Magic == RTMEMCACHE_MAGIC);
+
+    AssertPtr(pvObj);
+    Assert(RT_ALIGN_P(pvObj, pThis->cbAlignment) == pvObj);
+
+    if (pThis->paSlots)
+    {
+        uint32_t        idxSlot;
+        PRTMEMCACHESLOT pSlot = rtMemCacheSlotAcquire(pThis, &idxSlot);
+        if (pSlot)
+        {
+            PRTMEMCACHEPAGE pPage = (PRTMEMCACHEPAGE)(((uintptr_t)pvObj) & ~(uintptr_t)PAGE_OFFSET_MASK);
+            Assert(pPage->pCache == pThis);
+            if (pPage->idxHomeSlot != idxSlot)
+                pSlot->s.cRemoteFrees++;
+
+            bool const fTaken = rtMemCacheMagFree(pThis, pSlot, pvObj);
+            if (fTaken)
+                pSlot->s.cFreeHits++;
+            else
+                pSlot->s.cFreeMisses++;
+            ASMAtomicWriteU32(&pSlot->s.fBusy, 0);
+            if (fTaken)
+                return;
+        }
+    }
+
+    rtMemCacheFreeSlab(pThis, pvObj);
+}
+
+
+RTDECL(int) RTMemCacheQueryStats(RTMEMCACHE hMemCache, PRTMEMCACHESTATS pStats)
+{
+    RTMEMCACHEINT *pThis = hMemCache;
+    AssertPtrReturn(pThis, VERR_INVALID_HANDLE);
+    AssertReturn(pThis->u32Magic == RTMEMCACHE_MAGIC, VERR_INVALID_HANDLE);
+    AssertPtrReturn(pStats, VERR_INVALID_POINTER);
+
+    RT_ZERO(*pStats);
+    pStats->cObjects        = ASMAtomicReadU32(&pThis->cTotal);
+    pStats->cFreeObjects    = (uint32_t)RT_MAX(ASMAtomicReadS32(&pThis->cFree), 0);
+    if (pThis->paSlots)
+    {
+        pStats->cMagazineRounds  = pThis->cMagRounds;
+        pStats->cDepotFull       = pThis->cDepotFull;
+        pStats->cDepotEmpty      = pThis->cDepotEmpty;
+        pStats->cSlotCollisions  = pThis->cSlotCollisions;
+        pStats->cDepotExchanges  = pThis->cDepotExchanges;
+        pStats->cDepotContention = pThis->cDepotContention;
+        pStats->cDepotTrims      = pThis->cDepotTrims;
+        for (uint32_t iSlot = 0; iSlot <= pThis->fSlotMask; iSlot++)
+        {
+            PRTMEMCACHESLOT pSlot = &pThis->paSlots[iSlot];
+            pStats->cAllocHits   += pSlot->s.cAllocHits;
+            pStats->cAllocMisses += pSlot->s.cAllocMisses;
+            pStats->cFreeHits    += pSlot->s.cFreeHits;
+            pStats->cFreeMisses  += pSlot->s.cFreeMisses;
+            pStats->cRemoteFrees += pSlot->s.cRemoteFrees;
+        }
+    }
+    return VINF_SUCCESS;
+}
+
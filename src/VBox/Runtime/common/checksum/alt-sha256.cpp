@@ -43,6 +43,25 @@
 #include <iprt/assert.h>
 #include <iprt/asm.h>
 #include <iprt/string.h>
+#if defined(RT_ARCH_AMD64) || defined(RT_ARCH_X86)
+# include <iprt/asm-amd64-x86.h>
+# include <iprt/x86.h>
+#endif
+
+/** @def RTSHA256_WITH_SHANI
+ * Use the SHA extensions (SHA-NI) in ring-3 where the vector register state is
+ * ours to use.  Selected at runtime based on CPUID. */
+#if    defined(IN_RING3) \
+    && (defined(RT_ARCH_AMD64) || defined(RT_ARCH_X86)) \
+    && ((defined(_MSC_VER) && _MSC_VER >= 1900) || RT_GNUC_PREREQ(4, 9) || defined(__clang__))
+# define RTSHA256_WITH_SHANI
+# include <immintrin.h>
+# if defined(_MSC_VER)
+#  define RTSHA256_TARGET_SHANI
+# else
+#  define RTSHA256_TARGET_SHANI     __attribute__((__target__("sha,sse4.1")))
+# endif
+#endif
 
 
 /** Our private context structure. */
@@ -67,10 +86,33 @@ AssertCompile(RT_SIZEOFMEMB(RTSHA256CONTEXT, abPadding) >= RT_SIZEOFMEMB(RTSHA25
 AssertCompileMemberSize(RTSHA256ALTPRIVATECTX, auH, RTSHA256_HASH_SIZE);
 
 
+/*********************************************************************************************************************************
+*   Structures and Typedefs                                                                                                      *
+*********************************************************************************************************************************/
+/**
+ * Processes whole blocks.
+ *
+ * @param   pCtx                The SHA-256 context.
+ * @param   pbBlocks            The blocks, no alignment requirements.
+ * @param   cBlocks             The number of blocks.
+ */
+typedef void FNRTSHA256BLOCKS(PRTSHA256CONTEXT pCtx, uint8_t const *pbBlocks, size_t cBlocks);
+/** Pointer to a block processing worker. */
+typedef FNRTSHA256BLOCKS *PFNRTSHA256BLOCKS;
+
+
+/*********************************************************************************************************************************
+*   Internal Functions                                                                                                           *
+*********************************************************************************************************************************/
+#ifdef RTSHA256_WITH_SHANI
+static FNRTSHA256BLOCKS rtSha256BlocksResolve;
+#endif
+
+
 /*********************************************************************************************************************************
 *   Global Variables                                                                                                             *
 *********************************************************************************************************************************/
-#ifndef RTSHA256_UNROLLED
+#if !defined(RTSHA256_UNROLLED) || defined(RTSHA256_WITH_SHANI)
 /** The K constants */
 static uint32_t const g_auKs[] =
 {
@@ -91,7 +133,12 @@ static uint32_t const g_auKs[] =
     UINT32_C(0x748f82ee), UINT32_C(0x78a5636f), UINT32_C(0x84c87814), UINT32_C(0x8cc70208),
     UINT32_C(0x90befffa), UINT32_C(0xa4506ceb), UINT32_C(0xbef9a3f7), UINT32_C(0xc67178f2),
 };
-#endif /* !RTSHA256_UNROLLED */
+#endif /* !RTSHA256_UNROLLED || RTSHA256_WITH_SHANI */
+
+#ifdef RTSHA256_WITH_SHANI
+/** The block processing worker, resolved on first use. */
+static PFNRTSHA256BLOCKS volatile g_pfnRTSha256Blocks = rtSha256BlocksResolve;
+#endif
 
 
 
@@ -458,6 +505,141 @@ static void rtSha256BlockProcess(PRTSHA256CONTEXT pCtx)
 }
 
 
+/**
+ * Processes whole blocks, portable version.
+ */
+static void rtSha256BlocksGeneric(PRTSHA256CONTEXT pCtx, uint8_t const *pbBlocks, size_t cBlocks)
+{
+    if (pbBlocks == (uint8_t const *)&pCtx->AltPrivate.auW[0])
+    {
+        /* The block buffered in the context. */
+        Assert(cBlocks == 1);
+        rtSha256BlockInitBuffered(pCtx);
+        rtSha256BlockProcess(pCtx);
+    }
+    else if (!((uintptr_t)pbBlocks & (sizeof(void *) - 1)))
+    {
+        for (; cBlocks > 0; cBlocks--, pbBlocks += RTSHA256_BLOCK_SIZE)
+        {
+            rtSha256BlockInit(pCtx, pbBlocks);
+            rtSha256BlockProcess(pCtx);
+        }
+    }
+    else
+    {
+        /* Unaligned input, so buffer it. */
+        for (; cBlocks > 0; cBlocks--, pbBlocks += RTSHA256_BLOCK_SIZE)
+        {
+            memcpy((uint8_t *)&pCtx->AltPrivate.auW[0], pbBlocks, RTSHA256_BLOCK_SIZE);
+            rtSha256BlockInitBuffered(pCtx);
+            rtSha256BlockProcess(pCtx);
+        }
+    }
+}
+
+
+#ifdef RTSHA256_WITH_SHANI
+/**
+ * Processes whole blocks using the SHA extensions.
+ *
+ * The sha256rnds2 instruction does two rounds and wants the state split into
+ * ABEF and CDGH halves.  The message schedule for four rounds at a time is
+ * done by sha256msg1 (W[t-16] + sigma0(W[t-15])), an add of W[t-7] and
+ * sha256msg2 (+ sigma1(W[t-2])).
+ */
+RTSHA256_TARGET_SHANI
+static void rtSha256BlocksShaNi(PRTSHA256CONTEXT pCtx, uint8_t const *pbBlocks, size_t cBlocks)
+{
+    __m128i const uBSwapMask = _mm_set_epi64x(UINT64_C(0x0c0d0e0f08090a0b), UINT64_C(0x0405060700010203));
+
+    /* DCBA, HGFE -> ABEF, CDGH */
+    __m128i uTmp    = _mm_shuffle_epi32(_mm_loadu_si128((__m128i const *)&pCtx->AltPrivate.auH[0]), 0xb1);
+    __m128i uState1 = _mm_shuffle_epi32(_mm_loadu_si128((__m128i const *)&pCtx->AltPrivate.auH[4]), 0x1b);
+    __m128i uState0 = _mm_alignr_epi8(uTmp, uState1, 8);
+    uState1 = _mm_blend_epi16(uState1, uTmp, 0xf0);
+
+    for (; cBlocks > 0; cBlocks--, pbBlocks += RTSHA256_BLOCK_SIZE)
+    {
+        __m128i const uSaveAbef = uState0;
+        __m128i const uSaveCdgh = uState1;
+        __m128i       auMsg[4];
+        for (unsigned iQuad = 0; iQuad < 16; iQuad++)
+        {
+            __m128i uW;
+            if (iQuad < 4)
+                uW = _mm_shuffle_epi8(_mm_loadu_si128((__m128i const *)&pbBlocks[iQuad * 16]), uBSwapMask);
+            else
+            {
+                uW = _mm_sha256msg1_epu32(auMsg[iQuad & 3], auMsg[(iQuad + 1) & 3]);
+                uW = _mm_add_epi32(uW, _mm_alignr_epi8(auMsg[(iQuad + 3) & 3], auMsg[(iQuad + 2) & 3], 4));
+                uW = _mm_sha256msg2_epu32(uW, auMsg[(iQuad + 3) & 3]);
+            }
+            auMsg[iQuad & 3] = uW;
+
+            __m128i uWK = _mm_add_epi32(uW, _mm_loadu_si128((__m128i const *)&g_auKs[iQuad * 4]));
+            uState1 = _mm_sha256rnds2_epu32(uState1, uState0, uWK);
+            uWK     = _mm_shuffle_epi32(uWK, 0x0e);
+            uState0 = _mm_sha256rnds2_epu32(uState0, uState1, uWK);
+        }
+        uState0 = _mm_add_epi32(uState0, uSaveAbef);
+        uState1 = _mm_add_epi32(uState1, uSaveCdgh);
+    }
+
+    /* ABEF, CDGH -> DCBA, HGFE */
+    uTmp    = _mm_shuffle_epi32(uState0, 0x1b);
+    uState1 = _mm_shuffle_epi32(uState1, 0xb1);
+    uState0 = _mm_blend_epi16(uTmp, uState1, 0xf0);
+    uState1 = _mm_alignr_epi8(uState1, uTmp, 8);
+    _mm_storeu_si128((__m128i *)&pCtx->AltPrivate.auH[0], uState0);
+    _mm_storeu_si128((__m128i *)&pCtx->AltPrivate.auH[4], uState1);
+}
+
+
+/**
+ * Picks the best block processing worker for this CPU, then calls it.
+ */
+static void rtSha256BlocksResolve(PRTSHA256CONTEXT pCtx, uint8_t const *pbBlocks, size_t cBlocks)
+{
+    PFNRTSHA256BLOCKS pfn = rtSha256BlocksGeneric;
+    if (ASMHasCpuId())
+    {
+        uint32_t uMaxStd, uEax, uEbx, uEcx, uEdx;
+        ASMCpuId(0, &uMaxStd, &uEbx, &uEcx, &uEdx);
+        ASMCpuId(1, &uEax, &uEbx, &uEcx, &uEdx);
+        if (   ASMIsValidStdRange(uMaxStd)
+            && uMaxStd >= 7
+            && (uEcx & (X86_CPUID_FEATURE_ECX_SSSE3 | X86_CPUID_FEATURE_ECX_SSE4_1))
+                    == (X86_CPUID_FEATURE_ECX_SSSE3 | X86_CPUID_FEATURE_ECX_SSE4_1))
+        {
+            uint32_t uEax7, uEbx7, uEcx7, uEdx7;
+            ASMCpuId_Idx_ECX(7, 0, &uEax7, &uEbx7, &uEcx7, &uEdx7);
+            if (uEbx7 & X86_CPUID_STEXT_FEATURE_EBX_SHA)
+                pfn = rtSha256BlocksShaNi;
+        }
+    }
+    ASMAtomicWritePtr(&g_pfnRTSha256Blocks, pfn);
+    pfn(pCtx, pbBlocks, cBlocks);
+}
+#endif /* RTSHA256_WITH_SHANI */
+
+
+/**
+ * Processes whole blocks using the best worker for this CPU.
+ *
+ * @param   pCtx                The SHA-256 context.
+ * @param   pbBlocks            The blocks.
+ * @param   cBlocks             The number of blocks.
+ */
+DECLINLINE(void) rtSha256Blocks(PRTSHA256CONTEXT pCtx, uint8_t const *pbBlocks, size_t cBlocks)
+{
+#ifdef RTSHA256_WITH_SHANI
+    g_pfnRTSha256Blocks(pCtx, pbBlocks, cBlocks);
+#else
+    rtSha256BlocksGeneric(pCtx, pbBlocks, cBlocks);
+#endif
+}
+
+
 RTDECL(void) RTSha256Update(PRTSHA256CONTEXT pCtx, const void *pvBuf, size_t cbBuf)
 {
     Assert(pCtx->AltPrivate.cbMessage < UINT64_MAX / 8);
@@ -477,8 +659,7 @@ RTDECL(void) RTSha256Update(PRTSHA256CONTEXT pCtx, const void *pvBuf, size_t cbB
             pbBuf += cbMissing;
             cbBuf -= cbMissing;
 
-            rtSha256BlockInitBuffered(pCtx);
-            rtSha256BlockProcess(pCtx);
+            rtSha256Blocks(pCtx, (uint8_t const *)&pCtx->AltPrivate.auW[0], 1);
         }
         else
         {
@@ -488,36 +669,17 @@ RTDECL(void) RTSha256Update(PRTSHA256CONTEXT pCtx, const void *pvBuf, size_t cbB
         }
     }
 
-    if (!((uintptr_t)pbBuf & (sizeof(void *) - 1)))
-    {
-        /*
-         * Process full blocks directly from the input buffer.
-         */
-        while (cbBuf >= RTSHA256_BLOCK_SIZE)
-        {
-            rtSha256BlockInit(pCtx, pbBuf);
-            rtSha256BlockProcess(pCtx);
-
-            pCtx->AltPrivate.cbMessage += RTSHA256_BLOCK_SIZE;
-            pbBuf += RTSHA256_BLOCK_SIZE;
-            cbBuf -= RTSHA256_BLOCK_SIZE;
-        }
-    }
-    else
+    /*
+     * Process full blocks directly from the input buffer.
+     */
+    if (cbBuf >= RTSHA256_BLOCK_SIZE)
     {
-        /*
-         * Unaligned input, so buffer it.
-         */
-        while (cbBuf >= RTSHA256_BLOCK_SIZE)
-        {
-            memcpy((uint8_t *)&pCtx->AltPrivate.auW[0], pbBuf, RTSHA256_BLOCK_SIZE);
-            rtSha256BlockInitBuffered(pCtx);
-            rtSha256BlockProcess(pCtx);
+        size_t const cBlocks = cbBuf / RTSHA256_BLOCK_SIZE;
+        rtSha256Blocks(pCtx, pbBuf, cBlocks);
 
-            pCtx->AltPrivate.cbMessage += RTSHA256_BLOCK_SIZE;
-            pbBuf += RTSHA256_BLOCK_SIZE;
-            cbBuf -= RTSHA256_BLOCK_SIZE;
-        }
+        pCtx->AltPrivate.cbMessage += cBlocks * RTSHA256_BLOCK_SIZE;
+        pbBuf += cBlocks * RTSHA256_BLOCK_SIZE;
+        cbBuf -= cBlocks * RTSHA256_BLOCK_SIZE;
     }
 
     /*
@@ -566,8 +728,7 @@ static void rtSha256FinalInternal(PRTSHA256CONTEXT pCtx)
     /*
      * Process the last buffered block constructed/completed above.
      */
-    rtSha256BlockInitBuffered(pCtx);
-    rtSha256BlockProcess(pCtx);
+    rtSha256Blocks(pCtx, (uint8_t const *)&pCtx->AltPrivate.auW[0], 1);
 
     /*
      * Convert the byte order of the hash words and we're done.
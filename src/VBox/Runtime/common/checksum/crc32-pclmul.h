@@ -0,0 +1,159 @@
+/* $Id$ */
+/** @file
+ * IPRT - CRC32, PCLMULQDQ folding worker shared by crc32.cpp and crc32-zlib.cpp.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+#ifndef ___common_checksum_crc32_pclmul_h
+#define ___common_checksum_crc32_pclmul_h
+
+#include <iprt/types.h>
+#include <iprt/assert.h>
+
+/** @def RTCRC32_WITH_PCLMUL
+ * Fold the data with PCLMULQDQ in ring-3 where the vector register state is
+ * ours to use.  The caller selects it at runtime using rtCrc32PclmulIsUsable. */
+#if    defined(IN_RING3) \
+    && (defined(RT_ARCH_AMD64) || defined(RT_ARCH_X86)) \
+    && (defined(_MSC_VER) || RT_GNUC_PREREQ(4, 9) || defined(__clang__))
+# define RTCRC32_WITH_PCLMUL
+# include <iprt/asm-amd64-x86.h>
+# include <iprt/x86.h>
+# include <smmintrin.h>
+# include <wmmintrin.h>
+# if defined(_MSC_VER)
+#  define RTCRC32_TARGET_PCLMUL
+# else
+#  define RTCRC32_TARGET_PCLMUL     __attribute__((__target__("sse4.1,pclmul")))
+# endif
+
+/** The minimum number of bytes rtCrc32ProcessPclmul can deal with. */
+# define RTCRC32_PCLMUL_MIN         64
+
+
+/**
+ * Checks whether the CPU has the instructions rtCrc32ProcessPclmul uses.
+ */
+static bool rtCrc32PclmulIsUsable(void)
+{
+    if (ASMHasCpuId())
+    {
+        uint32_t uEax, uEbx, uEcx, uEdx;
+        ASMCpuId(1, &uEax, &uEbx, &uEcx, &uEdx);
+        return (uEcx & (X86_CPUID_FEATURE_ECX_SSE4_1 | X86_CPUID_FEATURE_ECX_PCLMUL))
+            == (X86_CPUID_FEATURE_ECX_SSE4_1 | X86_CPUID_FEATURE_ECX_PCLMUL);
+    }
+    return false;
+}
+
+
+/**
+ * Folds whole 16 byte blocks into the CRC32 state using PCLMULQDQ.
+ *
+ * This is the method described in Intel's "Fast CRC Computation for Generic
+ * Polynomials Using PCLMULQDQ Instruction": four 128-bit accumulators are
+ * folded forward by 512 bits per iteration, then folded into one, reduced to
+ * 64 bits and finally Barrett reduced to 32 bits.  The constants are for the
+ * bit reflected 0x04c11db7 polynomial.
+ *
+ * @returns The updated CRC32 state (not finalized).
+ * @param   uCrc32      The current CRC32 state (not finalized).
+ * @param   pb          The data.
+ * @param   cb          Number of bytes, at least RTCRC32_PCLMUL_MIN and a
+ *                      multiple of 16.
+ */
+RTCRC32_TARGET_PCLMUL
+static uint32_t rtCrc32ProcessPclmul(uint32_t uCrc32, uint8_t const *pb, size_t cb)
+{
+    /* x^(4*128+32) and x^(4*128-32) mod P, for folding 512 bits at a time. */
+    __m128i const uK1K2 = _mm_set_epi64x(UINT64_C(0x01c6e41596), UINT64_C(0x0154442bd4));
+    /* x^(128+32) and x^(128-32) mod P, for folding 128 bits at a time. */
+    __m128i const uK3K4 = _mm_set_epi64x(UINT64_C(0x00ccaa009e), UINT64_C(0x01751997d0));
+    /* x^64 mod P, for the 96 to 64 bit step. */
+    __m128i const uK5   = _mm_set_epi64x(0, UINT64_C(0x0163cd6124));
+    /* P and the Barrett constant u = floor(x^64 / P). */
+    __m128i const uPoly = _mm_set_epi64x(UINT64_C(0x01f7011641), UINT64_C(0x01db710641));
+    __m128i const uMask = _mm_setr_epi32(~0, 0, ~0, 0);
+    Assert(cb >= RTCRC32_PCLMUL_MIN && !(cb & 15));
+
+    __m128i uX1 = _mm_loadu_si128((__m128i const *)&pb[0x00]);
+    __m128i uX2 = _mm_loadu_si128((__m128i const *)&pb[0x10]);
+    __m128i uX3 = _mm_loadu_si128((__m128i const *)&pb[0x20]);
+    __m128i uX4 = _mm_loadu_si128((__m128i const *)&pb[0x30]);
+    uX1 = _mm_xor_si128(uX1, _mm_cvtsi32_si128((int)uCrc32));
+    pb += 64;
+    cb -= 64;
+
+    while (cb >= 64)
+    {
+        __m128i const uT1 = _mm_clmulepi64_si128(uX1, uK1K2, 0x00);
+        __m128i const uT2 = _mm_clmulepi64_si128(uX2, uK1K2, 0x00);
+        __m128i const uT3 = _mm_clmulepi64_si128(uX3, uK1K2, 0x00);
+        __m128i const uT4 = _mm_clmulepi64_si128(uX4, uK1K2, 0x00);
+        uX1 = _mm_clmulepi64_si128(uX1, uK1K2, 0x11);
+        uX2 = _mm_clmulepi64_si128(uX2, uK1K2, 0x11);
+        uX3 = _mm_clmulepi64_si128(uX3, uK1K2, 0x11);
+        uX4 = _mm_clmulepi64_si128(uX4, uK1K2, 0x11);
+        uX1 = _mm_xor_si128(_mm_xor_si128(uX1, uT1), _mm_loadu_si128((__m128i const *)&pb[0x00]));
+        uX2 = _mm_xor_si128(_mm_xor_si128(uX2, uT2), _mm_loadu_si128((__m128i const *)&pb[0x10]));
+        uX3 = _mm_xor_si128(_mm_xor_si128(uX3, uT3), _mm_loadu_si128((__m128i const *)&pb[0x20]));
+        uX4 = _mm_xor_si128(_mm_xor_si128(uX4, uT4), _mm_loadu_si128((__m128i const *)&pb[0x30]));
+        pb += 64;
+        cb -= 64;
+    }
+
+    /* Fold the four accumulators into one. */
+    __m128i uT = _mm_clmulepi64_si128(uX1, uK3K4, 0x00);
+    uX1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(uX1, uK3K4, 0x11), uT), uX2);
+    uT  = _mm_clmulepi64_si128(uX1, uK3K4, 0x00);
+    uX1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(uX1, uK3K4, 0x11), uT), uX3);
+    uT  = _mm_clmulepi64_si128(uX1, uK3K4, 0x00);
+    uX1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(uX1, uK3K4, 0x11), uT), uX4);
+
+    /* Fold in any remaining 16 byte blocks. */
+    while (cb >= 16)
+    {
+        uT  = _mm_clmulepi64_si128(uX1, uK3K4, 0x00);
+        uX1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(uX1, uK3K4, 0x11), uT),
+                            _mm_loadu_si128((__m128i const *)pb));
+        pb += 16;
+        cb -= 16;
+    }
+
+    /* 128 -> 64 bits. */
+    uT  = _mm_clmulepi64_si128(uX1, uK3K4, 0x10);
+    uX1 = _mm_xor_si128(_mm_srli_si128(uX1, 8), uT);
+    uT  = _mm_srli_si128(uX1, 4);
+    uX1 = _mm_xor_si128(_mm_clmulepi64_si128(_mm_and_si128(uX1, uMask), uK5, 0x00), uT);
+
+    /* Barrett reduction to 32 bits. */
+    uT  = _mm_clmulepi64_si128(_mm_and_si128(uX1, uMask), uPoly, 0x10);
+    uT  = _mm_clmulepi64_si128(_mm_and_si128(uT, uMask), uPoly, 0x00);
+    uX1 = _mm_xor_si128(uX1, uT);
+    return (uint32_t)_mm_extract_epi32(uX1, 1);
+}
+
+#endif /* RTCRC32_WITH_PCLMUL */
+
+#endif
+
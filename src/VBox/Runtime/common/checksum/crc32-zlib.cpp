@@ -31,10 +31,33 @@
 #include "internal/iprt.h"
 #include <iprt/crc.h>
 
+#include <iprt/asm.h>
+
 #include <zlib.h>
+#include "crc32-pclmul.h"
 
 /** @todo Check if we can't just use the zlib code directly here. */
 
+
+/**
+ * Processes data.
+ *
+ * @returns The updated CRC32 (zlib convention, i.e. finalized).
+ * @param   uCRC32      The current CRC32.
+ * @param   pv          The data.
+ * @param   cb          Number of bytes.
+ */
+typedef uint32_t FNRTCRC32PROCESS(uint32_t uCRC32, const void *pv, size_t cb);
+/** Pointer to a CRC32 worker. */
+typedef FNRTCRC32PROCESS *PFNRTCRC32PROCESS;
+
+#ifdef RTCRC32_WITH_PCLMUL
+static FNRTCRC32PROCESS rtCrc32ProcessResolve;
+/** The CRC32 worker, resolved on first use. */
+static PFNRTCRC32PROCESS volatile g_pfnRTCrc32Process = rtCrc32ProcessResolve;
+#endif
+
+
 /**
  * Deal with blocks that are too big for the uInt type.
  */
@@ -47,18 +70,58 @@ static uint32_t rtCrc32ProcessTooBig(uint32_t uCRC32, const void *pv, size_t cb)
         uCRC32 = crc32(uCRC32, pb, cbChunk);
         pb += cbChunk;
         cb -= cbChunk;
-    } while (!cb);
+    } while (cb);
     return uCRC32;
 }
 
-RTDECL(uint32_t) RTCrc32(const void *pv, register size_t cb)
+/**
+ * The zlib worker.
+ */
+static uint32_t rtCrc32ProcessZlib(uint32_t uCRC32, const void *pv, size_t cb)
 {
-    uint32_t uCrc = crc32(0, NULL, 0);
     if (RT_UNLIKELY((uInt)cb == cb))
-        uCrc = crc32(uCrc, (const Bytef *)pv, (uInt)cb);
+        uCRC32 = crc32(uCRC32, (const Bytef *)pv, (uInt)cb);
     else
-        uCrc = rtCrc32ProcessTooBig(uCrc, pv, cb);
-    return uCrc;
+        uCRC32 = rtCrc32ProcessTooBig(uCRC32, pv, cb);
+    return uCRC32;
+}
+
+
+#ifdef RTCRC32_WITH_PCLMUL
+/**
+ * PCLMULQDQ worker, folds the bulk and leaves the tail to zlib.
+ */
+static uint32_t rtCrc32ProcessWithPclmul(uint32_t uCRC32, const void *pv, size_t cb)
+{
+    if (cb >= RTCRC32_PCLMUL_MIN)
+    {
+        /* zlib hands out the finalized value, the folding works on the raw state. */
+        size_t const cbFold = cb & ~(size_t)15;
+        uCRC32 = ~rtCrc32ProcessPclmul(~uCRC32, (uint8_t const *)pv, cbFold);
+        pv  = (uint8_t const *)pv + cbFold;
+        cb -= cbFold;
+        if (!cb)
+            return uCRC32;
+    }
+    return rtCrc32ProcessZlib(uCRC32, pv, cb);
+}
+
+
+/**
+ * Picks the best CRC32 worker for this CPU, then calls it.
+ */
+static uint32_t rtCrc32ProcessResolve(uint32_t uCRC32, const void *pv, size_t cb)
+{
+    PFNRTCRC32PROCESS pfn = rtCrc32PclmulIsUsable() ? rtCrc32ProcessWithPclmul : rtCrc32ProcessZlib;
+    ASMAtomicWritePtr(&g_pfnRTCrc32Process, pfn);
+    return pfn(uCRC32, pv, cb);
+}
+#endif /* RTCRC32_WITH_PCLMUL */
+
+
+RTDECL(uint32_t) RTCrc32(const void *pv, register size_t cb)
+{
+    return RTCrc32Process(crc32(0, NULL, 0), pv, cb);
 }
 RT_EXPORT_SYMBOL(RTCrc32);
 
@@ -72,11 +135,11 @@ RT_EXPORT_SYMBOL(RTCrc32Start);
 
 RTDECL(uint32_t) RTCrc32Process(uint32_t uCRC32, const void *pv, size_t cb)
 {
-    if (RT_UNLIKELY((uInt)cb == cb))
-        uCRC32 = crc32(uCRC32, (const Bytef *)pv, (uInt)cb);
-    else
-        uCRC32 = rtCrc32ProcessTooBig(uCRC32, pv, cb);
-    return uCRC32;
+#ifdef RTCRC32_WITH_PCLMUL
+    return g_pfnRTCrc32Process(uCRC32, pv, cb);
+#else
+    return rtCrc32ProcessZlib(uCRC32, pv, cb);
+#endif
 }
 RT_EXPORT_SYMBOL(RTCrc32Process);
 
@@ -78,6 +78,28 @@ __FBSDID("$FreeBSD: src/sys/libkern/crc32.c,v 1.2 2003/06/11 05:23:04 obrien Exp
 # include "internal/iprt.h"
 #endif
 
+#include <iprt/asm.h>
+#include "crc32-pclmul.h"
+
+
+/**
+ * Processes data.
+ *
+ * @returns The updated CRC32 state (not finalized).
+ * @param   uCRC32      The current CRC32 state.
+ * @param   pb          The data.
+ * @param   cb          Number of bytes.
+ */
+typedef uint32_t FNRTCRC32PROCESS(uint32_t uCRC32, uint8_t const *pb, size_t cb);
+/** Pointer to a CRC32 worker. */
+typedef FNRTCRC32PROCESS *PFNRTCRC32PROCESS;
+
+#ifdef RTCRC32_WITH_PCLMUL
+static FNRTCRC32PROCESS rtCrc32ProcessResolve;
+/** The CRC32 worker, resolved on first use. */
+static PFNRTCRC32PROCESS volatile g_pfnRTCrc32Process = rtCrc32ProcessResolve;
+#endif
+
 #if 0
 uint32_t crc32_tab[] = {
 #else
@@ -150,13 +172,49 @@ crc32(const void *buf, size_t size)
 
 
 
-RTDECL(uint32_t) RTCrc32(const void *pv, size_t cb)
+/**
+ * Table driven worker.
+ */
+static uint32_t rtCrc32ProcessGeneric(uint32_t uCRC32, uint8_t const *pb, size_t cb)
 {
-    const uint8_t  *pu8 = (const uint8_t *)pv;
-    uint32_t        uCRC32 = ~0U;
     while (cb--)
-        uCRC32 = g_au32CRC32[(uCRC32 ^ *pu8++) & 0xff] ^ (uCRC32 >> 8);
-    return uCRC32 ^ ~0U;
+        uCRC32 = g_au32CRC32[(uCRC32 ^ *pb++) & 0xff] ^ (uCRC32 >> 8);
+    return uCRC32;
+}
+
+
+#ifdef RTCRC32_WITH_PCLMUL
+/**
+ * PCLMULQDQ worker, folds the bulk and leaves the tail to the table.
+ */
+static uint32_t rtCrc32ProcessWithPclmul(uint32_t uCRC32, uint8_t const *pb, size_t cb)
+{
+    if (cb >= RTCRC32_PCLMUL_MIN)
+    {
+        size_t const cbFold = cb & ~(size_t)15;
+        uCRC32 = rtCrc32ProcessPclmul(uCRC32, pb, cbFold);
+        pb += cbFold;
+        cb -= cbFold;
+    }
+    return rtCrc32ProcessGeneric(uCRC32, pb, cb);
+}
+
+
+/**
+ * Picks the best CRC32 worker for this CPU, then calls it.
+ */
+static uint32_t rtCrc32ProcessResolve(uint32_t uCRC32, uint8_t const *pb, size_t cb)
+{
+    PFNRTCRC32PROCESS pfn = rtCrc32PclmulIsUsable() ? rtCrc32ProcessWithPclmul : rtCrc32ProcessGeneric;
+    ASMAtomicWritePtr(&g_pfnRTCrc32Process, pfn);
+    return pfn(uCRC32, pb, cb);
+}
+#endif /* RTCRC32_WITH_PCLMUL */
+
+
+RTDECL(uint32_t) RTCrc32(const void *pv, size_t cb)
+{
+    return RTCrc32Process(~0U, pv, cb) ^ ~0U;
 }
 RT_EXPORT_SYMBOL(RTCrc32);
 
@@ -170,10 +228,11 @@ RT_EXPORT_SYMBOL(RTCrc32Start);
 
 RTDECL(uint32_t) RTCrc32Process(uint32_t uCRC32, const void *pv, size_t cb)
 {
-    const uint8_t  *pu8 = (const uint8_t *)pv;
-    while (cb--)
-        uCRC32 = g_au32CRC32[(uCRC32 ^ *pu8++) & 0xff] ^ (uCRC32 >> 8);
-    return uCRC32;
+#ifdef RTCRC32_WITH_PCLMUL
+    return g_pfnRTCrc32Process(uCRC32, (uint8_t const *)pv, cb);
+#else
+    return rtCrc32ProcessGeneric(uCRC32, (uint8_t const *)pv, cb);
+#endif
 }
 RT_EXPORT_SYMBOL(RTCrc32Process);
 
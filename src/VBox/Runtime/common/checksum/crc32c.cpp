@@ -24,9 +24,75 @@
  * terms and conditions of either the GPL or the CDDL or both.
  */
 
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
 #include <iprt/crc.h>
 #include "internal/iprt.h"
 
+#include <iprt/asm.h>
+#if defined(RT_ARCH_AMD64) || defined(RT_ARCH_X86)
+# include <iprt/asm-amd64-x86.h>
+# include <iprt/x86.h>
+#endif
+
+/** @def RTCRC32C_WITH_SSE42
+ * Use the SSE4.2 crc32 instruction in ring-3, selected at runtime based on
+ * CPUID.  On AMD64 three streams are interleaved to hide the instruction
+ * latency and merged using PCLMULQDQ when the CPU has it. */
+#if    defined(IN_RING3) \
+    && (defined(RT_ARCH_AMD64) || defined(RT_ARCH_X86)) \
+    && (defined(_MSC_VER) || RT_GNUC_PREREQ(4, 9) || defined(__clang__))
+# define RTCRC32C_WITH_SSE42
+# include <nmmintrin.h>
+# include <wmmintrin.h>
+# if defined(_MSC_VER)
+#  define RTCRC32C_TARGET_SSE42
+#  define RTCRC32C_TARGET_SSE42_PCLMUL
+# else
+#  define RTCRC32C_TARGET_SSE42         __attribute__((__target__("sse4.2")))
+#  define RTCRC32C_TARGET_SSE42_PCLMUL  __attribute__((__target__("sse4.2,pclmul")))
+# endif
+#endif
+
+
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** The block size of each of the three streams for large buffers. */
+#define RTCRC32C_LONG_BLOCK     8192
+/** The block size of each of the three streams for medium sized buffers. */
+#define RTCRC32C_SHORT_BLOCK    256
+
+
+/*********************************************************************************************************************************
+*   Structures and Typedefs                                                                                                      *
+*********************************************************************************************************************************/
+/**
+ * Processes data.
+ *
+ * @returns The updated CRC32C state (not finalized).
+ * @param   uCrc32C     The current CRC32C state.
+ * @param   pb          The data.
+ * @param   cb          Number of bytes.
+ */
+typedef uint32_t FNRTCRC32CPROCESS(uint32_t uCrc32C, uint8_t const *pb, size_t cb);
+/** Pointer to a CRC32C worker. */
+typedef FNRTCRC32CPROCESS *PFNRTCRC32CPROCESS;
+
+
+/*********************************************************************************************************************************
+*   Internal Functions                                                                                                           *
+*********************************************************************************************************************************/
+#ifdef RTCRC32C_WITH_SSE42
+static FNRTCRC32CPROCESS rtCrc32CProcessResolve;
+#endif
+
+
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
 /**
  * Generated using the pycrc tool using model crc-32c.
  */
@@ -77,6 +143,11 @@ static uint32_t const g_au32Crc32C[] =
     0xbe2da0a5, 0x4c4623a6, 0x5f16d052, 0xad7d5351
 };
 
+#ifdef RTCRC32C_WITH_SSE42
+/** The CRC32C worker, resolved on first use. */
+static PFNRTCRC32CPROCESS volatile g_pfnRTCrc32CProcess = rtCrc32CProcessResolve;
+#endif
+
 
 DECLINLINE(uint32_t) rtCrc32CProcessWithTable(const uint32_t *pau32Crc32,
                                               uint32_t uCrc32, const void *pv, size_t cb)
@@ -90,6 +161,150 @@ DECLINLINE(uint32_t) rtCrc32CProcessWithTable(const uint32_t *pau32Crc32,
 }
 
 
+/**
+ * Table driven worker.
+ */
+static uint32_t rtCrc32CProcessGeneric(uint32_t uCrc32C, uint8_t const *pb, size_t cb)
+{
+    return rtCrc32CProcessWithTable(g_au32Crc32C, uCrc32C, pb, cb);
+}
+
+
+#ifdef RTCRC32C_WITH_SSE42
+/**
+ * SSE4.2 worker, a single stream of crc32 instructions.
+ */
+RTCRC32C_TARGET_SSE42
+static uint32_t rtCrc32CProcessSse42(uint32_t uCrc32C, uint8_t const *pb, size_t cb)
+{
+    while (cb > 0 && ((uintptr_t)pb & 7))
+    {
+        uCrc32C = _mm_crc32_u8(uCrc32C, *pb++);
+        cb--;
+    }
+
+# ifdef RT_ARCH_AMD64
+    uint64_t uCrc64 = uCrc32C;
+    while (cb >= 8)
+    {
+        uCrc64 = _mm_crc32_u64(uCrc64, *(uint64_t const *)pb);
+        pb += 8;
+        cb -= 8;
+    }
+    uCrc32C = (uint32_t)uCrc64;
+# else
+    while (cb >= 4)
+    {
+        uCrc32C = _mm_crc32_u32(uCrc32C, *(uint32_t const *)pb);
+        pb += 4;
+        cb -= 4;
+    }
+# endif
+
+    while (cb-- > 0)
+        uCrc32C = _mm_crc32_u8(uCrc32C, *pb++);
+    return uCrc32C;
+}
+
+
+# ifdef RT_ARCH_AMD64
+/**
+ * Processes three consecutive blocks as independent streams and merges them.
+ *
+ * The crc32 instruction has a latency of three cycles but a throughput of one
+ * per cycle, so three streams keep the unit busy.  Merging multiplies the
+ * first two stream values by x^(8 * cbBlock * n) modulo the polynomial: a
+ * carry-less multiply with x^(8 * cbBlock * n - 33) followed by a crc32 of the
+ * 64-bit product, which accounts for the remaining 33 powers.
+ *
+ * @returns The updated CRC32C state.
+ * @param   uCrc32C     The CRC32C state at the start of the first block.
+ * @param   pb          The three blocks, 8 byte aligned.
+ * @param   cbBlock     The size of one block, a multiple of 8.
+ * @param   uK1         x^(8 * cbBlock - 33) mod P, bit reflected.
+ * @param   uK2         x^(16 * cbBlock - 33) mod P, bit reflected.
+ */
+RTCRC32C_TARGET_SSE42_PCLMUL
+DECLINLINE(uint32_t) rtCrc32CProcessThreeWay(uint32_t uCrc32C, uint8_t const *pb, size_t cbBlock, uint32_t uK1, uint32_t uK2)
+{
+    uint64_t const *pu64A  = (uint64_t const *)pb;
+    uint64_t const *pu64B  = (uint64_t const *)(pb + cbBlock);
+    uint64_t const *pu64C  = (uint64_t const *)(pb + cbBlock * 2);
+    size_t const    cQWords = cbBlock / 8;
+    uint64_t        uCrcA  = uCrc32C;
+    uint64_t        uCrcB  = 0;
+    uint64_t        uCrcC  = 0;
+    for (size_t i = 0; i < cQWords; i++)
+    {
+        uCrcA = _mm_crc32_u64(uCrcA, pu64A[i]);
+        uCrcB = _mm_crc32_u64(uCrcB, pu64B[i]);
+        uCrcC = _mm_crc32_u64(uCrcC, pu64C[i]);
+    }
+
+    __m128i const uK     = _mm_set_epi64x(uK1, uK2);
+    __m128i const uProdA = _mm_clmulepi64_si128(_mm_cvtsi64_si128((int64_t)uCrcA), uK, 0x00);
+    __m128i const uProdB = _mm_clmulepi64_si128(_mm_cvtsi64_si128((int64_t)uCrcB), uK, 0x10);
+    uint64_t const uProd = (uint64_t)_mm_cvtsi128_si64(_mm_xor_si128(uProdA, uProdB));
+    return (uint32_t)uCrcC ^ (uint32_t)_mm_crc32_u64(0, uProd);
+}
+
+
+/**
+ * SSE4.2 + PCLMULQDQ worker, three interleaved streams for larger buffers.
+ */
+RTCRC32C_TARGET_SSE42_PCLMUL
+static uint32_t rtCrc32CProcessSse42Pclmul(uint32_t uCrc32C, uint8_t const *pb, size_t cb)
+{
+    while (cb > 0 && ((uintptr_t)pb & 7))
+    {
+        uCrc32C = _mm_crc32_u8(uCrc32C, *pb++);
+        cb--;
+    }
+
+    while (cb >= RTCRC32C_LONG_BLOCK * 3)
+    {
+        uCrc32C = rtCrc32CProcessThreeWay(uCrc32C, pb, RTCRC32C_LONG_BLOCK, UINT32_C(0x54a86326), UINT32_C(0x1dc403cc));
+        pb += RTCRC32C_LONG_BLOCK * 3;
+        cb -= RTCRC32C_LONG_BLOCK * 3;
+    }
+
+    while (cb >= RTCRC32C_SHORT_BLOCK * 3)
+    {
+        uCrc32C = rtCrc32CProcessThreeWay(uCrc32C, pb, RTCRC32C_SHORT_BLOCK, UINT32_C(0xb9e02b86), UINT32_C(0xdd7e3b0c));
+        pb += RTCRC32C_SHORT_BLOCK * 3;
+        cb -= RTCRC32C_SHORT_BLOCK * 3;
+    }
+
+    return rtCrc32CProcessSse42(uCrc32C, pb, cb);
+}
+# endif /* RT_ARCH_AMD64 */
+
+
+/**
+ * Picks the best CRC32C worker for this CPU, then calls it.
+ */
+static uint32_t rtCrc32CProcessResolve(uint32_t uCrc32C, uint8_t const *pb, size_t cb)
+{
+    PFNRTCRC32CPROCESS pfn = rtCrc32CProcessGeneric;
+    if (ASMHasCpuId())
+    {
+        uint32_t uEax, uEbx, uEcx, uEdx;
+        ASMCpuId(1, &uEax, &uEbx, &uEcx, &uEdx);
+        if (uEcx & X86_CPUID_FEATURE_ECX_SSE4_2)
+        {
+            pfn = rtCrc32CProcessSse42;
+# ifdef RT_ARCH_AMD64
+            if (uEcx & X86_CPUID_FEATURE_ECX_PCLMUL)
+                pfn = rtCrc32CProcessSse42Pclmul;
+# endif
+        }
+    }
+    ASMAtomicWritePtr(&g_pfnRTCrc32CProcess, pfn);
+    return pfn(uCrc32C, pb, cb);
+}
+#endif /* RTCRC32C_WITH_SSE42 */
+
+
 RTDECL(uint32_t) RTCrc32CStart(void)
 {
     return ~0U;
@@ -108,7 +323,11 @@ RTDECL(uint32_t) RTCrc32C(const void *pv, size_t cb)
 {
     uint32_t uCrc32C = RTCrc32CStart();
 
-    uCrc32C = rtCrc32CProcessWithTable(g_au32Crc32C, uCrc32C, pv, cb);
+#ifdef RTCRC32C_WITH_SSE42
+    uCrc32C = g_pfnRTCrc32CProcess(uCrc32C, (uint8_t const *)pv, cb);
+#else
+    uCrc32C = rtCrc32CProcessGeneric(uCrc32C, (uint8_t const *)pv, cb);
+#endif
     return RTCrc32CFinish(uCrc32C);
 }
 RT_EXPORT_SYMBOL(RTCrc32C);
@@ -116,7 +335,11 @@ RT_EXPORT_SYMBOL(RTCrc32C);
 
 RTDECL(uint32_t) RTCrc32CProcess(uint32_t uCrc32C, const void *pv, size_t cb)
 {
-    return rtCrc32CProcessWithTable(g_au32Crc32C, uCrc32C, pv, cb);;
+#ifdef RTCRC32C_WITH_SSE42
+    return g_pfnRTCrc32CProcess(uCrc32C, (uint8_t const *)pv, cb);
+#else
+    return rtCrc32CProcessGeneric(uCrc32C, (uint8_t const *)pv, cb);
+#endif
 }
 RT_EXPORT_SYMBOL(RTCrc32CProcess);
 
@@ -33,6 +33,62 @@
 
 #include <iprt/asm.h>
 #include <iprt/assert.h>
+#include <iprt/string.h>
+#if defined(RT_ARCH_AMD64) || defined(RT_ARCH_X86)
+# include <iprt/asm-amd64-x86.h>
+# include <iprt/x86.h>
+#endif
+
+/** @def RTNETCSUM_WITH_SIMD
+ * Use SSE2/AVX2 for summing and copying data in ring-3 where the vector
+ * register state is ours to use.  Selected at runtime based on CPUID. */
+#if    defined(IN_RING3) \
+    && (defined(RT_ARCH_AMD64) || defined(RT_ARCH_X86)) \
+    && (defined(_MSC_VER) || RT_GNUC_PREREQ(4, 9) || defined(__clang__))
+# define RTNETCSUM_WITH_SIMD
+# include <emmintrin.h>
+# include <immintrin.h>
+# if defined(_MSC_VER)
+#  define RTNETCSUM_TARGET_SSE2
+#  define RTNETCSUM_TARGET_AVX2
+# else
+#  define RTNETCSUM_TARGET_SSE2     __attribute__((__target__("sse2")))
+#  define RTNETCSUM_TARGET_AVX2     __attribute__((__target__("avx2")))
+# endif
+#endif
+
+
+/*********************************************************************************************************************************
+*   Structures and Typedefs                                                                                                      *
+*********************************************************************************************************************************/
+/**
+ * Sums an even number of bytes as native endian words.
+ *
+ * @returns 64-bit sum, to be folded by the caller.
+ * @param   pbDst       Where to copy the data to, NULL if not copying.
+ * @param   pbSrc       The data.
+ * @param   cb          Number of bytes, must be even.
+ */
+typedef uint64_t FNRTNETCSUMBLOCKS(uint8_t *pbDst, uint8_t const *pbSrc, size_t cb);
+/** Pointer to a data summing worker. */
+typedef FNRTNETCSUMBLOCKS *PFNRTNETCSUMBLOCKS;
+
+
+/*********************************************************************************************************************************
+*   Internal Functions                                                                                                           *
+*********************************************************************************************************************************/
+#ifdef RTNETCSUM_WITH_SIMD
+static FNRTNETCSUMBLOCKS rtNetCSumBlocksResolve;
+#endif
+
+
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
+#ifdef RTNETCSUM_WITH_SIMD
+/** The data summing worker, resolved on first use. */
+static PFNRTNETCSUMBLOCKS volatile g_pfnRTNetCSumBlocks = rtNetCSumBlocksResolve;
+#endif
 
 
 /**
@@ -286,9 +342,184 @@ RT_EXPORT_SYMBOL(RTNetIPv4AddTCPChecksum);
 
 
 /**
- * Adds the checksum of the specified data segment to the intermediate checksum value [inlined].
+ * Sums an even number of bytes, portable version.
+ *
+ * 32-bit words are summed into a 64-bit accumulator where unaligned access is
+ * cheap; since 2^16 == 1 (mod 2^16-1) this yields the same ones' complement
+ * sum as adding up the 16-bit words one by one.
+ */
+static uint64_t rtNetCSumBlocksGeneric(uint8_t *pbDst, uint8_t const *pbSrc, size_t cb)
+{
+    uint64_t u64Sum = 0;
+    Assert(!(cb & 1));
+    if (pbDst)
+        memcpy(pbDst, pbSrc, cb);
+
+#if defined(RT_ARCH_AMD64) || defined(RT_ARCH_X86)
+    uint32_t const *pu32 = (uint32_t const *)pbSrc;
+    while (cb >= 16)
+    {
+        u64Sum += pu32[0];
+        u64Sum += pu32[1];
+        u64Sum += pu32[2];
+        u64Sum += pu32[3];
+        pu32 += 4;
+        cb   -= 16;
+    }
+    while (cb >= 4)
+    {
+        u64Sum += *pu32++;
+        cb     -= 4;
+    }
+    pbSrc = (uint8_t const *)pu32;
+#endif
+
+    uint16_t const *pu16 = (uint16_t const *)pbSrc;
+    while (cb >= 2)
+    {
+        u64Sum += *pu16++;
+        cb     -= 2;
+    }
+    return u64Sum;
+}
+
+
+#ifdef RTNETCSUM_WITH_SIMD
+/**
+ * Sums an even number of bytes, SSE2 version.
+ *
+ * The dwords are zero extended into 64-bit lanes so the accumulators cannot
+ * overflow for any realistic buffer size.
+ */
+RTNETCSUM_TARGET_SSE2
+static uint64_t rtNetCSumBlocksSse2(uint8_t *pbDst, uint8_t const *pbSrc, size_t cb)
+{
+    __m128i const uZero = _mm_setzero_si128();
+    __m128i       uAcc0 = _mm_setzero_si128();
+    __m128i       uAcc1 = _mm_setzero_si128();
+    size_t const  cbBlocks = cb & ~(size_t)31;
+    size_t        off;
+
+    if (pbDst)
+        for (off = 0; off < cbBlocks; off += 32)
+        {
+            __m128i const u0 = _mm_loadu_si128((__m128i const *)&pbSrc[off]);
+            __m128i const u1 = _mm_loadu_si128((__m128i const *)&pbSrc[off + 16]);
+            _mm_storeu_si128((__m128i *)&pbDst[off],      u0);
+            _mm_storeu_si128((__m128i *)&pbDst[off + 16], u1);
+            uAcc0 = _mm_add_epi64(uAcc0, _mm_unpacklo_epi32(u0, uZero));
+            uAcc1 = _mm_add_epi64(uAcc1, _mm_unpackhi_epi32(u0, uZero));
+            uAcc0 = _mm_add_epi64(uAcc0, _mm_unpacklo_epi32(u1, uZero));
+            uAcc1 = _mm_add_epi64(uAcc1, _mm_unpackhi_epi32(u1, uZero));
+        }
+    else
+        for (off = 0; off < cbBlocks; off += 32)
+        {
+            __m128i const u0 = _mm_loadu_si128((__m128i const *)&pbSrc[off]);
+            __m128i const u1 = _mm_loadu_si128((__m128i const *)&pbSrc[off + 16]);
+            uAcc0 = _mm_add_epi64(uAcc0, _mm_unpacklo_epi32(u0, uZero));
+            uAcc1 = _mm_add_epi64(uAcc1, _mm_unpackhi_epi32(u0, uZero));
+            uAcc0 = _mm_add_epi64(uAcc0, _mm_unpacklo_epi32(u1, uZero));
+            uAcc1 = _mm_add_epi64(uAcc1, _mm_unpackhi_epi32(u1, uZero));
+        }
+
+    uint64_t au64[2];
+    _mm_storeu_si128((__m128i *)&au64[0], _mm_add_epi64(uAcc0, uAcc1));
+    return au64[0] + au64[1]
+         + rtNetCSumBlocksGeneric(pbDst ? &pbDst[cbBlocks] : NULL, &pbSrc[cbBlocks], cb - cbBlocks);
+}
+
+
+/**
+ * Sums an even number of bytes, AVX2 version.
+ */
+RTNETCSUM_TARGET_AVX2
+static uint64_t rtNetCSumBlocksAvx2(uint8_t *pbDst, uint8_t const *pbSrc, size_t cb)
+{
+    __m256i const uZero = _mm256_setzero_si256();
+    __m256i       uAcc0 = _mm256_setzero_si256();
+    __m256i       uAcc1 = _mm256_setzero_si256();
+    size_t const  cbBlocks = cb & ~(size_t)63;
+    size_t        off;
+
+    if (pbDst)
+        for (off = 0; off < cbBlocks; off += 64)
+        {
+            __m256i const u0 = _mm256_loadu_si256((__m256i const *)&pbSrc[off]);
+            __m256i const u1 = _mm256_loadu_si256((__m256i const *)&pbSrc[off + 32]);
+            _mm256_storeu_si256((__m256i *)&pbDst[off],      u0);
+            _mm256_storeu_si256((__m256i *)&pbDst[off + 32], u1);
+            uAcc0 = _mm256_add_epi64(uAcc0, _mm256_unpacklo_epi32(u0, uZero));
+            uAcc1 = _mm256_add_epi64(uAcc1, _mm256_unpackhi_epi32(u0, uZero));
+            uAcc0 = _mm256_add_epi64(uAcc0, _mm256_unpacklo_epi32(u1, uZero));
+            uAcc1 = _mm256_add_epi64(uAcc1, _mm256_unpackhi_epi32(u1, uZero));
+        }
+    else
+        for (off = 0; off < cbBlocks; off += 64)
+        {
+            __m256i const u0 = _mm256_loadu_si256((__m256i const *)&pbSrc[off]);
+            __m256i const u1 = _mm256_loadu_si256((__m256i const *)&pbSrc[off + 32]);
+            uAcc0 = _mm256_add_epi64(uAcc0, _mm256_unpacklo_epi32(u0, uZero));
+            uAcc1 = _mm256_add_epi64(uAcc1, _mm256_unpackhi_epi32(u0, uZero));
+            uAcc0 = _mm256_add_epi64(uAcc0, _mm256_unpacklo_epi32(u1, uZero));
+            uAcc1 = _mm256_add_epi64(uAcc1, _mm256_unpackhi_epi32(u1, uZero));
+        }
+
+    uint64_t au64[4];
+    _mm256_storeu_si256((__m256i *)&au64[0], _mm256_add_epi64(uAcc0, uAcc1));
+    return au64[0] + au64[1] + au64[2] + au64[3]
+         + rtNetCSumBlocksSse2(pbDst ? &pbDst[cbBlocks] : NULL, &pbSrc[cbBlocks], cb - cbBlocks);
+}
+
+
+/**
+ * Picks the best data summing worker for this CPU, then calls it.
+ */
+static uint64_t rtNetCSumBlocksResolve(uint8_t *pbDst, uint8_t const *pbSrc, size_t cb)
+{
+    PFNRTNETCSUMBLOCKS pfn = rtNetCSumBlocksGeneric;
+    if (ASMHasCpuId())
+    {
+        uint32_t uMaxStd, uEax, uEbx, uEcx, uEdx;
+        ASMCpuId(0, &uMaxStd, &uEbx, &uEcx, &uEdx);
+        ASMCpuId(1, &uEax, &uEbx, &uEcx, &uEdx);
+        if (uEdx & X86_CPUID_FEATURE_EDX_SSE2)
+            pfn = rtNetCSumBlocksSse2;
+        if (   ASMIsValidStdRange(uMaxStd)
+            && uMaxStd >= 7
+            && (uEcx & X86_CPUID_FEATURE_ECX_OSXSAVE)
+            && (ASMGetXcr0() & (XSAVE_C_SSE | XSAVE_C_YMM)) == (XSAVE_C_SSE | XSAVE_C_YMM))
+        {
+            uint32_t uEax7, uEbx7, uEcx7, uEdx7;
+            ASMCpuId_Idx_ECX(7, 0, &uEax7, &uEbx7, &uEcx7, &uEdx7);
+            if (uEbx7 & X86_CPUID_STEXT_FEATURE_EBX_AVX2)
+                pfn = rtNetCSumBlocksAvx2;
+        }
+    }
+    ASMAtomicWritePtr(&g_pfnRTNetCSumBlocks, pfn);
+    return pfn(pbDst, pbSrc, cb);
+}
+#endif /* RTNETCSUM_WITH_SIMD */
+
+
+/**
+ * Folds a 64-bit sum into an intermediate 32-bit checksum value with end
+ * around carry.
+ */
+DECLINLINE(uint32_t) rtNetCSumFold64(uint64_t u64Sum)
+{
+    u64Sum = (u64Sum >> 32) + (u64Sum & UINT32_MAX);
+    u64Sum = (u64Sum >> 32) + (u64Sum & UINT32_MAX);
+    return (uint32_t)u64Sum;
+}
+
+
+/**
+ * Adds the checksum of the specified data segment to the intermediate checksum
+ * value, optionally copying it on the way [inlined].
  *
  * @returns 32-bit intermediary checksum value.
+ * @param   pvDst           Where to copy the data to, NULL if not copying.
  * @param   pvData          Pointer to the data that should be checksummed.
  * @param   cbData          The number of bytes to checksum.
  * @param   u32Sum          The 32-bit intermediate checksum value.
@@ -296,46 +527,70 @@ RT_EXPORT_SYMBOL(RTNetIPv4AddTCPChecksum);
  *                          when starting to checksum the data (aka text) after a TCP
  *                          or UDP header (data never start at an odd offset).
  */
-DECLINLINE(uint32_t) rtNetIPv4AddDataChecksum(void const *pvData, size_t cbData, uint32_t u32Sum, bool *pfOdd)
+DECLINLINE(uint32_t) rtNetIPv4AddDataChecksumWorker(void *pvDst, void const *pvData, size_t cbData, uint32_t u32Sum, bool *pfOdd)
 {
-    uint16_t const *pw = (uint16_t const *)pvData;
+    uint8_t const *pbSrc  = (uint8_t const *)pvData;
+    uint8_t       *pbDst  = (uint8_t *)pvDst;
+    uint64_t       u64Sum = u32Sum; /* the intermediate value may be close to UINT32_MAX */
+    if (!cbData)
+        return u32Sum;
+
     if (*pfOdd)
     {
 #ifdef RT_BIG_ENDIAN
         /* there was an odd byte in the previous chunk, add the lower byte. */
-        u32Sum += *(uint8_t *)pvData;
+        u64Sum += *pbSrc;
 #else
         /* there was an odd byte in the previous chunk, add the upper byte. */
-        u32Sum += (uint32_t)*(uint8_t *)pvData << 8;
+        u64Sum += (uint32_t)*pbSrc << 8;
 #endif
         /* skip the byte. */
+        if (pbDst)
+            *pbDst++ = *pbSrc;
+        pbSrc++;
         cbData--;
-        if (!cbData)
-            return u32Sum;
-        pvData = (uint8_t const *)pvData + 1;
     }
 
     /* iterate the data. */
-    while (cbData > 1)
-    {
-        u32Sum += *pw;
-        pw++;
-        cbData -= 2;
-    }
+    size_t const cbEven = cbData & ~(size_t)1;
+#ifdef RTNETCSUM_WITH_SIMD
+    u64Sum += g_pfnRTNetCSumBlocks(pbDst, pbSrc, cbEven);
+#else
+    u64Sum += rtNetCSumBlocksGeneric(pbDst, pbSrc, cbEven);
+#endif
 
     /* handle odd byte. */
-    if (cbData)
+    if (cbData & 1)
     {
+        if (pbDst)
+            pbDst[cbEven] = pbSrc[cbEven];
 #ifdef RT_BIG_ENDIAN
-        u32Sum += (uint32_t)*(uint8_t *)pw << 8;
+        u64Sum += (uint32_t)pbSrc[cbEven] << 8;
 #else
-        u32Sum += *(uint8_t *)pw;
+        u64Sum += pbSrc[cbEven];
 #endif
         *pfOdd = true;
     }
     else
         *pfOdd = false;
-    return u32Sum;
+    return rtNetCSumFold64(u64Sum);
+}
+
+
+/**
+ * Adds the checksum of the specified data segment to the intermediate checksum value [inlined].
+ *
+ * @returns 32-bit intermediary checksum value.
+ * @param   pvData          Pointer to the data that should be checksummed.
+ * @param   cbData          The number of bytes to checksum.
+ * @param   u32Sum          The 32-bit intermediate checksum value.
+ * @param   pfOdd           This is used to keep track of odd bits, initialize to false
+ *                          when starting to checksum the data (aka text) after a TCP
+ *                          or UDP header (data never start at an odd offset).
+ */
+DECLINLINE(uint32_t) rtNetIPv4AddDataChecksum(void const *pvData, size_t cbData, uint32_t u32Sum, bool *pfOdd)
+{
+    return rtNetIPv4AddDataChecksumWorker(NULL, pvData, cbData, u32Sum, pfOdd);
 }
 
 /**
@@ -356,6 +611,27 @@ RTDECL(uint32_t) RTNetIPv4AddDataChecksum(void const *pvData, size_t cbData, uin
 RT_EXPORT_SYMBOL(RTNetIPv4AddDataChecksum);
 
 
+/**
+ * Copies a data segment and adds its checksum to the intermediate checksum
+ * value in the same pass.
+ *
+ * @returns 32-bit intermediary checksum value.
+ * @param   pvDst           Where to copy the data to.  Must not overlap with
+ *                          @a pvSrc.
+ * @param   pvSrc           The data bits to copy and checksum.
+ * @param   cbData          The number of bytes to copy and checksum.
+ * @param   u32Sum          The 32-bit intermediate checksum value.
+ * @param   pfOdd           This is used to keep track of odd bits, see
+ *                          RTNetIPv4AddDataChecksum.
+ */
+RTDECL(uint32_t) RTNetIPv4AddDataChecksumAndCopy(void *pvDst, void const *pvSrc, size_t cbData, uint32_t u32Sum, bool *pfOdd)
+{
+    AssertPtr(pvDst);
+    return rtNetIPv4AddDataChecksumWorker(pvDst, pvSrc, cbData, u32Sum, pfOdd);
+}
+RT_EXPORT_SYMBOL(RTNetIPv4AddDataChecksumAndCopy);
+
+
 /**
  * Finalizes a IPv4 checksum [inlined].
  *
@@ -1797,7 +1797,7 @@ static int rtDbgModCvLoadDirectory(PRTDBGMODCV pThis)
          * Just sort the directory in a way we like, no need to make
          * complicated demands on the linker output.
          */
-        RTSortShell(pThis->paDirEnts, cDirEnts, sizeof(pThis->paDirEnts[0]), rtDbgModCvDirEntCmp, NULL);
+        RTSortIntro(pThis->paDirEnts, cDirEnts, sizeof(pThis->paDirEnts[0]), rtDbgModCvDirEntCmp, NULL);
 
         /*
          * Basic info validation.
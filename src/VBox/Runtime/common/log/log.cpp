@@ -88,6 +88,27 @@ AssertCompile(sizeof(RTLOG_RINGBUF_EYE_CATCHER) == 16);
 #define RTLOG_RINGBUF_EYE_CATCHER_END    "\0\0\0END RING BUF"
 AssertCompile(sizeof(RTLOG_RINGBUF_EYE_CATCHER_END) == 16);
 
+#ifdef IN_RING3
+/** The size of the per-thread binary log buffers (RTLOGFLAGS_BINARY), power of two. */
+# define RTLOGBIN_BUF_SIZE              _64K
+/** The max size of a single binary log record.  Larger ones are formatted
+ * immediately. */
+# define RTLOGBIN_REC_MAX               1024
+/** The max interval between two flusher thread runs (milliseconds). */
+# define RTLOGBIN_FLUSH_INTERVAL_MS     100
+/** RTLOGBINREC::cbRec value marking the end of the used part of the buffer,
+ * the next record starts at offset zero. */
+# define RTLOGBIN_REC_WRAP              UINT32_C(0)
+
+/** @name Binary logging initialization states (RTLOGGERINTERNAL::enmBinState).
+ * @{ */
+# define RTLOGBINSTATE_UNINITIALIZED    UINT32_C(0)
+# define RTLOGBINSTATE_INITIALIZING     UINT32_C(1)
+# define RTLOGBINSTATE_READY            UINT32_C(2)
+# define RTLOGBINSTATE_FAILED           UINT32_C(3)
+/** @} */
+#endif
+
 
 /*********************************************************************************************************************************
 *   Structures and Typedefs                                                                                                      *
@@ -103,8 +124,93 @@ typedef struct RTLOGOUTPUTPREFIXEDARGS
     unsigned                fFlags;
     /** The group. (used for prefixing.) */
     unsigned                iGroup;
+#ifdef IN_RING3
+    /** The binary log record being replayed, NULL if not replaying. (used for
+     * prefixing.) */
+    struct RTLOGBINREC const *pBinRec;
+    /** The buffer pBinRec lives in. */
+    struct RTLOGBINBUF const *pBinBuf;
+#endif
 } RTLOGOUTPUTPREFIXEDARGS, *PRTLOGOUTPUTPREFIXEDARGS;
 
+#ifdef IN_RING3
+/**
+ * Binary log record header (RTLOGFLAGS_BINARY).
+ *
+ * The header is followed by a zero terminated copy of the format string padded
+ * to a 64-bit boundary, as the flusher may format the record after the module
+ * owning the original string has been unloaded.  Then come the captured
+ * arguments in the order they are consumed by the format string, each in a
+ * 64-bit slot.  Strings are stored as a length slot (UINT32_MAX for NULL)
+ * followed by the zero terminated characters, padded to a 64-bit boundary.
+ */
+typedef struct RTLOGBINREC
+{
+    /** The size of the record including this header, 64-bit aligned.
+     * RTLOGBIN_REC_WRAP for the wrap marker. */
+    uint32_t                cbRec;
+    /** The logging flags. */
+    uint32_t                fFlags;
+    /** The group. */
+    uint32_t                iGroup;
+    /** The length of the format string copy following the header. */
+    uint32_t                cchFormat;
+    /** RTTimeNanoTS() at the time of the call. */
+    uint64_t                nsTs;
+    /** The TSC at the time of the call (RTTimeNanoTS() on non-x86 hosts). */
+    uint64_t                uTsc;
+} RTLOGBINREC;
+AssertCompileSizeAlignment(RTLOGBINREC, sizeof(uint64_t));
+
+/**
+ * Per-thread binary log buffer.
+ *
+ * This is a single producer, single consumer ring buffer.  The owner thread
+ * is the producer, the consumer is whoever owns the logger lock.  Records are
+ * never split across the end of the buffer.
+ */
+typedef struct RTLOGBINBUF
+{
+    /** The next buffer (RTLOGGERINTERNAL::pBinBufs). */
+    struct RTLOGBINBUF     *pNext;
+    /** The native handle of the owner thread. */
+    RTNATIVETHREAD          hNativeThread;
+    /** The write offset (free running), only updated by the owner thread. */
+    uint32_t volatile       offHead;
+    /** The read offset (free running), only updated by the consumer. */
+    uint32_t volatile       offTail;
+    /** Number of records dropped because the buffer was full. */
+    uint32_t volatile       cDropped;
+    /** The write offset snapshot of the current drain (consumer only). */
+    uint32_t                offDrainEnd;
+    /** Set by the TLS destructor when the owner thread terminates. */
+    bool volatile           fDead;
+    /** fDead snapshot of the current drain (consumer only). */
+    bool                    fDrainDead;
+    /** The name of the owner thread. */
+    char                    szThread[16];
+    /** The buffer. */
+    uint64_t                au64Buf[RTLOGBIN_BUF_SIZE / sizeof(uint64_t)];
+} RTLOGBINBUF;
+/** Pointer to a per-thread binary log buffer. */
+typedef RTLOGBINBUF *PRTLOGBINBUF;
+
+/**
+ * Kind of argument consumed by a format specifier in binary logging mode.
+ */
+typedef enum RTLOGBINARG
+{
+    /** Cannot be captured, must be formatted immediately. */
+    RTLOGBINARG_INVALID = 0,
+    /** 32-bit (or promoted to int) integer. */
+    RTLOGBINARG_U32,
+    /** 64-bit integer. */
+    RTLOGBINARG_U64,
+    /** Zero terminated string. */
+    RTLOGBINARG_STR
+} RTLOGBINARG;
+#endif /* IN_RING3 */
+
 #ifndef IN_RC
 
 /**
@@ -199,11 +305,30 @@ typedef struct RTLOGGERINTERNAL
     /** Pointer to filename. */
     char                    szFilename[RTPATH_MAX];
     /** @} */
+
+    /** @name Binary logging (RTLOGFLAGS_BINARY).
+     * @{ */
+    /** The initialization state (RTLOGBINSTATE_XXX). */
+    uint32_t volatile       enmBinState;
+    /** Number of threads inside rtlogBinLog, rtlogBinTerm waits for this to
+     * drop to zero before freeing anything. */
+    uint32_t volatile       cBinWriters;
+    /** Set when the flusher thread should terminate. */
+    bool volatile           fBinShutdown;
+    /** TLS index of the per-thread buffers. */
+    RTTLS                   iBinTls;
+    /** The per-thread buffers, protected by the logger lock. */
+    struct RTLOGBINBUF     *pBinBufs;
+    /** Event semaphore the flusher thread waits on. */
+    RTSEMEVENT              hBinEvt;
+    /** The flusher thread. */
+    RTTHREAD                hBinThread;
+    /** @} */
 # endif /* IN_RING3 */
 } RTLOGGERINTERNAL;
 
 /** The revision of the internal logger structure. */
-# define RTLOGGERINTERNAL_REV    UINT32_C(10)
+# define RTLOGGERINTERNAL_REV    UINT32_C(11)
 
 # ifdef IN_RING3
 /** The size of the RTLOGGERINTERNAL structure in ring-0.  */
@@ -229,6 +354,8 @@ static void rtR0LogLoggerExFallback(uint32_t fDestFlags, uint32_t fFlags, PRTLOG
 #ifdef IN_RING3
 static int rtlogFileOpen(PRTLOGGER pLogger, char *pszErrorMsg, size_t cchErrorMsg);
 static void rtlogRotate(PRTLOGGER pLogger, uint32_t uTimeSlot, bool fFirst);
+static void rtlogBinDrainLocked(PRTLOGGER pLogger);
+static void rtlogBinTerm(PRTLOGGER pLogger);
 #endif
 #ifndef IN_RC
 static void rtLogRingBufFlush(PRTLOGGER pLogger);
@@ -317,6 +444,7 @@ static struct
     { "writethru",    sizeof("writethru"   ) - 1,   RTLOGFLAGS_WRITE_THROUGH,       false },
     { "writethrough", sizeof("writethrough") - 1,   RTLOGFLAGS_WRITE_THROUGH,       false },
     { "flush",        sizeof("flush"       ) - 1,   RTLOGFLAGS_FLUSH,               false },
+    { "binary",       sizeof("binary"      ) - 1,   RTLOGFLAGS_BINARY,              false },
     { "lockcnts",     sizeof("lockcnts"    ) - 1,   RTLOGFLAGS_PREFIX_LOCK_COUNTS,  false },
     { "cpuid",        sizeof("cpuid"       ) - 1,   RTLOGFLAGS_PREFIX_CPUID,        false },
     { "pid",          sizeof("pid"         ) - 1,   RTLOGFLAGS_PREFIX_PID,          false },
@@ -843,6 +971,11 @@ RTDECL(int) RTLogCreateExV(PRTLOGGER *ppLogger, uint32_t fFlags, const char *psz
 # ifdef IN_RING3
         pLogger->pInt->pfnPhase                 = pfnPhase;
         pLogger->pInt->hFile                    = NIL_RTFILE;
+        pLogger->pInt->enmBinState              = RTLOGBINSTATE_UNINITIALIZED;
+        pLogger->pInt->cBinWriters              = 0;
+        pLogger->pInt->iBinTls                  = NIL_RTTLS;
+        pLogger->pInt->hBinEvt                  = NIL_RTSEMEVENT;
+        pLogger->pInt->hBinThread               = NIL_RTTHREAD;
         pLogger->pInt->cHistory                 = cHistory;
         if (cbHistoryFileMax == 0)
             pLogger->pInt->cbHistoryFileMax     = UINT64_MAX;
@@ -1086,6 +1219,13 @@ RTDECL(int) RTLogDestroy(PRTLOGGER pLogger)
     AssertReturn(pLogger->u32Magic == RTLOGGER_MAGIC, VERR_INVALID_MAGIC);
     AssertPtrReturn(pLogger->pInt, VERR_INVALID_POINTER);
 
+# ifdef IN_RING3
+    /*
+     * Stop the binary log flusher thread and format whatever is still queued.
+     */
+    rtlogBinTerm(pLogger);
+# endif
+
     /*
      * Acquire logger instance sem and disable all logging. (paranoia)
      */
@@ -2584,6 +2724,9 @@ RTDECL(void) RTLogFlush(PRTLOGGER pLogger)
     if (   pLogger->offScratch
 #ifndef IN_RC
         || (pLogger->fDestFlags & RTLOGDEST_RINGBUF)
+#endif
+#ifdef IN_RING3
+        || pLogger->pInt->pBinBufs
 #endif
        )
     {
@@ -2595,6 +2738,13 @@ RTDECL(void) RTLogFlush(PRTLOGGER pLogger)
         if (RT_FAILURE(rc))
             return;
 #endif
+#ifdef IN_RING3
+        /*
+         * Format queued binary records.
+         */
+        rtlogBinDrainLocked(pLogger);
+#endif
+
         /*
          * Call worker.
          */
@@ -2853,6 +3003,774 @@ RTDECL(void) RTLogLoggerV(PRTLOGGER pLogger, const char *pszFormat, va_list args
 RT_EXPORT_SYMBOL(RTLogLoggerV);
 
 
+#ifdef IN_RING3
+
+/**
+ * %R types which can be captured by value in binary logging mode.
+ */
+static struct
+{
+    char        sz[7];                  /**< The type name following the 'R'. */
+    uint8_t     cch;                    /**< The length of the name. */
+    uint8_t     cb;                     /**< The size of the argument. */
+} const g_aLogBinRTypes[] =
+{
+    { RT_STR_TUPLE("rc"),       sizeof(int) },
+    { RT_STR_TUPLE("rs"),       sizeof(int) },
+    { RT_STR_TUPLE("rf"),       sizeof(int) },
+    { RT_STR_TUPLE("ra"),       sizeof(int) },
+    { RT_STR_TUPLE("X8"),       sizeof(uint32_t) },
+    { RT_STR_TUPLE("X16"),      sizeof(uint32_t) },
+    { RT_STR_TUPLE("X32"),      sizeof(uint32_t) },
+    { RT_STR_TUPLE("X64"),      sizeof(uint64_t) },
+    { RT_STR_TUPLE("U8"),       sizeof(uint32_t) },
+    { RT_STR_TUPLE("U16"),      sizeof(uint32_t) },
+    { RT_STR_TUPLE("U32"),      sizeof(uint32_t) },
+    { RT_STR_TUPLE("U64"),      sizeof(uint64_t) },
+    { RT_STR_TUPLE("I8"),       sizeof(int32_t) },
+    { RT_STR_TUPLE("I16"),      sizeof(int32_t) },
+    { RT_STR_TUPLE("I32"),      sizeof(int32_t) },
+    { RT_STR_TUPLE("I64"),      sizeof(int64_t) },
+    { RT_STR_TUPLE("Gp"),       sizeof(RTGCPHYS) },
+    { RT_STR_TUPLE("Hp"),       sizeof(RTHCPHYS) },
+    { RT_STR_TUPLE("Hv"),       sizeof(RTHCPTR) },
+    { RT_STR_TUPLE("Tbool"),    sizeof(int) },
+    { RT_STR_TUPLE("Tfoff"),    sizeof(RTFOFF) },
+    { RT_STR_TUPLE("Tint"),     sizeof(RTINT) },
+    { RT_STR_TUPLE("Tiop"),     sizeof(uint32_t) },
+    { RT_STR_TUPLE("Tnthrd"),   sizeof(RTNATIVETHREAD) },
+    { RT_STR_TUPLE("Tproc"),    sizeof(RTPROCESS) },
+    { RT_STR_TUPLE("Tptr"),     sizeof(RTUINTPTR) },
+    { RT_STR_TUPLE("Tuint"),    sizeof(RTUINT) },
+    { RT_STR_TUPLE("Txint"),    sizeof(RTUINT) },
+};
+
+
+/**
+ * Parses a format specifier for binary logging.
+ *
+ * This must agree with the way RTStrFormatV consumes arguments.
+ *
+ * @returns Pointer to the character following the specifier.
+ * @param   psz             Pointer to the character following the '%'.
+ * @param   pfStarWidth     Where to return whether the width is an argument.
+ * @param   pfStarPrecision Where to return whether the precision is an
+ *                          argument.
+ * @param   pcchPrecision   Where to return the precision given in the format
+ *                          string, -1 if none or if it is an argument.
+ * @param   penmArg         Where to return the kind of argument consumed.
+ */
+static const char *rtlogBinParseSpec(const char *psz, bool *pfStarWidth, bool *pfStarPrecision, int *pcchPrecision,
+                                     RTLOGBINARG *penmArg)
+{
+    *pfStarWidth     = false;
+    *pfStarPrecision = false;
+    *pcchPrecision   = -1;
+    *penmArg         = RTLOGBINARG_INVALID;
+
+    /* flags */
+    while (   *psz == '#' || *psz == '-' || *psz == '+'
+           || *psz == ' ' || *psz == '0' || *psz == '\'')
+        psz++;
+
+    /* width */
+    if (*psz == '*')
+    {
+        *pfStarWidth = true;
+        psz++;
+    }
+    else
+        while (RT_C_IS_DIGIT(*psz))
+            psz++;
+
+    /* precision */
+    if (*psz == '.')
+    {
+        psz++;
+        if (*psz == '*')
+        {
+            *pfStarPrecision = true;
+            psz++;
+        }
+        else
+        {
+            int cchPrecision = 0;
+            while (RT_C_IS_DIGIT(*psz))
+                cchPrecision = cchPrecision * 10 + *psz++ - '0';
+            *pcchPrecision = cchPrecision;
+        }
+    }
+
+    /* argument size */
+    char const chArgSize = *psz;
+    unsigned   cbArg     = sizeof(int);
+    switch (chArgSize)
+    {
+        case 'z':
+        case 't':
+            cbArg = sizeof(size_t);
+            psz++;
+            break;
+        case 'L':
+        case 'j':
+        case 'q':
+            cbArg = sizeof(uint64_t);
+            psz++;
+            break;
+        case 'l':
+            psz++;
+            if (*psz == 'l')
+            {
+                cbArg = sizeof(uint64_t);
+                psz++;
+            }
+            else
+                cbArg = sizeof(long);
+            break;
+        case 'h':
+            psz++;
+            if (*psz == 'h')
+                psz++;
+            break;
+        case 'I':
+            if (psz[1] == '6' && psz[2] == '4')
+            {
+                cbArg = sizeof(uint64_t);
+                psz += 3;
+            }
+            else if (psz[1] == '3' && psz[2] == '2')
+                psz += 3;
+            else
+            {
+                cbArg = sizeof(uint64_t);
+                psz++;
+            }
+            break;
+        default:
+            break;
+    }
+
+    /* type */
+    switch (*psz++)
+    {
+        case 'c':
+            *penmArg = RTLOGBINARG_U32;
+            break;
+
+        case 'd':
+        case 'i':
+        case 'o':
+        case 'u':
+        case 'x':
+        case 'X':
+            *penmArg = cbArg == sizeof(uint64_t) ? RTLOGBINARG_U64 : RTLOGBINARG_U32;
+            break;
+
+        case 'p':
+            *penmArg = sizeof(void *) == sizeof(uint64_t) ? RTLOGBINARG_U64 : RTLOGBINARG_U32;
+            break;
+
+        case 's':
+        case 'S':
+            if (chArgSize != 'l' && chArgSize != 'L') /* UTF-16 strings */
+                *penmArg = RTLOGBINARG_STR;
+            break;
+
+        case 'R':
+            for (unsigned i = 0; i < RT_ELEMENTS(g_aLogBinRTypes); i++)
+                if (!strncmp(psz, g_aLogBinRTypes[i].sz, g_aLogBinRTypes[i].cch))
+                {
+                    *penmArg = g_aLogBinRTypes[i].cb == sizeof(uint64_t) ? RTLOGBINARG_U64 : RTLOGBINARG_U32;
+                    psz += g_aLogBinRTypes[i].cch;
+                    break;
+                }
+            break;
+
+        default:
+            /* %N, %M, %n and anything unknown. */
+            break;
+    }
+    return psz;
+}
+
+
+/**
+ * TLS destructor for the per-thread binary log buffers.
+ *
+ * The buffer is freed by the consumer once it has been drained.
+ *
+ * @param   pvValue     The buffer.
+ */
+static DECLCALLBACK(void) rtlogBinTlsDtor(void *pvValue)
+{
+    PRTLOGBINBUF pBuf = (PRTLOGBINBUF)pvValue;
+    if (pBuf)
+        ASMAtomicWriteBool(&pBuf->fDead, true);
+}
+
+
+/**
+ * The binary log flusher thread.
+ *
+ * @returns VINF_SUCCESS.
+ * @param   hThreadSelf The thread handle.
+ * @param   pvUser      The logger instance.
+ */
+static DECLCALLBACK(int) rtlogBinFlushThread(RTTHREAD hThreadSelf, void *pvUser)
+{
+    PRTLOGGER           pLogger = (PRTLOGGER)pvUser;
+    PRTLOGGERINTERNAL   pInt    = pLogger->pInt;
+    RT_NOREF_PV(hThreadSelf);
+
+    while (!ASMAtomicReadBool(&pInt->fBinShutdown))
+    {
+        RTSemEventWait(pInt->hBinEvt, RTLOGBIN_FLUSH_INTERVAL_MS);
+        if (RT_SUCCESS(rtlogLock(pLogger)))
+        {
+            rtlogBinDrainLocked(pLogger);
+            rtlogUnlock(pLogger);
+        }
+    }
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Initializes binary logging for a logger on first use.
+ *
+ * @returns true if ready, false if the caller should format immediately.
+ * @param   pLogger     The logger instance.
+ */
+static bool rtlogBinInit(PRTLOGGER pLogger)
+{
+    PRTLOGGERINTERNAL pInt = pLogger->pInt;
+    if (!ASMAtomicCmpXchgU32(&pInt->enmBinState, RTLOGBINSTATE_INITIALIZING, RTLOGBINSTATE_UNINITIALIZED))
+        return ASMAtomicReadU32(&pInt->enmBinState) == RTLOGBINSTATE_READY;
+
+    /* Without destructor support the buffers of terminated threads are only
+       freed when the logger is destroyed. */
+    int rc = RTTlsAllocEx(&pInt->iBinTls, rtlogBinTlsDtor);
+    if (RT_FAILURE(rc))
+    {
+        pInt->iBinTls = RTTlsAlloc();
+        rc = pInt->iBinTls != NIL_RTTLS ? VINF_SUCCESS : VERR_NO_MEMORY;
+    }
+    if (RT_SUCCESS(rc))
+    {
+        rc = RTSemEventCreate(&pInt->hBinEvt);
+        if (RT_SUCCESS(rc))
+        {
+            rc = RTThreadCreate(&pInt->hBinThread, rtlogBinFlushThread, pLogger, 0 /*cbStack*/,
+                                RTTHREADTYPE_IO, RTTHREADFLAGS_WAITABLE, "LogFlush");
+            if (RT_SUCCESS(rc))
+            {
+                ASMAtomicWriteU32(&pInt->enmBinState, RTLOGBINSTATE_READY);
+                return true;
+            }
+            RTSemEventDestroy(pInt->hBinEvt);
+            pInt->hBinEvt = NIL_RTSEMEVENT;
+        }
+        RTTlsFree(pInt->iBinTls);
+        pInt->iBinTls = NIL_RTTLS;
+    }
+    ASMAtomicWriteU32(&pInt->enmBinState, RTLOGBINSTATE_FAILED);
+    return false;
+}
+
+
+/**
+ * Terminates binary logging, draining and freeing all the buffers.
+ *
+ * @param   pLogger     The logger instance.  Not locked.
+ */
+static void rtlogBinTerm(PRTLOGGER pLogger)
+{
+    PRTLOGGERINTERNAL pInt = pLogger->pInt;
+
+    /* Stop new writers and wait for those already inside rtlogBinLog, they
+       may be using the TLS index and the buffers.  An initialization that
+       completes meanwhile flips the state back to ready, so repeat until it
+       sticks. */
+    uint32_t enmState = ASMAtomicXchgU32(&pInt->enmBinState, RTLOGBINSTATE_FAILED);
+    for (;;)
+    {
+        while (ASMAtomicReadU32(&pInt->cBinWriters) != 0)
+            RTThreadYield();
+        uint32_t const enmNew = ASMAtomicXchgU32(&pInt->enmBinState, RTLOGBINSTATE_FAILED);
+        if (enmNew == RTLOGBINSTATE_FAILED)
+            break;
+        enmState = enmNew;
+    }
+    if (enmState != RTLOGBINSTATE_READY)
+        return;
+
+    ASMAtomicWriteBool(&pInt->fBinShutdown, true);
+    RTSemEventSignal(pInt->hBinEvt);
+    int rc = RTThreadWait(pInt->hBinThread, RT_INDEFINITE_WAIT, NULL);
+    AssertRC(rc);
+    pInt->hBinThread = NIL_RTTHREAD;
+
+    rc = rtlogLock(pLogger);
+    if (RT_SUCCESS(rc))
+    {
+        rtlogBinDrainLocked(pLogger);
+        PRTLOGBINBUF pBuf = pInt->pBinBufs;
+        pInt->pBinBufs = NULL;
+        rtlogUnlock(pLogger);
+
+        while (pBuf)
+        {
+            PRTLOGBINBUF pNext = pBuf->pNext;
+            RTMemFree(pBuf);
+            pBuf = pNext;
+        }
+    }
+
+    RTTlsFree(pInt->iBinTls);
+    pInt->iBinTls = NIL_RTTLS;
+    RTSemEventDestroy(pInt->hBinEvt);
+    pInt->hBinEvt = NIL_RTSEMEVENT;
+}
+
+
+/**
+ * Creates the binary log buffer for the calling thread.
+ *
+ * @returns Pointer to the buffer, NULL on failure.
+ * @param   pLogger     The logger instance.  Not locked.
+ */
+static PRTLOGBINBUF rtlogBinBufCreate(PRTLOGGER pLogger)
+{
+    PRTLOGBINBUF pBuf = (PRTLOGBINBUF)RTMemAllocZ(sizeof(*pBuf));
+    if (!pBuf)
+        return NULL;
+    pBuf->hNativeThread = RTThreadNativeSelf();
+    const char *pszName = RTThreadSelfName();
+    if (pszName)
+        RTStrCopy(pBuf->szThread, sizeof(pBuf->szThread), pszName);
+
+    int rc = rtlogLock(pLogger);
+    if (RT_FAILURE(rc))
+    {
+        RTMemFree(pBuf);
+        return NULL;
+    }
+    pBuf->pNext = pLogger->pInt->pBinBufs;
+    pLogger->pInt->pBinBufs = pBuf;
+    rtlogUnlock(pLogger);
+
+    RTTlsSet(pLogger->pInt->iBinTls, pBuf);
+    return pBuf;
+}
+
+
+/**
+ * Appends a record to a per-thread binary log buffer.
+ *
+ * The record is dropped and counted if the buffer is full.
+ *
+ * @param   pInt        The internal logger data.
+ * @param   pBuf        The calling thread's buffer.
+ * @param   pvRec       The record.
+ * @param   cbRec       The size of the record, 64-bit aligned.
+ */
+static void rtlogBinPut(PRTLOGGERINTERNAL pInt, PRTLOGBINBUF pBuf, void const *pvRec, uint32_t cbRec)
+{
+    uint32_t const offHead  = pBuf->offHead;
+    uint32_t const cbUsed   = offHead - ASMAtomicReadU32(&pBuf->offTail);
+    uint32_t const offBuf   = offHead & (RTLOGBIN_BUF_SIZE - 1);
+    uint32_t const cbToEnd  = RTLOGBIN_BUF_SIZE - offBuf;
+    uint32_t const cbNeeded = cbRec <= cbToEnd ? cbRec : cbToEnd + cbRec;
+    if (cbUsed + cbNeeded > RTLOGBIN_BUF_SIZE)
+    {
+        ASMAtomicIncU32(&pBuf->cDropped);
+        RTSemEventSignal(pInt->hBinEvt);
+        return;
+    }
+
+    uint8_t *pbBuf = (uint8_t *)&pBuf->au64Buf[0];
+    if (cbRec <= cbToEnd)
+        memcpy(&pbBuf[offBuf], pvRec, cbRec);
+    else
+    {
+        *(uint32_t *)&pbBuf[offBuf] = RTLOGBIN_REC_WRAP;
+        memcpy(pbBuf, pvRec, cbRec);
+    }
+    ASMAtomicWriteU32(&pBuf->offHead, offHead + cbNeeded);
+
+    /* Kick the flusher when crossing the half full mark. */
+    if (   cbUsed            <  RTLOGBIN_BUF_SIZE / 2
+        && cbUsed + cbNeeded >= RTLOGBIN_BUF_SIZE / 2)
+        RTSemEventSignal(pInt->hBinEvt);
+}
+
+
+/**
+ * Worker for rtlogBinLog that captures the message into a record and queues it.
+ *
+ * @returns true if the message was taken care of (queued or dropped), false
+ *          if the caller should format it immediately.
+ * @param   pLogger     The logger instance.  Not locked, binary logging ready.
+ * @param   fFlags      The logging flags.
+ * @param   iGroup      The group.
+ * @param   pszFormat   Format string.
+ * @param   args        Format arguments.  Not consumed.
+ */
+static bool rtlogBinLogWorker(PRTLOGGER pLogger, unsigned fFlags, unsigned iGroup, const char *pszFormat, va_list args)
+{
+    PRTLOGGERINTERNAL pInt = pLogger->pInt;
+    PRTLOGBINBUF pBuf = (PRTLOGBINBUF)RTTlsGet(pInt->iBinTls);
+    if (RT_UNLIKELY(!pBuf))
+    {
+        pBuf = rtlogBinBufCreate(pLogger);
+        if (!pBuf)
+            return false;
+    }
+
+    /*
+     * Capture the arguments.
+     */
+    union
+    {
+        RTLOGBINREC     Hdr;
+        uint64_t        au64[RTLOGBIN_REC_MAX / sizeof(uint64_t)];
+        uint8_t         ab[RTLOGBIN_REC_MAX];
+    } uRec;
+    size_t const cchFormat = strlen(pszFormat);
+    size_t const cbFormat  = RT_ALIGN_Z(cchFormat + 1, sizeof(uint64_t));
+    if (sizeof(RTLOGBINREC) + cbFormat > sizeof(uRec))
+        return false;
+    memcpy(&uRec.ab[sizeof(RTLOGBINREC)], pszFormat, cchFormat);
+    memset(&uRec.ab[sizeof(RTLOGBINREC) + cchFormat], 0, cbFormat - cchFormat);
+
+    size_t      off  = sizeof(RTLOGBINREC) + cbFormat;
+    bool        fOk  = true;
+    const char *psz  = pszFormat;
+    va_list     va;
+    va_copy(va, args);
+    while ((psz = strchr(psz, '%')) != NULL)
+    {
+        psz++;
+        if (*psz == '%')
+        {
+            psz++;
+            continue;
+        }
+
+        bool        fStarWidth;
+        bool        fStarPrecision;
+        int         cchPrecision;
+        RTLOGBINARG enmArg;
+        psz = rtlogBinParseSpec(psz, &fStarWidth, &fStarPrecision, &cchPrecision, &enmArg);
+        if (   enmArg == RTLOGBINARG_INVALID
+            || off + 3 * sizeof(uint64_t) > sizeof(uRec))
+        {
+            fOk = false;
+            break;
+        }
+
+        if (fStarWidth)
+        {
+            uRec.au64[off / sizeof(uint64_t)] = (uint64_t)(int64_t)va_arg(va, int);
+            off += sizeof(uint64_t);
+        }
+        if (fStarPrecision)
+        {
+            cchPrecision = va_arg(va, int);
+            cchPrecision = RT_MAX(cchPrecision, 0);
+            uRec.au64[off / sizeof(uint64_t)] = (uint64_t)cchPrecision;
+            off += sizeof(uint64_t);
+        }
+
+        if (enmArg == RTLOGBINARG_U32)
+        {
+            uRec.au64[off / sizeof(uint64_t)] = va_arg(va, uint32_t);
+            off += sizeof(uint64_t);
+        }
+        else if (enmArg == RTLOGBINARG_U64)
+        {
+            uRec.au64[off / sizeof(uint64_t)] = va_arg(va, uint64_t);
+            off += sizeof(uint64_t);
+        }
+        else
+        {
+            const char *pszStr = va_arg(va, const char *);
+            if (!pszStr)
+            {
+                uRec.au64[off / sizeof(uint64_t)] = UINT32_MAX;
+                off += sizeof(uint64_t);
+                continue;
+            }
+            size_t const cchStr = RTStrNLen(pszStr, cchPrecision >= 0 ? (size_t)cchPrecision : RTLOGBIN_REC_MAX);
+            size_t const cbStr  = RT_ALIGN_Z(cchStr + 1, sizeof(uint64_t));
+            if (off + sizeof(uint64_t) + cbStr > sizeof(uRec))
+            {
+                fOk = false;
+                break;
+            }
+            uRec.au64[off / sizeof(uint64_t)] = cchStr;
+            off += sizeof(uint64_t);
+            memcpy(&uRec.ab[off], pszStr, cchStr);
+            memset(&uRec.ab[off + cchStr], 0, cbStr - cchStr);
+            off += cbStr;
+        }
+    }
+    va_end(va);
+    if (!fOk)
+        return false;
+
+    /*
+     * Complete the header and queue it.
+     */
+    uRec.Hdr.cbRec         = (uint32_t)off;
+    uRec.Hdr.fFlags        = fFlags;
+    uRec.Hdr.iGroup        = iGroup;
+    uRec.Hdr.cchFormat     = (uint32_t)cchFormat;
+    uRec.Hdr.nsTs          = RTTimeNanoTS();
+#if defined(RT_ARCH_AMD64) || defined(RT_ARCH_X86)
+    uRec.Hdr.uTsc          = ASMReadTSC();
+#else
+    uRec.Hdr.uTsc          = uRec.Hdr.nsTs;
+#endif
+    rtlogBinPut(pInt, pBuf, &uRec, (uint32_t)off);
+    return true;
+}
+
+
+/**
+ * Tries to log a message in binary form (RTLOGFLAGS_BINARY), initializing
+ * binary logging on first use.
+ *
+ * @returns true if the message was taken care of (queued or dropped), false
+ *          if the caller should format it immediately.
+ * @param   pLogger     The logger instance.  Not locked.
+ * @param   fFlags      The logging flags.
+ * @param   iGroup      The group.
+ * @param   pszFormat   Format string.
+ * @param   args        Format arguments.  Not consumed.
+ */
+static bool rtlogBinLog(PRTLOGGER pLogger, unsigned fFlags, unsigned iGroup, const char *pszFormat, va_list args)
+{
+    PRTLOGGERINTERNAL pInt = pLogger->pInt;
+    bool              fRet = false;
+    ASMAtomicIncU32(&pInt->cBinWriters);
+    if (   RT_LIKELY(ASMAtomicReadU32(&pInt->enmBinState) == RTLOGBINSTATE_READY)
+        || rtlogBinInit(pLogger))
+        fRet = rtlogBinLogWorker(pLogger, fFlags, iGroup, pszFormat, args);
+    ASMAtomicDecU32(&pInt->cBinWriters);
+    return fRet;
+}
+
+
+/**
+ * Formats a single replayed argument.
+ *
+ * @returns Number of bytes formatted.
+ * @param   pfnOutput   The output function.
+ * @param   pvOutput    The output function argument.
+ * @param   pszFormat   The format string with a single specifier.
+ * @param   ...         The argument.
+ */
+static size_t rtlogBinFormat(PFNRTSTROUTPUT pfnOutput, void *pvOutput, const char *pszFormat, ...)
+{
+    va_list va;
+    va_start(va, pszFormat);
+    size_t cch = RTLogFormatV(pfnOutput, pvOutput, pszFormat, va);
+    va_end(va);
+    return cch;
+}
+
+
+/**
+ * Formats a binary log record into the scratch buffer.
+ *
+ * @param   pLogger     The logger instance.  Locked.
+ * @param   pBuf        The buffer the record lives in.
+ * @param   pRec        The record.
+ */
+static void rtlogBinReplayLocked(PRTLOGGER pLogger, PRTLOGBINBUF pBuf, RTLOGBINREC const *pRec)
+{
+    RTLOGOUTPUTPREFIXEDARGS OutputArgs;
+    PFNRTSTROUTPUT          pfnOutput;
+    void                   *pvOutput;
+    if (pLogger->fFlags & (RTLOGFLAGS_PREFIX_MASK | RTLOGFLAGS_USECRLF))
+    {
+        OutputArgs.pLogger = pLogger;
+        OutputArgs.iGroup  = pRec->iGroup;
+        OutputArgs.fFlags  = pRec->fFlags;
+        OutputArgs.pBinRec = pRec;
+        OutputArgs.pBinBuf = pBuf;
+        pfnOutput = rtLogOutputPrefixed;
+        pvOutput  = &OutputArgs;
+    }
+    else
+    {
+        pfnOutput = rtLogOutput;
+        pvOutput  = pLogger;
+    }
+
+    uint64_t const *pau64 = (uint64_t const *)pRec;
+    size_t          idx   = (sizeof(*pRec) + RT_ALIGN_Z(pRec->cchFormat + 1, sizeof(uint64_t))) / sizeof(uint64_t);
+    const char     *psz   = (const char *)(pRec + 1);
+    for (;;)
+    {
+        /* Literal text. */
+        const char *pszPct = strchr(psz, '%');
+        if (!pszPct)
+        {
+            if (*psz)
+                pfnOutput(pvOutput, psz, strlen(psz));
+            break;
+        }
+        if (pszPct != psz)
+            pfnOutput(pvOutput, psz, pszPct - psz);
+        if (pszPct[1] == '%')
+        {
+            pfnOutput(pvOutput, "%", 1);
+            psz = pszPct + 2;
+            continue;
+        }
+
+        /* Rebuild the specifier with the width and precision arguments resolved. */
+        bool        fStarWidth;
+        bool        fStarPrecision;
+        int         cchPrecision;
+        RTLOGBINARG enmArg;
+        psz = rtlogBinParseSpec(pszPct + 1, &fStarWidth, &fStarPrecision, &cchPrecision, &enmArg);
+        int32_t iWidth = 0;
+        if (fStarWidth)
+            iWidth = (int32_t)pau64[idx++];
+        if (fStarPrecision)
+            cchPrecision = (int32_t)pau64[idx++];
+
+        char    szSpec[64];
+        size_t  cchSpec = 0;
+        szSpec[cchSpec++] = '%';
+        if (iWidth < 0)
+        {
+            szSpec[cchSpec++] = '-';
+            iWidth = -iWidth;
+        }
+        for (const char *pch = pszPct + 1; pch < psz && cchSpec < sizeof(szSpec) - 16; pch++)
+            if (*pch != '*')
+                szSpec[cchSpec++] = *pch;
+            else
+                cchSpec += RTStrFormatNumber(&szSpec[cchSpec], pch[-1] == '.' ? (uint32_t)cchPrecision : (uint32_t)iWidth,
+                                             10, 0, 0, 0);
+        szSpec[cchSpec] = '\0';
+
+        /* Format the argument. */
+        uint64_t const u64 = pau64[idx++];
+        if (enmArg == RTLOGBINARG_U32)
+            rtlogBinFormat(pfnOutput, pvOutput, szSpec, (uint32_t)u64);
+        else if (enmArg == RTLOGBINARG_U64)
+            rtlogBinFormat(pfnOutput, pvOutput, szSpec, u64);
+        else if (u64 == UINT32_MAX)
+            rtlogBinFormat(pfnOutput, pvOutput, szSpec, (const char *)NULL);
+        else
+        {
+            rtlogBinFormat(pfnOutput, pvOutput, szSpec, (const char *)&pau64[idx]);
+            idx += RT_ALIGN_64(u64 + 1, sizeof(uint64_t)) / sizeof(uint64_t);
+        }
+    }
+}
+
+
+/**
+ * Returns the next record of a buffer within the current drain, skipping wrap
+ * markers.
+ *
+ * @returns Pointer to the record, NULL if none.
+ * @param   pBuf        The buffer.
+ */
+DECLINLINE(RTLOGBINREC const *) rtlogBinPeek(PRTLOGBINBUF pBuf)
+{
+    uint32_t offTail = pBuf->offTail;
+    while (offTail != pBuf->offDrainEnd)
+    {
+        uint32_t const      offBuf = offTail & (RTLOGBIN_BUF_SIZE - 1);
+        RTLOGBINREC const  *pRec   = (RTLOGBINREC const *)((uint8_t const *)&pBuf->au64Buf[0] + offBuf);
+        if (pRec->cbRec != RTLOGBIN_REC_WRAP)
+            return pRec;
+        offTail += RTLOGBIN_BUF_SIZE - offBuf;
+        ASMAtomicWriteU32(&pBuf->offTail, offTail);
+    }
+    return NULL;
+}
+
+
+/**
+ * Formats all queued binary log records in timestamp order and frees the
+ * buffers of terminated threads.
+ *
+ * @param   pLogger     The logger instance.  Locked.
+ */
+static void rtlogBinDrainLocked(PRTLOGGER pLogger)
+{
+    PRTLOGGERINTERNAL pInt = pLogger->pInt;
+    PRTLOGBINBUF      pBuf;
+    if (!pInt->pBinBufs)
+        return;
+
+    /*
+     * Take a snapshot so busy threads cannot keep us here forever.
+     */
+    for (pBuf = pInt->pBinBufs; pBuf; pBuf = pBuf->pNext)
+    {
+        pBuf->fDrainDead  = ASMAtomicReadBool(&pBuf->fDead);
+        pBuf->offDrainEnd = ASMAtomicReadU32(&pBuf->offHead);
+    }
+
+    /*
+     * Merge the buffers by timestamp.
+     */
+    for (;;)
+    {
+        PRTLOGBINBUF        pBest    = NULL;
+        RTLOGBINREC const  *pBestRec = NULL;
+        for (pBuf = pInt->pBinBufs; pBuf; pBuf = pBuf->pNext)
+        {
+            RTLOGBINREC const *pRec = rtlogBinPeek(pBuf);
+            if (pRec && (!pBestRec || pRec->nsTs < pBestRec->nsTs))
+            {
+                pBest    = pBuf;
+                pBestRec = pRec;
+            }
+        }
+        if (!pBest)
+            break;
+
+        rtlogBinReplayLocked(pLogger, pBest, pBestRec);
+        ASMAtomicWriteU32(&pBest->offTail, pBest->offTail + pBestRec->cbRec);
+    }
+
+    /*
+     * Report drops and free the buffers of dead threads.
+     */
+    PRTLOGBINBUF *ppBuf = &pInt->pBinBufs;
+    while ((pBuf = *ppBuf) != NULL)
+    {
+        uint32_t cDropped = ASMAtomicXchgU32(&pBuf->cDropped, 0);
+        if (cDropped)
+            rtlogLoggerExFLocked(pLogger, 0, ~0U, "%u log records from thread '%s' (%RTnthrd) were dropped, the buffer was full.\n",
+                                 cDropped, pBuf->szThread, pBuf->hNativeThread);
+        if (pBuf->fDrainDead && pBuf->offTail == pBuf->offDrainEnd)
+        {
+            *ppBuf = pBuf->pNext;
+            RTMemFree(pBuf);
+        }
+        else
+            ppBuf = &pBuf->pNext;
+    }
+
+    if (    !(pLogger->fFlags & RTLOGFLAGS_BUFFERED)
+        &&  pLogger->offScratch)
+        rtlogFlush(pLogger);
+}
+
+#endif /* IN_RING3 */
+
+
 /**
  * Write to a logger instance.
  *
@@ -2900,6 +3818,15 @@ RTDECL(void) RTLogLoggerExV(PRTLOGGER pLogger, unsigned fFlags, unsigned iGroup,
         &&  (pLogger->afGroups[iGroup] & (fFlags | RTLOGGRPFLAGS_ENABLED)) != (fFlags | RTLOGGRPFLAGS_ENABLED))
         return;
 
+#ifdef IN_RING3
+    /*
+     * Binary logging defers the formatting to the flusher thread.
+     */
+    if (   (pLogger->fFlags & (RTLOGFLAGS_BINARY | RTLOGFLAGS_RESTRICT_GROUPS)) == RTLOGFLAGS_BINARY
+        && rtlogBinLog(pLogger, fFlags, iGroup, pszFormat, args))
+        return;
+#endif
+
     /*
      * Acquire logger instance sem.
      */
@@ -2913,6 +3840,14 @@ RTDECL(void) RTLogLoggerExV(PRTLOGGER pLogger, unsigned fFlags, unsigned iGroup,
         return;
     }
 
+#ifdef IN_RING3
+    /*
+     * Get any queued binary records out first to keep the output ordered.
+     */
+    if (pLogger->pInt->pBinBufs)
+        rtlogBinDrainLocked(pLogger);
+#endif
+
     /*
      * Check restrictions and call worker.
      */
@@ -3553,7 +4488,11 @@ static DECLCALLBACK(size_t) rtLogOutputPrefixed(void *pv, const char *pachChars,
                 psz = &pLogger->achScratch[pLogger->offScratch];
                 if (pLogger->fFlags & RTLOGFLAGS_PREFIX_TS)
                 {
+#ifdef IN_RING3
+                    uint64_t     u64    = pArgs->pBinRec ? pArgs->pBinRec->nsTs : RTTimeNanoTS();
+#else
                     uint64_t     u64    = RTTimeNanoTS();
+#endif
                     int          iBase  = 16;
                     unsigned int fFlags = RTSTR_F_ZEROPAD;
                     if (pLogger->fFlags & RTLOGFLAGS_DECIMAL_TS)
@@ -3579,7 +4518,14 @@ static DECLCALLBACK(size_t) rtLogOutputPrefixed(void *pv, const char *pachChars,
 
                 if (pLogger->fFlags & RTLOGFLAGS_PREFIX_TSC)
                 {
-#if defined(RT_ARCH_AMD64) || defined(RT_ARCH_X86)
+#ifdef IN_RING3
+                    uint64_t     u64    = pArgs->pBinRec ? pArgs->pBinRec->uTsc
+# if defined(RT_ARCH_AMD64) || defined(RT_ARCH_X86)
+                                        : ASMReadTSC();
+# else
+                                        : RTTimeNanoTS();
+# endif
+#elif defined(RT_ARCH_AMD64) || defined(RT_ARCH_X86)
                     uint64_t     u64    = ASMReadTSC();
 #else
                     uint64_t     u64    = RTTimeNanoTS();
@@ -3694,7 +4640,9 @@ static DECLCALLBACK(size_t) rtLogOutputPrefixed(void *pv, const char *pachChars,
 
                 if (pLogger->fFlags & RTLOGFLAGS_PREFIX_TID)
                 {
-#ifndef IN_RC
+#ifdef IN_RING3
+                    RTNATIVETHREAD Thread = pArgs->pBinBuf ? pArgs->pBinBuf->hNativeThread : RTThreadNativeSelf();
+#elif !defined(IN_RC)
                     RTNATIVETHREAD Thread = RTThreadNativeSelf();
 #else
                     RTNATIVETHREAD Thread = NIL_RTNATIVETHREAD;
@@ -3707,7 +4655,7 @@ static DECLCALLBACK(size_t) rtLogOutputPrefixed(void *pv, const char *pachChars,
                 if (pLogger->fFlags & RTLOGFLAGS_PREFIX_THREAD)
                 {
 #ifdef IN_RING3
-                    const char *pszName = RTThreadSelfName();
+                    const char *pszName = pArgs->pBinBuf ? pArgs->pBinBuf->szThread : RTThreadSelfName();
 #elif defined IN_RC
                     const char *pszName = "EMT-RC";
 #else
@@ -3935,6 +4883,10 @@ static void rtlogLoggerExVLocked(PRTLOGGER pLogger, unsigned fFlags, unsigned iG
         OutputArgs.pLogger = pLogger;
         OutputArgs.iGroup  = iGroup;
         OutputArgs.fFlags  = fFlags;
+#ifdef IN_RING3
+        OutputArgs.pBinRec = NULL;
+        OutputArgs.pBinBuf = NULL;
+#endif
         RTLogFormatV(rtLogOutputPrefixed, &OutputArgs, pszFormat, args);
     }
     else
@@ -38,10 +38,11 @@
 #include <iprt/log.h>
 #ifndef IN_RC
 # include <iprt/mem.h>
-#endif
-#if defined(IN_RING0) || (!defined(RT_ARCH_AMD64) && !defined(RT_ARCH_X86))
 # include <iprt/mp.h>
-#else
+#elif !defined(RT_ARCH_AMD64) && !defined(RT_ARCH_X86)
+# include <iprt/mp.h>
+#endif
+#if !defined(IN_RING0) && (defined(RT_ARCH_AMD64) || defined(RT_ARCH_X86))
 # include <iprt/asm-amd64-x86.h>
 #endif
 #include <iprt/path.h>
@@ -74,6 +75,13 @@ AssertCompile(RTTRACEBUF_ALIGNMENT >= sizeof(uint64_t) * 2);
 #define RTTRACEBUF_DEF_ENTRY_SIZE   256
 AssertCompile(!(RTTRACEBUF_DEF_ENTRY_SIZE & (RTTRACEBUF_DEF_ENTRY_SIZE - 1)));
 
+/** The maximum number of per-CPU sub-buffers (power of two). */
+#define RTTRACEBUF_MAX_SUB_BUFS     64
+AssertCompile(!(RTTRACEBUF_MAX_SUB_BUFS & (RTTRACEBUF_MAX_SUB_BUFS - 1)));
+/** The minimum number of entries in a per-CPU sub-buffer.  CPUs share
+ * sub-buffers rather than getting smaller ones. */
+#define RTTRACEBUF_MIN_ENTRIES_PER_SUB  128
+
 /**
  * The volatile trace buffer members.
  */
@@ -81,7 +89,9 @@ typedef struct RTTRACEBUFVOLATILE
 {
     /** Reference counter. */
     uint32_t volatile   cRefs;
-    /** The next entry to make use of. */
+    /** The next entry to make use of.
+     * This is the head of the only ring when RTTRACEBUF_FLAGS_PER_CPU isn't
+     * used, otherwise the sub-buffer heads follow this structure. */
     uint32_t volatile   iEntry;
 } RTTRACEBUFVOLATILE;
 /** Pointer to the volatile parts of a trace buffer. */
@@ -97,10 +107,29 @@ typedef struct RTTRACEBUFENTRY
     uint64_t            NanoTS;
     /** The ID of the CPU the event was recorded.  */
     RTCPUID             idCpu;
-    /** The message. */
-    char                szMsg[RTTRACEBUF_ALIGNMENT - sizeof(uint64_t) - sizeof(RTCPUID)];
+    /** The event ID, RTTRACEBUF_EVENT_ID_MSG for text messages. */
+    uint32_t            idEvent;
+    union
+    {
+        /** The message (RTTRACEBUF_EVENT_ID_MSG). */
+        char            szMsg[RTTRACEBUF_ALIGNMENT - sizeof(uint64_t) - sizeof(RTCPUID) - sizeof(uint32_t)];
+        /** Binary event data (any other event ID). */
+        struct
+        {
+            /** The number of arguments. */
+            uint32_t    cArgs;
+            /** Alignment padding. */
+            uint32_t    u32Padding;
+            /** The arguments, variable sized.  The last byte of an entry is
+             * never written so that torn message reads stay terminated. */
+            uint64_t    au64Args[1];
+        } Evt;
+    } u;
 } RTTRACEBUFENTRY;
 AssertCompile(sizeof(RTTRACEBUFENTRY) <= RTTRACEBUF_ALIGNMENT);
+AssertCompileMemberOffset(RTTRACEBUFENTRY, u.Evt.au64Args, 24);
+/* RTTraceBufAddEvent stores four arguments, which must fit in the smallest entry. */
+AssertCompile(24 + 4 * sizeof(uint64_t) < RTTRACEBUF_MIN_ENTRY_SIZE);
 /** Pointer to a trace buffer entry. */
 typedef RTTRACEBUFENTRY *PRTTRACEBUFENTRY;
 
@@ -118,17 +147,25 @@ typedef struct RTTRACEBUFINT
     uint32_t            u32Magic;
     /** The entry size. */
     uint32_t            cbEntry;
-    /** The number of entries. */
+    /** The total number of entries. */
     uint32_t            cEntries;
-    /** Flags (always zero for now).  */
+    /** Flags, RTTRACEBUF_FLAGS_XXX.  */
     uint32_t            fFlags;
     /** The offset to the volatile members (RTTRACEBUFVOLATILE) (relative to
      *  the start of this structure). */
     uint32_t            offVolatile;
     /** The offset to the entries (relative to the start of this structure). */
     uint32_t            offEntries;
-    /** Reserved entries. */
-    uint32_t            au32Reserved[2];
+    /** The number of sub-buffers, a power of two.  This is 1 unless
+     * RTTRACEBUF_FLAGS_PER_CPU is used. */
+    uint32_t            cSubBufs;
+    /** The number of entries in each sub-buffer. */
+    uint32_t            cEntriesPerSub;
+    /** The offset of the first sub-buffer head index (relative to the start of
+     * this structure).  The head indexes are RTTRACEBUF_ALIGNMENT bytes apart. */
+    uint32_t            offHeads;
+    /** Reserved. */
+    uint32_t            u32Reserved;
 } RTTRACEBUFINT;
 /** Pointer to a const trace buffer. */
 typedef RTTRACEBUFINT const *PCRTTRACEBUFINT;
@@ -146,12 +183,39 @@ typedef RTTRACEBUFINT const *PCRTTRACEBUFINT;
 # define RTTRACEBUF_CUR_CPU()   ASMGetApicId()
 #endif
 
+/**
+ * Gets the sub-buffer index for a RTTRACEBUF_CUR_CPU() value.
+ *
+ * CPU IDs and APIC IDs are frequently sparse, so masking them directly would
+ * make some CPUs share a sub-buffer while others are never used.
+ */
+#if defined(IN_RING0) || (!defined(RT_ARCH_AMD64) && !defined(RT_ARCH_X86))
+# define RTTRACEBUF_CPU_TO_SUB_BUF(a_idCpu)     ((uint32_t)RTMpCpuIdToSetIndex(a_idCpu))
+#elif defined(IN_RING3)
+# define RTTRACEBUF_CPU_TO_SUB_BUF(a_idCpu)     rtTraceBufApicIdToSubBuf((uint8_t)(a_idCpu))
+#else
+# define RTTRACEBUF_CPU_TO_SUB_BUF(a_idCpu)     (a_idCpu)
+#endif
+
 /** Calculates the address of the volatile trace buffer members. */
 #define RTTRACEBUF_TO_VOLATILE(a_pThis)     ((PRTTRACEBUFVOLATILE)((uint8_t *)(a_pThis) + (a_pThis)->offVolatile))
 
-/** Calculates the address of a trace buffer entry. */
-#define RTTRACEBUF_TO_ENTRY(a_pThis, a_iEntry) \
-    ((PRTTRACEBUFENTRY)( (uint8_t *)(a_pThis) + (a_pThis)->offEntries + (a_iEntry) * (a_pThis)->cbEntry ))
+/** Calculates the address of the head index of the given sub-buffer (masked
+ * by the sub-buffer count). */
+#define RTTRACEBUF_TO_HEAD(a_pThis, a_iSub) \
+    ((uint32_t volatile *)( (uint8_t *)(a_pThis) + (a_pThis)->offHeads \
+                          + ((a_iSub) & ((a_pThis)->cSubBufs - 1)) * RTTRACEBUF_ALIGNMENT ))
+
+/** Calculates the address of a trace buffer entry in the given sub-buffer
+ * (masked by the sub-buffer count). */
+#define RTTRACEBUF_TO_ENTRY(a_pThis, a_iSub, a_iEntry) \
+    ((PRTTRACEBUFENTRY)( (uint8_t *)(a_pThis) + (a_pThis)->offEntries \
+                       + (  ((a_iSub) & ((a_pThis)->cSubBufs - 1)) * (a_pThis)->cEntriesPerSub \
+                          + (a_iEntry)) * (a_pThis)->cbEntry ))
+
+/** Calculates the maximum number of binary event arguments an entry can hold. */
+#define RTTRACEBUF_MAX_EVENT_ARGS(a_pThis) \
+    ((uint32_t)(((a_pThis)->cbEntry - RT_OFFSETOF(RTTRACEBUFENTRY, u.Evt.au64Args) - 1) / sizeof(uint64_t)))
 
 /** Validates a trace buffer handle and returns rc if not valid. */
 #define RTTRACEBUF_VALID_RETURN_RC(a_pThis, a_rc) \
@@ -211,21 +275,23 @@ typedef RTTRACEBUFINT const *PCRTTRACEBUFINT;
  * The prologue code for a RTTraceAddSomething function.
  *
  * Resolves a trace buffer handle, grabs a reference to it and allocates the
- * next entry.  Return with an appropriate error status on failure.
+ * next entry in the sub-buffer of the current CPU.  Return with an appropriate
+ * error status on failure.
  *
  * @param   a_hTraceBuf     The trace buffer handle passed by the user.
+ * @param   a_idEvent       The event ID to store in the entry.
  *
  * @remarks This is kind of ugly, sorry.
  */
-#define RTTRACEBUF_ADD_PROLOGUE(a_hTraceBuf) \
+#define RTTRACEBUF_ADD_PROLOGUE_EX(a_hTraceBuf, a_idEvent) \
     int                 rc; \
     uint32_t            cRefs; \
     uint32_t            iEntry; \
+    uint32_t            iSub; \
+    RTCPUID             idCpu; \
     PCRTTRACEBUFINT     pThis; \
     PRTTRACEBUFVOLATILE pVolatile; \
     PRTTRACEBUFENTRY    pEntry; \
-    char               *pszBuf; \
-    size_t              cchBuf; \
     \
     /* Resolve and validate the handle. */ \
     if ((a_hTraceBuf) == RTTRACEBUF_DEFAULT) \
@@ -256,18 +322,35 @@ typedef RTTRACEBUFINT const *PCRTTRACEBUFINT;
         AssertFailedReturn(VERR_INVALID_HANDLE); \
     } \
     \
-    /* Grab the next entry and set the time stamp. */ \
-    iEntry  = ASMAtomicIncU32(&pVolatile->iEntry) - 1; \
-    iEntry %= pThis->cEntries; \
-    pEntry  = RTTRACEBUF_TO_ENTRY(pThis, iEntry); \
-    pEntry->NanoTS = RTTimeNanoTS(); \
-    pEntry->idCpu  = RTTRACEBUF_CUR_CPU(); \
-    pszBuf  = &pEntry->szMsg[0]; \
-    *pszBuf = '\0'; \
-    cchBuf  = pThis->cbEntry - RT_OFFSETOF(RTTRACEBUFENTRY, szMsg) - 1; \
+    /* Grab the next entry of our sub-buffer and set the time stamp. */ \
+    idCpu   = RTTRACEBUF_CUR_CPU(); \
+    iSub    = pThis->cSubBufs > 1 ? RTTRACEBUF_CPU_TO_SUB_BUF(idCpu) : 0; \
+    iEntry  = ASMAtomicIncU32(RTTRACEBUF_TO_HEAD(pThis, iSub)) - 1; \
+    iEntry %= pThis->cEntriesPerSub; \
+    pEntry  = RTTRACEBUF_TO_ENTRY(pThis, iSub, iEntry); \
+    pEntry->NanoTS  = RTTimeNanoTS(); \
+    pEntry->idCpu   = idCpu; \
+    pEntry->idEvent = (a_idEvent); \
     rc      = VINF_SUCCESS
 
 
+/**
+ * The prologue code for a RTTraceAddMsgSomething function.
+ *
+ * Same as RTTRACEBUF_ADD_PROLOGUE_EX and additionally sets up pszBuf and cchBuf
+ * for the message text.
+ *
+ * @param   a_hTraceBuf     The trace buffer handle passed by the user.
+ */
+#define RTTRACEBUF_ADD_PROLOGUE(a_hTraceBuf) \
+    char               *pszBuf; \
+    size_t              cchBuf; \
+    RTTRACEBUF_ADD_PROLOGUE_EX(a_hTraceBuf, RTTRACEBUF_EVENT_ID_MSG); \
+    pszBuf  = &pEntry->u.szMsg[0]; \
+    *pszBuf = '\0'; \
+    cchBuf  = pThis->cbEntry - RT_OFFSETOF(RTTRACEBUFENTRY, u.szMsg) - 1
+
+
 /**
  * Used by a RTTraceAddPosSomething to store the source position in the entry
  * prior to adding the actual trace message text.
@@ -297,14 +380,48 @@ typedef RTTRACEBUFINT const *PCRTTRACEBUFINT;
     return rc
 
 
+#if defined(IN_RING3) && (defined(RT_ARCH_AMD64) || defined(RT_ARCH_X86))
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
+/** Sub-buffer index plus one for each APIC ID, zero if not yet assigned.  The
+ * indexes are handed out in the order the CPUs first add an entry. */
+static uint32_t volatile    g_aiTraceBufSubBufFromApicId[256];
+/** The number of sub-buffer indexes handed out. */
+static uint32_t volatile    g_cTraceBufSubBufIds = 0;
+
+
+/**
+ * Translates an APIC ID into a dense sub-buffer index.
+ *
+ * Ring-3 has no cheap way of getting the CPU set index, so we number the APIC
+ * IDs ourselves.  Racing threads on the same CPU may waste an index, which
+ * only means two CPUs might end up sharing a sub-buffer.
+ *
+ * @returns Sub-buffer index (not masked).
+ * @param   idApic      The APIC ID of the current CPU.
+ */
+static uint32_t rtTraceBufApicIdToSubBuf(uint8_t idApic)
+{
+    uint32_t iSub = ASMAtomicUoReadU32(&g_aiTraceBufSubBufFromApicId[idApic]);
+    if (RT_LIKELY(iSub))
+        return iSub - 1;
+    iSub = ASMAtomicIncU32(&g_cTraceBufSubBufIds);
+    if (!ASMAtomicCmpXchgU32(&g_aiTraceBufSubBufFromApicId[idApic], iSub, 0))
+        iSub = ASMAtomicReadU32(&g_aiTraceBufSubBufFromApicId[idApic]);
+    return iSub - 1;
+}
+#endif
+
+
 #ifndef IN_RC /* Drop this in RC context (too lazy to split the file). */
 
 RTDECL(int) RTTraceBufCreate(PRTTRACEBUF phTraceBuf, uint32_t cEntries, uint32_t cbEntry, uint32_t fFlags)
 {
     AssertPtrReturn(phTraceBuf, VERR_INVALID_POINTER);
     AssertReturn(!(fFlags & ~(RTTRACEBUF_FLAGS_MASK & ~ RTTRACEBUF_FLAGS_FREE_ME)), VERR_INVALID_PARAMETER);
-    AssertMsgReturn(cbEntry  <= RTTRACEBUF_MAX_ENTRIES,    ("%#x\n", cbEntry),  VERR_OUT_OF_RANGE);
-    AssertMsgReturn(cEntries <= RTTRACEBUF_MAX_ENTRY_SIZE, ("%#x\n", cEntries), VERR_OUT_OF_RANGE);
+    AssertMsgReturn(cbEntry  <= RTTRACEBUF_MAX_ENTRY_SIZE, ("%#x\n", cbEntry),  VERR_OUT_OF_RANGE);
+    AssertMsgReturn(cEntries <= RTTRACEBUF_MAX_ENTRIES,    ("%#x\n", cEntries), VERR_OUT_OF_RANGE);
 
     /*
      * Apply default and alignment adjustments.
@@ -320,23 +437,22 @@ RTDECL(int) RTTraceBufCreate(PRTTRACEBUF phTraceBuf, uint32_t cEntries, uint32_t
         cEntries = RTTRACEBUF_MIN_ENTRIES;
 
     /*
-     * Calculate the required buffer size, allocte it and hand it on to the
-     * carver API.
+     * Ask the carver for the required buffer size, add room for aligning the
+     * block, allocate it and hand it on to the carver.
      */
-    size_t  cbBlock = cbEntry * cEntries
-                    + RT_ALIGN_Z(sizeof(RTTRACEBUFINT),      RTTRACEBUF_ALIGNMENT)
-                    + RT_ALIGN_Z(sizeof(RTTRACEBUFVOLATILE), RTTRACEBUF_ALIGNMENT);
-    void   *pvBlock = RTMemAlloc(cbBlock);
-    if (!((uintptr_t)pvBlock & (RTTRACEBUF_ALIGNMENT - 1)))
+    size_t  cbBlock = 0;
+    int rc = RTTraceBufCarve(phTraceBuf, cEntries, cbEntry, fFlags, NULL, &cbBlock);
+    if (rc != VERR_BUFFER_OVERFLOW)
     {
-        RTMemFree(pvBlock);
-        cbBlock += RTTRACEBUF_ALIGNMENT - 1;
-        pvBlock = RTMemAlloc(cbBlock);
+        AssertReturn(RT_FAILURE_NP(rc), VERR_INTERNAL_ERROR_3);
+        return rc;
     }
-    int rc;
+    cbBlock += RTTRACEBUF_ALIGNMENT;
+
+    void   *pvBlock = RTMemAlloc(cbBlock);
     if (pvBlock)
     {
-        rc = RTTraceBufCarve(phTraceBuf, cEntries, cbEntry, fFlags, pvBlock, &cbBlock);
+        rc = RTTraceBufCarve(phTraceBuf, cEntries, cbEntry, fFlags | RTTRACEBUF_FLAGS_FREE_ME, pvBlock, &cbBlock);
         if (RT_FAILURE(rc))
             RTMemFree(pvBlock);
     }
@@ -351,18 +467,33 @@ RTDECL(int) RTTraceBufCarve(PRTTRACEBUF phTraceBuf, uint32_t cEntries, uint32_t
 {
     AssertPtrReturn(phTraceBuf, VERR_INVALID_POINTER);
     AssertReturn(!(fFlags & ~RTTRACEBUF_FLAGS_MASK), VERR_INVALID_PARAMETER);
-    AssertMsgReturn(cbEntry  <= RTTRACEBUF_MAX_ENTRIES,    ("%#x\n", cbEntry),  VERR_OUT_OF_RANGE);
-    AssertMsgReturn(cEntries <= RTTRACEBUF_MAX_ENTRY_SIZE, ("%#x\n", cEntries), VERR_OUT_OF_RANGE);
+    AssertMsgReturn(cbEntry  <= RTTRACEBUF_MAX_ENTRY_SIZE, ("%#x\n", cbEntry),  VERR_OUT_OF_RANGE);
+    AssertMsgReturn(cEntries <= RTTRACEBUF_MAX_ENTRIES,    ("%#x\n", cEntries), VERR_OUT_OF_RANGE);
     AssertPtrReturn(pcbBlock, VERR_INVALID_POINTER);
     size_t const cbBlock = *pcbBlock;
     AssertReturn(RT_VALID_PTR(pvBlock) || !cbBlock, VERR_INVALID_POINTER);
 
+    /*
+     * Figure out the number of sub-buffers.  We use one per possible CPU,
+     * rounded up to a power of two so the dense sub-buffer index
+     * of a CPU (RTTRACEBUF_CPU_TO_SUB_BUF) can simply be masked.
+     */
+    uint32_t cSubBufs = 1;
+    if (fFlags & RTTRACEBUF_FLAGS_PER_CPU)
+    {
+        uint32_t const cCpus = RT_MIN(RT_MAX(RTMpGetArraySize(), 1), RTTRACEBUF_MAX_SUB_BUFS);
+        while (cSubBufs < cCpus)
+            cSubBufs <<= 1;
+    }
+    size_t       cbHeads    = cSubBufs > 1 ? (size_t)cSubBufs * RTTRACEBUF_ALIGNMENT : 0;
+
     /*
      * Apply defaults, align sizes and check against available buffer space.
      * This code can be made a bit more clever, if someone feels like it.
      */
     size_t const cbHdr      = RT_ALIGN_Z(sizeof(RTTRACEBUFINT),      RTTRACEBUF_ALIGNMENT)
-                            + RT_ALIGN_Z(sizeof(RTTRACEBUFVOLATILE), RTTRACEBUF_ALIGNMENT);
+                            + RT_ALIGN_Z(sizeof(RTTRACEBUFVOLATILE), RTTRACEBUF_ALIGNMENT)
+                            + cbHeads;
     size_t const cbEntryBuf = cbBlock > cbHdr ? cbBlock - cbHdr : 0;
     if (cbEntry)
         cbEntry = RT_ALIGN_32(cbEntry, RTTRACEBUF_ALIGNMENT);
@@ -377,8 +508,8 @@ RTDECL(int) RTTraceBufCarve(PRTTRACEBUF phTraceBuf, uint32_t cEntries, uint32_t
         {
             size_t cbEntryZ = cbBlock / cEntries;
             cbEntryZ &= ~(RTTRACEBUF_ALIGNMENT - 1);
-            if (cbEntryZ > RTTRACEBUF_MAX_ENTRIES)
-                cbEntryZ = RTTRACEBUF_MAX_ENTRIES;
+            if (cbEntryZ > RTTRACEBUF_MAX_ENTRY_SIZE)
+                cbEntryZ = RTTRACEBUF_MAX_ENTRY_SIZE;
             cbEntry = (uint32_t)cbEntryZ;
         }
         else if (cbBlock >= RT_ALIGN_32(512, RTTRACEBUF_ALIGNMENT) * 256)
@@ -402,12 +533,26 @@ RTDECL(int) RTTraceBufCarve(PRTTRACEBUF phTraceBuf, uint32_t cEntries, uint32_t
     if (cEntries < RTTRACEBUF_MIN_ENTRIES)
         cEntries = RTTRACEBUF_MIN_ENTRIES;
 
+    /* Divide the entries evenly between the sub-buffers, letting CPUs share
+       sub-buffers when there are too few entries for each to get its own. */
+    if (cEntries / cSubBufs < RTTRACEBUF_MIN_ENTRIES_PER_SUB)
+    {
+        while (cSubBufs > 1 && cEntries / cSubBufs < RTTRACEBUF_MIN_ENTRIES_PER_SUB)
+            cSubBufs >>= 1;
+        cbHeads = cSubBufs > 1 ? (size_t)cSubBufs * RTTRACEBUF_ALIGNMENT : 0;
+    }
+    uint32_t cEntriesPerSub = cEntries / cSubBufs;
+    if (cEntriesPerSub < RTTRACEBUF_MIN_ENTRIES)
+        cEntriesPerSub = RTTRACEBUF_MIN_ENTRIES;
+    cEntries = cEntriesPerSub * cSubBufs;
+
     uint32_t offVolatile = RTTRACEBUF_ALIGNMENT - ((uintptr_t)pvBlock & (RTTRACEBUF_ALIGNMENT - 1));
     if (offVolatile < sizeof(RTTRACEBUFINT))
         offVolatile += RTTRACEBUF_ALIGNMENT;
     size_t cbReqBlock = offVolatile
                       + RT_ALIGN_Z(sizeof(RTTRACEBUFVOLATILE), RTTRACEBUF_ALIGNMENT)
-                      + cbEntry * cEntries;
+                      + cbHeads
+                      + (size_t)cbEntry * cEntries;
     if (*pcbBlock < cbReqBlock)
     {
         *pcbBlock = cbReqBlock;
@@ -425,7 +570,13 @@ RTDECL(int) RTTraceBufCarve(PRTTRACEBUF phTraceBuf, uint32_t cEntries, uint32_t
     pThis->cEntries         = cEntries;
     pThis->fFlags           = fFlags;
     pThis->offVolatile      = offVolatile;
-    pThis->offEntries       = offVolatile + RT_ALIGN_Z(sizeof(RTTRACEBUFVOLATILE), RTTRACEBUF_ALIGNMENT);
+    pThis->cSubBufs         = cSubBufs;
+    pThis->cEntriesPerSub   = cEntriesPerSub;
+    if (cSubBufs > 1)
+        pThis->offHeads     = offVolatile + RT_ALIGN_32(sizeof(RTTRACEBUFVOLATILE), RTTRACEBUF_ALIGNMENT);
+    else
+        pThis->offHeads     = offVolatile + RT_OFFSETOF(RTTRACEBUFVOLATILE, iEntry);
+    pThis->offEntries       = offVolatile + RT_ALIGN_32(sizeof(RTTRACEBUFVOLATILE), RTTRACEBUF_ALIGNMENT) + (uint32_t)cbHeads;
 
     PRTTRACEBUFVOLATILE pVolatile = (PRTTRACEBUFVOLATILE)((uint8_t *)pThis + offVolatile);
     pVolatile->cRefs        = 1;
@@ -562,33 +713,199 @@ RTDECL(int) RTTraceBufAddPosMsgV(RTTRACEBUF hTraceBuf, RT_SRC_POS_DECL, const ch
 }
 
 
-RTDECL(int) RTTraceBufEnumEntries(RTTRACEBUF hTraceBuf, PFNRTTRACEBUFCALLBACK pfnCallback, void *pvUser)
+RTDECL(int) RTTraceBufAddEvent(RTTRACEBUF hTraceBuf, uint32_t idEvent,
+                               uint64_t uArg1, uint64_t uArg2, uint64_t uArg3, uint64_t uArg4)
 {
-    int                 rc = VINF_SUCCESS;
-    uint32_t            iBase;
-    uint32_t            cLeft;
-    PCRTTRACEBUFINT     pThis;
-    RTTRACEBUF_RESOLVE_VALIDATE_RETAIN_RETURN(hTraceBuf, pThis);
+    AssertReturn(idEvent != RTTRACEBUF_EVENT_ID_MSG, VERR_INVALID_PARAMETER);
+    RTTRACEBUF_ADD_PROLOGUE_EX(hTraceBuf, idEvent);
+    pEntry->u.Evt.cArgs       = 4;
+    pEntry->u.Evt.au64Args[0] = uArg1;
+    pEntry->u.Evt.au64Args[1] = uArg2;
+    pEntry->u.Evt.au64Args[2] = uArg3;
+    pEntry->u.Evt.au64Args[3] = uArg4;
+    RTTRACEBUF_ADD_EPILOGUE();
+}
 
-    iBase = ASMAtomicReadU32(&RTTRACEBUF_TO_VOLATILE(pThis)->iEntry);
-    cLeft = pThis->cEntries;
-    while (cLeft--)
+
+RTDECL(int) RTTraceBufAddEventEx(RTTRACEBUF hTraceBuf, uint32_t idEvent, uint64_t const *pau64Args, uint32_t cArgs)
+{
+    AssertReturn(idEvent != RTTRACEBUF_EVENT_ID_MSG, VERR_INVALID_PARAMETER);
+    AssertReturn(RT_VALID_PTR(pau64Args) || !cArgs, VERR_INVALID_POINTER);
+    RTTRACEBUF_ADD_PROLOGUE_EX(hTraceBuf, idEvent);
+    uint32_t const cMaxArgs = RTTRACEBUF_MAX_EVENT_ARGS(pThis);
+    if (cArgs > cMaxArgs)
     {
-        PRTTRACEBUFENTRY pEntry;
+        cArgs = cMaxArgs;
+        rc    = VERR_BUFFER_OVERFLOW;
+    }
+    pEntry->u.Evt.cArgs = cArgs;
+    for (uint32_t iArg = 0; iArg < cArgs; iArg++)
+        pEntry->u.Evt.au64Args[iArg] = pau64Args[iArg];
+    RTTRACEBUF_ADD_EPILOGUE();
+}
 
-        iBase %= pThis->cEntries;
-        pEntry = RTTRACEBUF_TO_ENTRY(pThis, iBase);
-        if (pEntry->NanoTS)
+
+/**
+ * Enumerates the used entries of all sub-buffers, merging them in time stamp
+ * order.
+ *
+ * Each sub-buffer is walked from its oldest entry, and the sub-buffer whose
+ * current entry has the lowest time stamp is picked next.  Entries that are
+ * being written while we're at it may come out slightly out of order, just
+ * like they may be garbled in a single ring.
+ *
+ * @returns IPRT status code, the first callback status other than
+ *          VINF_SUCCESS.
+ * @param   pThis           The trace buffer (referenced).
+ * @param   pfnCallback     The callback.
+ * @param   pvUser          The user argument for the callback.
+ */
+static int rtTraceBufEnumWorker(PCRTTRACEBUFINT pThis, PFNRTTRACEBUFRECCALLBACK pfnCallback, void *pvUser)
+{
+    uint32_t const  cSubBufs       = pThis->cSubBufs;
+    uint32_t const  cEntriesPerSub = pThis->cEntriesPerSub;
+    uint32_t        aiNext[RTTRACEBUF_MAX_SUB_BUFS];
+    uint32_t        acLeft[RTTRACEBUF_MAX_SUB_BUFS];
+    uint32_t        cLeft = pThis->cEntries;
+    AssertReturn(cSubBufs <= RTTRACEBUF_MAX_SUB_BUFS, VERR_INTERNAL_ERROR_2);
+
+    for (uint32_t iSub = 0; iSub < cSubBufs; iSub++)
+    {
+        aiNext[iSub] = ASMAtomicReadU32(RTTRACEBUF_TO_HEAD(pThis, iSub)) % cEntriesPerSub;
+        acLeft[iSub] = cEntriesPerSub;
+    }
+
+    for (;;)
+    {
+        /*
+         * Pick the sub-buffer with the oldest entry, skipping unused ones.
+         */
+        uint32_t         iBest  = UINT32_MAX;
+        uint64_t         uBest  = UINT64_MAX;
+        PRTTRACEBUFENTRY pBest  = NULL;
+        for (uint32_t iSub = 0; iSub < cSubBufs; iSub++)
+            while (acLeft[iSub])
+            {
+                PRTTRACEBUFENTRY pEntry = RTTRACEBUF_TO_ENTRY(pThis, iSub, aiNext[iSub]);
+                uint64_t const   NanoTS = pEntry->NanoTS;
+                if (NanoTS)
+                {
+                    if (NanoTS < uBest)
+                    {
+                        uBest = NanoTS;
+                        iBest = iSub;
+                        pBest = pEntry;
+                    }
+                    break;
+                }
+                aiNext[iSub] = (aiNext[iSub] + 1) % cEntriesPerSub;
+                acLeft[iSub]--;
+                cLeft--;
+            }
+        if (iBest == UINT32_MAX)
+            break;
+        aiNext[iBest] = (aiNext[iBest] + 1) % cEntriesPerSub;
+        acLeft[iBest]--;
+        cLeft--;
+
+        /*
+         * Hand it to the callback.
+         */
+        RTTRACEBUFRECORD Rec;
+        Rec.NanoTS  = uBest;
+        Rec.idCpu   = pBest->idCpu;
+        Rec.idEvent = pBest->idEvent;
+        if (Rec.idEvent == RTTRACEBUF_EVENT_ID_MSG)
         {
-            rc = pfnCallback((RTTRACEBUF)pThis, cLeft, pEntry->NanoTS, pEntry->idCpu, pEntry->szMsg, pvUser);
-            if (rc != VINF_SUCCESS)
-                break;
+            Rec.cArgs     = 0;
+            Rec.pau64Args = NULL;
+            Rec.pszMsg    = pBest->u.szMsg;
         }
-
-        /* next */
-        iBase += 1;
+        else
+        {
+            Rec.cArgs     = RT_MIN(pBest->u.Evt.cArgs, RTTRACEBUF_MAX_EVENT_ARGS(pThis));
+            Rec.pau64Args = &pBest->u.Evt.au64Args[0];
+            Rec.pszMsg    = NULL;
+        }
+        int rc = pfnCallback((RTTRACEBUF)pThis, cLeft, &Rec, pvUser);
+        if (rc != VINF_SUCCESS)
+            return rc;
     }
 
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Formats a binary event record as text.
+ *
+ * @returns Pointer to the text, either @a pszBuf or the message text.
+ * @param   pRecord     The record.
+ * @param   pszBuf      The output buffer.
+ * @param   cbBuf       The size of the output buffer.
+ */
+static const char *rtTraceBufFormatRecord(PCRTTRACEBUFRECORD pRecord, char *pszBuf, size_t cbBuf)
+{
+    if (pRecord->pszMsg)
+        return pRecord->pszMsg;
+
+    size_t off = RTStrPrintf(pszBuf, cbBuf, "event %#x:", pRecord->idEvent);
+    for (uint32_t iArg = 0; iArg < pRecord->cArgs && off < cbBuf - 1; iArg++)
+        off += RTStrPrintf(&pszBuf[off], cbBuf - off, " %#RX64", pRecord->pau64Args[iArg]);
+    return pszBuf;
+}
+
+
+RTDECL(int) RTTraceBufEnumRecords(RTTRACEBUF hTraceBuf, PFNRTTRACEBUFRECCALLBACK pfnCallback, void *pvUser)
+{
+    int                 rc;
+    PCRTTRACEBUFINT     pThis;
+    AssertPtrReturn(pfnCallback, VERR_INVALID_POINTER);
+    RTTRACEBUF_RESOLVE_VALIDATE_RETAIN_RETURN(hTraceBuf, pThis);
+
+    rc = rtTraceBufEnumWorker(pThis, pfnCallback, pvUser);
+
+    RTTRACEBUF_DROP_REFERENCE(pThis);
+    return rc;
+}
+
+
+/**
+ * Argument package for rtTraceBufEnumEntriesCallback.
+ */
+typedef struct RTTRACEBUFENUMENTRIESARGS
+{
+    PFNRTTRACEBUFCALLBACK   pfnCallback;
+    void                   *pvUser;
+} RTTRACEBUFENUMENTRIESARGS;
+
+
+/**
+ * @callback_method_impl{FNRTTRACEBUFRECCALLBACK,
+ *      Formats binary events and passes the record on to a FNRTTRACEBUFCALLBACK.}
+ */
+static DECLCALLBACK(int) rtTraceBufEnumEntriesCallback(RTTRACEBUF hTraceBuf, uint32_t iEntry, PCRTTRACEBUFRECORD pRecord,
+                                                       void *pvUser)
+{
+    RTTRACEBUFENUMENTRIESARGS *pArgs = (RTTRACEBUFENUMENTRIESARGS *)pvUser;
+    char szTmp[256];
+    return pArgs->pfnCallback(hTraceBuf, iEntry, pRecord->NanoTS, pRecord->idCpu,
+                              rtTraceBufFormatRecord(pRecord, szTmp, sizeof(szTmp)), pArgs->pvUser);
+}
+
+
+RTDECL(int) RTTraceBufEnumEntries(RTTRACEBUF hTraceBuf, PFNRTTRACEBUFCALLBACK pfnCallback, void *pvUser)
+{
+    int                         rc;
+    PCRTTRACEBUFINT             pThis;
+    RTTRACEBUFENUMENTRIESARGS   Args;
+    AssertPtrReturn(pfnCallback, VERR_INVALID_POINTER);
+    RTTRACEBUF_RESOLVE_VALIDATE_RETAIN_RETURN(hTraceBuf, pThis);
+
+    Args.pfnCallback = pfnCallback;
+    Args.pvUser      = pvUser;
+    rc = rtTraceBufEnumWorker(pThis, rtTraceBufEnumEntriesCallback, &Args);
+
     RTTRACEBUF_DROP_REFERENCE(pThis);
     return rc;
 }
@@ -610,6 +927,14 @@ RTDECL(uint32_t) RTTraceBufGetEntryCount(RTTRACEBUF hTraceBuf)
 }
 
 
+RTDECL(uint32_t) RTTraceBufGetMaxEventArgs(RTTRACEBUF hTraceBuf)
+{
+    PCRTTRACEBUFINT pThis = hTraceBuf;
+    RTTRACEBUF_VALID_RETURN_RC(pThis, 0);
+    return RTTRACEBUF_MAX_EVENT_ARGS(pThis);
+}
+
+
 RTDECL(bool) RTTraceBufDisable(RTTRACEBUF hTraceBuf)
 {
     PCRTTRACEBUFINT pThis = hTraceBuf;
@@ -628,58 +953,57 @@ RTDECL(bool) RTTraceBufEnable(RTTRACEBUF hTraceBuf)
 
 /*
  *
- * Move the following to a separate file, consider using the enumerator.
+ * Move the following to a separate file.
  *
  */
 
+/**
+ * @callback_method_impl{FNRTTRACEBUFRECCALLBACK, Dumps a record to the log.}
+ */
+static DECLCALLBACK(int) rtTraceBufDumpToLogCallback(RTTRACEBUF hTraceBuf, uint32_t iEntry, PCRTTRACEBUFRECORD pRecord,
+                                                     void *pvUser)
+{
+    char szTmp[256];
+    RTLogPrintf("%04u/%'llu/%02x: %s\n", iEntry, pRecord->NanoTS, pRecord->idCpu,
+                rtTraceBufFormatRecord(pRecord, szTmp, sizeof(szTmp)));
+    NOREF(hTraceBuf); NOREF(pvUser);
+    return VINF_SUCCESS;
+}
+
+
 RTDECL(int) RTTraceBufDumpToLog(RTTRACEBUF hTraceBuf)
 {
-    uint32_t            iBase;
-    uint32_t            cLeft;
     PCRTTRACEBUFINT     pThis;
     RTTRACEBUF_RESOLVE_VALIDATE_RETAIN_RETURN(hTraceBuf, pThis);
 
-    iBase = ASMAtomicReadU32(&RTTRACEBUF_TO_VOLATILE(pThis)->iEntry);
-    cLeft = pThis->cEntries;
-    while (cLeft--)
-    {
-        PRTTRACEBUFENTRY pEntry;
+    rtTraceBufEnumWorker(pThis, rtTraceBufDumpToLogCallback, NULL);
 
-        iBase %= pThis->cEntries;
-        pEntry = RTTRACEBUF_TO_ENTRY(pThis, iBase);
-        if (pEntry->NanoTS)
-            RTLogPrintf("%04u/%'llu/%02x: %s\n", cLeft, pEntry->NanoTS, pEntry->idCpu, pEntry->szMsg);
+    RTTRACEBUF_DROP_REFERENCE(pThis);
+    return VINF_SUCCESS;
+}
 
-        /* next */
-        iBase += 1;
-    }
 
-    RTTRACEBUF_DROP_REFERENCE(pThis);
+/**
+ * @callback_method_impl{FNRTTRACEBUFRECCALLBACK, Dumps a record to the assertion
+ *      message.}
+ */
+static DECLCALLBACK(int) rtTraceBufDumpToAssertCallback(RTTRACEBUF hTraceBuf, uint32_t iEntry, PCRTTRACEBUFRECORD pRecord,
+                                                        void *pvUser)
+{
+    char szTmp[256];
+    RTAssertMsg2AddWeak("%u/%'llu/%02x: %s\n", iEntry, pRecord->NanoTS, pRecord->idCpu,
+                        rtTraceBufFormatRecord(pRecord, szTmp, sizeof(szTmp)));
+    NOREF(hTraceBuf); NOREF(pvUser);
     return VINF_SUCCESS;
 }
 
 
 RTDECL(int) RTTraceBufDumpToAssert(RTTRACEBUF hTraceBuf)
 {
-    uint32_t            iBase;
-    uint32_t            cLeft;
     PCRTTRACEBUFINT     pThis;
     RTTRACEBUF_RESOLVE_VALIDATE_RETAIN_RETURN(hTraceBuf, pThis);
 
-    iBase = ASMAtomicReadU32(&RTTRACEBUF_TO_VOLATILE(pThis)->iEntry);
-    cLeft = pThis->cEntries;
-    while (cLeft--)
-    {
-        PRTTRACEBUFENTRY pEntry;
-
-        iBase %= pThis->cEntries;
-        pEntry = RTTRACEBUF_TO_ENTRY(pThis, iBase);
-        if (pEntry->NanoTS)
-            RTAssertMsg2AddWeak("%u/%'llu/%02x: %s\n", cLeft, pEntry->NanoTS, pEntry->idCpu, pEntry->szMsg);
-
-        /* next */
-        iBase += 1;
-    }
+    rtTraceBufEnumWorker(pThis, rtTraceBufDumpToAssertCallback, NULL);
 
     RTTRACEBUF_DROP_REFERENCE(pThis);
     return VINF_SUCCESS;
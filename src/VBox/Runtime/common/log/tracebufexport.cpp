@@ -0,0 +1,205 @@
+/* $Id$ */
+/** @file
+ * IPRT - Tracebuffer export to the Chrome trace event format.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include "internal/iprt.h"
+#include <iprt/trace.h>
+
+#include <iprt/assert.h>
+#include <iprt/err.h>
+#include <iprt/string.h>
+
+
+/*********************************************************************************************************************************
+*   Structures and Typedefs                                                                                                      *
+*********************************************************************************************************************************/
+/**
+ * Export state.
+ */
+typedef struct RTTRACEBUFEXPORTSTATE
+{
+    /** The event descriptors. */
+    PCRTTRACEBUFEVTDESC     paDescs;
+    /** Number of event descriptors. */
+    uint32_t                cDescs;
+    /** Number of records written so far. */
+    uint32_t                cRecords;
+    /** The output function. */
+    PFNRTDUMPPRINTFV        pfnPrintfV;
+    /** The user argument for the output function. */
+    void                   *pvUser;
+} RTTRACEBUFEXPORTSTATE;
+/** Pointer to the export state. */
+typedef RTTRACEBUFEXPORTSTATE *PRTTRACEBUFEXPORTSTATE;
+
+
+/**
+ * Printf wrapper for the output function.
+ *
+ * @param   pState      The export state.
+ * @param   pszFormat   The format string.
+ * @param   ...         Format arguments.
+ */
+static void rtTraceBufExportPrintf(PRTTRACEBUFEXPORTSTATE pState, const char *pszFormat, ...)
+{
+    va_list va;
+    va_start(va, pszFormat);
+    pState->pfnPrintfV(pState->pvUser, pszFormat, va);
+    va_end(va);
+}
+
+
+/**
+ * Outputs a JSON string literal.
+ *
+ * @param   pState      The export state.
+ * @param   psz         The string.
+ */
+static void rtTraceBufExportString(PRTTRACEBUFEXPORTSTATE pState, const char *psz)
+{
+    char    szBuf[256];
+    size_t  off = 0;
+    szBuf[off++] = '"';
+    for (;;)
+    {
+        /* Flush when there may not be room for the longest escape sequence. */
+        if (off >= sizeof(szBuf) - 8)
+        {
+            szBuf[off] = '\0';
+            rtTraceBufExportPrintf(pState, "%s", szBuf);
+            off = 0;
+        }
+
+        unsigned char const uch = (unsigned char)*psz++;
+        if (!uch)
+            break;
+        if (uch == '"' || uch == '\\')
+        {
+            szBuf[off++] = '\\';
+            szBuf[off++] = (char)uch;
+        }
+        else if (uch < 0x20)
+            off += RTStrPrintf(&szBuf[off], sizeof(szBuf) - off, "\\u%04x", uch);
+        else
+            szBuf[off++] = (char)uch;
+    }
+    szBuf[off++] = '"';
+    szBuf[off]   = '\0';
+    rtTraceBufExportPrintf(pState, "%s", szBuf);
+}
+
+
+/**
+ * @callback_method_impl{FNRTTRACEBUFRECCALLBACK, Exports one record.}
+ */
+static DECLCALLBACK(int) rtTraceBufExportChromeRecord(RTTRACEBUF hTraceBuf, uint32_t iEntry, PCRTTRACEBUFRECORD pRecord,
+                                                      void *pvUser)
+{
+    PRTTRACEBUFEXPORTSTATE pState = (PRTTRACEBUFEXPORTSTATE)pvUser;
+    NOREF(hTraceBuf); NOREF(iEntry);
+
+    /*
+     * Look up the event descriptor.
+     */
+    PCRTTRACEBUFEVTDESC pDesc = NULL;
+    if (pRecord->idEvent != RTTRACEBUF_EVENT_ID_MSG)
+        for (uint32_t i = 0; i < pState->cDescs; i++)
+            if (pState->paDescs[i].idEvent == pRecord->idEvent)
+            {
+                pDesc = &pState->paDescs[i];
+                break;
+            }
+
+    /*
+     * The common part.  The time stamp is in microseconds.
+     */
+    rtTraceBufExportPrintf(pState, "%s\n{\"name\":", pState->cRecords ? "," : "");
+    if (pRecord->idEvent == RTTRACEBUF_EVENT_ID_MSG)
+        rtTraceBufExportPrintf(pState, "\"msg\"");
+    else if (pDesc && pDesc->pszName)
+        rtTraceBufExportString(pState, pDesc->pszName);
+    else
+        rtTraceBufExportPrintf(pState, "\"event-%#x\"", pRecord->idEvent);
+    if (pDesc && pDesc->pszCategory)
+    {
+        rtTraceBufExportPrintf(pState, ",\"cat\":");
+        rtTraceBufExportString(pState, pDesc->pszCategory);
+    }
+    rtTraceBufExportPrintf(pState, ",\"ph\":\"i\",\"s\":\"t\",\"ts\":%RU64.%03u,\"pid\":0,\"tid\":%u,\"args\":{",
+                           pRecord->NanoTS / RT_NS_1US, (unsigned)(pRecord->NanoTS % RT_NS_1US), pRecord->idCpu);
+
+    /*
+     * The arguments.
+     */
+    if (pRecord->idEvent == RTTRACEBUF_EVENT_ID_MSG)
+    {
+        rtTraceBufExportPrintf(pState, "\"msg\":");
+        rtTraceBufExportString(pState, pRecord->pszMsg);
+    }
+    else
+    {
+        uint32_t const cArgs = pDesc ? RT_MIN(pDesc->cArgs, pRecord->cArgs) : pRecord->cArgs;
+        for (uint32_t iArg = 0; iArg < cArgs; iArg++)
+        {
+            if (pDesc && pDesc->papszArgNames && pDesc->papszArgNames[iArg])
+            {
+                rtTraceBufExportPrintf(pState, "%s", iArg ? "," : "");
+                rtTraceBufExportString(pState, pDesc->papszArgNames[iArg]);
+            }
+            else
+                rtTraceBufExportPrintf(pState, "%s\"arg%u\"", iArg ? "," : "", iArg + 1);
+            rtTraceBufExportPrintf(pState, ":%RU64", pRecord->pau64Args[iArg]);
+        }
+    }
+    rtTraceBufExportPrintf(pState, "}}");
+
+    pState->cRecords++;
+    return VINF_SUCCESS;
+}
+
+
+RTDECL(int) RTTraceBufExportChromeTrace(RTTRACEBUF hTraceBuf, PCRTTRACEBUFEVTDESC paDescs, uint32_t cDescs,
+                                        PFNRTDUMPPRINTFV pfnPrintfV, void *pvUser)
+{
+    AssertReturn(RT_VALID_PTR(paDescs) || !cDescs, VERR_INVALID_POINTER);
+    AssertPtrReturn(pfnPrintfV, VERR_INVALID_POINTER);
+
+    RTTRACEBUFEXPORTSTATE State;
+    State.paDescs    = paDescs;
+    State.cDescs     = cDescs;
+    State.cRecords   = 0;
+    State.pfnPrintfV = pfnPrintfV;
+    State.pvUser     = pvUser;
+
+    rtTraceBufExportPrintf(&State, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    int rc = RTTraceBufEnumRecords(hTraceBuf, rtTraceBufExportChromeRecord, &State);
+    rtTraceBufExportPrintf(&State, "\n]}\n");
+    return rc;
+}
+
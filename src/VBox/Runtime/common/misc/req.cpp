@@ -80,6 +80,8 @@ DECLHIDDEN(int) rtReqAlloc(RTREQTYPE enmType, bool fPoolOrQueue, void *pvOwner,
     pReq->iStatusX          = VERR_RT_REQUEST_STATUS_STILL_PENDING;
     pReq->enmState          = RTREQSTATE_ALLOCATED;
     pReq->pNext             = NULL;
+    pReq->pContinuations    = NULL;
+    pReq->pNextContinuation = NULL;
     pReq->uOwner.pv         = pvOwner;
     pReq->fFlags            = RTREQFLAGS_IPRT_STATUS;
     pReq->enmType           = enmType;
@@ -136,6 +138,8 @@ DECLHIDDEN(int) rtReqReInit(PRTREQINT pReq, RTREQTYPE enmType)
      * Initialize the packet and return it.
      */
     ASMAtomicWriteNullPtr(&pReq->pNext);
+    ASMAtomicWriteNullPtr(&pReq->pContinuations);
+    pReq->pNextContinuation = NULL;
     pReq->iStatusX = VERR_RT_REQUEST_STATUS_STILL_PENDING;
     pReq->enmState = RTREQSTATE_ALLOCATED;
     pReq->fFlags   = RTREQFLAGS_IPRT_STATUS;
@@ -296,6 +300,18 @@ RTDECL(int) RTReqWait(PRTREQ hReq, RTMSINTERVAL cMillies)
                      pReq->enmType, RTREQTYPE_INVALID + 1, RTREQTYPE_MAX - 1),
                     VERR_RT_REQUEST_INVALID_TYPE);
 
+    /*
+     * Don't block if an earlier wait (e.g. a poll) consumed the completion
+     * signal already.  If the signal is still on its way, rtReqReInit will
+     * take care of it when the request is recycled.
+     */
+    if (   pReq->enmState == RTREQSTATE_COMPLETED
+        && ASMAtomicReadBool(&pReq->fEventSemClear))
+    {
+        LogFlow(("RTReqWait: returns VINF_SUCCESS (already completed)\n"));
+        return VINF_SUCCESS;
+    }
+
     /*
      * Wait on the package.
      */
@@ -304,6 +320,8 @@ RTDECL(int) RTReqWait(PRTREQ hReq, RTMSINTERVAL cMillies)
         rc = RTSemEventWait(pReq->EventSem, cMillies);
     else
     {
+        if (pReq->fPoolOrQueue)
+            rtReqPoolHelpWhileWaiting(pReq);
         do
         {
             rc = RTSemEventWait(pReq->EventSem, RT_INDEFINITE_WAIT);
@@ -469,6 +487,7 @@ DECLHIDDEN(int) rtReqProcessOne(PRTREQINT pReq)
             rcRet = rc2;
         }
     }
+    rtReqPoolRunContinuations(pReq);
     RTReqRelease(pReq);
     return rcRet;
 }
@@ -33,10 +33,13 @@
 
 #include <iprt/assert.h>
 #include <iprt/asm.h>
+#include <iprt/cpuset.h>
 #include <iprt/critsect.h>
 #include <iprt/list.h>
 #include <iprt/log.h>
 #include <iprt/mem.h>
+#include <iprt/mp.h>
+#include <iprt/once.h>
 #include <iprt/string.h>
 #include <iprt/time.h>
 #include <iprt/semaphore.h>
@@ -55,6 +58,17 @@
 #define RTREQPOOL_PUSH_BACK_MAX_MS      RT_MS_1MIN
 /** The max number of free requests to keep around. */
 #define RTREQPOOL_MAX_FREE_REQUESTS     (RTREQPOOL_MAX_THREADS * 2U)
+/** The number of entries in a worker thread's work stealing deque.  Must be a
+ * power of two.  Requests that don't fit go to the shared queue. */
+#define RTREQPOOL_DEQUE_SIZE            256U
+
+/** @name Shared queue priority segments, RTREQPOOLINT::apPendingTails indexes.
+ * @{ */
+#define RTREQPOOL_PRIO_HIGH             0
+#define RTREQPOOL_PRIO_NORMAL           1
+#define RTREQPOOL_PRIO_LOW              2
+#define RTREQPOOL_PRIO_COUNT            3
+/** @} */
 
 
 /*********************************************************************************************************************************
@@ -91,11 +105,26 @@ typedef struct RTREQPOOLTHREAD
 
     /** The thread handle. */
     RTTHREAD                hThread;
+    /** The CPU the thread should bind itself to, NIL_RTCPUID if none. */
+    RTCPUID                 idBindCpu;
     /** Nano seconds timestamp representing the birth time of the thread.  */
     uint64_t                uBirthNanoTs;
     /** Pointer to the request thread pool instance the thread is associated
      *  with. */
     struct RTREQPOOLINT    *pPool;
+
+    /** @name Work stealing deque.
+     * The owner pushes and pops at the bottom without any locking, other
+     * workers steal from the top while owning the pool critical section
+     * (Chase & Lev, with a fixed size ring).
+     * @{ */
+    /** The steal end, only ever incremented. */
+    uint32_t volatile       iDequeTop;
+    /** The owner end. */
+    uint32_t volatile       iDequeBottom;
+    /** The request ring, indexed by iDequeTop/iDequeBottom modulo its size. */
+    PRTREQINT volatile      apDeque[RTREQPOOL_DEQUE_SIZE];
+    /** @} */
 } RTREQPOOLTHREAD;
 /** Pointer to a worker thread. */
 typedef RTREQPOOLTHREAD *PRTREQPOOLTHREAD;
@@ -136,6 +165,10 @@ typedef struct RTREQPOOLINT
     uint32_t                cMsMinPushBack;
     /** The max number of free requests in the recycle LIFO. */
     uint32_t                cMaxFreeRequests;
+    /** Whether to bind new worker threads to a CPU. */
+    bool                    fBindToCpus;
+    /** Whether waiting worker threads process other requests meanwhile. */
+    bool                    fHelpWhileWaiting;
     /** @}  */
 
     /** Signaled by terminating worker threads. */
@@ -153,6 +186,9 @@ typedef struct RTREQPOOLINT
     uint32_t                cThreadsCreated;
     /** Statistics: The timestamp when the last thread was created. */
     uint64_t                uLastThreadCreateNanoTs;
+    /** The CPU set index to start looking for the next CPU to bind a worker
+     * thread to. */
+    uint32_t                iNextBindCpu;
     /** Linked list of worker threads. */
     RTLISTANCHOR            WorkerThreads;
 
@@ -173,16 +209,22 @@ typedef struct RTREQPOOLINT
     /** Linked list of idle threads. */
     RTLISTANCHOR            IdleThreads;
 
-    /** Head of the request FIFO. */
+    /** Head of the request FIFO.  High priority requests first, then normal
+     * and finally low priority ones. */
     PRTREQINT               pPendingRequests;
-    /** Where to insert the next request. */
-    PRTREQINT              *ppPendingRequests;
-    /** The number of requests currently pending. */
+    /** Where to insert the next request of each priority (RTREQPOOL_PRIO_XXX),
+     * i.e. the tails of the priority segments of the FIFO. */
+    PRTREQINT              *apPendingTails[RTREQPOOL_PRIO_COUNT];
+    /** The number of requests currently pending in the FIFO. */
     uint32_t                cCurPendingRequests;
     /** The number of requests currently being executed. */
     uint32_t volatile       cCurActiveRequests;
     /** The number of requests submitted. */
-    uint64_t                cReqSubmitted;
+    uint64_t volatile       cReqSubmitted;
+    /** The number of requests worker threads have put in their own deque. */
+    uint64_t volatile       cReqWorkerQueued;
+    /** The number of requests stolen from other workers' deques. */
+    uint64_t                cReqStolen;
 
     /** Head of the request recycling LIFO. */
     PRTREQINT               pFreeRequests;
@@ -196,6 +238,240 @@ typedef struct RTREQPOOLINT
 } RTREQPOOLINT;
 
 
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
+/** Makes sure g_iReqPoolTls is allocated once. */
+static RTONCE           g_ReqPoolTlsOnce = RTONCE_INITIALIZER;
+/** TLS entry pointing to the RTREQPOOLTHREAD of the calling worker thread. */
+static RTTLS            g_iReqPoolTls    = NIL_RTTLS;
+
+
+/**
+ * @callback_method_impl{FNRTONCE, Allocates g_iReqPoolTls.}
+ */
+static DECLCALLBACK(int) rtReqPoolTlsInitOnce(void *pvUser)
+{
+    NOREF(pvUser);
+    return RTTlsAllocEx(&g_iReqPoolTls, NULL);
+}
+
+
+/**
+ * Gets the worker thread structure of the calling thread if it belongs to the
+ * given pool.
+ *
+ * @returns Pointer to the worker thread structure, NULL if not a worker thread
+ *          of @a pPool.
+ * @param   pPool               The pool.
+ */
+DECLINLINE(PRTREQPOOLTHREAD) rtReqPoolCurWorker(PRTREQPOOLINT pPool)
+{
+    if (g_iReqPoolTls != NIL_RTTLS)
+    {
+        PRTREQPOOLTHREAD pThread = (PRTREQPOOLTHREAD)RTTlsGet(g_iReqPoolTls);
+        if (pThread && pThread->pPool == pPool)
+            return pThread;
+    }
+    return NULL;
+}
+
+
+/**
+ * Pushes a request onto the bottom of the calling worker thread's deque.
+ *
+ * @returns true on success, false if the deque is full.
+ * @param   pThread             The calling worker thread.
+ * @param   pReq                The request.
+ */
+static bool rtReqPoolDequePush(PRTREQPOOLTHREAD pThread, PRTREQINT pReq)
+{
+    uint32_t const iBottom = ASMAtomicUoReadU32(&pThread->iDequeBottom);
+    uint32_t const iTop    = ASMAtomicReadU32(&pThread->iDequeTop);
+    if (iBottom - iTop >= RTREQPOOL_DEQUE_SIZE)
+        return false;
+    ASMAtomicWritePtr(&pThread->apDeque[iBottom % RTREQPOOL_DEQUE_SIZE], pReq);
+    ASMAtomicWriteU32(&pThread->iDequeBottom, iBottom + 1);
+    return true;
+}
+
+
+/**
+ * Pops the most recently pushed request off the calling worker thread's
+ * deque.
+ *
+ * @returns The request, NULL if the deque is empty.
+ * @param   pThread             The calling worker thread.
+ */
+static PRTREQINT rtReqPoolDequePop(PRTREQPOOLTHREAD pThread)
+{
+    /* Reserve the bottom entry before looking at the top, the write is a full
+       fence so a thief either sees the reservation or we see its steal. */
+    uint32_t const iBottom = ASMAtomicUoReadU32(&pThread->iDequeBottom) - 1;
+    ASMAtomicWriteU32(&pThread->iDequeBottom, iBottom);
+    uint32_t const iTop    = ASMAtomicReadU32(&pThread->iDequeTop);
+    int32_t const  cLeft   = (int32_t)(iBottom - iTop);
+    if (cLeft < 0)
+    {
+        ASMAtomicWriteU32(&pThread->iDequeBottom, iTop);
+        return NULL;
+    }
+
+    PRTREQINT pReq = ASMAtomicUoReadPtrT(&pThread->apDeque[iBottom % RTREQPOOL_DEQUE_SIZE], PRTREQINT);
+    if (cLeft > 0)
+        return pReq;
+
+    /* The last entry, race the thieves for it. */
+    if (!ASMAtomicCmpXchgU32(&pThread->iDequeTop, iTop + 1, iTop))
+        pReq = NULL;
+    ASMAtomicWriteU32(&pThread->iDequeBottom, iTop + 1);
+    return pReq;
+}
+
+
+/**
+ * Steals the oldest request from another worker thread's deque.
+ *
+ * @returns The request, NULL if the deque is empty.
+ * @param   pVictim             The worker thread to steal from.
+ * @remarks Caller owns the critical section, so thieves never race one
+ *          another, only the owner.
+ */
+static PRTREQINT rtReqPoolDequeSteal(PRTREQPOOLTHREAD pVictim)
+{
+    for (;;)
+    {
+        uint32_t const iTop    = ASMAtomicReadU32(&pVictim->iDequeTop);
+        uint32_t const iBottom = ASMAtomicReadU32(&pVictim->iDequeBottom);
+        if ((int32_t)(iBottom - iTop) <= 0)
+            return NULL;
+        PRTREQINT pReq = ASMAtomicReadPtrT(&pVictim->apDeque[iTop % RTREQPOOL_DEQUE_SIZE], PRTREQINT);
+        if (ASMAtomicCmpXchgU32(&pVictim->iDequeTop, iTop + 1, iTop))
+            return pReq;
+    }
+}
+
+
+/**
+ * Steals a request from one of the other worker threads.
+ *
+ * The search starts with the thread following the thief in the worker list.
+ * With RTREQPOOLCFGVAR_BIND_TO_CPUS that is the one bound to the next CPU set
+ * index, which is usually a close one as far as caches and memory go.
+ *
+ * @returns The request, NULL if nothing to steal.
+ * @param   pPool               The pool.
+ * @param   pThief              The calling worker thread.
+ * @remarks Caller owns the critical section.
+ */
+static PRTREQINT rtReqPoolStealLocked(PRTREQPOOLINT pPool, PRTREQPOOLTHREAD pThief)
+{
+    PRTLISTNODE pNode = &pThief->ListNode;
+    for (;;)
+    {
+        pNode = pNode->pNext;
+        if (pNode == &pThief->ListNode)
+            return NULL;
+        if (pNode == &pPool->WorkerThreads)
+            continue;
+        PRTREQINT pReq = rtReqPoolDequeSteal(RT_FROM_MEMBER(pNode, RTREQPOOLTHREAD, ListNode));
+        if (pReq)
+        {
+            pPool->cReqStolen++;
+            return pReq;
+        }
+    }
+}
+
+
+/**
+ * Maps the RTREQFLAGS_PRIORITY_XXX flags to a RTREQPOOL_PRIO_XXX value.
+ *
+ * @returns RTREQPOOL_PRIO_XXX.
+ * @param   fFlags              The request flags.
+ */
+DECLINLINE(unsigned) rtReqPoolPriority(uint32_t fFlags)
+{
+    if (fFlags & RTREQFLAGS_PRIORITY_HIGH)
+        return RTREQPOOL_PRIO_HIGH;
+    if (fFlags & RTREQFLAGS_PRIORITY_LOW)
+        return RTREQPOOL_PRIO_LOW;
+    return RTREQPOOL_PRIO_NORMAL;
+}
+
+
+/**
+ * Inserts a request into the shared FIFO according to its priority.
+ *
+ * @param   pPool               The pool.
+ * @param   pReq                The request.
+ * @remarks Caller owns the critical section.
+ */
+static void rtReqPoolInsertPendingLocked(PRTREQPOOLINT pPool, PRTREQINT pReq)
+{
+    unsigned const iPrio    = rtReqPoolPriority(pReq->fFlags);
+    PRTREQINT     *ppInsert = pPool->apPendingTails[iPrio];
+    pReq->pNext = *ppInsert;
+    *ppInsert   = pReq;
+
+    /* Move our tail and those of any empty lower priority segments after us. */
+    for (unsigned i = iPrio; i < RTREQPOOL_PRIO_COUNT; i++)
+        if (pPool->apPendingTails[i] == ppInsert)
+            pPool->apPendingTails[i] = (PRTREQINT *)&pReq->pNext;
+    pPool->cCurPendingRequests++;
+}
+
+
+/**
+ * Removes the request at the head of the shared FIFO.
+ *
+ * @returns The request, NULL if none.
+ * @param   pPool               The pool.
+ * @param   fInclLowPrio        Whether to consider low priority requests.
+ * @remarks Caller owns the critical section.
+ */
+static PRTREQINT rtReqPoolRemovePendingLocked(PRTREQPOOLINT pPool, bool fInclLowPrio)
+{
+    PRTREQINT pReq = pPool->pPendingRequests;
+    if (   !pReq
+        || (!fInclLowPrio && rtReqPoolPriority(pReq->fFlags) == RTREQPOOL_PRIO_LOW))
+        return NULL;
+
+    pPool->pPendingRequests = pReq->pNext;
+    for (unsigned i = 0; i < RTREQPOOL_PRIO_COUNT; i++)
+        if (pPool->apPendingTails[i] == (PRTREQINT *)&pReq->pNext)
+            pPool->apPendingTails[i] = &pPool->pPendingRequests;
+    Assert(pPool->cCurPendingRequests > 0);
+    pPool->cCurPendingRequests--;
+    return pReq;
+}
+
+
+/**
+ * Finds something for an idle or waiting worker thread to do.
+ *
+ * The order is: high and normal priority requests from the shared FIFO,
+ * requests stolen from the other worker threads and finally low priority
+ * requests from the shared FIFO.
+ *
+ * @returns The request, NULL if none.
+ * @param   pPool               The pool.
+ * @param   pThread             The calling worker thread.
+ * @remarks Caller owns the critical section.
+ */
+static PRTREQINT rtReqPoolGetWorkLocked(PRTREQPOOLINT pPool, PRTREQPOOLTHREAD pThread)
+{
+    PRTREQINT pReq = rtReqPoolRemovePendingLocked(pPool, false /*fInclLowPrio*/);
+    if (!pReq)
+    {
+        pReq = rtReqPoolStealLocked(pPool, pThread);
+        if (!pReq)
+            pReq = rtReqPoolRemovePendingLocked(pPool, true /*fInclLowPrio*/);
+    }
+    return pReq;
+}
+
+
 /**
  * Used by exiting thread and the pool destruction code to cancel unexpected
  * requests.
@@ -210,6 +486,7 @@ static void rtReqPoolCancelReq(PRTREQINT pReq)
     if (pReq->hPushBackEvt != NIL_RTSEMEVENTMULTI)
         RTSemEventMultiSignal(pReq->hPushBackEvt);
     RTSemEventSignal(pReq->EventSem);
+    rtReqPoolRunContinuations(pReq);
 
     RTReqRelease(pReq);
 }
@@ -227,7 +504,9 @@ static void rtReqPoolRecalcPushBack(PRTREQPOOLINT pPool)
     uint32_t const iStep    = pPool->cCurThreads - pPool->cThreadsPushBackThreshold;
 
     uint32_t cMsCurPushBack;
-    if ((cMsRange >> 2) >= cSteps)
+    if (!cSteps)
+        cMsCurPushBack = 0; /* push back disabled (threshold == max) */
+    else if ((cMsRange >> 2) >= cSteps)
         cMsCurPushBack = cMsRange / cSteps * iStep;
     else
         cMsCurPushBack = (uint32_t)( (uint64_t)cMsRange * RT_NS_1MS  / cSteps * iStep / RT_NS_1MS );
@@ -275,6 +554,17 @@ static int rtReqPoolThreadExit(PRTREQPOOLINT pPool, PRTREQPOOLTHREAD pThread, bo
         rtReqPoolCancelReq(pReq);
     }
 
+    /* Idle threads don't have anything in their deque, so this is only for
+       pool destruction. */
+    while ((pReq = rtReqPoolDequePop(pThread)) != NULL)
+    {
+        if (pPool->fDestructing)
+            rtReqPoolCancelReq(pReq);
+        else
+            rtReqPoolInsertPendingLocked(pPool, pReq);
+    }
+    RTTlsSet(g_iReqPoolTls, NULL);
+
     /* If we're the last thread terminating, ping the destruction thread before
        we leave the critical section. */
     if (   RTListIsEmpty(&pPool->WorkerThreads)
@@ -298,8 +588,12 @@ static int rtReqPoolThreadExit(PRTREQPOOLINT pPool, PRTREQPOOLTHREAD pThread, bo
 static void rtReqPoolThreadProcessRequest(PRTREQPOOLINT pPool, PRTREQPOOLTHREAD pThread, PRTREQINT pReq)
 {
     /*
-     * Update thread state.
+     * Update thread state, saving the state of any request we're processing
+     * already (RTReqWait helping out).
      */
+    PRTREQINT const pOuterReq           = pThread->pPendingReq;
+    uint64_t const  uOuterPendingNanoTs = pThread->uPendingNanoTs;
+    uint64_t const  uOuterProcNanoTs    = pThread->uProcessingNanoTs;
     pThread->uProcessingNanoTs  = RTTimeNanoTS();
     pThread->uPendingNanoTs     = pReq->uSubmitNanoTs;
     pThread->pPendingReq        = pReq;
@@ -315,11 +609,14 @@ static void rtReqPoolThreadProcessRequest(PRTREQPOOLINT pPool, PRTREQPOOLTHREAD
      * Update thread statistics and state.
      */
     ASMAtomicDecU32(&pPool->cCurActiveRequests);
-    pThread->pPendingReq    = NULL;
     uint64_t const uNsTsEnd = RTTimeNanoTS();
     pThread->cNsTotalReqProcessing += uNsTsEnd - pThread->uProcessingNanoTs;
     pThread->cNsTotalReqQueued     += pThread->uProcessingNanoTs - pThread->uPendingNanoTs;
     pThread->cReqProcessed++;
+
+    pThread->pPendingReq        = pOuterReq;
+    pThread->uPendingNanoTs     = uOuterPendingNanoTs;
+    pThread->uProcessingNanoTs  = uOuterProcNanoTs;
 }
 
 
@@ -336,6 +633,15 @@ static DECLCALLBACK(int) rtReqPoolThreadProc(RTTHREAD hThreadSelf, void *pvArg)
     PRTREQPOOLTHREAD    pThread = (PRTREQPOOLTHREAD)pvArg;
     PRTREQPOOLINT       pPool   = pThread->pPool;
 
+    RTTlsSet(g_iReqPoolTls, pThread);
+    if (pThread->idBindCpu != NIL_RTCPUID)
+    {
+        /* Restricted cpusets and containers may refuse this, run unbound then. */
+        int rc = RTThreadSetAffinityToCpu(pThread->idBindCpu);
+        if (RT_FAILURE(rc))
+            LogRel(("RTReqPool/%s: Failed to bind worker thread to CPU %u: %Rrc\n", pPool->szName, pThread->idBindCpu, rc));
+    }
+
     /*
      * The work loop.
      */
@@ -358,6 +664,14 @@ static DECLCALLBACK(int) rtReqPoolThreadProc(RTTHREAD hThreadSelf, void *pvArg)
             continue;
         }
 
+        /* Then our own deque, most recently pushed first. */
+        pReq = rtReqPoolDequePop(pThread);
+        if (pReq)
+        {
+            rtReqPoolThreadProcessRequest(pPool, pThread, pReq);
+            continue;
+        }
+
         ASMAtomicIncU32(&pPool->cIdleThreads);
         RTCritSectEnter(&pPool->CritSect);
 
@@ -383,16 +697,10 @@ static DECLCALLBACK(int) rtReqPoolThreadProc(RTTHREAD hThreadSelf, void *pvArg)
             continue;
         }
 
-        /* Any pending requests in the queue? */
-        pReq = pPool->pPendingRequests;
+        /* Any pending requests in the queue or anything to steal? */
+        pReq = rtReqPoolGetWorkLocked(pPool, pThread);
         if (pReq)
         {
-            pPool->pPendingRequests = pReq->pNext;
-            if (pReq->pNext == NULL)
-                pPool->ppPendingRequests = &pPool->pPendingRequests;
-            Assert(pPool->cCurPendingRequests > 0);
-            pPool->cCurPendingRequests--;
-
             /* Un-idle ourselves and process the request. */
             if (!RTListIsEmpty(&pThread->IdleNode))
             {
@@ -438,6 +746,30 @@ static DECLCALLBACK(int) rtReqPoolThreadProc(RTTHREAD hThreadSelf, void *pvArg)
 }
 
 
+/**
+ * Picks the CPU to bind the next worker thread to.
+ *
+ * @returns CPU ID, NIL_RTCPUID if none could be found.
+ * @param   pPool               The pool.
+ * @remarks Caller owns the critical section
+ */
+static RTCPUID rtReqPoolPickCpu(PRTREQPOOLINT pPool)
+{
+    RTCPUSET OnlineSet;
+    RTMpGetOnlineSet(&OnlineSet);
+    for (uint32_t i = 0; i < RTCPUSET_MAX_CPUS; i++)
+    {
+        int const iCpu = (int)((pPool->iNextBindCpu + i) % RTCPUSET_MAX_CPUS);
+        if (RTCpuSetIsMemberByIndex(&OnlineSet, iCpu))
+        {
+            pPool->iNextBindCpu = (uint32_t)iCpu + 1;
+            return RTMpCpuIdFromSetIndex(iCpu);
+        }
+    }
+    return NIL_RTCPUID;
+}
+
+
 /**
  * Create a new worker thread.
  *
@@ -454,6 +786,7 @@ static void rtReqPoolCreateNewWorker(RTREQPOOL pPool)
     pThread->pPool        = pPool;
     pThread->idLastCpu    = NIL_RTCPUID;
     pThread->hThread      = NIL_RTTHREAD;
+    pThread->idBindCpu    = pPool->fBindToCpus ? rtReqPoolPickCpu(pPool) : NIL_RTCPUID;
     RTListInit(&pThread->IdleNode);
     RTListAppend(&pPool->WorkerThreads, &pThread->ListNode);
     pPool->cCurThreads++;
@@ -522,11 +855,66 @@ static int rtReqPoolPushBack(PRTREQPOOLINT pPool, PRTREQINT pReq)
 
 
 
-DECLHIDDEN(void) rtReqPoolSubmit(PRTREQPOOLINT pPool, PRTREQINT pReq)
+/**
+ * Makes sure somebody will steal from a worker thread that just pushed a
+ * request onto its deque.
+ *
+ * Wakes up an idle worker thread, or creates a new one while we're below the
+ * push back threshold.  A worker thread doesn't push back.
+ *
+ * @param   pPool               The pool.
+ */
+static void rtReqPoolWakeThief(PRTREQPOOLINT pPool)
 {
     RTCritSectEnter(&pPool->CritSect);
 
-    pPool->cReqSubmitted++;
+    PRTREQPOOLTHREAD pThread = RTListGetFirst(&pPool->IdleThreads, RTREQPOOLTHREAD, IdleNode);
+    if (pThread)
+    {
+        RTListNodeRemove(&pThread->IdleNode);
+        RTListInit(&pThread->IdleNode);
+        ASMAtomicDecU32(&pPool->cIdleThreads);
+
+        RTThreadUserSignal(pThread->hThread);
+    }
+    else if (   pPool->cIdleThreads == 0
+             && pPool->cCurThreads < pPool->cThreadsPushBackThreshold
+             && pPool->cCurThreads < pPool->cMaxThreads)
+        rtReqPoolCreateNewWorker(pPool);
+
+    RTCritSectLeave(&pPool->CritSect);
+}
+
+
+DECLHIDDEN(void) rtReqPoolSubmit(PRTREQPOOLINT pPool, PRTREQINT pReq)
+{
+    ASMAtomicIncU64(&pPool->cReqSubmitted);
+
+    /*
+     * Normal priority requests submitted by a worker thread go onto its own
+     * deque without any locking.  Most of the time the worker will pick it up
+     * itself once it's done with the current one (or when waiting on it),
+     * otherwise an idle worker will steal it.
+     *
+     * This is only done for pools where waiting workers help out.  Elsewhere
+     * a worker blocking on its child request relies on the pending queue
+     * growing the pool up to cMaxThreads, which the deque path doesn't do.
+     */
+    if (   pPool->fHelpWhileWaiting
+        && !(pReq->fFlags & RTREQFLAGS_PRIORITY_MASK))
+    {
+        PRTREQPOOLTHREAD pSelf = rtReqPoolCurWorker(pPool);
+        if (pSelf && rtReqPoolDequePush(pSelf, pReq))
+        {
+            ASMAtomicIncU64(&pPool->cReqWorkerQueued);
+            if (   ASMAtomicReadU32(&pPool->cIdleThreads) > 0
+                || pPool->cCurThreads < pPool->cThreadsPushBackThreshold)
+                rtReqPoolWakeThief(pPool);
+            return;
+        }
+    }
+
+    RTCritSectEnter(&pPool->CritSect);
 
     /*
      * Try schedule the request to a thread that's currently idle.
@@ -534,7 +922,6 @@ DECLHIDDEN(void) rtReqPoolSubmit(PRTREQPOOLINT pPool, PRTREQINT pReq)
     PRTREQPOOLTHREAD pThread = RTListGetFirst(&pPool->IdleThreads, RTREQPOOLTHREAD, IdleNode);
     if (pThread)
     {
-        /** @todo CPU affinity??? */
         ASMAtomicWritePtr(&pThread->pTodoReq, pReq);
 
         RTListNodeRemove(&pThread->IdleNode);
@@ -551,10 +938,7 @@ DECLHIDDEN(void) rtReqPoolSubmit(PRTREQPOOLINT pPool, PRTREQINT pReq)
     /*
      * Put the request in the pending queue.
      */
-    pReq->pNext = NULL;
-    *pPool->ppPendingRequests = pReq;
-    pPool->ppPendingRequests  = (PRTREQINT*)&pReq->pNext;
-    pPool->cCurPendingRequests++;
+    rtReqPoolInsertPendingLocked(pPool, pReq);
 
     /*
      * If there is an incoming worker thread already or we've reached the
@@ -618,6 +1002,93 @@ DECLHIDDEN(bool) rtReqPoolRecycle(PRTREQPOOLINT pPool, PRTREQINT pReq)
 }
 
 
+/**
+ * Submits a continuation request whose predecessor has completed.
+ *
+ * @param   pReq                The continuation request, the pool reference
+ *                              was retained when it was registered.
+ */
+static void rtReqPoolSubmitContinuation(PRTREQINT pReq)
+{
+    PRTREQPOOLINT pPool = pReq->uOwner.hPool;
+    if (!ASMAtomicReadBool(&pPool->fDestructing))
+    {
+        pReq->uSubmitNanoTs = RTTimeNanoTS();
+        rtReqPoolSubmit(pPool, pReq);
+    }
+    else
+        rtReqPoolCancelReq(pReq);
+}
+
+
+/**
+ * Submits the continuations of a request that just completed.
+ *
+ * @param   pReq                The completed request.
+ */
+DECLHIDDEN(void) rtReqPoolRunContinuations(PRTREQINT pReq)
+{
+    PRTREQINT pList = ASMAtomicXchgPtrT(&pReq->pContinuations, RTREQ_CONTINUATIONS_DONE, PRTREQINT);
+    if (pList && pList != RTREQ_CONTINUATIONS_DONE)
+    {
+        /* Reverse the LIFO so they're submitted in registration order. */
+        PRTREQINT pReversed = NULL;
+        while (pList)
+        {
+            PRTREQINT pNext = pList->pNextContinuation;
+            pList->pNextContinuation = pReversed;
+            pReversed = pList;
+            pList = pNext;
+        }
+
+        while (pReversed)
+        {
+            PRTREQINT pNext = pReversed->pNextContinuation;
+            pReversed->pNextContinuation = NULL;
+            rtReqPoolSubmitContinuation(pReversed);
+            pReversed = pNext;
+        }
+    }
+}
+
+
+/**
+ * Called by RTReqWait before blocking indefinitely on a pool request.
+ *
+ * If the calling thread is a worker thread of the request's pool and the pool
+ * has RTREQPOOLCFGVAR_HELP_WHILE_WAITING enabled, it processes other requests
+ * of the pool until @a pReq has completed or there is nothing more to pick up.
+ * The latter means that @a pReq is being processed by another thread or will
+ * be picked up by a thread that's busy, so blocking can't deadlock the pool.
+ *
+ * @param   pReq                The request being waited on.
+ */
+DECLHIDDEN(void) rtReqPoolHelpWhileWaiting(PRTREQINT pReq)
+{
+    PRTREQPOOLINT pPool = pReq->uOwner.hPool;
+    if (!pPool || !pPool->fHelpWhileWaiting)
+        return;
+    PRTREQPOOLTHREAD pThread = rtReqPoolCurWorker(pPool);
+    if (!pThread)
+        return;
+
+    while (   pReq->enmState != RTREQSTATE_COMPLETED
+           && !ASMAtomicReadBool(&pPool->fDestructing))
+    {
+        PRTREQINT pOther = rtReqPoolDequePop(pThread);
+        if (!pOther)
+        {
+            RTCritSectEnter(&pPool->CritSect);
+            pOther = rtReqPoolGetWorkLocked(pPool, pThread);
+            RTCritSectLeave(&pPool->CritSect);
+            if (!pOther)
+                break;
+        }
+        rtReqPoolThreadProcessRequest(pPool, pThread, pOther);
+    }
+}
+
+
 RTDECL(int) RTReqPoolCreate(uint32_t cMaxThreads, RTMSINTERVAL cMsMinIdle,
                             uint32_t cThreadsPushBackThreshold, uint32_t cMsMaxPushBack,
                             const char *pszName, PRTREQPOOL phPool)
@@ -648,6 +1119,10 @@ RTDECL(int) RTReqPoolCreate(uint32_t cMaxThreads, RTMSINTERVAL cMsMinIdle,
 
     AssertPtrReturn(phPool, VERR_INVALID_POINTER);
 
+    int rc = RTOnce(&g_ReqPoolTlsOnce, rtReqPoolTlsInitOnce, NULL);
+    if (RT_FAILURE(rc))
+        return rc;
+
     /*
      * Create and initialize the pool.
      */
@@ -668,12 +1143,15 @@ RTDECL(int) RTReqPoolCreate(uint32_t cMaxThreads, RTMSINTERVAL cMsMinIdle,
     pPool->cMsMaxPushBack       = cMsMaxPushBack;
     pPool->cMsMinPushBack       = cMsMinPushBack;
     pPool->cMaxFreeRequests     = cMaxThreads * 2;
+    pPool->fBindToCpus          = false;
+    pPool->fHelpWhileWaiting    = false;
     pPool->hThreadTermEvt       = NIL_RTSEMEVENTMULTI;
     pPool->fDestructing         = false;
     pPool->cMsCurPushBack       = 0;
     pPool->cCurThreads          = 0;
     pPool->cThreadsCreated      = 0;
     pPool->uLastThreadCreateNanoTs = 0;
+    pPool->iNextBindCpu         = 0;
     RTListInit(&pPool->WorkerThreads);
     pPool->cReqProcessed        = 0;
     pPool->cNsTotalReqProcessing= 0;
@@ -682,14 +1160,17 @@ RTDECL(int) RTReqPoolCreate(uint32_t cMaxThreads, RTMSINTERVAL cMsMinIdle,
     pPool->cIdleThreads         = 0;
     RTListInit(&pPool->IdleThreads);
     pPool->pPendingRequests     = NULL;
-    pPool->ppPendingRequests    = &pPool->pPendingRequests;
+    for (unsigned i = 0; i < RTREQPOOL_PRIO_COUNT; i++)
+        pPool->apPendingTails[i] = &pPool->pPendingRequests;
     pPool->cCurPendingRequests  = 0;
     pPool->cCurActiveRequests   = 0;
     pPool->cReqSubmitted        = 0;
+    pPool->cReqWorkerQueued     = 0;
+    pPool->cReqStolen           = 0;
     pPool->pFreeRequests        = NULL;
     pPool->cCurFreeRequests     = 0;
 
-    int rc = RTSemEventMultiCreate(&pPool->hThreadTermEvt);
+    rc = RTSemEventMultiCreate(&pPool->hThreadTermEvt);
     if (RT_SUCCESS(rc))
     {
         rc = RTCritSectInit(&pPool->CritSect);
@@ -839,6 +1320,16 @@ RTDECL(int) RTReqPoolSetCfgVar(RTREQPOOL hPool, RTREQPOOLCFGVAR enmVar, uint64_t
             }
             break;
 
+        case RTREQPOOLCFGVAR_BIND_TO_CPUS:
+            AssertMsgBreakStmt(uValue <= 1,  ("%llu\n",  uValue), rc = VERR_OUT_OF_RANGE);
+            pPool->fBindToCpus = uValue != 0;
+            break;
+
+        case RTREQPOOLCFGVAR_HELP_WHILE_WAITING:
+            AssertMsgBreakStmt(uValue <= 1,  ("%llu\n",  uValue), rc = VERR_OUT_OF_RANGE);
+            pPool->fHelpWhileWaiting = uValue != 0;
+            break;
+
         default:
             AssertFailed();
             rc = VERR_IPE_NOT_REACHED_DEFAULT_CASE;
@@ -910,6 +1401,14 @@ RTDECL(uint64_t) RTReqPoolGetCfgVar(RTREQPOOL hPool, RTREQPOOLCFGVAR enmVar)
             u64 = pPool->cMaxFreeRequests;
             break;
 
+        case RTREQPOOLCFGVAR_BIND_TO_CPUS:
+            u64 = pPool->fBindToCpus;
+            break;
+
+        case RTREQPOOLCFGVAR_HELP_WHILE_WAITING:
+            u64 = pPool->fHelpWhileWaiting;
+            break;
+
         default:
             AssertFailed();
             u64 = UINT64_MAX;
@@ -933,19 +1432,30 @@ RTDECL(uint64_t) RTReqPoolGetStat(RTREQPOOL hPool, RTREQPOOLSTAT enmStat)
     RTCritSectEnter(&pPool->CritSect);
 
     uint64_t u64;
+    PRTREQPOOLTHREAD pThread;
     switch (enmStat)
     {
         case RTREQPOOLSTAT_THREADS:                     u64 = pPool->cCurThreads; break;
         case RTREQPOOLSTAT_THREADS_CREATED:             u64 = pPool->cThreadsCreated; break;
         case RTREQPOOLSTAT_REQUESTS_PROCESSED:          u64 = pPool->cReqProcessed; break;
         case RTREQPOOLSTAT_REQUESTS_SUBMITTED:          u64 = pPool->cReqSubmitted; break;
-        case RTREQPOOLSTAT_REQUESTS_PENDING:            u64 = pPool->cCurPendingRequests; break;
+        case RTREQPOOLSTAT_REQUESTS_PENDING:
+            u64 = pPool->cCurPendingRequests;
+            RTListForEach(&pPool->WorkerThreads, pThread, RTREQPOOLTHREAD, ListNode)
+            {
+                int32_t const cInDeque = (int32_t)(ASMAtomicReadU32(&pThread->iDequeBottom) - ASMAtomicReadU32(&pThread->iDequeTop));
+                if (cInDeque > 0)
+                    u64 += (uint32_t)cInDeque;
+            }
+            break;
         case RTREQPOOLSTAT_REQUESTS_ACTIVE:             u64 = pPool->cCurActiveRequests; break;
         case RTREQPOOLSTAT_REQUESTS_FREE:               u64 = pPool->cCurFreeRequests; break;
         case RTREQPOOLSTAT_NS_TOTAL_REQ_PROCESSING:     u64 = pPool->cNsTotalReqProcessing; break;
         case RTREQPOOLSTAT_NS_TOTAL_REQ_QUEUED:         u64 = pPool->cNsTotalReqQueued; break;
         case RTREQPOOLSTAT_NS_AVERAGE_REQ_PROCESSING:   u64 = pPool->cNsTotalReqProcessing / RT_MAX(pPool->cReqProcessed, 1); break;
         case RTREQPOOLSTAT_NS_AVERAGE_REQ_QUEUED:       u64 = pPool->cNsTotalReqQueued / RT_MAX(pPool->cReqProcessed, 1); break;
+        case RTREQPOOLSTAT_REQUESTS_WORKER_QUEUED:      u64 = pPool->cReqWorkerQueued; break;
+        case RTREQPOOLSTAT_REQUESTS_STOLEN:             u64 = pPool->cReqStolen; break;
         default:
             AssertFailed();
             u64 = UINT64_MAX;
@@ -1011,7 +1521,8 @@ RTDECL(uint32_t) RTReqPoolRelease(RTREQPOOL hPool)
             pPool->pPendingRequests = pReq->pNext;
             rtReqPoolCancelReq(pReq);
         }
-        pPool->ppPendingRequests = NULL;
+        for (unsigned i = 0; i < RTREQPOOL_PRIO_COUNT; i++)
+            pPool->apPendingTails[i] = NULL;
         pPool->cCurPendingRequests = 0;
 
         /* Wait for the workers to shut down. */
@@ -1107,7 +1618,8 @@ RTDECL(int) RTReqPoolCallExV(RTREQPOOL hPool, RTMSINTERVAL cMillies, PRTREQ *phR
      * Check input.
      */
     AssertPtrReturn(pfnFunction, VERR_INVALID_POINTER);
-    AssertMsgReturn(!((uint32_t)fFlags & ~(uint32_t)(RTREQFLAGS_NO_WAIT | RTREQFLAGS_RETURN_MASK)), ("%#x\n", (uint32_t)fFlags), VERR_INVALID_PARAMETER);
+    AssertMsgReturn(!((uint32_t)fFlags & ~(uint32_t)(RTREQFLAGS_NO_WAIT | RTREQFLAGS_RETURN_MASK | RTREQFLAGS_PRIORITY_MASK)), ("%#x\n", (uint32_t)fFlags), VERR_INVALID_PARAMETER);
+    AssertMsgReturn((fFlags & RTREQFLAGS_PRIORITY_MASK) != RTREQFLAGS_PRIORITY_MASK, ("%#x\n", (uint32_t)fFlags), VERR_INVALID_PARAMETER);
     if (!(fFlags & RTREQFLAGS_NO_WAIT))
     {
         AssertPtrReturn(phReq, VERR_INVALID_POINTER);
@@ -1208,3 +1720,85 @@ RTDECL(int) RTReqPoolCallVoidNoWait(RTREQPOOL hPool, PFNRT pfnFunction, unsigned
 }
 RT_EXPORT_SYMBOL(RTReqPoolCallVoidNoWait);
 
+
+RTDECL(int) RTReqPoolCallAfterEx(RTREQPOOL hPool, PRTREQ hReqAfter, PRTREQ *phReq, uint32_t fFlags,
+                                 PFNRT pfnFunction, unsigned cArgs, ...)
+{
+    va_list va;
+    va_start(va, cArgs);
+    int rc = RTReqPoolCallAfterExV(hPool, hReqAfter, phReq, fFlags, pfnFunction, cArgs, va);
+    va_end(va);
+    return rc;
+}
+RT_EXPORT_SYMBOL(RTReqPoolCallAfterEx);
+
+
+RTDECL(int) RTReqPoolCallAfterExV(RTREQPOOL hPool, PRTREQ hReqAfter, PRTREQ *phReq, uint32_t fFlags,
+                                  PFNRT pfnFunction, unsigned cArgs, va_list va)
+{
+    /*
+     * Check input.
+     */
+    PRTREQINT pReqAfter = hReqAfter;
+    AssertPtrReturn(pReqAfter, VERR_INVALID_HANDLE);
+    AssertReturn(pReqAfter->u32Magic == RTREQ_MAGIC, VERR_INVALID_HANDLE);
+    AssertMsgReturn(   pReqAfter->enmState == RTREQSTATE_ALLOCATED
+                    || pReqAfter->enmState == RTREQSTATE_QUEUED
+                    || pReqAfter->enmState == RTREQSTATE_PROCESSING
+                    || pReqAfter->enmState == RTREQSTATE_COMPLETED,
+                    ("Invalid state %d\n", pReqAfter->enmState),
+                    VERR_RT_REQUEST_STATE);
+    AssertPtrReturn(pfnFunction, VERR_INVALID_POINTER);
+    AssertMsgReturn(!((uint32_t)fFlags & ~(uint32_t)(RTREQFLAGS_NO_WAIT | RTREQFLAGS_RETURN_MASK | RTREQFLAGS_PRIORITY_MASK)), ("%#x\n", (uint32_t)fFlags), VERR_INVALID_PARAMETER);
+    AssertMsgReturn((fFlags & RTREQFLAGS_PRIORITY_MASK) != RTREQFLAGS_PRIORITY_MASK, ("%#x\n", (uint32_t)fFlags), VERR_INVALID_PARAMETER);
+    if (!(fFlags & RTREQFLAGS_NO_WAIT))
+    {
+        AssertPtrReturn(phReq, VERR_INVALID_POINTER);
+        *phReq = NIL_RTREQ;
+    }
+
+    PRTREQINT pReq = NULL;
+    AssertMsgReturn(cArgs * sizeof(uintptr_t) <= sizeof(pReq->u.Internal.aArgs), ("cArgs=%u\n", cArgs), VERR_TOO_MUCH_DATA);
+
+    /*
+     * Allocate and initialize the request.
+     */
+    int rc = RTReqPoolAlloc(hPool, RTREQTYPE_INTERNAL, &pReq);
+    if (RT_FAILURE(rc))
+        return rc;
+    pReq->fFlags           = fFlags;
+    pReq->u.Internal.pfn   = pfnFunction;
+    pReq->u.Internal.cArgs = cArgs;
+    for (unsigned iArg = 0; iArg < cArgs; iArg++)
+        pReq->u.Internal.aArgs[iArg] = va_arg(va, uintptr_t);
+
+    /*
+     * It is queued as far as the caller is concerned, so do what RTReqSubmit
+     * does up front and hook it onto the predecessor.  If that has completed
+     * already, submit it straight away.
+     */
+    pReq->enmState = RTREQSTATE_QUEUED;
+    if (!(fFlags & RTREQFLAGS_NO_WAIT))
+    {
+        RTReqRetain(pReq);
+        *phReq = pReq;
+    }
+
+    for (;;)
+    {
+        PRTREQINT pHead = ASMAtomicReadPtrT(&pReqAfter->pContinuations, PRTREQINT);
+        if (pHead == RTREQ_CONTINUATIONS_DONE)
+        {
+            rtReqPoolSubmitContinuation(pReq);
+            break;
+        }
+        pReq->pNextContinuation = pHead;
+        if (ASMAtomicCmpXchgPtr(&pReqAfter->pContinuations, pReq, pHead))
+            break;
+    }
+
+    LogFlow(("RTReqPoolCallAfterExV: returns VINF_SUCCESS pReq=%p pReqAfter=%p\n", pReq, pReqAfter));
+    return VINF_SUCCESS;
+}
+RT_EXPORT_SYMBOL(RTReqPoolCallAfterExV);
+
@@ -0,0 +1,119 @@
+/* $Id$ */
+/** @file
+ * IPRT - Binary Search in Sorted Arrays.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include "internal/iprt.h"
+#include <iprt/sort.h>
+
+
+RTDECL(size_t) RTSortLowerBound(void const *pvArray, size_t cElements, size_t cbElement, void const *pvKey,
+                                PFNRTSORTCMP pfnCmp, void *pvUser)
+{
+    uint8_t const *pbArray = (uint8_t const *)pvArray;
+    size_t         iFirst  = 0;
+    while (cElements > 0)
+    {
+        size_t const cHalf = cElements / 2;
+        if (pfnCmp(&pbArray[(iFirst + cHalf) * cbElement], pvKey, pvUser) < 0)
+        {
+            iFirst    += cHalf + 1;
+            cElements -= cHalf + 1;
+        }
+        else
+            cElements = cHalf;
+    }
+    return iFirst;
+}
+RT_EXPORT_SYMBOL(RTSortLowerBound);
+
+
+RTDECL(size_t) RTSortUpperBound(void const *pvArray, size_t cElements, size_t cbElement, void const *pvKey,
+                                PFNRTSORTCMP pfnCmp, void *pvUser)
+{
+    uint8_t const *pbArray = (uint8_t const *)pvArray;
+    size_t         iFirst  = 0;
+    while (cElements > 0)
+    {
+        size_t const cHalf = cElements / 2;
+        if (pfnCmp(&pbArray[(iFirst + cHalf) * cbElement], pvKey, pvUser) <= 0)
+        {
+            iFirst    += cHalf + 1;
+            cElements -= cHalf + 1;
+        }
+        else
+            cElements = cHalf;
+    }
+    return iFirst;
+}
+RT_EXPORT_SYMBOL(RTSortUpperBound);
+
+
+RTDECL(bool) RTSortBinarySearch(void const *pvArray, size_t cElements, size_t cbElement, void const *pvKey,
+                                PFNRTSORTCMP pfnCmp, void *pvUser, size_t *piElement)
+{
+    size_t const i = RTSortLowerBound(pvArray, cElements, cbElement, pvKey, pfnCmp, pvUser);
+    if (piElement)
+        *piElement = i;
+    return i < cElements
+        && pfnCmp((uint8_t const *)pvArray + i * cbElement, pvKey, pvUser) == 0;
+}
+RT_EXPORT_SYMBOL(RTSortBinarySearch);
+
+
+RTDECL(size_t) RTSortApvLowerBound(void const * const *papvArray, size_t cElements, void const *pvKey,
+                                   PFNRTSORTCMP pfnCmp, void *pvUser)
+{
+    size_t iFirst = 0;
+    while (cElements > 0)
+    {
+        size_t const cHalf = cElements / 2;
+        if (pfnCmp(papvArray[iFirst + cHalf], pvKey, pvUser) < 0)
+        {
+            iFirst    += cHalf + 1;
+            cElements -= cHalf + 1;
+        }
+        else
+            cElements = cHalf;
+    }
+    return iFirst;
+}
+RT_EXPORT_SYMBOL(RTSortApvLowerBound);
+
+
+RTDECL(bool) RTSortApvBinarySearch(void const * const *papvArray, size_t cElements, void const *pvKey,
+                                   PFNRTSORTCMP pfnCmp, void *pvUser, size_t *piElement)
+{
+    size_t const i = RTSortApvLowerBound(papvArray, cElements, pvKey, pfnCmp, pvUser);
+    if (piElement)
+        *piElement = i;
+    return i < cElements
+        && pfnCmp(papvArray[i], pvKey, pvUser) == 0;
+}
+RT_EXPORT_SYMBOL(RTSortApvBinarySearch);
+
@@ -0,0 +1,469 @@
+/* $Id$ */
+/** @file
+ * IPRT - Introspective Sort.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include "internal/iprt.h"
+#include <iprt/sort.h>
+
+#include <iprt/assert.h>
+#include <iprt/string.h>
+
+
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** Partitions this size or smaller are insertion sorted. */
+#define RTSORT_INSERTION_THRESHOLD      24
+/** Partitions larger than this use the ninther for picking the pivot. */
+#define RTSORT_NINTHER_THRESHOLD        128
+/** Max number of element moves a partial insertion sort will do before
+ * giving up. */
+#define RTSORT_PARTIAL_INSERTION_LIMIT  8
+
+
+/*********************************************************************************************************************************
+*   Structures and Typedefs                                                                                                      *
+*********************************************************************************************************************************/
+/**
+ * State shared by the variable sized element workers.
+ */
+typedef struct RTSORTINTRO
+{
+    /** The element size. */
+    size_t          cbElement;
+    /** The compare callback. */
+    PFNRTSORTCMP    pfnCmp;
+    /** The user argument for the callback. */
+    void           *pvUser;
+} RTSORTINTRO;
+/** Pointer to the introsort state. */
+typedef RTSORTINTRO *PRTSORTINTRO;
+
+
+/**
+ * Calculates the recursion depth at which we switch to heap sort.
+ *
+ * @returns 2 * log2(cElements).
+ * @param   cElements       The number of elements.
+ */
+DECLINLINE(unsigned) rtSortIntroMaxDepth(size_t cElements)
+{
+    unsigned cDepth = 0;
+    while (cElements > 1)
+    {
+        cElements >>= 1;
+        cDepth += 2;
+    }
+    return cDepth;
+}
+
+
+/**
+ * Swaps two elements.
+ */
+DECLINLINE(void) rtSortSwap(uint8_t *pb1, uint8_t *pb2, size_t cb)
+{
+    while (cb >= sizeof(uint64_t))
+    {
+        uint64_t u64;
+        memcpy(&u64, pb1, sizeof(u64));
+        memcpy(pb1, pb2, sizeof(u64));
+        memcpy(pb2, &u64, sizeof(u64));
+        pb1 += sizeof(u64);
+        pb2 += sizeof(u64);
+        cb  -= sizeof(u64);
+    }
+    while (cb-- > 0)
+    {
+        uint8_t const b = *pb1;
+        *pb1++ = *pb2;
+        *pb2++ = b;
+    }
+}
+
+
+/**
+ * Sorts three elements.
+ */
+DECLINLINE(void) rtSortIntroSort3(PRTSORTINTRO pThis, uint8_t *pb1, uint8_t *pb2, uint8_t *pb3)
+{
+    if (pThis->pfnCmp(pb2, pb1, pThis->pvUser) < 0)
+        rtSortSwap(pb1, pb2, pThis->cbElement);
+    if (pThis->pfnCmp(pb3, pb2, pThis->pvUser) < 0)
+    {
+        rtSortSwap(pb2, pb3, pThis->cbElement);
+        if (pThis->pfnCmp(pb2, pb1, pThis->pvUser) < 0)
+            rtSortSwap(pb1, pb2, pThis->cbElement);
+    }
+}
+
+
+/**
+ * Insertion sort, optionally giving up after a few moves.
+ *
+ * @returns true if sorted, false if it gave up.
+ * @param   pThis           The sort state.
+ * @param   pbArray         The array.
+ * @param   cElements       The number of elements.
+ * @param   cMaxMoves       The max number of elements to move, SIZE_MAX for
+ *                          no limit.
+ */
+static bool rtSortIntroInsertion(PRTSORTINTRO pThis, uint8_t *pbArray, size_t cElements, size_t cMaxMoves)
+{
+    size_t const cb     = pThis->cbElement;
+    size_t       cMoves = 0;
+    for (size_t i = 1; i < cElements; i++)
+    {
+        uint8_t *pbCur = &pbArray[i * cb];
+        size_t   j     = i;
+        while (   j > 0
+               && pThis->pfnCmp(pbCur, pbCur - cb, pThis->pvUser) < 0)
+        {
+            rtSortSwap(pbCur - cb, pbCur, cb);
+            pbCur -= cb;
+            j--;
+        }
+        cMoves += i - j;
+        if (cMoves > cMaxMoves)
+            return false;
+    }
+    return true;
+}
+
+
+/**
+ * Heap sort, the fallback for when partitioning goes badly.
+ */
+static void rtSortIntroHeap(PRTSORTINTRO pThis, uint8_t *pbArray, size_t cElements)
+{
+    size_t const cb     = pThis->cbElement;
+    size_t       iStart = cElements / 2;
+    size_t       iEnd   = cElements;
+    while (iEnd > 1)
+    {
+        if (iStart > 0)
+            iStart--;
+        else
+        {
+            iEnd--;
+            rtSortSwap(pbArray, &pbArray[iEnd * cb], cb);
+        }
+
+        size_t iRoot = iStart;
+        size_t iChild;
+        while ((iChild = iRoot * 2 + 1) < iEnd)
+        {
+            if (   iChild + 1 < iEnd
+                && pThis->pfnCmp(&pbArray[iChild * cb], &pbArray[(iChild + 1) * cb], pThis->pvUser) < 0)
+                iChild++;
+            if (pThis->pfnCmp(&pbArray[iRoot * cb], &pbArray[iChild * cb], pThis->pvUser) >= 0)
+                break;
+            rtSortSwap(&pbArray[iRoot * cb], &pbArray[iChild * cb], cb);
+            iRoot = iChild;
+        }
+    }
+}
+
+
+/**
+ * The introsort worker, recursing on the smaller partition.
+ */
+static void rtSortIntroWorker(PRTSORTINTRO pThis, uint8_t *pbArray, size_t cElements, unsigned cDepth)
+{
+    size_t const cb = pThis->cbElement;
+    while (cElements > RTSORT_INSERTION_THRESHOLD)
+    {
+        if (!cDepth--)
+        {
+            rtSortIntroHeap(pThis, pbArray, cElements);
+            return;
+        }
+
+        /*
+         * Pick the pivot and move it to the start of the array.
+         */
+        size_t const iMid   = cElements / 2;
+        uint8_t     *pbMid  = &pbArray[iMid * cb];
+        uint8_t     *pbLast = &pbArray[(cElements - 1) * cb];
+        if (cElements > RTSORT_NINTHER_THRESHOLD)
+        {
+            rtSortIntroSort3(pThis, pbArray, pbMid, pbLast);
+            rtSortIntroSort3(pThis, pbArray + cb, pbMid - cb, pbLast - cb);
+            rtSortIntroSort3(pThis, pbArray + cb * 2, pbMid + cb, pbLast - cb * 2);
+            rtSortIntroSort3(pThis, pbMid - cb, pbMid, pbMid + cb);
+        }
+        else
+            rtSortIntroSort3(pThis, pbArray, pbMid, pbLast);
+        rtSortSwap(pbArray, pbMid, cb);
+
+        /*
+         * Hoare partitioning around pbArray[0].  Elements equal to the pivot
+         * stop both scans so duplicates get spread evenly on both sides.
+         */
+        bool   fSwapped = false;
+        size_t i        = 0;
+        size_t j        = cElements;
+        for (;;)
+        {
+            do
+                i++;
+            while (i < cElements && pThis->pfnCmp(&pbArray[i * cb], pbArray, pThis->pvUser) < 0);
+            do
+                j--;
+            while (pThis->pfnCmp(pbArray, &pbArray[j * cb], pThis->pvUser) < 0);
+            if (i >= j)
+                break;
+            rtSortSwap(&pbArray[i * cb], &pbArray[j * cb], cb);
+            fSwapped = true;
+        }
+        rtSortSwap(pbArray, &pbArray[j * cb], cb);
+
+        size_t const cLeft   = j;
+        size_t const cRight  = cElements - j - 1;
+        uint8_t     *pbRight = &pbArray[(j + 1) * cb];
+
+        /*
+         * If the partition was already in place, the input is likely (mostly)
+         * sorted; try finishing both sides with a few insertion moves.
+         */
+        if (!fSwapped)
+        {
+            bool const fLeftDone  = rtSortIntroInsertion(pThis, pbArray, cLeft, RTSORT_PARTIAL_INSERTION_LIMIT);
+            bool const fRightDone = rtSortIntroInsertion(pThis, pbRight, cRight, RTSORT_PARTIAL_INSERTION_LIMIT);
+            if (fLeftDone && fRightDone)
+                return;
+        }
+
+        /*
+         * Recurse on the smaller part, loop on the larger one.
+         */
+        if (cLeft < cRight)
+        {
+            rtSortIntroWorker(pThis, pbArray, cLeft, cDepth);
+            pbArray   = pbRight;
+            cElements = cRight;
+        }
+        else
+        {
+            rtSortIntroWorker(pThis, pbRight, cRight, cDepth);
+            cElements = cLeft;
+        }
+    }
+
+    rtSortIntroInsertion(pThis, pbArray, cElements, SIZE_MAX);
+}
+
+
+RTDECL(void) RTSortIntro(void *pvArray, size_t cElements, size_t cbElement, PFNRTSORTCMP pfnCmp, void *pvUser)
+{
+    /* Anything worth sorting? */
+    if (cElements < 2)
+        return;
+    AssertReturnVoid(cbElement > 0);
+
+    RTSORTINTRO This;
+    This.cbElement = cbElement;
+    This.pfnCmp    = pfnCmp;
+    This.pvUser    = pvUser;
+    rtSortIntroWorker(&This, (uint8_t *)pvArray, cElements, rtSortIntroMaxDepth(cElements));
+}
+RT_EXPORT_SYMBOL(RTSortIntro);
+
+
+
+/*
+ * The pointer array variant.
+ */
+
+/**
+ * Sorts three pointers.
+ */
+DECLINLINE(void) rtSortApvIntroSort3(void **ppv1, void **ppv2, void **ppv3, PFNRTSORTCMP pfnCmp, void *pvUser)
+{
+    void *pvTmp;
+    if (pfnCmp(*ppv2, *ppv1, pvUser) < 0)
+    {
+        pvTmp = *ppv1; *ppv1 = *ppv2; *ppv2 = pvTmp;
+    }
+    if (pfnCmp(*ppv3, *ppv2, pvUser) < 0)
+    {
+        pvTmp = *ppv2; *ppv2 = *ppv3; *ppv3 = pvTmp;
+        if (pfnCmp(*ppv2, *ppv1, pvUser) < 0)
+        {
+            pvTmp = *ppv1; *ppv1 = *ppv2; *ppv2 = pvTmp;
+        }
+    }
+}
+
+
+/**
+ * Insertion sort of a pointer array, optionally giving up after a few moves.
+ *
+ * @returns true if sorted, false if it gave up.
+ */
+static bool rtSortApvIntroInsertion(void **papvArray, size_t cElements, size_t cMaxMoves, PFNRTSORTCMP pfnCmp, void *pvUser)
+{
+    size_t cMoves = 0;
+    for (size_t i = 1; i < cElements; i++)
+    {
+        void  *pvTmp = papvArray[i];
+        size_t j     = i;
+        while (   j > 0
+               && pfnCmp(pvTmp, papvArray[j - 1], pvUser) < 0)
+        {
+            papvArray[j] = papvArray[j - 1];
+            j--;
+        }
+        papvArray[j] = pvTmp;
+        cMoves += i - j;
+        if (cMoves > cMaxMoves)
+            return false;
+    }
+    return true;
+}
+
+
+/**
+ * Heap sort of a pointer array.
+ */
+static void rtSortApvIntroHeap(void **papvArray, size_t cElements, PFNRTSORTCMP pfnCmp, void *pvUser)
+{
+    size_t iStart = cElements / 2;
+    size_t iEnd   = cElements;
+    while (iEnd > 1)
+    {
+        void *pvTmp;
+        if (iStart > 0)
+            iStart--;
+        else
+        {
+            iEnd--;
+            pvTmp = papvArray[0]; papvArray[0] = papvArray[iEnd]; papvArray[iEnd] = pvTmp;
+        }
+
+        size_t iRoot = iStart;
+        size_t iChild;
+        while ((iChild = iRoot * 2 + 1) < iEnd)
+        {
+            if (   iChild + 1 < iEnd
+                && pfnCmp(papvArray[iChild], papvArray[iChild + 1], pvUser) < 0)
+                iChild++;
+            if (pfnCmp(papvArray[iRoot], papvArray[iChild], pvUser) >= 0)
+                break;
+            pvTmp = papvArray[iRoot]; papvArray[iRoot] = papvArray[iChild]; papvArray[iChild] = pvTmp;
+            iRoot = iChild;
+        }
+    }
+}
+
+
+/**
+ * The pointer array introsort worker.
+ */
+static void rtSortApvIntroWorker(void **papvArray, size_t cElements, unsigned cDepth, PFNRTSORTCMP pfnCmp, void *pvUser)
+{
+    while (cElements > RTSORT_INSERTION_THRESHOLD)
+    {
+        if (!cDepth--)
+        {
+            rtSortApvIntroHeap(papvArray, cElements, pfnCmp, pvUser);
+            return;
+        }
+
+        size_t const iMid  = cElements / 2;
+        size_t const iLast = cElements - 1;
+        if (cElements > RTSORT_NINTHER_THRESHOLD)
+        {
+            rtSortApvIntroSort3(&papvArray[0], &papvArray[iMid],     &papvArray[iLast],     pfnCmp, pvUser);
+            rtSortApvIntroSort3(&papvArray[1], &papvArray[iMid - 1], &papvArray[iLast - 1], pfnCmp, pvUser);
+            rtSortApvIntroSort3(&papvArray[2], &papvArray[iMid + 1], &papvArray[iLast - 2], pfnCmp, pvUser);
+            rtSortApvIntroSort3(&papvArray[iMid - 1], &papvArray[iMid], &papvArray[iMid + 1], pfnCmp, pvUser);
+        }
+        else
+            rtSortApvIntroSort3(&papvArray[0], &papvArray[iMid], &papvArray[iLast], pfnCmp, pvUser);
+        void *const pvPivot = papvArray[iMid];
+        papvArray[iMid] = papvArray[0];
+        papvArray[0]    = pvPivot;
+
+        bool   fSwapped = false;
+        size_t i        = 0;
+        size_t j        = cElements;
+        for (;;)
+        {
+            do
+                i++;
+            while (i < cElements && pfnCmp(papvArray[i], pvPivot, pvUser) < 0);
+            do
+                j--;
+            while (pfnCmp(pvPivot, papvArray[j], pvUser) < 0);
+            if (i >= j)
+                break;
+            void *pvTmp = papvArray[i]; papvArray[i] = papvArray[j]; papvArray[j] = pvTmp;
+            fSwapped = true;
+        }
+        papvArray[0] = papvArray[j];
+        papvArray[j] = pvPivot;
+
+        size_t const cLeft  = j;
+        size_t const cRight = cElements - j - 1;
+        if (!fSwapped)
+        {
+            bool const fLeftDone  = rtSortApvIntroInsertion(papvArray, cLeft, RTSORT_PARTIAL_INSERTION_LIMIT, pfnCmp, pvUser);
+            bool const fRightDone = rtSortApvIntroInsertion(&papvArray[j + 1], cRight, RTSORT_PARTIAL_INSERTION_LIMIT,
+                                                            pfnCmp, pvUser);
+            if (fLeftDone && fRightDone)
+                return;
+        }
+
+        if (cLeft < cRight)
+        {
+            rtSortApvIntroWorker(papvArray, cLeft, cDepth, pfnCmp, pvUser);
+            papvArray += j + 1;
+            cElements  = cRight;
+        }
+        else
+        {
+            rtSortApvIntroWorker(&papvArray[j + 1], cRight, cDepth, pfnCmp, pvUser);
+            cElements = cLeft;
+        }
+    }
+
+    rtSortApvIntroInsertion(papvArray, cElements, SIZE_MAX, pfnCmp, pvUser);
+}
+
+
+RTDECL(void) RTSortApvIntro(void **papvArray, size_t cElements, PFNRTSORTCMP pfnCmp, void *pvUser)
+{
+    /* Anything worth sorting? */
+    if (cElements < 2)
+        return;
+    rtSortApvIntroWorker(papvArray, cElements, rtSortIntroMaxDepth(cElements), pfnCmp, pvUser);
+}
+RT_EXPORT_SYMBOL(RTSortApvIntro);
+
@@ -0,0 +1,512 @@
+/* $Id$ */
+/** @file
+ * IPRT - Merge Sorts, Stable and Parallel.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include "internal/iprt.h"
+#include <iprt/sort.h>
+
+#include <iprt/assert.h>
+#include <iprt/err.h>
+#include <iprt/mem.h>
+#include <iprt/mp.h>
+#include <iprt/string.h>
+
+
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** The size of the runs that are insertion sorted before merging. */
+#define RTSORT_MERGE_RUN                    16
+/** The minimum number of elements per chunk / merge part for RTSortParallel. */
+#define RTSORT_PARALLEL_MIN_ELEMENTS        4096
+/** The max number of chunks RTSortParallel splits the array into. */
+#define RTSORT_PARALLEL_MAX_TASKS           64
+
+
+/*********************************************************************************************************************************
+*   Structures and Typedefs                                                                                                      *
+*********************************************************************************************************************************/
+/**
+ * RTSortParallel state.
+ */
+typedef struct RTSORTPARALLEL
+{
+    /** The element size. */
+    size_t          cbElement;
+    /** The compare callback. */
+    PFNRTSORTCMP    pfnCmp;
+    /** The user argument for the callback. */
+    void           *pvUser;
+    /** The request pool. */
+    RTREQPOOL       hPool;
+} RTSORTPARALLEL;
+/** Pointer to the RTSortParallel state. */
+typedef RTSORTPARALLEL *PRTSORTPARALLEL;
+
+/**
+ * A RTSortParallel task, either sorting a chunk or merging part of two runs.
+ */
+typedef struct RTSORTPARALLELTASK
+{
+    /** The sort state. */
+    PRTSORTPARALLEL pThis;
+    /** The left run, or the chunk to sort in place. */
+    uint8_t        *pbLeft;
+    /** The number of elements in the left run / chunk. */
+    size_t          cLeft;
+    /** The right run, NULL if this is a chunk sorting task. */
+    uint8_t const  *pbRight;
+    /** The number of elements in the right run. */
+    size_t          cRight;
+    /** Where to merge the runs to. */
+    uint8_t        *pbDst;
+} RTSORTPARALLELTASK;
+/** Pointer to a RTSortParallel task. */
+typedef RTSORTPARALLELTASK *PRTSORTPARALLELTASK;
+
+/**
+ * A sorted run for RTSortParallel.
+ */
+typedef struct RTSORTPARALLELRUN
+{
+    /** The index of the first element. */
+    size_t          iFirst;
+    /** The number of elements. */
+    size_t          cElements;
+} RTSORTPARALLELRUN;
+
+
+/**
+ * Stable insertion sort of a run of variable sized elements.
+ */
+static void rtSortMergeInsertion(uint8_t *pbArray, size_t cElements, size_t cbElement, PFNRTSORTCMP pfnCmp, void *pvUser)
+{
+    for (size_t i = 1; i < cElements; i++)
+    {
+        uint8_t *pbCur = &pbArray[i * cbElement];
+        while (   pbCur != pbArray
+               && pfnCmp(pbCur - cbElement, pbCur, pvUser) > 0)
+        {
+            /* Swap with the previous element. */
+            uint8_t *pb1 = pbCur - cbElement;
+            uint8_t *pb2 = pbCur;
+            size_t   cb  = cbElement;
+            while (cb-- > 0)
+            {
+                uint8_t const b = *pb1;
+                *pb1++ = *pb2;
+                *pb2++ = b;
+            }
+            pbCur -= cbElement;
+        }
+    }
+}
+
+
+/**
+ * Merges two adjacent sorted runs of variable sized elements.
+ *
+ * Elements from the left run go first when equal, keeping things stable.
+ */
+static void rtSortMergeRuns(uint8_t const *pbLeft, size_t cLeft, uint8_t const *pbRight, size_t cRight, uint8_t *pbDst,
+                            size_t cbElement, PFNRTSORTCMP pfnCmp, void *pvUser)
+{
+    /* Already in order? Common for partially sorted input. */
+    if (   !cLeft
+        || !cRight
+        || pfnCmp(pbLeft + (cLeft - 1) * cbElement, pbRight, pvUser) <= 0)
+    {
+        memcpy(pbDst, pbLeft, cLeft * cbElement);
+        memcpy(pbDst + cLeft * cbElement, pbRight, cRight * cbElement);
+        return;
+    }
+
+    while (cLeft > 0 && cRight > 0)
+    {
+        if (pfnCmp(pbRight, pbLeft, pvUser) < 0)
+        {
+            memcpy(pbDst, pbRight, cbElement);
+            pbRight += cbElement;
+            cRight--;
+        }
+        else
+        {
+            memcpy(pbDst, pbLeft, cbElement);
+            pbLeft += cbElement;
+            cLeft--;
+        }
+        pbDst += cbElement;
+    }
+    memcpy(pbDst, pbLeft, cLeft * cbElement);
+    pbDst += cLeft * cbElement;
+    memcpy(pbDst, pbRight, cRight * cbElement);
+}
+
+
+RTDECL(int) RTSortMerge(void *pvArray, size_t cElements, size_t cbElement, PFNRTSORTCMP pfnCmp, void *pvUser)
+{
+    /* Anything worth sorting? */
+    if (cElements < 2)
+        return VINF_SUCCESS;
+    AssertReturn(cbElement > 0, VERR_INVALID_PARAMETER);
+    AssertReturn(cElements <= ~(size_t)0 / cbElement, VERR_INVALID_PARAMETER);
+
+    uint8_t *pbArray = (uint8_t *)pvArray;
+    if (cElements <= RTSORT_MERGE_RUN)
+    {
+        rtSortMergeInsertion(pbArray, cElements, cbElement, pfnCmp, pvUser);
+        return VINF_SUCCESS;
+    }
+
+    uint8_t *pbTmp = (uint8_t *)RTMemTmpAlloc(cElements * cbElement);
+    if (!pbTmp)
+        return VERR_NO_TMP_MEMORY;
+
+    /*
+     * Insertion sort the initial runs, then merge bottom up ping-ponging
+     * between the array and the temporary buffer.
+     */
+    for (size_t i = 0; i < cElements; i += RTSORT_MERGE_RUN)
+        rtSortMergeInsertion(&pbArray[i * cbElement], RT_MIN(RTSORT_MERGE_RUN, cElements - i), cbElement, pfnCmp, pvUser);
+
+    uint8_t *pbSrc = pbArray;
+    uint8_t *pbDst = pbTmp;
+    for (size_t cRun = RTSORT_MERGE_RUN; cRun < cElements; cRun *= 2)
+    {
+        for (size_t i = 0; i < cElements; i += cRun * 2)
+        {
+            size_t const cLeft  = RT_MIN(cRun, cElements - i);
+            size_t const cRight = RT_MIN(cRun, cElements - i - cLeft);
+            rtSortMergeRuns(&pbSrc[i * cbElement], cLeft, &pbSrc[(i + cLeft) * cbElement], cRight,
+                            &pbDst[i * cbElement], cbElement, pfnCmp, pvUser);
+        }
+        uint8_t *pbSwap = pbSrc;
+        pbSrc = pbDst;
+        pbDst = pbSwap;
+    }
+
+    if (pbSrc != pbArray)
+        memcpy(pbArray, pbSrc, cElements * cbElement);
+    RTMemTmpFree(pbTmp);
+    return VINF_SUCCESS;
+}
+RT_EXPORT_SYMBOL(RTSortMerge);
+
+
+/**
+ * Stable insertion sort of a run of pointers.
+ */
+static void rtSortApvMergeInsertion(void **papvArray, size_t cElements, PFNRTSORTCMP pfnCmp, void *pvUser)
+{
+    for (size_t i = 1; i < cElements; i++)
+    {
+        void  *pvTmp = papvArray[i];
+        size_t j     = i;
+        while (   j > 0
+               && pfnCmp(papvArray[j - 1], pvTmp, pvUser) > 0)
+        {
+            papvArray[j] = papvArray[j - 1];
+            j--;
+        }
+        papvArray[j] = pvTmp;
+    }
+}
+
+
+/**
+ * Merges two adjacent sorted runs of pointers.
+ */
+static void rtSortApvMergeRuns(void * const *papvLeft, size_t cLeft, void * const *papvRight, size_t cRight, void **papvDst,
+                               PFNRTSORTCMP pfnCmp, void *pvUser)
+{
+    if (   !cLeft
+        || !cRight
+        || pfnCmp(papvLeft[cLeft - 1], papvRight[0], pvUser) <= 0)
+    {
+        memcpy(papvDst, papvLeft, cLeft * sizeof(papvDst[0]));
+        memcpy(&papvDst[cLeft], papvRight, cRight * sizeof(papvDst[0]));
+        return;
+    }
+
+    while (cLeft > 0 && cRight > 0)
+    {
+        if (pfnCmp(*papvRight, *papvLeft, pvUser) < 0)
+        {
+            *papvDst++ = *papvRight++;
+            cRight--;
+        }
+        else
+        {
+            *papvDst++ = *papvLeft++;
+            cLeft--;
+        }
+    }
+    memcpy(papvDst, papvLeft, cLeft * sizeof(papvDst[0]));
+    memcpy(&papvDst[cLeft], papvRight, cRight * sizeof(papvDst[0]));
+}
+
+
+RTDECL(int) RTSortApvMerge(void **papvArray, size_t cElements, PFNRTSORTCMP pfnCmp, void *pvUser)
+{
+    /* Anything worth sorting? */
+    if (cElements < 2)
+        return VINF_SUCCESS;
+    if (cElements <= RTSORT_MERGE_RUN)
+    {
+        rtSortApvMergeInsertion(papvArray, cElements, pfnCmp, pvUser);
+        return VINF_SUCCESS;
+    }
+
+    void **papvTmp = (void **)RTMemTmpAlloc(cElements * sizeof(papvTmp[0]));
+    if (!papvTmp)
+        return VERR_NO_TMP_MEMORY;
+
+    for (size_t i = 0; i < cElements; i += RTSORT_MERGE_RUN)
+        rtSortApvMergeInsertion(&papvArray[i], RT_MIN(RTSORT_MERGE_RUN, cElements - i), pfnCmp, pvUser);
+
+    void **papvSrc = papvArray;
+    void **papvDst = papvTmp;
+    for (size_t cRun = RTSORT_MERGE_RUN; cRun < cElements; cRun *= 2)
+    {
+        for (size_t i = 0; i < cElements; i += cRun * 2)
+        {
+            size_t const cLeft  = RT_MIN(cRun, cElements - i);
+            size_t const cRight = RT_MIN(cRun, cElements - i - cLeft);
+            rtSortApvMergeRuns(&papvSrc[i], cLeft, &papvSrc[i + cLeft], cRight, &papvDst[i], pfnCmp, pvUser);
+        }
+        void **papvSwap = papvSrc;
+        papvSrc = papvDst;
+        papvDst = papvSwap;
+    }
+
+    if (papvSrc != papvArray)
+        memcpy(papvArray, papvSrc, cElements * sizeof(papvArray[0]));
+    RTMemTmpFree(papvTmp);
+    return VINF_SUCCESS;
+}
+RT_EXPORT_SYMBOL(RTSortApvMerge);
+
+
+
+/**
+ * Executes a RTSortParallel task.
+ *
+ * @param   pTask           The task.
+ */
+static DECLCALLBACK(void) rtSortParallelTaskWorker(PRTSORTPARALLELTASK pTask)
+{
+    PRTSORTPARALLEL pThis = pTask->pThis;
+    if (!pTask->pbRight)
+        RTSortIntro(pTask->pbLeft, pTask->cLeft, pThis->cbElement, pThis->pfnCmp, pThis->pvUser);
+    else
+        rtSortMergeRuns(pTask->pbLeft, pTask->cLeft, pTask->pbRight, pTask->cRight, pTask->pbDst,
+                        pThis->cbElement, pThis->pfnCmp, pThis->pvUser);
+}
+
+
+/**
+ * Runs a batch of tasks on the pool, doing the first one on the calling
+ * thread.
+ *
+ * Tasks that cannot be submitted are executed on the calling thread too.
+ *
+ * @param   pThis           The sort state.
+ * @param   paTasks         The tasks.
+ * @param   cTasks          The number of tasks.
+ */
+static void rtSortParallelRunTasks(PRTSORTPARALLEL pThis, PRTSORTPARALLELTASK paTasks, size_t cTasks)
+{
+    PRTREQ apReqs[RTSORT_PARALLEL_MAX_TASKS];
+    Assert(cTasks <= RT_ELEMENTS(apReqs));
+
+    for (size_t i = 1; i < cTasks; i++)
+    {
+        apReqs[i] = NULL;
+        int rc = RTReqPoolCallEx(pThis->hPool, 0 /*cMillies*/, &apReqs[i], RTREQFLAGS_VOID,
+                                 (PFNRT)rtSortParallelTaskWorker, 1, &paTasks[i]);
+        if (   (rc != VINF_SUCCESS && rc != VERR_TIMEOUT)
+            || !apReqs[i])
+        {
+            apReqs[i] = NULL;
+            rtSortParallelTaskWorker(&paTasks[i]);
+        }
+    }
+
+    rtSortParallelTaskWorker(&paTasks[0]);
+
+    for (size_t i = 1; i < cTasks; i++)
+        if (apReqs[i])
+        {
+            int rc = RTReqWait(apReqs[i], RT_INDEFINITE_WAIT);
+            AssertRC(rc);
+            RTReqRelease(apReqs[i]);
+        }
+}
+
+
+/**
+ * Finds how many elements from the left run go into the first @a iDst
+ * elements of the stable merge of two runs.
+ *
+ * @returns Number of elements from the left run.
+ * @param   pThis           The sort state.
+ * @param   iDst            The merge output index.
+ * @param   pbLeft          The left run.
+ * @param   cLeft           The number of elements in the left run.
+ * @param   pbRight         The right run.
+ * @param   cRight          The number of elements in the right run.
+ */
+static size_t rtSortParallelCoRank(PRTSORTPARALLEL pThis, size_t iDst, uint8_t const *pbLeft, size_t cLeft,
+                                   uint8_t const *pbRight, size_t cRight)
+{
+    size_t const cb  = pThis->cbElement;
+    size_t       iLo = iDst > cRight ? iDst - cRight : 0;
+    size_t       iHi = RT_MIN(iDst, cLeft);
+    while (iLo < iHi)
+    {
+        /* Too few from the left if pbLeft[i] goes before pbRight[iDst - i - 1]. */
+        size_t const i = iLo + (iHi - iLo) / 2;
+        if (pThis->pfnCmp(&pbLeft[i * cb], &pbRight[(iDst - i - 1) * cb], pThis->pvUser) <= 0)
+            iLo = i + 1;
+        else
+            iHi = i;
+    }
+    return iLo;
+}
+
+
+RTDECL(int) RTSortParallel(RTREQPOOL hPool, void *pvArray, size_t cElements, size_t cbElement, PFNRTSORTCMP pfnCmp, void *pvUser)
+{
+    AssertReturn(cbElement > 0, VERR_INVALID_PARAMETER);
+
+    /*
+     * Figure out how many chunks to split it into.  We want a power of two
+     * so the merge rounds come out even.
+     */
+    size_t cWorkers = 1;
+    if (hPool != NIL_RTREQPOOL)
+    {
+        cWorkers = RTMpGetOnlineCount();
+        uint64_t const cMaxThreads = RTReqPoolGetCfgVar(hPool, RTREQPOOLCFGVAR_MAX_THREADS);
+        if (cMaxThreads != UINT64_MAX && cMaxThreads < cWorkers)
+            cWorkers = (size_t)cMaxThreads;
+        cWorkers = RT_MIN(cWorkers, cElements / RTSORT_PARALLEL_MIN_ELEMENTS);
+        cWorkers = RT_MIN(cWorkers, RTSORT_PARALLEL_MAX_TASKS);
+    }
+    size_t cChunks = 1;
+    while (cChunks * 2 <= cWorkers)
+        cChunks *= 2;
+    if (cChunks < 2)
+    {
+        RTSortIntro(pvArray, cElements, cbElement, pfnCmp, pvUser);
+        return VINF_SUCCESS;
+    }
+
+    AssertReturn(cElements <= ~(size_t)0 / cbElement, VERR_INVALID_PARAMETER);
+    uint8_t *pbTmp = (uint8_t *)RTMemTmpAlloc(cElements * cbElement);
+    if (!pbTmp)
+        return VERR_NO_TMP_MEMORY;
+
+    RTSORTPARALLEL This;
+    This.cbElement = cbElement;
+    This.pfnCmp    = pfnCmp;
+    This.pvUser    = pvUser;
+    This.hPool     = hPool;
+
+    RTSORTPARALLELTASK aTasks[RTSORT_PARALLEL_MAX_TASKS];
+    RTSORTPARALLELRUN  aRuns[RTSORT_PARALLEL_MAX_TASKS];
+
+    /*
+     * Sort the chunks.
+     */
+    uint8_t *pbSrc = (uint8_t *)pvArray;
+    uint8_t *pbDst = pbTmp;
+    for (size_t iChunk = 0; iChunk < cChunks; iChunk++)
+    {
+        aRuns[iChunk].iFirst    = cElements * iChunk / cChunks;
+        aRuns[iChunk].cElements = cElements * (iChunk + 1) / cChunks - aRuns[iChunk].iFirst;
+        aTasks[iChunk].pThis    = &This;
+        aTasks[iChunk].pbLeft   = &pbSrc[aRuns[iChunk].iFirst * cbElement];
+        aTasks[iChunk].cLeft    = aRuns[iChunk].cElements;
+        aTasks[iChunk].pbRight  = NULL;
+        aTasks[iChunk].cRight   = 0;
+        aTasks[iChunk].pbDst    = NULL;
+    }
+    rtSortParallelRunTasks(&This, aTasks, cChunks);
+
+    /*
+     * Merge pairs of runs till there is only one left.  Each merge is split
+     * into parts so all the workers have something to do in every round.
+     */
+    for (size_t cRuns = cChunks; cRuns > 1; cRuns /= 2)
+    {
+        size_t const cParts = cChunks / (cRuns / 2);
+        size_t       cTasks = 0;
+        for (size_t iRun = 0; iRun < cRuns; iRun += 2)
+        {
+            uint8_t const *pbLeft  = &pbSrc[aRuns[iRun].iFirst * cbElement];
+            size_t const   cLeft   = aRuns[iRun].cElements;
+            uint8_t const *pbRight = &pbSrc[aRuns[iRun + 1].iFirst * cbElement];
+            size_t const   cRight  = aRuns[iRun + 1].cElements;
+            size_t const   cTotal  = cLeft + cRight;
+            size_t         iPrevDst  = 0;
+            size_t         iPrevLeft = 0;
+            for (size_t iPart = 1; iPart <= cParts; iPart++)
+            {
+                size_t const iDst  = cTotal * iPart / cParts;
+                size_t const iLeft = iPart < cParts
+                                   ? rtSortParallelCoRank(&This, iDst, pbLeft, cLeft, pbRight, cRight) : cLeft;
+                PRTSORTPARALLELTASK pTask = &aTasks[cTasks++];
+                pTask->pThis   = &This;
+                pTask->pbLeft  = (uint8_t *)&pbLeft[iPrevLeft * cbElement];
+                pTask->cLeft   = iLeft - iPrevLeft;
+                pTask->pbRight = &pbRight[(iPrevDst - iPrevLeft) * cbElement];
+                pTask->cRight  = (iDst - iLeft) - (iPrevDst - iPrevLeft);
+                pTask->pbDst   = &pbDst[(aRuns[iRun].iFirst + iPrevDst) * cbElement];
+                iPrevDst  = iDst;
+                iPrevLeft = iLeft;
+            }
+
+            aRuns[iRun / 2].iFirst    = aRuns[iRun].iFirst;
+            aRuns[iRun / 2].cElements = cTotal;
+        }
+        rtSortParallelRunTasks(&This, aTasks, cTasks);
+
+        uint8_t *pbSwap = pbSrc;
+        pbSrc = pbDst;
+        pbDst = pbSwap;
+    }
+
+    if (pbSrc != (uint8_t *)pvArray)
+        memcpy(pvArray, pbSrc, cElements * cbElement);
+    RTMemTmpFree(pbTmp);
+    return VINF_SUCCESS;
+}
+RT_EXPORT_SYMBOL(RTSortParallel);
+
@@ -0,0 +1,263 @@
+/* $Id$ */
+/** @file
+ * IPRT - Radix Sort.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include "internal/iprt.h"
+#include <iprt/sort.h>
+
+#include <iprt/assert.h>
+#include <iprt/err.h>
+#include <iprt/mem.h>
+#include <iprt/string.h>
+
+
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** Arrays smaller than this are sorted using the inline introsort instead. */
+#define RTSORT_RADIX_MIN_ELEMENTS   64
+
+
+/**
+ * The radix sort histograms, one 256 entry table per key byte.
+ *
+ * This is allocated together with the temporary buffer as it's a bit much for
+ * the stack.
+ */
+typedef struct RTSORTRADIXHIST
+{
+    size_t      aacCounts[8][256];
+} RTSORTRADIXHIST;
+/** Pointer to the radix sort histograms. */
+typedef RTSORTRADIXHIST *PRTSORTRADIXHIST;
+
+
+/**
+ * Turns the histograms into starting offsets and figures out which passes
+ * are needed.
+ *
+ * @returns Bitmap of the key bytes that need a pass.  Bytes that are the same
+ *          for every element don't change the order and are skipped.
+ * @param   pHist           The histograms.
+ * @param   cbKey           The key size.
+ * @param   cElements       The number of elements.
+ */
+static uint32_t rtSortRadixPrepare(PRTSORTRADIXHIST pHist, size_t cbKey, size_t cElements)
+{
+    uint32_t fPasses = 0;
+    for (size_t iByte = 0; iByte < cbKey; iByte++)
+    {
+        size_t *pacCounts = pHist->aacCounts[iByte];
+        size_t  offNext   = 0;
+        bool    fTrivial  = false;
+        for (unsigned iDigit = 0; iDigit < 256; iDigit++)
+        {
+            size_t const cDigit = pacCounts[iDigit];
+            if (cDigit == cElements)
+                fTrivial = true;
+            pacCounts[iDigit] = offNext;
+            offNext += cDigit;
+        }
+        if (!fTrivial)
+            fPasses |= RT_BIT_32(iByte);
+    }
+    return fPasses;
+}
+
+
+/**
+ * Radix sorts an array of unsigned integers of the given width, least
+ * significant byte first.
+ */
+static int rtSortRadixInt(void *pvArray, size_t cElements, size_t cbKey)
+{
+    Assert(cbKey == sizeof(uint32_t) || cbKey == sizeof(uint64_t));
+    AssertReturn(cElements <= ~(size_t)0 / cbKey, VERR_INVALID_PARAMETER);
+
+    uint8_t *pbTmp = (uint8_t *)RTMemTmpAlloc(sizeof(RTSORTRADIXHIST) + cElements * cbKey);
+    if (!pbTmp)
+        return VERR_NO_TMP_MEMORY;
+    PRTSORTRADIXHIST pHist = (PRTSORTRADIXHIST)pbTmp;
+    RT_ZERO(*pHist);
+
+    /*
+     * Build all the histograms in one go.
+     */
+    if (cbKey == sizeof(uint32_t))
+    {
+        uint32_t const *pau32 = (uint32_t const *)pvArray;
+        for (size_t i = 0; i < cElements; i++)
+        {
+            uint32_t const u32 = pau32[i];
+            pHist->aacCounts[0][u32 & 0xff]++;
+            pHist->aacCounts[1][(u32 >>  8) & 0xff]++;
+            pHist->aacCounts[2][(u32 >> 16) & 0xff]++;
+            pHist->aacCounts[3][u32 >> 24]++;
+        }
+    }
+    else
+    {
+        uint64_t const *pau64 = (uint64_t const *)pvArray;
+        for (size_t i = 0; i < cElements; i++)
+        {
+            uint64_t const u64 = pau64[i];
+            for (unsigned iByte = 0; iByte < 8; iByte++)
+                pHist->aacCounts[iByte][(u64 >> (iByte * 8)) & 0xff]++;
+        }
+    }
+    uint32_t const fPasses = rtSortRadixPrepare(pHist, cbKey, cElements);
+
+    /*
+     * Scatter, ping-ponging between the array and the temporary buffer.
+     */
+    void *pvSrc = pvArray;
+    void *pvDst = pbTmp + sizeof(RTSORTRADIXHIST);
+    for (unsigned iByte = 0; iByte < cbKey; iByte++)
+        if (fPasses & RT_BIT_32(iByte))
+        {
+            size_t        *pacOffsets = pHist->aacCounts[iByte];
+            unsigned const cShift     = iByte * 8;
+            if (cbKey == sizeof(uint32_t))
+            {
+                uint32_t const *pau32Src = (uint32_t const *)pvSrc;
+                uint32_t       *pau32Dst = (uint32_t *)pvDst;
+                for (size_t i = 0; i < cElements; i++)
+                {
+                    uint32_t const u32 = pau32Src[i];
+                    pau32Dst[pacOffsets[(u32 >> cShift) & 0xff]++] = u32;
+                }
+            }
+            else
+            {
+                uint64_t const *pau64Src = (uint64_t const *)pvSrc;
+                uint64_t       *pau64Dst = (uint64_t *)pvDst;
+                for (size_t i = 0; i < cElements; i++)
+                {
+                    uint64_t const u64 = pau64Src[i];
+                    pau64Dst[pacOffsets[(u64 >> cShift) & 0xff]++] = u64;
+                }
+            }
+            void *pvSwap = pvSrc;
+            pvSrc = pvDst;
+            pvDst = pvSwap;
+        }
+
+    if (pvSrc != pvArray)
+        memcpy(pvArray, pvSrc, cElements * cbKey);
+    RTMemTmpFree(pbTmp);
+    return VINF_SUCCESS;
+}
+
+
+RTDECL(int) RTSortRadixU32(uint32_t *pau32Array, size_t cElements)
+{
+    if (cElements < RTSORT_RADIX_MIN_ELEMENTS)
+    {
+        RTSortU32(pau32Array, cElements);
+        return VINF_SUCCESS;
+    }
+    return rtSortRadixInt(pau32Array, cElements, sizeof(uint32_t));
+}
+RT_EXPORT_SYMBOL(RTSortRadixU32);
+
+
+RTDECL(int) RTSortRadixU64(uint64_t *pau64Array, size_t cElements)
+{
+    if (cElements < RTSORT_RADIX_MIN_ELEMENTS)
+    {
+        RTSortU64(pau64Array, cElements);
+        return VINF_SUCCESS;
+    }
+    return rtSortRadixInt(pau64Array, cElements, sizeof(uint64_t));
+}
+RT_EXPORT_SYMBOL(RTSortRadixU64);
+
+
+/**
+ * Reads the key of an element.
+ */
+DECLINLINE(uint64_t) rtSortRadixGetKey(uint8_t const *pbKey, size_t cbKey)
+{
+    switch (cbKey)
+    {
+        case 1: return *pbKey;
+        case 2: return *(uint16_t const *)pbKey;
+        case 4: return *(uint32_t const *)pbKey;
+        default: return *(uint64_t const *)pbKey;
+    }
+}
+
+
+RTDECL(int) RTSortRadixByKey(void *pvArray, size_t cElements, size_t cbElement, size_t offKey, size_t cbKey)
+{
+    AssertReturn(cbKey == 1 || cbKey == 2 || cbKey == 4 || cbKey == 8, VERR_INVALID_PARAMETER);
+    AssertReturn(offKey + cbKey <= cbElement, VERR_INVALID_PARAMETER);
+    if (cElements < 2)
+        return VINF_SUCCESS;
+    AssertReturn(cElements <= (~(size_t)0 - sizeof(RTSORTRADIXHIST)) / cbElement, VERR_INVALID_PARAMETER);
+
+    uint8_t *pbTmp = (uint8_t *)RTMemTmpAlloc(sizeof(RTSORTRADIXHIST) + cElements * cbElement);
+    if (!pbTmp)
+        return VERR_NO_TMP_MEMORY;
+    PRTSORTRADIXHIST pHist = (PRTSORTRADIXHIST)pbTmp;
+    RT_ZERO(*pHist);
+
+    uint8_t *pbSrc = (uint8_t *)pvArray;
+    for (size_t i = 0; i < cElements; i++)
+    {
+        uint64_t const uKey = rtSortRadixGetKey(&pbSrc[i * cbElement + offKey], cbKey);
+        for (unsigned iByte = 0; iByte < cbKey; iByte++)
+            pHist->aacCounts[iByte][(uKey >> (iByte * 8)) & 0xff]++;
+    }
+    uint32_t const fPasses = rtSortRadixPrepare(pHist, cbKey, cElements);
+
+    uint8_t *pbDst = pbTmp + sizeof(RTSORTRADIXHIST);
+    for (unsigned iByte = 0; iByte < cbKey; iByte++)
+        if (fPasses & RT_BIT_32(iByte))
+        {
+            size_t        *pacOffsets = pHist->aacCounts[iByte];
+            unsigned const cShift     = iByte * 8;
+            for (size_t i = 0; i < cElements; i++)
+            {
+                uint8_t const *pbElement = &pbSrc[i * cbElement];
+                uint64_t const uKey      = rtSortRadixGetKey(pbElement + offKey, cbKey);
+                memcpy(&pbDst[pacOffsets[(uKey >> cShift) & 0xff]++ * cbElement], pbElement, cbElement);
+            }
+            uint8_t *pbSwap = pbSrc;
+            pbSrc = pbDst;
+            pbDst = pbSwap;
+        }
+
+    if (pbSrc != (uint8_t *)pvArray)
+        memcpy(pvArray, pbSrc, cElements * cbElement);
+    RTMemTmpFree(pbTmp);
+    return VINF_SUCCESS;
+}
+RT_EXPORT_SYMBOL(RTSortRadixByKey);
+
@@ -0,0 +1,1015 @@
+/* $Id$ */
+/** @file
+ * IPRT - B+tree of uint64_t ranges.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include "internal/iprt.h"
+#include <iprt/bptree.h>
+
+#include <iprt/asm.h>
+#include <iprt/assert.h>
+#include <iprt/err.h>
+#include <iprt/memcache.h>
+#include <iprt/string.h>
+#include "internal/rangetree.h"
+
+
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** The size of a tree node, four cache lines. */
+#define RTBPTREE_NODE_SIZE          256
+/** The max number of entries in a leaf node. */
+#define RTBPTREE_LEAF_MAX           10
+/** The min number of entries in a non-root leaf node. */
+#define RTBPTREE_LEAF_MIN           (RTBPTREE_LEAF_MAX / 2)
+/** The max number of keys in an inner node (one less than children). */
+#define RTBPTREE_INNER_MAX          15
+/** The min number of keys in a non-root inner node. */
+#define RTBPTREE_INNER_MIN          (RTBPTREE_INNER_MAX / 2)
+/** The max tree height we handle.  With the minimum fan-out this is
+ * enough for more entries than fit into a 64-bit address space. */
+#define RTBPTREE_MAX_HEIGHT         24
+/** The max number of nodes a modification may need: a copy of each node on
+ * the path plus one split or sibling per level, and a new root. */
+#define RTBPTREE_MAX_WR_NODES       (RTBPTREE_MAX_HEIGHT * 2 + 1)
+
+
+/*********************************************************************************************************************************
+*   Structures and Typedefs                                                                                                      *
+*********************************************************************************************************************************/
+/**
+ * Node header, common to leaf and inner nodes.
+ */
+typedef struct RTBPTREEU64HDR
+{
+    /** Number of entries (leaf) or keys (inner). */
+    uint16_t                    cEntries;
+    /** Set if leaf node. */
+    bool                        fLeaf;
+    /** Set on nodes created by the current modification, i.e. nodes that
+     * aren't visible to lockless readers yet. */
+    bool                        fWritable;
+    /** Explicit padding. */
+    uint32_t                    u32Padding;
+} RTBPTREEU64HDR;
+/** Pointer to a node header. */
+typedef RTBPTREEU64HDR *PRTBPTREEU64HDR;
+
+/**
+ * Leaf node.
+ *
+ * The last keys are kept next to the first keys so range lookups don't need
+ * to touch the node cores.
+ */
+typedef struct RTBPTREEU64LEAF
+{
+    RTBPTREEU64HDR              Hdr;
+    /** The first keys, sorted. */
+    uint64_t                    aKeys[RTBPTREE_LEAF_MAX];
+    /** The corresponding last keys. */
+    uint64_t                    aKeysLast[RTBPTREE_LEAF_MAX];
+    /** The corresponding node cores. */
+    PRTRANGEU64NODECORE         apCores[RTBPTREE_LEAF_MAX];
+} RTBPTREEU64LEAF;
+AssertCompile(sizeof(RTBPTREEU64LEAF) <= RTBPTREE_NODE_SIZE);
+/** Pointer to a leaf node. */
+typedef RTBPTREEU64LEAF *PRTBPTREEU64LEAF;
+
+/**
+ * Inner node.
+ *
+ * Child i holds the keys in the range [aKeys[i - 1], aKeys[i]).  The
+ * separators aren't updated when the smallest key of a subtree is removed,
+ * so the lower bound isn't necessarily present in the subtree.
+ */
+typedef struct RTBPTREEU64INNER
+{
+    RTBPTREEU64HDR              Hdr;
+    /** The separator keys, sorted. */
+    uint64_t                    aKeys[RTBPTREE_INNER_MAX];
+    /** The children, Hdr.cEntries + 1 of them. */
+    PRTBPTREEU64HDR             apChildren[RTBPTREE_INNER_MAX + 1];
+} RTBPTREEU64INNER;
+AssertCompile(sizeof(RTBPTREEU64INNER) <= RTBPTREE_NODE_SIZE);
+/** Pointer to an inner node. */
+typedef RTBPTREEU64INNER *PRTBPTREEU64INNER;
+
+/**
+ * Writer state for one modification.
+ *
+ * All the nodes a modification may need are allocated up front so we never
+ * fail half way.  With lockless readers the nodes on the path are copied
+ * before being changed and the replaced ones retired until all readers that
+ * may see them are gone.
+ */
+typedef struct RTBPTREEU64WR
+{
+    /** The tree. */
+    PRTBPTREEU64                pTree;
+    /** Whether to copy nodes before changing them (lockless readers). */
+    bool                        fCopy;
+    /** Number of preallocated nodes left. */
+    uint32_t                    cSpare;
+    /** Number of nodes created by this modification. */
+    uint32_t                    cNew;
+    /** Number of nodes to free when done. */
+    uint32_t                    cRetired;
+    /** Preallocated nodes. */
+    PRTBPTREEU64HDR             apSpare[RTBPTREE_MAX_WR_NODES];
+    /** Nodes created by this modification. */
+    PRTBPTREEU64HDR             apNew[RTBPTREE_MAX_WR_NODES];
+    /** Nodes to free when done. */
+    PRTBPTREEU64HDR             apRetired[RTBPTREE_MAX_WR_NODES];
+} RTBPTREEU64WR;
+/** Pointer to writer state. */
+typedef RTBPTREEU64WR *PRTBPTREEU64WR;
+
+
+/**
+ * Gets the index of the child to descend into for the given key.
+ */
+DECLINLINE(unsigned) rtBpTreeU64InnerChild(PRTBPTREEU64INNER pInner, uint64_t Key)
+{
+    unsigned const cKeys = pInner->Hdr.cEntries;
+    unsigned       i     = 0;
+    while (i < cKeys && pInner->aKeys[i] <= Key)
+        i++;
+    return i;
+}
+
+
+/**
+ * Gets the number of leaf entries with a first key less or equal to the
+ * given key.
+ */
+DECLINLINE(unsigned) rtBpTreeU64LeafUpperBound(PRTBPTREEU64LEAF pLeaf, uint64_t Key)
+{
+    unsigned const cEntries = pLeaf->Hdr.cEntries;
+    unsigned       i        = 0;
+    while (i < cEntries && pLeaf->aKeys[i] <= Key)
+        i++;
+    return i;
+}
+
+
+/**
+ * Reads the root node pointer.
+ */
+DECLINLINE(PRTBPTREEU64HDR) rtBpTreeU64GetRoot(PRTBPTREEU64 pTree)
+{
+    return (PRTBPTREEU64HDR)ASMAtomicReadPtr((void * volatile *)&pTree->pRoot);
+}
+
+
+/**
+ * Finds the closest leaf entry to the given key.
+ *
+ * @returns The leaf, NULL if no such entry.
+ * @param   pRoot       The root node.
+ * @param   Key         The key.
+ * @param   fAbove      true: smallest first key >= @a Key.
+ *                      false: largest first key <= @a Key.
+ * @param   piEntry     Where to return the entry index.
+ */
+static PRTBPTREEU64LEAF rtBpTreeU64Seek(PRTBPTREEU64HDR pRoot, uint64_t Key, bool fAbove, unsigned *piEntry)
+{
+    PRTBPTREEU64HDR pNode = pRoot;
+    if (!pNode)
+        return NULL;
+
+    /*
+     * Descend, remembering the closest subtree on the side we're looking at
+     * in case the leaf doesn't have anything for us.
+     */
+    PRTBPTREEU64HDR pAlt = NULL;
+    while (!pNode->fLeaf)
+    {
+        PRTBPTREEU64INNER pInner = (PRTBPTREEU64INNER)pNode;
+        unsigned const    i      = rtBpTreeU64InnerChild(pInner, Key);
+        if (fAbove)
+        {
+            if (i < pInner->Hdr.cEntries)
+                pAlt = pInner->apChildren[i + 1];
+        }
+        else if (i > 0)
+            pAlt = pInner->apChildren[i - 1];
+        pNode = pInner->apChildren[i];
+    }
+
+    PRTBPTREEU64LEAF pLeaf = (PRTBPTREEU64LEAF)pNode;
+    unsigned const   i     = rtBpTreeU64LeafUpperBound(pLeaf, Key);
+    if (fAbove)
+    {
+        if (i > 0 && pLeaf->aKeys[i - 1] == Key)
+        {
+            *piEntry = i - 1;
+            return pLeaf;
+        }
+        if (i < pLeaf->Hdr.cEntries)
+        {
+            *piEntry = i;
+            return pLeaf;
+        }
+    }
+    else if (i > 0)
+    {
+        *piEntry = i - 1;
+        return pLeaf;
+    }
+
+    /*
+     * It's the outermost entry of the alternative subtree.
+     */
+    pNode = pAlt;
+    if (!pNode)
+        return NULL;
+    while (!pNode->fLeaf)
+    {
+        PRTBPTREEU64INNER pInner = (PRTBPTREEU64INNER)pNode;
+        pNode = pInner->apChildren[fAbove ? 0 : pInner->Hdr.cEntries];
+    }
+    pLeaf = (PRTBPTREEU64LEAF)pNode;
+    AssertReturn(pLeaf->Hdr.cEntries > 0, NULL);
+    *piEntry = fAbove ? 0 : pLeaf->Hdr.cEntries - 1U;
+    return pLeaf;
+}
+
+
+/**
+ * Frees a node, keeping a few around for the next modifications.
+ *
+ * @param   pTree       The tree.
+ * @param   pNode       The node to free.
+ */
+static void rtBpTreeU64FreeNode(PRTBPTREEU64 pTree, PRTBPTREEU64HDR pNode)
+{
+    if (pTree->cSpareNodes < RTBPTREE_MAX_WR_NODES)
+    {
+        /* Free nodes are linked thru the first child pointer. */
+        ((PRTBPTREEU64INNER)pNode)->apChildren[0] = (PRTBPTREEU64HDR)pTree->pvSpareNodes;
+        pTree->pvSpareNodes = pNode;
+        pTree->cSpareNodes++;
+    }
+    else
+        RTMemCacheFree(pTree->hMemCache, pNode);
+}
+
+
+/**
+ * Initializes the writer state and preallocates the nodes needed.
+ *
+ * @returns IPRT status code.
+ * @param   pWr         The writer state.
+ * @param   pTree       The tree.
+ * @param   cNodes      The max number of nodes the modification may need.
+ */
+static int rtBpTreeU64WrInit(PRTBPTREEU64WR pWr, PRTBPTREEU64 pTree, uint32_t cNodes)
+{
+    pWr->pTree    = pTree;
+    pWr->fCopy    = RT_BOOL(pTree->fFlags & RTBPTREE_F_LOCKLESS_READERS);
+    pWr->cSpare   = 0;
+    pWr->cNew     = 0;
+    pWr->cRetired = 0;
+    AssertReturn(cNodes <= RT_ELEMENTS(pWr->apSpare), VERR_INTERNAL_ERROR_3);
+    while (pWr->cSpare < cNodes)
+    {
+        PRTBPTREEU64HDR pNode = (PRTBPTREEU64HDR)pTree->pvSpareNodes;
+        if (pNode)
+        {
+            pTree->pvSpareNodes = ((PRTBPTREEU64INNER)pNode)->apChildren[0];
+            pTree->cSpareNodes--;
+        }
+        else
+        {
+            pNode = (PRTBPTREEU64HDR)RTMemCacheAlloc(pTree->hMemCache);
+            if (!pNode)
+            {
+                while (pWr->cSpare > 0)
+                    rtBpTreeU64FreeNode(pTree, pWr->apSpare[--pWr->cSpare]);
+                return VERR_NO_MEMORY;
+            }
+        }
+        pWr->apSpare[pWr->cSpare++] = pNode;
+    }
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Takes a preallocated node.
+ */
+static PRTBPTREEU64HDR rtBpTreeU64WrAlloc(PRTBPTREEU64WR pWr)
+{
+    AssertReleaseReturn(pWr->cSpare > 0, NULL);
+    PRTBPTREEU64HDR pNode = pWr->apSpare[--pWr->cSpare];
+    if (pWr->fCopy)
+    {
+        pWr->apNew[pWr->cNew++] = pNode;
+        pNode->fWritable = true;
+    }
+    else
+        pNode->fWritable = false;
+    return pNode;
+}
+
+
+/**
+ * Allocates a new empty node.
+ */
+static PRTBPTREEU64HDR rtBpTreeU64WrNew(PRTBPTREEU64WR pWr, bool fLeaf)
+{
+    PRTBPTREEU64HDR pNode = rtBpTreeU64WrAlloc(pWr);
+    bool const fWritable = pNode->fWritable;
+    RT_BZERO(pNode, RTBPTREE_NODE_SIZE);
+    pNode->fLeaf     = fLeaf;
+    pNode->fWritable = fWritable;
+    return pNode;
+}
+
+
+/**
+ * Makes a node writable, copying it if readers may see it.
+ *
+ * The caller must update the reference in the parent with the return value.
+ */
+static PRTBPTREEU64HDR rtBpTreeU64WrNode(PRTBPTREEU64WR pWr, PRTBPTREEU64HDR pNode)
+{
+    if (!pWr->fCopy || pNode->fWritable)
+        return pNode;
+    PRTBPTREEU64HDR pCopy = rtBpTreeU64WrAlloc(pWr);
+    memcpy(pCopy, pNode, RTBPTREE_NODE_SIZE);
+    pCopy->fWritable = true;
+    pWr->apRetired[pWr->cRetired++] = pNode;
+    return pCopy;
+}
+
+
+/**
+ * Gets rid of a node that is no longer part of the tree.
+ */
+static void rtBpTreeU64WrDiscard(PRTBPTREEU64WR pWr, PRTBPTREEU64HDR pNode)
+{
+    if (pWr->fCopy && pNode->fWritable)
+    {
+        /* Never seen by anyone, put it back. */
+        for (uint32_t i = 0; i < pWr->cNew; i++)
+            if (pWr->apNew[i] == pNode)
+            {
+                pWr->apNew[i] = pWr->apNew[--pWr->cNew];
+                break;
+            }
+        pWr->apSpare[pWr->cSpare++] = pNode;
+    }
+    else
+        pWr->apRetired[pWr->cRetired++] = pNode;
+}
+
+
+/**
+ * Publishes the modified tree and frees what it replaced.
+ *
+ * @param   pWr         The writer state.
+ * @param   pNewRoot    The new root node, NULL if empty.
+ */
+static void rtBpTreeU64WrCommit(PRTBPTREEU64WR pWr, PRTBPTREEU64HDR pNewRoot)
+{
+    PRTBPTREEU64 pTree = pWr->pTree;
+    for (uint32_t i = 0; i < pWr->cNew; i++)
+        pWr->apNew[i]->fWritable = false;
+
+    ASMAtomicWritePtr((void * volatile *)&pTree->pRoot, (void *)pNewRoot);
+    ASMAtomicIncU32(&pTree->uGeneration);
+
+    if (pWr->fCopy && pWr->cRetired)
+        rtRangeTreeRcuSynchronize(&pTree->Rcu);
+    while (pWr->cRetired > 0)
+        rtBpTreeU64FreeNode(pTree, pWr->apRetired[--pWr->cRetired]);
+    while (pWr->cSpare > 0)
+        rtBpTreeU64FreeNode(pTree, pWr->apSpare[--pWr->cSpare]);
+}
+
+
+/**
+ * Gets the tree height, 0 if empty.
+ */
+static uint32_t rtBpTreeU64Height(PRTBPTREEU64HDR pNode)
+{
+    uint32_t cHeight = 0;
+    while (pNode)
+    {
+        cHeight++;
+        if (pNode->fLeaf)
+            break;
+        pNode = ((PRTBPTREEU64INNER)pNode)->apChildren[0];
+    }
+    return cHeight;
+}
+
+
+/**
+ * Checks if a node is full.
+ */
+DECLINLINE(bool) rtBpTreeU64IsFull(PRTBPTREEU64HDR pNode)
+{
+    return pNode->cEntries >= (pNode->fLeaf ? RTBPTREE_LEAF_MAX : RTBPTREE_INNER_MAX);
+}
+
+
+/**
+ * Checks if a node is at its minimum, i.e. can't give away an entry.
+ */
+DECLINLINE(bool) rtBpTreeU64IsMin(PRTBPTREEU64HDR pNode)
+{
+    return pNode->cEntries <= (pNode->fLeaf ? RTBPTREE_LEAF_MIN : RTBPTREE_INNER_MIN);
+}
+
+
+/**
+ * Splits a full child in two.
+ *
+ * @param   pWr         The writer state.
+ * @param   pParent     The parent, writable and not full.
+ * @param   iChild      The index of the child to split, which must be
+ *                      writable.
+ */
+static void rtBpTreeU64Split(PRTBPTREEU64WR pWr, PRTBPTREEU64INNER pParent, unsigned iChild)
+{
+    PRTBPTREEU64HDR pLeft  = pParent->apChildren[iChild];
+    PRTBPTREEU64HDR pRight = rtBpTreeU64WrNew(pWr, pLeft->fLeaf);
+    uint64_t        uSeparator;
+    if (pLeft->fLeaf)
+    {
+        PRTBPTREEU64LEAF pLeftLeaf  = (PRTBPTREEU64LEAF)pLeft;
+        PRTBPTREEU64LEAF pRightLeaf = (PRTBPTREEU64LEAF)pRight;
+        unsigned const   cLeft      = RTBPTREE_LEAF_MAX / 2;
+        unsigned const   cRight     = pLeft->cEntries - cLeft;
+        memcpy(&pRightLeaf->aKeys[0],     &pLeftLeaf->aKeys[cLeft],     cRight * sizeof(pLeftLeaf->aKeys[0]));
+        memcpy(&pRightLeaf->aKeysLast[0], &pLeftLeaf->aKeysLast[cLeft], cRight * sizeof(pLeftLeaf->aKeysLast[0]));
+        memcpy(&pRightLeaf->apCores[0],   &pLeftLeaf->apCores[cLeft],   cRight * sizeof(pLeftLeaf->apCores[0]));
+        pRight->cEntries = (uint16_t)cRight;
+        pLeft->cEntries  = (uint16_t)cLeft;
+        uSeparator = pRightLeaf->aKeys[0];
+    }
+    else
+    {
+        /* The middle key moves up. */
+        PRTBPTREEU64INNER pLeftInner  = (PRTBPTREEU64INNER)pLeft;
+        PRTBPTREEU64INNER pRightInner = (PRTBPTREEU64INNER)pRight;
+        unsigned const    cLeft       = RTBPTREE_INNER_MAX / 2;
+        unsigned const    cRight      = pLeft->cEntries - cLeft - 1;
+        uSeparator = pLeftInner->aKeys[cLeft];
+        memcpy(&pRightInner->aKeys[0],      &pLeftInner->aKeys[cLeft + 1],      cRight * sizeof(pLeftInner->aKeys[0]));
+        memcpy(&pRightInner->apChildren[0], &pLeftInner->apChildren[cLeft + 1], (cRight + 1) * sizeof(pLeftInner->apChildren[0]));
+        pRight->cEntries = (uint16_t)cRight;
+        pLeft->cEntries  = (uint16_t)cLeft;
+    }
+
+    unsigned const cKeys = pParent->Hdr.cEntries;
+    Assert(cKeys < RTBPTREE_INNER_MAX);
+    memmove(&pParent->aKeys[iChild + 1],      &pParent->aKeys[iChild],      (cKeys - iChild) * sizeof(pParent->aKeys[0]));
+    memmove(&pParent->apChildren[iChild + 2], &pParent->apChildren[iChild + 1], (cKeys - iChild) * sizeof(pParent->apChildren[0]));
+    pParent->aKeys[iChild]          = uSeparator;
+    pParent->apChildren[iChild + 1] = pRight;
+    pParent->Hdr.cEntries           = (uint16_t)(cKeys + 1);
+}
+
+
+RTDECL(int) RTBpTreeU64Init(PRTBPTREEU64 pTree, uint32_t fFlags)
+{
+    AssertPtrReturn(pTree, VERR_INVALID_POINTER);
+    AssertReturn(!(fFlags & ~RTBPTREE_F_VALID_MASK), VERR_INVALID_FLAGS);
+
+    pTree->pRoot        = NULL;
+    pTree->uGeneration  = 0;
+    pTree->fFlags       = fFlags;
+    pTree->cNodes       = 0;
+    pTree->pvSpareNodes = NULL;
+    pTree->cSpareNodes  = 0;
+    rtRangeTreeRcuInit(&pTree->Rcu);
+    return RTMemCacheCreate(&pTree->hMemCache, RTBPTREE_NODE_SIZE, 64 /*cbAlignment*/, UINT32_MAX,
+                            NULL /*pfnCtor*/, NULL /*pfnDtor*/, NULL /*pvUser*/, 0 /*fFlags*/);
+}
+RT_EXPORT_SYMBOL(RTBpTreeU64Init);
+
+
+RTDECL(int) RTBpTreeU64Insert(PRTBPTREEU64 pTree, PRTRANGEU64NODECORE pNode)
+{
+    AssertPtrReturn(pTree, VERR_INVALID_POINTER);
+    AssertPtrReturn(pNode, VERR_INVALID_POINTER);
+    AssertReturn(pNode->Key <= pNode->KeyLast, VERR_INVALID_PARAMETER);
+    uint64_t const Key = pNode->Key;
+
+    /*
+     * Check for overlaps: only the range with the largest first key at or
+     * below our last key can overlap, as the ranges are disjoint.
+     */
+    PRTBPTREEU64HDR  pRoot = (PRTBPTREEU64HDR)pTree->pRoot;
+    unsigned         i;
+    PRTBPTREEU64LEAF pLeaf = rtBpTreeU64Seek(pRoot, pNode->KeyLast, false /*fAbove*/, &i);
+    if (pLeaf && pLeaf->aKeysLast[i] >= Key)
+        return VERR_ALREADY_EXISTS;
+
+    RTBPTREEU64WR  Wr;
+    uint32_t const cHeight = rtBpTreeU64Height(pRoot);
+    int rc = rtBpTreeU64WrInit(&Wr, pTree, (pTree->fFlags & RTBPTREE_F_LOCKLESS_READERS ? 2 * cHeight : cHeight) + 1);
+    if (RT_FAILURE(rc))
+        return rc;
+
+    /*
+     * Descend, splitting full nodes on the way so there is always room for
+     * the separator when a child is split.
+     */
+    PRTBPTREEU64HDR pNewRoot;
+    if (pRoot)
+    {
+        pNewRoot = rtBpTreeU64WrNode(&Wr, pRoot);
+        if (rtBpTreeU64IsFull(pNewRoot))
+        {
+            PRTBPTREEU64INNER pInner = (PRTBPTREEU64INNER)rtBpTreeU64WrNew(&Wr, false /*fLeaf*/);
+            pInner->apChildren[0] = pNewRoot;
+            rtBpTreeU64Split(&Wr, pInner, 0);
+            pNewRoot = &pInner->Hdr;
+        }
+
+        PRTBPTREEU64HDR pCur = pNewRoot;
+        while (!pCur->fLeaf)
+        {
+            PRTBPTREEU64INNER pInner = (PRTBPTREEU64INNER)pCur;
+            i = rtBpTreeU64InnerChild(pInner, Key);
+            PRTBPTREEU64HDR pChild = rtBpTreeU64WrNode(&Wr, pInner->apChildren[i]);
+            pInner->apChildren[i] = pChild;
+            if (rtBpTreeU64IsFull(pChild))
+            {
+                rtBpTreeU64Split(&Wr, pInner, i);
+                if (Key >= pInner->aKeys[i])
+                    pChild = pInner->apChildren[i + 1];
+            }
+            pCur = pChild;
+        }
+        pLeaf = (PRTBPTREEU64LEAF)pCur;
+    }
+    else
+    {
+        pLeaf    = (PRTBPTREEU64LEAF)rtBpTreeU64WrNew(&Wr, true /*fLeaf*/);
+        pNewRoot = &pLeaf->Hdr;
+    }
+
+    /*
+     * Insert into the leaf.
+     */
+    unsigned const cEntries = pLeaf->Hdr.cEntries;
+    Assert(cEntries < RTBPTREE_LEAF_MAX);
+    i = rtBpTreeU64LeafUpperBound(pLeaf, Key);
+    memmove(&pLeaf->aKeys[i + 1],     &pLeaf->aKeys[i],     (cEntries - i) * sizeof(pLeaf->aKeys[0]));
+    memmove(&pLeaf->aKeysLast[i + 1], &pLeaf->aKeysLast[i], (cEntries - i) * sizeof(pLeaf->aKeysLast[0]));
+    memmove(&pLeaf->apCores[i + 1],   &pLeaf->apCores[i],   (cEntries - i) * sizeof(pLeaf->apCores[0]));
+    pLeaf->aKeys[i]     = Key;
+    pLeaf->aKeysLast[i] = pNode->KeyLast;
+    pLeaf->apCores[i]   = pNode;
+    pLeaf->Hdr.cEntries = (uint16_t)(cEntries + 1);
+
+    pTree->cNodes++;
+    rtBpTreeU64WrCommit(&Wr, pNewRoot);
+    return VINF_SUCCESS;
+}
+RT_EXPORT_SYMBOL(RTBpTreeU64Insert);
+
+
+/**
+ * Makes sure a child has more than the minimum number of entries before we
+ * descend into it, borrowing from or merging with a sibling.
+ *
+ * @returns The writable child to descend into.
+ * @param   pWr         The writer state.
+ * @param   pParent     The parent, writable.
+ * @param   iChild      The index of the child.
+ */
+static PRTBPTREEU64HDR rtBpTreeU64Refill(PRTBPTREEU64WR pWr, PRTBPTREEU64INNER pParent, unsigned iChild)
+{
+    unsigned const  cKeys  = pParent->Hdr.cEntries;
+    PRTBPTREEU64HDR pChild = pParent->apChildren[iChild];
+
+    if (iChild > 0 && !rtBpTreeU64IsMin(pParent->apChildren[iChild - 1]))
+    {
+        /*
+         * Borrow the last entry of the left sibling.
+         */
+        PRTBPTREEU64HDR pLeft = rtBpTreeU64WrNode(pWr, pParent->apChildren[iChild - 1]);
+        pParent->apChildren[iChild - 1] = pLeft;
+        pChild = rtBpTreeU64WrNode(pWr, pChild);
+        pParent->apChildren[iChild] = pChild;
+
+        unsigned const c     = pChild->cEntries;
+        unsigned const iLast = pLeft->cEntries - 1U;
+        if (pChild->fLeaf)
+        {
+            PRTBPTREEU64LEAF pChildLeaf = (PRTBPTREEU64LEAF)pChild;
+            PRTBPTREEU64LEAF pLeftLeaf  = (PRTBPTREEU64LEAF)pLeft;
+            memmove(&pChildLeaf->aKeys[1],     &pChildLeaf->aKeys[0],     c * sizeof(pChildLeaf->aKeys[0]));
+            memmove(&pChildLeaf->aKeysLast[1], &pChildLeaf->aKeysLast[0], c * sizeof(pChildLeaf->aKeysLast[0]));
+            memmove(&pChildLeaf->apCores[1],   &pChildLeaf->apCores[0],   c * sizeof(pChildLeaf->apCores[0]));
+            pChildLeaf->aKeys[0]     = pLeftLeaf->aKeys[iLast];
+            pChildLeaf->aKeysLast[0] = pLeftLeaf->aKeysLast[iLast];
+            pChildLeaf->apCores[0]   = pLeftLeaf->apCores[iLast];
+            pParent->aKeys[iChild - 1] = pChildLeaf->aKeys[0];
+        }
+        else
+        {
+            PRTBPTREEU64INNER pChildInner = (PRTBPTREEU64INNER)pChild;
+            PRTBPTREEU64INNER pLeftInner  = (PRTBPTREEU64INNER)pLeft;
+            memmove(&pChildInner->aKeys[1],      &pChildInner->aKeys[0],      c * sizeof(pChildInner->aKeys[0]));
+            memmove(&pChildInner->apChildren[1], &pChildInner->apChildren[0], (c + 1) * sizeof(pChildInner->apChildren[0]));
+            pChildInner->aKeys[0]      = pParent->aKeys[iChild - 1];
+            pChildInner->apChildren[0] = pLeftInner->apChildren[iLast + 1];
+            pParent->aKeys[iChild - 1] = pLeftInner->aKeys[iLast];
+        }
+        pLeft->cEntries  = (uint16_t)iLast;
+        pChild->cEntries = (uint16_t)(c + 1);
+        return pChild;
+    }
+
+    if (iChild < cKeys && !rtBpTreeU64IsMin(pParent->apChildren[iChild + 1]))
+    {
+        /*
+         * Borrow the first entry of the right sibling.
+         */
+        PRTBPTREEU64HDR pRight = rtBpTreeU64WrNode(pWr, pParent->apChildren[iChild + 1]);
+        pParent->apChildren[iChild + 1] = pRight;
+        pChild = rtBpTreeU64WrNode(pWr, pChild);
+        pParent->apChildren[iChild] = pChild;
+
+        unsigned const c      = pChild->cEntries;
+        unsigned const cRight = pRight->cEntries - 1U;
+        if (pChild->fLeaf)
+        {
+            PRTBPTREEU64LEAF pChildLeaf = (PRTBPTREEU64LEAF)pChild;
+            PRTBPTREEU64LEAF pRightLeaf = (PRTBPTREEU64LEAF)pRight;
+            pChildLeaf->aKeys[c]     = pRightLeaf->aKeys[0];
+            pChildLeaf->aKeysLast[c] = pRightLeaf->aKeysLast[0];
+            pChildLeaf->apCores[c]   = pRightLeaf->apCores[0];
+            memmove(&pRightLeaf->aKeys[0],     &pRightLeaf->aKeys[1],     cRight * sizeof(pRightLeaf->aKeys[0]));
+            memmove(&pRightLeaf->aKeysLast[0], &pRightLeaf->aKeysLast[1], cRight * sizeof(pRightLeaf->aKeysLast[0]));
+            memmove(&pRightLeaf->apCores[0],   &pRightLeaf->apCores[1],   cRight * sizeof(pRightLeaf->apCores[0]));
+            pParent->aKeys[iChild] = pRightLeaf->aKeys[0];
+        }
+        else
+        {
+            PRTBPTREEU64INNER pChildInner = (PRTBPTREEU64INNER)pChild;
+            PRTBPTREEU64INNER pRightInner = (PRTBPTREEU64INNER)pRight;
+            pChildInner->aKeys[c]          = pParent->aKeys[iChild];
+            pChildInner->apChildren[c + 1] = pRightInner->apChildren[0];
+            pParent->aKeys[iChild]         = pRightInner->aKeys[0];
+            memmove(&pRightInner->aKeys[0],      &pRightInner->aKeys[1],      cRight * sizeof(pRightInner->aKeys[0]));
+            memmove(&pRightInner->apChildren[0], &pRightInner->apChildren[1], (cRight + 1) * sizeof(pRightInner->apChildren[0]));
+        }
+        pRight->cEntries = (uint16_t)cRight;
+        pChild->cEntries = (uint16_t)(c + 1);
+        return pChild;
+    }
+
+    /*
+     * Both siblings are at the minimum, merge with one of them.  We always
+     * merge the right node into the left one.
+     */
+    unsigned iLeft = iChild > 0 ? iChild - 1 : iChild;
+    PRTBPTREEU64HDR pLeft  = rtBpTreeU64WrNode(pWr, pParent->apChildren[iLeft]);
+    PRTBPTREEU64HDR pRight = pParent->apChildren[iLeft + 1];
+    pParent->apChildren[iLeft] = pLeft;
+
+    unsigned const cLeft  = pLeft->cEntries;
+    unsigned const cRight = pRight->cEntries;
+    if (pLeft->fLeaf)
+    {
+        PRTBPTREEU64LEAF pLeftLeaf  = (PRTBPTREEU64LEAF)pLeft;
+        PRTBPTREEU64LEAF pRightLeaf = (PRTBPTREEU64LEAF)pRight;
+        Assert(cLeft + cRight <= RTBPTREE_LEAF_MAX);
+        memcpy(&pLeftLeaf->aKeys[cLeft],     &pRightLeaf->aKeys[0],     cRight * sizeof(pLeftLeaf->aKeys[0]));
+        memcpy(&pLeftLeaf->aKeysLast[cLeft], &pRightLeaf->aKeysLast[0], cRight * sizeof(pLeftLeaf->aKeysLast[0]));
+        memcpy(&pLeftLeaf->apCores[cLeft],   &pRightLeaf->apCores[0],   cRight * sizeof(pLeftLeaf->apCores[0]));
+        pLeft->cEntries = (uint16_t)(cLeft + cRight);
+    }
+    else
+    {
+        PRTBPTREEU64INNER pLeftInner  = (PRTBPTREEU64INNER)pLeft;
+        PRTBPTREEU64INNER pRightInner = (PRTBPTREEU64INNER)pRight;
+        Assert(cLeft + 1 + cRight <= RTBPTREE_INNER_MAX);
+        pLeftInner->aKeys[cLeft] = pParent->aKeys[iLeft];
+        memcpy(&pLeftInner->aKeys[cLeft + 1],      &pRightInner->aKeys[0],      cRight * sizeof(pLeftInner->aKeys[0]));
+        memcpy(&pLeftInner->apChildren[cLeft + 1], &pRightInner->apChildren[0], (cRight + 1) * sizeof(pLeftInner->apChildren[0]));
+        pLeft->cEntries = (uint16_t)(cLeft + 1 + cRight);
+    }
+
+    memmove(&pParent->aKeys[iLeft],          &pParent->aKeys[iLeft + 1],      (cKeys - iLeft - 1) * sizeof(pParent->aKeys[0]));
+    memmove(&pParent->apChildren[iLeft + 1], &pParent->apChildren[iLeft + 2], (cKeys - iLeft - 1) * sizeof(pParent->apChildren[0]));
+    pParent->Hdr.cEntries = (uint16_t)(cKeys - 1);
+    rtBpTreeU64WrDiscard(pWr, pRight);
+    return pLeft;
+}
+
+
+/**
+ * Removes the entry with the given first key, which must be present.
+ *
+ * @returns The removed node core, NULL if out of memory.
+ * @param   pTree       The tree.
+ * @param   Key         The first key of the entry.
+ */
+static PRTRANGEU64NODECORE rtBpTreeU64RemoveIt(PRTBPTREEU64 pTree, uint64_t Key)
+{
+    PRTBPTREEU64HDR pRoot   = (PRTBPTREEU64HDR)pTree->pRoot;
+    uint32_t const  cHeight = rtBpTreeU64Height(pRoot);
+    RTBPTREEU64WR   Wr;
+    int rc = rtBpTreeU64WrInit(&Wr, pTree, pTree->fFlags & RTBPTREE_F_LOCKLESS_READERS ? 2 * cHeight : 0);
+    if (RT_FAILURE(rc))
+        return NULL;
+
+    /*
+     * Descend, making sure each node we enter can lose an entry.
+     */
+    PRTBPTREEU64HDR pNewRoot = rtBpTreeU64WrNode(&Wr, pRoot);
+    PRTBPTREEU64HDR pCur     = pNewRoot;
+    while (!pCur->fLeaf)
+    {
+        PRTBPTREEU64INNER pInner = (PRTBPTREEU64INNER)pCur;
+        unsigned const    i      = rtBpTreeU64InnerChild(pInner, Key);
+        PRTBPTREEU64HDR   pChild = pInner->apChildren[i];
+        if (rtBpTreeU64IsMin(pChild))
+            pChild = rtBpTreeU64Refill(&Wr, pInner, i);
+        else
+        {
+            pChild = rtBpTreeU64WrNode(&Wr, pChild);
+            pInner->apChildren[i] = pChild;
+        }
+        pCur = pChild;
+    }
+
+    PRTBPTREEU64LEAF pLeaf    = (PRTBPTREEU64LEAF)pCur;
+    unsigned const   cEntries = pLeaf->Hdr.cEntries;
+    unsigned const   i        = rtBpTreeU64LeafUpperBound(pLeaf, Key) - 1U;
+    AssertReleaseMsg(i < cEntries && pLeaf->aKeys[i] == Key, ("%#RX64\n", Key));
+    PRTRANGEU64NODECORE pNode = pLeaf->apCores[i];
+    memmove(&pLeaf->aKeys[i],     &pLeaf->aKeys[i + 1],     (cEntries - i - 1) * sizeof(pLeaf->aKeys[0]));
+    memmove(&pLeaf->aKeysLast[i], &pLeaf->aKeysLast[i + 1], (cEntries - i - 1) * sizeof(pLeaf->aKeysLast[0]));
+    memmove(&pLeaf->apCores[i],   &pLeaf->apCores[i + 1],   (cEntries - i - 1) * sizeof(pLeaf->apCores[0]));
+    pLeaf->Hdr.cEntries = (uint16_t)(cEntries - 1);
+
+    /*
+     * Drop the root if it ran empty.
+     */
+    while (pNewRoot && pNewRoot->cEntries == 0)
+    {
+        PRTBPTREEU64HDR pOldRoot = pNewRoot;
+        pNewRoot = pOldRoot->fLeaf ? NULL : ((PRTBPTREEU64INNER)pOldRoot)->apChildren[0];
+        rtBpTreeU64WrDiscard(&Wr, pOldRoot);
+    }
+
+    pTree->cNodes--;
+    rtBpTreeU64WrCommit(&Wr, pNewRoot);
+    return pNode;
+}
+
+
+RTDECL(PRTRANGEU64NODECORE) RTBpTreeU64Remove(PRTBPTREEU64 pTree, uint64_t Key)
+{
+    AssertPtrReturn(pTree, NULL);
+    unsigned         i;
+    PRTBPTREEU64LEAF pLeaf = rtBpTreeU64Seek((PRTBPTREEU64HDR)pTree->pRoot, Key, false /*fAbove*/, &i);
+    if (!pLeaf || pLeaf->aKeys[i] != Key)
+        return NULL;
+    return rtBpTreeU64RemoveIt(pTree, Key);
+}
+RT_EXPORT_SYMBOL(RTBpTreeU64Remove);
+
+
+RTDECL(PRTRANGEU64NODECORE) RTBpTreeU64RangeRemove(PRTBPTREEU64 pTree, uint64_t Key)
+{
+    AssertPtrReturn(pTree, NULL);
+    unsigned         i;
+    PRTBPTREEU64LEAF pLeaf = rtBpTreeU64Seek((PRTBPTREEU64HDR)pTree->pRoot, Key, false /*fAbove*/, &i);
+    if (!pLeaf || pLeaf->aKeysLast[i] < Key)
+        return NULL;
+    return rtBpTreeU64RemoveIt(pTree, pLeaf->aKeys[i]);
+}
+RT_EXPORT_SYMBOL(RTBpTreeU64RangeRemove);
+
+
+RTDECL(PRTRANGEU64NODECORE) RTBpTreeU64Get(PRTBPTREEU64 pTree, uint64_t Key)
+{
+    unsigned         i;
+    PRTBPTREEU64LEAF pLeaf = rtBpTreeU64Seek(rtBpTreeU64GetRoot(pTree), Key, false /*fAbove*/, &i);
+    if (pLeaf && pLeaf->aKeys[i] == Key)
+        return pLeaf->apCores[i];
+    return NULL;
+}
+RT_EXPORT_SYMBOL(RTBpTreeU64Get);
+
+
+RTDECL(PRTRANGEU64NODECORE) RTBpTreeU64RangeGet(PRTBPTREEU64 pTree, uint64_t Key)
+{
+    unsigned         i;
+    PRTBPTREEU64LEAF pLeaf = rtBpTreeU64Seek(rtBpTreeU64GetRoot(pTree), Key, false /*fAbove*/, &i);
+    if (pLeaf && pLeaf->aKeysLast[i] >= Key)
+        return pLeaf->apCores[i];
+    return NULL;
+}
+RT_EXPORT_SYMBOL(RTBpTreeU64RangeGet);
+
+
+RTDECL(PRTRANGEU64NODECORE) RTBpTreeU64GetBestFit(PRTBPTREEU64 pTree, uint64_t Key, bool fAbove)
+{
+    unsigned         i;
+    PRTBPTREEU64LEAF pLeaf = rtBpTreeU64Seek(rtBpTreeU64GetRoot(pTree), Key, fAbove, &i);
+    return pLeaf ? pLeaf->apCores[i] : NULL;
+}
+RT_EXPORT_SYMBOL(RTBpTreeU64GetBestFit);
+
+
+/**
+ * Worker for RTBpTreeU64DoWithAll.
+ */
+static int rtBpTreeU64DoWithAllNode(PRTBPTREEU64HDR pNode, bool fFromLeft, PFNRTRANGEU64CALLBACK pfnCallback, void *pvUser)
+{
+    unsigned const c = pNode->cEntries;
+    if (pNode->fLeaf)
+    {
+        PRTBPTREEU64LEAF pLeaf = (PRTBPTREEU64LEAF)pNode;
+        for (unsigned i = 0; i < c; i++)
+        {
+            int rc = pfnCallback(pLeaf->apCores[fFromLeft ? i : c - 1 - i], pvUser);
+            if (rc != VINF_SUCCESS)
+                return rc;
+        }
+    }
+    else
+    {
+        PRTBPTREEU64INNER pInner = (PRTBPTREEU64INNER)pNode;
+        for (unsigned i = 0; i <= c; i++)
+        {
+            int rc = rtBpTreeU64DoWithAllNode(pInner->apChildren[fFromLeft ? i : c - i], fFromLeft, pfnCallback, pvUser);
+            if (rc != VINF_SUCCESS)
+                return rc;
+        }
+    }
+    return VINF_SUCCESS;
+}
+
+
+RTDECL(int) RTBpTreeU64DoWithAll(PRTBPTREEU64 pTree, bool fFromLeft, PFNRTRANGEU64CALLBACK pfnCallback, void *pvUser)
+{
+    AssertPtrReturn(pfnCallback, VERR_INVALID_POINTER);
+    PRTBPTREEU64HDR pRoot = rtBpTreeU64GetRoot(pTree);
+    if (!pRoot)
+        return VINF_SUCCESS;
+    return rtBpTreeU64DoWithAllNode(pRoot, fFromLeft, pfnCallback, pvUser);
+}
+RT_EXPORT_SYMBOL(RTBpTreeU64DoWithAll);
+
+
+/**
+ * Worker for RTBpTreeU64Destroy.
+ */
+static int rtBpTreeU64DestroyNode(PRTBPTREEU64 pTree, PRTBPTREEU64HDR pNode, PFNRTRANGEU64CALLBACK pfnCallback, void *pvUser)
+{
+    int            rcRet = VINF_SUCCESS;
+    unsigned const c     = pNode->cEntries;
+    if (pNode->fLeaf)
+    {
+        if (pfnCallback)
+        {
+            PRTBPTREEU64LEAF pLeaf = (PRTBPTREEU64LEAF)pNode;
+            for (unsigned i = 0; i < c; i++)
+            {
+                int rc = pfnCallback(pLeaf->apCores[i], pvUser);
+                if (rc != VINF_SUCCESS && rcRet == VINF_SUCCESS)
+                    rcRet = rc;
+            }
+        }
+    }
+    else
+    {
+        PRTBPTREEU64INNER pInner = (PRTBPTREEU64INNER)pNode;
+        for (unsigned i = 0; i <= c; i++)
+        {
+            int rc = rtBpTreeU64DestroyNode(pTree, pInner->apChildren[i], pfnCallback, pvUser);
+            if (rc != VINF_SUCCESS && rcRet == VINF_SUCCESS)
+                rcRet = rc;
+        }
+    }
+    RTMemCacheFree(pTree->hMemCache, pNode);
+    return rcRet;
+}
+
+
+RTDECL(int) RTBpTreeU64Destroy(PRTBPTREEU64 pTree, PFNRTRANGEU64CALLBACK pfnCallback, void *pvUser)
+{
+    AssertPtrReturn(pTree, VERR_INVALID_POINTER);
+    int rc = VINF_SUCCESS;
+    PRTBPTREEU64HDR pRoot = (PRTBPTREEU64HDR)pTree->pRoot;
+    if (pRoot)
+    {
+        pTree->pRoot = NULL;
+        rc = rtBpTreeU64DestroyNode(pTree, pRoot, pfnCallback, pvUser);
+    }
+    while (pTree->pvSpareNodes)
+    {
+        PRTBPTREEU64HDR pNode = (PRTBPTREEU64HDR)pTree->pvSpareNodes;
+        pTree->pvSpareNodes = ((PRTBPTREEU64INNER)pNode)->apChildren[0];
+        RTMemCacheFree(pTree->hMemCache, pNode);
+    }
+    pTree->cSpareNodes = 0;
+    pTree->cNodes      = 0;
+    ASMAtomicIncU32(&pTree->uGeneration);
+    RTMemCacheDestroy(pTree->hMemCache);
+    pTree->hMemCache = NIL_RTMEMCACHE;
+    return rc;
+}
+RT_EXPORT_SYMBOL(RTBpTreeU64Destroy);
+
+
+RTDECL(void) RTBpTreeU64IterInit(PRTBPTREEU64ITER pIter, uint64_t uFirstKey)
+{
+    pIter->uNextKey    = uFirstKey;
+    pIter->fDone       = false;
+    pIter->pvLeaf      = NULL;
+    pIter->iEntry      = 0;
+    pIter->uGeneration = 0;
+}
+RT_EXPORT_SYMBOL(RTBpTreeU64IterInit);
+
+
+RTDECL(PRTRANGEU64NODECORE) RTBpTreeU64IterNext(PRTBPTREEU64 pTree, PRTBPTREEU64ITER pIter)
+{
+    if (pIter->fDone)
+        return NULL;
+
+    /*
+     * Continue in the cached leaf if the tree didn't change, otherwise look
+     * up the next key.  The generation must be read before the lookup.
+     */
+    uint32_t const   uGeneration = ASMAtomicReadU32(&pTree->uGeneration);
+    PRTBPTREEU64LEAF pLeaf       = (PRTBPTREEU64LEAF)pIter->pvLeaf;
+    unsigned         i           = pIter->iEntry;
+    if (   !pLeaf
+        || pIter->uGeneration != uGeneration
+        || i >= pLeaf->Hdr.cEntries)
+    {
+        pLeaf = rtBpTreeU64Seek(rtBpTreeU64GetRoot(pTree), pIter->uNextKey, true /*fAbove*/, &i);
+        if (!pLeaf)
+        {
+            pIter->fDone  = true;
+            pIter->pvLeaf = NULL;
+            return NULL;
+        }
+    }
+
+    pIter->pvLeaf      = pLeaf;
+    pIter->iEntry      = i + 1;
+    pIter->uGeneration = uGeneration;
+    if (pLeaf->aKeys[i] == UINT64_MAX)
+        pIter->fDone = true;
+    else
+        pIter->uNextKey = pLeaf->aKeys[i] + 1;
+    return pLeaf->apCores[i];
+}
+RT_EXPORT_SYMBOL(RTBpTreeU64IterNext);
+
+
+RTDECL(uint32_t) RTBpTreeU64ReadEnter(PRTBPTREEU64 pTree)
+{
+    return rtRangeTreeRcuEnter(&pTree->Rcu);
+}
+RT_EXPORT_SYMBOL(RTBpTreeU64ReadEnter);
+
+
+RTDECL(void) RTBpTreeU64ReadLeave(PRTBPTREEU64 pTree, uint32_t uToken)
+{
+    rtRangeTreeRcuLeave(&pTree->Rcu, uToken);
+}
+RT_EXPORT_SYMBOL(RTBpTreeU64ReadLeave);
+
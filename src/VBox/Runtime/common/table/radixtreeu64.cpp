@@ -0,0 +1,693 @@
+/* $Id$ */
+/** @file
+ * IPRT - Radix tree of uint64_t ranges.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include "internal/iprt.h"
+#include <iprt/bptree.h>
+
+#include <iprt/asm.h>
+#include <iprt/assert.h>
+#include <iprt/err.h>
+#include <iprt/memcache.h>
+#include <iprt/string.h>
+#include "internal/rangetree.h"
+
+
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** The number of index bits resolved per level. */
+#define RTRADIXTREE_SLOT_SHIFT      6
+/** The number of slots per node. */
+#define RTRADIXTREE_SLOTS           RT_BIT_32(RTRADIXTREE_SLOT_SHIFT)
+/** The slot mask. */
+#define RTRADIXTREE_SLOT_MASK       (RTRADIXTREE_SLOTS - 1)
+
+/** Checks if a slot value is a (tagged) node core pointer. */
+#define RTRADIXTREE_IS_CORE(a_pv)   (((uintptr_t)(a_pv) & 1) != 0)
+/** Converts a slot value to a node core pointer. */
+#define RTRADIXTREE_TO_CORE(a_pv)   ((PRTRANGEU64NODECORE)((uintptr_t)(a_pv) & ~(uintptr_t)1))
+/** Converts a node core pointer to a slot value. */
+#define RTRADIXTREE_FROM_CORE(a_p)  ((void *)((uintptr_t)(a_p) | 1))
+
+
+/*********************************************************************************************************************************
+*   Structures and Typedefs                                                                                                      *
+*********************************************************************************************************************************/
+/**
+ * Radix tree node.
+ *
+ * A slot is either empty, points to a child node, or holds a tagged node
+ * core pointer when the range covers the whole block of indexes the slot
+ * stands for.  A range is thus stored in as few slots as possible, using
+ * the higher levels for the aligned blocks it covers completely.
+ */
+typedef struct RTRADIXTREEU64NODE
+{
+    /** The number of index bits below the slots of this node. */
+    uint8_t                             uShift;
+    /** Explicit padding. */
+    uint8_t                             bPadding;
+    /** Number of slots in use. */
+    uint16_t                            cUsed;
+    /** Explicit padding. */
+    uint32_t                            u32Padding;
+    /** Link in the list of nodes waiting to be freed. */
+    struct RTRADIXTREEU64NODE          *pNextRetired;
+    /** The slots. */
+    void * volatile                     apSlots[RTRADIXTREE_SLOTS];
+} RTRADIXTREEU64NODE;
+/** Pointer to a radix tree node. */
+typedef RTRADIXTREEU64NODE *PRTRADIXTREEU64NODE;
+
+/**
+ * Writer state for one modification.
+ */
+typedef struct RTRADIXTREEU64WR
+{
+    /** The tree. */
+    PRTRADIXTREEU64                     pTree;
+    /** The tagged node core being inserted or removed. */
+    void                               *pvCore;
+    /** Nodes no longer in the tree. */
+    PRTRADIXTREEU64NODE                 pRetired;
+    /** Number of slots cleared by the removal. */
+    uint32_t                            cCleared;
+} RTRADIXTREEU64WR;
+/** Pointer to writer state. */
+typedef RTRADIXTREEU64WR *PRTRADIXTREEU64WR;
+
+
+/**
+ * Gets the last index covered by a node with the given shift, relative to the
+ * node base.
+ */
+DECLINLINE(uint64_t) rtRadixTreeU64Span(unsigned uShift)
+{
+    if (uShift + RTRADIXTREE_SLOT_SHIFT >= 64)
+        return UINT64_MAX;
+    return RT_BIT_64(uShift + RTRADIXTREE_SLOT_SHIFT) - 1;
+}
+
+
+/**
+ * Reads the root node pointer.
+ */
+DECLINLINE(PRTRADIXTREEU64NODE) rtRadixTreeU64GetRoot(PRTRADIXTREEU64 pTree)
+{
+    return (PRTRADIXTREEU64NODE)ASMAtomicReadPtr((void * volatile *)&pTree->pRoot);
+}
+
+
+/**
+ * Reads a slot.
+ */
+DECLINLINE(void *) rtRadixTreeU64GetSlot(PRTRADIXTREEU64NODE pNode, unsigned iSlot)
+{
+    return ASMAtomicReadPtr(&pNode->apSlots[iSlot]);
+}
+
+
+/**
+ * Looks up the node core covering the given index.
+ */
+static PRTRANGEU64NODECORE rtRadixTreeU64Lookup(PRTRADIXTREEU64NODE pNode, uint64_t idx)
+{
+    if (!pNode || idx > rtRadixTreeU64Span(pNode->uShift))
+        return NULL;
+    for (;;)
+    {
+        void *pv = rtRadixTreeU64GetSlot(pNode, (unsigned)(idx >> pNode->uShift) & RTRADIXTREE_SLOT_MASK);
+        if (!pv)
+            return NULL;
+        if (RTRADIXTREE_IS_CORE(pv))
+            return RTRADIXTREE_TO_CORE(pv);
+        pNode = (PRTRADIXTREEU64NODE)pv;
+    }
+}
+
+
+/**
+ * Finds the first node core covering an index at or after @a idx.
+ *
+ * @param   pNode       The node.
+ * @param   uBase       The first index the node covers.
+ * @param   idx         The index to start at, within the node.
+ */
+static PRTRANGEU64NODECORE rtRadixTreeU64FindNext(PRTRADIXTREEU64NODE pNode, uint64_t uBase, uint64_t idx)
+{
+    unsigned const uShift = pNode->uShift;
+    for (unsigned iSlot = (unsigned)((idx - uBase) >> uShift); iSlot < RTRADIXTREE_SLOTS; iSlot++)
+    {
+        void *pv = rtRadixTreeU64GetSlot(pNode, iSlot);
+        if (!pv)
+            continue;
+        if (RTRADIXTREE_IS_CORE(pv))
+            return RTRADIXTREE_TO_CORE(pv);
+        uint64_t const uChildBase = uBase + ((uint64_t)iSlot << uShift);
+        PRTRANGEU64NODECORE pCore = rtRadixTreeU64FindNext((PRTRADIXTREEU64NODE)pv, uChildBase, RT_MAX(idx, uChildBase));
+        if (pCore)
+            return pCore;
+    }
+    return NULL;
+}
+
+
+/**
+ * Finds the last node core covering an index at or before @a idx.
+ *
+ * @param   pNode       The node.
+ * @param   uBase       The first index the node covers.
+ * @param   idx         The index to start at, within the node.
+ */
+static PRTRANGEU64NODECORE rtRadixTreeU64FindPrev(PRTRADIXTREEU64NODE pNode, uint64_t uBase, uint64_t idx)
+{
+    unsigned const uShift = pNode->uShift;
+    for (int iSlot = (int)((idx - uBase) >> uShift); iSlot >= 0; iSlot--)
+    {
+        void *pv = rtRadixTreeU64GetSlot(pNode, (unsigned)iSlot);
+        if (!pv)
+            continue;
+        if (RTRADIXTREE_IS_CORE(pv))
+            return RTRADIXTREE_TO_CORE(pv);
+        uint64_t const uChildBase = uBase + ((uint64_t)iSlot << uShift);
+        uint64_t const uChildLast = uChildBase + RT_BIT_64(uShift) - 1;
+        PRTRANGEU64NODECORE pCore = rtRadixTreeU64FindPrev((PRTRADIXTREEU64NODE)pv, uChildBase, RT_MIN(idx, uChildLast));
+        if (pCore)
+            return pCore;
+    }
+    return NULL;
+}
+
+
+/**
+ * Checks if any index in the range is in use.
+ *
+ * @param   pNode       The node.
+ * @param   uBase       The first index the node covers.
+ * @param   idxFirst    The first index, within the node.
+ * @param   idxLast     The last index, within the node.
+ */
+static bool rtRadixTreeU64IsInUse(PRTRADIXTREEU64NODE pNode, uint64_t uBase, uint64_t idxFirst, uint64_t idxLast)
+{
+    unsigned const uShift    = pNode->uShift;
+    unsigned const iSlotLast = (unsigned)((idxLast - uBase) >> uShift);
+    for (unsigned iSlot = (unsigned)((idxFirst - uBase) >> uShift); iSlot <= iSlotLast; iSlot++)
+    {
+        void *pv = pNode->apSlots[iSlot];
+        if (!pv)
+            continue;
+        if (RTRADIXTREE_IS_CORE(pv))
+            return true;
+        /* Child nodes are never empty, so a fully covered one is in use. */
+        uint64_t const uChildBase = uBase + ((uint64_t)iSlot << uShift);
+        uint64_t const uChildLast = uChildBase + RT_BIT_64(uShift) - 1;
+        if (idxFirst <= uChildBase && idxLast >= uChildLast)
+            return true;
+        if (rtRadixTreeU64IsInUse((PRTRADIXTREEU64NODE)pv, uChildBase,
+                                  RT_MAX(idxFirst, uChildBase), RT_MIN(idxLast, uChildLast)))
+            return true;
+    }
+    return false;
+}
+
+
+/**
+ * Allocates a new empty node.
+ */
+static PRTRADIXTREEU64NODE rtRadixTreeU64NewNode(PRTRADIXTREEU64 pTree, unsigned uShift)
+{
+    PRTRADIXTREEU64NODE pNode = (PRTRADIXTREEU64NODE)RTMemCacheAlloc(pTree->hMemCache);
+    if (pNode)
+    {
+        RT_BZERO(pNode, sizeof(*pNode));
+        pNode->uShift = (uint8_t)uShift;
+    }
+    return pNode;
+}
+
+
+/**
+ * Stores the writer's node core in all slots of the range.
+ *
+ * @returns IPRT status code.
+ * @param   pWr         The writer state.
+ * @param   pNode       The node.
+ * @param   uBase       The first index the node covers.
+ * @param   idxFirst    The first index, within the node.
+ * @param   idxLast     The last index, within the node.
+ */
+static int rtRadixTreeU64Fill(PRTRADIXTREEU64WR pWr, PRTRADIXTREEU64NODE pNode, uint64_t uBase, uint64_t idxFirst, uint64_t idxLast)
+{
+    unsigned const uShift    = pNode->uShift;
+    unsigned const iSlotLast = (unsigned)((idxLast - uBase) >> uShift);
+    for (unsigned iSlot = (unsigned)((idxFirst - uBase) >> uShift); iSlot <= iSlotLast; iSlot++)
+    {
+        uint64_t const uChildBase = uBase + ((uint64_t)iSlot << uShift);
+        uint64_t const uChildLast = uChildBase + RT_BIT_64(uShift) - 1;
+        if (idxFirst <= uChildBase && idxLast >= uChildLast)
+        {
+            Assert(!pNode->apSlots[iSlot]);
+            ASMAtomicWritePtr(&pNode->apSlots[iSlot], pWr->pvCore);
+            pNode->cUsed++;
+            continue;
+        }
+
+        Assert(uShift > 0);
+        PRTRADIXTREEU64NODE pChild = (PRTRADIXTREEU64NODE)pNode->apSlots[iSlot];
+        Assert(!RTRADIXTREE_IS_CORE(pChild));
+        if (!pChild)
+        {
+            pChild = rtRadixTreeU64NewNode(pWr->pTree, uShift - RTRADIXTREE_SLOT_SHIFT);
+            if (!pChild)
+                return VERR_NO_MEMORY;
+            ASMAtomicWritePtr(&pNode->apSlots[iSlot], (void *)pChild);
+            pNode->cUsed++;
+        }
+        int rc = rtRadixTreeU64Fill(pWr, pChild, uChildBase, RT_MAX(idxFirst, uChildBase), RT_MIN(idxLast, uChildLast));
+        if (RT_FAILURE(rc))
+            return rc;
+    }
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Clears the slots holding the writer's node core in the range, retiring
+ * nodes that run empty.
+ *
+ * @param   pWr         The writer state.
+ * @param   pNode       The node.
+ * @param   uBase       The first index the node covers.
+ * @param   idxFirst    The first index, within the node.
+ * @param   idxLast     The last index, within the node.
+ */
+static void rtRadixTreeU64Clear(PRTRADIXTREEU64WR pWr, PRTRADIXTREEU64NODE pNode, uint64_t uBase, uint64_t idxFirst, uint64_t idxLast)
+{
+    unsigned const uShift    = pNode->uShift;
+    unsigned const iSlotLast = (unsigned)((idxLast - uBase) >> uShift);
+    for (unsigned iSlot = (unsigned)((idxFirst - uBase) >> uShift); iSlot <= iSlotLast; iSlot++)
+    {
+        void *pv = pNode->apSlots[iSlot];
+        if (!pv)
+            continue;
+        if (pv == pWr->pvCore)
+        {
+            ASMAtomicWriteNullPtr(&pNode->apSlots[iSlot]);
+            pNode->cUsed--;
+            pWr->cCleared++;
+        }
+        else if (!RTRADIXTREE_IS_CORE(pv))
+        {
+            PRTRADIXTREEU64NODE pChild     = (PRTRADIXTREEU64NODE)pv;
+            uint64_t const      uChildBase = uBase + ((uint64_t)iSlot << uShift);
+            uint64_t const      uChildLast = uChildBase + RT_BIT_64(uShift) - 1;
+            rtRadixTreeU64Clear(pWr, pChild, uChildBase, RT_MAX(idxFirst, uChildBase), RT_MIN(idxLast, uChildLast));
+            if (!pChild->cUsed)
+            {
+                ASMAtomicWriteNullPtr(&pNode->apSlots[iSlot]);
+                pNode->cUsed--;
+                pChild->pNextRetired = pWr->pRetired;
+                pWr->pRetired        = pChild;
+            }
+        }
+    }
+}
+
+
+/**
+ * Removes the writer's node core from the tree and frees what's no longer
+ * needed.
+ *
+ * @param   pWr         The writer state.
+ * @param   pCore       The node core.
+ */
+static void rtRadixTreeU64RemoveIt(PRTRADIXTREEU64WR pWr, PRTRANGEU64NODECORE pCore)
+{
+    PRTRADIXTREEU64     pTree = pWr->pTree;
+    PRTRADIXTREEU64NODE pRoot = (PRTRADIXTREEU64NODE)pTree->pRoot;
+    pWr->pvCore = RTRADIXTREE_FROM_CORE(pCore);
+    if (pRoot)
+    {
+        uint64_t const idxLast = RT_MIN(pCore->KeyLast >> pTree->cShift, rtRadixTreeU64Span(pRoot->uShift));
+        if ((pCore->Key >> pTree->cShift) <= idxLast)
+            rtRadixTreeU64Clear(pWr, pRoot, 0, pCore->Key >> pTree->cShift, idxLast);
+    }
+
+    /*
+     * Lower the tree while the root has nothing but a first child.
+     */
+    while (pRoot)
+    {
+        PRTRADIXTREEU64NODE pNewRoot;
+        if (!pRoot->cUsed)
+            pNewRoot = NULL;
+        else if (   pRoot->cUsed == 1
+                 && pRoot->uShift > 0
+                 && pRoot->apSlots[0]
+                 && !RTRADIXTREE_IS_CORE(pRoot->apSlots[0]))
+            pNewRoot = (PRTRADIXTREEU64NODE)pRoot->apSlots[0];
+        else
+            break;
+        ASMAtomicWritePtr((void * volatile *)&pTree->pRoot, (void *)pNewRoot);
+        pRoot->pNextRetired = pWr->pRetired;
+        pWr->pRetired       = pRoot;
+        pRoot = pNewRoot;
+    }
+
+    /*
+     * Wait for the readers to be done with the cleared slots and unlinked
+     * nodes, the caller may free the node core as soon as we return.
+     */
+    if (   (pWr->cCleared || pWr->pRetired)
+        && (pTree->fFlags & RTBPTREE_F_LOCKLESS_READERS))
+        rtRangeTreeRcuSynchronize(&pTree->Rcu);
+    while (pWr->pRetired)
+    {
+        PRTRADIXTREEU64NODE pNode = pWr->pRetired;
+        pWr->pRetired = pNode->pNextRetired;
+        RTMemCacheFree(pTree->hMemCache, pNode);
+    }
+}
+
+
+RTDECL(int) RTRadixTreeU64Init(PRTRADIXTREEU64 pTree, uint32_t cShift, uint32_t fFlags)
+{
+    AssertPtrReturn(pTree, VERR_INVALID_POINTER);
+    AssertReturn(cShift < 64, VERR_INVALID_PARAMETER);
+    AssertReturn(!(fFlags & ~RTBPTREE_F_VALID_MASK), VERR_INVALID_FLAGS);
+
+    pTree->pRoot  = NULL;
+    pTree->cShift = cShift;
+    pTree->fFlags = fFlags;
+    pTree->cNodes = 0;
+    rtRangeTreeRcuInit(&pTree->Rcu);
+    return RTMemCacheCreate(&pTree->hMemCache, sizeof(RTRADIXTREEU64NODE), 64 /*cbAlignment*/, UINT32_MAX,
+                            NULL /*pfnCtor*/, NULL /*pfnDtor*/, NULL /*pvUser*/, 0 /*fFlags*/);
+}
+RT_EXPORT_SYMBOL(RTRadixTreeU64Init);
+
+
+RTDECL(int) RTRadixTreeU64Insert(PRTRADIXTREEU64 pTree, PRTRANGEU64NODECORE pNode)
+{
+    AssertPtrReturn(pTree, VERR_INVALID_POINTER);
+    AssertPtrReturn(pNode, VERR_INVALID_POINTER);
+    AssertReturn(!((uintptr_t)pNode & 1), VERR_INVALID_POINTER);
+    uint64_t const fMask = RT_BIT_64(pTree->cShift) - 1;
+    AssertReturn(pNode->Key <= pNode->KeyLast, VERR_INVALID_PARAMETER);
+    AssertMsgReturn(!(pNode->Key & fMask) && (pNode->KeyLast & fMask) == fMask,
+                    ("%#RX64-%#RX64 cShift=%u\n", pNode->Key, pNode->KeyLast, pTree->cShift), VERR_INVALID_PARAMETER);
+    uint64_t const idxFirst = pNode->Key     >> pTree->cShift;
+    uint64_t const idxLast  = pNode->KeyLast >> pTree->cShift;
+
+    /*
+     * Check for overlaps.
+     */
+    PRTRADIXTREEU64NODE pRoot = (PRTRADIXTREEU64NODE)pTree->pRoot;
+    if (   pRoot
+        && idxFirst <= rtRadixTreeU64Span(pRoot->uShift)
+        && rtRadixTreeU64IsInUse(pRoot, 0, idxFirst, RT_MIN(idxLast, rtRadixTreeU64Span(pRoot->uShift))))
+        return VERR_ALREADY_EXISTS;
+
+    /*
+     * Make the tree tall enough, the root always covers the indexes from zero.
+     */
+    if (!pRoot)
+    {
+        unsigned uShift = 0;
+        while (rtRadixTreeU64Span(uShift) < idxLast)
+            uShift += RTRADIXTREE_SLOT_SHIFT;
+        pRoot = rtRadixTreeU64NewNode(pTree, uShift);
+        if (!pRoot)
+            return VERR_NO_MEMORY;
+        ASMAtomicWritePtr((void * volatile *)&pTree->pRoot, (void *)pRoot);
+    }
+    while (rtRadixTreeU64Span(pRoot->uShift) < idxLast)
+    {
+        PRTRADIXTREEU64NODE pNewRoot = rtRadixTreeU64NewNode(pTree, pRoot->uShift + RTRADIXTREE_SLOT_SHIFT);
+        if (!pNewRoot)
+            return VERR_NO_MEMORY;
+        Assert(pRoot->cUsed > 0);
+        pNewRoot->apSlots[0] = pRoot;
+        pNewRoot->cUsed      = 1;
+        ASMAtomicWritePtr((void * volatile *)&pTree->pRoot, (void *)pNewRoot);
+        pRoot = pNewRoot;
+    }
+
+    /*
+     * Fill in the slots, backing out again if we run out of memory.
+     */
+    RTRADIXTREEU64WR Wr;
+    Wr.pTree    = pTree;
+    Wr.pvCore   = RTRADIXTREE_FROM_CORE(pNode);
+    Wr.pRetired = NULL;
+    Wr.cCleared = 0;
+    int rc = rtRadixTreeU64Fill(&Wr, pRoot, 0, idxFirst, idxLast);
+    if (RT_SUCCESS(rc))
+        pTree->cNodes++;
+    else
+        rtRadixTreeU64RemoveIt(&Wr, pNode);
+    return rc;
+}
+RT_EXPORT_SYMBOL(RTRadixTreeU64Insert);
+
+
+RTDECL(PRTRANGEU64NODECORE) RTRadixTreeU64Remove(PRTRADIXTREEU64 pTree, uint64_t Key)
+{
+    AssertPtrReturn(pTree, NULL);
+    PRTRANGEU64NODECORE pCore = rtRadixTreeU64Lookup((PRTRADIXTREEU64NODE)pTree->pRoot, Key >> pTree->cShift);
+    if (!pCore || pCore->Key != Key)
+        return NULL;
+
+    RTRADIXTREEU64WR Wr;
+    Wr.pTree    = pTree;
+    Wr.pRetired = NULL;
+    Wr.cCleared = 0;
+    rtRadixTreeU64RemoveIt(&Wr, pCore);
+    pTree->cNodes--;
+    return pCore;
+}
+RT_EXPORT_SYMBOL(RTRadixTreeU64Remove);
+
+
+RTDECL(PRTRANGEU64NODECORE) RTRadixTreeU64RangeRemove(PRTRADIXTREEU64 pTree, uint64_t Key)
+{
+    AssertPtrReturn(pTree, NULL);
+    PRTRANGEU64NODECORE pCore = rtRadixTreeU64Lookup((PRTRADIXTREEU64NODE)pTree->pRoot, Key >> pTree->cShift);
+    if (!pCore)
+        return NULL;
+
+    RTRADIXTREEU64WR Wr;
+    Wr.pTree    = pTree;
+    Wr.pRetired = NULL;
+    Wr.cCleared = 0;
+    rtRadixTreeU64RemoveIt(&Wr, pCore);
+    pTree->cNodes--;
+    return pCore;
+}
+RT_EXPORT_SYMBOL(RTRadixTreeU64RangeRemove);
+
+
+RTDECL(PRTRANGEU64NODECORE) RTRadixTreeU64Get(PRTRADIXTREEU64 pTree, uint64_t Key)
+{
+    PRTRANGEU64NODECORE pCore = rtRadixTreeU64Lookup(rtRadixTreeU64GetRoot(pTree), Key >> pTree->cShift);
+    if (pCore && pCore->Key == Key)
+        return pCore;
+    return NULL;
+}
+RT_EXPORT_SYMBOL(RTRadixTreeU64Get);
+
+
+RTDECL(PRTRANGEU64NODECORE) RTRadixTreeU64RangeGet(PRTRADIXTREEU64 pTree, uint64_t Key)
+{
+    return rtRadixTreeU64Lookup(rtRadixTreeU64GetRoot(pTree), Key >> pTree->cShift);
+}
+RT_EXPORT_SYMBOL(RTRadixTreeU64RangeGet);
+
+
+RTDECL(PRTRANGEU64NODECORE) RTRadixTreeU64GetBestFit(PRTRADIXTREEU64 pTree, uint64_t Key, bool fAbove)
+{
+    PRTRADIXTREEU64NODE pRoot = rtRadixTreeU64GetRoot(pTree);
+    if (!pRoot)
+        return NULL;
+    uint64_t const idxMax = rtRadixTreeU64Span(pRoot->uShift);
+    uint64_t       idx    = Key >> pTree->cShift;
+    if (!fAbove)
+        return rtRadixTreeU64FindPrev(pRoot, 0, RT_MIN(idx, idxMax));
+
+    /*
+     * The range covering the index may start before the key, in which case
+     * it's the one after it we're after.
+     */
+    for (;;)
+    {
+        if (idx > idxMax)
+            return NULL;
+        PRTRANGEU64NODECORE pCore = rtRadixTreeU64FindNext(pRoot, 0, idx);
+        if (!pCore || pCore->Key >= Key)
+            return pCore;
+        if (pCore->KeyLast == UINT64_MAX)
+            return NULL;
+        idx = (pCore->KeyLast >> pTree->cShift) + 1;
+    }
+}
+RT_EXPORT_SYMBOL(RTRadixTreeU64GetBestFit);
+
+
+/**
+ * Worker for RTRadixTreeU64DoWithAll.
+ *
+ * A range occupies consecutive slots, so comparing with the previous node
+ * core is enough to call the callback only once for each.
+ */
+static int rtRadixTreeU64DoWithAllNode(PRTRADIXTREEU64NODE pNode, bool fFromLeft, PFNRTRANGEU64CALLBACK pfnCallback, void *pvUser,
+                                       void **ppvPrev)
+{
+    for (unsigned i = 0; i < RTRADIXTREE_SLOTS; i++)
+    {
+        void *pv = rtRadixTreeU64GetSlot(pNode, fFromLeft ? i : RTRADIXTREE_SLOTS - 1 - i);
+        if (!pv)
+            continue;
+        int rc;
+        if (RTRADIXTREE_IS_CORE(pv))
+        {
+            if (pv == *ppvPrev)
+                continue;
+            *ppvPrev = pv;
+            rc = pfnCallback(RTRADIXTREE_TO_CORE(pv), pvUser);
+        }
+        else
+            rc = rtRadixTreeU64DoWithAllNode((PRTRADIXTREEU64NODE)pv, fFromLeft, pfnCallback, pvUser, ppvPrev);
+        if (rc != VINF_SUCCESS)
+            return rc;
+    }
+    return VINF_SUCCESS;
+}
+
+
+RTDECL(int) RTRadixTreeU64DoWithAll(PRTRADIXTREEU64 pTree, bool fFromLeft, PFNRTRANGEU64CALLBACK pfnCallback, void *pvUser)
+{
+    AssertPtrReturn(pfnCallback, VERR_INVALID_POINTER);
+    PRTRADIXTREEU64NODE pRoot = rtRadixTreeU64GetRoot(pTree);
+    if (!pRoot)
+        return VINF_SUCCESS;
+    void *pvPrev = NULL;
+    return rtRadixTreeU64DoWithAllNode(pRoot, fFromLeft, pfnCallback, pvUser, &pvPrev);
+}
+RT_EXPORT_SYMBOL(RTRadixTreeU64DoWithAll);
+
+
+/**
+ * Worker for RTRadixTreeU64Destroy.
+ *
+ * Only compares node core pointers as the callback may have freed them.
+ */
+static int rtRadixTreeU64DestroyNode(PRTRADIXTREEU64 pTree, PRTRADIXTREEU64NODE pNode, PFNRTRANGEU64CALLBACK pfnCallback,
+                                     void *pvUser, void **ppvPrev)
+{
+    int rcRet = VINF_SUCCESS;
+    for (unsigned i = 0; i < RTRADIXTREE_SLOTS; i++)
+    {
+        void *pv = pNode->apSlots[i];
+        if (!pv)
+            continue;
+        int rc = VINF_SUCCESS;
+        if (RTRADIXTREE_IS_CORE(pv))
+        {
+            if (pv != *ppvPrev)
+            {
+                *ppvPrev = pv;
+                if (pfnCallback)
+                    rc = pfnCallback(RTRADIXTREE_TO_CORE(pv), pvUser);
+            }
+        }
+        else
+            rc = rtRadixTreeU64DestroyNode(pTree, (PRTRADIXTREEU64NODE)pv, pfnCallback, pvUser, ppvPrev);
+        if (rc != VINF_SUCCESS && rcRet == VINF_SUCCESS)
+            rcRet = rc;
+    }
+    RTMemCacheFree(pTree->hMemCache, pNode);
+    return rcRet;
+}
+
+
+RTDECL(int) RTRadixTreeU64Destroy(PRTRADIXTREEU64 pTree, PFNRTRANGEU64CALLBACK pfnCallback, void *pvUser)
+{
+    AssertPtrReturn(pTree, VERR_INVALID_POINTER);
+    int rc = VINF_SUCCESS;
+    PRTRADIXTREEU64NODE pRoot = (PRTRADIXTREEU64NODE)pTree->pRoot;
+    if (pRoot)
+    {
+        void *pvPrev = NULL;
+        pTree->pRoot = NULL;
+        rc = rtRadixTreeU64DestroyNode(pTree, pRoot, pfnCallback, pvUser, &pvPrev);
+    }
+    pTree->cNodes = 0;
+    RTMemCacheDestroy(pTree->hMemCache);
+    pTree->hMemCache = NIL_RTMEMCACHE;
+    return rc;
+}
+RT_EXPORT_SYMBOL(RTRadixTreeU64Destroy);
+
+
+RTDECL(void) RTRadixTreeU64IterInit(PRTRADIXTREEU64ITER pIter, uint64_t uFirstKey)
+{
+    pIter->uNextKey = uFirstKey;
+    pIter->fDone    = false;
+}
+RT_EXPORT_SYMBOL(RTRadixTreeU64IterInit);
+
+
+RTDECL(PRTRANGEU64NODECORE) RTRadixTreeU64IterNext(PRTRADIXTREEU64 pTree, PRTRADIXTREEU64ITER pIter)
+{
+    if (pIter->fDone)
+        return NULL;
+    PRTRANGEU64NODECORE pCore = RTRadixTreeU64GetBestFit(pTree, pIter->uNextKey, true /*fAbove*/);
+    if (!pCore || pCore->KeyLast == UINT64_MAX)
+        pIter->fDone = true;
+    else
+        pIter->uNextKey = pCore->KeyLast + 1;
+    return pCore;
+}
+RT_EXPORT_SYMBOL(RTRadixTreeU64IterNext);
+
+
+RTDECL(uint32_t) RTRadixTreeU64ReadEnter(PRTRADIXTREEU64 pTree)
+{
+    return rtRangeTreeRcuEnter(&pTree->Rcu);
+}
+RT_EXPORT_SYMBOL(RTRadixTreeU64ReadEnter);
+
+
+RTDECL(void) RTRadixTreeU64ReadLeave(PRTRADIXTREEU64 pTree, uint32_t uToken)
+{
+    rtRangeTreeRcuLeave(&pTree->Rcu, uToken);
+}
+RT_EXPORT_SYMBOL(RTRadixTreeU64ReadLeave);
+
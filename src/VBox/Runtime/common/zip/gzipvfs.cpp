@@ -34,7 +34,10 @@
 #include <iprt/assert.h>
 #include <iprt/file.h>
 #include <iprt/err.h>
+#include <iprt/mem.h>
+#include <iprt/mp.h>
 #include <iprt/poll.h>
+#include <iprt/req.h>
 #include <iprt/string.h>
 #include <iprt/vfslowlevel.h>
 
@@ -133,6 +136,31 @@ typedef RTZIPGZIPHDR const *PCRTZIPGZIPHDR;
 #define RTZIPGZIPHDR_OS_UNKNOWN         UINT8_C(0xff)
 /** @}  */
 
+/** The OS ID the parallel compressor puts in the header, the same as zlib. */
+#if defined(RT_OS_WINDOWS)
+# define RTZIPGZIPHDR_OS_NATIVE         RTZIPGZIPHDR_OS_NTFS
+#elif defined(RT_OS_OS2)
+# define RTZIPGZIPHDR_OS_NATIVE         RTZIPGZIPHDR_OS_HPFS
+#else
+# define RTZIPGZIPHDR_OS_NATIVE         RTZIPGZIPHDR_OS_UNIX
+#endif
+
+/** The deflate window size, also the size of the dictionaries and the saved
+ * windows of the access points. */
+#define RTZIPGZIP_WINDOW_SIZE           _32K
+
+/** The amount of input the parallel compressor gives each worker. */
+#define RTZIPGZIPPAR_BLOCK_SIZE         _128K
+/** The max number of worker threads for the parallel compressor. */
+#define RTZIPGZIPPAR_MAX_THREADS        16
+
+/** The initial distance between the access points of the indexed reader. */
+#define RTZIPGZIPIDX_SPAN               _1M
+/** The max number of access points.  When reached, every other point is
+ * dropped and the span doubled, so the index never takes more than about
+ * RTZIPGZIPIDX_MAX_POINTS * RTZIPGZIP_WINDOW_SIZE bytes. */
+#define RTZIPGZIPIDX_MAX_POINTS         1024
+
 
 /**
  * The internal data of a GZIP I/O stream.
@@ -168,10 +196,159 @@ typedef struct RTZIPGZIPSTREAM
 typedef RTZIPGZIPSTREAM *PRTZIPGZIPSTREAM;
 
 
+/**
+ * A block being compressed by the parallel gzip compressor.
+ */
+typedef struct RTZIPGZIPPARJOB
+{
+    /** The request while the block is being processed, NULL when idle. */
+    PRTREQ              pReq;
+    /** The raw deflate stream of this job. */
+    z_stream            Zlib;
+    /** Set if Zlib has been initialized. */
+    bool                fZlibInit;
+    /** Set if this is the final block (Z_FINISH instead of Z_SYNC_FLUSH). */
+    bool                fLast;
+    /** The number of input bytes in pbIn. */
+    uint32_t            cbIn;
+    /** The number of valid bytes in abDict. */
+    uint32_t            cbDict;
+    /** The number of compressed bytes in pbOut (worker output). */
+    uint32_t            cbOut;
+    /** The size of the pbOut buffer. */
+    uint32_t            cbOutMax;
+    /** The CRC-32 of the input (worker output). */
+    uint32_t            uCrc32;
+    /** The input buffer, RTZIPGZIPPAR_BLOCK_SIZE bytes. */
+    uint8_t            *pbIn;
+    /** The output buffer, cbOutMax bytes. */
+    uint8_t            *pbOut;
+    /** The dictionary: the up to 32KB of input preceding this block. */
+    uint8_t             abDict[RTZIPGZIP_WINDOW_SIZE];
+} RTZIPGZIPPARJOB;
+/** Pointer to a parallel gzip compressor job. */
+typedef RTZIPGZIPPARJOB *PRTZIPGZIPPARJOB;
+
+/**
+ * The internal data of a parallel GZIP compressor I/O stream.
+ *
+ * The jobs are used as a ring.  The one at iFill is the one currently
+ * receiving input, the cPending ones starting at iFirstPending have been
+ * handed to the pool and their output is written in that order.
+ */
+typedef struct RTZIPGZIPPARSTREAM
+{
+    /** The stream we're writing the compressed data to. */
+    RTVFSIOSTREAM       hVfsIos;
+    /** The worker thread pool. */
+    RTREQPOOL           hPool;
+    /** Set if we've failed and stopped writing. */
+    bool                fFatalError;
+    /** The stream offset for pfnTell, i.e. the uncompressed data. */
+    RTFOFF              offStream;
+    /** The CRC-32 of the data written so far (combined from the jobs). */
+    uint32_t            uCrc32;
+    /** The number of jobs. */
+    uint32_t            cJobs;
+    /** The job receiving input. */
+    uint32_t            iFill;
+    /** The oldest job that has been submitted. */
+    uint32_t            iFirstPending;
+    /** The number of submitted jobs. */
+    uint32_t            cPending;
+    /** The number of valid bytes in abDict. */
+    uint32_t            cbDict;
+    /** The last 32KB of input handed to the jobs, the next dictionary. */
+    uint8_t             abDict[RTZIPGZIP_WINDOW_SIZE];
+    /** The jobs (cJobs). */
+    PRTZIPGZIPPARJOB    paJobs;
+} RTZIPGZIPPARSTREAM;
+/** Pointer to a the internal data of a parallel GZIP compressor I/O stream. */
+typedef RTZIPGZIPPARSTREAM *PRTZIPGZIPPARSTREAM;
+
+
+/**
+ * An access point of the indexed gzip reader.
+ *
+ * This is the inflate state at a deflate block boundary: where in the
+ * compressed and uncompressed data it is and the window needed to resolve
+ * back references of the following blocks.
+ */
+typedef struct RTZIPGZIPIDXPOINT
+{
+    /** The uncompressed offset. */
+    uint64_t            offOut;
+    /** The offset of the first full compressed byte following the point. */
+    uint64_t            offIn;
+    /** The uncompressed offset of the start of the member the point is in. */
+    uint64_t            offMember;
+    /** The CRC-32 (gzip) or Adler-32 (zlib) of the member data preceding the
+     * point. */
+    uint32_t            uCheck;
+    /** The number of bits (0-7) of the byte at offIn - 1 belonging to the
+     * following block. */
+    uint8_t             cBits;
+    /** The 32KB of uncompressed data preceding the point. */
+    uint8_t            *pbWindow;
+} RTZIPGZIPIDXPOINT;
+/** Pointer to an access point. */
+typedef RTZIPGZIPIDXPOINT *PRTZIPGZIPIDXPOINT;
+
+/**
+ * The internal data of an indexed gzip file.
+ */
+typedef struct RTZIPGZIPFILE
+{
+    /** The compressed file. */
+    RTVFSFILE           hVfsFile;
+    /** The windowBits value to give inflateReset2 at the start of a member. */
+    int                 iWindowBitsHdr;
+    /** Set if the inflate state needs repositioning before it can be used
+     * (after an error). */
+    bool                fNeedReset;
+    /** Set if inflating raw deflate data, i.e. resumed from an access point
+     * and the member trailer is left to us. */
+    bool                fRaw;
+    /** Set if the decoder reached the end of the last member. */
+    bool                fEndOfStream;
+    /** The current file position (uncompressed). */
+    uint64_t            offCur;
+    /** The uncompressed offset of the decoder. */
+    uint64_t            offOut;
+    /** The uncompressed offset of the start of the current member. */
+    uint64_t            offMember;
+    /** The check value of the current member in raw mode, where zlib doesn't
+     * calculate it.  Seeded from the access point. */
+    uint32_t            uCheck;
+    /** The compressed offset following the data in abIn. */
+    uint64_t            offInBufEnd;
+    /** The uncompressed size, UINT64_MAX until the decoder has seen the end. */
+    uint64_t            cbOut;
+    /** The current distance between access points. */
+    uint64_t            cbSpan;
+    /** The number of access points. */
+    uint32_t            cPoints;
+    /** The access points, sorted by offset. */
+    PRTZIPGZIPIDXPOINT  paPoints;
+    /** The zlib stream. */
+    z_stream            Zlib;
+    /** The next write position in abWindow. */
+    uint32_t            offWindow;
+    /** Ring buffer with the last 32KB of output.  The decoder inflates into
+     * it so the window is at hand when adding an access point. */
+    uint8_t             abWindow[RTZIPGZIP_WINDOW_SIZE];
+    /** The input buffer. */
+    uint8_t             abIn[_64K];
+} RTZIPGZIPFILE;
+/** Pointer to the internal data of an indexed gzip file. */
+typedef RTZIPGZIPFILE *PRTZIPGZIPFILE;
+
+
 /*********************************************************************************************************************************
 *   Internal Functions                                                                                                           *
 *********************************************************************************************************************************/
 static int rtZipGzip_FlushIt(PRTZIPGZIPSTREAM pThis, uint8_t fFlushType);
+static int rtZipGzipPar_Create(RTVFSIOSTREAM hVfsIosDst, uint8_t uLevel, PRTVFSIOSTREAM phVfsIosZip);
 
 
 /**
@@ -778,10 +955,13 @@ RTDECL(int) RTZipGzipDecompressIoStream(RTVFSIOSTREAM hVfsIosIn, uint32_t fFlags
 RTDECL(int) RTZipGzipCompressIoStream(RTVFSIOSTREAM hVfsIosDst, uint32_t fFlags, uint8_t uLevel, PRTVFSIOSTREAM phVfsIosZip)
 {
     AssertPtrReturn(hVfsIosDst, VERR_INVALID_HANDLE);
-    AssertReturn(!fFlags, VERR_INVALID_PARAMETER);
+    AssertReturn(!(fFlags & ~RTZIPGZIPCOMP_F_PARALLEL), VERR_INVALID_PARAMETER);
     AssertPtrReturn(phVfsIosZip, VERR_INVALID_POINTER);
     AssertReturn(uLevel > 0 && uLevel <= 9, VERR_INVALID_PARAMETER);
 
+    if (fFlags & RTZIPGZIPCOMP_F_PARALLEL)
+        return rtZipGzipPar_Create(hVfsIosDst, uLevel, phVfsIosZip);
+
     uint32_t cRefs = RTVfsIoStrmRetain(hVfsIosDst);
     AssertReturn(cRefs != UINT32_MAX, VERR_INVALID_HANDLE);
 
@@ -827,3 +1007,1096 @@ RTDECL(int) RTZipGzipCompressIoStream(RTVFSIOSTREAM hVfsIosDst, uint32_t fFlags,
     return rc;
 }
 
+
+/**
+ * Converts a zlib status from one of the parallel or indexed gzip workers.
+ *
+ * @returns IPRT status code.
+ * @param   rcZlib          The zlib status code.
+ * @param   fDecompress     Set if it's from inflate, clear if from deflate.
+ */
+static int rtZipGzipConvertErrFromZlibNoState(int rcZlib, bool fDecompress)
+{
+    switch (rcZlib)
+    {
+        case Z_OK:
+        case Z_STREAM_END:
+            return VINF_SUCCESS;
+        case Z_MEM_ERROR:
+            return VERR_ZIP_NO_MEMORY;
+        case Z_VERSION_ERROR:
+            return VERR_ZIP_UNSUPPORTED_VERSION;
+        default:
+            return fDecompress ? VERR_ZIP_CORRUPTED : VERR_ZIP_ERROR;
+    }
+}
+
+
+/**
+ * Worker thread function compressing one block for the parallel compressor.
+ *
+ * The block becomes a sequence of raw deflate blocks primed with the preceding
+ * input as dictionary and ending on a byte boundary, or with the final block
+ * if fLast is set.  So the outputs of consecutive jobs just concatenate.
+ *
+ * @returns IPRT status code.
+ * @param   pJob            The job.
+ */
+static DECLCALLBACK(int) rtZipGzipPar_CompressWorker(PRTZIPGZIPPARJOB pJob)
+{
+    pJob->uCrc32 = crc32(0, pJob->pbIn, pJob->cbIn);
+
+    int rcZlib = deflateReset(&pJob->Zlib);
+    if (rcZlib == Z_OK && pJob->cbDict)
+        rcZlib = deflateSetDictionary(&pJob->Zlib, pJob->abDict, pJob->cbDict);
+    if (rcZlib == Z_OK)
+    {
+        pJob->Zlib.next_in   = pJob->pbIn;
+        pJob->Zlib.avail_in  = pJob->cbIn;
+        pJob->Zlib.next_out  = pJob->pbOut;
+        pJob->Zlib.avail_out = pJob->cbOutMax;
+        rcZlib = deflate(&pJob->Zlib, pJob->fLast ? Z_FINISH : Z_SYNC_FLUSH);
+        pJob->cbOut = pJob->cbOutMax - pJob->Zlib.avail_out;
+
+        /* The output buffer is sized so everything fits in one go. */
+        if (pJob->fLast ? rcZlib == Z_STREAM_END : rcZlib == Z_OK && pJob->Zlib.avail_out > 0)
+            return VINF_SUCCESS;
+        AssertMsgReturn(rcZlib < 0, ("%d avail_in=%u avail_out=%u\n", rcZlib, pJob->Zlib.avail_in, pJob->Zlib.avail_out),
+                        VERR_BUFFER_OVERFLOW);
+    }
+    return rtZipGzipConvertErrFromZlibNoState(rcZlib, false /*fDecompress*/);
+}
+
+
+/**
+ * Waits for the oldest submitted job and writes its output.
+ *
+ * Nothing is written once the stream has failed, but the job is still waited
+ * for so it can be reused or freed.
+ *
+ * @returns IPRT status code.
+ * @param   pThis           The parallel gzip compressor instance data.
+ */
+static int rtZipGzipPar_CompleteOldest(PRTZIPGZIPPARSTREAM pThis)
+{
+    Assert(pThis->cPending > 0);
+    PRTZIPGZIPPARJOB pJob = &pThis->paJobs[pThis->iFirstPending];
+    pThis->iFirstPending = (pThis->iFirstPending + 1) % pThis->cJobs;
+    pThis->cPending--;
+
+    int rc = RTReqWait(pJob->pReq, RT_INDEFINITE_WAIT);
+    AssertRC(rc);
+    if (RT_SUCCESS(rc))
+        rc = RTReqGetStatus(pJob->pReq);
+    RTReqRelease(pJob->pReq);
+    pJob->pReq = NULL;
+
+    if (pThis->fFatalError)
+        return RT_FAILURE(rc) ? rc : VERR_INVALID_STATE;
+    if (RT_SUCCESS(rc))
+    {
+        rc = RTVfsIoStrmWrite(pThis->hVfsIos, pJob->pbOut, pJob->cbOut, true /*fBlocking*/, NULL /*pcbWritten*/);
+        pThis->uCrc32 = crc32_combine(pThis->uCrc32, pJob->uCrc32, (z_off_t)pJob->cbIn);
+    }
+    if (RT_FAILURE(rc))
+        pThis->fFatalError = true;
+    return rc;
+}
+
+
+/**
+ * Hands the job being filled to the thread pool and moves on to the next one.
+ *
+ * @returns IPRT status code.
+ * @param   pThis           The parallel gzip compressor instance data.
+ * @param   fLast           Set if this is the end of the stream.
+ */
+static int rtZipGzipPar_Submit(PRTZIPGZIPPARSTREAM pThis, bool fLast)
+{
+    PRTZIPGZIPPARJOB pJob = &pThis->paJobs[pThis->iFill];
+    Assert(!pJob->pReq);
+
+    /*
+     * The dictionary is the input preceding this block, after which the
+     * block's input becomes part of the next one.
+     */
+    pJob->fLast  = fLast;
+    pJob->cbDict = pThis->cbDict;
+    memcpy(pJob->abDict, pThis->abDict, pThis->cbDict);
+    if (pJob->cbIn >= sizeof(pThis->abDict))
+    {
+        memcpy(pThis->abDict, &pJob->pbIn[pJob->cbIn - sizeof(pThis->abDict)], sizeof(pThis->abDict));
+        pThis->cbDict = sizeof(pThis->abDict);
+    }
+    else
+    {
+        uint32_t const cbKeep = RT_MIN(pThis->cbDict, sizeof(pThis->abDict) - pJob->cbIn);
+        memmove(pThis->abDict, &pThis->abDict[pThis->cbDict - cbKeep], cbKeep);
+        memcpy(&pThis->abDict[cbKeep], pJob->pbIn, pJob->cbIn);
+        pThis->cbDict = cbKeep + pJob->cbIn;
+    }
+
+    int rc = RTReqPoolCallEx(pThis->hPool, 0 /*cMillies*/, &pJob->pReq, RTREQFLAGS_IPRT_STATUS,
+                             (PFNRT)rtZipGzipPar_CompressWorker, 1, pJob);
+    if (rc == VERR_TIMEOUT)
+        rc = VINF_SUCCESS;
+    if (RT_FAILURE(rc))
+    {
+        pThis->fFatalError = true;
+        return rc;
+    }
+    pThis->cPending++;
+
+    /*
+     * Advance to the next job, waiting for it if all are busy.
+     */
+    pThis->iFill = (pThis->iFill + 1) % pThis->cJobs;
+    if (pThis->cPending == pThis->cJobs)
+        rc = rtZipGzipPar_CompleteOldest(pThis);
+    pThis->paJobs[pThis->iFill].cbIn = 0;
+    return rc;
+}
+
+
+/**
+ * @interface_method_impl{RTVFSOBJOPS,pfnClose}
+ */
+static DECLCALLBACK(int) rtZipGzipPar_Close(void *pvThis)
+{
+    PRTZIPGZIPPARSTREAM pThis = (PRTZIPGZIPPARSTREAM)pvThis;
+
+    /*
+     * Compress the remainder as the final block, write everything out and
+     * complete the member with the trailer.
+     */
+    int rc = VINF_SUCCESS;
+    if (!pThis->fFatalError)
+    {
+        rc = rtZipGzipPar_Submit(pThis, true /*fLast*/);
+        while (pThis->cPending > 0 && RT_SUCCESS(rc))
+            rc = rtZipGzipPar_CompleteOldest(pThis);
+        if (RT_SUCCESS(rc))
+        {
+            uint32_t const au32Trailer[2] = { RT_H2LE_U32(pThis->uCrc32), RT_H2LE_U32((uint32_t)pThis->offStream) };
+            rc = RTVfsIoStrmWrite(pThis->hVfsIos, au32Trailer, sizeof(au32Trailer), true /*fBlocking*/, NULL /*pcbWritten*/);
+        }
+        if (RT_FAILURE(rc))
+            pThis->fFatalError = true;
+    }
+
+    /* Wait for whatever is still in flight after a failure. */
+    while (pThis->cPending > 0)
+        rtZipGzipPar_CompleteOldest(pThis);
+
+    /*
+     * Free the resources.
+     */
+    if (pThis->paJobs)
+    {
+        for (uint32_t i = 0; i < pThis->cJobs; i++)
+        {
+            PRTZIPGZIPPARJOB pJob = &pThis->paJobs[i];
+            if (pJob->fZlibInit)
+                deflateEnd(&pJob->Zlib);
+            RTMemFree(pJob->pbIn);
+            RTMemFree(pJob->pbOut);
+        }
+        RTMemFree(pThis->paJobs);
+        pThis->paJobs = NULL;
+    }
+    RTReqPoolRelease(pThis->hPool);
+    pThis->hPool = NIL_RTREQPOOL;
+    RTVfsIoStrmRelease(pThis->hVfsIos);
+    pThis->hVfsIos = NIL_RTVFSIOSTREAM;
+
+    return rc;
+}
+
+
+/**
+ * @interface_method_impl{RTVFSOBJOPS,pfnQueryInfo}
+ */
+static DECLCALLBACK(int) rtZipGzipPar_QueryInfo(void *pvThis, PRTFSOBJINFO pObjInfo, RTFSOBJATTRADD enmAddAttr)
+{
+    PRTZIPGZIPPARSTREAM pThis = (PRTZIPGZIPPARSTREAM)pvThis;
+    return RTVfsIoStrmQueryInfo(pThis->hVfsIos, pObjInfo, enmAddAttr);
+}
+
+
+/**
+ * @interface_method_impl{RTVFSIOSTREAMOPS,pfnRead}
+ */
+static DECLCALLBACK(int) rtZipGzipPar_Read(void *pvThis, RTFOFF off, PCRTSGBUF pSgBuf, bool fBlocking, size_t *pcbRead)
+{
+    RT_NOREF_PV(pvThis); RT_NOREF_PV(off); RT_NOREF_PV(pSgBuf); RT_NOREF_PV(fBlocking); RT_NOREF_PV(pcbRead);
+    return VERR_ACCESS_DENIED;
+}
+
+
+/**
+ * @interface_method_impl{RTVFSIOSTREAMOPS,pfnWrite}
+ */
+static DECLCALLBACK(int) rtZipGzipPar_Write(void *pvThis, RTFOFF off, PCRTSGBUF pSgBuf, bool fBlocking, size_t *pcbWritten)
+{
+    PRTZIPGZIPPARSTREAM pThis = (PRTZIPGZIPPARSTREAM)pvThis;
+
+    Assert(pSgBuf->cSegs == 1); NOREF(fBlocking);
+    AssertReturn(off == -1 || off == pThis->offStream , VERR_INVALID_PARAMETER);
+    if (pThis->fFatalError)
+        return VERR_INVALID_STATE;
+
+    /*
+     * Fill the current job and hand it to the pool whenever it's full.
+     */
+    int             rc        = VINF_SUCCESS;
+    size_t          cbWritten = 0;
+    uint8_t const  *pbSrc     = (uint8_t const *)pSgBuf->paSegs[0].pvSeg;
+    size_t          cbLeft    = pSgBuf->paSegs[0].cbSeg;
+    while (cbLeft > 0)
+    {
+        PRTZIPGZIPPARJOB pJob   = &pThis->paJobs[pThis->iFill];
+        uint32_t const   cbThis = (uint32_t)RT_MIN(cbLeft, RTZIPGZIPPAR_BLOCK_SIZE - pJob->cbIn);
+        memcpy(&pJob->pbIn[pJob->cbIn], pbSrc, cbThis);
+        pJob->cbIn += cbThis;
+        pbSrc      += cbThis;
+        cbLeft     -= cbThis;
+        cbWritten  += cbThis;
+
+        if (pJob->cbIn == RTZIPGZIPPAR_BLOCK_SIZE)
+        {
+            rc = rtZipGzipPar_Submit(pThis, false /*fLast*/);
+            if (RT_FAILURE(rc))
+                break;
+        }
+    }
+
+    pThis->offStream += cbWritten;
+    if (pcbWritten)
+        *pcbWritten = cbWritten;
+    return rc;
+}
+
+
+/**
+ * @interface_method_impl{RTVFSIOSTREAMOPS,pfnFlush}
+ */
+static DECLCALLBACK(int) rtZipGzipPar_Flush(void *pvThis)
+{
+    PRTZIPGZIPPARSTREAM pThis = (PRTZIPGZIPPARSTREAM)pvThis;
+    if (pThis->fFatalError)
+        return VERR_INVALID_STATE;
+
+    /* Cut the block short and write out everything that's pending. */
+    int rc = VINF_SUCCESS;
+    if (pThis->paJobs[pThis->iFill].cbIn > 0)
+        rc = rtZipGzipPar_Submit(pThis, false /*fLast*/);
+    while (pThis->cPending > 0 && RT_SUCCESS(rc))
+        rc = rtZipGzipPar_CompleteOldest(pThis);
+    if (RT_FAILURE(rc))
+        return rc;
+
+    return RTVfsIoStrmFlush(pThis->hVfsIos);
+}
+
+
+/**
+ * @interface_method_impl{RTVFSIOSTREAMOPS,pfnPollOne}
+ */
+static DECLCALLBACK(int) rtZipGzipPar_PollOne(void *pvThis, uint32_t fEvents, RTMSINTERVAL cMillies, bool fIntr,
+                                              uint32_t *pfRetEvents)
+{
+    PRTZIPGZIPPARSTREAM pThis = (PRTZIPGZIPPARSTREAM)pvThis;
+
+    /* There is always room for more input, the write blocks when needed. */
+    uint32_t fRetEvents = RTPOLL_EVT_WRITE;
+    if (pThis->fFatalError)
+        fRetEvents |= RTPOLL_EVT_ERROR;
+    fRetEvents &= fEvents;
+    if (fRetEvents)
+    {
+        *pfRetEvents = fRetEvents;
+        return VINF_SUCCESS;
+    }
+    return RTVfsIoStrmPoll(pThis->hVfsIos, fEvents & ~RTPOLL_EVT_READ, cMillies, fIntr, pfRetEvents);
+}
+
+
+/**
+ * @interface_method_impl{RTVFSIOSTREAMOPS,pfnTell}
+ */
+static DECLCALLBACK(int) rtZipGzipPar_Tell(void *pvThis, PRTFOFF poffActual)
+{
+    PRTZIPGZIPPARSTREAM pThis = (PRTZIPGZIPPARSTREAM)pvThis;
+    *poffActual = pThis->offStream;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * The parallel GZIP compressor I/O stream vtable.
+ */
+static RTVFSIOSTREAMOPS g_rtZipGzipParOps =
+{
+    { /* Obj */
+        RTVFSOBJOPS_VERSION,
+        RTVFSOBJTYPE_IO_STREAM,
+        "gzip-parallel",
+        rtZipGzipPar_Close,
+        rtZipGzipPar_QueryInfo,
+        RTVFSOBJOPS_VERSION
+    },
+    RTVFSIOSTREAMOPS_VERSION,
+    RTVFSIOSTREAMOPS_FEAT_NO_SG,
+    rtZipGzipPar_Read,
+    rtZipGzipPar_Write,
+    rtZipGzipPar_Flush,
+    rtZipGzipPar_PollOne,
+    rtZipGzipPar_Tell,
+    NULL /* Skip */,
+    NULL /*ZeroFill*/,
+    RTVFSIOSTREAMOPS_VERSION,
+};
+
+
+/**
+ * Creates a parallel gzip compressor stream, RTZIPGZIPCOMP_F_PARALLEL.
+ *
+ * @returns IPRT status code.
+ * @param   hVfsIosDst          The compressed output stream, a reference is
+ *                              retained on success.
+ * @param   uLevel              The compression level.
+ * @param   phVfsIosZip         Where to return the stream handle.
+ */
+static int rtZipGzipPar_Create(RTVFSIOSTREAM hVfsIosDst, uint8_t uLevel, PRTVFSIOSTREAM phVfsIosZip)
+{
+    uint32_t cRefs = RTVfsIoStrmRetain(hVfsIosDst);
+    AssertReturn(cRefs != UINT32_MAX, VERR_INVALID_HANDLE);
+
+    RTVFSIOSTREAM       hVfsIos;
+    PRTZIPGZIPPARSTREAM pThis;
+    int rc = RTVfsNewIoStream(&g_rtZipGzipParOps, sizeof(RTZIPGZIPPARSTREAM), RTFILE_O_WRITE, NIL_RTVFS, NIL_RTVFSLOCK,
+                          &hVfsIos, (void **)&pThis);
+    if (RT_SUCCESS(rc))
+    {
+        pThis->hVfsIos       = hVfsIosDst;
+        pThis->hPool         = NIL_RTREQPOOL;
+        pThis->fFatalError   = false;
+        pThis->offStream     = 0;
+        pThis->uCrc32        = crc32(0, NULL, 0);
+        pThis->iFill         = 0;
+        pThis->iFirstPending = 0;
+        pThis->cPending      = 0;
+        pThis->cbDict        = 0;
+
+        /*
+         * One worker per CPU and twice as many jobs so the next round of
+         * input can be collected while the previous one is being compressed.
+         */
+        uint32_t const cThreads = RT_MIN(RT_MAX(RTMpGetOnlineCount(), 1), RTZIPGZIPPAR_MAX_THREADS);
+        pThis->cJobs  = cThreads * 2;
+        pThis->paJobs = (PRTZIPGZIPPARJOB)RTMemAllocZ(sizeof(pThis->paJobs[0]) * pThis->cJobs);
+        if (pThis->paJobs)
+        {
+            for (uint32_t i = 0; i < pThis->cJobs && RT_SUCCESS(rc); i++)
+            {
+                PRTZIPGZIPPARJOB pJob = &pThis->paJobs[i];
+                int rcZlib = deflateInit2(&pJob->Zlib, uLevel, Z_DEFLATED, -15 /* raw, 32KB window */,
+                                          8 /* default memory level */, Z_DEFAULT_STRATEGY);
+                if (rcZlib == Z_OK)
+                {
+                    pJob->fZlibInit = true;
+                    /* Room for a whole block plus the empty stored block of the sync flush. */
+                    pJob->cbOutMax  = (uint32_t)deflateBound(&pJob->Zlib, RTZIPGZIPPAR_BLOCK_SIZE) + 64;
+                    pJob->pbIn      = (uint8_t *)RTMemAlloc(RTZIPGZIPPAR_BLOCK_SIZE);
+                    pJob->pbOut     = (uint8_t *)RTMemAlloc(pJob->cbOutMax);
+                    if (!pJob->pbIn || !pJob->pbOut)
+                        rc = VERR_NO_MEMORY;
+                }
+                else
+                    rc = rtZipGzipConvertErrFromZlibNoState(rcZlib, false /*fDecompress*/);
+            }
+            if (RT_SUCCESS(rc))
+                rc = RTReqPoolCreate(cThreads, RT_MS_1SEC, UINT32_MAX /*cThreadsPushBackThreshold*/,
+                                     UINT32_MAX /*cMsMaxPushBack*/, "gzip", &pThis->hPool);
+
+            /*
+             * Write the header once everything is set up, so a failure
+             * doesn't leave a stray header behind.
+             */
+            if (RT_SUCCESS(rc))
+            {
+                RTZIPGZIPHDR Hdr;
+                Hdr.bId1               = RTZIPGZIPHDR_ID1;
+                Hdr.bId2               = RTZIPGZIPHDR_ID2;
+                Hdr.bCompressionMethod = RTZIPGZIPHDR_CM_DEFLATE;
+                Hdr.fFlags             = 0;
+                Hdr.u32ModTime         = 0;
+                Hdr.bXtraFlags         = uLevel == 9 ? RTZIPGZIPHDR_XFL_DEFLATE_MAX
+                                       : uLevel == 1 ? RTZIPGZIPHDR_XFL_DEFLATE_FASTEST : 0;
+                Hdr.bOS                = RTZIPGZIPHDR_OS_NATIVE;
+                rc = RTVfsIoStrmWrite(hVfsIosDst, &Hdr, sizeof(Hdr), true /*fBlocking*/, NULL /*pcbWritten*/);
+            }
+            if (RT_SUCCESS(rc))
+            {
+                *phVfsIosZip = hVfsIos;
+                return VINF_SUCCESS;
+            }
+        }
+        else
+            rc = VERR_NO_MEMORY;
+        pThis->fFatalError = true;
+        RTVfsIoStrmRelease(hVfsIos);
+    }
+    else
+        RTVfsIoStrmRelease(hVfsIosDst);
+    return rc;
+}
+
+
+
+/**
+ * Reads more compressed input for the indexed gzip reader.
+ *
+ * @returns IPRT status code.  avail_in is zero at the end of the file.
+ * @param   pThis           The indexed gzip file instance data.
+ */
+static int rtZipGzipFile_FillInput(PRTZIPGZIPFILE pThis)
+{
+    Assert(pThis->Zlib.avail_in == 0);
+    size_t cbRead = 0;
+    int rc = RTVfsFileReadAt(pThis->hVfsFile, (RTFOFF)pThis->offInBufEnd, pThis->abIn, sizeof(pThis->abIn), &cbRead);
+    if (RT_SUCCESS(rc))
+    {
+        pThis->Zlib.next_in   = &pThis->abIn[0];
+        pThis->Zlib.avail_in  = (uInt)cbRead;
+        pThis->offInBufEnd   += cbRead;
+        rc = VINF_SUCCESS;
+    }
+    return rc;
+}
+
+
+/**
+ * Called when the decoder reached the end of a member, checks for another one.
+ *
+ * @returns IPRT status code.
+ * @param   pThis           The indexed gzip file instance data.
+ */
+static int rtZipGzipFile_NextMember(PRTZIPGZIPFILE pThis)
+{
+    bool const fGzip = pThis->iWindowBitsHdr == MAX_WBITS + 16;
+
+    /*
+     * In raw mode zlib stops after the last deflate block and leaves the
+     * trailer to us.  The check value was seeded from the access point, so
+     * this covers the whole member even if it was never inflated from the
+     * start.
+     */
+    if (pThis->fRaw)
+    {
+        uint8_t        abTrailer[8];
+        uint32_t const cbTrailer = fGzip ? 8 : 4;
+        uint32_t       offTrailer = 0;
+        while (offTrailer < cbTrailer)
+        {
+            if (pThis->Zlib.avail_in == 0)
+            {
+                int rc = rtZipGzipFile_FillInput(pThis);
+                if (RT_FAILURE(rc))
+                    return rc;
+                if (pThis->Zlib.avail_in == 0)
+                    return VERR_ZIP_CORRUPTED; /* truncated */
+            }
+            uint32_t const cbThis = RT_MIN(cbTrailer - offTrailer, pThis->Zlib.avail_in);
+            memcpy(&abTrailer[offTrailer], pThis->Zlib.next_in, cbThis);
+            pThis->Zlib.next_in  += cbThis;
+            pThis->Zlib.avail_in -= cbThis;
+            offTrailer += cbThis;
+        }
+
+        if (fGzip)
+        {
+            if (   RT_MAKE_U32_FROM_U8(abTrailer[0], abTrailer[1], abTrailer[2], abTrailer[3]) != pThis->uCheck
+                || RT_MAKE_U32_FROM_U8(abTrailer[4], abTrailer[5], abTrailer[6], abTrailer[7])
+                   != (uint32_t)(pThis->offOut - pThis->offMember))
+                return VERR_ZIP_CORRUPTED;
+        }
+        else if (RT_MAKE_U32_FROM_U8(abTrailer[3], abTrailer[2], abTrailer[1], abTrailer[0]) != pThis->uCheck)
+            return VERR_ZIP_CORRUPTED;
+    }
+
+    /*
+     * Like gunzip, we continue with the next member and ignore anything else.
+     * Only gzip members can be concatenated.
+     */
+    if (fGzip)
+    {
+        if (pThis->Zlib.avail_in == 0)
+        {
+            int rc = rtZipGzipFile_FillInput(pThis);
+            if (RT_FAILURE(rc))
+                return rc;
+        }
+        if (   pThis->Zlib.avail_in > 0
+            && pThis->Zlib.next_in[0] == RTZIPGZIPHDR_ID1)
+        {
+            int rcZlib = inflateReset2(&pThis->Zlib, pThis->iWindowBitsHdr);
+            if (rcZlib != Z_OK)
+                return rtZipGzipConvertErrFromZlibNoState(rcZlib, true /*fDecompress*/);
+            pThis->fRaw      = false;
+            pThis->offMember = pThis->offOut;
+            return VINF_SUCCESS;
+        }
+    }
+
+    pThis->fEndOfStream = true;
+    pThis->cbOut        = pThis->offOut;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Records an access point at the current decoder position.
+ *
+ * @param   pThis           The indexed gzip file instance data.
+ */
+static void rtZipGzipFile_AddPoint(PRTZIPGZIPFILE pThis)
+{
+    /*
+     * Thin out the index when it's full.
+     */
+    if (pThis->cPoints >= RTZIPGZIPIDX_MAX_POINTS)
+    {
+        uint32_t iDst = 0;
+        for (uint32_t iSrc = 0; iSrc < pThis->cPoints; iSrc++)
+            if (iSrc & 1)
+                RTMemFree(pThis->paPoints[iSrc].pbWindow);
+            else
+                pThis->paPoints[iDst++] = pThis->paPoints[iSrc];
+        pThis->cPoints = iDst;
+        pThis->cbSpan *= 2;
+        if (pThis->offOut < pThis->paPoints[pThis->cPoints - 1].offOut + pThis->cbSpan)
+            return;
+    }
+    else if (!pThis->paPoints)
+    {
+        pThis->paPoints = (PRTZIPGZIPIDXPOINT)RTMemAlloc(sizeof(pThis->paPoints[0]) * RTZIPGZIPIDX_MAX_POINTS);
+        if (!pThis->paPoints)
+            return;
+    }
+
+    /*
+     * Save the window in order, the index is an optimization so we don't
+     * complain when running short on memory.
+     */
+    uint8_t *pbWindow = (uint8_t *)RTMemAlloc(RTZIPGZIP_WINDOW_SIZE);
+    if (!pbWindow)
+        return;
+    uint32_t const cbTail = RTZIPGZIP_WINDOW_SIZE - pThis->offWindow;
+    memcpy(pbWindow, &pThis->abWindow[pThis->offWindow], cbTail);
+    memcpy(&pbWindow[cbTail], pThis->abWindow, pThis->offWindow);
+
+    PRTZIPGZIPIDXPOINT pPoint = &pThis->paPoints[pThis->cPoints++];
+    pPoint->offOut    = pThis->offOut;
+    pPoint->offIn     = pThis->offInBufEnd - pThis->Zlib.avail_in;
+    pPoint->offMember = pThis->offMember;
+    pPoint->uCheck    = pThis->fRaw ? pThis->uCheck : (uint32_t)pThis->Zlib.adler;
+    pPoint->cBits     = (uint8_t)(pThis->Zlib.data_type & 7);
+    pPoint->pbWindow  = pbWindow;
+}
+
+
+/**
+ * Inflates data for the indexed gzip reader, adding access points on the way.
+ *
+ * @returns IPRT status code.
+ * @param   pThis           The indexed gzip file instance data.
+ * @param   pbDst           Where to put the data.  NULL to skip it.
+ * @param   cbToRead        How much to inflate.
+ * @param   pcbRead         Where to return how much was inflated.  This is
+ *                          only less than @a cbToRead at the end of the stream
+ *                          or on failure.
+ */
+static int rtZipGzipFile_Inflate(PRTZIPGZIPFILE pThis, uint8_t *pbDst, size_t cbToRead, size_t *pcbRead)
+{
+    int    rc     = VINF_SUCCESS;
+    size_t cbRead = 0;
+    while (cbRead < cbToRead && !pThis->fEndOfStream)
+    {
+        if (pThis->Zlib.avail_in == 0)
+        {
+            rc = rtZipGzipFile_FillInput(pThis);
+            if (RT_FAILURE(rc))
+                break;
+            if (pThis->Zlib.avail_in == 0)
+            {
+                rc = VERR_ZIP_CORRUPTED; /* truncated */
+                break;
+            }
+        }
+
+        /*
+         * Inflate into the window and copy it out from there.  Z_BLOCK makes
+         * inflate return at each block boundary so we can add access points.
+         */
+        uInt const cbAvail = (uInt)RT_MIN(RTZIPGZIP_WINDOW_SIZE - pThis->offWindow, cbToRead - cbRead);
+        pThis->Zlib.next_out  = &pThis->abWindow[pThis->offWindow];
+        pThis->Zlib.avail_out = cbAvail;
+        int rcZlib = inflate(&pThis->Zlib, Z_BLOCK);
+
+        uInt const cbProduced = cbAvail - pThis->Zlib.avail_out;
+        if (pbDst)
+            memcpy(&pbDst[cbRead], &pThis->abWindow[pThis->offWindow], cbProduced);
+        if (pThis->fRaw && cbProduced)
+            pThis->uCheck = pThis->iWindowBitsHdr == MAX_WBITS + 16
+                          ? (uint32_t)crc32(pThis->uCheck, &pThis->abWindow[pThis->offWindow], cbProduced)
+                          : (uint32_t)adler32(pThis->uCheck, &pThis->abWindow[pThis->offWindow], cbProduced);
+        cbRead           += cbProduced;
+        pThis->offOut    += cbProduced;
+        pThis->offWindow  = (pThis->offWindow + cbProduced) % RTZIPGZIP_WINDOW_SIZE;
+
+        if (rcZlib == Z_STREAM_END)
+        {
+            rc = rtZipGzipFile_NextMember(pThis);
+            if (RT_FAILURE(rc))
+                break;
+        }
+        else if (rcZlib != Z_OK && rcZlib != Z_BUF_ERROR)
+        {
+            rc = rtZipGzipConvertErrFromZlibNoState(rcZlib, true /*fDecompress*/);
+            break;
+        }
+        else if (   (pThis->Zlib.data_type & (128 | 64)) == 128 /* at a block boundary, but not after the last one */
+                 && pThis->offOut >= (pThis->cPoints ? pThis->paPoints[pThis->cPoints - 1].offOut : 0) + pThis->cbSpan)
+            rtZipGzipFile_AddPoint(pThis);
+    }
+
+    if (RT_FAILURE(rc))
+        pThis->fNeedReset = true;
+    *pcbRead = cbRead;
+    return rc;
+}
+
+
+/**
+ * Positions the decoder of the indexed gzip reader at the given offset, or at
+ * the end of the stream if it's beyond it.
+ *
+ * @returns IPRT status code.
+ * @param   pThis           The indexed gzip file instance data.
+ * @param   offTarget       The uncompressed offset.
+ */
+static int rtZipGzipFile_SeekDecoder(PRTZIPGZIPFILE pThis, uint64_t offTarget)
+{
+    /*
+     * Find the last access point at or before the target and restart from it
+     * if we have to go backwards or if it's ahead of the decoder.
+     */
+    PRTZIPGZIPIDXPOINT pPoint = NULL;
+    uint32_t iStart = 0;
+    uint32_t iEnd   = pThis->cPoints;
+    while (iStart < iEnd)
+    {
+        uint32_t const i = iStart + (iEnd - iStart) / 2;
+        if (pThis->paPoints[i].offOut <= offTarget)
+        {
+            pPoint = &pThis->paPoints[i];
+            iStart = i + 1;
+        }
+        else
+            iEnd = i;
+    }
+
+    if (   pThis->fNeedReset
+        || offTarget < pThis->offOut
+        || (pPoint && pPoint->offOut > pThis->offOut))
+    {
+        int rcZlib;
+        pThis->Zlib.avail_in = 0;
+        if (pPoint)
+        {
+            /* Raw inflate primed with the pending bits and the window. */
+            rcZlib = inflateReset2(&pThis->Zlib, -MAX_WBITS);
+            if (rcZlib == Z_OK && pPoint->cBits)
+            {
+                uint8_t b;
+                int rc = RTVfsFileReadAt(pThis->hVfsFile, (RTFOFF)pPoint->offIn - 1, &b, 1, NULL);
+                if (RT_FAILURE(rc))
+                    return rc;
+                rcZlib = inflatePrime(&pThis->Zlib, pPoint->cBits, b >> (8 - pPoint->cBits));
+            }
+            if (rcZlib == Z_OK)
+                rcZlib = inflateSetDictionary(&pThis->Zlib, pPoint->pbWindow, RTZIPGZIP_WINDOW_SIZE);
+            memcpy(pThis->abWindow, pPoint->pbWindow, RTZIPGZIP_WINDOW_SIZE);
+            pThis->offInBufEnd = pPoint->offIn;
+            pThis->offOut      = pPoint->offOut;
+            pThis->offMember   = pPoint->offMember;
+            pThis->uCheck      = pPoint->uCheck;
+            pThis->fRaw        = true;
+        }
+        else
+        {
+            rcZlib = inflateReset2(&pThis->Zlib, pThis->iWindowBitsHdr);
+            pThis->offInBufEnd = 0;
+            pThis->offOut      = 0;
+            pThis->offMember   = 0;
+            pThis->fRaw        = false;
+        }
+        pThis->offWindow    = 0;
+        pThis->fEndOfStream = false;
+        if (rcZlib != Z_OK)
+            return rtZipGzipConvertErrFromZlibNoState(rcZlib, true /*fDecompress*/);
+        pThis->fNeedReset   = false;
+    }
+
+    /*
+     * Inflate forward to the target.
+     */
+    while (pThis->offOut < offTarget && !pThis->fEndOfStream)
+    {
+        size_t cbSkipped;
+        int rc = rtZipGzipFile_Inflate(pThis, NULL, (size_t)RT_MIN(offTarget - pThis->offOut, _1G), &cbSkipped);
+        if (RT_FAILURE(rc))
+            return rc;
+    }
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Determines the uncompressed size of the indexed gzip file.
+ *
+ * @returns IPRT status code.
+ * @param   pThis           The indexed gzip file instance data.
+ * @param   pcbFile         Where to return the size.
+ */
+static int rtZipGzipFile_GetSize(PRTZIPGZIPFILE pThis, uint64_t *pcbFile)
+{
+    if (pThis->cbOut == UINT64_MAX)
+    {
+        int rc = rtZipGzipFile_SeekDecoder(pThis, UINT64_MAX);
+        if (RT_FAILURE(rc))
+            return rc;
+        Assert(pThis->cbOut != UINT64_MAX);
+    }
+    *pcbFile = pThis->cbOut;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * @interface_method_impl{RTVFSOBJOPS,pfnClose}
+ */
+static DECLCALLBACK(int) rtZipGzipFile_Close(void *pvThis)
+{
+    PRTZIPGZIPFILE pThis = (PRTZIPGZIPFILE)pvThis;
+
+    inflateEnd(&pThis->Zlib);
+    for (uint32_t i = 0; i < pThis->cPoints; i++)
+        RTMemFree(pThis->paPoints[i].pbWindow);
+    RTMemFree(pThis->paPoints);
+    pThis->paPoints = NULL;
+    pThis->cPoints  = 0;
+
+    RTVfsFileRelease(pThis->hVfsFile);
+    pThis->hVfsFile = NIL_RTVFSFILE;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * @interface_method_impl{RTVFSOBJOPS,pfnQueryInfo}
+ */
+static DECLCALLBACK(int) rtZipGzipFile_QueryInfo(void *pvThis, PRTFSOBJINFO pObjInfo, RTFSOBJATTRADD enmAddAttr)
+{
+    PRTZIPGZIPFILE pThis = (PRTZIPGZIPFILE)pvThis;
+    int rc = RTVfsFileQueryInfo(pThis->hVfsFile, pObjInfo, enmAddAttr);
+    if (RT_SUCCESS(rc))
+    {
+        uint64_t cbFile;
+        rc = rtZipGzipFile_GetSize(pThis, &cbFile);
+        if (RT_SUCCESS(rc))
+            pObjInfo->cbObject = (RTFOFF)cbFile;
+    }
+    return rc;
+}
+
+
+/**
+ * @interface_method_impl{RTVFSIOSTREAMOPS,pfnRead}
+ */
+static DECLCALLBACK(int) rtZipGzipFile_Read(void *pvThis, RTFOFF off, PCRTSGBUF pSgBuf, bool fBlocking, size_t *pcbRead)
+{
+    PRTZIPGZIPFILE pThis = (PRTZIPGZIPFILE)pvThis;
+    AssertReturn(off >= -1, VERR_INVALID_PARAMETER);
+    AssertReturn(pSgBuf->cSegs == 1, VERR_INVALID_PARAMETER);
+    NOREF(fBlocking);
+
+    uint64_t const offRead  = off == -1 ? pThis->offCur : (uint64_t)off;
+    size_t const   cbToRead = pSgBuf->paSegs[0].cbSeg;
+    size_t         cbRead   = 0;
+    int rc = rtZipGzipFile_SeekDecoder(pThis, offRead);
+    if (RT_SUCCESS(rc) && pThis->offOut == offRead)
+        rc = rtZipGzipFile_Inflate(pThis, (uint8_t *)pSgBuf->paSegs[0].pvSeg, cbToRead, &cbRead);
+    pThis->offCur = offRead + cbRead;
+
+    if (RT_SUCCESS(rc) && cbRead < cbToRead)
+        rc = pcbRead ? VINF_EOF : VERR_EOF;
+    if (pcbRead)
+        *pcbRead = cbRead;
+    return rc;
+}
+
+
+/**
+ * @interface_method_impl{RTVFSIOSTREAMOPS,pfnWrite}
+ */
+static DECLCALLBACK(int) rtZipGzipFile_Write(void *pvThis, RTFOFF off, PCRTSGBUF pSgBuf, bool fBlocking, size_t *pcbWritten)
+{
+    RT_NOREF_PV(pvThis); RT_NOREF_PV(off); RT_NOREF_PV(pSgBuf); RT_NOREF_PV(fBlocking); RT_NOREF_PV(pcbWritten);
+    return VERR_ACCESS_DENIED;
+}
+
+
+/**
+ * @interface_method_impl{RTVFSIOSTREAMOPS,pfnFlush}
+ */
+static DECLCALLBACK(int) rtZipGzipFile_Flush(void *pvThis)
+{
+    RT_NOREF_PV(pvThis);
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * @interface_method_impl{RTVFSIOSTREAMOPS,pfnPollOne}
+ */
+static DECLCALLBACK(int) rtZipGzipFile_PollOne(void *pvThis, uint32_t fEvents, RTMSINTERVAL cMillies, bool fIntr,
+                                               uint32_t *pfRetEvents)
+{
+    NOREF(pvThis);
+    int rc;
+    if (fEvents & RTPOLL_EVT_READ)
+    {
+        *pfRetEvents = RTPOLL_EVT_READ;
+        rc = VINF_SUCCESS;
+    }
+    else
+        rc = RTVfsUtilDummyPollOne(fEvents, cMillies, fIntr, pfRetEvents);
+    return rc;
+}
+
+
+/**
+ * @interface_method_impl{RTVFSIOSTREAMOPS,pfnTell}
+ */
+static DECLCALLBACK(int) rtZipGzipFile_Tell(void *pvThis, PRTFOFF poffActual)
+{
+    PRTZIPGZIPFILE pThis = (PRTZIPGZIPFILE)pvThis;
+    *poffActual = (RTFOFF)pThis->offCur;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * @interface_method_impl{RTVFSOBJSETOPS,pfnMode}
+ */
+static DECLCALLBACK(int) rtZipGzipFile_SetMode(void *pvThis, RTFMODE fMode, RTFMODE fMask)
+{
+    NOREF(pvThis);
+    NOREF(fMode);
+    NOREF(fMask);
+    return VERR_NOT_SUPPORTED;
+}
+
+
+/**
+ * @interface_method_impl{RTVFSOBJSETOPS,pfnSetTimes}
+ */
+static DECLCALLBACK(int) rtZipGzipFile_SetTimes(void *pvThis, PCRTTIMESPEC pAccessTime, PCRTTIMESPEC pModificationTime,
+                                                PCRTTIMESPEC pChangeTime, PCRTTIMESPEC pBirthTime)
+{
+    NOREF(pvThis);
+    NOREF(pAccessTime);
+    NOREF(pModificationTime);
+    NOREF(pChangeTime);
+    NOREF(pBirthTime);
+    return VERR_NOT_SUPPORTED;
+}
+
+
+/**
+ * @interface_method_impl{RTVFSOBJSETOPS,pfnSetOwner}
+ */
+static DECLCALLBACK(int) rtZipGzipFile_SetOwner(void *pvThis, RTUID uid, RTGID gid)
+{
+    NOREF(pvThis);
+    NOREF(uid);
+    NOREF(gid);
+    return VERR_NOT_SUPPORTED;
+}
+
+
+/**
+ * @interface_method_impl{RTVFSFILEOPS,pfnSeek}
+ */
+static DECLCALLBACK(int) rtZipGzipFile_Seek(void *pvThis, RTFOFF offSeek, unsigned uMethod, PRTFOFF poffActual)
+{
+    PRTZIPGZIPFILE pThis = (PRTZIPGZIPFILE)pvThis;
+
+    /* Recalculate the request to RTFILE_SEEK_BEGIN.  The decoder is only
+       repositioned by the next read. */
+    switch (uMethod)
+    {
+        case RTFILE_SEEK_BEGIN:
+            break;
+        case RTFILE_SEEK_CURRENT:
+            offSeek += (RTFOFF)pThis->offCur;
+            break;
+        case RTFILE_SEEK_END:
+        {
+            uint64_t cbFile;
+            int rc = rtZipGzipFile_GetSize(pThis, &cbFile);
+            if (RT_FAILURE(rc))
+                return rc;
+            offSeek += (RTFOFF)cbFile;
+            break;
+        }
+        default:
+            AssertFailedReturn(VERR_INVALID_PARAMETER);
+    }
+    if (offSeek < 0)
+        return VERR_NEGATIVE_SEEK;
+
+    pThis->offCur = (uint64_t)offSeek;
+    if (poffActual)
+        *poffActual = offSeek;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * @interface_method_impl{RTVFSFILEOPS,pfnQuerySize}
+ */
+static DECLCALLBACK(int) rtZipGzipFile_QuerySize(void *pvThis, uint64_t *pcbFile)
+{
+    PRTZIPGZIPFILE pThis = (PRTZIPGZIPFILE)pvThis;
+    return rtZipGzipFile_GetSize(pThis, pcbFile);
+}
+
+
+/**
+ * The indexed GZIP file vtable.
+ */
+static const RTVFSFILEOPS g_rtZipGzipFileOps =
+{
+    { /* I/O stream */
+        { /* Obj */
+            RTVFSOBJOPS_VERSION,
+            RTVFSOBJTYPE_FILE,
+            "gzip-indexed",
+            rtZipGzipFile_Close,
+            rtZipGzipFile_QueryInfo,
+            RTVFSOBJOPS_VERSION
+        },
+        RTVFSIOSTREAMOPS_VERSION,
+        RTVFSIOSTREAMOPS_FEAT_NO_SG,
+        rtZipGzipFile_Read,
+        rtZipGzipFile_Write,
+        rtZipGzipFile_Flush,
+        rtZipGzipFile_PollOne,
+        rtZipGzipFile_Tell,
+        NULL /*Skip*/,
+        NULL /*ZeroFill*/,
+        RTVFSIOSTREAMOPS_VERSION
+    },
+    RTVFSFILEOPS_VERSION,
+    0,
+    { /* ObjSet */
+        RTVFSOBJSETOPS_VERSION,
+        RT_OFFSETOF(RTVFSFILEOPS, Stream.Obj) - RT_OFFSETOF(RTVFSFILEOPS, ObjSet),
+        rtZipGzipFile_SetMode,
+        rtZipGzipFile_SetTimes,
+        rtZipGzipFile_SetOwner,
+        RTVFSOBJSETOPS_VERSION
+    },
+    rtZipGzipFile_Seek,
+    rtZipGzipFile_QuerySize,
+    RTVFSFILEOPS_VERSION,
+};
+
+
+RTDECL(int) RTZipGzipDecompressFile(RTVFSFILE hVfsFileIn, uint32_t fFlags, PRTVFSFILE phVfsFileGunzip)
+{
+    AssertPtrReturn(hVfsFileIn, VERR_INVALID_HANDLE);
+    AssertReturn(!(fFlags & ~RTZIPGZIPDECOMP_F_ALLOW_ZLIB_HDR), VERR_INVALID_PARAMETER);
+    AssertPtrReturn(phVfsFileGunzip, VERR_INVALID_POINTER);
+
+    /*
+     * Check the header like RTZipGzipDecompressIoStream does.  Only gzip
+     * members can be concatenated, a zlib stream ends with the first one.
+     */
+    RTZIPGZIPHDR Hdr;
+    int rc = RTVfsFileReadAt(hVfsFileIn, 0, &Hdr, sizeof(Hdr), NULL /*pcbRead*/);
+    if (RT_FAILURE(rc))
+        return rc;
+    int iWindowBitsHdr;
+    if (   Hdr.bId1 == RTZIPGZIPHDR_ID1
+        && Hdr.bId2 == RTZIPGZIPHDR_ID2
+        && !(Hdr.fFlags & ~RTZIPGZIPHDR_FLG_VALID_MASK))
+    {
+        if (Hdr.bCompressionMethod != RTZIPGZIPHDR_CM_DEFLATE)
+            return VERR_ZIP_UNSUPPORTED_METHOD;
+        iWindowBitsHdr = MAX_WBITS + 16;
+    }
+    else if (   (fFlags & RTZIPGZIPDECOMP_F_ALLOW_ZLIB_HDR)
+             && (RT_MAKE_U16(Hdr.bId2, Hdr.bId1) % 31) == 0
+             && (Hdr.bId1 & 0xf) == RTZIPGZIPHDR_CM_DEFLATE )
+        iWindowBitsHdr = MAX_WBITS;
+    else
+        return VERR_ZIP_BAD_HEADER;
+
+    uint32_t cRefs = RTVfsFileRetain(hVfsFileIn);
+    AssertReturn(cRefs != UINT32_MAX, VERR_INVALID_HANDLE);
+
+    /*
+     * Create the file.  The decoder is positioned by the first read.
+     */
+    RTVFSFILE      hVfsFile;
+    PRTZIPGZIPFILE pThis;
+    rc = RTVfsNewFile(&g_rtZipGzipFileOps, sizeof(RTZIPGZIPFILE), RTFILE_O_READ | RTFILE_O_OPEN | RTFILE_O_DENY_NONE,
+                      NIL_RTVFS, NIL_RTVFSLOCK, &hVfsFile, (void **)&pThis);
+    if (RT_SUCCESS(rc))
+    {
+        pThis->hVfsFile       = hVfsFileIn;
+        pThis->iWindowBitsHdr = iWindowBitsHdr;
+        pThis->fNeedReset     = true;
+        pThis->fRaw           = false;
+        pThis->fEndOfStream   = false;
+        pThis->offCur         = 0;
+        pThis->offOut         = 0;
+        pThis->offMember      = 0;
+        pThis->uCheck         = 0;
+        pThis->offInBufEnd    = 0;
+        pThis->cbOut          = UINT64_MAX;
+        pThis->cbSpan         = RTZIPGZIPIDX_SPAN;
+        pThis->cPoints        = 0;
+        pThis->paPoints       = NULL;
+        pThis->offWindow      = 0;
+
+        RT_ZERO(pThis->Zlib);
+        pThis->Zlib.opaque    = pThis;
+        rc = inflateInit2(&pThis->Zlib, iWindowBitsHdr);
+        if (rc == Z_OK)
+        {
+            *phVfsFileGunzip = hVfsFile;
+            return VINF_SUCCESS;
+        }
+        rc = rtZipGzipConvertErrFromZlibNoState(rc, true /*fDecompress*/);
+        RTVfsFileRelease(hVfsFile);
+    }
+    else
+        RTVfsFileRelease(hVfsFileIn);
+    return rc;
+}
+
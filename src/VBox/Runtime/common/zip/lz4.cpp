@@ -0,0 +1,525 @@
+/* $Id$ */
+/** @file
+ * IPRT - LZ4 block format codec.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+/** @page pg_rt_zip_lz4    RTZip - LZ4 Block Format
+ *
+ * This is an independent implementation of the LZ4 block format, which is a
+ * byte oriented LZ77 variant without any entropy coding.  A block is a series
+ * of sequences, each made up of:
+ *      - A token byte, the high nibble is the literal count and the low nibble
+ *        the match length minus 4.  A nibble value of 15 means that further
+ *        length bytes follow, each adding up to 255 with 255 meaning that
+ *        another byte follows.
+ *      - The literal length bytes, if any.
+ *      - The literals.
+ *      - A 16-bit little endian match offset, never zero.
+ *      - The match length bytes, if any.
+ *
+ * The last sequence consists of the token and literals only.  To allow fast
+ * decoders, the last 5 bytes of a block are always literals and the last
+ * match must start at least 12 bytes before the end of the block.
+ *
+ * There are two match finders.  The fast one is greedy and probes a single
+ * hash table slot per position, skipping ahead faster the longer it goes
+ * without finding anything.  The high ratio one (RTZIPLEVEL_MAX) follows hash
+ * chains over the whole 64KB window and does one step of lazy matching.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include "lz4.h"
+
+#include <iprt/asm.h>
+#include <iprt/assert.h>
+#include <iprt/err.h>
+#include <iprt/mem.h>
+#include <iprt/string.h>
+
+
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** The minimum match length. */
+#define RTZIPLZ4_MIN_MATCH              4
+/** The number of bytes at the end of a block which are always literals. */
+#define RTZIPLZ4_LAST_LITERALS          5
+/** The last match must start at least this many bytes before the end. */
+#define RTZIPLZ4_MF_LIMIT               12
+/** The maximum match distance. */
+#define RTZIPLZ4_MAX_DISTANCE           0xffff
+/** The hash table size of the fast match finder (log2). */
+#define RTZIPLZ4_FAST_HASH_BITS         12
+/** Number of misses after which the fast match finder doubles its step. */
+#define RTZIPLZ4_FAST_SKIP_TRIGGER      6
+/** The hash table size of the high ratio match finder (log2). */
+#define RTZIPLZ4_HC_HASH_BITS           15
+/** The maximum number of chain entries the high ratio match finder visits. */
+#define RTZIPLZ4_HC_MAX_ATTEMPTS        128
+
+
+/*********************************************************************************************************************************
+*   Structures and Typedefs                                                                                                      *
+*********************************************************************************************************************************/
+/**
+ * The match finder tables of the high ratio compressor.
+ */
+typedef struct RTZIPLZ4HC
+{
+    /** The most recent position for each hash value, UINT32_MAX if none. */
+    uint32_t    aoffHead[RT_BIT_32(RTZIPLZ4_HC_HASH_BITS)];
+    /** The distance to the previous position with the same hash, indexed by
+     * the low 16 bits of the position.  Zero terminates the chain. */
+    uint16_t    au16Chain[RTZIPLZ4_MAX_DISTANCE + 1];
+} RTZIPLZ4HC;
+/** Pointer to the high ratio match finder tables. */
+typedef RTZIPLZ4HC *PRTZIPLZ4HC;
+
+
+DECLINLINE(uint32_t) rtZipLz4Read32(uint8_t const *pb)
+{
+    uint32_t u32;
+    memcpy(&u32, pb, sizeof(u32));
+    return u32;
+}
+
+
+DECLINLINE(uint32_t) rtZipLz4Hash(uint32_t u32, unsigned cBits)
+{
+    return (u32 * UINT32_C(2654435761)) >> (32 - cBits);
+}
+
+
+/**
+ * Counts the number of matching bytes.
+ *
+ * @returns Number of bytes at @a pbCur which equal those at @a pbRef.
+ * @param   pbCur       The current position.
+ * @param   pbRef       The earlier position to compare with.
+ * @param   pbLimit     Where to stop comparing (exclusive, relative to
+ *                      @a pbCur).
+ */
+DECLINLINE(size_t) rtZipLz4MatchLength(uint8_t const *pbCur, uint8_t const *pbRef, uint8_t const *pbLimit)
+{
+    uint8_t const *pbStart = pbCur;
+#ifdef RT_LITTLE_ENDIAN
+    while ((size_t)(pbLimit - pbCur) >= sizeof(uint64_t))
+    {
+        uint64_t u64Cur, u64Ref;
+        memcpy(&u64Cur, pbCur, sizeof(u64Cur));
+        memcpy(&u64Ref, pbRef, sizeof(u64Ref));
+        uint64_t const fDiff = u64Cur ^ u64Ref;
+        if (fDiff)
+            return (size_t)(pbCur - pbStart) + (ASMBitFirstSetU64(fDiff) - 1) / 8;
+        pbCur += sizeof(uint64_t);
+        pbRef += sizeof(uint64_t);
+    }
+#endif
+    while (pbCur < pbLimit && *pbCur == *pbRef)
+        pbCur++, pbRef++;
+    return (size_t)(pbCur - pbStart);
+}
+
+
+/**
+ * Encodes a length continuation (the part exceeding the nibble).
+ */
+DECLINLINE(uint8_t *) rtZipLz4PutLength(uint8_t *pbOut, size_t cb)
+{
+    while (cb >= 255)
+    {
+        *pbOut++ = 255;
+        cb -= 255;
+    }
+    *pbOut++ = (uint8_t)cb;
+    return pbOut;
+}
+
+
+/**
+ * Emits one sequence.
+ *
+ * @returns The new output position, NULL if the output buffer is too small.
+ * @param   pbOut       The output position.
+ * @param   pbOutEnd    The end of the output buffer.
+ * @param   pbLiterals  The literals.
+ * @param   cLiterals   The number of literals.
+ * @param   offMatch    The match distance.
+ * @param   cbMatch     The match length, 0 for the final literal only
+ *                      sequence.
+ */
+static uint8_t *rtZipLz4EmitSequence(uint8_t *pbOut, uint8_t *pbOutEnd, uint8_t const *pbLiterals, size_t cLiterals,
+                                     size_t offMatch, size_t cbMatch)
+{
+    size_t const cbNeeded = 1 + cLiterals / 255 + 1 + cLiterals
+                          + (cbMatch ? 2 + (cbMatch - RTZIPLZ4_MIN_MATCH) / 255 + 1 : 0);
+    if (RT_UNLIKELY(cbNeeded > (size_t)(pbOutEnd - pbOut)))
+        return NULL;
+
+    uint8_t *pbToken = pbOut++;
+    uint8_t  bToken;
+    if (cLiterals >= 15)
+    {
+        bToken = 15 << 4;
+        pbOut  = rtZipLz4PutLength(pbOut, cLiterals - 15);
+    }
+    else
+        bToken = (uint8_t)(cLiterals << 4);
+    memcpy(pbOut, pbLiterals, cLiterals);
+    pbOut += cLiterals;
+
+    if (cbMatch)
+    {
+        Assert(offMatch > 0 && offMatch <= RTZIPLZ4_MAX_DISTANCE);
+        Assert(cbMatch >= RTZIPLZ4_MIN_MATCH);
+        *pbOut++ = (uint8_t)offMatch;
+        *pbOut++ = (uint8_t)(offMatch >> 8);
+        cbMatch -= RTZIPLZ4_MIN_MATCH;
+        if (cbMatch >= 15)
+        {
+            bToken |= 15;
+            pbOut   = rtZipLz4PutLength(pbOut, cbMatch - 15);
+        }
+        else
+            bToken |= (uint8_t)cbMatch;
+    }
+    *pbToken = bToken;
+    return pbOut;
+}
+
+
+/**
+ * The greedy single probe compressor.
+ */
+static int rtZipLz4CompressFast(uint8_t const *pbSrc, size_t cbSrc, uint8_t *pbDst, size_t cbDst, size_t *pcbDstActual)
+{
+    uint8_t        *pbOut    = pbDst;
+    uint8_t * const pbOutEnd = pbDst + cbDst;
+    uint8_t const  *pbAnchor = pbSrc;
+
+    if (cbSrc > RTZIPLZ4_MF_LIMIT)
+    {
+        /* 16KB is too much for worker and EMT stacks. */
+        uint32_t *paoffHash = (uint32_t *)RTMemTmpAllocZ(sizeof(uint32_t) * RT_BIT_32(RTZIPLZ4_FAST_HASH_BITS));
+        if (!paoffHash)
+            return VERR_NO_TMP_MEMORY;
+
+        uint8_t const * const pbMfLimit    = pbSrc + cbSrc - RTZIPLZ4_MF_LIMIT;
+        uint8_t const * const pbMatchLimit = pbSrc + cbSrc - RTZIPLZ4_LAST_LITERALS;
+        uint8_t const        *pbIp         = pbSrc + 1;
+        unsigned              cMisses      = 0;
+        while (pbIp <= pbMfLimit)
+        {
+            uint32_t const u32Cur = rtZipLz4Read32(pbIp);
+            uint32_t const iHash  = rtZipLz4Hash(u32Cur, RTZIPLZ4_FAST_HASH_BITS);
+            uint8_t const *pbRef  = pbSrc + paoffHash[iHash];
+            paoffHash[iHash] = (uint32_t)(pbIp - pbSrc);
+            if (   (size_t)(pbIp - pbRef) <= RTZIPLZ4_MAX_DISTANCE
+                && rtZipLz4Read32(pbRef) == u32Cur)
+            {
+                /* Extend the match backwards into the pending literals. */
+                while (   pbIp > pbAnchor
+                       && pbRef > pbSrc
+                       && pbIp[-1] == pbRef[-1])
+                    pbIp--, pbRef--;
+
+                size_t const cbMatch = RTZIPLZ4_MIN_MATCH
+                                     + rtZipLz4MatchLength(pbIp + RTZIPLZ4_MIN_MATCH, pbRef + RTZIPLZ4_MIN_MATCH, pbMatchLimit);
+                pbOut = rtZipLz4EmitSequence(pbOut, pbOutEnd, pbAnchor, (size_t)(pbIp - pbAnchor),
+                                             (size_t)(pbIp - pbRef), cbMatch);
+                if (RT_UNLIKELY(!pbOut))
+                {
+                    RTMemTmpFree(paoffHash);
+                    return VERR_BUFFER_OVERFLOW;
+                }
+                pbIp    += cbMatch;
+                pbAnchor = pbIp;
+                cMisses  = 0;
+
+                /* Seed the table with a position inside the match. */
+                if (pbIp <= pbMfLimit)
+                    paoffHash[rtZipLz4Hash(rtZipLz4Read32(pbIp - 2), RTZIPLZ4_FAST_HASH_BITS)] = (uint32_t)(pbIp - 2 - pbSrc);
+            }
+            else
+                pbIp += 1 + (cMisses++ >> RTZIPLZ4_FAST_SKIP_TRIGGER);
+        }
+
+        RTMemTmpFree(paoffHash);
+    }
+
+    pbOut = rtZipLz4EmitSequence(pbOut, pbOutEnd, pbAnchor, (size_t)(pbSrc + cbSrc - pbAnchor), 0, 0);
+    if (RT_UNLIKELY(!pbOut))
+        return VERR_BUFFER_OVERFLOW;
+    *pcbDstActual = (size_t)(pbOut - pbDst);
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Finds the longest match for a position using the hash chains.
+ *
+ * All positions from @a *poffInsert up to and including @a pbIp are added to
+ * the chains first.
+ *
+ * @returns The match length, 0 if nothing of at least RTZIPLZ4_MIN_MATCH
+ *          bytes was found.
+ * @param   pHc             The match finder tables.
+ * @param   pbSrc           The start of the input.
+ * @param   pbIp            The position to find a match for.
+ * @param   pbMatchLimit    Where matches must end.
+ * @param   poffInsert      The next position to insert, updated.
+ * @param   ppbRef          Where to return the start of the match.
+ */
+static size_t rtZipLz4HcFindBest(PRTZIPLZ4HC pHc, uint8_t const *pbSrc, uint8_t const *pbIp, uint8_t const *pbMatchLimit,
+                                 uint32_t *poffInsert, uint8_t const **ppbRef)
+{
+    uint32_t const offIp = (uint32_t)(pbIp - pbSrc);
+    for (uint32_t off = *poffInsert; off <= offIp; off++)
+    {
+        uint32_t const iHash   = rtZipLz4Hash(rtZipLz4Read32(pbSrc + off), RTZIPLZ4_HC_HASH_BITS);
+        uint32_t const offPrev = pHc->aoffHead[iHash];
+        pHc->au16Chain[off & RTZIPLZ4_MAX_DISTANCE] = offPrev != UINT32_MAX && off - offPrev <= RTZIPLZ4_MAX_DISTANCE
+                                                    ? (uint16_t)(off - offPrev) : 0;
+        pHc->aoffHead[iHash] = off;
+    }
+    *poffInsert = offIp + 1;
+
+    size_t   cbBest   = RTZIPLZ4_MIN_MATCH - 1;
+    uint32_t cLeft    = RTZIPLZ4_HC_MAX_ATTEMPTS;
+    uint32_t offCand  = offIp;
+    uint32_t const u32Cur = rtZipLz4Read32(pbIp);
+    for (;;)
+    {
+        uint16_t const offDelta = pHc->au16Chain[offCand & RTZIPLZ4_MAX_DISTANCE];
+        if (!offDelta)
+            break;
+        offCand -= offDelta;
+        if (offIp - offCand > RTZIPLZ4_MAX_DISTANCE)
+            break;
+
+        uint8_t const *pbCand = pbSrc + offCand;
+        if (   pbCand[cbBest] == pbIp[cbBest]
+            && rtZipLz4Read32(pbCand) == u32Cur)
+        {
+            size_t const cbMatch = RTZIPLZ4_MIN_MATCH
+                                 + rtZipLz4MatchLength(pbIp + RTZIPLZ4_MIN_MATCH, pbCand + RTZIPLZ4_MIN_MATCH, pbMatchLimit);
+            if (cbMatch > cbBest)
+            {
+                cbBest  = cbMatch;
+                *ppbRef = pbCand;
+                if (pbIp + cbMatch >= pbMatchLimit)
+                    break;
+            }
+        }
+        if (!--cLeft)
+            break;
+    }
+    return cbBest >= RTZIPLZ4_MIN_MATCH ? cbBest : 0;
+}
+
+
+/**
+ * The hash chain compressor with one step lazy matching.
+ */
+static int rtZipLz4CompressHigh(uint8_t const *pbSrc, size_t cbSrc, uint8_t *pbDst, size_t cbDst, size_t *pcbDstActual)
+{
+    uint8_t        *pbOut    = pbDst;
+    uint8_t * const pbOutEnd = pbDst + cbDst;
+    uint8_t const  *pbAnchor = pbSrc;
+
+    if (cbSrc > RTZIPLZ4_MF_LIMIT)
+    {
+        PRTZIPLZ4HC pHc = (PRTZIPLZ4HC)RTMemTmpAlloc(sizeof(*pHc));
+        if (!pHc)
+            return VERR_NO_TMP_MEMORY;
+        memset(pHc->aoffHead, 0xff, sizeof(pHc->aoffHead));
+
+        uint8_t const * const pbMfLimit    = pbSrc + cbSrc - RTZIPLZ4_MF_LIMIT;
+        uint8_t const * const pbMatchLimit = pbSrc + cbSrc - RTZIPLZ4_LAST_LITERALS;
+        uint8_t const        *pbIp         = pbSrc;
+        uint32_t              offInsert    = 0;
+        while (pbIp <= pbMfLimit)
+        {
+            uint8_t const *pbRef   = NULL;
+            size_t         cbMatch = rtZipLz4HcFindBest(pHc, pbSrc, pbIp, pbMatchLimit, &offInsert, &pbRef);
+            if (!cbMatch)
+            {
+                pbIp++;
+                continue;
+            }
+
+            /* Defer the match while the next position has a longer one. */
+            while (pbIp + 1 <= pbMfLimit)
+            {
+                uint8_t const *pbRef2  = NULL;
+                size_t const   cbMatch2 = rtZipLz4HcFindBest(pHc, pbSrc, pbIp + 1, pbMatchLimit, &offInsert, &pbRef2);
+                if (cbMatch2 <= cbMatch)
+                    break;
+                pbIp++;
+                pbRef   = pbRef2;
+                cbMatch = cbMatch2;
+            }
+
+            pbOut = rtZipLz4EmitSequence(pbOut, pbOutEnd, pbAnchor, (size_t)(pbIp - pbAnchor), (size_t)(pbIp - pbRef), cbMatch);
+            if (RT_UNLIKELY(!pbOut))
+            {
+                RTMemTmpFree(pHc);
+                return VERR_BUFFER_OVERFLOW;
+            }
+            pbIp    += cbMatch;
+            pbAnchor = pbIp;
+        }
+
+        RTMemTmpFree(pHc);
+    }
+
+    pbOut = rtZipLz4EmitSequence(pbOut, pbOutEnd, pbAnchor, (size_t)(pbSrc + cbSrc - pbAnchor), 0, 0);
+    if (RT_UNLIKELY(!pbOut))
+        return VERR_BUFFER_OVERFLOW;
+    *pcbDstActual = (size_t)(pbOut - pbDst);
+    return VINF_SUCCESS;
+}
+
+
+DECLHIDDEN(int) rtZipLz4CompressBlock(void const *pvSrc, size_t cbSrc, void *pvDst, size_t cbDst, bool fHigh,
+                                      size_t *pcbDstActual)
+{
+    AssertReturn(cbSrc < UINT32_MAX, VERR_OUT_OF_RANGE);
+    if (fHigh)
+        return rtZipLz4CompressHigh((uint8_t const *)pvSrc, cbSrc, (uint8_t *)pvDst, cbDst, pcbDstActual);
+    return rtZipLz4CompressFast((uint8_t const *)pvSrc, cbSrc, (uint8_t *)pvDst, cbDst, pcbDstActual);
+}
+
+
+/**
+ * Decodes a length continuation.
+ *
+ * @returns false if the input ran out.
+ */
+DECLINLINE(bool) rtZipLz4GetLength(uint8_t const **ppbIn, uint8_t const *pbInEnd, size_t *pcb)
+{
+    uint8_t const *pbIn = *ppbIn;
+    size_t         cb   = *pcb;
+    uint8_t        b;
+    do
+    {
+        if (RT_UNLIKELY(pbIn >= pbInEnd))
+            return false;
+        b   = *pbIn++;
+        cb += b;
+    } while (b == 255);
+    *ppbIn = pbIn;
+    *pcb   = cb;
+    return true;
+}
+
+
+DECLHIDDEN(int) rtZipLz4DecompressBlock(void const *pvSrc, size_t cbSrc, void *pvDst, size_t cbDst, size_t *pcbDstActual)
+{
+    uint8_t const        *pbIn     = (uint8_t const *)pvSrc;
+    uint8_t const * const pbInEnd  = pbIn + cbSrc;
+    uint8_t * const       pbDst    = (uint8_t *)pvDst;
+    uint8_t              *pbOut    = pbDst;
+    uint8_t * const       pbOutEnd = pbDst + cbDst;
+
+    for (;;)
+    {
+        if (RT_UNLIKELY(pbIn >= pbInEnd))
+            return VERR_ZIP_CORRUPTED;
+        unsigned const bToken = *pbIn++;
+
+        /*
+         * The literals.  Short runs are copied with a fixed size when there is
+         * room for it on both sides, which beats a variable sized memcpy.
+         */
+        size_t cLiterals = bToken >> 4;
+        if (   cLiterals == 15
+            && RT_UNLIKELY(!rtZipLz4GetLength(&pbIn, pbInEnd, &cLiterals)))
+            return VERR_ZIP_CORRUPTED;
+        if (RT_UNLIKELY(cLiterals > (size_t)(pbInEnd - pbIn)))
+            return VERR_ZIP_CORRUPTED;
+        if (RT_UNLIKELY(cLiterals > (size_t)(pbOutEnd - pbOut)))
+            return VERR_BUFFER_OVERFLOW;
+        if (   cLiterals <= 16
+            && (size_t)(pbInEnd - pbIn) >= 16
+            && (size_t)(pbOutEnd - pbOut) >= 16)
+            memcpy(pbOut, pbIn, 16);
+        else
+            memcpy(pbOut, pbIn, cLiterals);
+        pbOut += cLiterals;
+        pbIn  += cLiterals;
+
+        /* The last sequence has no match part. */
+        if (pbIn == pbInEnd)
+            break;
+
+        /*
+         * The match.
+         */
+        if (RT_UNLIKELY((size_t)(pbInEnd - pbIn) < 2))
+            return VERR_ZIP_CORRUPTED;
+        size_t const offMatch = pbIn[0] | ((size_t)pbIn[1] << 8);
+        pbIn += 2;
+        if (RT_UNLIKELY(!offMatch || offMatch > (size_t)(pbOut - pbDst)))
+            return VERR_ZIP_CORRUPTED;
+
+        size_t cbMatch = bToken & 15;
+        if (   cbMatch == 15
+            && RT_UNLIKELY(!rtZipLz4GetLength(&pbIn, pbInEnd, &cbMatch)))
+            return VERR_ZIP_CORRUPTED;
+        cbMatch += RTZIPLZ4_MIN_MATCH;
+        if (RT_UNLIKELY(cbMatch > (size_t)(pbOutEnd - pbOut)))
+            return VERR_BUFFER_OVERFLOW;
+
+        uint8_t const *pbRef = pbOut - offMatch;
+        if (offMatch >= cbMatch)
+            memcpy(pbOut, pbRef, cbMatch);
+        else if (offMatch >= sizeof(uint64_t))
+        {
+            /* Overlapping, but each 8 byte chunk only reads bytes already written. */
+            size_t cbLeft = cbMatch;
+            while (cbLeft >= sizeof(uint64_t))
+            {
+                memcpy(pbOut + cbMatch - cbLeft, pbRef + cbMatch - cbLeft, sizeof(uint64_t));
+                cbLeft -= sizeof(uint64_t);
+            }
+            while (cbLeft)
+            {
+                pbOut[cbMatch - cbLeft] = pbRef[cbMatch - cbLeft];
+                cbLeft--;
+            }
+        }
+        else
+            for (size_t off = 0; off < cbMatch; off++)
+                pbOut[off] = pbRef[off];
+        pbOut += cbMatch;
+    }
+
+    *pcbDstActual = (size_t)(pbOut - pbDst);
+    return VINF_SUCCESS;
+}
+
@@ -0,0 +1,77 @@
+/* $Id$ */
+/** @file
+ * IPRT - LZ4 block format codec, internal header.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+#ifndef ___common_zip_lz4_h
+#define ___common_zip_lz4_h
+
+#include <iprt/types.h>
+
+RT_C_DECLS_BEGIN
+
+/** The worst case size of the LZ4 block encoding of @a a_cb bytes, i.e. one
+ * literal run covering everything. */
+#define RTZIPLZ4_COMPRESS_BOUND(a_cb)   ((a_cb) + (a_cb) / 255 + 16)
+
+/**
+ * Compresses a block into the LZ4 block format.
+ *
+ * @returns IPRT status code.
+ * @retval  VERR_BUFFER_OVERFLOW if the encoding does not fit into @a cbDst.
+ * @retval  VERR_NO_TMP_MEMORY if @a fHigh and the match finder tables could
+ *          not be allocated.
+ * @param   pvSrc           The data to compress.
+ * @param   cbSrc           The number of bytes to compress.
+ * @param   pvDst           The output buffer.
+ * @param   cbDst           The size of the output buffer.
+ * @param   fHigh           Use the hash chain match finder with lazy matching
+ *                          for a better ratio instead of the greedy single
+ *                          probe one.
+ * @param   pcbDstActual    Where to return the size of the encoding.
+ */
+DECLHIDDEN(int) rtZipLz4CompressBlock(void const *pvSrc, size_t cbSrc, void *pvDst, size_t cbDst, bool fHigh,
+                                      size_t *pcbDstActual);
+
+/**
+ * Decompresses a block in the LZ4 block format.
+ *
+ * The input is fully validated, a corrupt block will neither read outside
+ * @a pvSrc nor write outside @a pvDst.
+ *
+ * @returns IPRT status code.
+ * @retval  VERR_BUFFER_OVERFLOW if the output doesn't fit into @a cbDst.
+ * @retval  VERR_ZIP_CORRUPTED if the encoding is invalid.
+ * @param   pvSrc           The compressed block.
+ * @param   cbSrc           The size of the compressed block.
+ * @param   pvDst           The output buffer.
+ * @param   cbDst           The size of the output buffer.
+ * @param   pcbDstActual    Where to return the number of bytes produced.
+ */
+DECLHIDDEN(int) rtZipLz4DecompressBlock(void const *pvSrc, size_t cbSrc, void *pvDst, size_t cbDst, size_t *pcbDstActual);
+
+RT_C_DECLS_END
+
+#endif
+
@@ -33,6 +33,7 @@
 //#define RTZIP_USE_BZLIB 1
 #define RTZIP_USE_LZF 1
 #define RTZIP_LZF_BLOCK_BY_BLOCK
+#define RTZIP_USE_LZ4 1
 //#define RTZIP_USE_LZJB 1
 //#define RTZIP_USE_LZO 1
 
@@ -58,6 +59,9 @@
 #ifdef RTZIP_USE_LZO
 # include <lzo/lzo1x.h>
 #endif
+#ifdef RTZIP_USE_LZ4
+# include "lz4.h"
+#endif
 
 #include <iprt/zip.h>
 #include "internal/iprt.h"
@@ -113,6 +117,43 @@ typedef const RTZIPLZFHDR *PCRTZIPLZFHDR;
 
 #endif /* RTZIP_USE_LZF */
 
+#ifdef RTZIP_USE_LZ4
+
+/**
+ * LZ4 block header.
+ *
+ * All fields are little endian.
+ */
+#pragma pack(1)
+typedef struct RTZIPLZ4HDR
+{
+    /** Magic word (RTZIPLZ4HDR_MAGIC). */
+    uint16_t    u16Magic;
+    /** Flags (RTZIPLZ4HDR_F_XXX). */
+    uint16_t    fFlags;
+    /** The number of bytes of data following this header. */
+    uint16_t    cbData;
+    /** The size of the uncompressed data in bytes. */
+    uint16_t    cbUncompressed;
+} RTZIPLZ4HDR;
+#pragma pack()
+AssertCompileSize(RTZIPLZ4HDR, 8);
+/** Pointer to a LZ4 block header. */
+typedef RTZIPLZ4HDR *PRTZIPLZ4HDR;
+/** Pointer to a const LZ4 block header. */
+typedef const RTZIPLZ4HDR *PCRTZIPLZ4HDR;
+
+/** The magic of a LZ4 block header. */
+#define RTZIPLZ4HDR_MAGIC                       ('Z' | ('4' << 8))
+/** The block data is stored uncompressed because it didn't compress. */
+#define RTZIPLZ4HDR_F_STORED                    UINT16_C(0x0001)
+
+/** The max uncompressed data size of a block.
+ * Also the max compressed data size as blocks which don't shrink are stored. */
+#define RTZIPLZ4_MAX_UNCOMPRESSED_DATA_SIZE     (32*_1K)
+
+#endif /* RTZIP_USE_LZ4 */
+
 
 /**
  * Compressor/Decompressor instance data.
@@ -176,6 +217,20 @@ typedef struct RTZIPCOMP
             uint8_t     abInput[RTZIPLZF_MAX_UNCOMPRESSED_DATA_SIZE];
         } LZF;
 #endif
+#ifdef RTZIP_USE_LZ4
+        /** LZ4 stream. */
+        struct
+        {
+            /** Current output buffer position. */
+            uint8_t    *pbOutput;
+            /** The number of bytes in the input buffer. */
+            size_t      cbInput;
+            /** Whether to use the high ratio match finder. */
+            bool        fHigh;
+            /** The input buffer. */
+            uint8_t     abInput[RTZIPLZ4_MAX_UNCOMPRESSED_DATA_SIZE];
+        } LZ4;
+#endif
 
     } u;
 } RTZIPCOMP;
@@ -248,6 +303,18 @@ typedef struct RTZIPDECOMP
             uint8_t    *pbSpill;
         } LZF;
 #endif
+#ifdef RTZIP_USE_LZ4
+        /** LZ4 'stream'. */
+        struct
+        {
+            /** The spill buffer, see LZF. */
+            uint8_t     abSpill[RTZIPLZ4_MAX_UNCOMPRESSED_DATA_SIZE];
+            /** The number of bytes left spill buffer. */
+            unsigned    cbSpill;
+            /** The current spill buffer position. */
+            uint8_t    *pbSpill;
+        } LZ4;
+#endif
 
     } u;
 } RTZIPDECOM;
@@ -1351,6 +1418,255 @@ static DECLCALLBACK(int) rtZipLZFDecompInit(PRTZIPDECOMP pZip)
 #endif /* RTZIP_USE_LZF */
 
 
+#ifdef RTZIP_USE_LZ4
+
+/**
+ * Compresses one block into the output buffer, flushing it first if there
+ * isn't room for a worst case block.
+ *
+ * @returns iprt status code.
+ * @param   pZip        The compressor instance.
+ * @param   pbBuf       What to compress.
+ * @param   cbBuf       How much to compress, at most
+ *                      RTZIPLZ4_MAX_UNCOMPRESSED_DATA_SIZE.
+ */
+static int rtZipLZ4CompressBlock(PRTZIPCOMP pZip, const uint8_t *pbBuf, size_t cbBuf)
+{
+    Assert(cbBuf > 0 && cbBuf <= RTZIPLZ4_MAX_UNCOMPRESSED_DATA_SIZE);
+    size_t cbFree = sizeof(pZip->abBuffer) - (size_t)(pZip->u.LZ4.pbOutput - &pZip->abBuffer[0]);
+    if (cbFree < sizeof(RTZIPLZ4HDR) + RTZIPLZ4_MAX_UNCOMPRESSED_DATA_SIZE)
+    {
+        size_t cb = (size_t)(pZip->u.LZ4.pbOutput - &pZip->abBuffer[0]);
+        pZip->u.LZ4.pbOutput = &pZip->abBuffer[0];
+        int rc = pZip->pfnOut(pZip->pvUser, &pZip->abBuffer[0], cb);
+        if (RT_FAILURE(rc))
+            return rc;
+    }
+
+    /*
+     * Blocks which don't shrink are stored, so the data never exceeds the
+     * uncompressed size.
+     */
+    uint8_t *pbData = pZip->u.LZ4.pbOutput + sizeof(RTZIPLZ4HDR);
+    uint16_t fFlags = 0;
+    size_t   cbData;
+    int rc = rtZipLz4CompressBlock(pbBuf, cbBuf, pbData, cbBuf - 1, pZip->u.LZ4.fHigh, &cbData);
+    if (rc == VERR_BUFFER_OVERFLOW)
+    {
+        memcpy(pbData, pbBuf, cbBuf);
+        cbData = cbBuf;
+        fFlags = RTZIPLZ4HDR_F_STORED;
+    }
+    else if (RT_FAILURE(rc))
+        return rc;
+
+    RTZIPLZ4HDR Hdr;
+    Hdr.u16Magic       = RT_H2LE_U16(RTZIPLZ4HDR_MAGIC);
+    Hdr.fFlags         = RT_H2LE_U16(fFlags);
+    Hdr.cbData         = RT_H2LE_U16((uint16_t)cbData);
+    Hdr.cbUncompressed = RT_H2LE_U16((uint16_t)cbBuf);
+    memcpy(pZip->u.LZ4.pbOutput, &Hdr, sizeof(Hdr));
+    pZip->u.LZ4.pbOutput = pbData + cbData;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * @copydoc RTZipCompress
+ */
+static DECLCALLBACK(int) rtZipLZ4Compress(PRTZIPCOMP pZip, const void *pvBuf, size_t cbBuf)
+{
+    const uint8_t *pbBuf = (const uint8_t *)pvBuf;
+    while (cbBuf > 0)
+    {
+        /*
+         * Compress whole blocks straight from the caller's buffer when the
+         * input buffer is empty, buffer the rest.
+         */
+        int rc;
+        if (   !pZip->u.LZ4.cbInput
+            && cbBuf >= RTZIPLZ4_MAX_UNCOMPRESSED_DATA_SIZE)
+        {
+            rc = rtZipLZ4CompressBlock(pZip, pbBuf, RTZIPLZ4_MAX_UNCOMPRESSED_DATA_SIZE);
+            if (RT_FAILURE(rc))
+                return rc;
+            pbBuf += RTZIPLZ4_MAX_UNCOMPRESSED_DATA_SIZE;
+            cbBuf -= RTZIPLZ4_MAX_UNCOMPRESSED_DATA_SIZE;
+            continue;
+        }
+
+        size_t cb = RT_MIN(cbBuf, sizeof(pZip->u.LZ4.abInput) - pZip->u.LZ4.cbInput);
+        memcpy(&pZip->u.LZ4.abInput[pZip->u.LZ4.cbInput], pbBuf, cb);
+        pZip->u.LZ4.cbInput += cb;
+        pbBuf += cb;
+        cbBuf -= cb;
+        if (pZip->u.LZ4.cbInput == sizeof(pZip->u.LZ4.abInput))
+        {
+            pZip->u.LZ4.cbInput = 0;
+            rc = rtZipLZ4CompressBlock(pZip, pZip->u.LZ4.abInput, sizeof(pZip->u.LZ4.abInput));
+            if (RT_FAILURE(rc))
+                return rc;
+        }
+    }
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * @copydoc RTZipCompFinish
+ */
+static DECLCALLBACK(int) rtZipLZ4CompFinish(PRTZIPCOMP pZip)
+{
+    if (pZip->u.LZ4.cbInput)
+    {
+        size_t cbInput = pZip->u.LZ4.cbInput;
+        pZip->u.LZ4.cbInput = 0;
+        int rc = rtZipLZ4CompressBlock(pZip, pZip->u.LZ4.abInput, cbInput);
+        if (RT_FAILURE(rc))
+            return rc;
+    }
+
+    size_t cb = (size_t)(pZip->u.LZ4.pbOutput - &pZip->abBuffer[0]);
+    pZip->u.LZ4.pbOutput = &pZip->abBuffer[0];
+    return pZip->pfnOut(pZip->pvUser, &pZip->abBuffer[0], cb);
+}
+
+
+/**
+ * @copydoc RTZipCompDestroy
+ */
+static DECLCALLBACK(int) rtZipLZ4CompDestroy(PRTZIPCOMP pZip)
+{
+    NOREF(pZip);
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Initializes the compressor instance.
+ * @returns iprt status code.
+ * @param   pZip        The compressor instance.
+ * @param   enmLevel    The desired compression level.
+ */
+static DECLCALLBACK(int) rtZipLZ4CompInit(PRTZIPCOMP pZip, RTZIPLEVEL enmLevel)
+{
+    pZip->pfnCompress = rtZipLZ4Compress;
+    pZip->pfnFinish   = rtZipLZ4CompFinish;
+    pZip->pfnDestroy  = rtZipLZ4CompDestroy;
+
+    pZip->u.LZ4.pbOutput = &pZip->abBuffer[1];
+    pZip->u.LZ4.cbInput  = 0;
+    pZip->u.LZ4.fHigh    = enmLevel == RTZIPLEVEL_MAX;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * @copydoc RTZipDecompress
+ */
+static DECLCALLBACK(int) rtZipLZ4Decompress(PRTZIPDECOMP pZip, void *pvBuf, size_t cbBuf, size_t *pcbWritten)
+{
+    /*
+     * Same approach as LZF: read and decode one block at a time, straight
+     * into the user buffer when it fits and into the spill buffer if not.
+     */
+    size_t cbWritten = 0;
+    while (cbBuf > 0)
+    {
+        if (pZip->u.LZ4.cbSpill > 0)
+        {
+            unsigned cb = (unsigned)RT_MIN(pZip->u.LZ4.cbSpill, cbBuf);
+            memcpy(pvBuf, pZip->u.LZ4.pbSpill, cb);
+            pZip->u.LZ4.pbSpill += cb;
+            pZip->u.LZ4.cbSpill -= cb;
+            cbWritten += cb;
+            cbBuf -= cb;
+            if (!cbBuf)
+                break;
+            pvBuf = (uint8_t *)pvBuf + cb;
+        }
+
+        RTZIPLZ4HDR Hdr;
+        int rc = pZip->pfnIn(pZip->pvUser, &Hdr, sizeof(Hdr), NULL);
+        if (RT_FAILURE(rc))
+            return rc;
+        uint16_t const fFlags         = RT_LE2H_U16(Hdr.fFlags);
+        size_t const   cbData         = RT_LE2H_U16(Hdr.cbData);
+        size_t const   cbUncompressed = RT_LE2H_U16(Hdr.cbUncompressed);
+        if (   RT_LE2H_U16(Hdr.u16Magic) != RTZIPLZ4HDR_MAGIC
+            || (fFlags & ~RTZIPLZ4HDR_F_STORED)
+            || !cbData
+            || !cbUncompressed
+            || cbUncompressed > RTZIPLZ4_MAX_UNCOMPRESSED_DATA_SIZE
+            || (fFlags & RTZIPLZ4HDR_F_STORED ? cbData != cbUncompressed : cbData >= cbUncompressed))
+        {
+            AssertMsgFailed(("Invalid LZ4 header! %.*Rhxs\n", sizeof(Hdr), &Hdr));
+            return VERR_ZIP_CORRUPTED;
+        }
+        rc = pZip->pfnIn(pZip->pvUser, &pZip->abBuffer[0], cbData, NULL);
+        if (RT_FAILURE(rc))
+            return rc;
+
+        uint8_t *pbDst = cbUncompressed <= cbBuf ? (uint8_t *)pvBuf : &pZip->u.LZ4.abSpill[0];
+        if (fFlags & RTZIPLZ4HDR_F_STORED)
+            memcpy(pbDst, &pZip->abBuffer[0], cbData);
+        else
+        {
+            size_t cbOutput = 0;
+            rc = rtZipLz4DecompressBlock(&pZip->abBuffer[0], cbData, pbDst, cbUncompressed, &cbOutput);
+            if (RT_FAILURE(rc) || cbOutput != cbUncompressed)
+            {
+                AssertMsgFailed(("Decompression error, rc=%Rrc cbOutput=%#zx cbUncompressed=%#zx\n", rc, cbOutput, cbUncompressed));
+                return VERR_ZIP_CORRUPTED;
+            }
+        }
+
+        if (pbDst == (uint8_t *)pvBuf)
+        {
+            cbBuf -= cbUncompressed;
+            pvBuf = (uint8_t *)pvBuf + cbUncompressed;
+            cbWritten += cbUncompressed;
+        }
+        else
+        {
+            pZip->u.LZ4.pbSpill = &pZip->u.LZ4.abSpill[0];
+            pZip->u.LZ4.cbSpill = (unsigned)cbUncompressed;
+        }
+    }
+
+    if (pcbWritten)
+        *pcbWritten = cbWritten;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * @copydoc RTZipDecompDestroy
+ */
+static DECLCALLBACK(int) rtZipLZ4DecompDestroy(PRTZIPDECOMP pZip)
+{
+    NOREF(pZip);
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Initialize the decompressor instance.
+ * @returns iprt status code.
+ * @param   pZip        The decompressor instance.
+ */
+static DECLCALLBACK(int) rtZipLZ4DecompInit(PRTZIPDECOMP pZip)
+{
+    pZip->pfnDecompress = rtZipLZ4Decompress;
+    pZip->pfnDestroy    = rtZipLZ4DecompDestroy;
+    pZip->u.LZ4.cbSpill = 0;
+    pZip->u.LZ4.pbSpill = NULL;
+    return VINF_SUCCESS;
+}
+
+#endif /* RTZIP_USE_LZ4 */
+
+
 /**
  * Create a compressor instance.
  *
@@ -1437,6 +1753,12 @@ RTDECL(int)     RTZipCompCreate(PRTZIPCOMP *ppZip, void *pvUser, PFNRTZIPOUT pfn
 #endif
             break;
 
+        case RTZIPTYPE_LZ4:
+#ifdef RTZIP_USE_LZ4
+            rc = rtZipLZ4CompInit(pZip, enmLevel);
+#endif
+            break;
+
         case RTZIPTYPE_LZJB:
         case RTZIPTYPE_LZO:
             break;
@@ -1622,6 +1944,14 @@ static int rtzipDecompInit(PRTZIPDECOMP pZip)
 #endif
             break;
 
+        case RTZIPTYPE_LZ4:
+#ifdef RTZIP_USE_LZ4
+            rc = rtZipLZ4DecompInit(pZip);
+#else
+            AssertMsgFailed(("LZ4 is not include in this build!\n"));
+#endif
+            break;
+
         case RTZIPTYPE_LZJB:
 #ifdef RTZIP_USE_LZJB
             AssertMsgFailed(("LZJB streaming support is not implemented yet!\n"));
@@ -1777,6 +2107,13 @@ RTDECL(int) RTZipBlockCompress(RTZIPTYPE enmType, RTZIPLEVEL enmLevel, uint32_t
             break;
         }
 
+        case RTZIPTYPE_LZ4:
+#ifdef RTZIP_USE_LZ4
+            return rtZipLz4CompressBlock(pvSrc, cbSrc, pvDst, cbDst, enmLevel == RTZIPLEVEL_MAX, pcbDstActual);
+#else
+            return VERR_NOT_SUPPORTED;
+#endif
+
         case RTZIPTYPE_LZJB:
         {
 #ifdef RTZIP_USE_LZJB
@@ -1880,6 +2217,23 @@ RTDECL(int) RTZipBlockDecompress(RTZIPTYPE enmType, uint32_t fFlags,
             break;
         }
 
+        case RTZIPTYPE_LZ4:
+        {
+#ifdef RTZIP_USE_LZ4
+            size_t cbDstActual;
+            int rc = rtZipLz4DecompressBlock(pvSrc, cbSrc, pvDst, cbDst, &cbDstActual);
+            if (RT_FAILURE(rc))
+                return rc;
+            if (pcbDstActual)
+                *pcbDstActual = cbDstActual;
+            if (pcbSrcActual)
+                *pcbSrcActual = cbSrc;
+            break;
+#else
+            return VERR_NOT_SUPPORTED;
+#endif
+        }
+
         case RTZIPTYPE_LZJB:
         {
 #ifdef RTZIP_USE_LZJB
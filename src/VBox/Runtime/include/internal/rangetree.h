@@ -0,0 +1,107 @@
+/* $Id$ */
+/** @file
+ * IPRT - Internal header for the B+tree and radix range trees.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+#ifndef ___internal_rangetree_h
+#define ___internal_rangetree_h
+
+#include <iprt/bptree.h>
+#include <iprt/asm.h>
+#include <iprt/thread.h>
+
+RT_C_DECLS_BEGIN
+
+/**
+ * Initializes the read section bookkeeping.
+ *
+ * @param   pRcu        The bookkeeping structure.
+ */
+DECLINLINE(void) rtRangeTreeRcuInit(RTRANGETREERCU *pRcu)
+{
+    pRcu->iEpoch       = 0;
+    pRcu->acReaders[0] = 0;
+    pRcu->acReaders[1] = 0;
+    pRcu->u32Padding   = 0;
+}
+
+
+/**
+ * Enters a read section.
+ *
+ * The reader counts itself in the current epoch and then checks that the
+ * epoch didn't change meanwhile.  If it did, the writer may already have
+ * checked the count, so we back out and try again with the new epoch.
+ *
+ * @returns The epoch the reader is counted in.
+ * @param   pRcu        The bookkeeping structure.
+ */
+DECLINLINE(uint32_t) rtRangeTreeRcuEnter(RTRANGETREERCU *pRcu)
+{
+    for (;;)
+    {
+        uint32_t const iEpoch = ASMAtomicReadU32(&pRcu->iEpoch) & 1;
+        ASMAtomicIncU32(&pRcu->acReaders[iEpoch]);
+        if (RT_LIKELY(ASMAtomicReadU32(&pRcu->iEpoch) == iEpoch))
+            return iEpoch;
+        ASMAtomicDecU32(&pRcu->acReaders[iEpoch]);
+    }
+}
+
+
+/**
+ * Leaves a read section.
+ *
+ * @param   pRcu        The bookkeeping structure.
+ * @param   iEpoch      The rtRangeTreeRcuEnter return value.
+ */
+DECLINLINE(void) rtRangeTreeRcuLeave(RTRANGETREERCU *pRcu, uint32_t iEpoch)
+{
+    Assert(iEpoch <= 1);
+    ASMAtomicDecU32(&pRcu->acReaders[iEpoch & 1]);
+}
+
+
+/**
+ * Waits for all readers that might have seen the tree before the last change
+ * was published to leave their read sections.
+ *
+ * Called by the writer (writers are serialized by the caller) after
+ * publishing a change and before freeing the memory it replaced.  Readers
+ * entering after the epoch flip see the new tree, so only the count of the
+ * old epoch has to drain.
+ *
+ * @param   pRcu        The bookkeeping structure.
+ */
+DECLINLINE(void) rtRangeTreeRcuSynchronize(RTRANGETREERCU *pRcu)
+{
+    uint32_t const iOldEpoch = ASMAtomicXchgU32(&pRcu->iEpoch, (ASMAtomicReadU32(&pRcu->iEpoch) & 1) ^ 1) & 1;
+    while (ASMAtomicReadU32(&pRcu->acReaders[iOldEpoch]) != 0)
+        RTThreadYield();
+}
+
+RT_C_DECLS_END
+
+#endif
+
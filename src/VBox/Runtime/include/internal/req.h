@@ -77,6 +77,11 @@ struct RTREQ
 
     /** Pointer to the next request in the chain. */
     struct RTREQ * volatile pNext;
+    /** LIFO of requests to submit when this one completes, see
+     * RTReqPoolCallAfterEx.  Set to RTREQ_CONTINUATIONS_DONE on completion. */
+    struct RTREQ * volatile pContinuations;
+    /** Pointer to the next request in the continuation LIFO. */
+    struct RTREQ           *pNextContinuation;
 
     union
     {
@@ -115,6 +120,10 @@ struct RTREQ
     } u;
 };
 
+/** RTREQ::pContinuations value indicating that the request has completed and
+ * that continuations must be submitted directly. */
+#define RTREQ_CONTINUATIONS_DONE    ((struct RTREQ *)~(uintptr_t)0)
+
 /** Internal request representation. */
 typedef RTREQ       RTREQINT;
 /** Pointer to an internal request representation. */
@@ -163,6 +172,8 @@ DECLHIDDEN(void) rtReqQueueSubmit(PRTREQQUEUEINT pQueue, PRTREQINT pReq);
 DECLHIDDEN(void) rtReqPoolSubmit(PRTREQPOOLINT pPool, PRTREQINT pReq);
 DECLHIDDEN(bool) rtReqQueueRecycle(PRTREQQUEUEINT pQueue, PRTREQINT pReq);
 DECLHIDDEN(bool) rtReqPoolRecycle(PRTREQPOOLINT pPool, PRTREQINT pReq);
+DECLHIDDEN(void) rtReqPoolRunContinuations(PRTREQINT pReq);
+DECLHIDDEN(void) rtReqPoolHelpWhileWaiting(PRTREQINT pReq);
 
 RT_C_DECLS_END
 
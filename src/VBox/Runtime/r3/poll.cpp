@@ -42,6 +42,10 @@
 # include <limits.h>
 # include <errno.h>
 # include <sys/poll.h>
+# ifdef RT_OS_LINUX
+#  include <sys/epoll.h>
+#  include <unistd.h>
+# endif
 #endif
 
 #include <iprt/poll.h>
@@ -72,6 +76,12 @@
  *          this restriction later if it becomes necessary. */
 #define RTPOLL_SET_MAX     64
 
+/** @def RTPOLL_WITH_EPOLL
+ * Use epoll on Linux.  The descriptors are registered with the kernel when
+ * they are added to the set instead of being passed in on every wait. */
+#if defined(RT_OS_LINUX) || defined(DOXYGEN_RUNNING)
+# define RTPOLL_WITH_EPOLL
+#endif
 
 
 /*********************************************************************************************************************************
@@ -135,8 +145,14 @@ typedef struct RTPOLLSETINTERNAL
     /** Pointer to an array of native handles. */
     PRTHCINTPTR         pahNative;
 #else
-    /** Pointer to an array of pollfd structures. */
+    /** Pointer to an array of pollfd structures.
+     * This is maintained also when using epoll, as it is the fallback and we
+     * use it for validating new handles. */
     struct pollfd      *paPollFds;
+# ifdef RTPOLL_WITH_EPOLL
+    /** The epoll descriptor, -1 if not available (poll() is then used). */
+    int                 hEpoll;
+# endif
 #endif
     /** Pointer to an array of handles and IDs. */
     PRTPOLLSETHNDENT    paHandles;
@@ -144,6 +160,194 @@ typedef struct RTPOLLSETINTERNAL
 
 
 
+#if !defined(RT_OS_WINDOWS) && !defined(RT_OS_OS2)
+
+/**
+ * Converts poll revents to RTPOLL_EVT_XXX.
+ *
+ * @returns RTPOLL_EVT_XXX mask.
+ * @param   fRevents    The poll revents (epoll events use the same values on
+ *                      Linux).
+ */
+static uint32_t rtPollPosixToRtEvents(uint32_t fRevents)
+{
+    uint32_t fEvents = 0;
+    if (fRevents & (POLLIN
+# ifdef POLLRDNORM
+                    | POLLRDNORM     /* just in case */
+# endif
+# ifdef POLLRDBAND
+                    | POLLRDBAND     /* ditto */
+# endif
+# ifdef POLLPRI
+                    | POLLPRI        /* ditto */
+# endif
+# ifdef POLLMSG
+                    | POLLMSG        /* ditto */
+# endif
+# ifdef POLLWRITE
+                    | POLLWRITE       /* ditto */
+# endif
+# ifdef POLLEXTEND
+                    | POLLEXTEND      /* ditto */
+# endif
+                    )
+       )
+        fEvents |= RTPOLL_EVT_READ;
+
+    if (fRevents & (POLLOUT
+# ifdef POLLWRNORM
+                    | POLLWRNORM     /* just in case */
+# endif
+# ifdef POLLWRBAND
+                    | POLLWRBAND     /* ditto */
+# endif
+                    )
+       )
+        fEvents |= RTPOLL_EVT_WRITE;
+
+    if (fRevents & (POLLERR | POLLHUP | POLLNVAL
+# ifdef POLLRDHUP
+                    | POLLRDHUP
+# endif
+                    )
+       )
+        fEvents |= RTPOLL_EVT_ERROR;
+
+    return fEvents;
+}
+
+#endif /* POSIX */
+#ifdef RTPOLL_WITH_EPOLL
+
+AssertCompile(EPOLLIN == POLLIN);
+AssertCompile(EPOLLOUT == POLLOUT);
+AssertCompile(EPOLLERR == POLLERR);
+AssertCompile(EPOLLHUP == POLLHUP);
+
+
+/**
+ * Stops using epoll for the set, falling back on poll().
+ *
+ * @param   pThis       The poll set instance.
+ */
+static void rtPollSetLinuxDropEpoll(RTPOLLSETINTERNAL *pThis)
+{
+    if (pThis->hEpoll >= 0)
+    {
+        close(pThis->hEpoll);
+        pThis->hEpoll = -1;
+    }
+}
+
+
+/**
+ * Updates the epoll registration of a descriptor after a handle entry using it
+ * was added, removed or changed.
+ *
+ * A descriptor can only be registered once, so when it's entered more than
+ * once the union of the events is registered.  Should the kernel refuse the
+ * descriptor, we quietly fall back on poll() for the whole set.
+ *
+ * @param   pThis       The poll set instance.
+ * @param   cHandles    The number of handle entries to consider (the new
+ *                      entry isn't committed when adding).
+ * @param   fd          The descriptor.
+ */
+static void rtPollSetLinuxEpollSync(RTPOLLSETINTERNAL *pThis, uint32_t cHandles, int fd)
+{
+    if (pThis->hEpoll < 0)
+        return;
+
+    struct epoll_event Evt;
+    RT_ZERO(Evt);
+    Evt.data.fd = fd;
+    bool fInUse = false;
+    for (uint32_t j = 0; j < cHandles; j++)
+        if (pThis->paPollFds[j].fd == fd)
+        {
+            Evt.events |= (uint16_t)pThis->paPollFds[j].events;
+            fInUse = true;
+        }
+
+    int rc;
+    if (!fInUse)
+    {
+        /* The descriptor may already be closed, in which case it's gone from the set. */
+        rc = epoll_ctl(pThis->hEpoll, EPOLL_CTL_DEL, fd, &Evt);
+        Assert(rc == 0 || errno == ENOENT || errno == EBADF);
+        return;
+    }
+
+    rc = epoll_ctl(pThis->hEpoll, EPOLL_CTL_MOD, fd, &Evt);
+    if (rc != 0 && errno == ENOENT)
+        rc = epoll_ctl(pThis->hEpoll, EPOLL_CTL_ADD, fd, &Evt);
+    if (rc != 0)
+        rtPollSetLinuxDropEpoll(pThis);
+}
+
+
+/**
+ * The epoll variant of the POSIX part of rtPollNoResumeWorker.
+ *
+ * The descriptors are registered level-triggered, so the kernel rechecks
+ * their state before reporting them just like poll() does, and a single call
+ * retrieves all the ready ones.  Like with poll(), the first ready entry in
+ * the set is the one returned.
+ *
+ * @returns IPRT status code.
+ * @retval  VERR_TRY_AGAIN if epoll was dropped for the set and the caller
+ *          should use poll() instead.
+ * @param   pThis       The poll set instance.
+ * @param   cMillies    The timeout.
+ * @param   pfEvents    Where to return the events, optional.
+ * @param   pid         Where to return the handle ID, optional.
+ */
+static int rtPollLinuxEpollWorker(RTPOLLSETINTERNAL *pThis, RTMSINTERVAL cMillies, uint32_t *pfEvents, uint32_t *pid)
+{
+    struct epoll_event aEvents[RTPOLL_SET_MAX];
+    int cEvents = epoll_wait(pThis->hEpoll, aEvents, RT_ELEMENTS(aEvents),
+                             cMillies == RT_INDEFINITE_WAIT || cMillies >= INT_MAX
+                             ? -1
+                             : (int)cMillies);
+    if (cEvents == 0)
+        return VERR_TIMEOUT;
+    if (cEvents < 0)
+        return RTErrConvertFromErrno(errno);
+
+    /*
+     * Find the first handle entry interested in one of the events.  Entries
+     * sharing a descriptor may be interested in different events.
+     */
+    uint32_t const cHandles = pThis->cHandles;
+    for (uint32_t i = 0; i < cHandles; i++)
+    {
+        int const      fd       = pThis->paPollFds[i].fd;
+        uint32_t const fWanted  = (uint16_t)pThis->paPollFds[i].events | POLLERR | POLLHUP;
+        for (int iEvt = 0; iEvt < cEvents; iEvt++)
+            if (   aEvents[iEvt].data.fd == fd
+                && (aEvents[iEvt].events & fWanted))
+            {
+                if (pfEvents)
+                    *pfEvents = rtPollPosixToRtEvents(aEvents[iEvt].events & fWanted);
+                if (pid)
+                    *pid = pThis->paHandles[i].id;
+                return VINF_SUCCESS;
+            }
+    }
+
+    /*
+     * Nobody was interested in the events.  This is a stale registration of a
+     * descriptor closed before it was removed from the set while a duplicate
+     * keeps it open.  It stays ready, so retrying would spin.  Let poll()
+     * report it as invalid instead, like before epoll.
+     */
+    rtPollSetLinuxDropEpoll(pThis);
+    return VERR_TRY_AGAIN;
+}
+
+#endif /* RTPOLL_WITH_EPOLL */
+
 /**
  * Common worker for RTPoll and RTPollNoResume
  */
@@ -357,6 +561,15 @@ static int rtPollNoResumeWorker(RTPOLLSETINTERNAL *pThis, uint64_t MsStart, RTMS
 
     RT_NOREF_PV(MsStart);
 
+# ifdef RTPOLL_WITH_EPOLL
+    if (pThis->hEpoll >= 0)
+    {
+        rc = rtPollLinuxEpollWorker(pThis, cMillies, pfEvents, pid);
+        if (rc != VERR_TRY_AGAIN)
+            return rc;
+    }
+# endif
+
     /* clear the revents. */
     uint32_t i = pThis->cHandles;
     while (i-- > 0)
@@ -374,50 +587,7 @@ static int rtPollNoResumeWorker(RTPOLLSETINTERNAL *pThis, uint64_t MsStart, RTMS
         if (pThis->paPollFds[i].revents)
         {
             if (pfEvents)
-            {
-                *pfEvents = 0;
-                if (pThis->paPollFds[i].revents & (POLLIN
-# ifdef POLLRDNORM
-                                                   | POLLRDNORM     /* just in case */
-# endif
-# ifdef POLLRDBAND
-                                                   | POLLRDBAND     /* ditto */
-# endif
-# ifdef POLLPRI
-                                                   | POLLPRI        /* ditto */
-# endif
-# ifdef POLLMSG
-                                                   | POLLMSG        /* ditto */
-# endif
-# ifdef POLLWRITE
-                                                   | POLLWRITE       /* ditto */
-# endif
-# ifdef POLLEXTEND
-                                                   | POLLEXTEND      /* ditto */
-# endif
-                                                   )
-                   )
-                    *pfEvents |= RTPOLL_EVT_READ;
-
-                if (pThis->paPollFds[i].revents & (POLLOUT
-# ifdef POLLWRNORM
-                                                   | POLLWRNORM     /* just in case */
-# endif
-# ifdef POLLWRBAND
-                                                   | POLLWRBAND     /* ditto */
-# endif
-                                                   )
-                   )
-                    *pfEvents |= RTPOLL_EVT_WRITE;
-
-                if (pThis->paPollFds[i].revents & (POLLERR | POLLHUP | POLLNVAL
-# ifdef POLLRDHUP
-                                                   | POLLRDHUP
-# endif
-                                                   )
-                   )
-                *pfEvents |= RTPOLL_EVT_ERROR;
-            }
+                *pfEvents = rtPollPosixToRtEvents((uint16_t)pThis->paPollFds[i].revents);
             if (pid)
                 *pid = pThis->paHandles[i].id;
             return VINF_SUCCESS;
@@ -526,6 +696,9 @@ RTDECL(int) RTPollSetCreate(PRTPOLLSET phPollSet)
     pThis->pahNative            = NULL;
 #else
     pThis->paPollFds            = NULL;
+# ifdef RTPOLL_WITH_EPOLL
+    pThis->hEpoll               = epoll_create1(EPOLL_CLOEXEC); /* -1 (ENOSYS) on old kernels -> poll(). */
+# endif
 #endif
     pThis->paHandles            = NULL;
     pThis->u32Magic             = RTPOLLSET_MAGIC;
@@ -558,6 +731,9 @@ RTDECL(int) RTPollSetDestroy(RTPOLLSET hPollSet)
 #else
     RTMemFree(pThis->paPollFds);
     pThis->paPollFds = NULL;
+# ifdef RTPOLL_WITH_EPOLL
+    rtPollSetLinuxDropEpoll(pThis);
+# endif
 #endif
     RTMemFree(pThis->paHandles);
     pThis->paHandles = NULL;
@@ -865,6 +1041,10 @@ RTDECL(int) RTPollSetAdd(RTPOLLSET hPollSet, PCRTHANDLE pHandle, uint32_t fEvent
                 rc = RTErrConvertFromErrno(errno);
                 pThis->paPollFds[i].fd = -1;
             }
+# ifdef RTPOLL_WITH_EPOLL
+            else
+                rtPollSetLinuxEpollSync(pThis, i + 1, (int)hNative);
+# endif
 #endif /* POSIX */
 
             if (RT_SUCCESS(rc))
@@ -910,6 +1090,8 @@ RTDECL(int) RTPollSetRemove(RTPOLLSET hPollSet, uint32_t id)
 #ifdef RT_OS_OS2
             uint32_t            fRemovedEvents  = pThis->paHandles[i].fEvents;
             RTHCINTPTR const    hNative         = pThis->pahNative[i];
+#elif defined(RTPOLL_WITH_EPOLL)
+            int const           fdRemoved       = pThis->paPollFds[i].fd;
 #endif
 
             /* Remove the entry. */
@@ -966,7 +1148,9 @@ RTDECL(int) RTPollSetRemove(RTPOLLSET hPollSet, uint32_t id)
                 if (fRemovedEvents & RTPOLL_EVT_READ)
                     rtPollSetOs2RemoveSocket(pThis, 0, &pThis->cReadSockets, (int)hNative);
             }
-#endif /* RT_OS_OS2 */
+#elif defined(RTPOLL_WITH_EPOLL)
+            rtPollSetLinuxEpollSync(pThis, pThis->cHandles, fdRemoved);
+#endif /* RTPOLL_WITH_EPOLL */
             rc = VINF_SUCCESS;
             break;
         }
@@ -1100,6 +1284,9 @@ RTDECL(int) RTPollSetEventsChange(RTPOLLSET hPollSet, uint32_t id, uint32_t fEve
                     pThis->paPollFds[i].events |= POLLOUT;
                 if (fEvents & RTPOLL_EVT_ERROR)
                     pThis->paPollFds[i].events |= POLLERR;
+# ifdef RTPOLL_WITH_EPOLL
+                rtPollSetLinuxEpollSync(pThis, pThis->cHandles, pThis->paPollFds[i].fd);
+# endif
 #endif
                 pThis->paHandles[i].fEvents = fEvents;
             }
@@ -31,13 +31,114 @@
 #include <iprt/log.h>
 #include <iprt/initterm.h>
 #include <iprt/err.h>
+#include <iprt/file.h>
+#include <iprt/path.h>
+#include <iprt/process.h>
+#include <iprt/string.h>
+#include <iprt/test.h>
 
 #include <stdio.h>
 
+
+/**
+ * @callback_method_impl{FNRTLOGPHASE, No header or footer, only the messages.}
+ */
+static DECLCALLBACK(void) tstLogPhase(PRTLOGGER pLogger, RTLOGPHASE enmLogPhase, PFNRTLOGPHASEMSG pfnLogPhaseMsg)
+{
+    RT_NOREF3(pLogger, enmLogPhase, pfnLogPhaseMsg);
+}
+
+
+/**
+ * Logs a message to @ pLogger and appends the RTStrPrintf formatted text to
+ * the expected output.
+ */
+static void tstLogBinaryMsg(PRTLOGGER pLogger, char *pszExpect, size_t cbExpect, const char *pszFormat, ...)
+{
+    va_list va;
+    va_start(va, pszFormat);
+    size_t const cchExpect = strlen(pszExpect);
+    RTStrPrintfV(&pszExpect[cchExpect], cbExpect - cchExpect, pszFormat, va);
+    va_end(va);
+
+    va_start(va, pszFormat);
+    RTLogLoggerExV(pLogger, 0, ~0U, pszFormat, va);
+    va_end(va);
+}
+
+
+/**
+ * Checks that binary mode produces the same text as immediate formatting,
+ * also after the format strings have gone away.
+ */
+static void tstLogBinary(RTTEST hTest)
+{
+    RTTestSub(hTest, "binary");
+
+    char szPath[RTPATH_MAX];
+    RTTESTI_CHECK_RC_RETV(RTPathTemp(szPath, sizeof(szPath)), VINF_SUCCESS);
+    char szName[64];
+    RTStrPrintf(szName, sizeof(szName), "tstLog-binary-%u.log", RTProcSelf());
+    RTTESTI_CHECK_RC_RETV(RTPathAppend(szPath, sizeof(szPath), szName), VINF_SUCCESS);
+
+    PRTLOGGER pLogger;
+    int rc = RTLogCreateEx(&pLogger, RTLOGFLAGS_BINARY, NULL, NULL, 0, NULL, RTLOGDEST_FILE, tstLogPhase,
+                           0 /*cHistory*/, 0 /*cbHistoryFileMax*/, 0 /*cSecsHistoryTimeSlot*/, NULL, 0, "%s", szPath);
+    RTTESTI_CHECK_RC_RETV(rc, VINF_SUCCESS);
+
+    static char     s_szExpect[_16K];
+    static uint8_t  s_au8Hex[16];
+    for (unsigned iHex = 0; iHex < sizeof(s_au8Hex); iHex++)
+        s_au8Hex[iHex] = (uint8_t)iHex;
+    s_szExpect[0] = '\0';
+
+    tstLogBinaryMsg(pLogger, s_szExpect, sizeof(s_szExpect), "%%Rrc %d: %Rrc\n", VERR_INVALID_PARAMETER, VERR_INVALID_PARAMETER);
+    tstLogBinaryMsg(pLogger, s_szExpect, sizeof(s_szExpect), "%%s: '%s' '%10s' '%-10s' '%.3s' '%*.*s' '%s'\n",
+                    "string", "right", "left", "truncated", -8, 4, "star", (const char *)NULL);
+    tstLogBinaryMsg(pLogger, s_szExpect, sizeof(s_szExpect), "%%d/%%x: %d %u %#x %08x %lld %#llx %zu %p\n",
+                    -42, 42U, 0x42U, 0x42U, (long long)-_1T, (unsigned long long)_1E, sizeof(s_au8Hex), &s_au8Hex[0]);
+    tstLogBinaryMsg(pLogger, s_szExpect, sizeof(s_szExpect), "%%RX32/%%RU64/%%RGp: %RX32 %RU64 %RGp\n",
+                    _2G32, _2E, (RTGCPHYS)0x87654321);
+    tstLogBinaryMsg(pLogger, s_szExpect, sizeof(s_szExpect), "%%.8Rhxs (immediate): %.8Rhxs\n", &s_au8Hex[0]);
+
+    /* The format string must be copied, the original may be gone (module
+       unloaded) by the time the flusher formats the record. */
+    char szFormat[64];
+    for (unsigned i = 0; i < 8; i++)
+    {
+        RTStrPrintf(szFormat, sizeof(szFormat), "transient #%u: %%u '%%s'\n", i);
+        tstLogBinaryMsg(pLogger, s_szExpect, sizeof(s_szExpect), szFormat, i * 3, "arg");
+        memset(szFormat, 'x', sizeof(szFormat) - 1);
+    }
+
+    RTLogFlush(pLogger);
+    RTTESTI_CHECK_RC(RTLogDestroy(pLogger), VINF_SUCCESS);
+
+    void   *pvFile = NULL;
+    size_t  cbFile = 0;
+    rc = RTFileReadAll(szPath, &pvFile, &cbFile);
+    RTTESTI_CHECK_RC(rc, VINF_SUCCESS);
+    if (RT_SUCCESS(rc))
+    {
+        if (   cbFile != strlen(s_szExpect)
+            || memcmp(pvFile, s_szExpect, cbFile))
+            RTTestFailed(hTest, "Binary log output mismatch:\n--- got (%zu bytes) ---\n%.*s--- expected (%zu bytes) ---\n%s",
+                         cbFile, (int)cbFile, (const char *)pvFile, strlen(s_szExpect), s_szExpect);
+        RTFileReadAllFree(pvFile, cbFile);
+    }
+    RTFileDelete(szPath);
+}
+
+
 int main()
 {
-    RTR3InitExeNoArguments(0);
-    printf("tstLog: Requires manual inspection of the log output!\n");
+    RTTEST hTest;
+    RTEXITCODE rcExit = RTTestInitAndCreate("tstLog", &hTest);
+    if (rcExit != RTEXITCODE_SUCCESS)
+        return rcExit;
+    RTTestBanner(hTest);
+
+    RTTestPrintf(hTest, RTTESTLVL_ALWAYS, "The default logger output requires manual inspection!\n");
     RTLogPrintf("%%Rrc %d: %Rrc\n", VERR_INVALID_PARAMETER, VERR_INVALID_PARAMETER);
     RTLogPrintf("%%Rrs %d: %Rrs\n", VERR_INVALID_PARAMETER, VERR_INVALID_PARAMETER);
     RTLogPrintf("%%Rrf %d: %Rrf\n", VERR_INVALID_PARAMETER, VERR_INVALID_PARAMETER);
@@ -80,6 +181,7 @@ int main()
 
     RTLogFlush(NULL);
 
-    return 0;
-}
+    tstLogBinary(hTest);
 
+    return RTTestSummaryAndDestroy(hTest);
+}
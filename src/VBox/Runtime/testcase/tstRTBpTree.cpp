@@ -0,0 +1,642 @@
+/* $Id$ */
+/** @file
+ * IPRT Testcase - B+tree and radix range trees.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include <iprt/bptree.h>
+
+#include <iprt/asm.h>
+#include <iprt/avl.h>
+#include <iprt/err.h>
+#include <iprt/mem.h>
+#include <iprt/rand.h>
+#include <iprt/string.h>
+#include <iprt/test.h>
+#include <iprt/thread.h>
+#include <iprt/time.h>
+
+
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** The key granularity used for all ranges (the radix tree requires it). */
+#define TST_SHIFT           12
+/** The number of ranges in the random tests. */
+#define TST_RANGES          2048
+/** The number of ranges in the benchmark. */
+#define TST_BENCH_RANGES    _64K
+/** The number of lookups in the benchmark. */
+#define TST_BENCH_LOOKUPS   _1M
+
+
+/*********************************************************************************************************************************
+*   Structures and Typedefs                                                                                                      *
+*********************************************************************************************************************************/
+/**
+ * A range, in the tree being tested and the reference AVL tree.
+ */
+typedef struct TSTRANGE
+{
+    RTRANGEU64NODECORE  Core;
+    AVLRU64NODECORE     Avl;
+    bool                fInTree;
+} TSTRANGE;
+/** Pointer to a test range. */
+typedef TSTRANGE *PTSTRANGE;
+
+/**
+ * The tree under test.
+ */
+typedef struct TSTTREE
+{
+    /** Set for the radix tree, clear for the B+tree. */
+    bool                fRadix;
+    union
+    {
+        RTBPTREEU64     BpTree;
+        RTRADIXTREEU64  Radix;
+    } u;
+} TSTTREE;
+/** Pointer to the tree under test. */
+typedef TSTTREE *PTSTTREE;
+
+/**
+ * Reader thread arguments for the lockless test.
+ */
+typedef struct TSTREADERARGS
+{
+    PTSTTREE            pTree;
+    PTSTRANGE           paStable;
+    uint32_t            cStable;
+    uint32_t            cChurned;
+    bool volatile       fStop;
+    uint32_t volatile   cLookups;
+    uint32_t volatile   cErrors;
+} TSTREADERARGS;
+
+
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
+static RTTEST       g_hTest;
+static RTRAND       g_hRand;
+/** The test ranges. */
+static TSTRANGE     g_aRanges[TST_RANGES];
+
+
+/*
+ * Thin wrappers so the same tests can be run on both trees.
+ */
+
+static int tstInit(PTSTTREE pTree, bool fRadix, uint32_t fFlags)
+{
+    pTree->fRadix = fRadix;
+    return fRadix ? RTRadixTreeU64Init(&pTree->u.Radix, TST_SHIFT, fFlags) : RTBpTreeU64Init(&pTree->u.BpTree, fFlags);
+}
+
+static int tstInsert(PTSTTREE pTree, PTSTRANGE pRange)
+{
+    return pTree->fRadix ? RTRadixTreeU64Insert(&pTree->u.Radix, &pRange->Core) : RTBpTreeU64Insert(&pTree->u.BpTree, &pRange->Core);
+}
+
+static PTSTRANGE tstFromCore(PRTRANGEU64NODECORE pCore)
+{
+    return pCore ? RT_FROM_MEMBER(pCore, TSTRANGE, Core) : NULL;
+}
+
+static PTSTRANGE tstFromAvl(PAVLRU64NODECORE pAvl)
+{
+    return pAvl ? RT_FROM_MEMBER(pAvl, TSTRANGE, Avl) : NULL;
+}
+
+static PTSTRANGE tstRemove(PTSTTREE pTree, uint64_t Key)
+{
+    return tstFromCore(pTree->fRadix ? RTRadixTreeU64Remove(&pTree->u.Radix, Key) : RTBpTreeU64Remove(&pTree->u.BpTree, Key));
+}
+
+static PTSTRANGE tstRangeRemove(PTSTTREE pTree, uint64_t Key)
+{
+    return tstFromCore(pTree->fRadix ? RTRadixTreeU64RangeRemove(&pTree->u.Radix, Key) : RTBpTreeU64RangeRemove(&pTree->u.BpTree, Key));
+}
+
+static PTSTRANGE tstGet(PTSTTREE pTree, uint64_t Key)
+{
+    return tstFromCore(pTree->fRadix ? RTRadixTreeU64Get(&pTree->u.Radix, Key) : RTBpTreeU64Get(&pTree->u.BpTree, Key));
+}
+
+static PTSTRANGE tstRangeGet(PTSTTREE pTree, uint64_t Key)
+{
+    return tstFromCore(pTree->fRadix ? RTRadixTreeU64RangeGet(&pTree->u.Radix, Key) : RTBpTreeU64RangeGet(&pTree->u.BpTree, Key));
+}
+
+static PTSTRANGE tstGetBestFit(PTSTTREE pTree, uint64_t Key, bool fAbove)
+{
+    return tstFromCore(pTree->fRadix ? RTRadixTreeU64GetBestFit(&pTree->u.Radix, Key, fAbove)
+                                     : RTBpTreeU64GetBestFit(&pTree->u.BpTree, Key, fAbove));
+}
+
+static size_t tstCount(PTSTTREE pTree)
+{
+    return pTree->fRadix ? pTree->u.Radix.cNodes : pTree->u.BpTree.cNodes;
+}
+
+static int tstDoWithAll(PTSTTREE pTree, bool fFromLeft, PFNRTRANGEU64CALLBACK pfnCallback, void *pvUser)
+{
+    return pTree->fRadix ? RTRadixTreeU64DoWithAll(&pTree->u.Radix, fFromLeft, pfnCallback, pvUser)
+                         : RTBpTreeU64DoWithAll(&pTree->u.BpTree, fFromLeft, pfnCallback, pvUser);
+}
+
+static int tstDestroy(PTSTTREE pTree, PFNRTRANGEU64CALLBACK pfnCallback, void *pvUser)
+{
+    return pTree->fRadix ? RTRadixTreeU64Destroy(&pTree->u.Radix, pfnCallback, pvUser)
+                         : RTBpTreeU64Destroy(&pTree->u.BpTree, pfnCallback, pvUser);
+}
+
+static uint32_t tstReadEnter(PTSTTREE pTree)
+{
+    return pTree->fRadix ? RTRadixTreeU64ReadEnter(&pTree->u.Radix) : RTBpTreeU64ReadEnter(&pTree->u.BpTree);
+}
+
+static void tstReadLeave(PTSTTREE pTree, uint32_t uToken)
+{
+    if (pTree->fRadix)
+        RTRadixTreeU64ReadLeave(&pTree->u.Radix, uToken);
+    else
+        RTBpTreeU64ReadLeave(&pTree->u.BpTree, uToken);
+}
+
+
+/**
+ * Makes up a random granularity aligned range.
+ *
+ * Most ranges are small and in the low 64GB, some are large and a few sit at
+ * the very top of the key space.
+ */
+static void tstRandomRange(uint64_t *pKey, uint64_t *pKeyLast)
+{
+    uint32_t const uKind   = RTRandAdvU32Ex(g_hRand, 0, 99);
+    uint64_t       cPages  = uKind < 90 ? RTRandAdvU32Ex(g_hRand, 1, 16) : RTRandAdvU32Ex(g_hRand, 17, _256K);
+    uint64_t       iPage;
+    if (uKind < 97)
+        iPage = RTRandAdvU64Ex(g_hRand, 0, _16M);
+    else
+    {
+        cPages = RTRandAdvU32Ex(g_hRand, 1, 64);
+        iPage  = (UINT64_MAX >> TST_SHIFT) - RTRandAdvU32Ex(g_hRand, 0, 256);
+    }
+    uint64_t const iPageLast = (UINT64_MAX >> TST_SHIFT) - iPage >= cPages - 1 ? iPage + cPages - 1 : UINT64_MAX >> TST_SHIFT;
+    *pKey     = iPage << TST_SHIFT;
+    *pKeyLast = (iPageLast << TST_SHIFT) | (RT_BIT_64(TST_SHIFT) - 1);
+}
+
+
+/**
+ * Gets a key for lookups, usually within or next to a range.
+ */
+static uint64_t tstRandomKey(void)
+{
+    PTSTRANGE pRange = &g_aRanges[RTRandAdvU32Ex(g_hRand, 0, TST_RANGES - 1)];
+    switch (RTRandAdvU32Ex(g_hRand, 0, 5))
+    {
+        case 0:  return pRange->Core.Key;
+        case 1:  return pRange->Core.KeyLast;
+        case 2:  return pRange->Core.Key - 1;
+        case 3:  return pRange->Core.KeyLast + 1;
+        case 4:  return pRange->Core.Key + RTRandAdvU64Ex(g_hRand, 0, pRange->Core.KeyLast - pRange->Core.Key);
+        default: return RTRandAdvU64(g_hRand);
+    }
+}
+
+
+/** Collects the ranges in callback order. */
+typedef struct TSTCOLLECT
+{
+    PTSTRANGE  *papRanges;
+    uint32_t    cRanges;
+    uint32_t    cMax;
+} TSTCOLLECT;
+
+static DECLCALLBACK(int) tstCollectCallback(PRTRANGEU64NODECORE pNode, void *pvUser)
+{
+    TSTCOLLECT *pCollect = (TSTCOLLECT *)pvUser;
+    if (pCollect->cRanges >= pCollect->cMax)
+        return VERR_BUFFER_OVERFLOW;
+    pCollect->papRanges[pCollect->cRanges++] = tstFromCore(pNode);
+    return VINF_SUCCESS;
+}
+
+static DECLCALLBACK(int) tstCollectAvlCallback(PAVLRU64NODECORE pNode, void *pvUser)
+{
+    TSTCOLLECT *pCollect = (TSTCOLLECT *)pvUser;
+    if (pCollect->cRanges >= pCollect->cMax)
+        return VERR_BUFFER_OVERFLOW;
+    pCollect->papRanges[pCollect->cRanges++] = tstFromAvl(pNode);
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Checks that enumerating the tree in all the ways matches the reference.
+ */
+static void tstCheckEnum(PTSTTREE pTree, PAVLRU64TREE pAvlTree)
+{
+    static PTSTRANGE s_apExpect[TST_RANGES];
+    static PTSTRANGE s_apActual[TST_RANGES];
+    TSTCOLLECT Expect = { s_apExpect, 0, TST_RANGES };
+    RTTESTI_CHECK_RC_RETV(RTAvlrU64DoWithAll(pAvlTree, true /*fFromLeft*/, tstCollectAvlCallback, &Expect), VINF_SUCCESS);
+    RTTESTI_CHECK(tstCount(pTree) == Expect.cRanges);
+
+    TSTCOLLECT Actual = { s_apActual, 0, TST_RANGES };
+    RTTESTI_CHECK_RC_RETV(tstDoWithAll(pTree, true /*fFromLeft*/, tstCollectCallback, &Actual), VINF_SUCCESS);
+    RTTESTI_CHECK_RETV(Actual.cRanges == Expect.cRanges);
+    RTTESTI_CHECK_RETV(!memcmp(s_apActual, s_apExpect, Expect.cRanges * sizeof(s_apExpect[0])));
+
+    Actual.cRanges = 0;
+    RTTESTI_CHECK_RC_RETV(tstDoWithAll(pTree, false /*fFromLeft*/, tstCollectCallback, &Actual), VINF_SUCCESS);
+    RTTESTI_CHECK_RETV(Actual.cRanges == Expect.cRanges);
+    for (uint32_t i = 0; i < Expect.cRanges; i++)
+        RTTESTI_CHECK_RETV(s_apActual[i] == s_apExpect[Expect.cRanges - 1 - i]);
+
+    /* The iterators, starting in the middle of things. */
+    uint32_t const   iStart = Expect.cRanges ? RTRandAdvU32Ex(g_hRand, 0, Expect.cRanges - 1) : 0;
+    uint64_t const   uStart = Expect.cRanges ? s_apExpect[iStart]->Core.Key : 0;
+    uint32_t         i      = iStart;
+    PTSTRANGE        pRange;
+    if (pTree->fRadix)
+    {
+        RTRADIXTREEU64ITER Iter;
+        RTRadixTreeU64IterInit(&Iter, uStart);
+        while ((pRange = tstFromCore(RTRadixTreeU64IterNext(&pTree->u.Radix, &Iter))) != NULL)
+            RTTESTI_CHECK_RETV(i < Expect.cRanges && pRange == s_apExpect[i++]);
+    }
+    else
+    {
+        RTBPTREEU64ITER Iter;
+        RTBpTreeU64IterInit(&Iter, uStart);
+        while ((pRange = tstFromCore(RTBpTreeU64IterNext(&pTree->u.BpTree, &Iter))) != NULL)
+            RTTESTI_CHECK_RETV(i < Expect.cRanges && pRange == s_apExpect[i++]);
+    }
+    RTTESTI_CHECK(i == Expect.cRanges);
+}
+
+
+static DECLCALLBACK(int) tstCountCallback(PRTRANGEU64NODECORE pNode, void *pvUser)
+{
+    tstFromCore(pNode)->fInTree = false;
+    *(uint32_t *)pvUser += 1;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Random inserts, removals and lookups, cross checked with RTAvlrU64.
+ */
+static void tstRandom(bool fRadix, uint32_t fFlags, uint32_t cOps)
+{
+    RTTestISubF("%s, random, fFlags=%#x", fRadix ? "RTRadixTreeU64" : "RTBpTreeU64", fFlags);
+
+    TSTTREE Tree;
+    RTTESTI_CHECK_RC_RETV(tstInit(&Tree, fRadix, fFlags), VINF_SUCCESS);
+    AVLRU64TREE AvlTree = NULL;
+    RT_ZERO(g_aRanges);
+
+    for (uint32_t iOp = 0; iOp < cOps; iOp++)
+    {
+        PTSTRANGE pRange = &g_aRanges[RTRandAdvU32Ex(g_hRand, 0, TST_RANGES - 1)];
+        if (!pRange->fInTree)
+        {
+            /*
+             * Insert.
+             */
+            tstRandomRange(&pRange->Core.Key, &pRange->Core.KeyLast);
+            pRange->Avl.Key     = pRange->Core.Key;
+            pRange->Avl.KeyLast = pRange->Core.KeyLast;
+            bool const fAvl = RTAvlrU64Insert(&AvlTree, &pRange->Avl);
+            int const  rc   = tstInsert(&Tree, pRange);
+            if (fAvl ? rc != VINF_SUCCESS : rc != VERR_ALREADY_EXISTS)
+            {
+                RTTestIFailed("Insert %#RX64-%#RX64 -> %Rrc, AVL says %RTbool", pRange->Core.Key, pRange->Core.KeyLast, rc, fAvl);
+                break;
+            }
+            pRange->fInTree = fAvl;
+        }
+        else if (RTRandAdvU32Ex(g_hRand, 0, 2) != 0)
+        {
+            /*
+             * Remove by the first key or by any key in the range.
+             */
+            PTSTRANGE pRemoved;
+            if (RTRandAdvU32Ex(g_hRand, 0, 1))
+                pRemoved = tstRemove(&Tree, pRange->Core.Key);
+            else
+                pRemoved = tstRangeRemove(&Tree, pRange->Core.Key + RTRandAdvU64Ex(g_hRand, 0, pRange->Core.KeyLast - pRange->Core.Key));
+            RTTESTI_CHECK_MSG_BREAK(pRemoved == pRange, ("%p %p %#RX64\n", pRemoved, pRange, pRange->Core.Key));
+            RTTESTI_CHECK_BREAK(tstFromAvl(RTAvlrU64Remove(&AvlTree, pRange->Core.Key)) == pRange);
+            RTTESTI_CHECK_BREAK(tstRemove(&Tree, pRange->Core.Key) == NULL);
+            pRange->fInTree = false;
+        }
+
+        /*
+         * Lookups.
+         */
+        for (unsigned iLookup = 0; iLookup < 4; iLookup++)
+        {
+            uint64_t const Key = tstRandomKey();
+            RTTESTI_CHECK_MSG(tstGet(&Tree, Key) == tstFromAvl(RTAvlrU64Get(&AvlTree, Key)), ("Key=%#RX64\n", Key));
+            RTTESTI_CHECK_MSG(tstRangeGet(&Tree, Key) == tstFromAvl(RTAvlrU64RangeGet(&AvlTree, Key)), ("Key=%#RX64\n", Key));
+            RTTESTI_CHECK_MSG(   tstGetBestFit(&Tree, Key, true)
+                              == tstFromAvl(RTAvlrU64GetBestFit(&AvlTree, Key, true)), ("Key=%#RX64\n", Key));
+            RTTESTI_CHECK_MSG(   tstGetBestFit(&Tree, Key, false)
+                              == tstFromAvl(RTAvlrU64GetBestFit(&AvlTree, Key, false)), ("Key=%#RX64\n", Key));
+        }
+
+        if (iOp % 1024 == 0)
+            tstCheckEnum(&Tree, &AvlTree);
+        if (RTTestIErrorCount())
+            break;
+    }
+    tstCheckEnum(&Tree, &AvlTree);
+
+    /*
+     * Destroy.
+     */
+    uint32_t const cExpected = (uint32_t)tstCount(&Tree);
+    uint32_t       cCalls    = 0;
+    RTTESTI_CHECK_RC(tstDestroy(&Tree, tstCountCallback, &cCalls), VINF_SUCCESS);
+    RTTESTI_CHECK_MSG(cCalls == cExpected, ("%u %u\n", cCalls, cExpected));
+    for (uint32_t i = 0; i < TST_RANGES; i++)
+        RTTESTI_CHECK_RETV(!g_aRanges[i].fInTree);
+}
+
+
+/**
+ * Looks up the stable and churned ranges while the main thread churns the
+ * tree.
+ */
+static DECLCALLBACK(int) tstReaderThread(RTTHREAD hSelf, void *pvUser)
+{
+    RT_NOREF(hSelf);
+    TSTREADERARGS *pArgs = (TSTREADERARGS *)pvUser;
+    uint32_t       i     = 0;
+    while (!ASMAtomicReadBool(&pArgs->fStop))
+    {
+        PTSTRANGE      pStable = &pArgs->paStable[i % pArgs->cStable];
+        uint64_t const Key     = ((uint64_t)(i % pArgs->cChurned) * 8 + 4) << TST_SHIFT;
+        uint64_t const KeyLast = Key + (RT_BIT_64(TST_SHIFT) * 2) - 1;
+        i++;
+        uint32_t const uToken  = tstReadEnter(pArgs->pTree);
+        PTSTRANGE      pFound  = tstRangeGet(pArgs->pTree, pStable->Core.KeyLast);
+        PTSTRANGE      pBest   = tstGetBestFit(pArgs->pTree, pStable->Core.Key, true /*fAbove*/);
+        /* The writer poisons and frees churned ranges once removed, so they
+           must stay intact until we leave the read section.  Yield now and
+           then to give the writer a chance to get at them (single CPU hosts). */
+        PTSTRANGE      pChurn1 = tstGet(pArgs->pTree, Key);
+        PTSTRANGE      pChurn2 = tstRangeGet(pArgs->pTree, KeyLast);
+        if (i % 8 == 0)
+            RTThreadYield();
+        bool const     fBad    =    (pChurn1 && (pChurn1->Core.Key != Key || pChurn1->Core.KeyLast != KeyLast))
+                                 || (pChurn2 && (pChurn2->Core.Key != Key || pChurn2->Core.KeyLast != KeyLast));
+        tstReadLeave(pArgs->pTree, uToken);
+        if (pFound != pStable || pBest != pStable || fBad)
+            ASMAtomicIncU32(&pArgs->cErrors);
+        ASMAtomicIncU32(&pArgs->cLookups);
+        if (i % 64 == 0)
+            RTThreadYield();
+    }
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Lockless readers racing a writer.
+ *
+ * Every other range is inserted up front and never touched again, the reader
+ * must always find those while the ones in between come and go.  The churned
+ * ranges are allocated when inserted and poisoned and freed right after being
+ * removed, so the reader catches a tree handing out removed ranges.
+ */
+static void tstLockless(bool fRadix)
+{
+    RTTestISubF("%s, lockless readers", fRadix ? "RTRadixTreeU64" : "RTBpTreeU64");
+
+    TSTTREE Tree;
+    RTTESTI_CHECK_RC_RETV(tstInit(&Tree, fRadix, RTBPTREE_F_LOCKLESS_READERS), VINF_SUCCESS);
+    RT_ZERO(g_aRanges);
+    for (uint32_t i = 0; i < TST_RANGES; i++)
+    {
+        g_aRanges[i].Core.Key     = (uint64_t)i * 4 << TST_SHIFT;
+        g_aRanges[i].Core.KeyLast = (((uint64_t)i * 4 + 2) << TST_SHIFT) - 1;
+    }
+
+    static TSTRANGE s_aStable[TST_RANGES / 2];
+    for (uint32_t i = 0; i < TST_RANGES / 2; i++)
+    {
+        s_aStable[i] = g_aRanges[i * 2];
+        RTTESTI_CHECK_RC_RETV(tstInsert(&Tree, &s_aStable[i]), VINF_SUCCESS);
+    }
+
+    TSTREADERARGS Args;
+    Args.pTree    = &Tree;
+    Args.paStable = s_aStable;
+    Args.cStable  = RT_ELEMENTS(s_aStable);
+    Args.cChurned = TST_RANGES / 2;
+    Args.fStop    = false;
+    Args.cLookups = 0;
+    Args.cErrors  = 0;
+    RTTHREAD hThread;
+    RTTESTI_CHECK_RC_RETV(RTThreadCreate(&hThread, tstReaderThread, &Args, 0, RTTHREADTYPE_DEFAULT, RTTHREADFLAGS_WAITABLE,
+                                         "tstReader"), VINF_SUCCESS);
+
+    static PTSTRANGE s_apChurned[TST_RANGES / 2];
+    RT_ZERO(s_apChurned);
+    uint64_t const nsStart = RTTimeNanoTS();
+    uint32_t       cOps    = 0;
+    while (RTTimeNanoTS() - nsStart < RT_NS_1SEC)
+    {
+        uint32_t const idx    = RTRandAdvU32Ex(g_hRand, 0, TST_RANGES / 2 - 1);
+        PTSTRANGE      pRange = s_apChurned[idx];
+        if (!pRange)
+        {
+            pRange = (PTSTRANGE)RTMemAlloc(sizeof(*pRange));
+            RTTESTI_CHECK_BREAK(pRange);
+            *pRange = g_aRanges[idx * 2 + 1];
+            int rc = tstInsert(&Tree, pRange);
+            if (RT_FAILURE(rc))
+            {
+                RTTestIFailed("tstInsert -> %Rrc\n", rc);
+                RTMemFree(pRange);
+                break;
+            }
+            s_apChurned[idx] = pRange;
+        }
+        else
+        {
+            RTTESTI_CHECK_BREAK(tstRemove(&Tree, pRange->Core.Key) == pRange);
+            s_apChurned[idx] = NULL;
+            memset(pRange, 0xdd, sizeof(*pRange));
+            RTMemFree(pRange);
+        }
+        cOps++;
+    }
+
+    ASMAtomicWriteBool(&Args.fStop, true);
+    RTTESTI_CHECK_RC(RTThreadWait(hThread, RT_MS_1MIN, NULL), VINF_SUCCESS);
+    RTTESTI_CHECK_MSG(Args.cErrors == 0, ("%u of %u lookups failed\n", Args.cErrors, Args.cLookups));
+    RTTestIPrintf(RTTESTLVL_ALWAYS, "%u modifications, %u lookups\n", cOps, Args.cLookups);
+    RTTESTI_CHECK_RC(tstDestroy(&Tree, NULL, NULL), VINF_SUCCESS);
+    for (uint32_t i = 0; i < RT_ELEMENTS(s_apChurned); i++)
+        RTMemFree(s_apChurned[i]);
+}
+
+
+/**
+ * Compares lookup performance with RTAvlrU64.
+ */
+static void tstBenchmark(void)
+{
+    RTTestISub("Benchmark");
+
+    /*
+     * Page sized ranges with small gaps, inserted in random order.
+     */
+    PTSTRANGE  paRanges = (PTSTRANGE)RTMemAllocZ(TST_BENCH_RANGES * sizeof(TSTRANGE));
+    uint64_t  *pauKeys  = (uint64_t *)RTMemAlloc(TST_BENCH_LOOKUPS * sizeof(uint64_t));
+    uint32_t  *paiOrder = (uint32_t *)RTMemAlloc(TST_BENCH_RANGES * sizeof(uint32_t));
+    RTTESTI_CHECK_RETV(paRanges && pauKeys && paiOrder);
+    for (uint32_t i = 0; i < TST_BENCH_RANGES; i++)
+    {
+        paRanges[i].Core.Key     = (uint64_t)i * 3 << TST_SHIFT;
+        paRanges[i].Core.KeyLast = paRanges[i].Core.Key + RT_BIT_64(TST_SHIFT) - 1;
+        paRanges[i].Avl.Key      = paRanges[i].Core.Key;
+        paRanges[i].Avl.KeyLast  = paRanges[i].Core.KeyLast;
+        paiOrder[i] = i;
+    }
+    for (uint32_t i = TST_BENCH_RANGES - 1; i > 0; i--)
+    {
+        uint32_t const j = RTRandAdvU32Ex(g_hRand, 0, i);
+        uint32_t const t = paiOrder[i];
+        paiOrder[i] = paiOrder[j];
+        paiOrder[j] = t;
+    }
+    for (uint32_t i = 0; i < TST_BENCH_LOOKUPS; i++)
+    {
+        PTSTRANGE pRange = &paRanges[RTRandAdvU32Ex(g_hRand, 0, TST_BENCH_RANGES - 1)];
+        pauKeys[i] = pRange->Core.Key + RTRandAdvU32Ex(g_hRand, 0, RT_BIT_32(TST_SHIFT) - 1);
+    }
+
+    static const char * const s_apszNames[] = { "RTAvlrU64", "RTBpTreeU64", "RTRadixTreeU64" };
+    for (unsigned iTree = 0; iTree < RT_ELEMENTS(s_apszNames); iTree++)
+    {
+        AVLRU64TREE AvlTree = NULL;
+        TSTTREE     Tree;
+        if (iTree > 0)
+        {
+            RTTESTI_CHECK_RC_BREAK(tstInit(&Tree, iTree == 2, 0), VINF_SUCCESS);
+        }
+
+        uint64_t nsStart = RTTimeNanoTS();
+        for (uint32_t i = 0; i < TST_BENCH_RANGES; i++)
+        {
+            PTSTRANGE pRange = &paRanges[paiOrder[i]];
+            if (iTree == 0)
+                RTTESTI_CHECK(RTAvlrU64Insert(&AvlTree, &pRange->Avl));
+            else
+                RTTESTI_CHECK_RC(tstInsert(&Tree, pRange), VINF_SUCCESS);
+        }
+        RTTestIValueF((RTTimeNanoTS() - nsStart) / TST_BENCH_RANGES, RTTESTUNIT_NS_PER_CALL, "%s insert", s_apszNames[iTree]);
+
+        uint64_t cFound = 0;
+        nsStart = RTTimeNanoTS();
+        if (iTree == 0)
+            for (uint32_t i = 0; i < TST_BENCH_LOOKUPS; i++)
+                cFound += RTAvlrU64RangeGet(&AvlTree, pauKeys[i]) != NULL;
+        else if (iTree == 1)
+            for (uint32_t i = 0; i < TST_BENCH_LOOKUPS; i++)
+                cFound += RTBpTreeU64RangeGet(&Tree.u.BpTree, pauKeys[i]) != NULL;
+        else
+            for (uint32_t i = 0; i < TST_BENCH_LOOKUPS; i++)
+                cFound += RTRadixTreeU64RangeGet(&Tree.u.Radix, pauKeys[i]) != NULL;
+        RTTestIValueF((RTTimeNanoTS() - nsStart) / TST_BENCH_LOOKUPS, RTTESTUNIT_NS_PER_CALL, "%s range lookup", s_apszNames[iTree]);
+        RTTESTI_CHECK(cFound == TST_BENCH_LOOKUPS);
+
+        nsStart = RTTimeNanoTS();
+        for (uint32_t i = 0; i < TST_BENCH_RANGES; i++)
+        {
+            PTSTRANGE pRange = &paRanges[paiOrder[i]];
+            if (iTree == 0)
+                RTTESTI_CHECK(RTAvlrU64Remove(&AvlTree, pRange->Core.Key) == &pRange->Avl);
+            else
+                RTTESTI_CHECK(tstRemove(&Tree, pRange->Core.Key) == pRange);
+        }
+        RTTestIValueF((RTTimeNanoTS() - nsStart) / TST_BENCH_RANGES, RTTESTUNIT_NS_PER_CALL, "%s remove", s_apszNames[iTree]);
+
+        if (iTree > 0)
+            RTTESTI_CHECK_RC(tstDestroy(&Tree, NULL, NULL), VINF_SUCCESS);
+    }
+
+    RTMemFree(paiOrder);
+    RTMemFree(pauKeys);
+    RTMemFree(paRanges);
+}
+
+
+int main()
+{
+    RTEXITCODE rcExit = RTTestInitAndCreate("tstRTBpTree", &g_hTest);
+    if (rcExit != RTEXITCODE_SUCCESS)
+        return rcExit;
+    RTTestBanner(g_hTest);
+
+    RTTESTI_CHECK_RC_OK_RET(RTRandAdvCreateParkMiller(&g_hRand), RTEXITCODE_FAILURE);
+    uint32_t const uSeed = (uint32_t)RTTimeNanoTS();
+    RTTestIPrintf(RTTESTLVL_ALWAYS, "Seed %#x\n", uSeed);
+    RTRandAdvSeed(g_hRand, uSeed);
+
+    /*
+     * Testing.
+     */
+    tstRandom(false /*fRadix*/, 0, _64K);
+    tstRandom(false /*fRadix*/, RTBPTREE_F_LOCKLESS_READERS, _16K);
+    tstRandom(true /*fRadix*/, 0, _64K);
+    tstRandom(true /*fRadix*/, RTBPTREE_F_LOCKLESS_READERS, _16K);
+    if (!RTTestIErrorCount())
+    {
+        tstLockless(false /*fRadix*/);
+        tstLockless(true /*fRadix*/);
+    }
+    if (!RTTestIErrorCount())
+        tstBenchmark();
+
+    RTRandAdvDestroy(g_hRand);
+
+    /*
+     * Summary.
+     */
+    return RTTestSummaryAndDestroy(g_hTest);
+}
+
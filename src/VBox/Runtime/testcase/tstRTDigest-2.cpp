@@ -29,6 +29,7 @@
 *   Header Files                                                                                                                 *
 *********************************************************************************************************************************/
 #include <iprt/crypto/digest.h>
+#include <iprt/crc.h>
 #include <iprt/md2.h>
 #include <iprt/md5.h>
 #include <iprt/sha.h>
@@ -38,6 +39,7 @@
 #include <iprt/test.h>
 #include <iprt/thread.h>
 #include <iprt/string.h>
+#include <iprt/time.h>
 
 
 /*********************************************************************************************************************************
@@ -1252,6 +1254,101 @@ static void testSha384(void)
 }
 
 
+/**
+ * Bit-at-a-time reference CRC for checking the optimized code.
+ */
+static uint32_t testCrcRef(uint32_t uPoly, uint32_t uCrc, uint8_t const *pb, size_t cb)
+{
+    while (cb-- > 0)
+    {
+        uCrc ^= *pb++;
+        for (unsigned iBit = 0; iBit < 8; iBit++)
+            uCrc = uCrc & 1 ? (uCrc >> 1) ^ uPoly : uCrc >> 1;
+    }
+    return uCrc;
+}
+
+
+/**
+ * Tests CRC32 and CRC32C, mainly that all the code paths (unaligned heads,
+ * vector bulk, tails and chunked processing) agree with the reference.
+ */
+static void testCrc32(void)
+{
+    RTTestISub("CRC32 and CRC32C");
+
+    RTTESTI_CHECK(RTCrc32("123456789", 9) == UINT32_C(0xcbf43926));
+    RTTESTI_CHECK(RTCrc32C("123456789", 9) == UINT32_C(0xe3069283));
+
+    static size_t const s_acb[] = { 0, 1, 7, 15, 16, 17, 63, 64, 65, 127, 128, 255, 767, 768, 769, 1000, 4096,
+                                    24575, 24576, 24577, 49152 + 777, sizeof(g_abRandom72KB) - 64 };
+    for (unsigned iSize = 0; iSize < RT_ELEMENTS(s_acb); iSize++)
+        for (unsigned off = 0; off < 64; off += 7)
+        {
+            uint8_t const *pb = &g_abRandom72KB[off];
+            size_t const   cb = s_acb[iSize];
+            size_t const   cbHead = cb / 3;
+
+            uint32_t const uRef32 = testCrcRef(UINT32_C(0xedb88320), UINT32_MAX, pb, cb) ^ UINT32_MAX;
+            uint32_t uCrc = RTCrc32(pb, cb);
+            if (uCrc != uRef32)
+                RTTestIFailed("RTCrc32 off=%u cb=%zu: %#010RX32, expected %#010RX32", off, cb, uCrc, uRef32);
+            uCrc = RTCrc32Finish(RTCrc32Process(RTCrc32Process(RTCrc32Start(), pb, cbHead), &pb[cbHead], cb - cbHead));
+            if (uCrc != uRef32)
+                RTTestIFailed("RTCrc32Process off=%u cb=%zu: %#010RX32, expected %#010RX32", off, cb, uCrc, uRef32);
+
+            uint32_t const uRef32C = testCrcRef(UINT32_C(0x82f63b78), UINT32_MAX, pb, cb) ^ UINT32_MAX;
+            uCrc = RTCrc32C(pb, cb);
+            if (uCrc != uRef32C)
+                RTTestIFailed("RTCrc32C off=%u cb=%zu: %#010RX32, expected %#010RX32", off, cb, uCrc, uRef32C);
+            uCrc = RTCrc32CFinish(RTCrc32CProcess(RTCrc32CProcess(RTCrc32CStart(), pb, cbHead), &pb[cbHead], cb - cbHead));
+            if (uCrc != uRef32C)
+                RTTestIFailed("RTCrc32CProcess off=%u cb=%zu: %#010RX32, expected %#010RX32", off, cb, uCrc, uRef32C);
+        }
+}
+
+
+/**
+ * Reports the throughput of the checksums and digests used for bulk data
+ * (saved states, appliance manifests, disk images).
+ */
+static void testBenchmark(void)
+{
+    RTTestISub("Throughput");
+
+    static size_t const s_acb[] = { 512, _4K, _64K };
+    for (unsigned iSize = 0; iSize < RT_ELEMENTS(s_acb); iSize++)
+    {
+        size_t const   cb      = s_acb[iSize];
+        uint32_t const cRounds = (uint32_t)(_64M / cb);
+        uint32_t       uSum    = 0;
+        uint8_t        abHash[RTSHA256_HASH_SIZE];
+
+        uint64_t nsStart = RTTimeNanoTS();
+        for (uint32_t iRound = 0; iRound < cRounds; iRound++)
+            uSum += RTCrc32(g_abRandom72KB, cb);
+        uint64_t cNs = RTTimeNanoTS() - nsStart;
+        RTTestIValueF((uint64_t)cb * cRounds * RT_NS_1SEC / RT_MAX(cNs, 1) / _1M, RTTESTUNIT_MEGABYTES_PER_SEC,
+                      "CRC32 %zu bytes", cb);
+
+        nsStart = RTTimeNanoTS();
+        for (uint32_t iRound = 0; iRound < cRounds; iRound++)
+            uSum += RTCrc32C(g_abRandom72KB, cb);
+        cNs = RTTimeNanoTS() - nsStart;
+        RTTestIValueF((uint64_t)cb * cRounds * RT_NS_1SEC / RT_MAX(cNs, 1) / _1M, RTTESTUNIT_MEGABYTES_PER_SEC,
+                      "CRC32C %zu bytes", cb);
+
+        nsStart = RTTimeNanoTS();
+        for (uint32_t iRound = 0; iRound < cRounds / 8; iRound++)
+            RTSha256(g_abRandom72KB, cb, abHash);
+        cNs = RTTimeNanoTS() - nsStart;
+        RTTestIValueF((uint64_t)cb * (cRounds / 8) * RT_NS_1SEC / RT_MAX(cNs, 1) / _1M, RTTESTUNIT_MEGABYTES_PER_SEC,
+                      "SHA-256 %zu bytes", cb);
+        NOREF(uSum);
+    }
+}
+
+
 int main()
 {
     RTTEST hTest;
@@ -1273,6 +1370,8 @@ int main()
 #ifndef IPRT_WITHOUT_SHA512T256
     testSha512t256();
 #endif
+    testCrc32();
+    testBenchmark();
 
     return RTTestSummaryAndDestroy(hTest);
 }
@@ -71,14 +71,14 @@ static bool volatile        g_fTst3Stop;
  * Basic API checks.
  * We'll return if any of these fails.
  */
-static void tst1(void)
+static void tst1(uint32_t fFlags)
 {
-    RTTestISub("Basics");
+    RTTestISubF("Basics%s", fFlags & RTMEMCACHE_FLAGS_MAGAZINES ? " - magazines" : "");
 
     /* Create one without constructor or destructor. */
     uint32_t const cObjects = PAGE_SIZE * 2 / 256;
     RTMEMCACHE hMemCache;
-    RTTESTI_CHECK_RC_RETV(RTMemCacheCreate(&hMemCache, 256, cObjects, 32, NULL, NULL, NULL, 0 /*fFlags*/), VINF_SUCCESS);
+    RTTESTI_CHECK_RC_RETV(RTMemCacheCreate(&hMemCache, 256, cObjects, 32, NULL, NULL, NULL, fFlags), VINF_SUCCESS);
     RTTESTI_CHECK_RETV(hMemCache != NIL_RTMEMCACHE);
 
     /* Allocate a bit and free it again. */
@@ -121,6 +121,15 @@ static void tst1(void)
         }
     }
 
+    /* The statistics should add up. */
+    RTMEMCACHESTATS Stats;
+    RTTESTI_CHECK_RC(RTMemCacheQueryStats(hMemCache, &Stats), VINF_SUCCESS);
+    RTTESTI_CHECK(Stats.cObjects == cObjects);
+    if (fFlags & RTMEMCACHE_FLAGS_MAGAZINES)
+        RTTESTI_CHECK(Stats.cAllocHits > 0 && Stats.cFreeHits > 0);
+    else
+        RTTESTI_CHECK(Stats.cAllocHits == 0 && Stats.cFreeHits == 0);
+
     /* Destroy it. */
     RTTESTI_CHECK_RC(RTMemCacheDestroy(hMemCache), VINF_SUCCESS);
     RTTESTI_CHECK_RC(RTMemCacheDestroy(NIL_RTMEMCACHE), VINF_SUCCESS);
@@ -154,14 +163,14 @@ static DECLCALLBACK(void) tst2Dtor(RTMEMCACHE hMemCache, void *pvObj, void *pvUs
 /**
  * Test constructor / destructor.
  */
-static void tst2(void)
+static void tst2(uint32_t fFlags)
 {
-    RTTestISub("Ctor/Dtor");
+    RTTestISubF("Ctor/Dtor%s", fFlags & RTMEMCACHE_FLAGS_MAGAZINES ? " - magazines" : "");
 
     /* Create one without constructor or destructor. */
     bool            fFail    = false;
     uint32_t const  cObjects = PAGE_SIZE * 2 / 256;
-    RTTESTI_CHECK_RC_RETV(RTMemCacheCreate(&g_hMemCache, 256, cObjects, 32, tst2Ctor, tst2Dtor, &fFail, 0 /*fFlags*/), VINF_SUCCESS);
+    RTTESTI_CHECK_RC_RETV(RTMemCacheCreate(&g_hMemCache, 256, cObjects, 32, tst2Ctor, tst2Dtor, &fFail, fFlags), VINF_SUCCESS);
 
     /* A failure run first. */
     fFail = true;
@@ -261,13 +270,15 @@ static void tst3(uint32_t cThreads, uint32_t cbObject, int iMethod, uint32_t cSe
 {
     RTTestISubF("Benchmark - %u threads, %u bytes, %u secs, %s", cThreads, cbObject, cSecs,
                 iMethod == 0 ? "RTMemCache"
+                : iMethod == 2 ? "RTMemCache/magazines"
                 : "RTMemAlloc");
 
     /*
      * Create a cache with unlimited space, a start semaphore and line up
      * the threads.
      */
-    RTTESTI_CHECK_RC_RETV(RTMemCacheCreate(&g_hMemCache, cbObject, 0 /*cbAlignment*/, UINT32_MAX, NULL, NULL, NULL, 0 /*fFlags*/), VINF_SUCCESS);
+    RTTESTI_CHECK_RC_RETV(RTMemCacheCreate(&g_hMemCache, cbObject, 0 /*cbAlignment*/, UINT32_MAX, NULL, NULL, NULL,
+                                           iMethod == 2 ? RTMEMCACHE_FLAGS_MAGAZINES : 0), VINF_SUCCESS);
 
     RTSEMEVENTMULTI hEvt;
     RTTESTI_CHECK_RC_OK_RETV(RTSemEventMultiCreate(&hEvt));
@@ -280,7 +291,7 @@ static void tst3(uint32_t cThreads, uint32_t cbObject, int iMethod, uint32_t cSe
     {
         aThreads[i].hThread     = NIL_RTTHREAD;
         aThreads[i].cIterations = 0;
-        aThreads[i].fUseCache   = iMethod == 0;
+        aThreads[i].fUseCache   = iMethod != 1;
         aThreads[i].cbObject    = cbObject;
         aThreads[i].hEvt        = hEvt;
         RTTESTI_CHECK_RC_OK_RETV(RTThreadCreateF(&aThreads[i].hThread, tst3Thread, &aThreads[i], 0,
@@ -310,6 +321,15 @@ static void tst3(uint32_t cThreads, uint32_t cbObject, int iMethod, uint32_t cSe
     RTTestIPrintf(RTTESTLVL_ALWAYS, "%'8u iterations per second, %'llu ns on avg\n",
                   (unsigned)((long double)cIterations * 1000000000.0 / cElapsedNS),
                   cElapsedNS / cIterations);
+    if (iMethod == 2)
+    {
+        RTMEMCACHESTATS Stats;
+        RTTESTI_CHECK_RC(RTMemCacheQueryStats(g_hMemCache, &Stats), VINF_SUCCESS);
+        RTTestIPrintf(RTTESTLVL_ALWAYS, "hit rate %u%%, %'llu remote frees, %'llu slot collisions, %'llu depot exchanges, %u rounds\n",
+                      (unsigned)((Stats.cAllocHits + Stats.cFreeHits) * 100
+                                 / RT_MAX(Stats.cAllocHits + Stats.cFreeHits + Stats.cAllocMisses + Stats.cFreeMisses, 1)),
+                      Stats.cRemoteFrees, Stats.cSlotCollisions, Stats.cDepotExchanges, Stats.cMagazineRounds);
+    }
 
     /* clean up */
     RTTESTI_CHECK_RC(RTMemCacheDestroy(g_hMemCache), VINF_SUCCESS);
@@ -319,6 +339,7 @@ static void tst3(uint32_t cThreads, uint32_t cbObject, int iMethod, uint32_t cSe
 static void tst3AllMethods(uint32_t cThreads, uint32_t cbObject, uint32_t cSecs)
 {
     tst3(cThreads, cbObject, 0, cSecs);
+    tst3(cThreads, cbObject, 2, cSecs);
     tst3(cThreads, cbObject, 1, cSecs);
 }
 
@@ -334,8 +355,10 @@ int main(int argc, char **argv)
     RTTestBanner(hTest);
     g_hTest = hTest;
 
-    tst1();
-    tst2();
+    tst1(0);
+    tst1(RTMEMCACHE_FLAGS_MAGAZINES);
+    tst2(0);
+    tst2(RTMEMCACHE_FLAGS_MAGAZINES);
     if (RTTestIErrorCount() == 0)
     {
         uint32_t cSecs = argc == 1 ? 5 : 2;
@@ -37,6 +37,10 @@
 #include <iprt/string.h>
 #include <iprt/test.h>
 
+#ifdef RT_OS_LINUX
+# include <unistd.h>
+#endif
+
 
 static void tstRTPoll2(void)
 {
@@ -403,6 +407,74 @@ static void tstRTPoll1(void)
 
 }
 
+
+#ifdef RT_OS_LINUX
+static void tstRTPoll3(void)
+{
+    RTTestISub("Shared descriptors");
+
+    RTPOLLSET hSet;
+    RTTESTI_CHECK_RC_RETV(RTPollSetCreate(&hSet), VINF_SUCCESS);
+
+    /*
+     * Two entries for the same pipe must each only see the events they asked for.
+     */
+    RTPIPE hPipeR;
+    RTPIPE hPipeW;
+    RTTESTI_CHECK_RC_RETV(RTPipeCreate(&hPipeR, &hPipeW, 0/*fFlags*/), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTPollSetAddPipe(hSet, hPipeR, RTPOLL_EVT_ERROR, 1), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTPollSetAddPipe(hSet, hPipeR, RTPOLL_EVT_READ, 2), VINF_SUCCESS);
+
+    size_t cbWritten = 0;
+    RTTESTI_CHECK_RC(RTPipeWrite(hPipeW, "x", 1, &cbWritten), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTPipeClose(hPipeW), VINF_SUCCESS);
+
+    uint32_t fEvents = UINT32_MAX;
+    uint32_t id      = UINT32_MAX;
+    RTTESTI_CHECK_RC(RTPoll(hSet, 0, &fEvents, &id), VINF_SUCCESS);
+    RTTESTI_CHECK(id == 1);
+    RTTESTI_CHECK(fEvents == RTPOLL_EVT_ERROR);
+
+    RTTESTI_CHECK_RC(RTPollSetRemove(hSet, 1), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTPollSetRemove(hSet, 2), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTPipeClose(hPipeR), VINF_SUCCESS);
+
+    /*
+     * A descriptor closed before removal while a duplicate keeps the file open
+     * stays registered with epoll.  It must not make RTPollNoResume spin.
+     */
+    RTTESTI_CHECK_RC_RETV(RTPipeCreate(&hPipeR, &hPipeW, 0/*fFlags*/), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTPipeWrite(hPipeW, "x", 1, &cbWritten), VINF_SUCCESS);
+
+    RTPIPE hPipeDup = NIL_RTPIPE;
+    RTTESTI_CHECK_RC(RTPipeFromNative(&hPipeDup, dup((int)RTPipeToNative(hPipeR)), RTPIPE_N_READ), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTPollSetAddPipe(hSet, hPipeDup, RTPOLL_EVT_READ, 1), VINF_SUCCESS);
+
+    RTPIPE hPipeR2;
+    RTPIPE hPipeW2;
+    RTTESTI_CHECK_RC_RETV(RTPipeCreate(&hPipeR2, &hPipeW2, 0/*fFlags*/), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTPollSetAddPipe(hSet, hPipeR2, RTPOLL_EVT_READ, 2), VINF_SUCCESS);
+
+    RTTESTI_CHECK_RC(RTPipeClose(hPipeDup), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTPollSetRemove(hSet, 1), VINF_SUCCESS);
+
+    fEvents = UINT32_MAX;
+    id      = UINT32_MAX;
+    RTTESTI_CHECK_RC(RTPollNoResume(hSet, 100, &fEvents, &id), VERR_TIMEOUT);
+
+    RTTESTI_CHECK_RC(RTPipeWrite(hPipeW2, "x", 1, &cbWritten), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTPollNoResume(hSet, 100, &fEvents, &id), VINF_SUCCESS);
+    RTTESTI_CHECK(id == 2);
+    RTTESTI_CHECK(fEvents == RTPOLL_EVT_READ);
+
+    RTTESTI_CHECK_RC(RTPipeClose(hPipeW2), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTPipeClose(hPipeR2), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTPipeClose(hPipeW), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTPipeClose(hPipeR), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTPollSetDestroy(hSet), VINF_SUCCESS);
+}
+#endif
+
 int main()
 {
     RTTEST hTest;
@@ -415,6 +487,9 @@ int main()
      * The tests.
      */
     tstRTPoll1();
+#ifdef RT_OS_LINUX
+    tstRTPoll3();
+#endif
     if (RTTestErrorCount(hTest) == 0)
     {
         bool fMayPanic = RTAssertMayPanic();
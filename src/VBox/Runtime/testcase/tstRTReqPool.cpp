@@ -30,6 +30,7 @@
 *********************************************************************************************************************************/
 #include <iprt/req.h>
 
+#include <iprt/asm.h>
 #include <iprt/err.h>
 #include <iprt/test.h>
 #include <iprt/thread.h>
@@ -41,6 +42,10 @@
 *   Global Variables                                                                                                             *
 *********************************************************************************************************************************/
 static RTTEST g_hTest = NIL_RTTEST;
+/** The pool used by FibCallback. */
+static RTREQPOOL g_hFibPool = NIL_RTREQPOOL;
+/** Sequence counter for SeqCallback. */
+static uint32_t volatile g_iSeq = 0;
 
 
 static DECLCALLBACK(int) NopCallback(void)
@@ -132,6 +137,162 @@ static void test2(void)
 }
 
 
+static DECLCALLBACK(int) FibCallback(uintptr_t uN, uint64_t *puResult)
+{
+    if (uN < 2)
+    {
+        *puResult = uN;
+        return VINF_SUCCESS;
+    }
+
+    /* Fork one half to the pool and do the other half ourselves, then join. */
+    uint64_t uResult1;
+    PRTREQ   hReq;
+    int rc = RTReqPoolCallEx(g_hFibPool, 0, &hReq, RTREQFLAGS_IPRT_STATUS, (PFNRT)FibCallback, 2, uN - 1, &uResult1);
+    if (rc != VERR_TIMEOUT && RT_FAILURE(rc))
+        return rc;
+
+    uint64_t uResult2;
+    int rc2 = FibCallback(uN - 2, &uResult2);
+
+    rc = RTReqWait(hReq, RT_INDEFINITE_WAIT);
+    if (RT_SUCCESS(rc))
+        rc = RTReqGetStatus(hReq);
+    RTReqRelease(hReq);
+    if (RT_SUCCESS(rc))
+        rc = rc2;
+    *puResult = uResult1 + uResult2;
+    return rc;
+}
+
+
+static DECLCALLBACK(int) ChainCallback(uint32_t cDepth)
+{
+    if (!cDepth)
+        return VINF_SUCCESS;
+    return RTReqPoolCallWait(g_hFibPool, (PFNRT)ChainCallback, 1, cDepth - 1);
+}
+
+
+static DECLCALLBACK(int) SeqCallback(uint32_t *puSeq)
+{
+    *puSeq = ASMAtomicIncU32(&g_iSeq);
+    return VINF_SUCCESS;
+}
+
+
+static DECLCALLBACK(int) StatusOfCallback(PRTREQ hReq, int *prc)
+{
+    *prc = RTReqGetStatus(hReq);
+    return VINF_SUCCESS;
+}
+
+
+static DECLCALLBACK(int) SleepThenFailCallback(RTMSINTERVAL cMillies)
+{
+    RTThreadSleep(cMillies);
+    return VERR_GENERAL_FAILURE;
+}
+
+
+static void test3(void)
+{
+    RTTestISub("Work stealing");
+    RTTESTI_CHECK_RC_RETV(RTReqPoolCreate(4, RT_MS_1SEC, UINT32_MAX, 0, "fib", &g_hFibPool), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTReqPoolSetCfgVar(g_hFibPool, RTREQPOOLCFGVAR_BIND_TO_CPUS, 1), VINF_SUCCESS);
+    RTTESTI_CHECK(RTReqPoolGetCfgVar(g_hFibPool, RTREQPOOLCFGVAR_BIND_TO_CPUS) == 1);
+    RTTESTI_CHECK(RTReqPoolGetCfgVar(g_hFibPool, RTREQPOOLCFGVAR_HELP_WHILE_WAITING) == 0);
+    RTTESTI_CHECK_RC(RTReqPoolSetCfgVar(g_hFibPool, RTREQPOOLCFGVAR_HELP_WHILE_WAITING, 1), VINF_SUCCESS);
+    RTTESTI_CHECK(RTReqPoolGetCfgVar(g_hFibPool, RTREQPOOLCFGVAR_HELP_WHILE_WAITING) == 1);
+
+    /* The nested waits would deadlock a 4 thread pool without the workers
+       helping out while waiting. */
+    uint64_t NsTsStart = RTTimeNanoTS();
+    uint64_t uResult   = 0;
+    RTTESTI_CHECK_RC(RTReqPoolCallWait(g_hFibPool, (PFNRT)FibCallback, 2, (uintptr_t)20, &uResult), VINF_SUCCESS);
+    RTTESTI_CHECK_MSG(uResult == 6765, ("uResult=%RU64\n", uResult));
+    RTTestIValue("fib(20) time", RTTimeNanoTS() - NsTsStart, RTTESTUNIT_NS);
+    RTTestIValue("worker queued", RTReqPoolGetStat(g_hFibPool, RTREQPOOLSTAT_REQUESTS_WORKER_QUEUED), RTTESTUNIT_OCCURRENCES);
+    RTTestIValue("stolen", RTReqPoolGetStat(g_hFibPool, RTREQPOOLSTAT_REQUESTS_STOLEN), RTTESTUNIT_OCCURRENCES);
+    RTTESTI_CHECK(RTReqPoolGetStat(g_hFibPool, RTREQPOOLSTAT_REQUESTS_WORKER_QUEUED) > 0);
+    RTTESTI_CHECK(RTReqPoolGetStat(g_hFibPool, RTREQPOOLSTAT_REQUESTS_PENDING) == 0);
+
+    RTTESTI_CHECK(RTReqPoolRelease(g_hFibPool) == 0);
+    g_hFibPool = NIL_RTREQPOOL;
+
+    /* Without the helping, workers waiting on their children rely on the pool
+       growing beyond the push back threshold. */
+    RTTESTI_CHECK_RC_RETV(RTReqPoolCreate(16, RT_MS_1SEC, 2, 1, "chain", &g_hFibPool), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTReqPoolCallWait(g_hFibPool, (PFNRT)ChainCallback, 1, (uintptr_t)8), VINF_SUCCESS);
+    RTTESTI_CHECK(RTReqPoolGetStat(g_hFibPool, RTREQPOOLSTAT_REQUESTS_WORKER_QUEUED) == 0);
+    RTTESTI_CHECK(RTReqPoolGetStat(g_hFibPool, RTREQPOOLSTAT_THREADS) >= 9);
+    RTTESTI_CHECK(RTReqPoolRelease(g_hFibPool) == 0);
+    g_hFibPool = NIL_RTREQPOOL;
+
+    /* Keep the only worker thread busy and check the queue order. */
+    RTTestISub("Priorities");
+    RTREQPOOL hPool;
+    RTTESTI_CHECK_RC_RETV(RTReqPoolCreate(1, RT_MS_1SEC, UINT32_MAX, 0, "prio", &hPool), VINF_SUCCESS);
+    PRTREQ hReqBusy;
+    RTTESTI_CHECK_RC(RTReqPoolCallEx(hPool, 0, &hReqBusy, RTREQFLAGS_IPRT_STATUS, (PFNRT)SleepThenFailCallback, 1,
+                                     (RTMSINTERVAL)100), VERR_TIMEOUT);
+    RTThreadSleep(10);
+
+    static uint32_t const s_afFlags[6] =
+    {
+        RTREQFLAGS_PRIORITY_LOW, 0, RTREQFLAGS_PRIORITY_HIGH, 0, RTREQFLAGS_PRIORITY_HIGH, RTREQFLAGS_PRIORITY_LOW
+    };
+    static uint32_t const s_aiExpected[6] = { 5, 3, 1, 4, 2, 6 };
+    uint32_t aiSeq[6] = { 0, 0, 0, 0, 0, 0 };
+    PRTREQ   ahReqs[6];
+    g_iSeq = 0;
+    for (unsigned i = 0; i < RT_ELEMENTS(ahReqs); i++)
+        RTTESTI_CHECK_RC(RTReqPoolCallEx(hPool, 0, &ahReqs[i], s_afFlags[i], (PFNRT)SeqCallback, 1, &aiSeq[i]), VERR_TIMEOUT);
+    for (unsigned i = 0; i < RT_ELEMENTS(ahReqs); i++)
+    {
+        RTTESTI_CHECK_RC(RTReqWait(ahReqs[i], RT_INDEFINITE_WAIT), VINF_SUCCESS);
+        RTTESTI_CHECK_MSG(aiSeq[i] == s_aiExpected[i], ("#%u: %u, expected %u\n", i, aiSeq[i], s_aiExpected[i]));
+        RTReqRelease(ahReqs[i]);
+    }
+    RTTESTI_CHECK_RC(RTReqPoolCallEx(hPool, 0, &ahReqs[0], RTREQFLAGS_PRIORITY_MASK, (PFNRT)SeqCallback, 1, &aiSeq[0]),
+                     VERR_INVALID_PARAMETER);
+    RTTESTI_CHECK_RC(RTReqWait(hReqBusy, RT_INDEFINITE_WAIT), VINF_SUCCESS);
+    RTReqRelease(hReqBusy);
+
+    /* Continuations, both before and after the predecessor completed. */
+    RTTestISub("Continuations");
+    RTTESTI_CHECK_RC(RTReqPoolCallEx(hPool, 0, &hReqBusy, RTREQFLAGS_IPRT_STATUS, (PFNRT)SleepThenFailCallback, 1,
+                                     (RTMSINTERVAL)50), VERR_TIMEOUT);
+    int    rcBusy = VINF_SUCCESS;
+    int    rcThen = VERR_WRONG_ORDER;
+    PRTREQ hReqThen;
+    PRTREQ hReqThenThen;
+    RTTESTI_CHECK_RC(RTReqPoolCallAfterEx(hPool, hReqBusy, &hReqThen, RTREQFLAGS_IPRT_STATUS, (PFNRT)StatusOfCallback, 2,
+                                          hReqBusy, &rcBusy), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTReqPoolCallAfterEx(hPool, hReqThen, &hReqThenThen, RTREQFLAGS_IPRT_STATUS, (PFNRT)StatusOfCallback, 2,
+                                          hReqThen, &rcThen), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTReqWait(hReqThenThen, RT_INDEFINITE_WAIT), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(rcBusy, VERR_GENERAL_FAILURE);
+    RTTESTI_CHECK_RC(rcThen, VINF_SUCCESS);
+    RTReqRelease(hReqThenThen);
+
+    rcBusy = VINF_SUCCESS;
+    RTTESTI_CHECK_RC(RTReqPoolCallAfterEx(hPool, hReqBusy, &hReqThenThen, RTREQFLAGS_IPRT_STATUS, (PFNRT)StatusOfCallback, 2,
+                                          hReqBusy, &rcBusy), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTReqWait(hReqThenThen, RT_INDEFINITE_WAIT), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(rcBusy, VERR_GENERAL_FAILURE);
+    RTReqRelease(hReqThenThen);
+
+    /* Waiting again on a completed request must not block. */
+    RTTESTI_CHECK_RC(RTReqWait(hReqThen, RT_INDEFINITE_WAIT), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTReqWait(hReqThen, RT_INDEFINITE_WAIT), VINF_SUCCESS);
+    RTReqRelease(hReqThen);
+    RTReqRelease(hReqBusy);
+
+    RTTESTI_CHECK(RTReqPoolRelease(hPool) == 0);
+}
+
+
 int main()
 {
     RTEXITCODE rcExit = RTTestInitAndCreate("tstRTReqPool", &g_hTest);
@@ -143,6 +304,7 @@ int main()
     if (RTTestIErrorCount() == 0)
     {
         test2();
+        test3();
     }
     return RTTestSummaryAndDestroy(g_hTest);
 }
@@ -31,7 +31,9 @@
 #include <iprt/sort.h>
 
 #include <iprt/err.h>
+#include <iprt/mem.h>
 #include <iprt/rand.h>
+#include <iprt/req.h>
 #include <iprt/string.h>
 #include <iprt/test.h>
 #include <iprt/time.h>
@@ -47,6 +49,13 @@ typedef struct TSTRTSORTAPV
     size_t      cElements;
 } TSTRTSORTAPV;
 
+/** Element for checking stability, sorted by uKey only. */
+typedef struct TSTRTSORTSTABLE
+{
+    uint32_t    uKey;
+    uint32_t    iSeq;
+} TSTRTSORTSTABLE;
+
 
 static DECLCALLBACK(int) testApvCompare(void const *pvElement1, void const *pvElement2, void *pvUser)
 {
@@ -134,6 +143,249 @@ static void testSorter(RTTEST hTest, FNRTSORT pfnSorter, const char *pszName)
 }
 
 
+static DECLCALLBACK(void) testMergeSorter(void *pvArray, size_t cElements, size_t cbElement, PFNRTSORTCMP pfnCmp, void *pvUser)
+{
+    RTTESTI_CHECK_RC(RTSortMerge(pvArray, cElements, cbElement, pfnCmp, pvUser), VINF_SUCCESS);
+}
+
+
+static DECLCALLBACK(void) testApvMergeSorter(void **papvArray, size_t cElements, PFNRTSORTCMP pfnCmp, void *pvUser)
+{
+    RTTESTI_CHECK_RC(RTSortApvMerge(papvArray, cElements, pfnCmp, pvUser), VINF_SUCCESS);
+}
+
+
+static DECLCALLBACK(int) testU32Compare(void const *pvElement1, void const *pvElement2, void *pvUser)
+{
+    RT_NOREF(pvUser);
+    uint32_t const u1 = *(uint32_t const *)pvElement1;
+    uint32_t const u2 = *(uint32_t const *)pvElement2;
+    return u1 < u2 ? -1 : u1 > u2 ? 1 : 0;
+}
+
+
+/**
+ * Sorts arrays with patterns that trip up naive quick sorts.
+ */
+static void testPatterns(FNRTSORT pfnSorter, const char *pszName)
+{
+    RTTestISub(pszName);
+
+    static const uint32_t s_acElements[] = { 0, 1, 2, 3, 24, 25, 128, 129, 1000, 65536 };
+    uint32_t *pau32 = (uint32_t *)RTMemAlloc(65536 * sizeof(uint32_t));
+    RTTESTI_CHECK_RETV(pau32);
+    for (unsigned iSize = 0; iSize < RT_ELEMENTS(s_acElements); iSize++)
+        for (unsigned iPattern = 0; iPattern < 6; iPattern++)
+        {
+            uint32_t const cElements = s_acElements[iSize];
+            uint64_t       uSum      = 0;
+            for (uint32_t i = 0; i < cElements; i++)
+            {
+                switch (iPattern)
+                {
+                    case 0: pau32[i] = i; break;                                        /* ascending */
+                    case 1: pau32[i] = cElements - i; break;                            /* descending */
+                    case 2: pau32[i] = 42; break;                                       /* all equal */
+                    case 3: pau32[i] = i < cElements / 2 ? i : cElements - i; break;    /* organ pipe */
+                    case 4: pau32[i] = i & 7; break;                                    /* few unique */
+                    case 5: pau32[i] = i % 97 ? i : 0; break;                           /* mostly sorted */
+                }
+                uSum += pau32[i];
+            }
+
+            pfnSorter(pau32, cElements, sizeof(uint32_t), testU32Compare, NULL);
+
+            if (!RTSortIsSortedU32(pau32, cElements))
+                RTTestIFailed("failed sorting pattern #%u with %u elements", iPattern, cElements);
+            for (uint32_t i = 0; i < cElements; i++)
+                uSum -= pau32[i];
+            if (uSum != 0)
+                RTTestIFailed("pattern #%u with %u elements: elements lost or duplicated", iPattern, cElements);
+        }
+    RTMemFree(pau32);
+}
+
+
+static DECLCALLBACK(int) testStableCompare(void const *pvElement1, void const *pvElement2, void *pvUser)
+{
+    RT_NOREF(pvUser);
+    TSTRTSORTSTABLE const *pElement1 = (TSTRTSORTSTABLE const *)pvElement1;
+    TSTRTSORTSTABLE const *pElement2 = (TSTRTSORTSTABLE const *)pvElement2;
+    return pElement1->uKey < pElement2->uKey ? -1 : pElement1->uKey > pElement2->uKey ? 1 : 0;
+}
+
+
+/**
+ * Checks that the stable sorters keep the order of equal elements.
+ */
+static void testStable(void)
+{
+    RTTestISub("Stability");
+
+    RTRAND hRand;
+    RTTESTI_CHECK_RC_OK_RETV(RTRandAdvCreateParkMiller(&hRand));
+
+    static TSTRTSORTSTABLE s_aElements[20000];
+    static TSTRTSORTSTABLE s_aSorted[20000];
+    static TSTRTSORTSTABLE const *s_apElements[20000];
+    for (unsigned iSorter = 0; iSorter < 3; iSorter++)
+    {
+        for (uint32_t i = 0; i < RT_ELEMENTS(s_aElements); i++)
+        {
+            s_aElements[i].uKey = RTRandAdvU32Ex(hRand, 0, 63);
+            s_aElements[i].iSeq = i;
+            s_apElements[i]     = &s_aElements[i];
+        }
+
+        switch (iSorter)
+        {
+            case 0:
+                RTTESTI_CHECK_RC(RTSortMerge(s_aElements, RT_ELEMENTS(s_aElements), sizeof(s_aElements[0]),
+                                             testStableCompare, NULL), VINF_SUCCESS);
+                break;
+            case 1:
+                RTTESTI_CHECK_RC(RTSortRadixByKey(s_aElements, RT_ELEMENTS(s_aElements), sizeof(s_aElements[0]),
+                                                  RT_OFFSETOF(TSTRTSORTSTABLE, uKey), sizeof(uint32_t)), VINF_SUCCESS);
+                break;
+            case 2:
+                RTTESTI_CHECK_RC(RTSortApvMerge((void **)s_apElements, RT_ELEMENTS(s_apElements), testStableCompare, NULL),
+                                 VINF_SUCCESS);
+                for (uint32_t i = 0; i < RT_ELEMENTS(s_aElements); i++)
+                    s_aSorted[i] = *s_apElements[i];
+                memcpy(s_aElements, s_aSorted, sizeof(s_aElements));
+                break;
+        }
+
+        for (uint32_t i = 1; i < RT_ELEMENTS(s_aElements); i++)
+            if (   s_aElements[i - 1].uKey >  s_aElements[i].uKey
+                || (   s_aElements[i - 1].uKey == s_aElements[i].uKey
+                    && s_aElements[i - 1].iSeq >  s_aElements[i].iSeq))
+            {
+                RTTestIFailed("sorter #%u: element %u (%u/%u) and %u (%u/%u) are out of order", iSorter,
+                              i - 1, s_aElements[i - 1].uKey, s_aElements[i - 1].iSeq, i, s_aElements[i].uKey, s_aElements[i].iSeq);
+                break;
+            }
+    }
+
+    RTTESTI_CHECK_RC(RTSortRadixByKey(s_aElements, RT_ELEMENTS(s_aElements), sizeof(s_aElements[0]),
+                                      0, 3), VERR_INVALID_PARAMETER);
+    RTTESTI_CHECK_RC(RTSortRadixByKey(s_aElements, RT_ELEMENTS(s_aElements), sizeof(s_aElements[0]),
+                                      4, 8), VERR_INVALID_PARAMETER);
+    RTRandAdvDestroy(hRand);
+}
+
+
+/**
+ * Tests the integer radix sorts and the inline type specialized functions.
+ */
+static void testIntegers(void)
+{
+    RTTestISub("Integer sorting and searching");
+
+    RTRAND hRand;
+    RTTESTI_CHECK_RC_OK_RETV(RTRandAdvCreateParkMiller(&hRand));
+
+    static uint32_t s_au32[50000];
+    static uint32_t s_au32Copy[50000];
+    static uint64_t s_au64[50000];
+    static const uint32_t s_acElements[] = { 0, 1, 2, 17, 63, 64, 65, 1000, 4096, 50000 };
+    for (unsigned iSize = 0; iSize < RT_ELEMENTS(s_acElements); iSize++)
+    {
+        uint32_t const cElements = s_acElements[iSize];
+        uint32_t const uMax      = iSize & 1 ? UINT32_MAX : cElements; /* alternate between many and few duplicates */
+        for (uint32_t i = 0; i < cElements; i++)
+        {
+            s_au32[i] = s_au32Copy[i] = RTRandAdvU32Ex(hRand, 0, uMax);
+            s_au64[i] = RTRandAdvU64(hRand) >> (i & 7) * 8;
+        }
+
+        RTTESTI_CHECK_RC(RTSortRadixU32(s_au32, cElements), VINF_SUCCESS);
+        if (!RTSortIsSortedU32(s_au32, cElements))
+            RTTestIFailed("RTSortRadixU32 failed on %u elements", cElements);
+        RTTESTI_CHECK_RC(RTSortRadixU64(s_au64, cElements), VINF_SUCCESS);
+        if (!RTSortIsSortedU64(s_au64, cElements))
+            RTTestIFailed("RTSortRadixU64 failed on %u elements", cElements);
+        RTSortU32(s_au32Copy, cElements);
+        if (memcmp(s_au32, s_au32Copy, cElements * sizeof(uint32_t)))
+            RTTestIFailed("RTSortU32 and RTSortRadixU32 disagree on %u elements", cElements);
+
+        /* Searching, comparing with a linear scan. */
+        for (unsigned iLookup = 0; iLookup < 64; iLookup++)
+        {
+            uint32_t const uKey = iLookup & 1 || !cElements ? RTRandAdvU32Ex(hRand, 0, uMax)
+                                : s_au32[RTRandAdvU32Ex(hRand, 0, cElements - 1)];
+            size_t iLower = 0;
+            while (iLower < cElements && s_au32[iLower] < uKey)
+                iLower++;
+            size_t iUpper = iLower;
+            while (iUpper < cElements && s_au32[iUpper] == uKey)
+                iUpper++;
+
+            RTTESTI_CHECK(RTSortLowerBoundU32(s_au32, cElements, uKey) == iLower);
+            RTTESTI_CHECK(RTSortUpperBoundU32(s_au32, cElements, uKey) == iUpper);
+            size_t iFound = ~(size_t)0;
+            RTTESTI_CHECK(RTSortBinarySearchU32(s_au32, cElements, uKey, &iFound) == (iLower != iUpper));
+            RTTESTI_CHECK(iFound == iLower);
+
+            RTTESTI_CHECK(RTSortLowerBound(s_au32, cElements, sizeof(uint32_t), &uKey, testU32Compare, NULL) == iLower);
+            RTTESTI_CHECK(RTSortUpperBound(s_au32, cElements, sizeof(uint32_t), &uKey, testU32Compare, NULL) == iUpper);
+            iFound = ~(size_t)0;
+            RTTESTI_CHECK(   RTSortBinarySearch(s_au32, cElements, sizeof(uint32_t), &uKey, testU32Compare, NULL, &iFound)
+                          == (iLower != iUpper));
+            RTTESTI_CHECK(iFound == iLower);
+        }
+    }
+
+    /* The signed variants must order negative numbers first. */
+    int32_t ai32[] = { 5, -1, INT32_MIN, 0, INT32_MAX, -7, 3 };
+    RTSortS32(ai32, RT_ELEMENTS(ai32));
+    RTTESTI_CHECK(RTSortIsSortedS32(ai32, RT_ELEMENTS(ai32)) && ai32[0] == INT32_MIN && ai32[6] == INT32_MAX);
+    RTTESTI_CHECK(RTSortLowerBoundS32(ai32, RT_ELEMENTS(ai32), -1) == 2);
+
+    RTRandAdvDestroy(hRand);
+}
+
+
+/**
+ * Tests the parallel sorting using a request pool.
+ */
+static void testParallel(RTTEST hTest)
+{
+    RTTestISub("RTSortParallel");
+
+    RTREQPOOL hPool;
+    RTTESTI_CHECK_RC_RETV(RTReqPoolCreate(4, 10000 /*cMsMinIdle*/, 4, 10, "tstRTSort", &hPool), VINF_SUCCESS);
+
+    RTRAND hRand;
+    RTTESTI_CHECK_RC_OK_RETV(RTRandAdvCreateParkMiller(&hRand));
+
+    static const uint32_t s_acElements[] = { 0, 1, 1000, 16384, 100000, 262144 + 3 };
+    for (unsigned iSize = 0; iSize < RT_ELEMENTS(s_acElements); iSize++)
+    {
+        uint32_t const cElements = s_acElements[iSize];
+        uint32_t      *pau32;
+        RTTESTI_CHECK_RC_OK_BREAK(RTTestGuardedAlloc(hTest, cElements * sizeof(uint32_t) + 1, 1 /*cbAlign*/,
+                                                     false /*fHead*/, (void **)&pau32));
+        uint64_t uSum = 0;
+        for (uint32_t i = 0; i < cElements; i++)
+            uSum += pau32[i] = RTRandAdvU32Ex(hRand, 0, iSize & 1 ? UINT32_MAX : 4096);
+
+        RTTESTI_CHECK_RC(RTSortParallel(hPool, pau32, cElements, sizeof(uint32_t), testU32Compare, NULL), VINF_SUCCESS);
+
+        if (!RTSortIsSortedU32(pau32, cElements))
+            RTTestIFailed("failed sorting %u elements", cElements);
+        for (uint32_t i = 0; i < cElements; i++)
+            uSum -= pau32[i];
+        if (uSum != 0)
+            RTTestIFailed("%u elements: elements lost or duplicated", cElements);
+        RTTestGuardedFree(hTest, pau32);
+    }
+
+    RTTESTI_CHECK(RTReqPoolRelease(hPool) == 0);
+    RTRandAdvDestroy(hRand);
+}
+
+
 int main()
 {
     RTTEST hTest;
@@ -147,6 +399,15 @@ int main()
      */
     testSorter(hTest, RTSortShell, "RTSortShell - shell sort, variable sized element array");
     testApvSorter(RTSortApvShell, "RTSortApvShell - shell sort, pointer array");
+    testSorter(hTest, RTSortIntro, "RTSortIntro - introspective sort, variable sized element array");
+    testApvSorter(RTSortApvIntro, "RTSortApvIntro - introspective sort, pointer array");
+    testSorter(hTest, testMergeSorter, "RTSortMerge - merge sort, variable sized element array");
+    testApvSorter(testApvMergeSorter, "RTSortApvMerge - merge sort, pointer array");
+    testPatterns(RTSortIntro, "RTSortIntro - patterns");
+    testPatterns(testMergeSorter, "RTSortMerge - patterns");
+    testStable();
+    testIntegers();
+    testParallel(hTest);
 
     /*
      * Summary.
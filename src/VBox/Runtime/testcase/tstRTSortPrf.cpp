@@ -0,0 +1,202 @@
+/* $Id$ */
+/** @file
+ * IPRT Testcase - Sorting Performance.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include <iprt/sort.h>
+
+#include <iprt/err.h>
+#include <iprt/mem.h>
+#include <iprt/mp.h>
+#include <iprt/rand.h>
+#include <iprt/req.h>
+#include <iprt/string.h>
+#include <iprt/test.h>
+#include <iprt/time.h>
+
+
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** The number of elements to sort. */
+#define TST_ELEMENTS    _256K
+
+
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
+static RTTEST       g_hTest;
+static RTREQPOOL    g_hPool = NIL_RTREQPOOL;
+/** The input data. */
+static uint32_t    *g_pau32Input;
+/** The array being sorted. */
+static uint32_t    *g_pau32Work;
+
+
+static DECLCALLBACK(int) tstCompareU32(void const *pvElement1, void const *pvElement2, void *pvUser)
+{
+    RT_NOREF(pvUser);
+    uint32_t const u1 = *(uint32_t const *)pvElement1;
+    uint32_t const u2 = *(uint32_t const *)pvElement2;
+    return u1 < u2 ? -1 : u1 > u2 ? 1 : 0;
+}
+
+
+/**
+ * The sorting methods we measure.
+ */
+static void tstSortOne(unsigned iMethod, uint32_t *pau32, size_t cElements)
+{
+    switch (iMethod)
+    {
+        case 0: RTSortShell(pau32, cElements, sizeof(uint32_t), tstCompareU32, NULL); break;
+        case 1: RTSortIntro(pau32, cElements, sizeof(uint32_t), tstCompareU32, NULL); break;
+        case 2: RTTESTI_CHECK_RC(RTSortMerge(pau32, cElements, sizeof(uint32_t), tstCompareU32, NULL), VINF_SUCCESS); break;
+        case 3: RTTESTI_CHECK_RC(RTSortParallel(g_hPool, pau32, cElements, sizeof(uint32_t), tstCompareU32, NULL), VINF_SUCCESS); break;
+        case 4: RTTESTI_CHECK_RC(RTSortRadixU32(pau32, cElements), VINF_SUCCESS); break;
+        case 5: RTSortU32(pau32, cElements); break;
+    }
+}
+
+static const char * const g_apszMethods[] =
+{
+    "RTSortShell",
+    "RTSortIntro",
+    "RTSortMerge",
+    "RTSortParallel",
+    "RTSortRadixU32",
+    "RTSortU32 (inline)",
+};
+
+
+/**
+ * Measures all the sorting methods on the current input.
+ */
+static void tstBenchSorting(const char *pszInput)
+{
+    RTTestSub(g_hTest, pszInput);
+    for (unsigned iMethod = 0; iMethod < RT_ELEMENTS(g_apszMethods); iMethod++)
+    {
+        uint64_t cNsBest = UINT64_MAX;
+        for (unsigned iRun = 0; iRun < 3; iRun++)
+        {
+            memcpy(g_pau32Work, g_pau32Input, TST_ELEMENTS * sizeof(uint32_t));
+            uint64_t const nsStart = RTTimeNanoTS();
+            tstSortOne(iMethod, g_pau32Work, TST_ELEMENTS);
+            uint64_t const cNsElapsed = RTTimeNanoTS() - nsStart;
+            cNsBest = RT_MIN(cNsBest, cNsElapsed);
+            if (!RTSortIsSortedU32(g_pau32Work, TST_ELEMENTS))
+                RTTestFailed(g_hTest, "%s failed to sort %s input", g_apszMethods[iMethod], pszInput);
+        }
+        RTTestValueF(g_hTest, cNsBest / TST_ELEMENTS, RTTESTUNIT_NS_PER_OCCURRENCE, "%s", g_apszMethods[iMethod]);
+    }
+}
+
+
+/**
+ * Measures lookups in the sorted input.
+ */
+static void tstBenchSearching(void)
+{
+    RTTestSub(g_hTest, "Searching");
+    uint32_t const cLookups = _1M;
+    uint64_t       cFound   = 0;
+
+    uint64_t nsStart = RTTimeNanoTS();
+    for (uint32_t i = 0; i < cLookups; i++)
+    {
+        uint32_t const uKey = i * UINT32_C(0x9e3779b9);
+        cFound += RTSortBinarySearch(g_pau32Work, TST_ELEMENTS, sizeof(uint32_t), &uKey, tstCompareU32, NULL, NULL);
+    }
+    RTTestValue(g_hTest, "RTSortBinarySearch", (RTTimeNanoTS() - nsStart) / cLookups, RTTESTUNIT_NS_PER_CALL);
+
+    nsStart = RTTimeNanoTS();
+    for (uint32_t i = 0; i < cLookups; i++)
+        cFound += RTSortBinarySearchU32(g_pau32Work, TST_ELEMENTS, i * UINT32_C(0x9e3779b9), NULL);
+    RTTestValue(g_hTest, "RTSortBinarySearchU32 (inline)", (RTTimeNanoTS() - nsStart) / cLookups, RTTESTUNIT_NS_PER_CALL);
+
+    RTTestPrintf(g_hTest, RTTESTLVL_DEBUG, "cFound=%RU64\n", cFound);
+}
+
+
+int main()
+{
+    RTEXITCODE rcExit = RTTestInitAndCreate("tstRTSortPrf", &g_hTest);
+    if (rcExit != RTEXITCODE_SUCCESS)
+        return rcExit;
+    RTTestBanner(g_hTest);
+
+    g_pau32Input = (uint32_t *)RTMemAlloc(TST_ELEMENTS * sizeof(uint32_t));
+    g_pau32Work  = (uint32_t *)RTMemAlloc(TST_ELEMENTS * sizeof(uint32_t));
+    RTTESTI_CHECK_RET(g_pau32Input && g_pau32Work, RTEXITCODE_FAILURE);
+
+    uint32_t const cCpus = RT_MAX(RTMpGetOnlineCount(), 1);
+    int rc = RTReqPoolCreate(cCpus, RT_MS_1MIN, cCpus, 0, "tstRTSortPrf", &g_hPool);
+    if (RT_FAILURE(rc))
+        RTTestFailed(g_hTest, "RTReqPoolCreate -> %Rrc", rc);
+    RTTestPrintf(g_hTest, RTTESTLVL_ALWAYS, "%u elements, %u CPUs\n", TST_ELEMENTS, cCpus);
+
+    RTRAND hRand;
+    RTTESTI_CHECK_RC_OK_RET(RTRandAdvCreateParkMiller(&hRand), RTEXITCODE_FAILURE);
+    RTRandAdvSeed(hRand, 42);
+
+    /*
+     * Random, sorted, reverse sorted, mostly sorted and few unique values.
+     */
+    for (uint32_t i = 0; i < TST_ELEMENTS; i++)
+        g_pau32Input[i] = RTRandAdvU32(hRand);
+    tstBenchSorting("Random");
+    tstBenchSearching();
+
+    for (uint32_t i = 0; i < TST_ELEMENTS; i++)
+        g_pau32Input[i] = i;
+    tstBenchSorting("Sorted");
+
+    for (uint32_t i = 0; i < TST_ELEMENTS; i++)
+        g_pau32Input[i] = TST_ELEMENTS - i;
+    tstBenchSorting("Reversed");
+
+    for (uint32_t i = 0; i < TST_ELEMENTS; i++)
+        g_pau32Input[i] = i % 64 ? i : RTRandAdvU32(hRand);
+    tstBenchSorting("Mostly sorted");
+
+    for (uint32_t i = 0; i < TST_ELEMENTS; i++)
+        g_pau32Input[i] = RTRandAdvU32Ex(hRand, 0, 15);
+    tstBenchSorting("Few unique");
+
+    RTRandAdvDestroy(hRand);
+    RTReqPoolRelease(g_hPool);
+    RTMemFree(g_pau32Input);
+    RTMemFree(g_pau32Work);
+
+    /*
+     * Summary.
+     */
+    return RTTestSummaryAndDestroy(g_hTest);
+}
+
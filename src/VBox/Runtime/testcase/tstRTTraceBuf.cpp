@@ -0,0 +1,407 @@
+/* $Id$ */
+/** @file
+ * IPRT Testcase - Trace buffers.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include <iprt/trace.h>
+
+#include <iprt/asm.h>
+#include <iprt/err.h>
+#include <iprt/mem.h>
+#include <iprt/string.h>
+#include <iprt/test.h>
+#include <iprt/thread.h>
+#include <iprt/time.h>
+
+
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** The number of writer threads in the concurrency test. */
+#define TST_THREADS             4
+/** The number of events each writer thread adds (multiple of 32). */
+#define TST_EVENTS_PER_THREAD   256
+/** The number of events added by the benchmark. */
+#define TST_BENCH_EVENTS        _1M
+
+
+/*********************************************************************************************************************************
+*   Structures and Typedefs                                                                                                      *
+*********************************************************************************************************************************/
+/**
+ * Enumeration state.
+ */
+typedef struct TSTENUM
+{
+    /** Number of records seen. */
+    uint32_t            cRecords;
+    /** Number of text messages seen. */
+    uint32_t            cMsgs;
+    /** The time stamp of the previous record. */
+    uint64_t            uPrevTS;
+    /** Whether to check that the time stamps are ascending. */
+    bool                fCheckOrder;
+    /** Per thread bitmaps of the sequence numbers seen (concurrency test). */
+    uint32_t            abmSeen[TST_THREADS][TST_EVENTS_PER_THREAD / 32];
+} TSTENUM;
+/** Pointer to enumeration state. */
+typedef TSTENUM *PTSTENUM;
+
+/**
+ * Writer thread arguments.
+ */
+typedef struct TSTWRITER
+{
+    /** The trace buffer. */
+    RTTRACEBUF          hTraceBuf;
+    /** The thread number. */
+    uint64_t            iThread;
+    /** The thread handle. */
+    RTTHREAD            hThread;
+} TSTWRITER;
+/** Pointer to writer thread arguments. */
+typedef TSTWRITER *PTSTWRITER;
+
+
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
+/** The test handle. */
+static RTTEST               g_hTest;
+/** Set when the writer threads should start adding events. */
+static bool volatile        g_fGo;
+
+
+/**
+ * @callback_method_impl{FNRTTRACEBUFRECCALLBACK}
+ */
+static DECLCALLBACK(int) tstEnumRecord(RTTRACEBUF hTraceBuf, uint32_t iEntry, PCRTTRACEBUFRECORD pRecord, void *pvUser)
+{
+    PTSTENUM pState = (PTSTENUM)pvUser;
+    RT_NOREF2(hTraceBuf, iEntry);
+
+    if (pState->fCheckOrder && pRecord->NanoTS < pState->uPrevTS)
+        RTTestIFailed("Record #%u out of order: %RU64 < %RU64\n", pState->cRecords, pRecord->NanoTS, pState->uPrevTS);
+    pState->uPrevTS = pRecord->NanoTS;
+
+    if (pRecord->idEvent == RTTRACEBUF_EVENT_ID_MSG)
+    {
+        RTTESTI_CHECK(pRecord->pszMsg != NULL);
+        RTTESTI_CHECK(pRecord->cArgs == 0);
+        pState->cMsgs++;
+    }
+    else
+    {
+        RTTESTI_CHECK(pRecord->pszMsg == NULL);
+        RTTESTI_CHECK(pRecord->pau64Args != NULL);
+        if (pRecord->idEvent == 42)
+        {
+            /* Concurrency test: thread, sequence number and a check value. */
+            RTTESTI_CHECK_RET(pRecord->cArgs == 4, VERR_MISMATCH);
+            uint64_t const iThread = pRecord->pau64Args[0];
+            uint64_t const iSeq    = pRecord->pau64Args[1];
+            RTTESTI_CHECK_RET(iThread < TST_THREADS && iSeq < TST_EVENTS_PER_THREAD, VERR_MISMATCH);
+            RTTESTI_CHECK(pRecord->pau64Args[2] == ~(iThread * TST_EVENTS_PER_THREAD + iSeq));
+            if (ASMBitTestAndSet(&pState->abmSeen[iThread][0], (int32_t)iSeq))
+                RTTestIFailed("Duplicate event %RU64/%RU64\n", iThread, iSeq);
+        }
+    }
+    pState->cRecords++;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * @callback_method_impl{FNRTTRACEBUFCALLBACK}
+ */
+static DECLCALLBACK(int) tstEnumEntry(RTTRACEBUF hTraceBuf, uint32_t iEntry, uint64_t NanoTS, RTCPUID idCpu,
+                                      const char *pszMsg, void *pvUser)
+{
+    uint32_t *pcEntries = (uint32_t *)pvUser;
+    RT_NOREF4(hTraceBuf, iEntry, NanoTS, idCpu);
+    RTTESTI_CHECK(pszMsg != NULL);
+    if (   *pcEntries == 0
+        && strcmp(pszMsg, "event 0x7: 0x1 0x2 0x3 0x4"))
+        RTTestIFailed("Unexpected first entry text '%s'\n", pszMsg);
+    *pcEntries += 1;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Basic message and binary event recording in a single and a per-CPU buffer.
+ */
+static void tstBasics(uint32_t fFlags)
+{
+    RTTestISubF("Basics (fFlags=%#x)", fFlags);
+
+    /* Records from one thread go into one ring, so give each ring room for
+       all of them regardless of the host CPU count (64 rings at most). */
+    uint32_t const cEntriesCreate = fFlags & RTTRACEBUF_FLAGS_PER_CPU ? 256 * 64 : 256;
+    RTTRACEBUF hTraceBuf;
+    RTTESTI_CHECK_RC_RETV(RTTraceBufCreate(&hTraceBuf, cEntriesCreate, 64, fFlags), VINF_SUCCESS);
+    RTTESTI_CHECK(RTTraceBufGetEntrySize(hTraceBuf) == 64);
+    RTTESTI_CHECK(RTTraceBufGetEntryCount(hTraceBuf) >= cEntriesCreate);
+    RTTESTI_CHECK(RTTraceBufGetMaxEventArgs(hTraceBuf) == 4);
+
+    /* An empty buffer. */
+    TSTENUM State;
+    RT_ZERO(State);
+    State.fCheckOrder = true;
+    RTTESTI_CHECK_RC(RTTraceBufEnumRecords(hTraceBuf, tstEnumRecord, &State), VINF_SUCCESS);
+    RTTESTI_CHECK(State.cRecords == 0);
+
+    /* Mixed records. */
+    RTTESTI_CHECK_RC(RTTraceBufAddEvent(hTraceBuf, 7, 1, 2, 3, 4), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTTraceBufAddMsg(hTraceBuf, "hello"), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTTraceBufAddMsgF(hTraceBuf, "value %u", 42), VINF_SUCCESS);
+
+    uint64_t au64Args[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    RTTESTI_CHECK_RC(RTTraceBufAddEventEx(hTraceBuf, 8, au64Args, 2), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTTraceBufAddEventEx(hTraceBuf, 9, au64Args, 8), VERR_BUFFER_OVERFLOW);
+    RTTESTI_CHECK_RC(RTTraceBufAddEventEx(hTraceBuf, 10, NULL, 0), VINF_SUCCESS);
+
+    RT_ZERO(State);
+    State.fCheckOrder = true;
+    RTTESTI_CHECK_RC(RTTraceBufEnumRecords(hTraceBuf, tstEnumRecord, &State), VINF_SUCCESS);
+    RTTESTI_CHECK(State.cRecords == 6);
+    RTTESTI_CHECK(State.cMsgs == 2);
+
+    uint32_t cEntries = 0;
+    RTTESTI_CHECK_RC(RTTraceBufEnumEntries(hTraceBuf, tstEnumEntry, &cEntries), VINF_SUCCESS);
+    RTTESTI_CHECK(cEntries == 6);
+
+    /* Disabled buffers don't record anything. */
+    RTTESTI_CHECK(RTTraceBufDisable(hTraceBuf) == true);
+    RTTESTI_CHECK_RC(RTTraceBufAddEvent(hTraceBuf, 7, 1, 2, 3, 4), VINF_SUCCESS);
+    RTTESTI_CHECK(RTTraceBufEnable(hTraceBuf) == false);
+    RT_ZERO(State);
+    RTTESTI_CHECK_RC(RTTraceBufEnumRecords(hTraceBuf, tstEnumRecord, &State), VINF_SUCCESS);
+    RTTESTI_CHECK(State.cRecords == 6);
+
+    /* Wrap around a few times; the oldest entries are overwritten, order is kept. */
+    for (uint32_t i = 0; i < cEntriesCreate * 2; i++)
+        RTTESTI_CHECK_RC_BREAK(RTTraceBufAddEvent(hTraceBuf, 11, i, 0, 0, 0), VINF_SUCCESS);
+    RT_ZERO(State);
+    State.fCheckOrder = true;
+    RTTESTI_CHECK_RC(RTTraceBufEnumRecords(hTraceBuf, tstEnumRecord, &State), VINF_SUCCESS);
+    RTTESTI_CHECK(State.cRecords > 0 && State.cRecords <= RTTraceBufGetEntryCount(hTraceBuf));
+    RTTESTI_CHECK(State.cMsgs == 0);
+
+    RTTESTI_CHECK(RTTraceBufRelease(hTraceBuf) == 0);
+}
+
+
+/**
+ * Carving a buffer out of a caller supplied block.
+ */
+static void tstCarve(void)
+{
+    RTTestISub("Carve");
+
+    RTTRACEBUF hTraceBuf;
+    size_t     cbBlock = 0;
+    RTTESTI_CHECK_RC_RETV(RTTraceBufCarve(&hTraceBuf, 64, 128, RTTRACEBUF_FLAGS_PER_CPU, NULL, &cbBlock),
+                          VERR_BUFFER_OVERFLOW);
+    RTTESTI_CHECK_RETV(cbBlock >= 64 * 128);
+
+    void *pvBlock = RTMemAlloc(cbBlock);
+    RTTESTI_CHECK_RETV(pvBlock != NULL);
+    size_t cbLeft = cbBlock;
+    int rc = RTTraceBufCarve(&hTraceBuf, 64, 128, RTTRACEBUF_FLAGS_PER_CPU, pvBlock, &cbLeft);
+    RTTESTI_CHECK_RC(rc, VINF_SUCCESS);
+    if (RT_SUCCESS(rc))
+    {
+        RTTESTI_CHECK((void *)hTraceBuf == pvBlock);
+        RTTESTI_CHECK(RTTraceBufGetMaxEventArgs(hTraceBuf) == 12);
+        RTTESTI_CHECK_RC(RTTraceBufAddMsg(hTraceBuf, "carved"), VINF_SUCCESS);
+        TSTENUM State;
+        RT_ZERO(State);
+        RTTESTI_CHECK_RC(RTTraceBufEnumRecords(hTraceBuf, tstEnumRecord, &State), VINF_SUCCESS);
+        RTTESTI_CHECK(State.cMsgs == 1);
+        RTTESTI_CHECK(RTTraceBufRelease(hTraceBuf) == 0);
+    }
+    RTMemFree(pvBlock);
+}
+
+
+/**
+ * Writer thread for the concurrency test.
+ */
+static DECLCALLBACK(int) tstWriterThread(RTTHREAD hSelf, void *pvUser)
+{
+    PTSTWRITER pWriter = (PTSTWRITER)pvUser;
+    RT_NOREF(hSelf);
+    while (!ASMAtomicReadBool(&g_fGo))
+        RTThreadYield();
+    for (uint64_t iSeq = 0; iSeq < TST_EVENTS_PER_THREAD; iSeq++)
+        RTTraceBufAddEvent(pWriter->hTraceBuf, 42, pWriter->iThread, iSeq,
+                           ~(pWriter->iThread * TST_EVENTS_PER_THREAD + iSeq), 0);
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Several threads adding events concurrently.
+ */
+static void tstConcurrency(uint32_t fFlags)
+{
+    RTTestISubF("Concurrency (fFlags=%#x)", fFlags);
+
+    RTTRACEBUF hTraceBuf;
+    RTTESTI_CHECK_RC_RETV(RTTraceBufCreate(&hTraceBuf, _64K, 64, fFlags), VINF_SUCCESS);
+
+    TSTWRITER aWriters[TST_THREADS];
+    ASMAtomicWriteBool(&g_fGo, false);
+    for (uint32_t i = 0; i < TST_THREADS; i++)
+    {
+        aWriters[i].hTraceBuf = hTraceBuf;
+        aWriters[i].iThread   = i;
+        aWriters[i].hThread   = NIL_RTTHREAD;
+        RTTESTI_CHECK_RC(RTThreadCreate(&aWriters[i].hThread, tstWriterThread, &aWriters[i], 0, RTTHREADTYPE_DEFAULT,
+                                        RTTHREADFLAGS_WAITABLE, "tstWriter"), VINF_SUCCESS);
+    }
+    ASMAtomicWriteBool(&g_fGo, true);
+    for (uint32_t i = 0; i < TST_THREADS; i++)
+        if (aWriters[i].hThread != NIL_RTTHREAD)
+            RTTESTI_CHECK_RC(RTThreadWait(aWriters[i].hThread, RT_MS_1MIN, NULL), VINF_SUCCESS);
+
+    /* Every sub-buffer has room for all the events, so none may be lost. */
+    TSTENUM State;
+    RT_ZERO(State);
+    RTTESTI_CHECK_RC(RTTraceBufEnumRecords(hTraceBuf, tstEnumRecord, &State), VINF_SUCCESS);
+    RTTESTI_CHECK(State.cRecords == TST_THREADS * TST_EVENTS_PER_THREAD);
+    for (uint32_t i = 0; i < TST_THREADS; i++)
+        RTTESTI_CHECK(ASMBitFirstClear(&State.abmSeen[i][0], TST_EVENTS_PER_THREAD) == -1);
+
+    RTTESTI_CHECK(RTTraceBufRelease(hTraceBuf) == 0);
+}
+
+
+/**
+ * @callback_method_impl{FNRTDUMPPRINTFV, Appends to a string buffer.}
+ */
+static DECLCALLBACK(void) tstExportPrintfV(void *pvUser, const char *pszFormat, va_list va)
+{
+    char   *pszBuf = (char *)pvUser;
+    size_t  cch    = strlen(pszBuf);
+    RTStrPrintfV(&pszBuf[cch], _4K - cch, pszFormat, va);
+}
+
+
+/**
+ * Chrome trace event format export.
+ */
+static void tstExport(void)
+{
+    RTTestISub("Chrome trace export");
+
+    RTTRACEBUF hTraceBuf;
+    RTTESTI_CHECK_RC_RETV(RTTraceBufCreate(&hTraceBuf, 16, 64, 0), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTTraceBufAddMsg(hTraceBuf, "a \"quoted\"\\msg"), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTTraceBufAddEvent(hTraceBuf, 1, 10, 20, 0, 0), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTTraceBufAddEvent(hTraceBuf, 2, 30, 0, 0, 0), VINF_SUCCESS);
+
+    static const char * const s_apszArgs[] = { "port", "value" };
+    static const RTTRACEBUFEVTDESC s_aDescs[] =
+    {
+        { 1, 2, "io-write", "pdm", s_apszArgs },
+    };
+    char *pszBuf = (char *)RTMemAllocZ(_4K);
+    RTTESTI_CHECK_RETV(pszBuf != NULL);
+    RTTESTI_CHECK_RC(RTTraceBufExportChromeTrace(hTraceBuf, s_aDescs, RT_ELEMENTS(s_aDescs), tstExportPrintfV, pszBuf),
+                     VINF_SUCCESS);
+
+    RTTESTI_CHECK(!strncmp(pszBuf, RT_STR_TUPLE("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[")));
+    RTTESTI_CHECK(strstr(pszBuf, "\"msg\":\"a \\\"quoted\\\"\\\\msg\"") != NULL);
+    RTTESTI_CHECK(strstr(pszBuf, "\"name\":\"io-write\",\"cat\":\"pdm\"") != NULL);
+    RTTESTI_CHECK(strstr(pszBuf, "\"args\":{\"port\":10,\"value\":20}") != NULL);
+    RTTESTI_CHECK(strstr(pszBuf, "\"name\":\"event-0x2\"") != NULL);
+    RTTESTI_CHECK(strstr(pszBuf, "\"args\":{\"arg1\":30,\"arg2\":0,\"arg3\":0,\"arg4\":0}") != NULL);
+    RTTESTI_CHECK(!strcmp(strchr(pszBuf, '\0') - 4, "\n]}\n"));
+    if (RTTestIErrorCount())
+        RTTestIPrintf(RTTESTLVL_ALWAYS, "%s", pszBuf);
+
+    RTMemFree(pszBuf);
+    RTTESTI_CHECK(RTTraceBufRelease(hTraceBuf) == 0);
+}
+
+
+/**
+ * Compares the cost of binary events and formatted messages.
+ */
+static void tstBenchmark(void)
+{
+    RTTestISub("Benchmark");
+
+    static const char * const s_apszNames[] = { "shared", "per-cpu" };
+    for (uint32_t iBuf = 0; iBuf < RT_ELEMENTS(s_apszNames); iBuf++)
+    {
+        RTTRACEBUF hTraceBuf;
+        RTTESTI_CHECK_RC_BREAK(RTTraceBufCreate(&hTraceBuf, _16K, 64, iBuf ? RTTRACEBUF_FLAGS_PER_CPU : 0), VINF_SUCCESS);
+
+        uint64_t nsStart = RTTimeNanoTS();
+        for (uint32_t i = 0; i < TST_BENCH_EVENTS; i++)
+            RTTraceBufAddEvent(hTraceBuf, 1, i, 0x1000, 0, 0);
+        RTTestIValueF((RTTimeNanoTS() - nsStart) / TST_BENCH_EVENTS, RTTESTUNIT_NS_PER_CALL, "%s event", s_apszNames[iBuf]);
+
+        nsStart = RTTimeNanoTS();
+        for (uint32_t i = 0; i < TST_BENCH_EVENTS; i++)
+            RTTraceBufAddMsgF(hTraceBuf, "event %u %#x", i, 0x1000);
+        RTTestIValueF((RTTimeNanoTS() - nsStart) / TST_BENCH_EVENTS, RTTESTUNIT_NS_PER_CALL, "%s message", s_apszNames[iBuf]);
+
+        RTTESTI_CHECK(RTTraceBufRelease(hTraceBuf) == 0);
+    }
+}
+
+
+int main()
+{
+    RTEXITCODE rcExit = RTTestInitAndCreate("tstRTTraceBuf", &g_hTest);
+    if (rcExit != RTEXITCODE_SUCCESS)
+        return rcExit;
+    RTTestBanner(g_hTest);
+
+    /*
+     * Testing.
+     */
+    tstBasics(0);
+    tstBasics(RTTRACEBUF_FLAGS_PER_CPU);
+    tstCarve();
+    tstConcurrency(0);
+    tstConcurrency(RTTRACEBUF_FLAGS_PER_CPU);
+    tstExport();
+    if (!RTTestIErrorCount())
+        tstBenchmark();
+
+    /*
+     * Summary.
+     */
+    return RTTestSummaryAndDestroy(g_hTest);
+}
+
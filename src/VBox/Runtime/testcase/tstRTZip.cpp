@@ -39,6 +39,60 @@
 #include <iprt/param.h>
 #include <iprt/string.h>
 #include <iprt/test.h>
+#include <iprt/vfs.h>
+
+
+/*********************************************************************************************************************************
+*   Structures and Typedefs                                                                                                      *
+*********************************************************************************************************************************/
+/** Memory buffer for the stream tests. */
+typedef struct TSTRTZIPBUF
+{
+    uint8_t    *pb;
+    size_t      cb;
+    size_t      cbMax;
+    size_t      off;
+} TSTRTZIPBUF;
+typedef TSTRTZIPBUF *PTSTRTZIPBUF;
+
+
+/**
+ * Fills a buffer with something resembling guest memory: zero pages, runs of
+ * repeated text and structures, and some noise.
+ */
+static void tstRTZipFillData(uint8_t *pb, size_t cb)
+{
+    static const char s_szText[] = "The quick brown fox jumps over the lazy dog; 0123456789 ABCDEF.\n";
+    uint32_t uSeed = 0x19283746;
+    size_t   off   = 0;
+    while (off < cb)
+    {
+        uSeed = uSeed * 1103515245 + 12345;
+        size_t const cbChunk = RT_MIN(cb - off, (size_t)(uSeed >> 20) + 1);
+        switch ((uSeed >> 8) & 3)
+        {
+            case 0:
+                memset(&pb[off], 0, cbChunk);
+                break;
+            case 1:
+                for (size_t i = 0; i < cbChunk; i++)
+                    pb[off + i] = s_szText[(i + (uSeed >> 12)) % (sizeof(s_szText) - 1)];
+                break;
+            case 2:
+                for (size_t i = 0; i < cbChunk; i++)
+                    pb[off + i] = i & 3 ? 0 : (uint8_t)(i >> 2);
+                break;
+            default:
+                for (size_t i = 0; i < cbChunk; i++)
+                {
+                    uSeed = uSeed * 1103515245 + 12345;
+                    pb[off + i] = (uint8_t)(uSeed >> 16);
+                }
+                break;
+        }
+        off += cbChunk;
+    }
+}
 
 
 static void testFile(const char *pszFilename)
@@ -61,6 +115,246 @@ static void testFile(const char *pszFilename)
 }
 
 
+static void testBlock(RTZIPTYPE enmType, RTZIPLEVEL enmLevel, const char *pszName)
+{
+    RTTestISubF("Block %s", pszName);
+
+    static size_t const s_acbSizes[] = { 0, 1, 5, 12, 13, 17, 64, 255, 256, 1000, _4K, _4K + 3, _32K, _64K + 1, _256K };
+    size_t const  cbMax = _256K;
+    uint8_t      *pbSrc = (uint8_t *)RTTestGuardedAllocTail(NIL_RTTEST, cbMax);
+    uint8_t      *pbDst = (uint8_t *)RTMemAlloc(cbMax * 2 + 64);
+    uint8_t      *pbOut = (uint8_t *)RTMemAlloc(cbMax);
+    RTTESTI_CHECK_RETV(pbSrc && pbDst && pbOut);
+    tstRTZipFillData(pbSrc, cbMax);
+
+    for (unsigned i = 0; i < RT_ELEMENTS(s_acbSizes); i++)
+    {
+        size_t const   cbSrc = s_acbSizes[i];
+        uint8_t const *pbIn  = pbSrc + cbMax - cbSrc;   /* hits the guard page if we read too far */
+        if (cbSrc == 1 && enmType == RTZIPTYPE_LZF)
+            continue; /* lzf_compress always reads two bytes */
+        size_t cbDst = 0;
+        int rc = RTZipBlockCompress(enmType, enmLevel, 0, pbIn, cbSrc, pbDst, cbMax * 2 + 64, &cbDst);
+        if (rc == VERR_BUFFER_OVERFLOW && enmType == RTZIPTYPE_LZF)
+            continue; /* lzf doesn't store incompressible blocks */
+        RTTESTI_CHECK_MSG_RETV(RT_SUCCESS(rc), ("cbSrc=%zu rc=%Rrc\n", cbSrc, rc));
+
+        size_t cbOut = 0;
+        rc = RTZipBlockDecompress(enmType, 0, pbDst, cbDst, NULL, pbOut, cbMax, &cbOut);
+        RTTESTI_CHECK_MSG(RT_SUCCESS(rc) && cbOut == cbSrc && !memcmp(pbOut, pbIn, cbSrc),
+                          ("cbSrc=%zu cbDst=%zu cbOut=%zu rc=%Rrc\n", cbSrc, cbDst, cbOut, rc));
+
+        /* A too small output buffer must be refused, not overrun. */
+        if (cbDst > 1 && enmType == RTZIPTYPE_LZ4)
+        {
+            size_t cbIgn;
+            RTTESTI_CHECK_RC(RTZipBlockCompress(enmType, enmLevel, 0, pbIn, cbSrc, pbDst, cbDst - 1, &cbIgn),
+                             VERR_BUFFER_OVERFLOW);
+            if (cbSrc > 0)
+                RTTESTI_CHECK_RC(RTZipBlockDecompress(enmType, 0, pbDst, cbDst, NULL, pbOut, cbSrc - 1, &cbIgn),
+                                 VERR_BUFFER_OVERFLOW);
+        }
+    }
+
+    /* Corrupted LZ4 input must fail gracefully. */
+    if (enmType == RTZIPTYPE_LZ4)
+    {
+        size_t cbDst = 0;
+        RTTESTI_CHECK_RC_OK_RETV(RTZipBlockCompress(enmType, enmLevel, 0, pbSrc, _64K, pbDst, cbMax * 2, &cbDst));
+        uint32_t uSeed = 42;
+        for (unsigned i = 0; i < 2048; i++)
+        {
+            uSeed = uSeed * 1103515245 + 12345;
+            size_t const  off  = (uSeed >> 8) % cbDst;
+            uint8_t const bOld = pbDst[off];
+            pbDst[off] ^= (uint8_t)(uSeed >> 24) | 1;
+            size_t cbOut;
+            RTZipBlockDecompress(enmType, 0, pbDst, cbDst, NULL, pbOut, _64K, &cbOut);
+            RTZipBlockDecompress(enmType, 0, pbDst, off, NULL, pbOut, _64K, &cbOut);
+            pbDst[off] = bOld;
+        }
+    }
+
+    RTMemFree(pbOut);
+    RTMemFree(pbDst);
+    RTTestGuardedFree(NIL_RTTEST, pbSrc);
+}
+
+
+static DECLCALLBACK(int) tstRTZipBufOut(void *pvUser, const void *pvBuf, size_t cbBuf)
+{
+    PTSTRTZIPBUF pBuf = (PTSTRTZIPBUF)pvUser;
+    if (pBuf->cb + cbBuf > pBuf->cbMax)
+        return VERR_BUFFER_OVERFLOW;
+    memcpy(&pBuf->pb[pBuf->cb], pvBuf, cbBuf);
+    pBuf->cb += cbBuf;
+    return VINF_SUCCESS;
+}
+
+
+static DECLCALLBACK(int) tstRTZipBufIn(void *pvUser, void *pvBuf, size_t cbBuf, size_t *pcbBuf)
+{
+    PTSTRTZIPBUF pBuf = (PTSTRTZIPBUF)pvUser;
+    size_t cb = RT_MIN(cbBuf, pBuf->cb - pBuf->off);
+    if (!pcbBuf && cb != cbBuf)
+        return VERR_EOF;
+    memcpy(pvBuf, &pBuf->pb[pBuf->off], cb);
+    pBuf->off += cb;
+    if (pcbBuf)
+        *pcbBuf = cb;
+    return VINF_SUCCESS;
+}
+
+
+static void testStream(RTZIPTYPE enmType, RTZIPLEVEL enmLevel, const char *pszName)
+{
+    RTTestISubF("Stream %s", pszName);
+
+    size_t const cbData = _1M + 1234;
+    uint8_t     *pbData = (uint8_t *)RTMemAlloc(cbData);
+    uint8_t     *pbOut  = (uint8_t *)RTMemAlloc(cbData);
+    TSTRTZIPBUF  Buf;
+    Buf.cbMax = cbData * 2;
+    Buf.cb    = 0;
+    Buf.off   = 0;
+    Buf.pb    = (uint8_t *)RTMemAlloc(Buf.cbMax);
+    RTTESTI_CHECK_RETV(pbData && pbOut && Buf.pb);
+    tstRTZipFillData(pbData, cbData);
+
+    /* Compress using a mix of tiny and large writes. */
+    PRTZIPCOMP pZip;
+    RTTESTI_CHECK_RC_OK_RETV(RTZipCompCreate(&pZip, &Buf, tstRTZipBufOut, enmType, enmLevel));
+    uint32_t uSeed = 7;
+    size_t   off   = 0;
+    while (off < cbData)
+    {
+        uSeed = uSeed * 1103515245 + 12345;
+        size_t cb = (uSeed >> 16) & 1 ? (uSeed >> 20) % 200 : (uSeed >> 12) % (_128K + 1);
+        cb = RT_MIN(cb, cbData - off);
+        RTTESTI_CHECK_RC_OK_RETV(RTZipCompress(pZip, &pbData[off], cb));
+        off += cb;
+    }
+    RTTESTI_CHECK_RC_OK_RETV(RTZipCompFinish(pZip));
+    RTTESTI_CHECK_RC_OK_RETV(RTZipCompDestroy(pZip));
+    RTTestIPrintf(RTTESTLVL_ALWAYS, "%s: %zu -> %zu bytes\n", pszName, cbData, Buf.cb);
+
+    /* Decompress using reads of varying size. */
+    PRTZIPDECOMP pUnzip;
+    RTTESTI_CHECK_RC_OK_RETV(RTZipDecompCreate(&pUnzip, &Buf, tstRTZipBufIn));
+    off = 0;
+    while (off < cbData)
+    {
+        uSeed = uSeed * 1103515245 + 12345;
+        size_t cb = (uSeed >> 16) & 1 ? (uSeed >> 20) % 200 + 1 : (uSeed >> 12) % _128K + 1;
+        cb = RT_MIN(cb, cbData - off);
+        RTTESTI_CHECK_RC_OK_BREAK(RTZipDecompress(pUnzip, &pbOut[off], cb, NULL));
+        off += cb;
+    }
+    RTTESTI_CHECK_RC_OK(RTZipDecompDestroy(pUnzip));
+    RTTESTI_CHECK(off == cbData && !memcmp(pbOut, pbData, cbData));
+
+    RTMemFree(Buf.pb);
+    RTMemFree(pbOut);
+    RTMemFree(pbData);
+}
+
+
+static void testGzip(void)
+{
+    RTTestISub("Parallel gzip and indexed gunzip");
+
+    size_t const cbData = _4M + _64K + 123;
+    uint8_t     *pbData = (uint8_t *)RTMemAlloc(cbData);
+    uint8_t     *pbOut  = (uint8_t *)RTMemAlloc(cbData);
+    RTTESTI_CHECK_RETV(pbData && pbOut);
+    tstRTZipFillData(pbData, cbData);
+
+    /*
+     * Compress into a memory file using a mix of write sizes and a flush.
+     */
+    RTVFSFILE hVfsFileGz;
+    RTTESTI_CHECK_RC_OK_RETV(RTVfsMemFileCreate(NIL_RTVFSIOSTREAM, cbData, &hVfsFileGz));
+    RTVFSIOSTREAM hVfsIosGz = RTVfsFileToIoStream(hVfsFileGz);
+    RTVFSIOSTREAM hVfsIos;
+    RTTESTI_CHECK_RC_OK_RETV(RTZipGzipCompressIoStream(hVfsIosGz, RTZIPGZIPCOMP_F_PARALLEL, 6, &hVfsIos));
+    uint32_t uSeed = 42;
+    size_t   off   = 0;
+    while (off < cbData)
+    {
+        uSeed = uSeed * 1103515245 + 12345;
+        size_t cb = (uSeed >> 16) & 1 ? (uSeed >> 20) % 200 : (uSeed >> 12) % (_256K + 1);
+        cb = RT_MIN(cb, cbData - off);
+        RTTESTI_CHECK_RC_OK_BREAK(RTVfsIoStrmWrite(hVfsIos, &pbData[off], cb, true /*fBlocking*/, NULL));
+        off += cb;
+        if (off > cbData / 2 && off - cb <= cbData / 2)
+            RTTESTI_CHECK_RC_OK(RTVfsIoStrmFlush(hVfsIos));
+    }
+    RTTESTI_CHECK(RTVfsIoStrmRelease(hVfsIos) == 0);
+    uint64_t cbGz = 0;
+    RTTESTI_CHECK_RC_OK(RTVfsFileGetSize(hVfsFileGz, &cbGz));
+    RTTestIPrintf(RTTESTLVL_ALWAYS, "gzip: %zu -> %RU64 bytes\n", cbData, cbGz);
+
+    /*
+     * The regular gunzip stream must see a single member with all the data.
+     */
+    RTTESTI_CHECK_RC_OK(RTVfsFileSeek(hVfsFileGz, 0, RTFILE_SEEK_BEGIN, NULL));
+    RTTESTI_CHECK_RC_OK(RTZipGzipDecompressIoStream(hVfsIosGz, 0 /*fFlags*/, &hVfsIos));
+    if (hVfsIos != NIL_RTVFSIOSTREAM)
+    {
+        size_t cbRead = 0;
+        RTTESTI_CHECK_RC_OK(RTVfsIoStrmRead(hVfsIos, pbOut, cbData, true /*fBlocking*/, NULL));
+        RTTESTI_CHECK(!memcmp(pbOut, pbData, cbData));
+        RTTESTI_CHECK_RC(RTVfsIoStrmRead(hVfsIos, pbOut, 1, true /*fBlocking*/, &cbRead), VINF_EOF);
+        RTVfsIoStrmRelease(hVfsIos);
+    }
+
+    /*
+     * Random access through the indexed reader, going back and forth.
+     */
+    RTVFSFILE hVfsFile;
+    RTTESTI_CHECK_RC_OK(RTZipGzipDecompressFile(hVfsFileGz, 0 /*fFlags*/, &hVfsFile));
+    if (hVfsFile != NIL_RTVFSFILE)
+    {
+        uint64_t cbFile = 0;
+        RTTESTI_CHECK_RC_OK(RTVfsFileGetSize(hVfsFile, &cbFile));
+        RTTESTI_CHECK(cbFile == cbData);
+        for (unsigned i = 0; i < 256; i++)
+        {
+            uSeed = uSeed * 1103515245 + 12345;
+            off = (size_t)(((uint64_t)uSeed << 8) % cbData);
+            size_t cb = RT_MIN((uSeed >> 16) % _256K + 1, cbData - off);
+            RTTESTI_CHECK_RC_OK_BREAK(RTVfsFileReadAt(hVfsFile, off, pbOut, cb, NULL));
+            RTTESTI_CHECK_MSG_BREAK(!memcmp(pbOut, &pbData[off], cb), ("off=%#zx cb=%#zx\n", off, cb));
+        }
+        size_t cbRead = 1;
+        RTTESTI_CHECK_RC(RTVfsFileReadAt(hVfsFile, cbData, pbOut, 16, &cbRead), VINF_EOF);
+        RTTESTI_CHECK(cbRead == 0);
+        RTVfsFileRelease(hVfsFile);
+    }
+
+    /*
+     * A bad CRC-32 must be caught when the member end is only reached after
+     * resuming from an access point.
+     */
+    uint8_t bCrc = 0;
+    RTTESTI_CHECK_RC_OK(RTVfsFileReadAt(hVfsFileGz, cbGz - 8, &bCrc, 1, NULL));
+    bCrc ^= 0x55;
+    RTTESTI_CHECK_RC_OK(RTVfsFileWriteAt(hVfsFileGz, cbGz - 8, &bCrc, 1, NULL));
+    RTTESTI_CHECK_RC_OK(RTZipGzipDecompressFile(hVfsFileGz, 0 /*fFlags*/, &hVfsFile));
+    if (hVfsFile != NIL_RTVFSFILE)
+    {
+        RTTESTI_CHECK_RC_OK(RTVfsFileReadAt(hVfsFile, cbData - _64K, pbOut, _4K, NULL));
+        RTTESTI_CHECK_RC(RTVfsFileReadAt(hVfsFile, _1M + _1M / 2, pbOut, cbData - _1M - _1M / 2, NULL), VERR_ZIP_CORRUPTED);
+        RTVfsFileRelease(hVfsFile);
+    }
+
+    RTVfsIoStrmRelease(hVfsIosGz);
+    RTVfsFileRelease(hVfsFileGz);
+    RTMemFree(pbOut);
+    RTMemFree(pbData);
+}
+
+
 int main(int argc, char **argv)
 {
     RTTEST hTest;
@@ -76,7 +370,14 @@ int main(int argc, char **argv)
     }
     else
     {
-        /** @todo testcase */
+        testBlock(RTZIPTYPE_LZF, RTZIPLEVEL_FAST, "LZF");
+        testBlock(RTZIPTYPE_LZ4, RTZIPLEVEL_FAST, "LZ4");
+        testBlock(RTZIPTYPE_LZ4, RTZIPLEVEL_MAX,  "LZ4 max");
+        testStream(RTZIPTYPE_LZF, RTZIPLEVEL_DEFAULT, "LZF");
+        testStream(RTZIPTYPE_LZ4, RTZIPLEVEL_DEFAULT, "LZ4");
+        testStream(RTZIPTYPE_LZ4, RTZIPLEVEL_MAX, "LZ4 max");
+        testStream(RTZIPTYPE_ZLIB, RTZIPLEVEL_DEFAULT, "zlib");
+        testGzip();
     }
 
     /*
@@ -58,6 +58,7 @@ typedef struct RTGZIPCMDOPTS
     bool            fKeep;
     bool            fList;
     bool            fName;
+    bool            fParallel;
     bool            fQuiet;
     bool            fRecursive;
     const char     *pszSuff;
@@ -184,7 +185,7 @@ static RTEXITCODE gzipCompressFile(PRTVFSIOSTREAM phVfsSrc, PCRTGZIPCMDOPTS pOpt
      * Attach the ompressor to the output stream.
      */
     RTVFSIOSTREAM hVfsGzip;
-    int rc = RTZipGzipCompressIoStream(*phVfsDst, 0 /*fFlags*/, pOpts->uLevel, &hVfsGzip);
+    int rc = RTZipGzipCompressIoStream(*phVfsDst, pOpts->fParallel ? RTZIPGZIPCOMP_F_PARALLEL : 0, pOpts->uLevel, &hVfsGzip);
     if (RT_FAILURE(rc))
         return RTMsgErrorExit(RTEXITCODE_FAILURE, "RTZipGzipCompressIoStream failed: %Rrc", rc);
 
@@ -454,6 +455,7 @@ RTEXITCODE RTZipGzipCmd(unsigned cArgs, char **papszArgs)
         { "--list",         'l', RTGETOPT_REQ_NOTHING },
         { "--no-name",      'n', RTGETOPT_REQ_NOTHING },
         { "--name",         'N', RTGETOPT_REQ_NOTHING },
+        { "--parallel",     'p', RTGETOPT_REQ_NOTHING },
         { "--quiet",        'q', RTGETOPT_REQ_NOTHING },
         { "--recursive",    'r', RTGETOPT_REQ_NOTHING },
         { "--suffix",       'S', RTGETOPT_REQ_STRING  },
@@ -480,6 +482,7 @@ RTEXITCODE RTZipGzipCmd(unsigned cArgs, char **papszArgs)
     Opts.fKeep       = false;
     Opts.fList       = false;
     Opts.fName       = true;
+    Opts.fParallel   = false;
     Opts.fQuiet      = false;
     Opts.fRecursive  = false;
     Opts.pszSuff     = ".gz";
@@ -567,6 +570,7 @@ RTEXITCODE RTZipGzipCmd(unsigned cArgs, char **papszArgs)
             case 'l':   Opts.fList       = true;  break;
             case 'n':   Opts.fName       = false; break;
             case 'N':   Opts.fName       = true;  break;
+            case 'p':   Opts.fParallel   = true;  break;
             case 'q':   Opts.fQuiet      = true;  break;
             case 'r':   Opts.fRecursive  = true;  break;
             case 'S':   Opts.pszSuff     = ValueUnion.psz; break;
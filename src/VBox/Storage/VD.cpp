@@ -6127,13 +6127,13 @@ VBOXDDU_DECL(int) VDCreate(PVDINTERFACE pVDIfsDisk, VDTYPE enmType, PVBOXHDD *pp
 
             /* Create the I/O ctx cache */
             rc = RTMemCacheCreate(&pDisk->hMemCacheIoCtx, sizeof(VDIOCTX), 0, UINT32_MAX,
-                                  NULL, NULL, NULL, 0);
+                                  NULL, NULL, NULL, RTMEMCACHE_FLAGS_MAGAZINES);
             if (RT_FAILURE(rc))
                 break;
 
             /* Create the I/O task cache */
             rc = RTMemCacheCreate(&pDisk->hMemCacheIoTask, sizeof(VDIOTASK), 0, UINT32_MAX,
-                                  NULL, NULL, NULL, 0);
+                                  NULL, NULL, NULL, RTMEMCACHE_FLAGS_MAGAZINES);
             if (RT_FAILURE(rc))
                 break;
 
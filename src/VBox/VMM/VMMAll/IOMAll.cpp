@@ -109,14 +109,7 @@ VMMDECL(VBOXSTRICTRC) IOMIOPortRead(PVM pVM, PVMCPU pVCpu, RTIOPORT Port, uint32
     /*
      * Get handler for current context.
      */
-    CTX_SUFF(PIOMIOPORTRANGE) pRange = pVCpu->iom.s.CTX_SUFF(pRangeLastRead);
-    if (    !pRange
-        ||   (unsigned)Port - (unsigned)pRange->Port >= (unsigned)pRange->cPorts)
-    {
-        pRange = iomIOPortGetRange(pVM, Port);
-        if (pRange)
-            pVCpu->iom.s.CTX_SUFF(pRangeLastRead) = pRange;
-    }
+    CTX_SUFF(PIOMIOPORTRANGE) pRange = iomIOPortGetRangeCached(pVM, pVCpu, Port, &pVCpu->iom.s.CTX_SUFF(pRangeLastRead));
     MMHYPER_RC_ASSERT_RCPTR(pVM, pRange);
     if (pRange)
     {
@@ -281,14 +274,7 @@ VMM_INT_DECL(VBOXSTRICTRC) IOMIOPortReadString(PVM pVM, PVMCPU pVCpu, RTIOPORT u
     /*
      * Get handler for current context.
      */
-    CTX_SUFF(PIOMIOPORTRANGE) pRange = pVCpu->iom.s.CTX_SUFF(pRangeLastRead);
-    if (    !pRange
-        ||   (unsigned)uPort - (unsigned)pRange->Port >= (unsigned)pRange->cPorts)
-    {
-        pRange = iomIOPortGetRange(pVM, uPort);
-        if (pRange)
-            pVCpu->iom.s.CTX_SUFF(pRangeLastRead) = pRange;
-    }
+    CTX_SUFF(PIOMIOPORTRANGE) pRange = iomIOPortGetRangeCached(pVM, pVCpu, uPort, &pVCpu->iom.s.CTX_SUFF(pRangeLastRead));
     MMHYPER_RC_ASSERT_RCPTR(pVM, pRange);
     if (pRange)
     {
@@ -500,14 +486,7 @@ VMMDECL(VBOXSTRICTRC) IOMIOPortWrite(PVM pVM, PVMCPU pVCpu, RTIOPORT Port, uint3
     /*
      * Get handler for current context.
      */
-    CTX_SUFF(PIOMIOPORTRANGE) pRange = pVCpu->iom.s.CTX_SUFF(pRangeLastWrite);
-    if (    !pRange
-        ||   (unsigned)Port - (unsigned)pRange->Port >= (unsigned)pRange->cPorts)
-    {
-        pRange = iomIOPortGetRange(pVM, Port);
-        if (pRange)
-            pVCpu->iom.s.CTX_SUFF(pRangeLastWrite) = pRange;
-    }
+    CTX_SUFF(PIOMIOPORTRANGE) pRange = iomIOPortGetRangeCached(pVM, pVCpu, Port, &pVCpu->iom.s.CTX_SUFF(pRangeLastWrite));
     MMHYPER_RC_ASSERT_RCPTR(pVM, pRange);
     if (pRange)
     {
@@ -657,14 +636,7 @@ VMM_INT_DECL(VBOXSTRICTRC) IOMIOPortWriteString(PVM pVM, PVMCPU pVCpu, RTIOPORT
     /*
      * Get handler for current context.
      */
-    CTX_SUFF(PIOMIOPORTRANGE) pRange = pVCpu->iom.s.CTX_SUFF(pRangeLastWrite);
-    if (    !pRange
-        ||   (unsigned)uPort - (unsigned)pRange->Port >= (unsigned)pRange->cPorts)
-    {
-        pRange = iomIOPortGetRange(pVM, uPort);
-        if (pRange)
-            pVCpu->iom.s.CTX_SUFF(pRangeLastWrite) = pRange;
-    }
+    CTX_SUFF(PIOMIOPORTRANGE) pRange = iomIOPortGetRangeCached(pVM, pVCpu, uPort, &pVCpu->iom.s.CTX_SUFF(pRangeLastWrite));
     MMHYPER_RC_ASSERT_RCPTR(pVM, pRange);
     if (pRange)
     {
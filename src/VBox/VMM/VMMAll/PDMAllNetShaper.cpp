@@ -21,7 +21,12 @@
 *********************************************************************************************************************************/
 #define LOG_GROUP LOG_GROUP_NET_SHAPER
 #include <VBox/vmm/pdm.h>
+#include <VBox/vmm/vm.h>
+#include <VBox/sup.h>
 #include <VBox/log.h>
+#include <iprt/asm.h>
+#include <iprt/asm-amd64-x86.h>
+#include <iprt/asm-math.h>
 #include <iprt/time.h>
 
 #include <VBox/vmm/pdmnetshaper.h>
@@ -31,6 +36,11 @@
 /**
  * Obtain bandwidth in a bandwidth group.
  *
+ * The transfer is charged to the filter's group and to all its parents, it is
+ * only allowed if every level of the hierarchy has enough tokens.  If it isn't
+ * the filter is marked as choked and the TX thread gets woken up to release it
+ * once the bottleneck bucket has refilled sufficiently.
+ *
  * @returns True if bandwidth was allocated, false if not.
  * @param   pFilter         Pointer to the filter that allocates bandwidth.
  * @param   cbTransfer      Number of bytes to allocate.
@@ -42,36 +52,92 @@ VMMDECL(bool) PDMNsAllocateBandwidth(PPDMNSFILTER pFilter, size_t cbTransfer)
         return true;
 
     PPDMNSBWGROUP pBwGroup = ASMAtomicReadPtrT(&pFilter->CTX_SUFF(pBwGroup), PPDMNSBWGROUP);
-    int rc = PDMCritSectEnter(&pBwGroup->Lock, VERR_SEM_BUSY); AssertRC(rc);
-    if (RT_UNLIKELY(rc == VERR_SEM_BUSY))
-        return true;
 
-    bool fAllowed = true;
-    if (pBwGroup->cbPerSecMax)
+    /*
+     * Lock the chain, children before parents.
+     */
+    PPDMNSBWGROUP apChain[PDM_NETSHAPER_MAX_DEPTH];
+    uint32_t      acbTokens[PDM_NETSHAPER_MAX_DEPTH];
+    unsigned      cLevels = 0;
+    for (PPDMNSBWGROUP pCur = pBwGroup; pCur && cLevels < RT_ELEMENTS(apChain); pCur = pCur->CTX_SUFF(pParent))
     {
-        /* Re-fill the bucket first */
-        uint64_t tsNow        = RTTimeSystemNanoTS();
-        uint32_t uTokensAdded = (tsNow - pBwGroup->tsUpdatedLast) * pBwGroup->cbPerSecMax / (1000 * 1000 * 1000);
-        uint32_t uTokens      = RT_MIN(pBwGroup->cbBucket, uTokensAdded + pBwGroup->cbTokensLast);
+        int rc = PDMCritSectEnter(&pCur->Lock, VERR_SEM_BUSY); AssertRC(rc);
+        if (RT_UNLIKELY(rc == VERR_SEM_BUSY))
+        {
+            while (cLevels-- > 0)
+                PDMCritSectLeave(&apChain[cLevels]->Lock);
+            return true;
+        }
+        apChain[cLevels++] = pCur;
+    }
 
-        if (cbTransfer > uTokens)
+    /*
+     * Re-fill the buckets and figure out how long we'd have to wait for the
+     * slowest one.
+     */
+    uint32_t const cbWanted = (uint32_t)RT_MIN(cbTransfer, UINT32_MAX);
+    uint64_t const tsNow    = RTTimeSystemNanoTS();
+    uint64_t       cNsWait  = 0;
+    for (unsigned i = 0; i < cLevels; i++)
+    {
+        PPDMNSBWGROUP pCur = apChain[i];
+        if (!pCur->cbPerSecMax)
+            continue;
+        acbTokens[i] = pdmNsBwGroupCalcTokens(pCur, tsNow);
+        /* A transfer larger than the bucket only needs a full bucket. */
+        uint64_t cNs = pdmNsBwGroupCalcWait(pCur, acbTokens[i], RT_MIN(cbWanted, pCur->cbBucket));
+        cNsWait = RT_MAX(cNsWait, cNs);
+    }
+
+    bool fAllowed = cNsWait == 0;
+    bool fSignal  = false;
+    if (fAllowed)
+    {
+        for (unsigned i = 0; i < cLevels; i++)
         {
-            fAllowed = false;
-            ASMAtomicWriteBool(&pFilter->fChoked, true);
+            PPDMNSBWGROUP pCur = apChain[i];
+            if (!pCur->cbPerSecMax)
+                continue;
+            pCur->tsUpdatedLast = tsNow;
+            pCur->cbTokensLast  = acbTokens[i] - RT_MIN(acbTokens[i], cbWanted);
         }
+    }
+    else
+    {
+#ifdef IN_RING0
+        /* We cannot wake up the TX thread with interrupts disabled, so let it pass. */
+        if (!ASMIntAreEnabled())
+            fAllowed = true;
         else
+#endif
         {
-            pBwGroup->tsUpdatedLast = tsNow;
-            pBwGroup->cbTokensLast = uTokens - (uint32_t)cbTransfer;
+            ASMAtomicWriteU32(&pFilter->cbChoked, cbWanted);
+            ASMAtomicWriteBool(&pFilter->fChoked, true);
+
+            /* Arm the leaf group for release, waking the TX thread if this moves the deadline closer. */
+            uint64_t const tsRelease = tsNow + cNsWait;
+            if (   !ASMAtomicReadBool(&pBwGroup->fPending)
+                || tsRelease < ASMAtomicReadU64(&pBwGroup->tsReleaseNext))
+            {
+                ASMAtomicWriteU64(&pBwGroup->tsReleaseNext, tsRelease);
+                ASMAtomicWriteBool(&pBwGroup->fPending, true);
+                fSignal = true;
+            }
         }
-        Log2(("pdmNsAllocateBandwidth: BwGroup=%#p{%s} cbTransfer=%u uTokens=%u uTokensAdded=%u fAllowed=%RTbool\n",
-              pBwGroup, R3STRING(pBwGroup->pszNameR3), cbTransfer, uTokens, uTokensAdded, fAllowed));
     }
-    else
-        Log2(("pdmNsAllocateBandwidth: BwGroup=%#p{%s} disabled fAllowed=%RTbool\n",
-              pBwGroup, R3STRING(pBwGroup->pszNameR3), fAllowed));
+    Log2(("pdmNsAllocateBandwidth: BwGroup=%#p{%s} cbTransfer=%u cLevels=%u cNsWait=%RU64 fAllowed=%RTbool\n",
+          pBwGroup, R3STRING(pBwGroup->pszNameR3), cbTransfer, cLevels, cNsWait, fAllowed));
 
-    rc = PDMCritSectLeave(&pBwGroup->Lock); AssertRC(rc);
+    while (cLevels-- > 0)
+    {
+        int rc = PDMCritSectLeave(&apChain[cLevels]->Lock); AssertRC(rc);
+    }
+
+    if (fSignal)
+    {
+        int rc = SUPSemEventSignal(pBwGroup->CTX_SUFF(pVM)->pSession, pBwGroup->hEvtTx);
+        AssertRC(rc);
+    }
     return fAllowed;
 }
 
@@ -33,6 +33,9 @@
 #include <VBox/log.h>
 #include <iprt/asm.h>
 #include <iprt/assert.h>
+#ifndef IN_RC
+# include <iprt/time.h>
+#endif
 
 
 /**
@@ -87,19 +90,72 @@ static void pdmQueueSetFF(PPDMQUEUE pQueue)
 
 
 /**
- * Queue an item.
- * The item must have been obtained using PDMQueueAlloc(). Once the item
- * have been passed to this function it must not be touched!
+ * Wakes up the consumer thread of a queue if the new item requires it to do
+ * its work sooner than it currently plans to.
  *
- * @param   pQueue      The queue handle.
- * @param   pItem       The item to insert.
- * @thread  Any thread.
+ * @param   pQueue              The PDM queue (consumer thread mode).
+ * @param   cPending            The number of pending items including the one
+ *                              just inserted.
+ * @param   NanoMaxDelay        The maximum delay before processing the item, in
+ *                              nanoseconds.  0 means as soon as possible.
  */
-VMMDECL(void) PDMQueueInsert(PPDMQUEUE pQueue, PPDMQUEUEITEMCORE pItem)
+static void pdmQueueNotifyConsumer(PPDMQUEUE pQueue, uint32_t cPending, uint64_t NanoMaxDelay)
+{
+#ifdef IN_RC
+    /* The event semaphore cannot be signalled from raw-mode, so let ring-3
+       kick the consumer thread (see PDMR3QueueFlushAll). */
+    NOREF(cPending); NOREF(NanoMaxDelay);
+    pdmQueueSetFF(pQueue);
+#else
+    /*
+     * Lower the deadline if we need the items processed earlier than the
+     * consumer currently plans to wake up.  Reaching the batch size means
+     * right now, which the consumer must see in the deadline or it would just
+     * go back to sleep.  Only the producer actually lowering the deadline
+     * signals, so there is one wakeup per batch.
+     */
+    bool           fSignal     = false;
+    uint64_t const u64Deadline = NanoMaxDelay && cPending < pQueue->cMaxBatch ? RTTimeNanoTS() + NanoMaxDelay : 0;
+    for (;;)
+    {
+        uint64_t const u64Old = ASMAtomicReadU64(&pQueue->u64NanoTSDeadline);
+        if (u64Deadline >= u64Old)
+            break;
+        if (ASMAtomicCmpXchgU64(&pQueue->u64NanoTSDeadline, u64Deadline, u64Old))
+        {
+            fSignal = true;
+            break;
+        }
+    }
+
+    if (fSignal)
+    {
+        STAM_REL_COUNTER_INC(&pQueue->StatConsumerSignals);
+        int rc = SUPSemEventSignal(pQueue->CTX_SUFF(pVM)->pSession, pQueue->hEvtConsumer);
+        AssertRC(rc);
+    }
+#endif
+}
+
+
+/**
+ * Common worker for PDMQueueInsert and PDMQueueInsertEx.
+ *
+ * @param   pQueue          The queue handle.
+ * @param   pItem           The item to insert.
+ * @param   NanoMaxDelay    The maximum delay before processing the item, in
+ *                          nanoseconds.  Only honoured by consumer thread
+ *                          queues.
+ */
+static void pdmQueueInsertIt(PPDMQUEUE pQueue, PPDMQUEUEITEMCORE pItem, uint64_t NanoMaxDelay)
 {
     Assert(VALID_PTR(pQueue) && pQueue->CTX_SUFF(pVM));
     Assert(VALID_PTR(pItem));
 
+    uint32_t const cPending = ASMAtomicIncU32(&pQueue->cPending);
+    if (cPending > pQueue->cPendingMax)
+        ASMAtomicWriteU32(&pQueue->cPendingMax, cPending); /* racy, but it's just statistics */
+
 #if 0 /* the paranoid android version: */
     void *pvNext;
     do
@@ -116,10 +172,26 @@ VMMDECL(void) PDMQueueInsert(PPDMQUEUE pQueue, PPDMQUEUEITEMCORE pItem)
     } while (!ASMAtomicCmpXchgPtr(&pQueue->CTX_SUFF(pPending), pItem, pNext));
 #endif
 
-    if (!pQueue->pTimer)
+    if (pQueue->hEvtConsumer != NIL_SUPSEMEVENT)
+        pdmQueueNotifyConsumer(pQueue, cPending, NanoMaxDelay);
+    else if (!pQueue->pTimer)
         pdmQueueSetFF(pQueue);
     STAM_REL_COUNTER_INC(&pQueue->StatInsert);
-    STAM_STATS({ ASMAtomicIncU32(&pQueue->cStatPending); });
+}
+
+
+/**
+ * Queue an item.
+ * The item must have been obtained using PDMQueueAlloc(). Once the item
+ * have been passed to this function it must not be touched!
+ *
+ * @param   pQueue      The queue handle.
+ * @param   pItem       The item to insert.
+ * @thread  Any thread.
+ */
+VMMDECL(void) PDMQueueInsert(PPDMQUEUE pQueue, PPDMQUEUEITEMCORE pItem)
+{
+    pdmQueueInsertIt(pQueue, pItem, 0 /*NanoMaxDelay*/);
 }
 
 
@@ -131,13 +203,13 @@ VMMDECL(void) PDMQueueInsert(PPDMQUEUE pQueue, PPDMQUEUEITEMCORE pItem)
  * @param   pQueue          The queue handle.
  * @param   pItem           The item to insert.
  * @param   NanoMaxDelay    The maximum delay before processing the queue, in nanoseconds.
- *                          This applies only to GC.
+ *                          Queues with a consumer thread use this to coalesce
+ *                          wakeups, otherwise it applies only to GC.
  * @thread  Any thread.
  */
 VMMDECL(void) PDMQueueInsertEx(PPDMQUEUE pQueue, PPDMQUEUEITEMCORE pItem, uint64_t NanoMaxDelay)
 {
-    NOREF(NanoMaxDelay);
-    PDMQueueInsert(pQueue, pItem);
+    pdmQueueInsertIt(pQueue, pItem, NanoMaxDelay);
 #ifdef IN_RC
     PVM pVM = pQueue->CTX_SUFF(pVM);
     /** @todo figure out where to put this, the next bit should go there too.
@@ -206,7 +278,10 @@ VMMDECL(bool) PDMQueueFlushIfNecessary(PPDMQUEUE pQueue)
         || pQueue->pPendingR0 != NIL_RTR0PTR
         || pQueue->pPendingRC != NIL_RTRCPTR)
     {
-        pdmQueueSetFF(pQueue);
+        if (pQueue->hEvtConsumer != NIL_SUPSEMEVENT)
+            pdmQueueNotifyConsumer(pQueue, 0 /*cPending*/, 0 /*NanoMaxDelay*/);
+        else
+            pdmQueueSetFF(pQueue);
         return false;
     }
     return false;
@@ -1618,6 +1618,60 @@ VMMR0DECL(PHMGLOBALCPUINFO) HMR0GetCurrentCpu(void)
 }
 
 
+/**
+ * Records a VM-exit in the VM-exit profiler.
+ *
+ * @param   pExitProf       The VCPU's VM-exit profiler data.
+ * @param   idxReason       The profiler index of the exit reason, i.e. the
+ *                          exit reason or one of the HM_EXIT_PROF_IDX_XXX.
+ * @param   uRip            The guest RIP of the exiting instruction.
+ * @param   uAddr           The exit specific address (I/O port or
+ *                          guest-physical address), 0 if not applicable.
+ * @param   cTicks          Number of TSC ticks spent handling the exit.
+ *
+ * @remarks Called on the EMT with preemption possibly enabled, only the EMT
+ *          updates the data so no serialization is required.
+ */
+DECLHIDDEN(void) hmR0ExitProfRecord(PHMEXITPROF pExitProf, uint32_t idxReason, uint64_t uRip, uint64_t uAddr, uint64_t cTicks)
+{
+    AssertReturnVoid(idxReason < RT_ELEMENTS(pExitProf->aReasons));
+    PHMEXITPROFREASON pReason = &pExitProf->aReasons[idxReason];
+    pReason->cExits++;
+    pReason->cTicks += cTicks;
+
+    /* The latency histogram. ASMBitLastSetU64 returns the 1-based index of the MSB, 0 for no bits set. */
+    unsigned iBucket = ASMBitLastSetU64(cTicks);
+    if (iBucket >= HM_EXIT_PROF_BUCKETS)
+        iBucket = HM_EXIT_PROF_BUCKETS - 1;
+    pReason->acBuckets[iBucket]++;
+
+    /*
+     * The hot spots.  We use the space-saving algorithm here: if the (RIP, address)
+     * pair isn't tracked yet, it replaces the least frequent entry and inherits its
+     * hit count, which bounds the error while keeping the table tiny.
+     */
+    PHMEXITPROFHOTSPOT pMin = &pReason->aHotSpots[0];
+    for (unsigned i = 0; i < RT_ELEMENTS(pReason->aHotSpots); i++)
+    {
+        PHMEXITPROFHOTSPOT pHotSpot = &pReason->aHotSpots[i];
+        if (   pHotSpot->uRip  == uRip
+            && pHotSpot->uAddr == uAddr
+            && pHotSpot->cHits)
+        {
+            pHotSpot->cHits++;
+            pHotSpot->cTicks += cTicks;
+            return;
+        }
+        if (pHotSpot->cHits < pMin->cHits)
+            pMin = pHotSpot;
+    }
+    pMin->uRip    = uRip;
+    pMin->uAddr   = uAddr;
+    pMin->cHits  += 1;
+    pMin->cTicks  = cTicks;
+}
+
+
 /**
  * Returns the cpu structure for the current cpu.
  * Keep in mind that there is no guarantee it will stay the same (long jumps to ring 3!!!).
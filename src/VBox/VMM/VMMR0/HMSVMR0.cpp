@@ -3318,6 +3318,40 @@ static void hmR0SvmPostRunGuest(PVM pVM, PVMCPU pVCpu, PCPUMCTX pMixedCtx, PSVMT
 }
 
 
+/**
+ * Gathers the VM-exit profiler details for the current \#VMEXIT.
+ *
+ * @returns The profiler index of the exit reason.
+ * @param   pVCpu           The cross context virtual CPU structure.
+ * @param   pSvmTransient   Pointer to the SVM transient structure.
+ * @param   puRip           Where to return the guest RIP.
+ * @param   puAddr          Where to return the exit specific address (I/O port
+ *                          or guest-physical address), 0 if not applicable.
+ */
+static uint32_t hmR0SvmExitProfGather(PVMCPU pVCpu, PSVMTRANSIENT pSvmTransient, uint64_t *puRip, uint64_t *puAddr)
+{
+    PSVMVMCB pVmcb = (PSVMVMCB)pVCpu->hm.s.svm.pvVmcb;
+    *puRip  = pVmcb->guest.u64RIP;
+    *puAddr = 0;
+    switch (pSvmTransient->u64ExitCode)
+    {
+        case SVM_EXIT_NPF:
+            *puAddr = pVmcb->ctrl.u64ExitInfo2;
+            return HM_EXIT_PROF_IDX_NPF;
+        case SVM_EXIT_AVIC_INCOMPLETE_IPI:
+            return HM_EXIT_PROF_IDX_AVIC_INCOMPLETE_IPI;
+        case SVM_EXIT_AVIC_NOACCEL:
+            return HM_EXIT_PROF_IDX_AVIC_NOACCEL;
+        case SVM_EXIT_IOIO:
+            *puAddr = (pVmcb->ctrl.u64ExitInfo1 >> 16) & UINT16_MAX;
+            break;
+        default:
+            break;
+    }
+    return pSvmTransient->u64ExitCode < MAX_EXITREASON_STAT ? (uint32_t)pSvmTransient->u64ExitCode : HM_EXIT_PROF_IDX_OTHER;
+}
+
+
 /**
  * Runs the guest code using AMD-V.
  *
@@ -3371,8 +3405,27 @@ static int hmR0SvmRunGuestCodeNormal(PVM pVM, PVMCPU pVCpu, PCPUMCTX pCtx)
         HMSVM_EXITCODE_STAM_COUNTER_INC(SvmTransient.u64ExitCode);
         STAM_PROFILE_ADV_STOP_START(&pVCpu->hm.s.StatExit1, &pVCpu->hm.s.StatExit2, x);
         VBOXVMM_R0_HMSVM_VMEXIT(pVCpu, pCtx, SvmTransient.u64ExitCode, (PSVMVMCB)pVCpu->hm.s.svm.pvVmcb);
+
+        /* Gather the VM-exit profiler details if enabled (/HM/ExitProfiling). */
+        PHMEXITPROF const pExitProf = pVCpu->hm.s.pExitProfR0;
+        uint32_t idxExitProf   = 0;
+        uint64_t uExitProfRip  = 0;
+        uint64_t uExitProfAddr = 0;
+        uint64_t uExitProfTsc  = 0;
+        if (RT_LIKELY(!pExitProf))
+        { /* likely */ }
+        else
+        {
+            idxExitProf  = hmR0SvmExitProfGather(pVCpu, &SvmTransient, &uExitProfRip, &uExitProfAddr);
+            uExitProfTsc = ASMReadTSC();
+        }
+
         rc = hmR0SvmHandleExit(pVCpu, pCtx, &SvmTransient);
         STAM_PROFILE_ADV_STOP(&pVCpu->hm.s.StatExit2, x);
+        if (RT_LIKELY(!pExitProf))
+        { /* likely */ }
+        else
+            hmR0ExitProfRecord(pExitProf, idxExitProf, uExitProfRip, uExitProfAddr, ASMReadTSC() - uExitProfTsc);
         if (rc != VINF_SUCCESS)
             break;
         if (cLoops > pVM->hm.s.cMaxResumeLoops)
@@ -3449,8 +3502,27 @@ static int hmR0SvmRunGuestCodeStep(PVM pVM, PVMCPU pVCpu, PCPUMCTX pCtx)
         HMSVM_EXITCODE_STAM_COUNTER_INC(SvmTransient.u64ExitCode);
         STAM_PROFILE_ADV_STOP_START(&pVCpu->hm.s.StatExit1, &pVCpu->hm.s.StatExit2, x);
         VBOXVMM_R0_HMSVM_VMEXIT(pVCpu, pCtx, SvmTransient.u64ExitCode, (PSVMVMCB)pVCpu->hm.s.svm.pvVmcb);
+
+        /* Gather the VM-exit profiler details if enabled (/HM/ExitProfiling). */
+        PHMEXITPROF const pExitProf = pVCpu->hm.s.pExitProfR0;
+        uint32_t idxExitProf   = 0;
+        uint64_t uExitProfRip  = 0;
+        uint64_t uExitProfAddr = 0;
+        uint64_t uExitProfTsc  = 0;
+        if (RT_LIKELY(!pExitProf))
+        { /* likely */ }
+        else
+        {
+            idxExitProf  = hmR0SvmExitProfGather(pVCpu, &SvmTransient, &uExitProfRip, &uExitProfAddr);
+            uExitProfTsc = ASMReadTSC();
+        }
+
         rc = hmR0SvmHandleExit(pVCpu, pCtx, &SvmTransient);
         STAM_PROFILE_ADV_STOP(&pVCpu->hm.s.StatExit2, x);
+        if (RT_LIKELY(!pExitProf))
+        { /* likely */ }
+        else
+            hmR0ExitProfRecord(pExitProf, idxExitProf, uExitProfRip, uExitProfAddr, ASMReadTSC() - uExitProfTsc);
         if (rc != VINF_SUCCESS)
             break;
         if (cLoops > pVM->hm.s.cMaxResumeLoops)
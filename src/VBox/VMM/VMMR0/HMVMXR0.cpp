@@ -9007,6 +9007,51 @@ static void hmR0VmxPostRunGuest(PVM pVM, PVMCPU pVCpu, PCPUMCTX pMixedCtx, PVMXT
 }
 
 
+/**
+ * Gathers the VM-exit profiler details for the current VM-exit.
+ *
+ * @returns The profiler index of the exit reason.
+ * @param   pVCpu           The cross context virtual CPU structure.
+ * @param   pMixedCtx       Pointer to the guest-CPU context. The data may be
+ *                          out-of-sync. Make sure to update the required fields
+ *                          before using them.
+ * @param   pVmxTransient   Pointer to the VMX transient structure.
+ * @param   puRip           Where to return the guest RIP.
+ * @param   puAddr          Where to return the exit specific address (I/O port
+ *                          or guest-physical address), 0 if not applicable.
+ */
+static uint32_t hmR0VmxExitProfGather(PVMCPU pVCpu, PCPUMCTX pMixedCtx, PVMXTRANSIENT pVmxTransient, uint64_t *puRip,
+                                      uint64_t *puAddr)
+{
+    int rc = hmR0VmxSaveGuestRip(pVCpu, pMixedCtx);
+    AssertRC(rc);
+    *puRip  = pMixedCtx->rip;
+    *puAddr = 0;
+    switch (pVmxTransient->uExitReason)
+    {
+        case VMX_EXIT_IO_INSTR:
+            rc = hmR0VmxReadExitQualificationVmcs(pVCpu, pVmxTransient);
+            if (RT_SUCCESS(rc))
+                *puAddr = VMX_EXIT_QUALIFICATION_IO_PORT(pVmxTransient->uExitQualification);
+            break;
+
+        case VMX_EXIT_EPT_VIOLATION:
+        case VMX_EXIT_EPT_MISCONFIG:
+        {
+            RTGCPHYS GCPhys = 0;
+            rc = VMXReadVmcs64(VMX_VMCS64_EXIT_GUEST_PHYS_ADDR_FULL, &GCPhys);
+            if (RT_SUCCESS(rc))
+                *puAddr = GCPhys;
+            break;
+        }
+
+        default:
+            break;
+    }
+    return pVmxTransient->uExitReason < MAX_EXITREASON_STAT ? pVmxTransient->uExitReason : HM_EXIT_PROF_IDX_OTHER;
+}
+
+
 /**
  * Runs the guest code using VT-x the normal way.
  *
@@ -9063,6 +9108,20 @@ static VBOXSTRICTRC hmR0VmxRunGuestCodeNormal(PVM pVM, PVMCPU pVCpu, PCPUMCTX pC
 
         VBOXVMM_R0_HMVMX_VMEXIT_NOCTX(pVCpu, pCtx, VmxTransient.uExitReason);
 
+        /* Gather the VM-exit profiler details if enabled (/HM/ExitProfiling). */
+        PHMEXITPROF const pExitProf = pVCpu->hm.s.pExitProfR0;
+        uint32_t idxExitProf   = 0;
+        uint64_t uExitProfRip  = 0;
+        uint64_t uExitProfAddr = 0;
+        uint64_t uExitProfTsc  = 0;
+        if (RT_LIKELY(!pExitProf))
+        { /* likely */ }
+        else
+        {
+            idxExitProf  = hmR0VmxExitProfGather(pVCpu, pCtx, &VmxTransient, &uExitProfRip, &uExitProfAddr);
+            uExitProfTsc = ASMReadTSC();
+        }
+
         /* Handle the VM-exit. */
 #ifdef HMVMX_USE_FUNCTION_TABLE
         rcStrict = g_apfnVMExitHandlers[VmxTransient.uExitReason](pVCpu, pCtx, &VmxTransient);
@@ -9070,6 +9129,10 @@ static VBOXSTRICTRC hmR0VmxRunGuestCodeNormal(PVM pVM, PVMCPU pVCpu, PCPUMCTX pC
         rcStrict = hmR0VmxHandleExit(pVCpu, pCtx, &VmxTransient, VmxTransient.uExitReason);
 #endif
         STAM_PROFILE_ADV_STOP(&pVCpu->hm.s.StatExit2, x);
+        if (RT_LIKELY(!pExitProf))
+        { /* likely */ }
+        else
+            hmR0ExitProfRecord(pExitProf, idxExitProf, uExitProfRip, uExitProfAddr, ASMReadTSC() - uExitProfTsc);
         if (rcStrict == VINF_SUCCESS)
         {
             if (cLoops <= pVM->hm.s.cMaxResumeLoops)
@@ -10208,11 +10271,29 @@ static VBOXSTRICTRC hmR0VmxRunGuestCodeDebug(PVM pVM, PVMCPU pVCpu, PCPUMCTX pCt
 
         VBOXVMM_R0_HMVMX_VMEXIT_NOCTX(pVCpu, pCtx, VmxTransient.uExitReason);
 
+        /* Gather the VM-exit profiler details if enabled (/HM/ExitProfiling). */
+        PHMEXITPROF const pExitProf = pVCpu->hm.s.pExitProfR0;
+        uint32_t idxExitProf   = 0;
+        uint64_t uExitProfRip  = 0;
+        uint64_t uExitProfAddr = 0;
+        uint64_t uExitProfTsc  = 0;
+        if (RT_LIKELY(!pExitProf))
+        { /* likely */ }
+        else
+        {
+            idxExitProf  = hmR0VmxExitProfGather(pVCpu, pCtx, &VmxTransient, &uExitProfRip, &uExitProfAddr);
+            uExitProfTsc = ASMReadTSC();
+        }
+
         /*
          * Handle the VM-exit - we quit earlier on certain VM-exits, see hmR0VmxHandleExitDebug().
          */
         rcStrict = hmR0VmxRunDebugHandleExit(pVM, pVCpu, pCtx, &VmxTransient, VmxTransient.uExitReason, &DbgState);
         STAM_PROFILE_ADV_STOP(&pVCpu->hm.s.StatExit2, x);
+        if (RT_LIKELY(!pExitProf))
+        { /* likely */ }
+        else
+            hmR0ExitProfRecord(pExitProf, idxExitProf, uExitProfRip, uExitProfAddr, ASMReadTSC() - uExitProfTsc);
         if (rcStrict != VINF_SUCCESS)
             break;
         if (cLoops > pVM->hm.s.cMaxResumeLoops)
@@ -12108,6 +12189,26 @@ HMVMX_EXIT_DECL hmR0VmxExitWrmsr(PVMCPU pVCpu, PCPUMCTX pMixedCtx, PVMXTRANSIENT
     PVM pVM = pVCpu->CTX_SUFF(pVM);
     int rc = VINF_SUCCESS;
 
+    /*
+     * Fast path for x2APIC ICR writes, i.e. IPIs sent by SMP guests (TLB shootdowns,
+     * rescheduling). WRMSR raises #GP(0) at CPL > 0 before causing a VM-exit, so we can
+     * skip EMInterpretWrmsr() and the guest-state it requires and hand the value straight
+     * to the APIC. The ICR doesn't affect the TPR, so there's no APIC state to reload.
+     * Anything the APIC can't deal with here (not in x2APIC mode, reserved bits, INIT/SIPI)
+     * is reported before any side effects and is left to the generic path below.
+     */
+    if (pMixedCtx->ecx == MSR_IA32_X2APIC_ICR)
+    {
+        VBOXSTRICTRC rcStrict = APICWriteMsr(pVCpu, MSR_IA32_X2APIC_ICR, RT_MAKE_U64(pMixedCtx->eax, pMixedCtx->edx));
+        if (rcStrict == VINF_SUCCESS)
+        {
+            STAM_COUNTER_INC(&pVCpu->hm.s.StatExitWrmsr);
+            STAM_COUNTER_INC(&pVCpu->hm.s.StatExitWrmsrX2ApicIcr);
+            return hmR0VmxAdvanceGuestRip(pVCpu, pMixedCtx, pVmxTransient);
+        }
+        AssertMsg(rcStrict == VINF_CPUM_R3_MSR_WRITE, ("%Rrc\n", VBOXSTRICTRC_VAL(rcStrict)));
+    }
+
     /* EMInterpretWrmsr() requires CR0, EFLAGS and SS segment register. */
     rc  = hmR0VmxSaveGuestCR0(pVCpu, pMixedCtx);
     rc |= hmR0VmxSaveGuestRflags(pVCpu, pMixedCtx);
@@ -34,6 +34,7 @@
 
 #include <iprt/assert.h>
 #include <iprt/ctype.h>
+#include <iprt/string.h>
 #include <iprt/trace.h>
 
 
@@ -95,13 +96,17 @@ static int dbgfR3TraceEnable(PVM pVM, uint32_t cbEntry, uint32_t cEntries)
         rc = CFGMR3QueryU32Def(CFGMR3GetChild(CFGMR3GetRoot(pVM), "DBGF"), "TraceBufEntries", &cEntries, 4096);
         AssertRCReturn(rc, rc);
     }
+    bool fPerCpu;
+    rc = CFGMR3QueryBoolDef(CFGMR3GetChild(CFGMR3GetRoot(pVM), "DBGF"), "TraceBufPerCpu", &fPerCpu, false);
+    AssertRCReturn(rc, rc);
+    uint32_t const fFlags = fPerCpu ? RTTRACEBUF_FLAGS_PER_CPU : 0;
 
     /*
      * Figure the required size.
      */
     RTTRACEBUF  hTraceBuf;
     size_t      cbBlock = 0;
-    rc = RTTraceBufCarve(&hTraceBuf, cEntries, cbEntry, 0 /*fFlags*/, NULL, &cbBlock);
+    rc = RTTraceBufCarve(&hTraceBuf, cEntries, cbEntry, fFlags, NULL, &cbBlock);
     if (rc != VERR_BUFFER_OVERFLOW)
     {
         AssertReturn(!RT_SUCCESS_NP(rc), VERR_IPE_UNEXPECTED_INFO_STATUS);
@@ -120,7 +125,7 @@ static int dbgfR3TraceEnable(PVM pVM, uint32_t cbEntry, uint32_t cEntries)
     if (RT_FAILURE(rc))
         return rc;
 
-    rc = RTTraceBufCarve(&hTraceBuf, cEntries, cbEntry, 0 /*fFlags*/, pvBlock, &cbBlock);
+    rc = RTTraceBufCarve(&hTraceBuf, cEntries, cbEntry, fFlags, pvBlock, &cbBlock);
     AssertRCReturn(rc, rc);
     AssertRelease(hTraceBuf == (RTTRACEBUF)pvBlock);
     AssertRelease((void *)hTraceBuf == pvBlock);
@@ -192,7 +197,7 @@ int dbgfR3TraceInit(PVM pVM)
      * Register a debug info item that will dump the trace buffer content.
      */
     if (RT_SUCCESS(rc))
-        rc = DBGFR3InfoRegisterInternal(pVM, "tracebuf", "Display the trace buffer content. No arguments.", dbgfR3TraceInfo);
+        rc = DBGFR3InfoRegisterInternal(pVM, "tracebuf", "Display the trace buffer content. Pass 'chrome' to get it in the Chrome trace event format.", dbgfR3TraceInfo);
 
     return rc;
 }
@@ -431,6 +436,16 @@ dbgfR3TraceInfoDumpEntry(RTTRACEBUF hTraceBuf, uint32_t iEntry, uint64_t NanoTS,
 }
 
 
+/**
+ * @callback_method_impl{FNRTDUMPPRINTFV, Forwards the export output to the info helper.}
+ */
+static DECLCALLBACK(void) dbgfR3TraceInfoExportPrintfV(void *pvUser, const char *pszFormat, va_list va)
+{
+    PCDBGFINFOHLP pHlp = (PCDBGFINFOHLP)pvUser;
+    pHlp->pfnPrintfV(pHlp, pszFormat, va);
+}
+
+
 /**
  * @callback_method_impl{FNDBGFHANDLERINT, Info handler for displaying the trace buffer content.}
  */
@@ -439,12 +454,13 @@ static DECLCALLBACK(void) dbgfR3TraceInfo(PVM pVM, PCDBGFINFOHLP pHlp, const cha
     RTTRACEBUF hTraceBuf = pVM->hTraceBufR3;
     if (hTraceBuf == NIL_RTTRACEBUF)
         pHlp->pfnPrintf(pHlp, "Tracing is disable\n");
+    else if (pszArgs && strstr(pszArgs, "chrome"))
+        RTTraceBufExportChromeTrace(hTraceBuf, NULL, 0, dbgfR3TraceInfoExportPrintfV, (void *)pHlp);
     else
     {
         pHlp->pfnPrintf(pHlp, "Trace buffer %p - %u entries of %u bytes\n",
                         hTraceBuf, RTTraceBufGetEntryCount(hTraceBuf), RTTraceBufGetEntrySize(hTraceBuf));
         RTTraceBufEnumEntries(hTraceBuf, dbgfR3TraceInfoDumpEntry, (void *)pHlp);
     }
-    NOREF(pszArgs);
 }
 
@@ -57,6 +57,7 @@
 #include "HMInternal.h"
 #include <VBox/vmm/vm.h>
 #include <VBox/vmm/uvm.h>
+#include <VBox/sup.h>
 #include <VBox/err.h>
 #include <VBox/param.h>
 
@@ -380,6 +381,7 @@ static DECLCALLBACK(int)  hmR3Save(PVM pVM, PSSMHANDLE pSSM);
 static DECLCALLBACK(int)  hmR3Load(PVM pVM, PSSMHANDLE pSSM, uint32_t uVersion, uint32_t uPass);
 static DECLCALLBACK(void) hmR3InfoExitHistory(PVM pVM, PCDBGFINFOHLP pHlp, const char *pszArgs);
 static DECLCALLBACK(void) hmR3InfoEventPending(PVM pVM, PCDBGFINFOHLP pHlp, const char *pszArgs);
+static DECLCALLBACK(void) hmR3InfoExitProf(PVM pVM, PCDBGFINFOHLP pHlp, const char *pszArgs);
 static int                hmR3InitCPU(PVM pVM);
 static int                hmR3InitFinalizeR0(PVM pVM);
 static int                hmR3InitFinalizeR0Intel(PVM pVM);
@@ -436,6 +438,11 @@ VMMR3_INT_DECL(int) HMR3Init(PVM pVM)
                                       DBGFINFO_FLAGS_ALL_EMTS);
     AssertRCReturn(rc, rc);
 
+    rc = DBGFR3InfoRegisterInternalEx(pVM, "hmexitprof",
+                                      "Dumps the HM VM-exit latency profile. Args: 'flame' for folded stacks, 'reset' to clear.",
+                                      hmR3InfoExitProf, DBGFINFO_FLAGS_ALL_EMTS);
+    AssertRCReturn(rc, rc);
+
     /*
      * Read configuration.
      */
@@ -458,7 +465,8 @@ VMMR3_INT_DECL(int) HMR3Init(PVM pVM)
                               "|SvmPauseFilterThreshold"
                               "|Exclusive"
                               "|MaxResumeLoops"
-                              "|UseVmxPreemptTimer",
+                              "|UseVmxPreemptTimer"
+                              "|ExitProfiling",
                               "" /* pszValidNodes */, "HM" /* pszWho */, 0 /* uInstance */);
     if (RT_FAILURE(rc))
         return rc;
@@ -596,6 +604,14 @@ VMMR3_INT_DECL(int) HMR3Init(PVM pVM)
     rc = CFGMR3QueryBoolDef(pCfgHm, "UseVmxPreemptTimer", &pVM->hm.s.vmx.fUsePreemptTimer, true);
     AssertLogRelRCReturn(rc, rc);
 
+    /** @cfgm{/HM/ExitProfiling, bool, false}
+     * Whether to record per exit reason latency histograms and the most frequent
+     * guest RIP / address hot spots, see the 'hmexitprof' info handler.  This
+     * costs two TSC reads and some VMCS reads per VM-exit, so it's off by
+     * default. */
+    rc = CFGMR3QueryBoolDef(pCfgHm, "ExitProfiling", &pVM->hm.s.fExitProfiling, false);
+    AssertLogRelRCReturn(rc, rc);
+
     /*
      * Check if VT-x or AMD-v support according to the users wishes.
      */
@@ -748,6 +764,31 @@ static int hmR3InitCPU(PVM pVM)
         pVCpu->hm.s.fActive = false;
     }
 
+    /*
+     * The VM-exit profiler.  The profile is too big for the hyper heap, which
+     * only budgets 64KB per VCPU for everything, so it gets pages of its own.
+     */
+    if (pVM->hm.s.fExitProfiling)
+    {
+        for (VMCPUID i = 0; i < pVM->cCpus; i++)
+        {
+            PVMCPU  pVCpu = &pVM->aCpus[i];
+            void   *pvR3  = NULL;
+            RTR0PTR R0Ptr = NIL_RTR0PTR;
+            int rc = SUPR3PageAllocEx(RT_ALIGN_Z(sizeof(HMEXITPROF), PAGE_SIZE) >> PAGE_SHIFT, 0 /* fFlags */, &pvR3, &R0Ptr,
+                                      NULL /* paPages */);
+            if (RT_FAILURE(rc))
+            {
+                LogRel(("HM: Failed to allocate %zu bytes for the VM-exit profiler, rc=%Rrc\n", sizeof(HMEXITPROF), rc));
+                return rc;
+            }
+            RT_BZERO(pvR3, sizeof(HMEXITPROF));
+            pVCpu->hm.s.pExitProfR3 = (PHMEXITPROF)pvR3;
+            pVCpu->hm.s.pExitProfR0 = (R0PTRTYPE(PHMEXITPROF))R0Ptr;
+        }
+        LogRel(("HM: VM-exit profiling enabled\n"));
+    }
+
 #ifdef VBOX_WITH_STATISTICS
     STAM_REG(pVM, &pVM->hm.s.StatTprPatchSuccess,   STAMTYPE_COUNTER, "/HM/TPR/Patch/Success",  STAMUNIT_OCCURENCES, "Number of times an instruction was successfully patched.");
     STAM_REG(pVM, &pVM->hm.s.StatTprPatchFailure,   STAMTYPE_COUNTER, "/HM/TPR/Patch/Failed",   STAMUNIT_OCCURENCES, "Number of unsuccessful patch attempts.");
@@ -859,6 +900,7 @@ static int hmR3InitCPU(PVM pVM)
         HM_REG_COUNTER(&pVCpu->hm.s.StatExitRdrand,             "/HM/CPU%d/Exit/Instr/Rdrand", "Guest attempted to execute RDRAND.");
         HM_REG_COUNTER(&pVCpu->hm.s.StatExitRdmsr,              "/HM/CPU%d/Exit/Instr/Rdmsr", "Guest attempted to execute RDMSR.");
         HM_REG_COUNTER(&pVCpu->hm.s.StatExitWrmsr,              "/HM/CPU%d/Exit/Instr/Wrmsr", "Guest attempted to execute WRMSR.");
+        HM_REG_COUNTER(&pVCpu->hm.s.StatExitWrmsrX2ApicIcr,     "/HM/CPU%d/Exit/Instr/Wrmsr/X2ApicIcr", "x2APIC ICR writes (IPIs) handled by the fast path.");
         HM_REG_COUNTER(&pVCpu->hm.s.StatExitMwait,              "/HM/CPU%d/Exit/Instr/Mwait", "Guest attempted to execute MWAIT.");
         HM_REG_COUNTER(&pVCpu->hm.s.StatExitMonitor,            "/HM/CPU%d/Exit/Instr/Monitor", "Guest attempted to execute MONITOR.");
         HM_REG_COUNTER(&pVCpu->hm.s.StatExitDRxWrite,           "/HM/CPU%d/Exit/Instr/DR/Write", "Guest attempted to write a debug register.");
@@ -1832,6 +1874,13 @@ static int hmR3TermCPU(PVM pVM)
     {
         PVMCPU pVCpu = &pVM->aCpus[i]; NOREF(pVCpu);
 
+        if (pVCpu->hm.s.pExitProfR3)
+        {
+            SUPR3PageFreeEx(pVCpu->hm.s.pExitProfR3, RT_ALIGN_Z(sizeof(HMEXITPROF), PAGE_SIZE) >> PAGE_SHIFT);
+            pVCpu->hm.s.pExitProfR3 = NULL;
+            pVCpu->hm.s.pExitProfR0 = NIL_RTR0PTR;
+        }
+
 #ifdef VBOX_WITH_STATISTICS
         if (pVCpu->hm.s.paStatExitReason)
         {
@@ -3564,6 +3613,118 @@ static DECLCALLBACK(void) hmR3InfoExitHistory(PVM pVM, PCDBGFINFOHLP pHlp, const
 }
 
 
+/**
+ * Gets the description of a VM-exit profiler index.
+ *
+ * @returns Read-only description string, NULL if unknown.
+ * @param   pVM         The cross context VM structure.
+ * @param   idxReason   The profiler index of the exit reason.
+ */
+static const char *hmR3ExitProfGetDesc(PVM pVM, uint32_t idxReason)
+{
+    switch (idxReason)
+    {
+        case HM_EXIT_PROF_IDX_NPF:                  return hmSvmGetSpecialExitReasonDesc(SVM_EXIT_NPF);
+        case HM_EXIT_PROF_IDX_AVIC_INCOMPLETE_IPI:  return hmSvmGetSpecialExitReasonDesc(SVM_EXIT_AVIC_INCOMPLETE_IPI);
+        case HM_EXIT_PROF_IDX_AVIC_NOACCEL:         return hmSvmGetSpecialExitReasonDesc(SVM_EXIT_AVIC_NOACCEL);
+        case HM_EXIT_PROF_IDX_OTHER:                return "Other exit reasons.";
+    }
+    if (pVM->hm.s.vmx.fSupported)
+        return idxReason <= MAX_EXITREASON_VTX ? g_apszVTxExitReasons[idxReason] : NULL;
+    return idxReason <= MAX_EXITREASON_AMDV ? g_apszAmdVExitReasons[idxReason] : NULL;
+}
+
+
+/**
+ * Displays the VM-exit latency profile.
+ *
+ * @param   pVM         The cross context VM structure.
+ * @param   pHlp        The info helper functions.
+ * @param   pszArgs     Arguments: 'flame' to dump folded stacks suitable for
+ *                      flame graph tools, 'reset' to clear the data.
+ */
+static DECLCALLBACK(void) hmR3InfoExitProf(PVM pVM, PCDBGFINFOHLP pHlp, const char *pszArgs)
+{
+    PVMCPU pVCpu = VMMGetCpu(pVM);
+    if (!pVCpu)
+        pVCpu = &pVM->aCpus[0];
+
+    PHMEXITPROF pExitProf = pVCpu->hm.s.pExitProfR3;
+    if (!pExitProf)
+    {
+        pHlp->pfnPrintf(pHlp, "VM-exit profiling is not enabled (/HM/ExitProfiling)!\n");
+        return;
+    }
+
+    if (pszArgs && strstr(pszArgs, "reset"))
+    {
+        RT_BZERO(pExitProf, sizeof(*pExitProf));
+        pHlp->pfnPrintf(pHlp, "CPU[%u]: VM-exit profile cleared.\n", pVCpu->idCpu);
+        return;
+    }
+
+    /*
+     * Folded stacks, one line per hot spot: "CPUn;reason;address;rip count".
+     */
+    if (pszArgs && strstr(pszArgs, "flame"))
+    {
+        for (uint32_t idxReason = 0; idxReason < RT_ELEMENTS(pExitProf->aReasons); idxReason++)
+        {
+            PCHMEXITPROFREASON pReason = &pExitProf->aReasons[idxReason];
+            if (!pReason->cExits)
+                continue;
+            const char *pszDesc = hmR3ExitProfGetDesc(pVM, idxReason);
+            uint64_t    cHits   = 0;
+            for (unsigned i = 0; i < RT_ELEMENTS(pReason->aHotSpots); i++)
+            {
+                PCHMEXITPROFHOTSPOT pHotSpot = &pReason->aHotSpots[i];
+                if (!pHotSpot->cHits)
+                    continue;
+                cHits += pHotSpot->cHits;
+                pHlp->pfnPrintf(pHlp, "CPU%u;%s;%#RX64;%#RX64 %RU64\n", pVCpu->idCpu, pszDesc ? pszDesc : "Unknown",
+                                pHotSpot->uAddr, pHotSpot->uRip, pHotSpot->cHits);
+            }
+            if (pReason->cExits > cHits)
+                pHlp->pfnPrintf(pHlp, "CPU%u;%s;other %RU64\n", pVCpu->idCpu, pszDesc ? pszDesc : "Unknown",
+                                pReason->cExits - cHits);
+        }
+        return;
+    }
+
+    /*
+     * Human readable summary.
+     */
+    pHlp->pfnPrintf(pHlp, "CPU[%u]: %s VM-exit latency profile (TSC ticks):\n", pVCpu->idCpu,
+                    pVM->hm.s.vmx.fSupported ? "VT-x" : "AMD-V");
+    for (uint32_t idxReason = 0; idxReason < RT_ELEMENTS(pExitProf->aReasons); idxReason++)
+    {
+        PCHMEXITPROFREASON pReason = &pExitProf->aReasons[idxReason];
+        if (!pReason->cExits)
+            continue;
+        const char *pszDesc = hmR3ExitProfGetDesc(pVM, idxReason);
+        pHlp->pfnPrintf(pHlp, "  %#05x %-40s exits=%-12RU64 ticks=%-16RU64 avg=%RU64\n", idxReason,
+                        pszDesc ? pszDesc : "Unknown", pReason->cExits, pReason->cTicks, pReason->cTicks / pReason->cExits);
+
+        for (unsigned iBucket = 0; iBucket < RT_ELEMENTS(pReason->acBuckets); iBucket++)
+            if (pReason->acBuckets[iBucket])
+            {
+                if (iBucket + 1 < RT_ELEMENTS(pReason->acBuckets))
+                    pHlp->pfnPrintf(pHlp, "        < %-12RU64 %u\n", RT_BIT_64(iBucket), pReason->acBuckets[iBucket]);
+                else
+                    pHlp->pfnPrintf(pHlp, "       >= %-12RU64 %u\n", RT_BIT_64(iBucket - 1), pReason->acBuckets[iBucket]);
+            }
+
+        for (unsigned i = 0; i < RT_ELEMENTS(pReason->aHotSpots); i++)
+        {
+            PCHMEXITPROFHOTSPOT pHotSpot = &pReason->aHotSpots[i];
+            if (pHotSpot->cHits)
+                pHlp->pfnPrintf(pHlp, "        rip=%016RX64 addr=%016RX64 hits=%-10RU64 ticks=%RU64\n",
+                                pHotSpot->uRip, pHotSpot->uAddr, pHotSpot->cHits, pHotSpot->cTicks);
+        }
+    }
+}
+
+
 /**
  * Displays the HM pending event.
  *
@@ -237,6 +237,21 @@ VMMR3_INT_DECL(int) IOMR3Init(PVM pVM)
             STAM_REG(pVM, &pVM->iom.s.StatInstOut,            STAMTYPE_COUNTER, "/IOM/IOWork/Out",                          STAMUNIT_OCCURENCES,     "Counter of any OUT instructions.");
             STAM_REG(pVM, &pVM->iom.s.StatInstIns,            STAMTYPE_COUNTER, "/IOM/IOWork/Ins",                          STAMUNIT_OCCURENCES,     "Counter of any INS instructions.");
             STAM_REG(pVM, &pVM->iom.s.StatInstOuts,           STAMTYPE_COUNTER, "/IOM/IOWork/Outs",                         STAMUNIT_OCCURENCES,     "Counter of any OUTS instructions.");
+
+#ifdef VBOX_WITH_STATISTICS
+            for (VMCPUID idCpu = 0; idCpu < pVM->cCpus; idCpu++)
+            {
+                PVMCPU pVCpu = &pVM->aCpus[idCpu];
+                STAMR3RegisterF(pVM, &pVCpu->iom.s.StatIOPortLookupHits,   STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES,
+                                "I/O port range lookups served by the per-VCPU caches.",  "/IOM/CPU%u/LookupCache/IOPortHits", idCpu);
+                STAMR3RegisterF(pVM, &pVCpu->iom.s.StatIOPortLookupMisses, STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES,
+                                "I/O port range lookups requiring a tree walk.",          "/IOM/CPU%u/LookupCache/IOPortMisses", idCpu);
+                STAMR3RegisterF(pVM, &pVCpu->iom.s.StatMMIOLookupHits,     STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES,
+                                "MMIO range lookups served by the per-VCPU caches.",      "/IOM/CPU%u/LookupCache/MMIOHits", idCpu);
+                STAMR3RegisterF(pVM, &pVCpu->iom.s.StatMMIOLookupMisses,   STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES,
+                                "MMIO range lookups requiring a tree walk.",              "/IOM/CPU%u/LookupCache/MMIOMisses", idCpu);
+            }
+#endif
         }
     }
 
@@ -287,6 +302,16 @@ static void iomR3FlushCache(PVM pVM)
         pVCpu->iom.s.pStatsLastWriteRC = NIL_RTRCPTR;
         pVCpu->iom.s.pMMIORangeLastRC  = NIL_RTRCPTR;
         pVCpu->iom.s.pMMIOStatsLastRC  = NIL_RTRCPTR;
+
+        for (unsigned i = 0; i < IOM_LOOKUP_CACHE_ENTRIES; i++)
+        {
+            pVCpu->iom.s.apIOPortRangeCacheR0[i] = NIL_RTR0PTR;
+            pVCpu->iom.s.apMMIORangeCacheR0[i]   = NIL_RTR0PTR;
+            pVCpu->iom.s.apIOPortRangeCacheR3[i] = NULL;
+            pVCpu->iom.s.apMMIORangeCacheR3[i]   = NULL;
+            pVCpu->iom.s.apIOPortRangeCacheRC[i] = NIL_RTRCPTR;
+            pVCpu->iom.s.apMMIORangeCacheRC[i]   = NIL_RTRCPTR;
+        }
     }
 
     IOM_UNLOCK_EXCL(pVM);
@@ -338,6 +363,11 @@ VMMR3_INT_DECL(void) IOMR3Relocate(PVM pVM, RTGCINTPTR offDelta)
         pVCpu->iom.s.pStatsLastWriteRC = NIL_RTRCPTR;
         pVCpu->iom.s.pMMIORangeLastRC  = NIL_RTRCPTR;
         pVCpu->iom.s.pMMIOStatsLastRC  = NIL_RTRCPTR;
+        for (unsigned i = 0; i < IOM_LOOKUP_CACHE_ENTRIES; i++)
+        {
+            pVCpu->iom.s.apIOPortRangeCacheRC[i] = NIL_RTRCPTR;
+            pVCpu->iom.s.apMMIORangeCacheRC[i]   = NIL_RTRCPTR;
+        }
     }
 }
 
@@ -748,6 +748,10 @@ VMMR3_INT_DECL(int) PDMR3Term(PVM pVM)
     {
         pdmR3TermLuns(pVM, pDevIns->Internal.s.pLunsR3, pDevIns->pReg->szName, pDevIns->iInstance);
 
+        /* The queues go first, their consumer threads may otherwise call
+           into the device after the destructor has torn it down. */
+        PDMR3QueueDestroyDevice(pVM, pDevIns);
+
         if (pDevIns->pReg->pfnDestruct)
         {
             LogFlow(("pdmR3DevTerm: Destroying - device '%s'/%d\n",
@@ -759,7 +763,6 @@ VMMR3_INT_DECL(int) PDMR3Term(PVM pVM)
         SSMR3DeregisterDevice(pVM, pDevIns, NULL, 0);
         pdmR3CritSectBothDeleteDevice(pVM, pDevIns);
         pdmR3ThreadDestroyDevice(pVM, pDevIns);
-        PDMR3QueueDestroyDevice(pVM, pDevIns);
         PGMR3PhysMMIOExDeregister(pVM, pDevIns, UINT32_MAX, UINT32_MAX);
 #ifdef VBOX_WITH_PDM_ASYNC_COMPLETION
         pdmR3AsyncCompletionTemplateDestroyDevice(pVM, pDevIns);
@@ -32,6 +32,7 @@
 
 #include <VBox/log.h>
 #include <iprt/asm.h>
+#include <iprt/asm-math.h>
 #include <iprt/assert.h>
 #include <iprt/thread.h>
 #include <iprt/mem.h>
@@ -130,23 +131,33 @@ typedef struct PDMACBWMGR
     PPDMASYNCCOMPLETIONEPCLASS                  pEpClass;
     /** Identifier of the manager. */
     char                                       *pszId;
+    /** The parent manager whose limit applies on top of ours, NULL if none. */
+    struct PDMACBWMGR                          *pParent;
+    /** Lock protecting the token bucket. */
+    RTCRITSECT                                  Lock;
     /** Maximum number of bytes the endpoints are allowed to transfer (Max is 4GB/s currently) */
     volatile uint32_t                           cbTransferPerSecMax;
     /** Number of bytes we start with */
     volatile uint32_t                           cbTransferPerSecStart;
     /** Step after each update */
     volatile uint32_t                           cbTransferPerSecStep;
-    /** Number of bytes we are allowed to transfer till the next update.
-     * Reset by the refresh timer. */
+    /** Configured burst size in bytes, 0 for one second worth of the current rate. */
+    uint32_t                                    cbBurst;
+    /** Number of bytes in the token bucket at the last update. */
     volatile uint32_t                           cbTransferAllowed;
     /** Timestamp of the last update */
     volatile uint64_t                           tsUpdatedLast;
+    /** Timestamp of the last rate step (see cbTransferPerSecStep). */
+    uint64_t                                    tsSteppedLast;
     /** Reference counter - How many endpoints are associated with this manager. */
     volatile uint32_t                           cRefs;
 } PDMACBWMGR;
 /** Pointer to a bandwidth control manager pointer. */
 typedef PPDMACBWMGR *PPPDMACBWMGR;
 
+/** Maximum depth of the bandwidth manager hierarchy. */
+#define PDMAC_BWMGR_MAX_DEPTH   4
+
 
 /*********************************************************************************************************************************
 *   Internal Functions                                                                                                           *
@@ -648,10 +659,10 @@ static void pdmacBwMgrUnlink(PPDMACBWMGR pBwMgr)
 
 /** Lazy coder. */
 static int pdmacAsyncCompletionBwMgrCreate(PPDMASYNCCOMPLETIONEPCLASS pEpClass, const char *pszBwMgr, uint32_t cbTransferPerSecMax,
-                                           uint32_t cbTransferPerSecStart, uint32_t cbTransferPerSecStep)
+                                           uint32_t cbTransferPerSecStart, uint32_t cbTransferPerSecStep, uint32_t cbBurst)
 {
-    LogFlowFunc(("pEpClass=%#p pszBwMgr=%#p{%s} cbTransferPerSecMax=%u cbTransferPerSecStart=%u cbTransferPerSecStep=%u\n",
-                 pEpClass, pszBwMgr, pszBwMgr, cbTransferPerSecMax, cbTransferPerSecStart, cbTransferPerSecStep));
+    LogFlowFunc(("pEpClass=%#p pszBwMgr=%#p{%s} cbTransferPerSecMax=%u cbTransferPerSecStart=%u cbTransferPerSecStep=%u cbBurst=%u\n",
+                 pEpClass, pszBwMgr, pszBwMgr, cbTransferPerSecMax, cbTransferPerSecStart, cbTransferPerSecStep, cbBurst));
 
     AssertPtrReturn(pEpClass, VERR_INVALID_POINTER);
     AssertPtrReturn(pszBwMgr, VERR_INVALID_POINTER);
@@ -668,6 +679,10 @@ static int pdmacAsyncCompletionBwMgrCreate(PPDMASYNCCOMPLETIONEPCLASS pEpClass,
         {
             pBwMgr->pszId = RTStrDup(pszBwMgr);
             if (pBwMgr->pszId)
+                rc = RTCritSectInit(&pBwMgr->Lock);
+            else
+                rc = VERR_NO_MEMORY;
+            if (RT_SUCCESS(rc))
             {
                 pBwMgr->pEpClass              = pEpClass;
                 pBwMgr->cRefs                 = 0;
@@ -676,16 +691,18 @@ static int pdmacAsyncCompletionBwMgrCreate(PPDMASYNCCOMPLETIONEPCLASS pEpClass,
                 pBwMgr->cbTransferPerSecMax   = cbTransferPerSecMax;
                 pBwMgr->cbTransferPerSecStart = cbTransferPerSecStart;
                 pBwMgr->cbTransferPerSecStep  = cbTransferPerSecStep;
+                pBwMgr->cbBurst               = cbBurst;
 
-                pBwMgr->cbTransferAllowed     = pBwMgr->cbTransferPerSecStart;
+                pBwMgr->cbTransferAllowed     = cbBurst ? cbBurst : pBwMgr->cbTransferPerSecStart;
                 pBwMgr->tsUpdatedLast         = RTTimeSystemNanoTS();
+                pBwMgr->tsSteppedLast         = pBwMgr->tsUpdatedLast;
 
                 pdmacBwMgrLink(pBwMgr);
                 rc = VINF_SUCCESS;
             }
             else
             {
-                rc = VERR_NO_MEMORY;
+                RTStrFree(pBwMgr->pszId);
                 MMR3HeapFree(pBwMgr);
             }
         }
@@ -698,6 +715,67 @@ static int pdmacAsyncCompletionBwMgrCreate(PPDMASYNCCOMPLETIONEPCLASS pEpClass,
 }
 
 
+/**
+ * Gets the number of levels in the subtree rooted at the given bandwidth manager.
+ *
+ * @returns The subtree height, 1 if the manager has no children.
+ * @param   pEpClass    The endpoint class the manager belongs to.
+ * @param   pBwMgr      The subtree root.
+ */
+static unsigned pdmacBwMgrSubtreeHeight(PPDMASYNCCOMPLETIONEPCLASS pEpClass, PPDMACBWMGR pBwMgr)
+{
+    unsigned cHeight = 1;
+    int rc = RTCritSectEnter(&pEpClass->CritSect); AssertRC(rc);
+    for (PPDMACBWMGR pCur = pEpClass->pBwMgrsHead; pCur; pCur = pCur->pNext)
+    {
+        unsigned    cLevels = 1;
+        PPDMACBWMGR pUp     = pCur;
+        while (pUp && pUp != pBwMgr)
+        {
+            pUp = pUp->pParent;
+            cLevels++;
+        }
+        if (pUp && cLevels > cHeight)
+            cHeight = cLevels;
+    }
+    rc = RTCritSectLeave(&pEpClass->CritSect); AssertRC(rc);
+    return cHeight;
+}
+
+
+/**
+ * Makes @a pszParent the parent of the given bandwidth manager.
+ *
+ * @returns VBox status code.
+ * @param   pEpClass    The endpoint class.
+ * @param   pszBwMgr    The identifier of the child manager.
+ * @param   pszParent   The identifier of the parent manager.
+ */
+static int pdmacBwMgrSetParent(PPDMASYNCCOMPLETIONEPCLASS pEpClass, const char *pszBwMgr, const char *pszParent)
+{
+    PPDMACBWMGR pBwMgr  = pdmacBwMgrFindById(pEpClass, pszBwMgr);
+    PPDMACBWMGR pParent = pdmacBwMgrFindById(pEpClass, pszParent);
+    if (!pBwMgr || !pParent)
+    {
+        LogRel(("AIOMgr: Parent bandwidth group '%s' of '%s' does not exist\n", pszParent, pszBwMgr));
+        return VERR_NOT_FOUND;
+    }
+
+    /* The hierarchy must be a tree of limited depth, count the levels below and above us. */
+    unsigned cLevels = pdmacBwMgrSubtreeHeight(pEpClass, pBwMgr);
+    for (PPDMACBWMGR pCur = pParent; pCur; pCur = pCur->pParent)
+        if (pCur == pBwMgr || ++cLevels > PDMAC_BWMGR_MAX_DEPTH)
+        {
+            LogRel(("AIOMgr: Making '%s' the parent of '%s' creates a loop or exceeds the maximum depth of %u\n",
+                    pszParent, pszBwMgr, PDMAC_BWMGR_MAX_DEPTH));
+            return VERR_INVALID_PARAMETER;
+        }
+
+    pBwMgr->pParent = pParent;
+    return VINF_SUCCESS;
+}
+
+
 /** Lazy coder. */
 DECLINLINE(void) pdmacBwMgrRetain(PPDMACBWMGR pBwMgr)
 {
@@ -713,9 +791,45 @@ DECLINLINE(void) pdmacBwMgrRelease(PPDMACBWMGR pBwMgr)
 }
 
 
+/**
+ * Re-fills the token bucket of a bandwidth manager.
+ *
+ * @returns Number of bytes in the bucket.
+ * @param   pBwMgr      The bandwidth manager, caller owns the lock.
+ * @param   tsNow       The current RTTimeSystemNanoTS() value.
+ */
+static uint32_t pdmacBwMgrRefill(PPDMACBWMGR pBwMgr, uint64_t tsNow)
+{
+    /* Ramp up the rate once per second until the maximum is reached. */
+    if (   pBwMgr->cbTransferPerSecStart < pBwMgr->cbTransferPerSecMax
+        && tsNow - pBwMgr->tsSteppedLast >= RT_NS_1SEC)
+    {
+        pBwMgr->tsSteppedLast = tsNow;
+        pBwMgr->cbTransferPerSecStart = RT_MIN(pBwMgr->cbTransferPerSecMax, pBwMgr->cbTransferPerSecStart + pBwMgr->cbTransferPerSecStep);
+        LogFlow(("AIOMgr: Increasing maximum bandwidth to %u bytes/sec\n", pBwMgr->cbTransferPerSecStart));
+    }
+
+    uint32_t const cbRate     = pBwMgr->cbTransferPerSecStart;
+    uint32_t const cbBucket   = pBwMgr->cbBurst ? pBwMgr->cbBurst : cbRate;
+    uint64_t const cNsElapsed = tsNow - pBwMgr->tsUpdatedLast;
+    if (!cbRate)
+        return RT_MIN(cbBucket, pBwMgr->cbTransferAllowed);
+    /* Only saturate once the bucket could have filled up from empty, the burst
+       may well be larger than what the rate adds in a second. */
+    if (cNsElapsed >= (uint64_t)cbBucket * RT_NS_1SEC / cbRate)
+        return cbBucket;
+    uint64_t const cbAdded    = ASMMultU64ByU32DivByU32(cNsElapsed, cbRate, RT_NS_1SEC);
+    return (uint32_t)RT_MIN(cbBucket, cbAdded + pBwMgr->cbTransferAllowed);
+}
+
+
 /**
  * Checks if the endpoint is allowed to transfer the given amount of bytes.
  *
+ * The transfer is charged against the endpoint's bandwidth manager and all
+ * its parents, each of which is a token bucket refilled at its current rate
+ * and holding up to its burst size.
+ *
  * @returns true if the endpoint is allowed to transfer the data.
  *          false otherwise
  * @param   pEndpoint                 The endpoint.
@@ -733,42 +847,44 @@ bool pdmacEpIsTransferAllowed(PPDMASYNCCOMPLETIONENDPOINT pEndpoint, uint32_t cb
 
     if (pBwMgr)
     {
-        uint32_t cbOld = ASMAtomicSubU32(&pBwMgr->cbTransferAllowed, cbTransfer);
-        if (RT_LIKELY(cbOld >= cbTransfer))
-            fAllowed = true;
-        else
+        PPDMACBWMGR apChain[PDMAC_BWMGR_MAX_DEPTH];
+        uint32_t    acbTokens[PDMAC_BWMGR_MAX_DEPTH];
+        unsigned    cLevels = 0;
+        for (PPDMACBWMGR pCur = pBwMgr; pCur && cLevels < RT_ELEMENTS(apChain); pCur = pCur->pParent)
         {
-            fAllowed = false;
+            RTCritSectEnter(&pCur->Lock);
+            apChain[cLevels++] = pCur;
+        }
 
-            /* We are out of resources  Check if we can update again. */
-            uint64_t tsNow          = RTTimeSystemNanoTS();
-            uint64_t tsUpdatedLast  = ASMAtomicUoReadU64(&pBwMgr->tsUpdatedLast);
+        uint64_t const tsNow   = RTTimeSystemNanoTS();
+        uint64_t       cNsWait = 0;
+        for (unsigned i = 0; i < cLevels; i++)
+        {
+            PPDMACBWMGR pCur   = apChain[i];
+            acbTokens[i] = pdmacBwMgrRefill(pCur, tsNow);
 
-            if (tsNow - tsUpdatedLast >= (1000*1000*1000))
+            /* A request larger than the bucket only needs a full bucket. */
+            uint32_t cbBucket = pCur->cbBurst ? pCur->cbBurst : pCur->cbTransferPerSecStart;
+            uint32_t cbNeeded = RT_MIN(cbTransfer, cbBucket);
+            if (cbNeeded > acbTokens[i])
             {
-                if (ASMAtomicCmpXchgU64(&pBwMgr->tsUpdatedLast, tsNow, tsUpdatedLast))
-                {
-                    if (pBwMgr->cbTransferPerSecStart < pBwMgr->cbTransferPerSecMax)
-                    {
-                       pBwMgr->cbTransferPerSecStart = RT_MIN(pBwMgr->cbTransferPerSecMax, pBwMgr->cbTransferPerSecStart + pBwMgr->cbTransferPerSecStep);
-                       LogFlow(("AIOMgr: Increasing maximum bandwidth to %u bytes/sec\n", pBwMgr->cbTransferPerSecStart));
-                    }
-
-                    /* Update */
-                    uint32_t cbTransferAllowedNew =   pBwMgr->cbTransferPerSecStart > cbTransfer
-                                                    ? pBwMgr->cbTransferPerSecStart - cbTransfer
-                                                    : 0;
-                    ASMAtomicWriteU32(&pBwMgr->cbTransferAllowed, cbTransferAllowedNew);
-                    fAllowed = true;
-                    LogFlow(("AIOMgr: Refreshed bandwidth\n"));
-                }
+                uint64_t cNs = ((uint64_t)(cbNeeded - acbTokens[i]) * RT_NS_1SEC) / RT_MAX(pCur->cbTransferPerSecStart, 1);
+                cNsWait = RT_MAX(cNsWait, cNs);
             }
-            else
+        }
+
+        fAllowed = cNsWait == 0;
+        if (fAllowed)
+            for (unsigned i = 0; i < cLevels; i++)
             {
-                ASMAtomicAddU32(&pBwMgr->cbTransferAllowed, cbTransfer);
-                *pmsWhenNext = ((1000*1000*1000) - (tsNow - tsUpdatedLast)) / (1000*1000);
+                apChain[i]->tsUpdatedLast     = tsNow;
+                apChain[i]->cbTransferAllowed = acbTokens[i] - RT_MIN(acbTokens[i], cbTransfer);
             }
-        }
+        else
+            *pmsWhenNext = (RTMSINTERVAL)RT_MAX(1, (cNsWait + RT_NS_1MS - 1) / RT_NS_1MS);
+
+        while (cLevels-- > 0)
+            RTCritSectLeave(&apChain[cLevels]->Lock);
     }
 
     LogFlowFunc(("fAllowed=%RTbool\n", fAllowed));
@@ -856,7 +972,7 @@ int pdmR3AsyncCompletionEpClassInit(PVM pVM, PCPDMASYNCCOMPLETIONEPCLASSOPS pEpC
 
             /* Create task cache */
             rc = RTMemCacheCreate(&pEndpointClass->hMemCacheTasks, pEpClassOps->cbTask,
-                                  0, UINT32_MAX, NULL, NULL, NULL, 0);
+                                  0, UINT32_MAX, NULL, NULL, NULL, RTMEMCACHE_FLAGS_MAGAZINES);
             if (RT_SUCCESS(rc))
             {
                 /* Call the specific endpoint class initializer. */
@@ -886,9 +1002,12 @@ int pdmR3AsyncCompletionEpClassInit(PVM pVM, PCPDMASYNCCOMPLETIONEPCLASSOPS pEpC
                                         {
                                             uint32_t cbStep;
                                             rc = CFGMR3QueryU32Def(pCur, "Step", &cbStep, 0);
+                                            uint32_t cbBurst = 0;
+                                            if (RT_SUCCESS(rc))
+                                                rc = CFGMR3QueryU32Def(pCur, "Burst", &cbBurst, 0);
                                             if (RT_SUCCESS(rc))
                                                 rc = pdmacAsyncCompletionBwMgrCreate(pEndpointClass, pszBwGrpId,
-                                                                                     cbMax, cbStart, cbStep);
+                                                                                     cbMax, cbStart, cbStep, cbBurst);
                                         }
                                     }
                                 }
@@ -899,6 +1018,28 @@ int pdmR3AsyncCompletionEpClassInit(PVM pVM, PCPDMASYNCCOMPLETIONEPCLASSOPS pEpC
                             if (RT_FAILURE(rc))
                                 break;
                         }
+
+                        /* Link up the hierarchy now that all groups exist. */
+                        for (PCFGMNODE pCur = CFGMR3GetFirstChild(pCfgBwGrp); pCur && RT_SUCCESS(rc); pCur = CFGMR3GetNextChild(pCur))
+                        {
+                            char *pszParent = NULL;
+                            rc = CFGMR3QueryStringAllocDef(pCur, "Parent", &pszParent, NULL);
+                            if (RT_SUCCESS(rc) && pszParent)
+                            {
+                                size_t cbName = CFGMR3GetNameLen(pCur) + 1;
+                                char *pszBwGrpId = (char *)RTMemAllocZ(cbName);
+                                if (pszBwGrpId)
+                                {
+                                    rc = CFGMR3GetName(pCur, pszBwGrpId, cbName);
+                                    if (RT_SUCCESS(rc))
+                                        rc = pdmacBwMgrSetParent(pEndpointClass, pszBwGrpId, pszParent);
+                                    RTMemFree(pszBwGrpId);
+                                }
+                                else
+                                    rc = VERR_NO_MEMORY;
+                                MMR3HeapFree(pszParent);
+                            }
+                        }
                     }
                     if (RT_SUCCESS(rc))
                     {
@@ -952,6 +1093,8 @@ static void pdmR3AsyncCompletionEpClassTerminate(PPDMASYNCCOMPLETIONEPCLASS pEnd
     {
         PPDMACBWMGR pFree = pBwMgr;
         pBwMgr = pBwMgr->pNext;
+        RTCritSectDelete(&pFree->Lock);
+        RTStrFree(pFree->pszId);
         MMR3HeapFree(pFree);
     }
 
@@ -1305,6 +1448,9 @@ void pdmR3AsyncCompletionResume(PVM pVM)
                 LogRel(("AIOMgr:     Max:   %u B/s\n", pBwMgr->cbTransferPerSecMax));
                 LogRel(("AIOMgr:     Start: %u B/s\n", pBwMgr->cbTransferPerSecStart));
                 LogRel(("AIOMgr:     Step:  %u B/s\n", pBwMgr->cbTransferPerSecStep));
+                LogRel(("AIOMgr:     Burst: %u B\n", pBwMgr->cbBurst ? pBwMgr->cbBurst : pBwMgr->cbTransferPerSecStart));
+                if (pBwMgr->pParent)
+                    LogRel(("AIOMgr:     Parent: %s\n", pBwMgr->pParent->pszId));
                 LogRel(("AIOMgr:     Endpoints:\n"));
 
                 pEp = pEpClass->pEndpointsHead;
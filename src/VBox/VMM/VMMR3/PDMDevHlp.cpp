@@ -1711,7 +1711,7 @@ static DECLCALLBACK(void) pdmR3DevHlp_PCISetIrq(PPDMDEVINS pDevIns, PPDMPCIDEV p
     /*
      * Validate input.
      */
-    Assert(iIrq == 0);
+    Assert(iIrq == 0 || pPciDev->Int.s.u8MsixCapOffset != 0); /* MSI-X devices may pass a vector number. */
     Assert((uint32_t)iLevel <= PDM_IRQ_LEVEL_FLIP_FLOP);
 
     /*
@@ -1916,6 +1916,26 @@ static DECLCALLBACK(int) pdmR3DevHlp_QueueCreate(PPDMDEVINS pDevIns, size_t cbIt
 }
 
 
+/** @interface_method_impl{PDMDEVHLPR3,pfnQueueEnableConsumerThread} */
+static DECLCALLBACK(int) pdmR3DevHlp_QueueEnableConsumerThread(PPDMDEVINS pDevIns, PPDMQUEUE pQueue, uint32_t cMaxBatch,
+                                                               RTTHREADTYPE enmType, const char *pszThreadName)
+{
+    PDMDEV_ASSERT_DEVINS(pDevIns);
+    LogFlow(("pdmR3DevHlp_QueueEnableConsumerThread: caller='%s'/%d: pQueue=%p cMaxBatch=%u enmType=%d pszThreadName=%p:{%s}\n",
+             pDevIns->pReg->szName, pDevIns->iInstance, pQueue, cMaxBatch, enmType, pszThreadName, pszThreadName));
+
+    PVM pVM = pDevIns->Internal.s.pVMR3;
+    VM_ASSERT_EMT(pVM);
+    AssertPtrReturn(pQueue, VERR_INVALID_POINTER);
+    AssertReturn(pQueue->enmType == PDMQUEUETYPE_DEV && pQueue->u.Dev.pDevIns == pDevIns, VERR_INVALID_HANDLE);
+
+    int rc = PDMR3QueueEnableConsumerThread(pQueue, cMaxBatch, enmType, pszThreadName);
+
+    LogFlow(("pdmR3DevHlp_QueueEnableConsumerThread: caller='%s'/%d: returns %Rrc\n", pDevIns->pReg->szName, pDevIns->iInstance, rc));
+    return rc;
+}
+
+
 /** @interface_method_impl{PDMDEVHLPR3,pfnCritSectInit} */
 static DECLCALLBACK(int) pdmR3DevHlp_CritSectInit(PPDMDEVINS pDevIns, PPDMCRITSECT pCritSect, RT_SRC_POS_DECL,
                                                   const char *pszNameFmt, va_list va)
@@ -3677,7 +3697,7 @@ const PDMDEVHLPR3 g_pdmR3DevHlpTrusted =
     pdmR3DevHlp_CallR0,
     pdmR3DevHlp_VMGetSuspendReason,
     pdmR3DevHlp_VMGetResumeReason,
-    0,
+    pdmR3DevHlp_QueueEnableConsumerThread,
     0,
     0,
     0,
@@ -3934,7 +3954,7 @@ const PDMDEVHLPR3 g_pdmR3DevHlpUnTrusted =
     pdmR3DevHlp_CallR0,
     pdmR3DevHlp_VMGetSuspendReason,
     pdmR3DevHlp_VMGetResumeReason,
-    0,
+    pdmR3DevHlp_QueueEnableConsumerThread,
     0,
     0,
     0,
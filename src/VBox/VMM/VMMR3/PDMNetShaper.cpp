@@ -28,10 +28,12 @@
 #endif
 #include <VBox/vmm/vm.h>
 #include <VBox/vmm/uvm.h>
+#include <VBox/sup.h>
 #include <VBox/err.h>
 
 #include <VBox/log.h>
 #include <iprt/asm.h>
+#include <iprt/asm-math.h>
 #include <iprt/assert.h>
 #include <iprt/thread.h>
 #include <iprt/mem.h>
@@ -59,6 +61,8 @@ typedef struct PDMNETSHAPER
     RTCRITSECT               Lock;
     /** Pending TX thread. */
     PPDMTHREAD               pTxThread;
+    /** Event semaphore the TX thread waits on for choked filters. */
+    SUPSEMEVENT              hEvtTx;
     /** Pointer to the first bandwidth group. */
     PPDMNSBWGROUP            pBwGroupsHead;
 } PDMNETSHAPER;
@@ -136,16 +140,18 @@ static void pdmNsBwGroupUnlink(PPDMNSBWGROUP pBwGroup)
 
 static void pdmNsBwGroupSetLimit(PPDMNSBWGROUP pBwGroup, uint64_t cbPerSecMax)
 {
+    uint64_t cbBucket = pBwGroup->cbBurst ? pBwGroup->cbBurst : cbPerSecMax * PDM_NETSHAPER_MAX_LATENCY / 1000;
     pBwGroup->cbPerSecMax = cbPerSecMax;
-    pBwGroup->cbBucket    = RT_MAX(PDM_NETSHAPER_MIN_BUCKET_SIZE, cbPerSecMax * PDM_NETSHAPER_MAX_LATENCY / 1000);
+    pBwGroup->cbBucket    = (uint32_t)RT_MIN(RT_MAX(PDM_NETSHAPER_MIN_BUCKET_SIZE, cbBucket), PDM_NETSHAPER_MAX_BUCKET_SIZE);
     LogFlow(("pdmNsBwGroupSetLimit: New rate limit is %llu bytes per second, adjusted bucket size to %u bytes\n",
              pBwGroup->cbPerSecMax, pBwGroup->cbBucket));
 }
 
 
-static int pdmNsBwGroupCreate(PPDMNETSHAPER pShaper, const char *pszBwGroup, uint64_t cbPerSecMax)
+static int pdmNsBwGroupCreate(PPDMNETSHAPER pShaper, const char *pszBwGroup, uint64_t cbPerSecMax, uint32_t cbBurst)
 {
-    LogFlow(("pdmNsBwGroupCreate: pShaper=%#p pszBwGroup=%#p{%s} cbPerSecMax=%llu\n", pShaper, pszBwGroup, pszBwGroup, cbPerSecMax));
+    LogFlow(("pdmNsBwGroupCreate: pShaper=%#p pszBwGroup=%#p{%s} cbPerSecMax=%llu cbBurst=%u\n",
+             pShaper, pszBwGroup, pszBwGroup, cbPerSecMax, cbBurst));
 
     AssertPtrReturn(pShaper, VERR_INVALID_POINTER);
     AssertPtrReturn(pszBwGroup, VERR_INVALID_POINTER);
@@ -166,7 +172,11 @@ static int pdmNsBwGroupCreate(PPDMNETSHAPER pShaper, const char *pszBwGroup, uin
                 if (pBwGroup->pszNameR3)
                 {
                     pBwGroup->pShaperR3             = pShaper;
+                    pBwGroup->pVMR3                 = pShaper->pVM;
+                    pBwGroup->pVMR0                 = pShaper->pVM->pVMR0;
+                    pBwGroup->hEvtTx                = pShaper->hEvtTx;
                     pBwGroup->cRefs                 = 0;
+                    pBwGroup->cbBurst               = cbBurst;
 
                     pdmNsBwGroupSetLimit(pBwGroup, cbPerSecMax);
 
@@ -193,6 +203,71 @@ static int pdmNsBwGroupCreate(PPDMNETSHAPER pShaper, const char *pszBwGroup, uin
 }
 
 
+/**
+ * Gets the number of levels in the subtree rooted at the given bandwidth group.
+ *
+ * @returns The subtree height, 1 if the group has no children.
+ * @param   pShaper     The network shaper.
+ * @param   pBwGroup    The subtree root.
+ */
+static unsigned pdmNsBwGroupSubtreeHeight(PPDMNETSHAPER pShaper, PPDMNSBWGROUP pBwGroup)
+{
+    unsigned cHeight = 1;
+    LOCK_NETSHAPER(pShaper);
+    for (PPDMNSBWGROUP pCur = pShaper->pBwGroupsHead; pCur; pCur = pCur->pNextR3)
+    {
+        unsigned      cLevels = 1;
+        PPDMNSBWGROUP pUp     = pCur;
+        while (pUp && pUp != pBwGroup)
+        {
+            pUp = pUp->pParentR3;
+            cLevels++;
+        }
+        if (pUp && cLevels > cHeight)
+            cHeight = cLevels;
+    }
+    UNLOCK_NETSHAPER(pShaper);
+    return cHeight;
+}
+
+
+/**
+ * Makes @a pszParent the parent of the given bandwidth group.
+ *
+ * @returns VBox status code.
+ * @param   pShaper     The network shaper.
+ * @param   pszBwGroup  The name of the child group.
+ * @param   pszParent   The name of the parent group.
+ */
+static int pdmNsBwGroupSetParent(PPDMNETSHAPER pShaper, const char *pszBwGroup, const char *pszParent)
+{
+    PPDMNSBWGROUP pBwGroup = pdmNsBwGroupFindById(pShaper, pszBwGroup);
+    PPDMNSBWGROUP pParent  = pdmNsBwGroupFindById(pShaper, pszParent);
+    if (!pBwGroup || !pParent)
+    {
+        LogRel(("NetShaper: Parent group '%s' of '%s' does not exist\n", pszParent, pszBwGroup));
+        return VERR_NOT_FOUND;
+    }
+
+    /* The hierarchy must be a tree of limited depth, count the levels below and above us. */
+    unsigned cLevels = pdmNsBwGroupSubtreeHeight(pShaper, pBwGroup);
+    for (PPDMNSBWGROUP pCur = pParent; pCur; pCur = pCur->pParentR3)
+    {
+        if (pCur == pBwGroup || ++cLevels > PDM_NETSHAPER_MAX_DEPTH)
+        {
+            LogRel(("NetShaper: Making '%s' the parent of '%s' creates a loop or exceeds the maximum depth of %u\n",
+                    pszParent, pszBwGroup, PDM_NETSHAPER_MAX_DEPTH));
+            return VERR_INVALID_PARAMETER;
+        }
+    }
+
+    pBwGroup->pParentR3 = pParent;
+    pBwGroup->pParentR0 = MMHyperR3ToR0(pShaper->pVM, pParent);
+    LogRel(("NetShaper: Bandwidth group '%s' is a child of '%s'\n", pszBwGroup, pszParent));
+    return VINF_SUCCESS;
+}
+
+
 static void pdmNsBwGroupTerminate(PPDMNSBWGROUP pBwGroup)
 {
     Assert(pBwGroup->cRefs == 0);
@@ -214,7 +289,18 @@ DECLINLINE(void) pdmNsBwGroupUnref(PPDMNSBWGROUP pBwGroup)
 }
 
 
-static void pdmNsBwGroupXmitPending(PPDMNSBWGROUP pBwGroup)
+/**
+ * Releases choked filters of a bandwidth group.
+ *
+ * Filters are released in round-robin order starting after the last one
+ * released, and only as many as the tokens currently in the bucket can
+ * satisfy.  If some remain choked the group is re-armed for when the bucket
+ * has refilled enough for the next one in line.
+ *
+ * @param   pBwGroup    The bandwidth group.
+ * @param   tsNow       The current RTTimeSystemNanoTS() value.
+ */
+static void pdmNsBwGroupXmitPending(PPDMNSBWGROUP pBwGroup, uint64_t tsNow)
 {
     /*
      * We don't need to hold the bandwidth group lock to iterate over the list
@@ -224,27 +310,55 @@ static void pdmNsBwGroupXmitPending(PPDMNSBWGROUP pBwGroup)
     AssertPtr(pBwGroup);
     AssertPtr(pBwGroup->pShaperR3);
     Assert(RTCritSectIsOwner(&pBwGroup->pShaperR3->Lock));
-    //LOCK_NETSHAPER(pShaper);
 
     /* Check if the group is disabled. */
-    if (pBwGroup->cbPerSecMax == 0)
-        return;
+    bool     fUnlimited = pBwGroup->cbPerSecMax == 0;
+    uint32_t cbBudget   = UINT32_MAX;
+    if (!fUnlimited)
+    {
+        int rc = PDMCritSectEnter(&pBwGroup->Lock, VERR_SEM_BUSY); AssertRC(rc);
+        cbBudget = pdmNsBwGroupCalcTokens(pBwGroup, tsNow);
+        PDMCritSectLeave(&pBwGroup->Lock);
+    }
 
-    PPDMNSFILTER pFilter = pBwGroup->pFiltersHeadR3;
+    PPDMNSFILTER pStart = pBwGroup->pFilterCursorR3 ? pBwGroup->pFilterCursorR3 : pBwGroup->pFiltersHeadR3;
+    PPDMNSFILTER pFilter = pStart;
+    bool         fReleasedAny = false;
     while (pFilter)
     {
-        bool fChoked = ASMAtomicXchgBool(&pFilter->fChoked, false);
-        Log3((LOG_FN_FMT ": pFilter=%#p fChoked=%RTbool\n", __PRETTY_FUNCTION__, pFilter, fChoked));
-        if (fChoked && pFilter->pIDrvNetR3)
+        PPDMNSFILTER pNext = pFilter->pNextR3 ? pFilter->pNextR3 : pBwGroup->pFiltersHeadR3;
+        if (ASMAtomicReadBool(&pFilter->fChoked))
         {
-            LogFlowFunc(("Calling pfnXmitPending for pFilter=%#p\n", pFilter));
-            pFilter->pIDrvNetR3->pfnXmitPending(pFilter->pIDrvNetR3);
+            uint32_t cbChoked = RT_MIN(ASMAtomicReadU32(&pFilter->cbChoked), pBwGroup->cbBucket);
+            if (   !fUnlimited
+                && fReleasedAny
+                && cbChoked > cbBudget)
+            {
+                /* Out of tokens, the rest has to wait.  Continue with this filter next time. */
+                uint64_t tsRelease = tsNow + pdmNsBwGroupCalcWait(pBwGroup, cbBudget, cbChoked);
+                ASMAtomicWriteU64(&pBwGroup->tsReleaseNext, tsRelease);
+                ASMAtomicWriteBool(&pBwGroup->fPending, true);
+                pBwGroup->pFilterCursorR3 = pFilter;
+                Log3(("pdmNsBwGroupXmitPending: %s: deferring pFilter=%#p cbChoked=%u cbBudget=%u\n",
+                      pBwGroup->pszNameR3, pFilter, cbChoked, cbBudget));
+                return;
+            }
+
+            cbBudget -= RT_MIN(cbBudget, cbChoked);
+            fReleasedAny = true;
+            ASMAtomicWriteBool(&pFilter->fChoked, false);
+            pBwGroup->pFilterCursorR3 = pNext;
+            if (pFilter->pIDrvNetR3)
+            {
+                LogFlowFunc(("Calling pfnXmitPending for pFilter=%#p\n", pFilter));
+                pFilter->pIDrvNetR3->pfnXmitPending(pFilter->pIDrvNetR3);
+            }
         }
 
-        pFilter = pFilter->pNextR3;
+        pFilter = pNext;
+        if (pFilter == pStart)
+            break;
     }
-
-    //UNLOCK_NETSHAPER(pShaper);
 }
 
 
@@ -285,6 +399,8 @@ static void pdmNsFilterUnlink(PPDMNSFILTER pFilter)
         AssertPtr(pPrev);
         pPrev->pNextR3 = pFilter->pNextR3;
     }
+    if (pBwGroup->pFilterCursorR3 == pFilter)
+        pBwGroup->pFilterCursorR3 = pFilter->pNextR3;
 
     rc = PDMCritSectLeave(&pBwGroup->Lock); AssertRC(rc);
 }
@@ -408,29 +524,44 @@ VMMR3DECL(int) PDMR3NsBwGroupSetLimit(PUVM pUVM, const char *pszBwGroup, uint64_
 /**
  * I/O thread for pending TX.
  *
+ * The thread sleeps until a filter gets choked and then until the earliest
+ * time at which a choked filter can be released again, so it doesn't consume
+ * any CPU while no bandwidth limit is being hit.
+ *
  * @returns VINF_SUCCESS (ignored).
  * @param   pVM         The cross context VM structure.
  * @param   pThread     The PDM thread data.
  */
 static DECLCALLBACK(int) pdmR3NsTxThread(PVM pVM, PPDMTHREAD pThread)
 {
-    RT_NOREF_PV(pVM);
-
     PPDMNETSHAPER pShaper = (PPDMNETSHAPER)pThread->pvUser;
     LogFlow(("pdmR3NsTxThread: pShaper=%p\n", pShaper));
     while (pThread->enmState == PDMTHREADSTATE_RUNNING)
     {
-        RTThreadSleep(PDM_NETSHAPER_MAX_LATENCY);
-
-        /* Go over all bandwidth groups/filters calling pfnXmitPending */
+        /* Go over all bandwidth groups with choked filters which are due for release. */
+        uint64_t cNsWait = UINT64_MAX;
         LOCK_NETSHAPER(pShaper);
-        PPDMNSBWGROUP pBwGroup = pShaper->pBwGroupsHead;
-        while (pBwGroup)
+        for (PPDMNSBWGROUP pBwGroup = pShaper->pBwGroupsHead; pBwGroup; pBwGroup = pBwGroup->pNextR3)
         {
-            pdmNsBwGroupXmitPending(pBwGroup);
-            pBwGroup = pBwGroup->pNextR3;
+            if (!ASMAtomicReadBool(&pBwGroup->fPending))
+                continue;
+            uint64_t tsNow = RTTimeSystemNanoTS();
+            if (ASMAtomicReadU64(&pBwGroup->tsReleaseNext) <= tsNow)
+            {
+                ASMAtomicWriteBool(&pBwGroup->fPending, false);
+                pdmNsBwGroupXmitPending(pBwGroup, tsNow);
+                if (!ASMAtomicReadBool(&pBwGroup->fPending))
+                    continue;
+            }
+            uint64_t tsRelease = ASMAtomicReadU64(&pBwGroup->tsReleaseNext);
+            cNsWait = RT_MIN(cNsWait, tsRelease > tsNow ? tsRelease - tsNow : 0);
         }
         UNLOCK_NETSHAPER(pShaper);
+
+        if (cNsWait == UINT64_MAX)
+            SUPSemEventWaitNoResume(pVM->pSession, pShaper->hEvtTx, RT_INDEFINITE_WAIT);
+        else if (cNsWait > 0)
+            SUPSemEventWaitNsRelIntr(pVM->pSession, pShaper->hEvtTx, cNsWait);
     }
     return VINF_SUCCESS;
 }
@@ -441,10 +572,9 @@ static DECLCALLBACK(int) pdmR3NsTxThread(PVM pVM, PPDMTHREAD pThread)
  */
 static DECLCALLBACK(int) pdmR3NsTxWakeUp(PVM pVM, PPDMTHREAD pThread)
 {
-    RT_NOREF2(pVM, pThread);
-    LogFlow(("pdmR3NsTxWakeUp: pShaper=%p\n", pThread->pvUser));
-    /* Nothing to do */
-    return VINF_SUCCESS;
+    PPDMNETSHAPER pShaper = (PPDMNETSHAPER)pThread->pvUser;
+    LogFlow(("pdmR3NsTxWakeUp: pShaper=%p\n", pShaper));
+    return SUPSemEventSignal(pVM->pSession, pShaper->hEvtTx);
 }
 
 
@@ -475,6 +605,8 @@ int pdmR3NetShaperTerm(PVM pVM)
     }
 
     RTCritSectDelete(&pShaper->Lock);
+    SUPSemEventClose(pVM->pSession, pShaper->hEvtTx);
+    pShaper->hEvtTx = NIL_SUPSEMEVENT;
     return VINF_SUCCESS;
 }
 
@@ -500,6 +632,8 @@ int pdmR3NetShaperInit(PVM pVM)
 
         pShaper->pVM = pVM;
         rc = RTCritSectInit(&pShaper->Lock);
+        if (RT_SUCCESS(rc))
+            rc = SUPSemEventCreate(pVM->pSession, &pShaper->hEvtTx);
         if (RT_SUCCESS(rc))
         {
             /* Create all bandwidth groups. */
@@ -518,7 +652,13 @@ int pdmR3NetShaperInit(PVM pVM)
                             uint64_t cbMax;
                             rc = CFGMR3QueryU64(pCur, "Max", &cbMax);
                             if (RT_SUCCESS(rc))
-                                rc = pdmNsBwGroupCreate(pShaper, pszBwGrpId, cbMax);
+                            {
+                                /* Burst size in bytes, by default what the rate allows within PDM_NETSHAPER_MAX_LATENCY. */
+                                uint32_t cbBurst;
+                                rc = CFGMR3QueryU32Def(pCur, "Burst", &cbBurst, 0);
+                                if (RT_SUCCESS(rc))
+                                    rc = pdmNsBwGroupCreate(pShaper, pszBwGrpId, cbMax, cbBurst);
+                            }
                         }
                         RTMemFree(pszBwGrpId);
                     }
@@ -527,6 +667,28 @@ int pdmR3NetShaperInit(PVM pVM)
                     if (RT_FAILURE(rc))
                         break;
                 }
+
+                /* Link up the hierarchy now that all groups exist (the parent may come after the child). */
+                for (PCFGMNODE pCur = CFGMR3GetFirstChild(pCfgBwGrp); pCur && RT_SUCCESS(rc); pCur = CFGMR3GetNextChild(pCur))
+                {
+                    char *pszParent = NULL;
+                    rc = CFGMR3QueryStringAllocDef(pCur, "Parent", &pszParent, NULL);
+                    if (RT_SUCCESS(rc) && pszParent)
+                    {
+                        size_t cbName = CFGMR3GetNameLen(pCur) + 1;
+                        char *pszBwGrpId = (char *)RTMemAllocZ(cbName);
+                        if (pszBwGrpId)
+                        {
+                            rc = CFGMR3GetName(pCur, pszBwGrpId, cbName);
+                            if (RT_SUCCESS(rc))
+                                rc = pdmNsBwGroupSetParent(pShaper, pszBwGrpId, pszParent);
+                            RTMemFree(pszBwGrpId);
+                        }
+                        else
+                            rc = VERR_NO_MEMORY;
+                        MMR3HeapFree(pszParent);
+                    }
+                }
             }
 
             if (RT_SUCCESS(rc))
@@ -540,8 +702,10 @@ int pdmR3NetShaperInit(PVM pVM)
                 }
             }
 
-            RTCritSectDelete(&pShaper->Lock);
+            SUPSemEventClose(pVM->pSession, pShaper->hEvtTx);
         }
+        if (RTCritSectIsInitialized(&pShaper->Lock))
+            RTCritSectDelete(&pShaper->Lock);
 
         MMR3HeapFree(pShaper);
     }
@@ -34,6 +34,7 @@
 #include <iprt/asm.h>
 #include <iprt/assert.h>
 #include <iprt/thread.h>
+#include <iprt/time.h>
 
 
 /*********************************************************************************************************************************
@@ -42,6 +43,8 @@
 DECLINLINE(void)            pdmR3QueueFreeItem(PPDMQUEUE pQueue, PPDMQUEUEITEMCORE pItem);
 static bool                 pdmR3QueueFlush(PPDMQUEUE pQueue);
 static DECLCALLBACK(void)   pdmR3QueueTimer(PVM pVM, PTMTIMER pTimer, void *pvUser);
+static DECLCALLBACK(int)    pdmR3QueueConsumerThread(PVM pVM, PPDMTHREAD pThread);
+static DECLCALLBACK(int)    pdmR3QueueConsumerWakeUp(PVM pVM, PPDMTHREAD pThread);
 
 
 
@@ -99,6 +102,8 @@ static int pdmR3QueueCreate(PVM pVM, size_t cbItem, uint32_t cItems, uint32_t cM
     //pQueue->pPendingRC = NULL;
     pQueue->iFreeHead = cItems;
     //pQueue->iFreeTail = 0;
+    pQueue->hEvtConsumer = NIL_SUPSEMEVENT;
+    pQueue->u64NanoTSDeadline = UINT64_MAX;
     PPDMQUEUEITEMCORE pItem = (PPDMQUEUEITEMCORE)((char *)pQueue + RT_ALIGN_Z(RT_OFFSETOF(PDMQUEUE, aFreeItems[cItems + PDMQUEUE_FREE_SLACK]), 16));
     for (unsigned i = 0; i < cItems; i++, pItem = (PPDMQUEUEITEMCORE)((char *)pItem + cbItem))
     {
@@ -180,8 +185,9 @@ static int pdmR3QueueCreate(PVM pVM, size_t cbItem, uint32_t cItems, uint32_t cM
     STAMR3RegisterF(pVM, &pQueue->StatFlushLeftovers,   STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES,   "Left over items after flush.",     "/PDM/Queue/%s/FlushLeftovers", pQueue->pszName);
 #ifdef VBOX_WITH_STATISTICS
     STAMR3RegisterF(pVM, &pQueue->StatFlushPrf,         STAMTYPE_PROFILE, STAMVISIBILITY_ALWAYS, STAMUNIT_CALLS,        "Profiling pdmR3QueueFlush.",       "/PDM/Queue/%s/FlushPrf",       pQueue->pszName);
-    STAMR3RegisterF(pVM, (void *)&pQueue->cStatPending, STAMTYPE_U32,     STAMVISIBILITY_ALWAYS, STAMUNIT_COUNT,        "Pending items.",                   "/PDM/Queue/%s/Pending",        pQueue->pszName);
 #endif
+    STAMR3RegisterF(pVM, (void *)&pQueue->cPending,     STAMTYPE_U32,     STAMVISIBILITY_ALWAYS, STAMUNIT_COUNT,        "Pending items.",                   "/PDM/Queue/%s/Pending",        pQueue->pszName);
+    STAMR3RegisterF(pVM, (void *)&pQueue->cPendingMax,  STAMTYPE_U32_RESET, STAMVISIBILITY_ALWAYS, STAMUNIT_COUNT,      "Max pending items.",               "/PDM/Queue/%s/PendingMax",     pQueue->pszName);
 
     *ppQueue = pQueue;
     return VINF_SUCCESS;
@@ -375,6 +381,79 @@ VMMR3_INT_DECL(int) PDMR3QueueCreateExternal(PVM pVM, size_t cbItem, uint32_t cI
 }
 
 
+/**
+ * Hands the processing of a queue over to a dedicated consumer thread.
+ *
+ * Instead of raising VM_FF_PDM_QUEUES and having an EMT flush the queue on its
+ * next trip thru ring-3, the producers (R0 and R3, any thread) wake up the
+ * consumer thread via a support driver event semaphore.  The consumer grabs
+ * all pending items in one go and feeds them to the queue callback.
+ *
+ * Wakeups are coalesced: PDMQueueInsertEx only signals the consumer if its
+ * NanoMaxDelay deadline is earlier than the one the consumer is already
+ * waiting for, or when @a cMaxBatch items are pending.  PDMQueueInsert
+ * requests immediate processing.
+ *
+ * @returns VBox status code.
+ * @param   pQueue              The queue.  Must not be timer driven and the
+ *                              consumer callback must be safe to call on a
+ *                              non-EMT thread.
+ * @param   cMaxBatch           Number of pending items which triggers a
+ *                              wakeup regardless of the deadlines.
+ * @param   enmType             The thread type.
+ * @param   pszThreadName       The thread name.  Not copied.
+ * @thread  Emulation thread only.
+ */
+VMMR3_INT_DECL(int) PDMR3QueueEnableConsumerThread(PPDMQUEUE pQueue, uint32_t cMaxBatch, RTTHREADTYPE enmType,
+                                                   const char *pszThreadName)
+{
+    LogFlow(("PDMR3QueueEnableConsumerThread: pQueue=%p:{%s} cMaxBatch=%u enmType=%d pszThreadName=%s\n",
+             pQueue, pQueue ? pQueue->pszName : NULL, cMaxBatch, enmType, pszThreadName));
+
+    /*
+     * Validate input.
+     */
+    AssertPtrReturn(pQueue, VERR_INVALID_POINTER);
+    PVM pVM = pQueue->pVMR3;
+    AssertPtrReturn(pVM, VERR_INVALID_HANDLE);
+    VM_ASSERT_EMT_RETURN(pVM, VERR_VM_THREAD_NOT_EMT);
+    AssertReturn(!pQueue->pTimer, VERR_INVALID_STATE);
+    AssertReturn(pQueue->hEvtConsumer == NIL_SUPSEMEVENT, VERR_WRONG_ORDER);
+    AssertMsgReturn(cMaxBatch >= 1 && cMaxBatch <= pQueue->cItems, ("cMaxBatch=%u\n", cMaxBatch), VERR_OUT_OF_RANGE);
+    AssertPtrReturn(pszThreadName, VERR_INVALID_POINTER);
+
+    /*
+     * Create the event semaphore and the thread.  The event must be in place
+     * before the thread starts, while the inserters must not use it before
+     * the thread exists, so the handle is published last.
+     */
+    SUPSEMEVENT hEvt;
+    int rc = SUPSemEventCreate(pVM->pSession, &hEvt);
+    AssertRCReturn(rc, rc);
+
+    pQueue->cMaxBatch         = cMaxBatch;
+    pQueue->u64NanoTSDeadline = UINT64_MAX;
+    pQueue->hEvtConsumer      = hEvt;
+    rc = PDMR3ThreadCreate(pVM, &pQueue->pThread, pQueue, pdmR3QueueConsumerThread, pdmR3QueueConsumerWakeUp,
+                           0 /*cbStack*/, enmType, pszThreadName);
+    if (RT_FAILURE(rc))
+    {
+        pQueue->hEvtConsumer = NIL_SUPSEMEVENT;
+        pQueue->pThread      = NULL;
+        SUPSemEventClose(pVM->pSession, hEvt);
+        return rc;
+    }
+
+    STAMR3RegisterF(pVM, &pQueue->cMaxBatch,            STAMTYPE_U32,     STAMVISIBILITY_ALWAYS, STAMUNIT_COUNT,        "Wakeup batch size.",               "/PDM/Queue/%s/Consumer/cMaxBatch", pQueue->pszName);
+    STAMR3RegisterF(pVM, &pQueue->StatConsumerSignals,  STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES,   "Consumer wakeups by producers.",   "/PDM/Queue/%s/Consumer/Signals",   pQueue->pszName);
+    STAMR3RegisterF(pVM, &pQueue->StatConsumerBatches,  STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES,   "Batches processed.",               "/PDM/Queue/%s/Consumer/Batches",   pQueue->pszName);
+    STAMR3RegisterF(pVM, &pQueue->StatConsumerItems,    STAMTYPE_COUNTER, STAMVISIBILITY_ALWAYS, STAMUNIT_OCCURENCES,   "Items processed.",                 "/PDM/Queue/%s/Consumer/Items",     pQueue->pszName);
+
+    Log(("PDM: Queue %s is now serviced by thread %s (cMaxBatch=%u)\n", pQueue->pszName, pszThreadName, cMaxBatch));
+    return VINF_SUCCESS;
+}
+
+
 /**
  * Destroy a queue.
  *
@@ -439,13 +518,30 @@ VMMR3_INT_DECL(int) PDMR3QueueDestroy(PPDMQUEUE pQueue)
             pUVM->pdm.s.pQueuesForced = pQueue->pNext;
     }
     pQueue->pNext = NULL;
-    pQueue->pVMR3 = NULL;
     pdmUnlock(pVM);
 
+    /*
+     * Stop the consumer thread (if any) before the queue goes away.
+     */
+    if (pQueue->pThread)
+    {
+        int rcThread;
+        int rc = PDMR3ThreadDestroy(pQueue->pThread, &rcThread);
+        AssertRC(rc);
+        pQueue->pThread = NULL;
+    }
+    if (pQueue->hEvtConsumer != NIL_SUPSEMEVENT)
+    {
+        SUPSemEventClose(pVM->pSession, pQueue->hEvtConsumer);
+        pQueue->hEvtConsumer = NIL_SUPSEMEVENT;
+    }
+    pQueue->pVMR3 = NULL;
+
     /*
      * Deregister statistics.
      */
     STAMR3DeregisterF(pVM->pUVM, "/PDM/Queue/%s/cbItem", pQueue->pszName);
+    STAMR3DeregisterF(pVM->pUVM, "/PDM/Queue/%s/Consumer/*", pQueue->pszName);
 
     /*
      * Destroy the timer and free it.
@@ -656,7 +752,17 @@ VMMR3_INT_DECL(void) PDMR3QueueFlushAll(PVM pVM)
             if (    pCur->pPendingR3
                 ||  pCur->pPendingR0
                 ||  pCur->pPendingRC)
-                pdmR3QueueFlush(pCur);
+            {
+                /* Queues with a consumer thread only get here when raw-mode
+                   inserted items, so just kick the thread. */
+                if (pCur->hEvtConsumer != NIL_SUPSEMEVENT)
+                {
+                    ASMAtomicWriteU64(&pCur->u64NanoTSDeadline, 0);
+                    SUPSemEventSignal(pVM->pSession, pCur->hEvtConsumer);
+                }
+                else
+                    pdmR3QueueFlush(pCur);
+            }
 
         ASMAtomicBitClear(&pVM->pdm.s.fQueueFlushing, PDM_QUEUE_FLUSH_FLAG_ACTIVE_BIT);
 
@@ -839,7 +945,8 @@ static bool pdmR3QueueFlush(PPDMQUEUE pQueue)
  */
 DECLINLINE(void) pdmR3QueueFreeItem(PPDMQUEUE pQueue, PPDMQUEUEITEMCORE pItem)
 {
-    VM_ASSERT_EMT(pQueue->pVMR3);
+    Assert(   pQueue->hEvtConsumer != NIL_SUPSEMEVENT
+           || VM_IS_EMT(pQueue->pVMR3));
 
     int i = pQueue->iFreeHead;
     int iNext = (i + 1) % (pQueue->cItems + PDMQUEUE_FREE_SLACK);
@@ -853,7 +960,7 @@ DECLINLINE(void) pdmR3QueueFreeItem(PPDMQUEUE pQueue, PPDMQUEUEITEMCORE pItem)
 
     if (!ASMAtomicCmpXchgU32(&pQueue->iFreeHead, iNext, i))
         AssertMsgFailed(("huh? i=%d iNext=%d iFreeHead=%d iFreeTail=%d\n", i, iNext, pQueue->iFreeHead, pQueue->iFreeTail));
-    STAM_STATS({ ASMAtomicDecU32(&pQueue->cStatPending); });
+    ASMAtomicDecU32(&pQueue->cPending);
 }
 
 
@@ -878,3 +985,64 @@ static DECLCALLBACK(void) pdmR3QueueTimer(PVM pVM, PTMTIMER pTimer, void *pvUser
     AssertRC(rc);
 }
 
+
+/**
+ * @copydoc FNPDMTHREADINT
+ */
+static DECLCALLBACK(int) pdmR3QueueConsumerThread(PVM pVM, PPDMTHREAD pThread)
+{
+    PPDMQUEUE pQueue = (PPDMQUEUE)pThread->pvUser;
+    LogFlow(("pdmR3QueueConsumerThread: pQueue=%p:{%s}\n", pQueue, pQueue->pszName));
+
+    while (pThread->enmState == PDMTHREADSTATE_RUNNING)
+    {
+        /*
+         * Sleep until the earliest deadline requested by the producers.
+         */
+        uint64_t const u64Deadline = ASMAtomicReadU64(&pQueue->u64NanoTSDeadline);
+        if (u64Deadline > RTTimeNanoTS())
+        {
+            int rc;
+            if (u64Deadline == UINT64_MAX)
+                rc = SUPSemEventWaitNoResume(pVM->pSession, pQueue->hEvtConsumer, RT_INDEFINITE_WAIT);
+            else
+                rc = SUPSemEventWaitNsAbsIntr(pVM->pSession, pQueue->hEvtConsumer, u64Deadline);
+            AssertLogRelMsgReturn(RT_SUCCESS(rc) || rc == VERR_TIMEOUT || rc == VERR_INTERRUPTED,
+                                  ("%Rrc\n", rc), rc);
+            continue;
+        }
+
+        /*
+         * Reset the deadline before grabbing the items so that inserts racing
+         * us will signal the semaphore again, then process the whole batch.
+         */
+        ASMAtomicWriteU64(&pQueue->u64NanoTSDeadline, UINT64_MAX);
+        if (   pQueue->pPendingR3
+            || pQueue->pPendingR0
+            || pQueue->pPendingRC)
+        {
+            uint32_t const cPending = ASMAtomicReadU32(&pQueue->cPending);
+            STAM_REL_COUNTER_INC(&pQueue->StatConsumerBatches);
+            if (pdmR3QueueFlush(pQueue))
+                STAM_REL_COUNTER_ADD(&pQueue->StatConsumerItems, cPending);
+            else
+            {
+                /* The consumer said "enough!", retry the leftovers a little later. */
+                uint64_t const u64Retry = RTTimeNanoTS() + RT_NS_1MS;
+                ASMAtomicCmpXchgU64(&pQueue->u64NanoTSDeadline, u64Retry, UINT64_MAX);
+            }
+        }
+    }
+
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * @copydoc FNPDMTHREADWAKEUPINT
+ */
+static DECLCALLBACK(int) pdmR3QueueConsumerWakeUp(PVM pVM, PPDMTHREAD pThread)
+{
+    PPDMQUEUE pQueue = (PPDMQUEUE)pThread->pvUser;
+    return SUPSemEventSignal(pVM->pSession, pQueue->hEvtConsumer);
+}
@@ -112,7 +112,10 @@
  *       - type 5: Named data - length prefixed name followed by the data. This
  *                 type is not implemented yet as we're missing the API part, so
  *                 the type assignment is tentative.
- *       - types 6 thru 15 are current undefined.
+ *       - type 6: Raw data compressed by LZ4, same layout as type 3.  Only
+ *                 written when the SSM/UseLZ4 config key is set as older
+ *                 versions cannot read it.
+ *       - types 7 thru 15 are current undefined.
  *   - bit 4: Important (set), can be skipped (clear).
  *   - bit 5: Undefined flag, must be zero.
  *   - bit 6: Undefined flag, must be zero.
@@ -145,6 +148,7 @@
 *********************************************************************************************************************************/
 #define LOG_GROUP LOG_GROUP_SSM
 #include <VBox/vmm/ssm.h>
+#include <VBox/vmm/cfgm.h>
 #include <VBox/vmm/dbgf.h>
 #include <VBox/vmm/pdmapi.h>
 #include <VBox/vmm/pdmcritsect.h>
@@ -227,10 +231,13 @@
 /** Named data items.
  * A length prefix zero terminated string (i.e. max 255) followed by the data.  */
 #define SSM_REC_TYPE_NAMED                      5
+/** Raw data compressed by LZ4.
+ * Same layout as SSM_REC_TYPE_RAW_LZF. */
+#define SSM_REC_TYPE_RAW_LZ4                    6
 /** Macro for validating the record type.
  * This can be used with the flags+type byte, no need to mask out the type first. */
 #define SSM_REC_TYPE_IS_VALID(u8Type)           (   ((u8Type) & SSM_REC_TYPE_MASK) >  SSM_REC_TYPE_INVALID \
-                                                 && ((u8Type) & SSM_REC_TYPE_MASK) <= SSM_REC_TYPE_NAMED )
+                                                 && ((u8Type) & SSM_REC_TYPE_MASK) <= SSM_REC_TYPE_RAW_LZ4 )
 /** @} */
 
 /** The flag mask. */
@@ -514,6 +521,8 @@ typedef struct SSMHANDLE
             uint8_t         abDataBuffer[4096];
             /** The maximum downtime given as milliseconds. */
             uint32_t        cMsMaxDowntime;
+            /** Whether to compress data records using LZ4 instead of LZF. */
+            bool            fUseLz4;
         } Write;
 
         /** Read data. */
@@ -3480,12 +3489,13 @@ static int ssmR3DataWriteBig(PSSMHANDLE pSSM, const void *pvBuf, size_t cbBuf)
                 if (RT_FAILURE(rc))
                     break;
                 size_t cbRec = SSM_ZIP_BLOCK_SIZE - (SSM_ZIP_BLOCK_SIZE / 16);
-                rc = RTZipBlockCompress(RTZIPTYPE_LZF, RTZIPLEVEL_FAST, 0 /*fFlags*/,
+                bool const fLz4 = pSSM->u.Write.fUseLz4;
+                rc = RTZipBlockCompress(fLz4 ? RTZIPTYPE_LZ4 : RTZIPTYPE_LZF, RTZIPLEVEL_FAST, 0 /*fFlags*/,
                                         pvBuf, SSM_ZIP_BLOCK_SIZE,
                                         pb + 1 + 3 + 1, cbRec, &cbRec);
                 if (RT_SUCCESS(rc))
                 {
-                    pb[0] = SSM_REC_FLAGS_FIXED | SSM_REC_FLAGS_IMPORTANT | SSM_REC_TYPE_RAW_LZF;
+                    pb[0] = SSM_REC_FLAGS_FIXED | SSM_REC_FLAGS_IMPORTANT | (fLz4 ? SSM_REC_TYPE_RAW_LZ4 : SSM_REC_TYPE_RAW_LZF);
                     pb[4] = SSM_ZIP_BLOCK_SIZE / _1K;
                     cbRec += 1;
                 }
@@ -5184,7 +5194,13 @@ static int ssmR3SaveDoCreateFile(PVM pVM, const char *pszFilename, PCSSMSTRMOPS
     pSSM->u.Write.offDataBuffer     = 0;
     pSSM->u.Write.cMsMaxDowntime    = UINT32_MAX;
 
-    int rc;
+    /** @cfgm{/SSM/UseLZ4, bool, false}
+     * Compress data records using LZ4 instead of LZF.  This is faster in both
+     * directions and compresses a little better, but saved states written this
+     * way cannot be restored by versions predating SSM_REC_TYPE_RAW_LZ4. */
+    int rc = CFGMR3QueryBoolDef(CFGMR3GetChild(CFGMR3GetRoot(pVM), "SSM"), "UseLZ4", &pSSM->u.Write.fUseLz4, false);
+    AssertLogRelRCReturnStmt(rc, RTMemFree(pSSM), rc);
+
     if (pStreamOps)
         rc = ssmR3StrmInit(&pSSM->Strm, pStreamOps, pvStreamOpsUser, true /*fWrite*/, true /*fChecksummed*/, 8 /*cBuffers*/);
     else
@@ -6016,13 +6032,13 @@ DECLINLINE(int) ssmR3DataReadV2Raw(PSSMHANDLE pSSM, void *pvBuf, size_t cbToRead
 
 
 /**
- * Reads and checks the LZF "header".
+ * Reads and checks the LZF or LZ4 "header".
  *
  * @returns VBox status code. Sets pSSM->rc on error.
  * @param   pSSM            The saved state handle..
  * @param   pcbDecompr      Where to store the size of the decompressed data.
  */
-DECLINLINE(int) ssmR3DataReadV2RawLzfHdr(PSSMHANDLE pSSM, uint32_t *pcbDecompr)
+DECLINLINE(int) ssmR3DataReadV2RawZipHdr(PSSMHANDLE pSSM, uint32_t *pcbDecompr)
 {
     *pcbDecompr = 0; /* shuts up gcc. */
     AssertLogRelMsgReturn(   pSSM->u.Read.cbRecLeft > 1
@@ -6048,15 +6064,15 @@ DECLINLINE(int) ssmR3DataReadV2RawLzfHdr(PSSMHANDLE pSSM, uint32_t *pcbDecompr)
 
 
 /**
- * Reads an LZF block from the stream and decompresses into the specified
- * buffer.
+ * Reads an LZF or LZ4 block from the stream and decompresses into the
+ * specified buffer.
  *
  * @returns VBox status code. Sets pSSM->rc on error.
  * @param   pSSM            The saved state handle.
  * @param   pvDst           Pointer to the output buffer.
  * @param   cbDecompr       The size of the decompressed data.
  */
-static int ssmR3DataReadV2RawLzf(PSSMHANDLE pSSM, void *pvDst, size_t cbDecompr)
+static int ssmR3DataReadV2RawZip(PSSMHANDLE pSSM, void *pvDst, size_t cbDecompr)
 {
     int         rc;
     uint32_t    cbCompr    = pSSM->u.Read.cbRecLeft;
@@ -6083,7 +6099,9 @@ static int ssmR3DataReadV2RawLzf(PSSMHANDLE pSSM, void *pvDst, size_t cbDecompr)
      * Decompress it.
      */
     size_t cbDstActual;
-    rc = RTZipBlockDecompress(RTZIPTYPE_LZF, 0 /*fFlags*/,
+    RTZIPTYPE const enmZipType = (pSSM->u.Read.u8TypeAndFlags & SSM_REC_TYPE_MASK) == SSM_REC_TYPE_RAW_LZ4
+                               ? RTZIPTYPE_LZ4 : RTZIPTYPE_LZF;
+    rc = RTZipBlockDecompress(enmZipType, 0 /*fFlags*/,
                               pb, cbCompr, NULL /*pcbSrcActual*/,
                               pvDst, cbDecompr, &cbDstActual);
     if (RT_SUCCESS(rc))
@@ -6356,20 +6374,21 @@ static int ssmR3DataReadUnbufferedV2(PSSMHANDLE pSSM, void *pvBuf, size_t cbBuf)
             }
 
             case SSM_REC_TYPE_RAW_LZF:
+            case SSM_REC_TYPE_RAW_LZ4:
             {
-                int rc = ssmR3DataReadV2RawLzfHdr(pSSM, &cbToRead);
+                int rc = ssmR3DataReadV2RawZipHdr(pSSM, &cbToRead);
                 if (RT_FAILURE(rc))
                     return rc;
                 if (cbToRead <= cbBuf)
                 {
-                    rc = ssmR3DataReadV2RawLzf(pSSM, pvBuf, cbToRead);
+                    rc = ssmR3DataReadV2RawZip(pSSM, pvBuf, cbToRead);
                     if (RT_FAILURE(rc))
                         return rc;
                 }
                 else
                 {
                     /* The output buffer is too small, use the data buffer. */
-                    rc = ssmR3DataReadV2RawLzf(pSSM, &pSSM->u.Read.abDataBuffer[0], cbToRead);
+                    rc = ssmR3DataReadV2RawZip(pSSM, &pSSM->u.Read.abDataBuffer[0], cbToRead);
                     if (RT_FAILURE(rc))
                         return rc;
                     pSSM->u.Read.cbDataBuffer  = cbToRead;
@@ -6479,11 +6498,12 @@ static int ssmR3DataReadBufferedV2(PSSMHANDLE pSSM, void *pvBuf, size_t cbBuf)
             }
 
             case SSM_REC_TYPE_RAW_LZF:
+            case SSM_REC_TYPE_RAW_LZ4:
             {
-                int rc = ssmR3DataReadV2RawLzfHdr(pSSM, &cbToRead);
+                int rc = ssmR3DataReadV2RawZipHdr(pSSM, &cbToRead);
                 if (RT_FAILURE(rc))
                     return rc;
-                rc = ssmR3DataReadV2RawLzf(pSSM, &pSSM->u.Read.abDataBuffer[0], cbToRead);
+                rc = ssmR3DataReadV2RawZip(pSSM, &pSSM->u.Read.abDataBuffer[0], cbToRead);
                 if (RT_FAILURE(rc))
                     return rc;
                 pSSM->u.Read.cbDataBuffer = cbToRead;
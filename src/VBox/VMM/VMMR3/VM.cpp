@@ -911,6 +911,16 @@ static int vmR3InitRing3(PVM pVM, PUVM pUVM)
         AssertRC(rc);
         rc = STAMR3RegisterF(pVM, &pUVM->aCpus[idCpu].vm.s.StatHaltTimers,          STAMTYPE_PROFILE, STAMVISIBILITY_ALWAYS, STAMUNIT_NS_PER_CALL, "Profiling halted state timer tasks.", "/PROF/CPU%d/VM/Halt/Timers", idCpu);
         AssertRC(rc);
+        rc = STAMR3RegisterF(pVM, &pUVM->aCpus[idCpu].vm.s.StatHaltPollHit,         STAMTYPE_PROFILE, STAMVISIBILITY_USED,   STAMUNIT_NS_PER_CALL, "Halt polls that found pending work.", "/PROF/CPU%d/VM/Halt/PollHit", idCpu);
+        AssertRC(rc);
+        rc = STAMR3RegisterF(pVM, &pUVM->aCpus[idCpu].vm.s.StatHaltPollMiss,        STAMTYPE_PROFILE, STAMVISIBILITY_USED,   STAMUNIT_NS_PER_CALL, "Time wasted by halt polls that blocked anyway.", "/PROF/CPU%d/VM/Halt/PollMiss", idCpu);
+        AssertRC(rc);
+        rc = STAMR3RegisterF(pVM, &pUVM->aCpus[idCpu].vm.s.StatHaltPollGrow,        STAMTYPE_COUNTER, STAMVISIBILITY_USED,   STAMUNIT_OCCURENCES,  "Times the halt poll window was grown.", "/PROF/CPU%d/VM/Halt/PollGrow", idCpu);
+        AssertRC(rc);
+        rc = STAMR3RegisterF(pVM, &pUVM->aCpus[idCpu].vm.s.StatHaltPollShrink,      STAMTYPE_COUNTER, STAMVISIBILITY_USED,   STAMUNIT_OCCURENCES,  "Times the halt poll window was shrunk.", "/PROF/CPU%d/VM/Halt/PollShrink", idCpu);
+        AssertRC(rc);
+        rc = STAMR3RegisterF(pVM, &pUVM->aCpus[idCpu].vm.s.cNsHaltPollWindow,       STAMTYPE_U32,     STAMVISIBILITY_USED,   STAMUNIT_NS,          "The current halt poll window.", "/PROF/CPU%d/VM/Halt/PollWindow", idCpu);
+        AssertRC(rc);
     }
 
     STAM_REG(pVM, &pUVM->vm.s.StatReqAllocNew,   STAMTYPE_COUNTER,     "/VM/Req/AllocNew",       STAMUNIT_OCCURENCES,        "Number of VMR3ReqAlloc returning a new packet.");
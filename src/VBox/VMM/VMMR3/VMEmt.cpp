@@ -401,6 +401,139 @@ static DECLCALLBACK(int) vmR3HaltOldDoHalt(PUVMCPU pUVCpu, const uint32_t fMask,
 }
 
 
+/**
+ * Reads the adaptive halt polling configuration used by halt method 1 and the
+ * global 1 halt method.
+ *
+ * @param   pUVM        The user mode VM structure.
+ */
+static void vmR3HaltPollReadConfigU(PUVM pUVM)
+{
+    /*
+     * The defaults.  Polling is disabled unless a max window is configured.
+     */
+    pUVM->vm.s.cNsHaltPollMaxCfg   = 0;
+    pUVM->vm.s.cNsHaltPollStartCfg = 10000;     /* 10 us */
+    pUVM->vm.s.uHaltPollGrowCfg    = 2;
+    pUVM->vm.s.uHaltPollShrinkCfg  = 2;
+
+    /*
+     * Query overrides.
+     */
+    PCFGMNODE pCfg = CFGMR3GetChild(CFGMR3GetRoot(pUVM->pVM), "/VMM/HaltPoll");
+    if (pCfg)
+    {
+        uint32_t u32;
+        /** @cfgm{/VMM/HaltPoll/MaxNs, uint32_t, 0}
+         * The max number of nanoseconds an EMT polls for pending interrupts and
+         * timers before blocking when the guest halts, 0 disables polling.  Values
+         * around 200000 (200 us) suits latency sensitive guests. */
+        if (RT_SUCCESS(CFGMR3QueryU32(pCfg, "MaxNs", &u32)))
+            pUVM->vm.s.cNsHaltPollMaxCfg = RT_MIN(u32, RT_NS_10MS);
+        /** @cfgm{/VMM/HaltPoll/StartNs, uint32_t, 10000}
+         * The polling window to start out with when growing it from zero. */
+        if (RT_SUCCESS(CFGMR3QueryU32(pCfg, "StartNs", &u32)) && u32 > 0)
+            pUVM->vm.s.cNsHaltPollStartCfg = u32;
+        /** @cfgm{/VMM/HaltPoll/Grow, uint32_t, 2}
+         * The factor the polling window is grown by after a short block. */
+        if (RT_SUCCESS(CFGMR3QueryU32(pCfg, "Grow", &u32)) && u32 >= 2)
+            pUVM->vm.s.uHaltPollGrowCfg = u32;
+        /** @cfgm{/VMM/HaltPoll/Shrink, uint32_t, 2}
+         * The divisor the polling window is shrunk by after a long block, 0 resets
+         * the window to zero. */
+        if (RT_SUCCESS(CFGMR3QueryU32(pCfg, "Shrink", &u32)))
+            pUVM->vm.s.uHaltPollShrinkCfg = u32;
+    }
+    if (pUVM->vm.s.cNsHaltPollStartCfg > pUVM->vm.s.cNsHaltPollMaxCfg)
+        pUVM->vm.s.cNsHaltPollStartCfg = pUVM->vm.s.cNsHaltPollMaxCfg;
+    if (pUVM->vm.s.cNsHaltPollMaxCfg)
+        LogRel(("VMEmt: HaltPoll config: max=%u ns start=%u ns grow=%u shrink=%u\n",
+                pUVM->vm.s.cNsHaltPollMaxCfg, pUVM->vm.s.cNsHaltPollStartCfg,
+                pUVM->vm.s.uHaltPollGrowCfg, pUVM->vm.s.uHaltPollShrinkCfg));
+
+    for (VMCPUID idCpu = 0; idCpu < pUVM->cCpus; idCpu++)
+        pUVM->aCpus[idCpu].vm.s.cNsHaltPollWindow = 0;
+}
+
+
+/**
+ * Polls for pending work before blocking in a halt loop.
+ *
+ * @returns true if there is something to do (force action pending or the next
+ *          timer is due), false if the window expired and the caller should
+ *          block.
+ * @param   pUVCpu          Pointer to the user mode VMCPU structure.
+ * @param   fMask           The VMCPU force action mask to check.
+ * @param   cNsToNextEvent  The number of nanoseconds till the next timer event.
+ */
+static bool vmR3HaltPoll(PUVMCPU pUVCpu, const uint32_t fMask, uint64_t cNsToNextEvent)
+{
+    uint32_t const cNsWindow = pUVCpu->vm.s.cNsHaltPollWindow;
+    if (!cNsWindow)
+        return false;
+
+    PVM            pVM              = pUVCpu->pVM;
+    PVMCPU         pVCpu            = pUVCpu->pVCpu;
+    uint64_t const u64Start         = RTTimeNanoTS();
+    uint64_t const u64PollDeadline  = u64Start + cNsWindow;
+    uint64_t const u64TimerDeadline = u64Start + cNsToNextEvent;
+    uint64_t       u64Now;
+    do
+    {
+        if (    VM_FF_IS_PENDING(pVM, VM_FF_EXTERNAL_HALTED_MASK)
+            ||  VMCPU_FF_IS_PENDING(pVCpu, fMask))
+        {
+            STAM_REL_PROFILE_ADD_PERIOD(&pUVCpu->vm.s.StatHaltPollHit, RTTimeNanoTS() - u64Start);
+            return true;
+        }
+        ASMNopPause();
+        u64Now = RTTimeNanoTS();
+        if (u64Now >= u64TimerDeadline)
+        {
+            STAM_REL_PROFILE_ADD_PERIOD(&pUVCpu->vm.s.StatHaltPollHit, u64Now - u64Start);
+            return true;
+        }
+    } while (u64Now < u64PollDeadline);
+
+    STAM_REL_PROFILE_ADD_PERIOD(&pUVCpu->vm.s.StatHaltPollMiss, u64Now - u64Start);
+    return false;
+}
+
+
+/**
+ * Adjusts the halt polling window after blocking.
+ *
+ * A block that was short enough to have been covered by the max window grows
+ * the window so the next one is caught by polling, while a long block shrinks
+ * it so we don't burn host CPU on guests that are really idle.
+ *
+ * @param   pUVCpu          Pointer to the user mode VMCPU structure.
+ * @param   cNsBlocked      How long we blocked.
+ */
+static void vmR3HaltPollAdjust(PUVMCPU pUVCpu, uint64_t cNsBlocked)
+{
+    PUVM     pUVM      = pUVCpu->pUVM;
+    uint32_t cNsWindow = pUVCpu->vm.s.cNsHaltPollWindow;
+    if (cNsBlocked <= pUVM->vm.s.cNsHaltPollMaxCfg)
+    {
+        if (cNsWindow < cNsBlocked)
+        {
+            if (!cNsWindow)
+                cNsWindow = pUVM->vm.s.cNsHaltPollStartCfg;
+            else
+                cNsWindow = (uint32_t)RT_MIN((uint64_t)cNsWindow * pUVM->vm.s.uHaltPollGrowCfg, pUVM->vm.s.cNsHaltPollMaxCfg);
+            STAM_REL_COUNTER_INC(&pUVCpu->vm.s.StatHaltPollGrow);
+        }
+    }
+    else if (cNsWindow)
+    {
+        cNsWindow = pUVM->vm.s.uHaltPollShrinkCfg ? cNsWindow / pUVM->vm.s.uHaltPollShrinkCfg : 0;
+        STAM_REL_COUNTER_INC(&pUVCpu->vm.s.StatHaltPollShrink);
+    }
+    pUVCpu->vm.s.cNsHaltPollWindow = cNsWindow;
+}
+
+
 /**
  * Initialize the configuration of halt method 1 & 2.
  *
@@ -466,6 +599,7 @@ static int vmR3HaltMethod12ReadConfigU(PUVM pUVM)
  */
 static DECLCALLBACK(int) vmR3HaltMethod1Init(PUVM pUVM)
 {
+    vmR3HaltPollReadConfigU(pUVM);
     return vmR3HaltMethod12ReadConfigU(pUVM);
 }
 
@@ -561,6 +695,10 @@ static DECLCALLBACK(int) vmR3HaltMethod1Halt(PUVMCPU pUVCpu, const uint32_t fMas
             &&  u64NanoTS >= 250000) /* 0.250 ms */
 #endif
         {
+            /* Poll a little first if that has been paying off recently. */
+            if (vmR3HaltPoll(pUVCpu, fMask, u64NanoTS))
+                continue;
+
             const uint64_t Start = pUVCpu->vm.s.Halt.Method12.u64LastBlockTS = RTTimeNanoTS();
             VMMR3YieldStop(pVM);
 
@@ -575,6 +713,8 @@ static DECLCALLBACK(int) vmR3HaltMethod1Halt(PUVMCPU pUVCpu, const uint32_t fMas
             rc = RTSemEventWait(pUVCpu->vm.s.EventSemWait, cMilliSecs);
             uint64_t const cNsElapsedSchedHalt = RTTimeNanoTS() - u64StartSchedHalt;
             STAM_REL_PROFILE_ADD_PERIOD(&pUVCpu->vm.s.StatHaltBlock, cNsElapsedSchedHalt);
+            if (pUVM->vm.s.cNsHaltPollMaxCfg)
+                vmR3HaltPollAdjust(pUVCpu, cNsElapsedSchedHalt);
 
             if (rc == VERR_TIMEOUT)
                 rc = VINF_SUCCESS;
@@ -653,6 +793,8 @@ static DECLCALLBACK(int) vmR3HaltGlobal1Init(PUVM pUVM)
     }
     LogRel(("VMEmt: HaltedGlobal1 config: cNsSpinBlockThresholdCfg=%u\n",
             pUVM->vm.s.Halt.Global1.cNsSpinBlockThresholdCfg));
+
+    vmR3HaltPollReadConfigU(pUVM);
     return VINF_SUCCESS;
 }
 
@@ -710,12 +852,18 @@ static DECLCALLBACK(int) vmR3HaltGlobal1Halt(PUVMCPU pUVCpu, const uint32_t fMas
                 ||  VMCPU_FF_IS_PENDING(pVCpu, fMask))
                 break;
 
+            /* Poll a little first if that has been paying off recently. */
+            if (vmR3HaltPoll(pUVCpu, fMask, u64Delta))
+                continue;
+
             //RTLogPrintf("loop=%-3d  u64GipTime=%'llu / %'llu   now=%'llu / %'llu\n", cLoops, u64GipTime, u64Delta, u64NowLog, u64GipTime - u64NowLog);
             uint64_t const u64StartSchedHalt   = RTTimeNanoTS();
             rc = SUPR3CallVMMR0Ex(pVM->pVMR0, pVCpu->idCpu, VMMR0_DO_GVMM_SCHED_HALT, u64GipTime, NULL);
             uint64_t const u64EndSchedHalt     = RTTimeNanoTS();
             uint64_t const cNsElapsedSchedHalt = u64EndSchedHalt - u64StartSchedHalt;
             STAM_REL_PROFILE_ADD_PERIOD(&pUVCpu->vm.s.StatHaltBlock, cNsElapsedSchedHalt);
+            if (pUVM->vm.s.cNsHaltPollMaxCfg)
+                vmR3HaltPollAdjust(pUVCpu, cNsElapsedSchedHalt);
 
             if (rc == VERR_INTERRUPTED)
                 rc = VINF_SUCCESS;
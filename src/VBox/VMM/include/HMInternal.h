@@ -144,6 +144,27 @@ RT_C_DECLS_BEGIN
 #define MASK_EXITREASON_STAT       0xff
 #define MASK_INJECT_IRQ_STAT       0xff
 
+/** @name VM-exit profiler.
+ * @{ */
+/** Number of log2 latency buckets per exit reason.  Bucket N counts exits
+ *  whose handling took less than 2^N TSC ticks, the last one catches the rest. */
+#define HM_EXIT_PROF_BUCKETS       24
+/** Number of (RIP, address) hot spots tracked per exit reason. */
+#define HM_EXIT_PROF_HOT_SPOTS     4
+/** Profiler index used for AMD-V nested page faults.  Exit reasons below
+ *  MAX_EXITREASON_STAT are used as-is, the sparse ones above it get their own
+ *  indexes so they don't alias the low ones. */
+#define HM_EXIT_PROF_IDX_NPF                    (MAX_EXITREASON_STAT + 0)
+/** Profiler index used for AMD-V AVIC incomplete IPI exits. */
+#define HM_EXIT_PROF_IDX_AVIC_INCOMPLETE_IPI    (MAX_EXITREASON_STAT + 1)
+/** Profiler index used for AMD-V AVIC unhandled register access exits. */
+#define HM_EXIT_PROF_IDX_AVIC_NOACCEL           (MAX_EXITREASON_STAT + 2)
+/** Profiler index used for any other exit reason. */
+#define HM_EXIT_PROF_IDX_OTHER                  (MAX_EXITREASON_STAT + 3)
+/** Number of exit reason entries in HMEXITPROF. */
+#define HM_EXIT_PROF_REASONS                    (MAX_EXITREASON_STAT + 4)
+/** @} */
+
 /** @name HM changed flags.
  * These flags are used to keep track of which important registers that
  * have been changed since last they were reset.
@@ -558,7 +579,9 @@ typedef struct HM
 
     /** HMR0Init was run */
     bool                    fHMR0Init;
-    bool                    u8Alignment1[3];
+    /** Set if the VM-exit latency profiler is enabled (/HM/ExitProfiling). */
+    bool                    fExitProfiling;
+    bool                    u8Alignment1[2];
 
     STAMCOUNTER             StatTprPatchSuccess;
     STAMCOUNTER             StatTprPatchFailure;
@@ -569,6 +592,59 @@ typedef struct HM
 /** Pointer to HM VM instance data. */
 typedef HM *PHM;
 
+
+/**
+ * VM-exit profiler hot spot, i.e. a guest RIP and exit specific address
+ * (I/O port, guest-physical address) pair that causes exits.
+ */
+typedef struct HMEXITPROFHOTSPOT
+{
+    /** The guest RIP of the exiting instruction. */
+    uint64_t                uRip;
+    /** The exit specific address (I/O port or guest-physical address), 0 if n/a. */
+    uint64_t                uAddr;
+    /** Number of exits attributed to this hot spot. */
+    uint64_t                cHits;
+    /** Number of TSC ticks spent handling exits attributed to this hot spot. */
+    uint64_t                cTicks;
+} HMEXITPROFHOTSPOT;
+/** Pointer to a VM-exit profiler hot spot. */
+typedef HMEXITPROFHOTSPOT *PHMEXITPROFHOTSPOT;
+/** Pointer to a const VM-exit profiler hot spot. */
+typedef HMEXITPROFHOTSPOT const *PCHMEXITPROFHOTSPOT;
+
+/**
+ * VM-exit profiler data for one exit reason.
+ */
+typedef struct HMEXITPROFREASON
+{
+    /** Number of exits recorded. */
+    uint64_t                cExits;
+    /** Total number of TSC ticks spent handling the exits. */
+    uint64_t                cTicks;
+    /** Log2 latency histogram, see HM_EXIT_PROF_BUCKETS. */
+    uint32_t                acBuckets[HM_EXIT_PROF_BUCKETS];
+    /** The most frequent hot spots (space-saving approximation). */
+    HMEXITPROFHOTSPOT       aHotSpots[HM_EXIT_PROF_HOT_SPOTS];
+} HMEXITPROFREASON;
+/** Pointer to VM-exit profiler data for one exit reason. */
+typedef HMEXITPROFREASON *PHMEXITPROFREASON;
+/** Pointer to const VM-exit profiler data for one exit reason. */
+typedef HMEXITPROFREASON const *PCHMEXITPROFREASON;
+
+/**
+ * Per-VCPU VM-exit profiler data, allocated from the hyper heap when
+ * /HM/ExitProfiling is enabled.
+ */
+typedef struct HMEXITPROF
+{
+    /** Per exit reason data, indexed by the exit reason if below
+     *  MAX_EXITREASON_STAT, otherwise by one of the HM_EXIT_PROF_IDX_XXX. */
+    HMEXITPROFREASON        aReasons[HM_EXIT_PROF_REASONS];
+} HMEXITPROF;
+/** Pointer to per-VCPU VM-exit profiler data. */
+typedef HMEXITPROF *PHMEXITPROF;
+
 AssertCompileMemberAlignment(HM, StatTprPatchSuccess, 8);
 
 /* Maximum number of cached entries. */
@@ -1007,6 +1083,7 @@ typedef struct HMCPU
     STAMCOUNTER             StatExitDRxRead;
     STAMCOUNTER             StatExitRdmsr;
     STAMCOUNTER             StatExitWrmsr;
+    STAMCOUNTER             StatExitWrmsrX2ApicIcr;
     STAMCOUNTER             StatExitClts;
     STAMCOUNTER             StatExitXdtrAccess;
     STAMCOUNTER             StatExitHlt;
@@ -1089,6 +1166,11 @@ typedef struct HMCPU
 #ifdef HM_PROFILE_EXIT_DISPATCH
     STAMPROFILEADV          StatExitDispatch;
 #endif
+
+    /** VM-exit profiler data (R3 ptr), NULL if not enabled. */
+    R3PTRTYPE(PHMEXITPROF)  pExitProfR3;
+    /** VM-exit profiler data (R0 ptr), NULL if not enabled. */
+    R0PTRTYPE(PHMEXITPROF)  pExitProfR0;
 } HMCPU;
 /** Pointer to HM VMCPU instance data. */
 typedef HMCPU *PHMCPU;
@@ -1103,6 +1185,8 @@ AssertCompileMemberAlignment(HMCPU, Event, 8);
  *        everything here must be internal. */
 VMMR0DECL(PHMGLOBALCPUINFO) HMR0GetCurrentCpu(void);
 VMMR0DECL(PHMGLOBALCPUINFO) HMR0GetCurrentCpuEx(RTCPUID idCpu);
+DECLHIDDEN(void)            hmR0ExitProfRecord(PHMEXITPROF pExitProf, uint32_t idxReason, uint64_t uRip, uint64_t uAddr,
+                                               uint64_t cTicks);
 
 
 # ifdef VBOX_STRICT
@@ -55,6 +55,117 @@ DECLINLINE(PIOMIOPORTRANGER3) iomIOPortGetRangeR3(PVM pVM, RTIOPORT Port)
 }
 
 
+/**
+ * Gets the I/O port range for the specified I/O port in the current context,
+ * consulting the per-VCPU lookup caches before the AVL tree.
+ *
+ * @returns Pointer to I/O port range.
+ * @returns NULL if no port registered.
+ *
+ * @param   pVM         The cross context VM structure.
+ * @param   pVCpu       The cross context virtual CPU structure of the calling EMT.
+ * @param   Port        The I/O port to lookup.
+ * @param   ppRangeLast Pointer to the single entry cache to use and update
+ *                      (pRangeLastRead or pRangeLastWrite).
+ */
+DECLINLINE(CTX_SUFF(PIOMIOPORTRANGE)) iomIOPortGetRangeCached(PVM pVM, PVMCPU pVCpu, RTIOPORT Port,
+                                                              CTX_SUFF(PIOMIOPORTRANGE) *ppRangeLast)
+{
+    Assert(IOM_IS_SHARED_LOCK_OWNER(pVM));
+
+    CTX_SUFF(PIOMIOPORTRANGE) pRange = *ppRangeLast;
+    if (    pRange
+        &&  (unsigned)Port - (unsigned)pRange->Port < (unsigned)pRange->cPorts)
+    {
+        STAM_COUNTER_INC(&pVCpu->iom.s.StatIOPortLookupHits);
+        return pRange;
+    }
+
+    CTX_SUFF(PIOMIOPORTRANGE) *papSet = &pVCpu->iom.s.CTX_SUFF(apIOPortRangeCache)[IOM_IOPORT_CACHE_SET_IDX(Port)];
+    for (unsigned iWay = 0; iWay < IOM_LOOKUP_CACHE_WAYS; iWay++)
+    {
+        pRange = papSet[iWay];
+        if (    pRange
+            &&  (unsigned)Port - (unsigned)pRange->Port < (unsigned)pRange->cPorts)
+        {
+            /* Keep the set in most recently used order. */
+            for (; iWay > 0; iWay--)
+                papSet[iWay] = papSet[iWay - 1];
+            papSet[0] = pRange;
+            *ppRangeLast = pRange;
+            STAM_COUNTER_INC(&pVCpu->iom.s.StatIOPortLookupHits);
+            return pRange;
+        }
+    }
+
+    STAM_COUNTER_INC(&pVCpu->iom.s.StatIOPortLookupMisses);
+    pRange = iomIOPortGetRange(pVM, Port);
+    if (pRange)
+    {
+        /* Evict the least recently used entry. */
+        for (unsigned iWay = IOM_LOOKUP_CACHE_WAYS - 1; iWay > 0; iWay--)
+            papSet[iWay] = papSet[iWay - 1];
+        papSet[0] = pRange;
+        *ppRangeLast = pRange;
+    }
+    return pRange;
+}
+
+
+/**
+ * Looks up the MMIO range for the specified physical address in the current
+ * context, consulting the per-VCPU lookup caches before the AVL tree.
+ *
+ * @returns Pointer to MMIO range.
+ * @returns NULL if address not in a MMIO range.
+ *
+ * @param   pVM     The cross context VM structure.
+ * @param   pVCpu   The cross context virtual CPU structure of the calling EMT.
+ * @param   GCPhys  Physical address to lookup.
+ *
+ * @remarks The caller must own the IOM lock (shared will do).
+ */
+DECLINLINE(PIOMMMIORANGE) iomMmioLookupRangeCached(PVM pVM, PVMCPU pVCpu, RTGCPHYS GCPhys)
+{
+    PIOMMMIORANGE pRange = pVCpu->iom.s.CTX_SUFF(pMMIORangeLast);
+    if (    pRange
+        &&  GCPhys - pRange->GCPhys < pRange->cb)
+    {
+        STAM_COUNTER_INC(&pVCpu->iom.s.StatMMIOLookupHits);
+        return pRange;
+    }
+
+    PIOMMMIORANGE *papSet = &pVCpu->iom.s.CTX_SUFF(apMMIORangeCache)[IOM_MMIO_CACHE_SET_IDX(GCPhys)];
+    for (unsigned iWay = 0; iWay < IOM_LOOKUP_CACHE_WAYS; iWay++)
+    {
+        pRange = papSet[iWay];
+        if (    pRange
+            &&  GCPhys - pRange->GCPhys < pRange->cb)
+        {
+            /* Keep the set in most recently used order. */
+            for (; iWay > 0; iWay--)
+                papSet[iWay] = papSet[iWay - 1];
+            papSet[0] = pRange;
+            pVCpu->iom.s.CTX_SUFF(pMMIORangeLast) = pRange;
+            STAM_COUNTER_INC(&pVCpu->iom.s.StatMMIOLookupHits);
+            return pRange;
+        }
+    }
+
+    STAM_COUNTER_INC(&pVCpu->iom.s.StatMMIOLookupMisses);
+    pRange = (PIOMMMIORANGE)RTAvlroGCPhysRangeGet(&pVM->iom.s.CTX_SUFF(pTrees)->MMIOTree, GCPhys);
+    if (pRange)
+    {
+        /* Evict the least recently used entry. */
+        for (unsigned iWay = IOM_LOOKUP_CACHE_WAYS - 1; iWay > 0; iWay--)
+            papSet[iWay] = papSet[iWay - 1];
+        papSet[0] = pRange;
+    }
+    pVCpu->iom.s.CTX_SUFF(pMMIORangeLast) = pRange;
+    return pRange;
+}
+
+
 /**
  * Gets the MMIO range for the specified physical address in the current context.
  *
@@ -68,12 +179,7 @@ DECLINLINE(PIOMIOPORTRANGER3) iomIOPortGetRangeR3(PVM pVM, RTIOPORT Port)
 DECLINLINE(PIOMMMIORANGE) iomMmioGetRange(PVM pVM, PVMCPU pVCpu, RTGCPHYS GCPhys)
 {
     Assert(IOM_IS_SHARED_LOCK_OWNER(pVM));
-    PIOMMMIORANGE pRange = pVCpu->iom.s.CTX_SUFF(pMMIORangeLast);
-    if (    !pRange
-        ||  GCPhys - pRange->GCPhys >= pRange->cb)
-        pVCpu->iom.s.CTX_SUFF(pMMIORangeLast) = pRange
-            = (PIOMMMIORANGE)RTAvlroGCPhysRangeGet(&pVM->iom.s.CTX_SUFF(pTrees)->MMIOTree, GCPhys);
-    return pRange;
+    return iomMmioLookupRangeCached(pVM, pVCpu, GCPhys);
 }
 
 /**
@@ -106,11 +212,7 @@ DECLINLINE(PIOMMMIORANGE) iomMmioGetRangeWithRef(PVM pVM, PVMCPU pVCpu, RTGCPHYS
     int rc = IOM_LOCK_SHARED_EX(pVM, VINF_SUCCESS);
     AssertRCReturn(rc, NULL);
 
-    PIOMMMIORANGE pRange = pVCpu->iom.s.CTX_SUFF(pMMIORangeLast);
-    if (   !pRange
-        || GCPhys - pRange->GCPhys >= pRange->cb)
-        pVCpu->iom.s.CTX_SUFF(pMMIORangeLast) = pRange
-            = (PIOMMMIORANGE)RTAvlroGCPhysRangeGet(&pVM->iom.s.CTX_SUFF(pTrees)->MMIOTree, GCPhys);
+    PIOMMMIORANGE pRange = iomMmioLookupRangeCached(pVM, pVCpu, GCPhys);
     if (pRange)
         iomMmioRetainRange(pRange);
 
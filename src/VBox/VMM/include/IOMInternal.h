@@ -379,6 +379,28 @@ typedef struct IOM
 typedef IOM *PIOM;
 
 
+/** @name Per-VCPU range lookup cache geometry.
+ *
+ * The single entry pRangeLast / pMMIORangeLast caches are backed by a small
+ * set associative cache so that guests alternating between a handful of
+ * devices don't fall back on the AVL trees for every access.  The caches are
+ * flushed (iomR3FlushCache) whenever a range is registered or deregistered.
+ * @{ */
+/** Number of sets, power of two. */
+#define IOM_LOOKUP_CACHE_SETS               4
+/** Number of ways (entries) per set, most recently used first. */
+#define IOM_LOOKUP_CACHE_WAYS               2
+/** Total number of entries in each lookup cache. */
+#define IOM_LOOKUP_CACHE_ENTRIES            (IOM_LOOKUP_CACHE_SETS * IOM_LOOKUP_CACHE_WAYS)
+/** Calculates the index of the first entry of the set for an MMIO address. */
+#define IOM_MMIO_CACHE_SET_IDX(a_GCPhys) \
+    ( ((unsigned)(((a_GCPhys) >> PAGE_SHIFT) ^ ((a_GCPhys) >> (PAGE_SHIFT + 4))) & (IOM_LOOKUP_CACHE_SETS - 1)) * IOM_LOOKUP_CACHE_WAYS )
+/** Calculates the index of the first entry of the set for an I/O port. */
+#define IOM_IOPORT_CACHE_SET_IDX(a_Port) \
+    ( ((((unsigned)(a_Port) >> 4) ^ ((unsigned)(a_Port) >> 8)) & (IOM_LOOKUP_CACHE_SETS - 1)) * IOM_LOOKUP_CACHE_WAYS )
+/** @} */
+
+
 /**
  * IOM per virtual CPU instance data.
  */
@@ -451,6 +473,29 @@ typedef struct IOMCPU
     RCPTRTYPE(PIOMMMIORANGE)        pMMIORangeLastRC;
     RCPTRTYPE(PIOMMMIOSTATS)        pMMIOStatsLastRC;
     /** @} */
+
+    /** @name Set associative I/O port and MMIO range lookup caches.
+     * Consulted when the pRangeLast and pMMIORangeLast entries above miss.
+     * @{ */
+    R3PTRTYPE(PIOMIOPORTRANGER3)    apIOPortRangeCacheR3[IOM_LOOKUP_CACHE_ENTRIES];
+    R3PTRTYPE(PIOMMMIORANGE)        apMMIORangeCacheR3[IOM_LOOKUP_CACHE_ENTRIES];
+    R0PTRTYPE(PIOMIOPORTRANGER0)    apIOPortRangeCacheR0[IOM_LOOKUP_CACHE_ENTRIES];
+    R0PTRTYPE(PIOMMMIORANGE)        apMMIORangeCacheR0[IOM_LOOKUP_CACHE_ENTRIES];
+    RCPTRTYPE(PIOMIOPORTRANGERC)    apIOPortRangeCacheRC[IOM_LOOKUP_CACHE_ENTRIES];
+    RCPTRTYPE(PIOMMMIORANGE)        apMMIORangeCacheRC[IOM_LOOKUP_CACHE_ENTRIES];
+    /** @} */
+
+    /** @name Range lookup statistics.
+     * @{ */
+    /** I/O port lookups satisfied by the pRangeLast entries or the cache. */
+    STAMCOUNTER                     StatIOPortLookupHits;
+    /** I/O port lookups that had to walk the AVL tree. */
+    STAMCOUNTER                     StatIOPortLookupMisses;
+    /** MMIO lookups satisfied by the pMMIORangeLast entry or the cache. */
+    STAMCOUNTER                     StatMMIOLookupHits;
+    /** MMIO lookups that had to walk the AVL tree. */
+    STAMCOUNTER                     StatMMIOLookupMisses;
+    /** @} */
 } IOMCPU;
 /** Pointer to IOM per virtual CPU instance data. */
 typedef IOMCPU *PIOMCPU;
@@ -840,10 +840,35 @@ typedef struct PDMQUEUE
 #ifdef VBOX_WITH_STATISTICS
     /** State: Profiling the flushing. */
     STAMPROFILE                     StatFlushPrf;
-    /** State: Pending items. */
-    uint32_t volatile               cStatPending;
-    uint32_t volatile               cAlignment;
 #endif
+    /** Occupancy: Items inserted but not yet consumed. */
+    uint32_t volatile               cPending;
+    /** Occupancy: High water mark of cPending. */
+    uint32_t volatile               cPendingMax;
+
+    /** @name Consumer thread mode (PDMR3QueueEnableConsumerThread).
+     * @{ */
+    /** Event semaphore the consumer thread is waiting on.  NIL_SUPSEMEVENT if the
+     * queue is flushed by an EMT (VM_FF_PDM_QUEUES) or by the interval timer. */
+    SUPSEMEVENT                     hEvtConsumer;
+    /** Number of pending items which makes the producers wake up the consumer
+     * regardless of the coalescing deadline. */
+    uint32_t                        cMaxBatch;
+    /** The RTTimeNanoTS deadline by which the consumer thread must process the
+     * pending items.  UINT64_MAX if the consumer can sleep indefinitely. */
+    uint64_t volatile               u64NanoTSDeadline;
+    /** The consumer thread. */
+    R3PTRTYPE(PPDMTHREAD)           pThread;
+#if HC_ARCH_BITS == 32
+    RTR3PTR                         Alignment2;
+#endif
+    /** Stat: Consumer thread wakeups requested by producers. */
+    STAMCOUNTER                     StatConsumerSignals;
+    /** Stat: Batches processed by the consumer thread. */
+    STAMCOUNTER                     StatConsumerBatches;
+    /** Stat: Items processed by the consumer thread. */
+    STAMCOUNTER                     StatConsumerItems;
+    /** @} */
 
     /** Array of pointers to free items. Variable size. */
     struct PDMQUEUEFREEITEM
@@ -15,6 +15,9 @@
  * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
  */
 
+/** Maximum depth of the bandwidth group hierarchy (leaf group included). */
+#define PDM_NETSHAPER_MAX_DEPTH     4
+
 /**
  * Bandwidth group instance data
  */
@@ -24,23 +27,86 @@ typedef struct PDMNSBWGROUP
     R3PTRTYPE(struct PDMNSBWGROUP *)            pNextR3;
     /** Pointer to the shared UVM structure. */
     R3PTRTYPE(struct PDMNETSHAPER *)            pShaperR3;
+    /** Pointer to the parent group, NULL for a root group (ring-3). */
+    R3PTRTYPE(struct PDMNSBWGROUP *)            pParentR3;
+    /** Pointer to the parent group, NIL for a root group (ring-0). */
+    R0PTRTYPE(struct PDMNSBWGROUP *)            pParentR0;
+    /** The cross context VM structure (ring-3). */
+    PVMR3                                       pVMR3;
+    /** The cross context VM structure (ring-0). */
+    PVMR0                                       pVMR0;
+    /** Event semaphore the TX thread waits on (shared by all groups). */
+    SUPSEMEVENT                                 hEvtTx;
     /** Critical section protecting all members below. */
     PDMCRITSECT                                 Lock;
     /** Pointer to the first filter attached to this group. */
     R3PTRTYPE(struct PDMNSFILTER *)             pFiltersHeadR3;
+    /** The filter to consider first when releasing choked filters, this
+     * rotates so all filters in the group get a fair share (ring-3). */
+    R3PTRTYPE(struct PDMNSFILTER *)             pFilterCursorR3;
     /** Bandwidth group name. */
     R3PTRTYPE(char *)                           pszNameR3;
     /** Maximum number of bytes filters are allowed to transfer. */
     volatile uint64_t                           cbPerSecMax;
+    /** Configured burst size in bytes, 0 if derived from the rate. */
+    uint32_t                                    cbBurst;
     /** Number of bytes we are allowed to transfer in one burst. */
     volatile uint32_t                           cbBucket;
     /** Number of bytes we were allowed to transfer at the last update. */
     volatile uint32_t                           cbTokensLast;
+    /** Set if choked filters are waiting for the TX thread to release them. */
+    volatile bool                               fPending;
+    /** Alignment padding. */
+    bool                                        afPadding[3];
     /** Timestamp of the last update */
     volatile uint64_t                           tsUpdatedLast;
+    /** When the TX thread should release the choked filters (RTTimeSystemNanoTS). */
+    volatile uint64_t                           tsReleaseNext;
     /** Reference counter - How many filters are associated with this group. */
     volatile uint32_t                           cRefs;
 } PDMNSBWGROUP;
 /** Pointer to a bandwidth group. */
 typedef PDMNSBWGROUP *PPDMNSBWGROUP;
 
+
+/**
+ * Calculates the number of tokens in the bucket at the given time.
+ *
+ * @returns Number of bytes that may be transferred right now.
+ * @param   pBwGroup    The bandwidth group, caller owns the lock.
+ * @param   tsNow       The current RTTimeSystemNanoTS() value.
+ */
+DECLINLINE(uint32_t) pdmNsBwGroupCalcTokens(PPDMNSBWGROUP pBwGroup, uint64_t tsNow)
+{
+    uint64_t const cNsElapsed = tsNow - pBwGroup->tsUpdatedLast;
+    uint32_t const cbBucket   = pBwGroup->cbBucket;
+    uint64_t const cbPerSec   = pBwGroup->cbPerSecMax;
+    if ((int64_t)cNsElapsed < 0)
+        return cbBucket;
+    if (!cbPerSec)
+        return RT_MIN(cbBucket, pBwGroup->cbTokensLast);
+    /* The bucket is full once there was time to fill it from empty at the
+       configured rate.  Below that the product is less than
+       cbBucket * RT_NS_1SEC (< 2^62), so it cannot overflow. */
+    if (cNsElapsed >= (uint64_t)cbBucket * RT_NS_1SEC / cbPerSec)
+        return cbBucket;
+    uint64_t const cbAdded = cNsElapsed * cbPerSec / RT_NS_1SEC;
+    return (uint32_t)RT_MIN(cbBucket, cbAdded + pBwGroup->cbTokensLast);
+}
+
+
+/**
+ * Calculates how long it takes for the bucket to accumulate @a cbWanted bytes.
+ *
+ * @returns Nanoseconds.
+ * @param   pBwGroup    The bandwidth group.
+ * @param   cbTokens    Current number of tokens in the bucket.
+ * @param   cbWanted    The number of bytes required.
+ */
+DECLINLINE(uint64_t) pdmNsBwGroupCalcWait(PPDMNSBWGROUP pBwGroup, uint32_t cbTokens, uint32_t cbWanted)
+{
+    uint64_t const cbPerSec = RT_MAX(pBwGroup->cbPerSecMax, 1);
+    if (cbWanted <= cbTokens)
+        return 0;
+    return ((uint64_t)(cbWanted - cbTokens) * RT_NS_1SEC + cbPerSec - 1) / cbPerSec;
+}
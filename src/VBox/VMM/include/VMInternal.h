@@ -302,6 +302,21 @@ typedef struct VMINTUSERPERVM
         }                           Global1;
     }                               Halt;
 
+    /** @name Adaptive halt polling (halt methods 1 and global 1).
+     * The EMT spins for a self tuning window checking for pending interrupts
+     * and timers before blocking, avoiding the host sleep/wakeup cost for
+     * guests ping-ponging between HLT and interrupts.
+     * @{ */
+    /** The max polling window (ns), 0 if polling is disabled. */
+    uint32_t                        cNsHaltPollMaxCfg;
+    /** The window (ns) to start out with when growing from zero. */
+    uint32_t                        cNsHaltPollStartCfg;
+    /** The factor to grow the window by after a short block. */
+    uint32_t                        uHaltPollGrowCfg;
+    /** The divisor to shrink the window by after a long block. */
+    uint32_t                        uHaltPollShrinkCfg;
+    /** @} */
+
     /** Pointer to the DBGC instance data. */
     void                           *pvDBGC;
 
@@ -353,7 +368,9 @@ typedef struct VMINTUSERPERVMCPU
     uint32_t                        HaltFrequency;
     /** The number of halts in the current period. */
     uint32_t                        cHalts;
-    uint32_t                        padding; /**< alignment padding. */
+    /** The current adaptive halt polling window (ns), see
+     *  VMINTUSERPERVM::cNsHaltPollMaxCfg. */
+    uint32_t                        cNsHaltPollWindow;
     /** When we started counting halts in cHalts (RTTimeNanoTS). */
     uint64_t                        u64HaltsStartTS;
     /** @} */
@@ -435,6 +452,14 @@ typedef struct VMINTUSERPERVMCPU
     STAMPROFILE                     StatHaltBlockOnTime;
     STAMPROFILE                     StatHaltTimers;
     STAMPROFILE                     StatHaltPoll;
+    /** Time spent in halt polls ending with pending work (ns). */
+    STAMPROFILE                     StatHaltPollHit;
+    /** Time wasted in halt polls that ended up blocking anyway (ns). */
+    STAMPROFILE                     StatHaltPollMiss;
+    /** Number of times the halt polling window was grown. */
+    STAMCOUNTER                     StatHaltPollGrow;
+    /** Number of times the halt polling window was shrunk. */
+    STAMCOUNTER                     StatHaltPollShrink;
     /** @} */
 } VMINTUSERPERVMCPU;
 AssertCompileMemberAlignment(VMINTUSERPERVMCPU, u64HaltsStartTS, 8);